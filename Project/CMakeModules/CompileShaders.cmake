@@ -0,0 +1,46 @@
+# SPIR-V isn't committed: every glslc line of a CompileShader.bat is turned into a build step, so the batch file stays
+# the one list of shaders & their flags. glslc comes from Binary/ like the batch file expects, else the Vulkan SDK.
+#
+#   add_shader_target(<target> <batch file>)
+#
+# The batch file runs from its own directory, %~dp0 is that directory. Every shader is compiled again when any source
+# next to them changes, includes aren't tracked one by one.
+
+function(add_shader_target TARGET_NAME BATCH_FILE)
+    get_filename_component(BATCH_DIRECTORY "${BATCH_FILE}" DIRECTORY)
+    find_program(GLSLC_EXECUTABLE glslc
+        HINTS "${PROJECT_BINARY_ROOT}" "$ENV{VULKAN_SDK}/Bin" "$ENV{VULKAN_SDK}/bin")
+    if (NOT GLSLC_EXECUTABLE)
+        message(WARNING "glslc not found in ${PROJECT_BINARY_ROOT} or the Vulkan SDK, ${TARGET_NAME} compiles nothing, run ${BATCH_FILE} by hand.")
+        add_custom_target(${TARGET_NAME} SOURCES "${BATCH_FILE}")
+        return()
+    endif()
+
+    FILE(GLOB_RECURSE SHADER_SOURCE_FILE_LIST ${BATCH_DIRECTORY}/Engine/ShaderSource/*.*)
+    file(STRINGS "${BATCH_FILE}" SHADER_COMMAND_LIST REGEX "glslc")
+    set(SHADER_OUTPUT_FILE_LIST "")
+    foreach(SHADER_COMMAND ${SHADER_COMMAND_LIST})
+        separate_arguments(SHADER_ARGUMENT_LIST WINDOWS_COMMAND "${SHADER_COMMAND}")
+        list(POP_FRONT SHADER_ARGUMENT_LIST)
+        string(REPLACE "%~dp0" "${BATCH_DIRECTORY}/" SHADER_ARGUMENT_LIST "${SHADER_ARGUMENT_LIST}")
+
+        list(FIND SHADER_ARGUMENT_LIST "-o" SHADER_OUTPUT_INDEX)
+        if (SHADER_OUTPUT_INDEX LESS 0)
+            message(FATAL_ERROR "No -o in ${BATCH_FILE} line: ${SHADER_COMMAND}")
+        endif()
+        math(EXPR SHADER_OUTPUT_INDEX "${SHADER_OUTPUT_INDEX} + 1")
+        list(GET SHADER_ARGUMENT_LIST ${SHADER_OUTPUT_INDEX} SHADER_OUTPUT_FILE)
+        get_filename_component(SHADER_OUTPUT_FILE "${SHADER_OUTPUT_FILE}" ABSOLUTE BASE_DIR "${BATCH_DIRECTORY}")
+        get_filename_component(SHADER_OUTPUT_NAME "${SHADER_OUTPUT_FILE}" NAME)
+
+        add_custom_command(OUTPUT "${SHADER_OUTPUT_FILE}"
+            COMMAND "${GLSLC_EXECUTABLE}" ${SHADER_ARGUMENT_LIST}
+            DEPENDS ${SHADER_SOURCE_FILE_LIST} "${BATCH_FILE}"
+            WORKING_DIRECTORY "${BATCH_DIRECTORY}"
+            COMMENT "Compiling ${SHADER_OUTPUT_NAME}"
+            VERBATIM)
+        list(APPEND SHADER_OUTPUT_FILE_LIST "${SHADER_OUTPUT_FILE}")
+    endforeach()
+
+    add_custom_target(${TARGET_NAME} ALL DEPENDS ${SHADER_OUTPUT_FILE_LIST} SOURCES "${BATCH_FILE}" ${SHADER_SOURCE_FILE_LIST})
+endfunction()
@@ -1,2 +1,30 @@
 %~dp0../Binary/glslc.exe ./Engine/ShaderSource/sample.shader.vert --target-env=vulkan -g -c -o %~dp0../Data/Engine/sample.vs.spv  -fshader-stage=vertex -fentry-point=Vs_Main -DSTAGE=VERTEX_STAGE
-%~dp0../Binary/glslc.exe ./Engine/ShaderSource/sample.shader.frag --target-env=vulkan -g -c -o %~dp0../Data/Engine/sample.fs.spv  -fshader-stage=fragment -fentry-point=Ps_Main -DSTAGE=FRAGMENT_STAGE
\ No newline at end of file
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/sample.shader.frag --target-env=vulkan -g -c -o %~dp0../Data/Engine/sample.fs.spv  -fshader-stage=fragment -fentry-point=Ps_Main -DSTAGE=FRAGMENT_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/meshlet_cull.shader.comp --target-env=vulkan1.1 -g -c -o %~dp0../Data/Engine/meshlet_cull.cs.spv  -fshader-stage=compute -fentry-point=Cs_Main -DSTAGE=COMPUTE_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/meshlet.shader.vert --target-env=vulkan1.1 -g -c -o %~dp0../Data/Engine/meshlet.vs.spv  -fshader-stage=vertex -fentry-point=Vs_Main -DSTAGE=VERTEX_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/meshlet.shader.task --target-env=vulkan1.1 --target-spv=spv1.4 -g -c -o %~dp0../Data/Engine/meshlet.ts.spv  -fshader-stage=task -fentry-point=Ts_Main -DSTAGE=TASK_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/meshlet.shader.mesh --target-env=vulkan1.1 --target-spv=spv1.4 -g -c -o %~dp0../Data/Engine/meshlet.ms.spv  -fshader-stage=mesh -fentry-point=Ms_Main -DSTAGE=MESH_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/procedural_scene.shader.vert --target-env=vulkan -g -c -o %~dp0../Data/Engine/procedural_scene.vs.spv  -fshader-stage=vertex -fentry-point=Vs_Main -DSTAGE=VERTEX_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/procedural_scene.shader.frag --target-env=vulkan -g -c -o %~dp0../Data/Engine/procedural_scene.fs.spv  -fshader-stage=fragment -fentry-point=Ps_Main -DSTAGE=FRAGMENT_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/light_cluster.shader.comp --target-env=vulkan -g -c -o %~dp0../Data/Engine/light_cluster.cs.spv  -fshader-stage=compute -fentry-point=Cs_Main -DSTAGE=COMPUTE_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/clustered_pbr.shader.frag --target-env=vulkan -g -c -o %~dp0../Data/Engine/clustered_pbr.fs.spv  -fshader-stage=fragment -fentry-point=Ps_Main -DSTAGE=FRAGMENT_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/fullscreen.shader.vert --target-env=vulkan -g -c -o %~dp0../Data/Engine/fullscreen.vs.spv  -fshader-stage=vertex -fentry-point=Vs_Main -DSTAGE=VERTEX_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/gbuffer.shader.frag --target-env=vulkan -g -c -o %~dp0../Data/Engine/gbuffer.fs.spv  -fshader-stage=fragment -fentry-point=Ps_Main -DSTAGE=FRAGMENT_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/deferred_lighting.shader.frag --target-env=vulkan -g -c -o %~dp0../Data/Engine/deferred_lighting.fs.spv  -fshader-stage=fragment -fentry-point=Ps_Main -DSTAGE=FRAGMENT_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/shadowed_scene.shader.frag --target-env=vulkan -g -c -o %~dp0../Data/Engine/shadowed_scene.fs.spv  -fshader-stage=fragment -fentry-point=Ps_Main -DSTAGE=FRAGMENT_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/post_process.shader.comp --target-env=vulkan -g -c -o %~dp0../Data/Engine/post_process.cs.spv  -fshader-stage=compute -fentry-point=Cs_Main -DSTAGE=COMPUTE_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/post_process.shader.comp --target-env=vulkan -g -c -o %~dp0../Data/Engine/post_process_final.cs.spv  -fshader-stage=compute -fentry-point=Cs_Main -DSTAGE=COMPUTE_STAGE -DPOST_FINAL_OUTPUT
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/temporal_upscale.shader.comp --target-env=vulkan -g -c -o %~dp0../Data/Engine/temporal_upscale.cs.spv  -fshader-stage=compute -fentry-point=Cs_Main -DSTAGE=COMPUTE_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/particle_simulate.shader.comp --target-env=vulkan -g -c -o %~dp0../Data/Engine/particle_simulate.cs.spv  -fshader-stage=compute -fentry-point=Cs_Main -DSTAGE=COMPUTE_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/particle_sort.shader.comp --target-env=vulkan -g -c -o %~dp0../Data/Engine/particle_sort.cs.spv  -fshader-stage=compute -fentry-point=Cs_Main -DSTAGE=COMPUTE_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/particle.shader.vert --target-env=vulkan -g -c -o %~dp0../Data/Engine/particle.vs.spv  -fshader-stage=vertex -fentry-point=Vs_Main -DSTAGE=VERTEX_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/particle.shader.frag --target-env=vulkan -g -c -o %~dp0../Data/Engine/particle.fs.spv  -fshader-stage=fragment -fentry-point=Ps_Main -DSTAGE=FRAGMENT_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/skin.shader.comp --target-env=vulkan -g -c -o %~dp0../Data/Engine/skin.cs.spv  -fshader-stage=compute -fentry-point=Cs_Main -DSTAGE=COMPUTE_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/skinned.shader.vert --target-env=vulkan -g -c -o %~dp0../Data/Engine/skinned.vs.spv  -fshader-stage=vertex -fentry-point=Vs_Main -DSTAGE=VERTEX_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/procedural_scene.shader.vert --target-env=vulkan -g -c -o %~dp0../Data/Engine/procedural_scene_culled.vs.spv  -fshader-stage=vertex -fentry-point=Vs_Main -DSTAGE=VERTEX_STAGE -DINSTANCE_LIST
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/procedural_scene.shader.vert --target-env=vulkan -g -c -o %~dp0../Data/Engine/procedural_scene_batched.vs.spv  -fshader-stage=vertex -fentry-point=Vs_Main -DSTAGE=VERTEX_STAGE -DBATCHED
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/hiz_build.shader.comp --target-env=vulkan -g -c -o %~dp0../Data/Engine/hiz_build.cs.spv  -fshader-stage=compute -fentry-point=Cs_Main -DSTAGE=COMPUTE_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/occlusion_cull.shader.comp --target-env=vulkan -g -c -o %~dp0../Data/Engine/occlusion_cull.cs.spv  -fshader-stage=compute -fentry-point=Cs_Main -DSTAGE=COMPUTE_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/virtual_textured_scene.shader.frag --target-env=vulkan -g -c -o %~dp0../Data/Engine/virtual_textured_scene.fs.spv  -fshader-stage=fragment -fentry-point=Ps_Main -DSTAGE=FRAGMENT_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/virtual_texture_feedback.shader.frag --target-env=vulkan -g -c -o %~dp0../Data/Engine/virtual_texture_feedback.fs.spv  -fshader-stage=fragment -fentry-point=Ps_Main -DSTAGE=FRAGMENT_STAGE
+%~dp0../Binary/glslc.exe ./Engine/ShaderSource/virtual_texture_feedback.shader.comp --target-env=vulkan -g -c -o %~dp0../Data/Engine/virtual_texture_feedback.cs.spv  -fshader-stage=compute -fentry-point=Cs_Main -DSTAGE=COMPUTE_STAGE
\ No newline at end of file
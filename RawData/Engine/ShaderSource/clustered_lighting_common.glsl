@@ -0,0 +1,41 @@
+/******************************************************************************
+* Clustered forward+ lighting shared definitions, keep in sync with
+* VulkanClusteredLighting.h & VulkanClusteredLighting.cpp
+******************************************************************************/
+#define LIGHT_TYPE_POINT        0u
+#define LIGHT_TYPE_SPOT         1u
+#define CLUSTER_MAX_LIGHTS      256u
+
+struct ClusteredLight
+{
+    vec4 positionRange;     // xyz: world position, w: range
+    vec4 colorIntensity;    // rgb: linear color, w: intensity
+    vec4 directionType;     // xyz: spot direction, w: light type
+    vec4 spotCosines;       // x: cos outer angle, y: cos inner angle
+};
+
+layout(std140, set = 0, binding = 0) uniform ClusteredLightingParams
+{
+    mat4 view;
+    mat4 inverseProjection;
+    mat4 inverseView;
+    vec4 cameraPosition;
+    vec4 screenSize;        // xy: pixels, zw: pixels per cluster tile
+    vec4 depthSlicing;      // x: near, y: far, z: slice scale, w: slice bias
+    uvec4 gridSize;         // xyz: clusters, w: light count
+} cluster;
+
+layout(std430, set = 0, binding = 1) readonly buffer ClusteredLightBuffer { ClusteredLight lights[]; };
+
+uint ClusterIndex(uvec3 cell)
+{
+    return cell.x + cluster.gridSize.x * (cell.y + cluster.gridSize.y * cell.z);
+}
+
+// Froxel of a fragment, viewDepth is the positive distance along the view direction.
+uint ClusterOf(vec2 fragCoord, float viewDepth)
+{
+    uvec2 tile = min(uvec2(fragCoord / cluster.screenSize.zw), cluster.gridSize.xy - 1u);
+    float slice = log(max(viewDepth, cluster.depthSlicing.x)) * cluster.depthSlicing.z + cluster.depthSlicing.w;
+    return ClusterIndex(uvec3(tile, min(uint(max(slice, 0.0)), cluster.gridSize.z - 1u)));
+}
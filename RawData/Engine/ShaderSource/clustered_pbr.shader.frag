@@ -0,0 +1,26 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "clustered_lighting_common.glsl"
+#include "clustered_pbr_common.glsl"
+
+
+/******************************************************************************
+* Fragment Shader, metallic roughness PBR lit by the lights of its cluster
+******************************************************************************/
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec3 fragColor;
+layout(location = 2) in vec3 fragPosition;
+layout(location = 3) in vec2 fragMaterial;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float viewDepth = -(cluster.view * vec4(fragPosition, 1.0)).z;
+    vec3 radiance = ShadeClusteredLights(fragPosition, normalize(fragNormal), fragColor, fragMaterial.x, fragMaterial.y, gl_FragCoord.xy, viewDepth);
+    outColor = ToneMap(radiance);
+}
@@ -0,0 +1,89 @@
+/******************************************************************************
+* Metallic roughness PBR lit by the lights of a cluster, shared by the forward
+* & deferred fragment shaders. Include after clustered_lighting_common.glsl.
+******************************************************************************/
+layout(std430, set = 0, binding = 2) readonly buffer ClusterCountBuffer { uint clusterLightCounts[]; };
+layout(std430, set = 0, binding = 3) readonly buffer ClusterIndexBuffer { uint clusterLightIndices[]; };
+
+const float PI = 3.14159265359;
+const vec3 AMBIENT = vec3(0.03);
+
+float DistributionGGX(float NdotH, float alpha)
+{
+    float alphaSquared = alpha * alpha;
+    float denominator = NdotH * NdotH * (alphaSquared - 1.0) + 1.0;
+    return alphaSquared / (PI * denominator * denominator);
+}
+
+// Height correlated Smith, already divided by 4 * NdotL * NdotV.
+float VisibilitySmithGGX(float NdotV, float NdotL, float alpha)
+{
+    float alphaSquared = alpha * alpha;
+    float lambdaV = NdotL * sqrt(NdotV * NdotV * (1.0 - alphaSquared) + alphaSquared);
+    float lambdaL = NdotV * sqrt(NdotL * NdotL * (1.0 - alphaSquared) + alphaSquared);
+    return 0.5 / max(lambdaV + lambdaL, 1e-5);
+}
+
+vec3 FresnelSchlick(float VdotH, vec3 f0)
+{
+    return f0 + (1.0 - f0) * pow(1.0 - VdotH, 5.0);
+}
+
+// Inverse square falloff windowed to reach zero at the light's range.
+float DistanceAttenuation(float distanceSquared, float range)
+{
+    float ratio = distanceSquared / (range * range);
+    float window = clamp(1.0 - ratio * ratio, 0.0, 1.0);
+    return window * window / max(distanceSquared, 1e-4);
+}
+
+// Ambient plus every light of the cluster, N normalized, position in world space.
+vec3 ShadeClusteredLights(vec3 position, vec3 N, vec3 albedo, float metallic, float roughness, vec2 fragCoord, float viewDepth)
+{
+    float alpha = roughness * roughness;
+    vec3 f0 = mix(vec3(0.04), albedo, metallic);
+    vec3 diffuseColor = albedo * (1.0 - metallic);
+
+    vec3 V = normalize(cluster.cameraPosition.xyz - position);
+    float NdotV = max(dot(N, V), 1e-4);
+
+    uint clusterIndex = ClusterOf(fragCoord, viewDepth);
+    uint lightCount = clusterLightCounts[clusterIndex];
+    uint firstIndex = clusterIndex * CLUSTER_MAX_LIGHTS;
+
+    vec3 radiance = AMBIENT * albedo;
+    for (uint i = 0u; i < lightCount; ++i) {
+        ClusteredLight light = lights[clusterLightIndices[firstIndex + i]];
+        vec3 toLight = light.positionRange.xyz - position;
+        float distanceSquared = dot(toLight, toLight);
+        if (distanceSquared >= light.positionRange.w * light.positionRange.w) {
+            continue;
+        }
+
+        vec3 L = toLight * inversesqrt(max(distanceSquared, 1e-8));
+        float NdotL = dot(N, L);
+        if (NdotL <= 0.0) {
+            continue;
+        }
+
+        float attenuation = DistanceAttenuation(distanceSquared, light.positionRange.w);
+        if (uint(light.directionType.w) == LIGHT_TYPE_SPOT) {
+            attenuation *= smoothstep(light.spotCosines.x, light.spotCosines.y, dot(-L, light.directionType.xyz));
+        }
+
+        vec3 H = normalize(V + L);
+        float NdotH = max(dot(N, H), 0.0);
+        float VdotH = max(dot(V, H), 0.0);
+        vec3 F = FresnelSchlick(VdotH, f0);
+        vec3 specular = F * (DistributionGGX(NdotH, alpha) * VisibilitySmithGGX(NdotV, NdotL, alpha));
+        vec3 diffuse = (1.0 - F) * diffuseColor / PI;
+        radiance += (diffuse + specular) * light.colorIntensity.rgb * (light.colorIntensity.w * attenuation * NdotL);
+    }
+    return radiance;
+}
+
+// Reinhard, the sRGB target encodes the result.
+vec4 ToneMap(vec3 radiance)
+{
+    return vec4(radiance / (radiance + 1.0), 1.0);
+}
@@ -0,0 +1,41 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "clustered_lighting_common.glsl"
+#include "clustered_pbr_common.glsl"
+#include "gbuffer_common.glsl"
+
+
+/******************************************************************************
+* Fragment Shader, deferred lighting subpass, the G-buffer is read in place
+******************************************************************************/
+layout(input_attachment_index = 0, set = 1, binding = 0) uniform subpassInput gbufferAlbedoMetallic;
+layout(input_attachment_index = 1, set = 1, binding = 1) uniform subpassInput gbufferNormalRoughness;
+layout(input_attachment_index = 2, set = 1, binding = 2) uniform subpassInput gbufferDepth;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float depth = subpassLoad(gbufferDepth).r;
+    if (depth >= 1.0) {
+        // Nothing drawn, same as the forward pass' clear color.
+        outColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    vec4 albedoMetallic = subpassLoad(gbufferAlbedoMetallic);
+    vec4 normalRoughness = subpassLoad(gbufferNormalRoughness);
+
+    vec2 ndc = gl_FragCoord.xy / cluster.screenSize.xy * 2.0 - 1.0;
+    vec4 viewPosition = cluster.inverseProjection * vec4(ndc, depth, 1.0);
+    viewPosition /= viewPosition.w;
+    vec3 position = (cluster.inverseView * viewPosition).xyz;
+
+    vec3 radiance = ShadeClusteredLights(position, DecodeOctahedron(normalRoughness.xy), albedoMetallic.rgb, albedoMetallic.a, normalRoughness.z,
+        gl_FragCoord.xy, -viewPosition.z);
+    outColor = ToneMap(radiance);
+}
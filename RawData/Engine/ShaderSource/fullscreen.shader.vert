@@ -0,0 +1,14 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+
+/******************************************************************************
+* Vertex Shader, one triangle covering the viewport, draw 3 vertices
+******************************************************************************/
+void main() {
+    vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,25 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "gbuffer_common.glsl"
+
+
+/******************************************************************************
+* Fragment Shader, deferred geometry subpass
+******************************************************************************/
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec3 fragColor;
+layout(location = 2) in vec3 fragPosition;
+layout(location = 3) in vec2 fragMaterial;
+
+layout(location = 0) out vec4 outAlbedoMetallic;
+layout(location = 1) out vec4 outNormalRoughness;
+
+void main() {
+    outAlbedoMetallic = vec4(fragColor, fragMaterial.x);
+    outNormalRoughness = vec4(EncodeOctahedron(normalize(fragNormal)), fragMaterial.y, 0.0);
+}
@@ -0,0 +1,28 @@
+/******************************************************************************
+* Packed G-buffer, keep in sync with VulkanDeferredPass.cpp
+*
+*   0: R8G8B8A8_SRGB           rgb: albedo, a: metallic
+*   1: A2B10G10R10_UNORM       rg: octahedral normal, b: roughness
+*   2: depth
+******************************************************************************/
+vec2 OctahedronWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+// Unit vector to [0, 1]^2
+vec2 EncodeOctahedron(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 encoded = n.z >= 0.0 ? n.xy : OctahedronWrap(n.xy);
+    return encoded * 0.5 + 0.5;
+}
+
+vec3 DecodeOctahedron(vec2 encoded)
+{
+    encoded = encoded * 2.0 - 1.0;
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
@@ -0,0 +1,21 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "meshlet_common.glsl"
+
+
+/******************************************************************************
+* Vertex Shader, indirect draw path, instance index carries the meshlet index
+******************************************************************************/
+layout(location = 0) in vec3 inPosition;
+
+layout(location = 0) out vec3 fragColor;
+
+void main() {
+    gl_Position = params.viewProjection * vec4(inPosition, 1.0);
+    fragColor = MeshletColor(gl_InstanceIndex);
+}
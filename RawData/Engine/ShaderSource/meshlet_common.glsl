@@ -0,0 +1,70 @@
+/******************************************************************************
+* Meshlet shared definitions, keep in sync with Meshlet.h & VulkanMeshletCuller.h
+******************************************************************************/
+struct MeshletBounds
+{
+    vec4 sphereCenterRadius;    // xyz: center, w: radius
+    vec4 coneApex;              // xyz: apex
+    vec4 coneAxisCutoff;        // xyz: axis, w: sin(half angle), 1.0 means never backfacing
+};
+
+struct Meshlet
+{
+    uint vertexOffset;
+    uint triangleOffset;
+    uint vertexCount;
+    uint triangleCount;
+};
+
+struct DrawIndexedIndirectCommand
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int  vertexOffset;
+    uint firstInstance;
+};
+
+#define MESHLET_FLAG_COMPACT        0x1
+#define MESHLET_FLAG_FIRST_INSTANCE 0x2
+
+layout(std430, set = 0, binding = 0) readonly buffer MeshletBoundsBuffer { MeshletBounds bounds[]; };
+layout(std430, set = 0, binding = 1) readonly buffer MeshletBuffer { Meshlet meshlets[]; };
+
+layout(push_constant) uniform MeshletCullParams
+{
+    mat4 viewProjection;
+    vec4 cameraPosition;
+    uint meshletCount;
+    uint flags;
+} params;
+
+bool IsMeshletVisible(uint meshletIndex)
+{
+    MeshletBounds b = bounds[meshletIndex];
+
+    // Normal cone backface test
+    if (b.coneAxisCutoff.w < 1.0) {
+        vec3 view = b.coneApex.xyz - params.cameraPosition.xyz;
+        if (dot(view, b.coneAxisCutoff.xyz) >= b.coneAxisCutoff.w * length(view)) {
+            return false;
+        }
+    }
+
+    // Frustum planes extracted from the view projection rows, depth range [0, 1]
+    mat4 m = transpose(params.viewProjection);
+    vec4 planes[6] = vec4[](m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2]);
+    for (int i = 0; i < 6; ++i) {
+        vec4 plane = planes[i] / length(planes[i].xyz);
+        if (dot(plane.xyz, b.sphereCenterRadius.xyz) + plane.w < -b.sphereCenterRadius.w) {
+            return false;
+        }
+    }
+    return true;
+}
+
+vec3 MeshletColor(uint meshletIndex)
+{
+    uint hash = meshletIndex * 2654435761u;
+    return vec3(float(hash & 255u), float((hash >> 8) & 255u), float((hash >> 16) & 255u)) / 255.0;
+}
@@ -0,0 +1,32 @@
+/******************************************************************************
+* Two phase occlusion culling against a hierarchical depth pyramid. Each mip
+* of the pyramid keeps the farthest depth under its texel, a box nearer than
+* the farthest depth under its screen rectangle may be visible.
+******************************************************************************/
+// Levels of a pyramid at most 4096 texels on a side, HIZ_MAX_LEVELS of VulkanOcclusionCuller.cpp.
+#define HIZ_MAX_LEVELS 13
+// Source texels a pyramid group reduces per side, six levels into one texel.
+#define HIZ_TILE_SIZE 64
+#define HIZ_GROUP_SIZE 256
+#define OCCLUSION_GROUP_SIZE 64
+
+// World space axis aligned box of an instance.
+struct ObjectBounds {
+    vec4 center;
+    vec4 extent;             // Half size, w unused
+};
+
+struct DrawIndirectCommand {
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+};
+
+// Same layout as OcclusionCounters of VulkanOcclusionCuller.cpp, the draw & dispatch arguments are read from here.
+struct OcclusionCounters {
+    DrawIndirectCommand earlyDraw;   // Visible in the previous frame's pyramid
+    DrawIndirectCommand lateDraw;    // Occluded in it, visible in this frame's
+    uint retestCount;                // In the frustum but occluded in the previous frame's pyramid
+    uint lateDispatch[3];            // Groups of the retest list
+};
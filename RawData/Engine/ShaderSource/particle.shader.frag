@@ -0,0 +1,22 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+
+/******************************************************************************
+* Fragment Shader, a soft disc
+******************************************************************************/
+layout(location = 0) in vec2 fragCorner;
+layout(location = 1) in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float radius2 = dot(fragCorner, fragCorner);
+    if (radius2 > 1.0) {
+        discard;
+    }
+    outColor = vec4(fragColor.rgb, fragColor.a * (1.0 - radius2));
+}
@@ -0,0 +1,42 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "particle_common.glsl"
+
+// Set when the pipeline is built, world size of a particle at emission.
+layout(constant_id = 0) const float PARTICLE_SIZE = 0.05;
+
+
+/******************************************************************************
+* Vertex Shader, a camera facing quad per particle in sort order
+******************************************************************************/
+layout(location = 0) out vec2 fragCorner;
+layout(location = 1) out vec4 fragColor;
+
+const vec2 QUAD_CORNERS[6] = vec2[](
+    vec2(-1.0,-1.0), vec2( 1.0,-1.0), vec2( 1.0, 1.0),
+    vec2(-1.0,-1.0), vec2( 1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main() {
+    Particle particle = particleStates[sortEntries[gl_InstanceIndex].y];
+    vec3 position = particle.positionAge.xyz;
+    float life = clamp(particle.positionAge.w / particle.velocityLifetime.w, 0.0, 1.0);
+
+    vec3 toCamera = particles.cameraPosition.xyz - position;
+    toCamera = (dot(toCamera, toCamera) > 1e-8) ? normalize(toCamera) : vec3(0.0, 0.0, 1.0);
+    vec3 right = cross(vec3(0.0, 1.0, 0.0), toCamera);
+    right = (dot(right, right) > 1e-8) ? normalize(right) : vec3(1.0, 0.0, 0.0);
+    vec3 up = cross(toCamera, right);
+
+    vec2 corner = QUAD_CORNERS[gl_VertexIndex];
+    float size = PARTICLE_SIZE * (1.0 - 0.5 * life);
+    gl_Position = particles.viewProjection * vec4(position + (right * corner.x + up * corner.y) * size, 1.0);
+    fragCorner = corner;
+    // Hot at emission, cooling & fading out over the lifetime.
+    fragColor = vec4(mix(vec3(1.0, 0.75, 0.3), vec3(0.3, 0.45, 1.0), life), 1.0 - life);
+}
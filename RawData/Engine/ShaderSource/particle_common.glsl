@@ -0,0 +1,44 @@
+/******************************************************************************
+* GPU particles, simulated, compacted & sorted in compute & drawn indirectly.
+* Every particle lives in a fixed pool, indices move between a dead list & two
+* alive lists swapped each frame, the host never sees a particle.
+******************************************************************************/
+struct Particle {
+    vec4 positionAge;        // xyz: world position, w: seconds since emission
+    vec4 velocityLifetime;   // xyz: world velocity, w: seconds it lives
+};
+
+// Same layout as ParticleCounters of VulkanParticleSystem.cpp, the indirect arguments are read from here.
+layout(std430, set = 0, binding = 0) buffer ParticleCounterBuffer {
+    uint aliveCount[2];      // Of each alive list
+    uint deadCount;
+    uint emitCount;          // This frame's, at most the dead count
+    uint emitDispatch[3];
+    uint simulateDispatch[3];
+    uint sortDispatch[3];    // Blocks of the alive count padded to a power of two
+    uint sortCount;          // Alive entries, the padding sorts after them
+    uint draw[4];            // VkDrawIndirectCommand, 6 vertices per alive particle
+} counters;
+
+layout(std430, set = 0, binding = 1) buffer ParticleBuffer { Particle particleStates[]; };
+layout(std430, set = 0, binding = 2) buffer DeadBuffer { uint deadList[]; };
+// Both alive lists, the second one starts at the capacity.
+layout(std430, set = 0, binding = 3) buffer AliveBuffer { uint aliveLists[]; };
+// x: sort key, y: particle index, in draw order once sorted.
+layout(std430, set = 0, binding = 4) buffer SortBuffer { uvec2 sortEntries[]; };
+
+// Written each frame into the frame ring, the sort pushes its own constants.
+#if !defined(PARTICLE_SORT_SHADER)
+layout(std140, set = 0, binding = 5) uniform ParticleConstants {
+    mat4 viewProjection;
+    vec4 cameraPosition;     // xyz: world, w: delta time in seconds
+    vec4 emitter;            // xyz: world position, w: radius of the emission sphere
+    vec4 emitterVelocity;    // xyz: mean initial velocity, w: random velocity added in any direction
+    uvec4 frame;             // x: particles to emit, y: emission seed, z: alive list read this frame
+} particles;
+#endif
+
+// Entries past the alive count, larger than any particle's key.
+#define PARTICLE_SORT_PADDING uvec2(0xffffffffu, 0xffffffffu)
+// Elements sorted in shared memory by a group of half as many invocations.
+#define PARTICLE_SORT_BLOCK 512
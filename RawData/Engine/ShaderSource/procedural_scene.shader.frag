@@ -0,0 +1,22 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "procedural_scene_common.glsl"
+
+
+/******************************************************************************
+* Fragment Shader
+******************************************************************************/
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec3 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float diffuse = max(dot(normalize(fragNormal), LIGHT_DIRECTION), 0.0);
+    outColor = vec4(fragColor * (0.25 + 0.75 * diffuse), 1.0);
+}
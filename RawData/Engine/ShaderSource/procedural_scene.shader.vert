@@ -0,0 +1,106 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "procedural_scene_common.glsl"
+
+
+/******************************************************************************
+* Vertex Shader, 36 vertices per cube, one instance per cube
+******************************************************************************/
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec3 fragColor;
+layout(location = 2) out vec3 fragPosition;    // World space, for the clustered PBR shading
+layout(location = 3) out vec2 fragMaterial;    // x: metallic, y: roughness
+layout(location = 4) out vec2 fragUV;          // Per face, for the virtual textured scene
+layout(location = 5) flat out uint fragInstance;
+
+#if defined(INSTANCE_LIST)
+// Per instance attribute, the culled draws only get the survivors' indices.
+layout(location = 0) in uint instanceIndex;
+#elif defined(BATCHED)
+// Corners of the registered cube meshes, w: face * 4 + corner of the face's quad, each draw's instances from the batcher's buffer, params.x the cube's index.
+layout(location = 0) in vec4 inCorner;
+
+struct DrawInstanceData {
+    mat4 transform;
+    vec4 params;
+};
+layout(std430, set = 1, binding = 0) readonly buffer DrawInstances {
+    DrawInstanceData instances[];
+};
+#endif
+
+// Per face normal & tangent frame, tangent x bitangent == normal keeps faces counter clockwise from outside.
+const vec3 FACE_NORMALS[6] = vec3[](
+    vec3( 1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+    vec3( 0.0, 1.0, 0.0), vec3( 0.0,-1.0, 0.0),
+    vec3( 0.0, 0.0, 1.0), vec3( 0.0, 0.0,-1.0)
+);
+const vec3 FACE_TANGENTS[6] = vec3[](
+    vec3(0.0, 1.0, 0.0), vec3(0.0, 0.0, 1.0),
+    vec3(0.0, 0.0, 1.0), vec3(1.0, 0.0, 0.0),
+    vec3(1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0)
+);
+const vec3 FACE_BITANGENTS[6] = vec3[](
+    vec3(0.0, 0.0, 1.0), vec3(0.0, 1.0, 0.0),
+    vec3(1.0, 0.0, 0.0), vec3(0.0, 0.0, 1.0),
+    vec3(0.0, 1.0, 0.0), vec3(1.0, 0.0, 0.0)
+);
+const vec2 FACE_CORNERS[6] = vec2[](
+    vec2(-1.0,-1.0), vec2( 1.0,-1.0), vec2( 1.0, 1.0),
+    vec2(-1.0,-1.0), vec2( 1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+// Of FACE_CORNERS, the quad's corners in order.
+const int QUAD_CORNERS[4] = int[](0, 1, 2, 5);
+
+uint Hash(uint value) {
+    value ^= value >> 16;
+    value *= 0x7feb352du;
+    value ^= value >> 15;
+    value *= 0x846ca68bu;
+    value ^= value >> 16;
+    return value;
+}
+
+void main() {
+#if defined(BATCHED)
+    // Same corners as the generated cubes, from the mesh of the cube's height, placed by its transform.
+    DrawInstanceData data = instances[gl_InstanceIndex];
+    int face = int(inCorner.w) / 4;
+    vec2 corner = FACE_CORNERS[QUAD_CORNERS[int(inCorner.w) % 4]];
+    vec3 normal = FACE_NORMALS[face];
+    uint instance = uint(data.params.x);
+    uint hash = Hash(instance);
+    vec3 position = (data.transform * vec4(inCorner.xyz, 1.0)).xyz;
+#else
+    int face = gl_VertexIndex / 6;
+    vec2 corner = FACE_CORNERS[gl_VertexIndex % 6];
+    vec3 normal = FACE_NORMALS[face];
+    vec3 local = normal + FACE_TANGENTS[face] * corner.x + FACE_BITANGENTS[face] * corner.y;
+
+    uint perRow = max(uint(scene.grid.x), 1u);
+#if defined(INSTANCE_LIST)
+    uint instance = instanceIndex;
+#else
+    uint instance = uint(gl_InstanceIndex);
+#endif
+    uint hash = Hash(instance);
+    vec2 cell = vec2(instance % perRow, instance / perRow) - vec2(float(perRow - 1u) * 0.5);
+    float height = 1.0 + float(hash & 3u);
+    vec3 center = vec3(cell.x * scene.grid.y, 0.0, cell.y * scene.grid.y);
+    vec3 position = center + local * vec3(0.5, 0.5 * height, 0.5) * scene.grid.z + vec3(0.0, 0.5 * height * scene.grid.z, 0.0);
+#endif
+
+    gl_Position = scene.viewProjection * vec4(position, 1.0);
+    fragNormal = normal;
+    fragColor = vec3(float((hash >> 8) & 255u), float((hash >> 16) & 255u), float((hash >> 24) & 255u)) / 255.0 * 0.7 + 0.3;
+    fragPosition = position;
+    fragMaterial = vec2((hash & 4u) != 0u ? 1.0 : 0.0, 0.2 + 0.7 * float((hash >> 3) & 31u) / 31.0);
+    fragUV = corner * 0.5 + 0.5;
+    fragInstance = instance;
+}
@@ -0,0 +1,10 @@
+/******************************************************************************
+* Procedural scene shared by the headless renderer & benchmarks: a square grid
+* of cubes generated from gl_VertexIndex & gl_InstanceIndex, no vertex buffers.
+******************************************************************************/
+layout(push_constant) uniform ProceduralSceneConstants {
+    mat4 viewProjection;
+    vec4 grid;              // x: cubes per row, y: spacing, z: cube size
+} scene;
+
+const vec3 LIGHT_DIRECTION = vec3(0.408, 0.816, 0.408);
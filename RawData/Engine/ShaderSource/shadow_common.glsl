@@ -0,0 +1,44 @@
+/******************************************************************************
+* Cascaded shadow maps of the directional light, keep in sync with
+* VulkanCascadedShadows.h & VulkanCascadedShadows.cpp
+******************************************************************************/
+#define SHADOW_CASCADE_COUNT    4
+
+layout(std140, set = 0, binding = 0) uniform CascadedShadowParams
+{
+    mat4 lightViewProjection[SHADOW_CASCADE_COUNT];
+    mat4 view;
+    vec4 splitDepths;       // Far view depth of each cascade
+    vec4 texelSizes;        // World size of a shadow texel in each cascade
+    vec4 lightDirection;    // xyz: towards the light
+} shadow;
+
+layout(set = 0, binding = 1) uniform sampler2DArrayShadow shadowMap;
+
+// 1 lit, 0 shadowed, position & normal in world space.
+float CascadedShadow(vec3 position, vec3 normal)
+{
+    float viewDepth = -(shadow.view * vec4(position, 1.0)).z;
+    int cascade = 0;
+    for (int i = 0; i < SHADOW_CASCADE_COUNT - 1; i++) {
+        cascade += (viewDepth > shadow.splitDepths[i]) ? 1 : 0;
+    }
+    if (viewDepth > shadow.splitDepths[SHADOW_CASCADE_COUNT - 1]) {
+        return 1.0;
+    }
+
+    // Normal offset by about a texel, grazing surfaces need it the most.
+    float grazing = 1.0 - max(dot(normal, shadow.lightDirection.xyz), 0.0);
+    vec3 biased = position + normal * shadow.texelSizes[cascade] * (0.5 + 1.5 * grazing);
+    vec4 coord = shadow.lightViewProjection[cascade] * vec4(biased, 1.0);
+    vec2 uv = coord.xy * 0.5 + 0.5;
+
+    // 4 taps of the filtered compare, about a 3x3 texel PCF.
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    lit += texture(shadowMap, vec4(uv + vec2(-0.5, -0.5) * texel, float(cascade), coord.z));
+    lit += texture(shadowMap, vec4(uv + vec2( 0.5, -0.5) * texel, float(cascade), coord.z));
+    lit += texture(shadowMap, vec4(uv + vec2(-0.5,  0.5) * texel, float(cascade), coord.z));
+    lit += texture(shadowMap, vec4(uv + vec2( 0.5,  0.5) * texel, float(cascade), coord.z));
+    return lit * 0.25;
+}
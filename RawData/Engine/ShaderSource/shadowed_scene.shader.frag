@@ -0,0 +1,28 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "procedural_scene_common.glsl"
+#include "shadow_common.glsl"
+
+
+/******************************************************************************
+* Fragment Shader, procedural_scene.shader.frag with cascaded shadows
+******************************************************************************/
+layout(location = 0) in vec3 fragNormal;
+layout(location = 1) in vec3 fragColor;
+layout(location = 2) in vec3 fragPosition;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec3 N = normalize(fragNormal);
+    float diffuse = max(dot(N, shadow.lightDirection.xyz), 0.0);
+    if (diffuse > 0.0) {
+        diffuse *= CascadedShadow(fragPosition, N);
+    }
+    outColor = vec4(fragColor * (0.25 + 0.75 * diffuse), 1.0);
+}
@@ -0,0 +1,46 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "skinning_common.glsl"
+
+layout(std430, set = 0, binding = 0) readonly buffer SkinnedVertexBuffer { SkinnedVertex skinnedVertices[]; };
+
+layout(push_constant) uniform SkinnedDrawConstants {
+    mat4 viewProjection;
+    uvec4 mesh;              // x: vertices per instance
+} draw;
+
+
+/******************************************************************************
+* Vertex Shader, the rest pose's indices, one instance per character, feeds
+* the same varyings as procedural_scene.shader.vert
+******************************************************************************/
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec3 fragColor;
+layout(location = 2) out vec3 fragPosition;
+layout(location = 3) out vec2 fragMaterial;
+
+uint Hash(uint value) {
+    value ^= value >> 16;
+    value *= 0x7feb352du;
+    value ^= value >> 15;
+    value *= 0x846ca68bu;
+    value ^= value >> 16;
+    return value;
+}
+
+void main() {
+    uint instance = uint(gl_InstanceIndex);
+    SkinnedVertex vertex = skinnedVertices[instance * draw.mesh.x + uint(gl_VertexIndex)];
+    uint hash = Hash(instance ^ 0x5bd1e995u);
+
+    gl_Position = draw.viewProjection * vertex.position;
+    fragNormal = vertex.normal.xyz;
+    fragColor = vec3(float((hash >> 8) & 255u), float((hash >> 16) & 255u), float((hash >> 24) & 255u)) / 255.0 * 0.5 + 0.5;
+    fragPosition = vertex.position.xyz;
+    fragMaterial = vec2(0.0, 0.6);
+}
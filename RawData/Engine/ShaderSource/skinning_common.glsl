@@ -0,0 +1,24 @@
+/******************************************************************************
+* GPU skinning, a compute pre-pass skins every instance's vertices once per
+* frame into a buffer the shadow & scene passes then draw from.
+******************************************************************************/
+// Rest pose, same layout as SkinnedMeshVertex of Animation.h.
+struct RestVertex {
+    vec3 position;
+    uint joints;             // Four 8 bit joint indices
+    vec3 normal;
+    uint weights;            // Four 8 bit unorm weights
+};
+
+// World space, instance after instance.
+struct SkinnedVertex {
+    vec4 position;           // w: 1
+    vec4 normal;             // w: unused
+};
+
+// Rows of an affine matrix, same layout as JointMatrix of Animation.h.
+struct JointMatrix {
+    vec4 rows[3];
+};
+
+#define SKINNING_GROUP_SIZE 64
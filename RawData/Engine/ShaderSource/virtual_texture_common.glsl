@@ -0,0 +1,63 @@
+/******************************************************************************
+* Virtual texturing of a texture set laid out as a grid in one virtual texture.
+* A page table mip per texture mip holds, per page, where the finest resident
+* page covering it sits in the physical cache: xy its slot, z its mip, w its
+* resident flag. Pages keep a border of their neighbours' texels, so bilinear
+* filtering within a page never reads another slot.
+******************************************************************************/
+// Same layout as VirtualTextureParams of VulkanVirtualTexture.cpp.
+layout(set = 0, binding = 0) uniform VirtualTextureParams {
+    vec4 pages;             // xy: pages a side of mip 0, z: mips, w: lod bias of the feedback pass
+    vec4 cache;             // xy: 1 / cache texels, z: page payload, w: page border
+    uvec4 textureSet;       // x: textures a row, y: textures, z: texels a side of a texture, w: texels a side of a page
+} virtualTexture;
+layout(set = 0, binding = 1) uniform usampler2D pageTable;
+layout(set = 0, binding = 2) uniform sampler2D pageCache;
+
+// Mip 0 texel of the virtual texture the instance's texture covers at uv, half a texel in from its edges.
+vec2 VirtualTexel(uint instance, vec2 uv) {
+    uint index = instance % virtualTexture.textureSet.y;
+    float size = float(virtualTexture.textureSet.z);
+    vec2 origin = vec2(float(index % virtualTexture.textureSet.x), float(index / virtualTexture.textureSet.x)) * size;
+    return origin + clamp(uv * size, vec2(0.5), vec2(size - 0.5));
+}
+
+// Mip the sampler would pick, from the texel footprint of the pixel.
+float VirtualLod(vec2 texel) {
+    vec2 dx = dFdx(texel);
+    vec2 dy = dFdy(texel);
+    return 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8));
+}
+
+uint VirtualMip(float lod) {
+    return uint(clamp(floor(lod), 0.0, virtualTexture.pages.z - 1.0));
+}
+
+uvec2 VirtualPageOf(vec2 texel, uint mip) {
+    uint pagesPerSide = max(uint(virtualTexture.pages.x) >> mip, 1u);
+    uvec2 page = uvec2(texel / (virtualTexture.cache.z * exp2(float(mip))));
+    return min(page, uvec2(pagesPerSide - 1u));
+}
+
+// Pages are numbered over all mips, mip 0 first, as GetVirtualTexturePageIndex() does.
+uint VirtualPageIndex(uint mip, uvec2 page) {
+    uint first = 0u;
+    for (uint level = 0u; level < mip; level++) {
+        uint pagesPerSide = max(uint(virtualTexture.pages.x) >> level, 1u);
+        first += pagesPerSide * pagesPerSide;
+    }
+    return first + page.y * max(uint(virtualTexture.pages.x) >> mip, 1u) + page.x;
+}
+
+// Filtered within the finest resident page, mid grey before the coarsest mip arrived.
+vec3 SampleVirtual(vec2 texel, float lod) {
+    uint mip = VirtualMip(lod);
+    uvec4 entry = texelFetch(pageTable, ivec2(VirtualPageOf(texel, mip)), int(mip));
+    if (0u == entry.a) {
+        return vec3(0.5);
+    }
+    float pageTexels = virtualTexture.cache.z * exp2(float(entry.b));
+    vec2 inPage = fract(texel / pageTexels) * virtualTexture.cache.z;
+    vec2 cacheTexel = vec2(entry.rg) * float(virtualTexture.textureSet.w) + virtualTexture.cache.w + inPage;
+    return textureLod(pageCache, cacheTexel * virtualTexture.cache.xy, 0.0).rgb;
+}
@@ -0,0 +1,25 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "procedural_scene_common.glsl"
+#include "virtual_texture_common.glsl"
+
+
+/******************************************************************************
+* Fragment Shader, the page the pixel samples in the full size view. The pass
+* is smaller by the feedback divisor, its lod bias makes up for it.
+******************************************************************************/
+layout(location = 4) in vec2 fragUV;
+layout(location = 5) flat in uint fragInstance;
+
+layout(location = 0) out uint outPage;
+
+void main() {
+    vec2 texel = VirtualTexel(fragInstance, fragUV);
+    uint mip = VirtualMip(VirtualLod(texel) + virtualTexture.pages.w);
+    outPage = VirtualPageIndex(mip, VirtualPageOf(texel, mip));
+}
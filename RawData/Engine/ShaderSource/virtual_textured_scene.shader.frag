@@ -0,0 +1,26 @@
+/******************************************************************************
+* Common Description
+******************************************************************************/
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : enable
+
+#include "procedural_scene_common.glsl"
+#include "virtual_texture_common.glsl"
+
+
+/******************************************************************************
+* Fragment Shader, every cube face shows its instance's texture of the set
+******************************************************************************/
+layout(location = 0) in vec3 fragNormal;
+layout(location = 4) in vec2 fragUV;
+layout(location = 5) flat in uint fragInstance;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec2 texel = VirtualTexel(fragInstance, fragUV);
+    vec3 albedo = SampleVirtual(texel, VirtualLod(texel));
+    float diffuse = max(dot(normalize(fragNormal), LIGHT_DIRECTION), 0.0);
+    outColor = vec4(albedo * (0.25 + 0.75 * diffuse), 1.0);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+
+#include "CrossPlatform.h"
+#include "Platform.h"
+#include "StandardC.h"
+#include "StandardCXX.h"
+#include "Memory.h"
+#include "Profiler.h"
+
+
+#define VK_USE_PLATFORM_WIN32_KHR
+#include <vulkan/vulkan.h>
+
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <vec3.hpp>
+#include <vec4.hpp>
+#include <mat4x4.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <map>
+#include <functional>
+#include <deque>
+#include <fstream>
+#include <filesystem>
@@ -0,0 +1,866 @@
+#include <cstdint> // Necessary for UINT32_MAX
+#include "FrameAllocator.h"
+#include "ImageEncoder.h"
+#include "VulkanUtility.h"
+#include "VulkanSceneAttachments.h"
+#include "VulkanClusteredLighting.h"
+#include "VulkanHeadlessDevice.h"
+#include "VulkanPostProcess.h"
+#include "VulkanSkinning.h"
+#include "StreamingIO.h"
+#include "VirtualTexture.h"
+#include "VulkanVirtualTexture.h"
+#include "VulkanOffscreenRenderer.h"
+#include "ImageCompare.h"
+#include "BenchmarkScenes.h"
+#include "QueueBenchmark.h"
+#include "ProfilerBenchmark.h"
+#include "EngineChecks.h"
+#include "BenchmarkRunner.h"
+
+
+__BEGIN_NAMESPACE
+
+
+#if PROFILER_ENABLED
+static const size_t PROFILE_EVENTS_PER_THREAD = 256 * 1024;
+#endif
+// Same as the player's, larger scenes grow it during their warm up.
+static const size_t FRAME_ARENA_BYTES_PER_THREAD = 1024 * 1024;
+// Texels a side of each texture of the virtual texture scenes, a page's payload.
+static const uint32_t VIRTUAL_TEXTURE_SCENE_TEXTURE_SIZE = VIRTUAL_TEXTURE_PAGE_PAYLOAD;
+// Warm up frames of a virtual texture scene waiting for its streaming to settle, at most.
+static const uint32_t VIRTUAL_TEXTURE_MAX_SETTLE_FRAMES = 600;
+// By OffscreenPostProcess.
+static const char* POST_PROCESS_NAMES[] = { "none", "fused", "unfused" };
+
+
+// User & kernel time of every thread in the process.
+static double GetProcessCpuSeconds()
+{
+#if( PLATFORM == PLATFORM_WINDOWS )
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+        uint64_t kernel = ((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+        uint64_t user = ((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+        return (double)(kernel + user) * 1e-7;     // 100 ns units
+    }
+    return 0.0;
+#else
+    return (double)std::clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Sums over every memory tag.
+static void GetTotalMemoryStatistics(MemoryTagStatistics& total)
+{
+    memset(&total, 0, sizeof(total));
+    for (uint8_t tag = 0; tag < (uint8_t)MemoryTag::Count; tag++) {
+        MemoryTagStatistics statistics;
+        GetMemoryStatistics((MemoryTag)tag, statistics);
+        total.m_CurrentBytes += statistics.m_CurrentBytes;
+        total.m_PeakBytes += statistics.m_PeakBytes;
+        total.m_CurrentAllocations += statistics.m_CurrentAllocations;
+        total.m_TotalAllocations += statistics.m_TotalAllocations;
+    }
+}
+
+static BenchmarkTimingSummary Summarize(std::vector<double> samples)
+{
+    BenchmarkTimingSummary summary;
+    if (samples.empty()) {
+        return summary;
+    }
+    std::sort(samples.begin(), samples.end());
+    double sum = 0.0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    summary.m_Mean = sum / samples.size();
+    summary.m_Median = samples[samples.size() / 2];
+    summary.m_P95 = samples[std::min(samples.size() - 1, (size_t)ceil(samples.size() * 0.95) - 1)];
+    summary.m_Min = samples.front();
+    summary.m_Max = samples.back();
+    return summary;
+}
+
+static std::string JsonString(const std::string& text)
+{
+    std::string escaped = "\"";
+    for (char c : text) {
+        if ('"' == c || '\\' == c) {
+            escaped += '\\';
+            escaped += c;
+        } else if ((unsigned char)c < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            escaped += code;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped + "\"";
+}
+
+static bool WriteFile(const std::string& path, const std::vector<uint8_t>& data)
+{
+    std::ofstream file(path, std::ios::binary);
+    return (bool)file.write((const char*)data.data(), data.size());
+}
+
+// Values of the metrics a baseline may name, by their path in the scene's JSON results.
+static bool GetBaselineMetric(const BenchmarkSceneResult& result, const std::string& metric, double& value)
+{
+    if ("phase_ms.gpu" == metric) {
+        value = result.m_GpuMs;
+    } else if ("attachment_bytes.memory" == metric) {
+        value = (double)result.m_AttachmentMemoryBytes;
+    } else if ("shadow_ms.gpu" == metric) {
+        value = result.m_ShadowGpuMs;
+    } else if ("post_ms.gpu" == metric) {
+        value = result.m_PostGpuMs;
+    } else if ("temporal.resolve_gpu_ms" == metric) {
+        value = result.m_TemporalGpuMs;
+    } else if ("particles.gpu_ms" == metric) {
+        value = result.m_ParticleGpuMs;
+    } else if ("skinning.gpu_ms" == metric) {
+        value = result.m_SkinningGpuMs;
+    } else if ("skinning.animation_cpu_ms" == metric) {
+        value = result.m_SkinningCpuMs;
+    } else if ("occlusion.cull_gpu_ms" == metric) {
+        value = result.m_OcclusionCullGpuMs;
+    } else if ("virtual_texture.pages_uploaded_per_frame" == metric) {
+        value = result.m_VirtualPagesUploaded;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+
+BenchmarkRunner::BenchmarkRunner() :
+	m_HeadlessDevice(nullptr)
+{
+}
+
+BenchmarkRunner::~BenchmarkRunner()
+{
+}
+
+bool BenchmarkRunner::Run(int argc, char** argv)
+{
+    if (!Initial(argc, argv)) {
+        return false;
+    }
+
+    bool succeeded = StartUp();
+    if (succeeded) {
+        succeeded = MainLoop();
+    }
+
+    ShutDown();
+    CleanUp();
+    return succeeded;
+}
+
+bool BenchmarkRunner::Initial(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if ("--update-goldens" == argument) {
+            m_Settings.m_UpdateGoldens = true;
+            continue;
+        }
+        if (nullptr == value) {
+            std::cout << "Missing value after " << argument << ".\n";
+            return false;
+        }
+        i++;
+        if ("--goldens" == argument) {
+            m_Settings.m_GoldenDirectory = value;
+        } else if ("--output" == argument) {
+            m_Settings.m_OutputPath = value;
+        } else if ("--scene" == argument) {
+            m_Settings.m_SceneFilter = value;
+        } else if ("--label" == argument) {
+            m_Settings.m_Label = value;
+        } else if ("--device" == argument) {
+            m_Settings.m_DeviceName = value;
+        } else if ("--frames" == argument) {
+            m_Settings.m_Frames = std::max(1, atoi(value));
+        } else if ("--warmup" == argument) {
+            m_Settings.m_WarmUpFrames = std::max(0, atoi(value));
+        } else if ("--queue-items" == argument) {
+            m_Settings.m_QueueItems = strtoull(value, nullptr, 10);
+        } else if ("--profiler-zones" == argument) {
+            m_Settings.m_ProfilerZones = strtoull(value, nullptr, 10);
+        } else if ("--threshold" == argument) {
+            m_Settings.m_Compare.m_Threshold = atof(value);
+        } else if ("--max-diff" == argument) {
+            m_Settings.m_Compare.m_MaxDifferentFraction = atof(value);
+        } else if ("--max-regression" == argument) {
+            m_Settings.m_MaxRegression = atof(value);
+        } else {
+            std::cout << "Unknown argument " << argument << ".\n"
+                "Usage: Benchmark [--goldens DIR] [--update-goldens] [--output FILE] [--scene NAME] [--label TEXT] [--device NAME]\n"
+                "                 [--frames N] [--warmup N] [--queue-items N] [--profiler-zones N] [--threshold T] [--max-diff FRACTION]\n"
+                "                 [--max-regression FRACTION]\n";
+            return false;
+        }
+    }
+
+#if PROFILER_ENABLED
+    Profiler::Initial(PROFILE_EVENTS_PER_THREAD);
+#endif
+    PROFILE_THREAD_NAME("Main");
+    FrameArena::Initial(FRAME_ARENA_BYTES_PER_THREAD);
+    return true;
+}
+
+bool BenchmarkRunner::MatchesFilter(const std::string& name) const
+{
+    return m_Settings.m_SceneFilter.empty() || std::string::npos != name.find(m_Settings.m_SceneFilter);
+}
+
+bool BenchmarkRunner::StartUp()
+{
+    // The queue cases alone run without a GPU.
+    size_t sceneCount = 0;
+    const BenchmarkScene* scenes = GetBenchmarkScenes(sceneCount);
+    bool renderScenes = false;
+    for (size_t i = 0; i < sceneCount; i++) {
+        renderScenes |= MatchesFilter(scenes[i].m_Name);
+    }
+    if (!renderScenes) {
+        return true;
+    }
+
+    HeadlessDeviceSettings deviceSettings;
+    deviceSettings.m_DeviceName = m_Settings.m_DeviceName;
+    deviceSettings.m_MaxQueues = 1;
+
+    m_HeadlessDevice = New<VulkanHeadlessDevice>(MemoryTag::GraphicDriver);
+    return m_HeadlessDevice->Create(deviceSettings);
+}
+
+VulkanOffscreenRenderer* BenchmarkRunner::GetRenderer(uint32_t samples)
+{
+    auto found = m_Renderers.find(samples);
+    if (found != m_Renderers.end()) {
+        return found->second;
+    }
+
+    SceneAttachmentSettings attachmentSettings;
+    attachmentSettings.m_Samples = samples;
+    attachmentSettings.m_Depth = true;
+
+    VulkanOffscreenRenderer* renderer = New<VulkanOffscreenRenderer>(MemoryTag::GraphicDriver);
+    m_Renderers[samples] = renderer;
+    if (!renderer->Create(m_HeadlessDevice, 0, attachmentSettings)) {
+        return nullptr;
+    }
+    return renderer;
+}
+
+bool BenchmarkRunner::MainLoop()
+{
+    size_t sceneCount = 0;
+    const BenchmarkScene* scenes = GetBenchmarkScenes(sceneCount);
+
+    bool passed = true;
+    LoadBaselines();
+    for (size_t i = 0; i < sceneCount; i++) {
+        const BenchmarkScene& scene = scenes[i];
+        if (!MatchesFilter(scene.m_Name)) {
+            continue;
+        }
+
+        BenchmarkSceneResult result;
+        result.m_Scene = &scene;
+        RunScene(scene, result);
+        passed &= ("pass" == result.m_ImageStatus || "updated" == result.m_ImageStatus);
+        CheckBaselines(scene, result);
+
+        std::cout << scene.m_Name << ": " << result.m_FrameMs.m_Median << " ms median, " << result.m_FrameMs.m_P95 << " ms p95, "
+            << result.m_CpuMsPerFrame << " CPU ms/frame, " << result.m_AllocationsPerFrame << " allocations/frame, "
+            << result.m_AttachmentMemoryBytes / (1024.0 * 1024.0) << " MiB attachment traffic/frame, image " << result.m_ImageStatus << "\n";
+        if (scene.m_TemporalScale > 0.0f) {
+            const BenchmarkSceneResult* native = FindNativeResult(result);
+            std::cout << scene.m_Name << ": " << result.m_TemporalGpuMs << " ms temporal resolve";
+            if (nullptr != native) {
+                std::cout << ", " << native->m_GpuMs - result.m_GpuMs << " GPU ms saved against " << native->m_Scene->m_Name;
+            }
+            std::cout << "\n";
+        }
+        if (scene.m_ParticleCapacity > 0) {
+            std::cout << scene.m_Name << ": " << result.m_ParticleGpuMs << " ms particle simulation & sort\n";
+        }
+        if (scene.m_SkinnedInstances > 0) {
+            std::cout << scene.m_Name << ": " << result.m_SkinningCpuMs << " ms animation on " << result.m_AnimationThreads << " threads, "
+                << result.m_SkinningGpuMs << " ms skinning\n";
+        }
+        if (scene.m_OcclusionCulling) {
+            std::cout << scene.m_Name << ": " << result.m_OcclusionEarlyDrawn << " early & " << result.m_OcclusionLateDrawn << " late of "
+                << scene.m_InstanceCount << " cubes drawn, " << result.m_OcclusionCullGpuMs << " ms culling, " << result.m_OcclusionPyramidGpuMs << " ms pyramid\n";
+        }
+        if (scene.m_VirtualTextureSlots > 0) {
+            std::cout << scene.m_Name << ": " << result.m_VirtualPagesResident << " pages resident after " << result.m_VirtualSettleFrames << " frames, "
+                << result.m_VirtualMemoryBytes / (1024.0 * 1024.0) << " of " << result.m_VirtualSetBytes / (1024.0 * 1024.0) << " MiB"
+                << (result.m_VirtualSparse ? " sparse" : "") << ", " << result.m_VirtualPagesUploaded << " uploads/frame\n";
+        }
+        if (scene.m_Meshlets) {
+            std::cout << scene.m_Name << ": " << result.m_MeshletVisibleTriangles << " of " << result.m_MeshletTriangles << " triangles in "
+                << result.m_MeshletVisibleCount << " of " << result.m_MeshletCount << " meshlets drawn, "
+                << (result.m_MeshletTriangles > 0 ? 100.0 * (1.0 - result.m_MeshletVisibleTriangles / result.m_MeshletTriangles) : 0.0) << "% culled\n";
+        }
+        if (scene.m_Batched) {
+            std::cout << scene.m_Name << ": " << result.m_BatchedObjects << " objects in " << result.m_BatchedDrawCalls << " draws, "
+                << result.m_BatchedPipelineBinds << " pipeline binds, " << result.m_BatchedCpuMs << " ms batching\n";
+        }
+        for (const BenchmarkBaselineResult& baseline : result.m_Baselines) {
+            passed &= !baseline.m_Missing;
+            if (baseline.m_Missing) {
+                std::cout << scene.m_Name << ": no recorded " << baseline.m_Metric << ", run with --update-goldens to record it.\n";
+                continue;
+            }
+            std::cout << scene.m_Name << ": " << baseline.m_Metric << " " << baseline.m_Value << " against " << baseline.m_Recorded << " recorded, "
+                << (baseline.m_Change >= 0.0 ? "+" : "") << 100.0 * baseline.m_Change << "%" << (baseline.m_Regressed ? ", regressed" : "") << "\n";
+        }
+        m_Results.push_back(result);
+    }
+    if (m_Settings.m_UpdateGoldens && !SaveBaselines()) {
+        std::cout << "Failed to write the baselines to " << m_Settings.m_GoldenDirectory << ".\n";
+        passed = false;
+    }
+    RunQueueBenchmarks(passed);
+    RunProfilerBenchmarks();
+    RunChecks(passed);
+
+    if (!WriteResults()) {
+        std::cout << "Failed to write " << m_Settings.m_OutputPath << ".\n";
+        return false;
+    }
+    std::cout << "Benchmark " << (passed ? "passed" : "failed") << ", results in " << m_Settings.m_OutputPath << ".\n";
+    return passed;
+}
+
+bool BenchmarkRunner::PrepareVirtualTexture(const BenchmarkScene& scene, std::string& path) const
+{
+    std::filesystem::path directory = std::filesystem::path(m_Settings.m_OutputPath).parent_path();
+    path = (directory / (std::string(scene.m_Name) + ".vtex")).string();
+
+    VirtualTextureHeader header;
+    if (std::filesystem::exists(path) && ReadVirtualTextureHeader(path, header) && scene.m_InstanceCount == header.m_TextureCount &&
+        VIRTUAL_TEXTURE_SCENE_TEXTURE_SIZE == header.m_TextureSize) {
+        return true;
+    }
+    std::cout << "Writing " << path << ", " << scene.m_InstanceCount << " textures.\n";
+    return WriteVirtualTextureSet(path, scene.m_InstanceCount, VIRTUAL_TEXTURE_SCENE_TEXTURE_SIZE, GenerateProceduralTexture);
+}
+
+bool BenchmarkRunner::RunScene(const BenchmarkScene& scene, BenchmarkSceneResult& result)
+{
+    PROFILE_ZONE("BenchmarkRunner::RunScene");
+    result.m_ImageStatus = "error";
+
+    VulkanOffscreenRenderer* renderer = GetRenderer(scene.m_Samples);
+    if (nullptr == renderer) {
+        return false;
+    }
+    result.m_Samples = (uint32_t)renderer->GetSceneAttachments()->GetSamples();
+
+    OffscreenFrameDesc desc;
+    BuildProceduralFrameDesc(scene.m_Width, scene.m_Height, scene.m_InstanceCount, scene.m_Eye, scene.m_Target, scene.m_FieldOfView, desc);
+    std::vector<ClusteredLight> lights;
+    if (scene.m_LightCount > 0) {
+        BuildProceduralLights(scene.m_InstanceCount, scene.m_LightCount, lights);
+        desc.m_Lights = lights.data();
+        desc.m_LightCount = (uint32_t)lights.size();
+        desc.m_Deferred = scene.m_Deferred;
+    }
+    desc.m_Shadows = scene.m_Shadows;
+    desc.m_DynamicCasterStart = scene.m_InstanceCount - std::min(scene.m_DynamicCasters, scene.m_InstanceCount);
+    desc.m_PostProcess = scene.m_PostProcess;
+    desc.m_TemporalScale = scene.m_TemporalScale;
+    desc.m_ParticleCapacity = scene.m_ParticleCapacity;
+    desc.m_ParticleEmitRate = scene.m_ParticleEmitRate;
+    desc.m_SkinnedInstances = scene.m_SkinnedInstances;
+    desc.m_OcclusionCulling = scene.m_OcclusionCulling;
+    desc.m_Meshlets = scene.m_Meshlets;
+    desc.m_Batched = scene.m_Batched;
+    std::string virtualTexturePath;
+    if (scene.m_VirtualTextureSlots > 0) {
+        if (!PrepareVirtualTexture(scene, virtualTexturePath)) {
+            return false;
+        }
+        desc.m_VirtualTexturePath = virtualTexturePath.c_str();
+        desc.m_VirtualTextureCacheSlots = scene.m_VirtualTextureSlots;
+    }
+
+    // Every frame starts a frame of the arena, as the player's threads do.
+    std::vector<uint8_t> rgba;
+    auto renderFrame = [&]() {
+        FrameArena::BeginFrame();
+        return renderer->Render(desc, rgba);
+    };
+
+    // Warm up reallocates the target for this resolution, outside of what's measured. Virtual textures stream
+    // until the view has every page it wants, or the finest the cache holds, so the golden sees the same pages.
+    for (uint32_t frame = 0; frame < m_Settings.m_WarmUpFrames; frame++) {
+        if (!renderFrame()) {
+            return false;
+        }
+    }
+    if (scene.m_VirtualTextureSlots > 0) {
+        result.m_VirtualSettleFrames = m_Settings.m_WarmUpFrames;
+        while (!renderer->GetVirtualTexture()->IsSettled() && result.m_VirtualSettleFrames < VIRTUAL_TEXTURE_MAX_SETTLE_FRAMES) {
+            if (!renderFrame()) {
+                return false;
+            }
+            result.m_VirtualSettleFrames++;
+        }
+    }
+
+    MemoryTagStatistics memoryBefore;
+    GetTotalMemoryStatistics(memoryBefore);
+    double cpuBefore = GetProcessCpuSeconds();
+
+    std::vector<double> frameMs;
+    frameMs.reserve(m_Settings.m_Frames);
+    for (uint32_t frame = 0; frame < m_Settings.m_Frames; frame++) {
+        auto frameStart = std::chrono::steady_clock::now();
+        if (!renderFrame()) {
+            return false;
+        }
+        frameMs.push_back(ElapsedMilliseconds(frameStart));
+
+        const OffscreenFrameTiming& timing = renderer->GetLastTiming();
+        result.m_RecordMs += timing.m_RecordMs;
+        result.m_GpuMs += timing.m_GpuMs;
+        result.m_ReadbackMs += timing.m_ReadbackMs;
+        result.m_ShadowCpuMs += timing.m_ShadowCpuMs;
+        result.m_ShadowGpuMs += timing.m_ShadowGpuMs;
+        result.m_ShadowStaticCascades += timing.m_ShadowStaticCascades;
+        result.m_PostGpuMs += timing.m_PostGpuMs;
+        result.m_PostDispatches += timing.m_PostDispatches;
+        result.m_TemporalGpuMs += timing.m_TemporalGpuMs;
+        result.m_ParticleGpuMs += timing.m_ParticleGpuMs;
+        result.m_SkinningCpuMs += timing.m_SkinningCpuMs;
+        result.m_SkinningGpuMs += timing.m_SkinningGpuMs;
+        result.m_OcclusionCullGpuMs += timing.m_OcclusionCullGpuMs;
+        result.m_OcclusionPyramidGpuMs += timing.m_OcclusionPyramidGpuMs;
+        result.m_OcclusionEarlyDrawn += timing.m_OcclusionEarlyDrawn;
+        result.m_OcclusionLateDrawn += timing.m_OcclusionLateDrawn;
+        result.m_VirtualPagesRequested += timing.m_VirtualPagesRequested;
+        result.m_VirtualPagesUploaded += timing.m_VirtualPagesUploaded;
+        result.m_VirtualPagesResident = timing.m_VirtualPagesResident;
+        result.m_MeshletTriangles = timing.m_MeshletTriangles;
+        result.m_MeshletVisibleTriangles += timing.m_MeshletVisibleTriangles;
+        result.m_MeshletCount = timing.m_MeshletCount;
+        result.m_MeshletVisibleCount += timing.m_MeshletVisibleCount;
+        result.m_BatchedObjects = timing.m_BatchedObjects;
+        result.m_BatchedDrawCalls = timing.m_BatchedDrawCalls;
+        result.m_BatchedPipelineBinds = timing.m_BatchedPipelineBinds;
+        result.m_BatchedCpuMs += timing.m_BatchedCpuMs;
+    }
+
+    double cpuSeconds = GetProcessCpuSeconds() - cpuBefore;
+    MemoryTagStatistics memoryAfter;
+    GetTotalMemoryStatistics(memoryAfter);
+
+    double frames = (double)m_Settings.m_Frames;
+    result.m_FrameMs = Summarize(frameMs);
+    result.m_RecordMs /= frames;
+    result.m_GpuMs /= frames;
+    result.m_ReadbackMs /= frames;
+    result.m_ShadowCpuMs /= frames;
+    result.m_ShadowGpuMs /= frames;
+    result.m_ShadowStaticCascades /= frames;
+    result.m_PostGpuMs /= frames;
+    result.m_PostDispatches /= frames;
+    result.m_TemporalGpuMs /= frames;
+    result.m_ParticleGpuMs /= frames;
+    result.m_SkinningCpuMs /= frames;
+    result.m_SkinningGpuMs /= frames;
+    result.m_OcclusionCullGpuMs /= frames;
+    result.m_OcclusionPyramidGpuMs /= frames;
+    result.m_OcclusionEarlyDrawn /= frames;
+    result.m_OcclusionLateDrawn /= frames;
+    result.m_VirtualPagesRequested /= frames;
+    result.m_VirtualPagesUploaded /= frames;
+    result.m_MeshletVisibleTriangles /= frames;
+    result.m_MeshletVisibleCount /= frames;
+    result.m_BatchedCpuMs /= frames;
+    result.m_CpuMsPerFrame = cpuSeconds * 1000.0 / frames;
+    result.m_AllocationsPerFrame = (double)(memoryAfter.m_TotalAllocations - memoryBefore.m_TotalAllocations) / frames;
+    result.m_MemoryBytes = memoryAfter.m_CurrentBytes;
+    result.m_PeakMemoryBytes = memoryAfter.m_PeakBytes;
+    result.m_AttachmentMemoryBytes = renderer->GetLastBandwidth().m_MemoryBytes;
+    result.m_AttachmentOnChipBytes = renderer->GetLastBandwidth().m_OnChipBytes;
+    if (OffscreenPostProcess::None != scene.m_PostProcess && nullptr != renderer->GetPostProcess()) {
+        result.m_PostIntermediateBytes = renderer->GetPostProcess()->GetIntermediateBytes();
+        result.m_PostUnsharedIntermediateBytes = renderer->GetPostProcess()->GetUnsharedIntermediateBytes();
+    }
+    if (scene.m_SkinnedInstances > 0 && nullptr != renderer->GetSkinning()) {
+        result.m_SkinnedVertices = renderer->GetSkinning()->GetVertexCount();
+        result.m_AnimationThreads = renderer->GetAnimationThreadCount();
+    }
+    if (scene.m_VirtualTextureSlots > 0 && nullptr != renderer->GetVirtualTexture()) {
+        const VulkanVirtualTexture* virtualTexture = renderer->GetVirtualTexture();
+        result.m_VirtualMemoryBytes = virtualTexture->GetMemoryBytes();
+        result.m_VirtualSetBytes = (uint64_t)GetVirtualTexturePageCount(virtualTexture->GetHeader()) * VIRTUAL_TEXTURE_PAGE_BYTES;
+        result.m_VirtualSparse = virtualTexture->IsSparse();
+    }
+
+    CheckGolden(scene, rgba, result);
+    return true;
+}
+
+void BenchmarkRunner::RunQueueBenchmarks(bool& passed)
+{
+    if (0 == m_Settings.m_QueueItems) {
+        return;
+    }
+
+    for (uint32_t producers : GetQueueBenchmarkProducerCounts()) {
+        for (uint32_t kind = 0; kind < (uint32_t)QueueBenchmarkKind::Count; kind++) {
+            if (!MatchesFilter(GetQueueBenchmarkName((QueueBenchmarkKind)kind, producers))) {
+                continue;
+            }
+            QueueBenchmarkResult result;
+            RunQueueBenchmark((QueueBenchmarkKind)kind, producers, m_Settings.m_QueueItems, result);
+            passed &= result.m_Valid;
+
+            std::cout << result.m_Name << ": " << result.m_MillionItemsPerSecond << " M items/s, " << result.m_FullRetries << " full retries"
+                << (result.m_Valid ? "" : ", items lost or reordered") << "\n";
+            m_QueueResults.push_back(result);
+        }
+    }
+}
+
+void BenchmarkRunner::RunProfilerBenchmarks()
+{
+    if (0 == m_Settings.m_ProfilerZones) {
+        return;
+    }
+
+    for (bool capturing : { false, true }) {
+        if (!MatchesFilter(GetProfilerBenchmarkName(capturing))) {
+            continue;
+        }
+        ProfilerBenchmarkResult result;
+        RunProfilerBenchmark(capturing, m_Settings.m_ProfilerZones, result);
+        if (0 == result.m_Zones) {
+            std::cout << result.m_Name << ": not measured, the profiler is compiled out or already capturing\n";
+        } else {
+            std::cout << result.m_Name << ": " << result.m_NanosecondsPerZone << " ns per zone, "
+                << (result.m_WithinBudget ? "within" : "over") << " the " << PROFILER_ZONE_BUDGET_NANOSECONDS << " ns budget\n";
+        }
+        m_ProfilerResults.push_back(result);
+    }
+}
+
+void BenchmarkRunner::RunChecks(bool& passed)
+{
+    std::vector<EngineCheckResult> results;
+    RunEngineChecks(m_HeadlessDevice, results);
+    for (const EngineCheckResult& result : results) {
+        if (!MatchesFilter(result.m_Name)) {
+            continue;
+        }
+        if (result.m_Skipped) {
+            std::cout << result.m_Name << ": skipped, no device\n";
+            m_CheckResults.push_back(result);
+            continue;
+        }
+        passed &= result.m_Passed;
+        std::cout << result.m_Name << ": " << (result.m_Passed ? "pass" : "fail, " + result.m_Detail) << "\n";
+        m_CheckResults.push_back(result);
+    }
+}
+
+void BenchmarkRunner::CheckGolden(const BenchmarkScene& scene, const std::vector<uint8_t>& rgba, BenchmarkSceneResult& result)
+{
+    std::filesystem::path goldenPath = std::filesystem::path(m_Settings.m_GoldenDirectory) / (std::string(scene.m_Name) + ".png");
+    std::filesystem::path failurePath = std::filesystem::path(m_Settings.m_OutputPath).parent_path();
+
+    std::vector<uint8_t> png;
+    if (!EncodePNG(rgba.data(), scene.m_Width, scene.m_Height, png)) {
+        result.m_ImageStatus = "error";
+        return;
+    }
+
+    if (m_Settings.m_UpdateGoldens) {
+        std::error_code error;
+        std::filesystem::create_directories(goldenPath.parent_path(), error);
+        result.m_ImageStatus = WriteFile(goldenPath.string(), png) ? "updated" : "error";
+        return;
+    }
+
+    std::ifstream file(goldenPath.string(), std::ios::binary);
+    std::vector<uint8_t> goldenFile((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    uint32_t goldenWidth = 0;
+    uint32_t goldenHeight = 0;
+    std::vector<uint8_t> golden;
+    if (goldenFile.empty() || !DecodePNG(goldenFile.data(), goldenFile.size(), goldenWidth, goldenHeight, golden)) {
+        std::cout << "No readable golden " << goldenPath.string() << ", run with --update-goldens to create it.\n";
+        result.m_ImageStatus = "missing";
+        WriteFile((failurePath / (std::string(scene.m_Name) + ".actual.png")).string(), png);
+        return;
+    }
+
+    std::vector<uint8_t> diff;
+    if (goldenWidth != scene.m_Width || goldenHeight != scene.m_Height ||
+        !CompareImages(golden.data(), rgba.data(), scene.m_Width, scene.m_Height, m_Settings.m_Compare, result.m_Compare, &diff)) {
+        result.m_ImageStatus = "fail";
+    } else {
+        result.m_ImageStatus = result.m_Compare.m_Passed ? "pass" : "fail";
+    }
+
+    if ("fail" == result.m_ImageStatus) {
+        WriteFile((failurePath / (std::string(scene.m_Name) + ".actual.png")).string(), png);
+        if (!diff.empty() && EncodePNG(diff.data(), scene.m_Width, scene.m_Height, png)) {
+            WriteFile((failurePath / (std::string(scene.m_Name) + ".diff.png")).string(), png);
+        }
+    }
+}
+
+void BenchmarkRunner::LoadBaselines()
+{
+    std::filesystem::path path = std::filesystem::path(m_Settings.m_GoldenDirectory) / "Baselines.txt";
+    std::ifstream file(path.string());
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || '#' == line[0]) {
+            continue;
+        }
+        std::istringstream fields(line);
+        std::string scene;
+        std::string metric;
+        double value = 0.0;
+        if (fields >> scene >> metric >> value) {
+            m_RecordedBaselines[scene + " " + metric] = value;
+        }
+    }
+}
+
+bool BenchmarkRunner::SaveBaselines() const
+{
+    std::filesystem::path path = std::filesystem::path(m_Settings.m_GoldenDirectory) / "Baselines.txt";
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    // Scenes the filter left out keep what they had.
+    std::ofstream file(path.string(), std::ios::trunc);
+    file << "# <scene> <metric> <value>, recorded by Benchmark --update-goldens on "
+        << (nullptr != m_HeadlessDevice ? m_HeadlessDevice->GetDeviceName() : "no device") << "\n";
+    for (const auto& baseline : m_RecordedBaselines) {
+        file << baseline.first << " " << baseline.second << "\n";
+    }
+    return (bool)file;
+}
+
+void BenchmarkRunner::CheckBaselines(const BenchmarkScene& scene, BenchmarkSceneResult& result)
+{
+    size_t baselineCount = 0;
+    const BenchmarkBaseline* baselines = GetBenchmarkBaselines(baselineCount);
+    for (size_t i = 0; i < baselineCount; i++) {
+        if (std::string(baselines[i].m_Scene) != scene.m_Name) {
+            continue;
+        }
+
+        BenchmarkBaselineResult baseline;
+        baseline.m_Metric = baselines[i].m_Metric;
+        if (!GetBaselineMetric(result, baseline.m_Metric, baseline.m_Value)) {
+            std::cout << "Unknown baseline metric " << baseline.m_Metric << " of " << scene.m_Name << ".\n";
+            result.m_Baselines.push_back(baseline);
+            continue;
+        }
+
+        // Only recorded along with a golden, a value of an image that wasn't written means nothing.
+        std::string key = std::string(scene.m_Name) + " " + baseline.m_Metric;
+        if (m_Settings.m_UpdateGoldens && "updated" == result.m_ImageStatus) {
+            m_RecordedBaselines[key] = baseline.m_Value;
+        }
+        auto recorded = m_RecordedBaselines.find(key);
+        if (recorded != m_RecordedBaselines.end()) {
+            baseline.m_Recorded = recorded->second;
+            baseline.m_Missing = false;
+            baseline.m_Change = (recorded->second > 0.0) ? baseline.m_Value / recorded->second - 1.0 : 0.0;
+            baseline.m_Regressed = (baseline.m_Change > m_Settings.m_MaxRegression);
+        }
+        result.m_Baselines.push_back(baseline);
+    }
+}
+
+bool BenchmarkRunner::WriteResults() const
+{
+    std::ostringstream json;
+    json.precision(6);
+    json << "{\n";
+    json << "  \"label\": " << JsonString(m_Settings.m_Label) << ",\n";
+    json << "  \"device\": " << JsonString(nullptr != m_HeadlessDevice ? m_HeadlessDevice->GetDeviceName() : "") << ",\n";
+    json << "  \"hardware_threads\": " << std::thread::hardware_concurrency() << ",\n";
+    json << "  \"warmup_frames\": " << m_Settings.m_WarmUpFrames << ",\n";
+    json << "  \"frames\": " << m_Settings.m_Frames << ",\n";
+    json << "  \"threshold\": " << m_Settings.m_Compare.m_Threshold << ",\n";
+    json << "  \"max_different_fraction\": " << m_Settings.m_Compare.m_MaxDifferentFraction << ",\n";
+    json << "  \"max_regression\": " << m_Settings.m_MaxRegression << ",\n";
+    json << "  \"scenes\": [";
+    for (size_t i = 0; i < m_Results.size(); i++) {
+        const BenchmarkSceneResult& result = m_Results[i];
+        const BenchmarkScene& scene = *result.m_Scene;
+        json << (i > 0 ? "," : "") << "\n    {\n";
+        json << "      \"name\": " << JsonString(scene.m_Name) << ",\n";
+        json << "      \"width\": " << scene.m_Width << ", \"height\": " << scene.m_Height << ", \"instances\": " << scene.m_InstanceCount
+            << ", \"lights\": " << scene.m_LightCount << ", \"deferred\": " << (scene.m_Deferred ? "true" : "false")
+            << ", \"shadows\": " << (scene.m_Shadows ? "true" : "false") << ", \"dynamic_casters\": " << scene.m_DynamicCasters
+            << ", \"post_process\": " << JsonString(POST_PROCESS_NAMES[(uint32_t)scene.m_PostProcess])
+            << ", \"samples\": " << result.m_Samples << ",\n";
+        json << "      \"frame_ms\": { \"mean\": " << result.m_FrameMs.m_Mean << ", \"median\": " << result.m_FrameMs.m_Median
+            << ", \"p95\": " << result.m_FrameMs.m_P95 << ", \"min\": " << result.m_FrameMs.m_Min << ", \"max\": " << result.m_FrameMs.m_Max << " },\n";
+        json << "      \"phase_ms\": { \"record\": " << result.m_RecordMs << ", \"gpu\": " << result.m_GpuMs << ", \"readback\": " << result.m_ReadbackMs << " },\n";
+        json << "      \"shadow_ms\": { \"cpu\": " << result.m_ShadowCpuMs << ", \"gpu\": " << result.m_ShadowGpuMs
+            << ", \"static_cascades_per_frame\": " << result.m_ShadowStaticCascades << " },\n";
+        json << "      \"post_ms\": { \"gpu\": " << result.m_PostGpuMs << ", \"dispatches\": " << result.m_PostDispatches << " },\n";
+        json << "      \"post_intermediate_bytes\": { \"allocated\": " << result.m_PostIntermediateBytes
+            << ", \"unshared\": " << result.m_PostUnsharedIntermediateBytes << " },\n";
+        if (scene.m_TemporalScale > 0.0f) {
+            // Saving of the whole frame's GPU time, resolve included, against the native scene.
+            const BenchmarkSceneResult* native = FindNativeResult(result);
+            double saving = (nullptr != native) ? native->m_GpuMs - result.m_GpuMs : 0.0;
+            json << "      \"temporal\": { \"scale\": " << scene.m_TemporalScale << ", \"resolve_gpu_ms\": " << result.m_TemporalGpuMs
+                << ", \"native_scene\": " << JsonString(nullptr != native ? native->m_Scene->m_Name : "")
+                << ", \"gpu_saving_ms\": " << saving << ", \"gpu_saving_fraction\": "
+                << ((nullptr != native && native->m_GpuMs > 0.0) ? saving / native->m_GpuMs : 0.0) << " },\n";
+        }
+        if (scene.m_ParticleCapacity > 0) {
+            json << "      \"particles\": { \"capacity\": " << scene.m_ParticleCapacity << ", \"emit_rate\": " << scene.m_ParticleEmitRate
+                << ", \"gpu_ms\": " << result.m_ParticleGpuMs << " },\n";
+        }
+        if (scene.m_SkinnedInstances > 0) {
+            json << "      \"skinning\": { \"instances\": " << scene.m_SkinnedInstances << ", \"vertices_per_instance\": " << result.m_SkinnedVertices
+                << ", \"animation_threads\": " << result.m_AnimationThreads << ", \"animation_cpu_ms\": " << result.m_SkinningCpuMs
+                << ", \"gpu_ms\": " << result.m_SkinningGpuMs << " },\n";
+        }
+        if (scene.m_OcclusionCulling) {
+            json << "      \"occlusion\": { \"early_drawn\": " << result.m_OcclusionEarlyDrawn << ", \"late_drawn\": " << result.m_OcclusionLateDrawn
+                << ", \"cull_gpu_ms\": " << result.m_OcclusionCullGpuMs << ", \"pyramid_gpu_ms\": " << result.m_OcclusionPyramidGpuMs << " },\n";
+        }
+        if (scene.m_VirtualTextureSlots > 0) {
+            json << "      \"virtual_texture\": { \"cache_slots\": " << scene.m_VirtualTextureSlots << ", \"sparse\": " << (result.m_VirtualSparse ? "true" : "false")
+                << ", \"settle_frames\": " << result.m_VirtualSettleFrames << ", \"pages_resident\": " << result.m_VirtualPagesResident
+                << ", \"pages_requested_per_frame\": " << result.m_VirtualPagesRequested << ", \"pages_uploaded_per_frame\": " << result.m_VirtualPagesUploaded
+                << ", \"memory_bytes\": " << result.m_VirtualMemoryBytes << ", \"set_bytes\": " << result.m_VirtualSetBytes << " },\n";
+        }
+        if (scene.m_Meshlets) {
+            json << "      \"meshlets\": { \"meshlets\": " << result.m_MeshletCount << ", \"visible_meshlets\": " << result.m_MeshletVisibleCount
+                << ", \"triangles\": " << result.m_MeshletTriangles << ", \"visible_triangles\": " << result.m_MeshletVisibleTriangles
+                << ", \"culled_fraction\": " << (result.m_MeshletTriangles > 0 ? 1.0 - result.m_MeshletVisibleTriangles / result.m_MeshletTriangles : 0.0) << " },\n";
+        }
+        if (scene.m_Batched) {
+            json << "      \"batching\": { \"objects\": " << result.m_BatchedObjects << ", \"draw_calls\": " << result.m_BatchedDrawCalls
+                << ", \"pipeline_binds\": " << result.m_BatchedPipelineBinds << ", \"cpu_ms\": " << result.m_BatchedCpuMs << " },\n";
+        }
+        json << "      \"baselines\": [";
+        for (size_t j = 0; j < result.m_Baselines.size(); j++) {
+            const BenchmarkBaselineResult& baseline = result.m_Baselines[j];
+            json << (j > 0 ? ", " : " ") << "{ \"metric\": " << JsonString(baseline.m_Metric) << ", \"value\": " << baseline.m_Value
+                << ", \"recorded\": " << baseline.m_Recorded << ", \"missing\": " << (baseline.m_Missing ? "true" : "false")
+                << ", \"change\": " << baseline.m_Change << ", \"regressed\": " << (baseline.m_Regressed ? "true" : "false") << " }";
+        }
+        json << (result.m_Baselines.empty() ? "],\n" : " ],\n");
+        json << "      \"cpu_ms_per_frame\": " << result.m_CpuMsPerFrame << ",\n";
+        json << "      \"allocations_per_frame\": " << result.m_AllocationsPerFrame << ",\n";
+        json << "      \"memory_bytes\": " << result.m_MemoryBytes << ", \"peak_memory_bytes\": " << result.m_PeakMemoryBytes << ",\n";
+        json << "      \"attachment_bytes\": { \"memory\": " << result.m_AttachmentMemoryBytes << ", \"on_chip\": " << result.m_AttachmentOnChipBytes << " },\n";
+        json << "      \"image\": { \"status\": " << JsonString(result.m_ImageStatus) << ", \"different_pixels\": " << result.m_Compare.m_DifferentPixels
+            << ", \"different_fraction\": " << result.m_Compare.m_DifferentFraction << ", \"max_distance\": " << result.m_Compare.m_MaxDistance
+            << ", \"psnr\": " << result.m_Compare.m_Psnr << " }\n";
+        json << "    }";
+    }
+    json << "\n  ],\n";
+    json << "  \"queues\": [";
+    for (size_t i = 0; i < m_QueueResults.size(); i++) {
+        const QueueBenchmarkResult& result = m_QueueResults[i];
+        json << (i > 0 ? "," : "") << "\n    { \"name\": " << JsonString(result.m_Name) << ", \"producers\": " << result.m_Producers
+            << ", \"items\": " << result.m_Items << ", \"ms\": " << result.m_Ms << ", \"million_items_per_second\": " << result.m_MillionItemsPerSecond
+            << ", \"full_retries\": " << result.m_FullRetries << ", \"valid\": " << (result.m_Valid ? "true" : "false") << " }";
+    }
+    json << "\n  ],\n";
+    json << "  \"profiler\": [";
+    for (size_t i = 0; i < m_ProfilerResults.size(); i++) {
+        const ProfilerBenchmarkResult& result = m_ProfilerResults[i];
+        json << (i > 0 ? "," : "") << "\n    { \"name\": " << JsonString(result.m_Name) << ", \"capturing\": " << (result.m_Capturing ? "true" : "false")
+            << ", \"zones\": " << result.m_Zones << ", \"ns_per_zone\": " << result.m_NanosecondsPerZone
+            << ", \"budget_ns\": " << PROFILER_ZONE_BUDGET_NANOSECONDS << ", \"within_budget\": " << (result.m_WithinBudget ? "true" : "false") << " }";
+    }
+    json << "\n  ],\n";
+    json << "  \"checks\": [";
+    for (size_t i = 0; i < m_CheckResults.size(); i++) {
+        const EngineCheckResult& result = m_CheckResults[i];
+        json << (i > 0 ? "," : "") << "\n    { \"name\": " << JsonString(result.m_Name) << ", \"passed\": " << (result.m_Passed ? "true" : "false")
+            << ", \"skipped\": " << (result.m_Skipped ? "true" : "false")
+            << ", \"detail\": " << JsonString(result.m_Detail) << " }";
+    }
+    json << "\n  ]\n}\n";
+
+    std::string text = json.str();
+    return WriteFile(m_Settings.m_OutputPath, std::vector<uint8_t>(text.begin(), text.end()));
+}
+
+const BenchmarkSceneResult* BenchmarkRunner::FindNativeResult(const BenchmarkSceneResult& result) const
+{
+    const BenchmarkScene& scene = *result.m_Scene;
+    for (const BenchmarkSceneResult& other : m_Results) {
+        const BenchmarkScene& native = *other.m_Scene;
+        if (0.0f == native.m_TemporalScale && native.m_Width == scene.m_Width && native.m_Height == scene.m_Height &&
+            native.m_InstanceCount == scene.m_InstanceCount && native.m_LightCount == scene.m_LightCount &&
+            native.m_Shadows == scene.m_Shadows && native.m_PostProcess == scene.m_PostProcess && native.m_ParticleCapacity == scene.m_ParticleCapacity &&
+            native.m_SkinnedInstances == scene.m_SkinnedInstances && native.m_OcclusionCulling == scene.m_OcclusionCulling &&
+            native.m_VirtualTextureSlots == scene.m_VirtualTextureSlots && native.m_Meshlets == scene.m_Meshlets &&
+            native.m_Batched == scene.m_Batched &&
+            other.m_Samples == result.m_Samples) {
+            return &other;
+        }
+    }
+    return nullptr;
+}
+
+bool BenchmarkRunner::ShutDown()
+{
+    for (auto& renderer : m_Renderers) {
+        renderer.second->Destroy();
+        Delete(renderer.second);
+    }
+    m_Renderers.clear();
+
+    if (nullptr != m_HeadlessDevice) {
+        m_HeadlessDevice->Destroy();
+    }
+    return true;
+}
+
+void BenchmarkRunner::CleanUp()
+{
+    if (nullptr != m_HeadlessDevice) {
+        Delete(m_HeadlessDevice);
+        m_HeadlessDevice = nullptr;
+    }
+    FrameArena::CleanUp();
+
+#if PROFILER_ENABLED
+    Profiler::CleanUp();
+#endif
+
+    ReportMemory();
+    ReportMemoryLeaks();
+}
+
+__END_NAMESPACE
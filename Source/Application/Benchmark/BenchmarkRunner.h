@@ -0,0 +1,151 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+class VulkanHeadlessDevice;
+class VulkanOffscreenRenderer;
+struct BenchmarkScene;
+
+
+typedef struct BenchmarkSettings {
+	std::string   m_GoldenDirectory = "Data/Goldens";
+	std::string   m_OutputPath = "BenchmarkResults.json";   // Failed images are written next to it
+	std::string   m_SceneFilter;                            // Substring of the scene names to run, empty runs all
+	std::string   m_Label;                                  // Copied to the JSON, e.g. the commit being measured
+	std::string   m_DeviceName;                             // e.g. "llvmpipe" for lavapipe
+	uint32_t      m_WarmUpFrames = 5;
+	uint32_t      m_Frames = 60;
+	uint64_t      m_QueueItems = 250000;                    // Per producer of the queue contention cases, 0 skips them
+	uint64_t      m_ProfilerZones = 1000000;                // Per run of the profiler zone cost cases, 0 skips them
+	bool          m_UpdateGoldens = false;                  // Baselines are recorded along
+	double        m_MaxRegression = 0.2;                    // Fraction a baseline metric may grow before it's reported
+	ImageCompareSettings m_Compare;
+} BenchmarkSettings;
+
+typedef struct BenchmarkTimingSummary {
+	double        m_Mean = 0.0;
+	double        m_Median = 0.0;
+	double        m_P95 = 0.0;
+	double        m_Min = 0.0;
+	double        m_Max = 0.0;
+} BenchmarkTimingSummary;
+
+typedef struct BenchmarkBaselineResult {
+	std::string   m_Metric;
+	double        m_Value = 0.0;
+	double        m_Recorded = 0.0;
+	bool          m_Missing = true;         // Nothing recorded for it, fails the run like a missing golden
+	double        m_Change = 0.0;           // Fraction of the recorded value, positive is worse
+	bool          m_Regressed = false;      // Over BenchmarkSettings::m_MaxRegression
+} BenchmarkBaselineResult;
+
+typedef struct BenchmarkSceneResult {
+	const BenchmarkScene*    m_Scene = nullptr;
+	uint32_t                 m_Samples = 1;
+	BenchmarkTimingSummary   m_FrameMs;
+	double                   m_RecordMs = 0.0;          // Means per frame of each phase
+	double                   m_GpuMs = 0.0;
+	double                   m_ReadbackMs = 0.0;
+	double                   m_ShadowCpuMs = 0.0;
+	double                   m_ShadowGpuMs = 0.0;
+	double                   m_ShadowStaticCascades = 0.0;   // Static cascade redraws per frame
+	double                   m_PostGpuMs = 0.0;
+	double                   m_PostDispatches = 0.0;
+	uint64_t                 m_PostIntermediateBytes = 0;           // Of the images the chain shares
+	uint64_t                 m_PostUnsharedIntermediateBytes = 0;   // With one image per intermediate instead
+	double                   m_TemporalGpuMs = 0.0;     // Resolve & output blit
+	double                   m_ParticleGpuMs = 0.0;     // Emission to sort, the draw is part of the scene pass
+	double                   m_SkinningCpuMs = 0.0;     // Animation sampling & blending, part of m_RecordMs
+	double                   m_SkinningGpuMs = 0.0;     // Skinning dispatch, the draws are part of the shadow & scene passes
+	uint32_t                 m_SkinnedVertices = 0;     // Per character
+	uint32_t                 m_AnimationThreads = 0;
+	double                   m_OcclusionCullGpuMs = 0.0;     // Both culling phases
+	double                   m_OcclusionPyramidGpuMs = 0.0;
+	double                   m_OcclusionEarlyDrawn = 0.0;    // Cubes per frame
+	double                   m_OcclusionLateDrawn = 0.0;
+	double                   m_VirtualPagesRequested = 0.0;  // Per frame, once settled
+	double                   m_VirtualPagesUploaded = 0.0;
+	uint32_t                 m_VirtualPagesResident = 0;
+	uint32_t                 m_VirtualSettleFrames = 0;      // Warm up frames until nothing was missing
+	uint64_t                 m_VirtualMemoryBytes = 0;       // Cache committed & page table
+	uint64_t                 m_VirtualSetBytes = 0;          // Every page of every mip
+	bool                     m_VirtualSparse = false;
+	uint32_t                 m_MeshletTriangles = 0;         // Of the whole mesh
+	double                   m_MeshletVisibleTriangles = 0.0;  // Per frame, left after culling
+	uint32_t                 m_MeshletCount = 0;
+	double                   m_MeshletVisibleCount = 0.0;
+	uint32_t                 m_BatchedObjects = 0;           // Draw calls without batching
+	uint32_t                 m_BatchedDrawCalls = 0;
+	uint32_t                 m_BatchedPipelineBinds = 0;
+	double                   m_BatchedCpuMs = 0.0;           // Per frame, preparing & recording the batches
+	double                   m_CpuMsPerFrame = 0.0;     // Process CPU time, every thread including the driver's
+	double                   m_AllocationsPerFrame = 0.0;
+	size_t                   m_MemoryBytes = 0;
+	size_t                   m_PeakMemoryBytes = 0;
+	uint64_t                 m_AttachmentMemoryBytes = 0;   // Per frame estimate, see VulkanOffscreenRenderer::GetLastBandwidth()
+	uint64_t                 m_AttachmentOnChipBytes = 0;
+	std::string              m_ImageStatus;             // pass, fail, missing, updated or error
+	std::vector<BenchmarkBaselineResult> m_Baselines;   // Of GetBenchmarkBaselines() for the scene
+	ImageCompareResult       m_Compare;
+} BenchmarkSceneResult;
+
+
+/**
+ * Renders the canned scenes of BenchmarkScenes.cpp on a headless device, measures frame time, CPU time
+ * per phase, allocations & memory, compares the last frame against the scene's golden image and writes
+ * everything as JSON. Run() fails when a scene fails to render or doesn't match its golden, so it can
+ * gate a CI step while the JSON is archived per commit to track performance.
+ * The cross-thread render request queue is measured as well, against a mutex queue under growing contention,
+ * and the host side engine checks run along, failing Run() alike. The cost of a profiler zone, idle & capturing,
+ * is reported against its budget but fails nothing, it's too noisy on shared machines.
+ * Feature scenes have a metric recorded with their goldens, see GetBenchmarkBaselines(): a scene without it fails
+ * like one without its golden, growing past m_MaxRegression is reported but fails nothing for the same reason.
+ */
+class BenchmarkRunner
+{
+public:
+	BenchmarkRunner();
+	virtual ~BenchmarkRunner();
+
+	bool Run(int argc, char** argv);
+
+private:
+	virtual bool Initial(int argc, char** argv);
+	virtual bool StartUp();
+	virtual bool MainLoop();
+	virtual bool ShutDown();
+	virtual void CleanUp();
+
+	VulkanOffscreenRenderer* GetRenderer(uint32_t samples);
+	bool RunScene(const BenchmarkScene& scene, BenchmarkSceneResult& result);
+	// The scene's set next to the results, written on the first run.
+	bool PrepareVirtualTexture(const BenchmarkScene& scene, std::string& path) const;
+	void CheckGolden(const BenchmarkScene& scene, const std::vector<uint8_t>& rgba, BenchmarkSceneResult& result);
+	// <goldens>/Baselines.txt, "<scene> <metric> <value>" per line.
+	void LoadBaselines();
+	bool SaveBaselines() const;
+	// Records the scene's metrics when updating the goldens, compares them otherwise.
+	void CheckBaselines(const BenchmarkScene& scene, BenchmarkSceneResult& result);
+	bool WriteResults() const;
+	// Same scene rendered natively without the temporal resolve, if it ran.
+	const BenchmarkSceneResult* FindNativeResult(const BenchmarkSceneResult& result) const;
+
+	bool MatchesFilter(const std::string& name) const;
+	void RunQueueBenchmarks(bool& passed);
+	void RunProfilerBenchmarks();
+	void RunChecks(bool& passed);
+
+	BenchmarkSettings                                 m_Settings;
+	VulkanHeadlessDevice*                             m_HeadlessDevice;
+	std::map<uint32_t, VulkanOffscreenRenderer*>      m_Renderers;       // By requested sample count
+	std::vector<BenchmarkSceneResult>                 m_Results;
+	std::vector<QueueBenchmarkResult>                 m_QueueResults;
+	std::vector<ProfilerBenchmarkResult>              m_ProfilerResults;
+	std::vector<EngineCheckResult>                    m_CheckResults;
+	std::map<std::string, double>                     m_RecordedBaselines;   // By "<scene> <metric>"
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,131 @@
+#include "VulkanUtility.h"
+#include "VulkanOffscreenRenderer.h"
+#include "BenchmarkScenes.h"
+
+
+__BEGIN_NAMESPACE
+
+// A scene with every feature off, turned on one call at a time.
+class BenchmarkSceneBuilder
+{
+public:
+    BenchmarkSceneBuilder(const char* name, uint32_t width, uint32_t height, uint32_t instanceCount, const glm::vec3& eye,
+        const glm::vec3& target = glm::vec3(0.0f))
+    {
+        m_Scene = BenchmarkScene();
+        m_Scene.m_Name = name;
+        m_Scene.m_Width = width;
+        m_Scene.m_Height = height;
+        m_Scene.m_InstanceCount = instanceCount;
+        m_Scene.m_Samples = 1;
+        m_Scene.m_Eye = eye;
+        m_Scene.m_Target = target;
+        m_Scene.m_FieldOfView = 60.0f;
+        m_Scene.m_PostProcess = OffscreenPostProcess::None;
+    }
+
+    BenchmarkSceneBuilder& FieldOfView(float degrees) { m_Scene.m_FieldOfView = degrees; return *this; }
+    BenchmarkSceneBuilder& Samples(uint32_t samples) { m_Scene.m_Samples = samples; return *this; }
+    BenchmarkSceneBuilder& Lights(uint32_t count) { m_Scene.m_LightCount = count; return *this; }
+    BenchmarkSceneBuilder& Deferred() { m_Scene.m_Deferred = true; return *this; }
+    BenchmarkSceneBuilder& Shadows(uint32_t dynamicCasters) { m_Scene.m_Shadows = true; m_Scene.m_DynamicCasters = dynamicCasters; return *this; }
+    BenchmarkSceneBuilder& PostProcess(OffscreenPostProcess postProcess) { m_Scene.m_PostProcess = postProcess; return *this; }
+    BenchmarkSceneBuilder& Temporal(float scale) { m_Scene.m_TemporalScale = scale; return *this; }
+    BenchmarkSceneBuilder& Particles(uint32_t capacity, float emitRate) { m_Scene.m_ParticleCapacity = capacity; m_Scene.m_ParticleEmitRate = emitRate; return *this; }
+    BenchmarkSceneBuilder& Skinned(uint32_t instances) { m_Scene.m_SkinnedInstances = instances; return *this; }
+    BenchmarkSceneBuilder& OcclusionCulling() { m_Scene.m_OcclusionCulling = true; return *this; }
+    BenchmarkSceneBuilder& VirtualTexture(uint32_t slots) { m_Scene.m_VirtualTextureSlots = slots; return *this; }
+    BenchmarkSceneBuilder& Meshlets() { m_Scene.m_Meshlets = true; return *this; }
+    BenchmarkSceneBuilder& Batched() { m_Scene.m_Batched = true; return *this; }
+
+    operator BenchmarkScene() const { return m_Scene; }
+
+private:
+    BenchmarkScene m_Scene;
+};
+
+// Cameras over the grid of 1024 & of 16384 cubes.
+static const glm::vec3 GRID_1024_EYE(0.0f, 30.0f, 45.0f);
+static const glm::vec3 GRID_16384_EYE(0.0f, 110.0f, 160.0f);
+
+// Renaming a scene or changing its camera invalidates its golden, regenerate it with --update-goldens.
+static const BenchmarkScene BENCHMARK_SCENES[] = {
+    BenchmarkSceneBuilder("cube", 256, 256, 1, glm::vec3(2.5f, 2.0f, 3.5f)).FieldOfView(45.0f),
+    BenchmarkSceneBuilder("grid_64", 640, 480, 64, glm::vec3(0.0f, 8.0f, 14.0f)),
+    BenchmarkSceneBuilder("grid_1024", 1280, 720, 1024, GRID_1024_EYE),
+    BenchmarkSceneBuilder("grid_1024_msaa4", 1280, 720, 1024, GRID_1024_EYE).Samples(4),
+    BenchmarkSceneBuilder("grid_16384", 1920, 1080, 16384, GRID_16384_EYE),
+    // Same lights per pixel with 16 times the lights, frame time should stay about flat.
+    BenchmarkSceneBuilder("grid_1024_lights_256", 1280, 720, 1024, GRID_1024_EYE).Lights(256),
+    BenchmarkSceneBuilder("grid_1024_lights_4096", 1280, 720, 1024, GRID_1024_EYE).Lights(4096),
+    // Should match the forward one within the threshold, compare attachment_bytes & frame time between the two.
+    BenchmarkSceneBuilder("grid_1024_lights_4096_deferred", 1280, 720, 1024, GRID_1024_EYE).Lights(4096).Deferred(),
+    // Static caster shadows are drawn once in warm up, shadow_ms should then follow the 64 dynamic casters only.
+    BenchmarkSceneBuilder("grid_1024_shadows", 1280, 720, 1024, GRID_1024_EYE).Shadows(64),
+    // Same chain fused & not, compare post_ms & post_intermediate_bytes between the two.
+    BenchmarkSceneBuilder("grid_1024_post", 1280, 720, 1024, GRID_1024_EYE).PostProcess(OffscreenPostProcess::Fused),
+    BenchmarkSceneBuilder("grid_1024_post_unfused", 1280, 720, 1024, GRID_1024_EYE).PostProcess(OffscreenPostProcess::Unfused),
+    // Compare the temporal saving against grid_16384, at 1 it's anti-aliasing only & costs the resolve.
+    BenchmarkSceneBuilder("grid_16384_taa", 1920, 1080, 16384, GRID_16384_EYE).Temporal(1.0f),
+    BenchmarkSceneBuilder("grid_16384_taau_77", 1920, 1080, 16384, GRID_16384_EYE).Temporal(0.77f),
+    BenchmarkSceneBuilder("grid_16384_taau_50", 1920, 1080, 16384, GRID_16384_EYE).Temporal(0.5f),
+    // A million particles emitted, simulated, sorted & drawn without the host touching one, compare particle_gpu_ms against grid_1024.
+    BenchmarkSceneBuilder("grid_1024_particles_1m", 1280, 720, 1024, GRID_1024_EYE).Particles(1 << 20, 400000.0f),
+    // Thousands of characters animated on worker threads & skinned once, the cascades & the scene pass all draw the skinned vertices,
+    // compare against grid_1024_shadows.
+    BenchmarkSceneBuilder("grid_1024_shadows_skinned_4096", 1280, 720, 1024, GRID_1024_EYE).Shadows(64).Skinned(4096),
+    // Down among the cubes, the nearest rows hide most of the grid: the culled one should match the other's image with a fraction
+    // of its cubes drawn, compare gpu time & occlusion drawn counts between the two.
+    BenchmarkSceneBuilder("grid_16384_street", 1920, 1080, 16384, glm::vec3(0.0f, 2.5f, 100.0f), glm::vec3(0.0f, 1.0f, 0.0f)),
+    BenchmarkSceneBuilder("grid_16384_street_occlusion", 1920, 1080, 16384, glm::vec3(0.0f, 2.5f, 100.0f), glm::vec3(0.0f, 1.0f, 0.0f)).OcclusionCulling(),
+    // A texture per cube, 89 MB of pages over all mips streamed into a 16 MB cache, measured once the streaming settled.
+    // Compare virtual_texture memory_bytes against set_bytes.
+    BenchmarkSceneBuilder("grid_1024_virtual_texture", 1280, 720, 1024, GRID_1024_EYE).VirtualTexture(256),
+    // The grid's faces as one mesh split into meshlets by direction, frustum & normal cone culled in compute before the draw:
+    // about half the triangles face away, compare meshlet visible_triangles against triangles & gpu time against grid_16384.
+    BenchmarkSceneBuilder("grid_16384_meshlets", 1920, 1080, 16384, GRID_16384_EYE).Meshlets(),
+    // The same grid as objects merged by pipeline & mesh into instanced draws, should match grid_16384's image:
+    // compare batching draw_calls against objects & cpu_ms against grid_16384's record time.
+    BenchmarkSceneBuilder("grid_16384_batched", 1920, 1080, 16384, GRID_16384_EYE).Batched(),
+};
+
+// A feature scene & the metrics it is tracked by, the values live in <goldens>/Baselines.txt with the images they were measured with.
+static const BenchmarkBaseline BENCHMARK_BASELINES[] = {
+    // Clustered forward+, light culling & shading of 4096 lights.
+    { "grid_1024_lights_4096",          "phase_ms.gpu" },
+    // Deferred, shading from the packed G-buffer & the attachment traffic it costs.
+    { "grid_1024_lights_4096_deferred", "phase_ms.gpu" },
+    { "grid_1024_lights_4096_deferred", "attachment_bytes.memory" },
+    // Cascaded shadows, the 64 dynamic casters redrawn over the cached static cascades.
+    { "grid_1024_shadows",              "shadow_ms.gpu" },
+    // Compute post-processing, the fused chain.
+    { "grid_1024_post",                 "post_ms.gpu" },
+    // Temporal upscaling from half resolution, the whole frame & the resolve alone.
+    { "grid_16384_taau_50",             "phase_ms.gpu" },
+    { "grid_16384_taau_50",             "temporal.resolve_gpu_ms" },
+    // GPU particles, a million emitted, simulated & sorted in compute.
+    { "grid_1024_particles_1m",         "particles.gpu_ms" },
+    // GPU skinning, the dispatch & the threaded animation blending feeding it.
+    { "grid_1024_shadows_skinned_4096", "skinning.gpu_ms" },
+    { "grid_1024_shadows_skinned_4096", "skinning.animation_cpu_ms" },
+    // Occlusion culling down among the cubes, the whole frame & both culling phases.
+    { "grid_16384_street_occlusion",    "phase_ms.gpu" },
+    { "grid_16384_street_occlusion",    "occlusion.cull_gpu_ms" },
+    // Virtual texturing once settled, the frame & the pages still streamed per frame.
+    { "grid_1024_virtual_texture",      "phase_ms.gpu" },
+    { "grid_1024_virtual_texture",      "virtual_texture.pages_uploaded_per_frame" },
+};
+
+const BenchmarkScene* GetBenchmarkScenes(size_t& count)
+{
+    count = sizeof(BENCHMARK_SCENES) / sizeof(BENCHMARK_SCENES[0]);
+    return BENCHMARK_SCENES;
+}
+
+const BenchmarkBaseline* GetBenchmarkBaselines(size_t& count)
+{
+    count = sizeof(BENCHMARK_BASELINES) / sizeof(BENCHMARK_BASELINES[0]);
+    return BENCHMARK_BASELINES;
+}
+
+__END_NAMESPACE
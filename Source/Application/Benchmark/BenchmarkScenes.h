@@ -0,0 +1,47 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+enum class OffscreenPostProcess : uint32_t;
+
+
+// A canned procedural scene, rendered headless & compared against <goldens>/<m_Name>.png.
+// The feature fields are passed on to OffscreenFrameDesc, which tells the ones that combine.
+typedef struct BenchmarkScene {
+	const char*   m_Name;
+	uint32_t      m_Width;
+	uint32_t      m_Height;
+	uint32_t      m_InstanceCount;
+	uint32_t      m_LightCount;       // Clustered forward+ PBR when non zero, see BuildProceduralLights()
+	uint32_t      m_Samples;
+	glm::vec3     m_Eye;
+	glm::vec3     m_Target;
+	float         m_FieldOfView;      // Vertical, in degrees
+	bool          m_Deferred;
+	bool          m_Shadows;
+	uint32_t      m_DynamicCasters;   // The last instances, shadows redrawn every frame, the others' are cached
+	OffscreenPostProcess m_PostProcess;
+	float         m_TemporalScale;
+	uint32_t      m_ParticleCapacity;
+	float         m_ParticleEmitRate; // Particles per second of the fountain, at 1/60 s per frame
+	uint32_t      m_SkinnedInstances;
+	bool          m_OcclusionCulling;
+	uint32_t      m_VirtualTextureSlots; // Pages of the cache, every cube a texture of its own when non zero
+	bool          m_Meshlets;
+	bool          m_Batched;
+} BenchmarkScene;
+
+const BenchmarkScene* GetBenchmarkScenes(size_t& count);
+
+// A feature's number, recorded next to its scene's golden by --update-goldens & compared against by later runs.
+typedef struct BenchmarkBaseline {
+	const char*   m_Scene;
+	const char*   m_Metric;           // Path in the scene's JSON results, e.g. phase_ms.gpu, lower is better
+} BenchmarkBaseline;
+
+const BenchmarkBaseline* GetBenchmarkBaselines(size_t& count);
+
+
+__END_NAMESPACE
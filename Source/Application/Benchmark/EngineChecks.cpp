@@ -0,0 +1,359 @@
+#include <cstdint> // Necessary for UINT32_MAX
+#include "FrameAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanSceneAttachments.h"
+#include "VulkanClusteredLighting.h"
+#include "VulkanHeadlessDevice.h"
+#include "VulkanPostProcess.h"
+#include "VulkanFrameRing.h"
+#include "VulkanDrawBatcher.h"
+#include "VulkanOffscreenRenderer.h"
+#include "Meshlet.h"
+#include "EngineChecks.h"
+
+
+__BEGIN_NAMESPACE
+
+
+static const uint32_t STEADY_FRAME_WARM_UP = 8;
+static const uint32_t STEADY_FRAME_COUNT = 32;
+static const uint32_t POOL_CHECK_THREADS = 4;
+static const uint32_t POOL_CHECK_BLOCKS_PER_THREAD = 4096;
+
+
+static void ExpectTrue(bool condition, const char* what, EngineCheckResult& result)
+{
+    if (condition) {
+        return;
+    }
+    result.m_Passed = false;
+    result.m_Detail += (result.m_Detail.empty() ? "" : "; ");
+    result.m_Detail += what;
+}
+
+// Flat meshlets facing one way are culled from behind only, a closed one never, a cone of known axis & angle
+// exactly outside of it.
+static void CheckMeshletBackfacing(EngineCheckResult& result)
+{
+    result.m_Name = "check_meshlet_backfacing";
+    result.m_Passed = true;
+
+    // A 4 x 4 grid of quads in the z = 0 plane, counter clockwise seen from +z.
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    for (uint32_t y = 0; y <= 4; y++) {
+        for (uint32_t x = 0; x <= 4; x++) {
+            positions.push_back(glm::vec3((float)x, (float)y, 0.0f));
+        }
+    }
+    for (uint32_t y = 0; y < 4; y++) {
+        for (uint32_t x = 0; x < 4; x++) {
+            uint32_t corner = y * 5 + x;
+            const uint32_t quad[6] = { corner, corner + 1, corner + 6, corner, corner + 6, corner + 5 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+    MeshletMesh plane;
+    if (!BuildMeshlets(positions.data(), positions.size(), indices.data(), indices.size(), plane) || 1 != plane.m_Bounds.size()) {
+        ExpectTrue(false, "plane not built into one meshlet", result);
+        return;
+    }
+    const MeshletBounds& planeBounds = plane.m_Bounds[0];
+    ExpectTrue(glm::dot(glm::vec3(planeBounds.m_ConeAxisCutoff), glm::vec3(0.0f, 0.0f, 1.0f)) > 0.999f, "plane cone axis is not +z", result);
+    ExpectTrue(planeBounds.m_ConeAxisCutoff.w < 0.001f, "plane cone is not flat", result);
+    ExpectTrue(!IsMeshletBackfacing(planeBounds, glm::vec3(2.0f, 2.0f, 5.0f)), "plane culled from the front", result);
+    ExpectTrue(!IsMeshletBackfacing(planeBounds, glm::vec3(-10.0f, 2.0f, 1.0f)), "plane culled from a grazing front angle", result);
+    ExpectTrue(IsMeshletBackfacing(planeBounds, glm::vec3(2.0f, 2.0f, -5.0f)), "plane kept from behind", result);
+    ExpectTrue(IsMeshletBackfacing(planeBounds, glm::vec3(-10.0f, 2.0f, -1.0f)), "plane kept from a grazing back angle", result);
+
+    // A closed cube faces every way, its cone can't cull it from anywhere.
+    const glm::vec3 cubeCorners[8] = {
+        glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(1.0f, 1.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f),
+        glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(1.0f, 0.0f, 1.0f), glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0.0f, 1.0f, 1.0f),
+    };
+    const uint32_t cubeIndices[36] = {
+        0, 3, 2, 0, 2, 1,   4, 5, 6, 4, 6, 7,   0, 1, 5, 0, 5, 4,
+        3, 7, 6, 3, 6, 2,   0, 4, 7, 0, 7, 3,   1, 2, 6, 1, 6, 5,
+    };
+    MeshletMesh cube;
+    if (!BuildMeshlets(cubeCorners, 8, cubeIndices, 36, cube) || 1 != cube.m_Bounds.size()) {
+        ExpectTrue(false, "cube not built into one meshlet", result);
+        return;
+    }
+    ExpectTrue(cube.m_Bounds[0].m_ConeAxisCutoff.w >= 1.0f, "cube cone can cull", result);
+    ExpectTrue(!IsMeshletBackfacing(cube.m_Bounds[0], glm::vec3(0.5f, 0.5f, -5.0f)) && !IsMeshletBackfacing(cube.m_Bounds[0], glm::vec3(0.5f, 5.0f, 0.5f)),
+        "cube culled", result);
+
+    // Normals within 30 degrees of +y: culled from within 60 degrees of -y, kept past it.
+    MeshletBounds cone;
+    cone.m_SphereCenterRadius = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    cone.m_ConeApex = glm::vec4(0.0f);
+    cone.m_ConeAxisCutoff = glm::vec4(0.0f, 1.0f, 0.0f, 0.5f);
+    ExpectTrue(IsMeshletBackfacing(cone, glm::vec3(0.0f, -10.0f, 0.0f)), "cone kept from straight below", result);
+    ExpectTrue(IsMeshletBackfacing(cone, glm::vec3(5.0f, -10.0f, 0.0f)), "cone kept 27 degrees off below", result);
+    ExpectTrue(!IsMeshletBackfacing(cone, glm::vec3(10.0f, -5.0f, 0.0f)), "cone culled 63 degrees off below", result);
+    ExpectTrue(!IsMeshletBackfacing(cone, glm::vec3(0.0f, 10.0f, 0.0f)), "cone culled from above", result);
+}
+
+// Moving an object in depth alone keeps its batch but may change the draw order: the batches are sorted again & the
+// draw list hash follows the order, returning to the same order gives back the same hash.
+static void CheckDrawBatcherDepthResort(VulkanHeadlessDevice* device, EngineCheckResult& result)
+{
+    result.m_Name = "check_draw_batcher_depth_resort";
+    if (nullptr == device) {
+        result.m_Skipped = true;
+        return;
+    }
+    result.m_Passed = true;
+
+    // Every Prepare() starts the ring's frame over, the instances land at the same offset & only the order moves the hash.
+    VulkanFrameRing* frameRing = New<VulkanFrameRing>(MemoryTag::GraphicDriver);
+    VulkanDrawBatcher* batcher = New<VulkanDrawBatcher>(MemoryTag::GraphicDriver);
+    if (!frameRing->Create(device->GetDevice(), device->GetPhysicalDevice(), 1, 64 * 1024) ||
+        !batcher->Create(device->GetDevice(), frameRing, 4)) {
+        ExpectTrue(false, "batcher not created", result);
+        batcher->Destroy();
+        Delete(batcher);
+        frameRing->Destroy();
+        Delete(frameRing);
+        return;
+    }
+    auto prepare = [&]() {
+        frameRing->BeginFrame(0);
+        batcher->Prepare();
+    };
+
+    // Stand in handles, only compared against VK_NULL_HANDLE & hashed, nothing is recorded.
+    batcher->RegisterPipeline(0, (VkPipeline)(uintptr_t)1, (VkPipelineLayout)(uintptr_t)1);
+    for (uint32_t mesh = 0; mesh < 2; mesh++) {
+        batcher->RegisterMesh(mesh, DrawMesh{ (VkBuffer)(uintptr_t)(mesh + 1), (VkBuffer)(uintptr_t)(mesh + 1), VK_INDEX_TYPE_UINT32, 36, 0, 0 });
+    }
+
+    DrawObjectDesc object{};
+    object.m_Instance.m_Transform = glm::mat4(1.0f);
+    object.m_MeshID = 0;
+    object.m_Depth = 0.2f;
+    uint32_t moved = batcher->AddObject(object);
+    object.m_MeshID = 1;
+    object.m_Depth = 0.8f;
+    batcher->AddObject(object);
+
+    prepare();
+    uint64_t nearFirst = batcher->GetDrawListHash();
+    ExpectTrue(2 == batcher->GetStatistics().m_DrawCalls, "two meshes not drawn as two batches", result);
+    prepare();
+    ExpectTrue(nearFirst == batcher->GetDrawListHash(), "hash changed with nothing updated", result);
+    ExpectTrue(0 == batcher->GetStatistics().m_DirtyBatches, "batch rewritten with nothing updated", result);
+
+    batcher->UpdateObject(moved, object.m_Instance, 0.9f);
+    prepare();
+    uint64_t nearLast = batcher->GetDrawListHash();
+    ExpectTrue(nearFirst != nearLast, "hash kept after moving behind the other batch", result);
+    ExpectTrue(1 == batcher->GetStatistics().m_DirtyBatches, "not only the updated batch rewritten", result);
+
+    batcher->UpdateObject(moved, object.m_Instance, 0.85f);
+    prepare();
+    ExpectTrue(nearLast == batcher->GetDrawListHash(), "hash changed moving in depth without changing the order", result);
+
+    batcher->UpdateObject(moved, object.m_Instance, 0.1f);
+    prepare();
+    ExpectTrue(nearFirst == batcher->GetDrawListHash(), "hash differs after moving back in front", result);
+
+    batcher->Destroy();
+    Delete(batcher);
+    frameRing->Destroy();
+    Delete(frameRing);
+}
+
+// A spilled allocation costs one heap block, the next Reset() grows the main block past the peak once & the same
+// frame then fits without touching the heap.
+static void CheckLinearAllocatorGrowth(EngineCheckResult& result)
+{
+    result.m_Name = "check_linear_allocator_growth";
+    result.m_Passed = true;
+
+    LinearAllocator allocator;
+    if (!allocator.Initial(256)) {
+        ExpectTrue(false, "allocator not initialized", result);
+        return;
+    }
+    ExpectTrue(1 == allocator.GetHeapAllocations(), "main block not a single heap allocation", result);
+
+    uint8_t* first = static_cast<uint8_t*>(allocator.Allocate(200));
+    ExpectTrue(nullptr != first && 1 == allocator.GetHeapAllocations(), "allocation within the capacity touched the heap", result);
+    uint8_t* spilled = static_cast<uint8_t*>(allocator.Allocate(200));
+    ExpectTrue(nullptr != spilled && 2 == allocator.GetHeapAllocations(), "overflow not spilled into one heap block", result);
+    ExpectTrue(nullptr != first && nullptr != spilled && (spilled >= first + 200 || spilled + 200 <= first), "overflow overlaps the main block", result);
+    void* aligned = allocator.Allocate(100, 64);
+    ExpectTrue(0 == ((uintptr_t)aligned & 63), "overflow allocation not aligned", result);
+
+    allocator.Reset();
+    ExpectTrue(allocator.GetCapacity() >= 400 && 4 == allocator.GetHeapAllocations(), "main block not grown past the peak on reset", result);
+    ExpectTrue(0 == allocator.GetUsed(), "reset left memory in use", result);
+
+    allocator.Allocate(200);
+    allocator.Allocate(200);
+    allocator.Allocate(100, 64);
+    ExpectTrue(4 == allocator.GetHeapAllocations(), "same frame spilled again after growing", result);
+    allocator.Reset();
+    ExpectTrue(4 == allocator.GetHeapAllocations(), "reset without overflow reallocated", result);
+
+    allocator.CleanUp();
+}
+
+// Threads allocate from one pool at once, then each frees the blocks of another so they cross thread caches:
+// no block handed out twice, none written over while live, and all of them back once the threads are done.
+static void CheckPoolAllocatorThreads(EngineCheckResult& result)
+{
+    result.m_Name = "check_pool_allocator_threads";
+    result.m_Passed = true;
+
+    PoolAllocator pool;
+    if (!pool.Initial(sizeof(uint64_t) * 4, 64, MemoryTag::Pool)) {
+        ExpectTrue(false, "pool not initialized", result);
+        return;
+    }
+
+    std::vector<std::vector<uint64_t*>> blocks(POOL_CHECK_THREADS);
+    std::vector<std::thread> threads;
+    for (uint32_t thread = 0; thread < POOL_CHECK_THREADS; thread++) {
+        threads.emplace_back([&pool, &blocks, thread]() {
+            blocks[thread].reserve(POOL_CHECK_BLOCKS_PER_THREAD);
+            for (uint32_t i = 0; i < POOL_CHECK_BLOCKS_PER_THREAD; i++) {
+                uint64_t* block = static_cast<uint64_t*>(pool.Allocate());
+                if (nullptr == block) {
+                    break;
+                }
+                block[0] = ((uint64_t)thread << 32) | i;
+                blocks[thread].push_back(block);
+                // Giving one back every fourth keeps the thread cache refilling & spilling meanwhile.
+                if (3 == (i & 3)) {
+                    uint64_t* recycled = blocks[thread][blocks[thread].size() - 2];
+                    blocks[thread].erase(blocks[thread].end() - 2);
+                    pool.Free(recycled);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+
+    std::vector<uint64_t*> all;
+    bool allocated = true;
+    bool intact = true;
+    for (uint32_t thread = 0; thread < POOL_CHECK_THREADS; thread++) {
+        allocated = allocated && (POOL_CHECK_BLOCKS_PER_THREAD - POOL_CHECK_BLOCKS_PER_THREAD / 4 == blocks[thread].size());
+        for (uint64_t* block : blocks[thread]) {
+            intact = intact && (thread == (uint32_t)(block[0] >> 32));
+            all.push_back(block);
+        }
+    }
+    ExpectTrue(allocated, "allocation failed", result);
+    ExpectTrue(intact, "live block written by another thread", result);
+    std::sort(all.begin(), all.end());
+    ExpectTrue(all.end() == std::adjacent_find(all.begin(), all.end()), "block handed out twice", result);
+    ExpectTrue(all.size() == pool.GetLiveBlocks(), "live count off after allocating", result);
+
+    for (uint32_t thread = 0; thread < POOL_CHECK_THREADS; thread++) {
+        threads.emplace_back([&pool, &blocks, thread]() {
+            for (uint64_t* block : blocks[(thread + 1) % POOL_CHECK_THREADS]) {
+                pool.Free(block);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    ExpectTrue(0 == pool.GetLiveBlocks(), "blocks still live after freeing", result);
+
+    pool.CleanUp();
+}
+
+// Tagged allocations of every subsystem but the Vulkan implementation's own, untagged std containers aren't seen.
+static size_t GetTrackedAllocations()
+{
+    size_t count = 0;
+    for (uint8_t tag = 0; tag < (uint8_t)MemoryTag::Count; tag++) {
+        if (MemoryTag::Vulkan == (MemoryTag)tag) {
+            continue;
+        }
+        MemoryTagStatistics statistics;
+        GetMemoryStatistics((MemoryTag)tag, statistics);
+        count += statistics.m_TotalAllocations;
+    }
+    return count;
+}
+
+// Once warmed up, frames of a batched scene with particles & a moving camera take their transient data from the
+// frame arena & the frame ring only: no tracked allocation & no growth of the arena.
+static void CheckSteadyFrameAllocations(VulkanHeadlessDevice* device, EngineCheckResult& result)
+{
+    result.m_Name = "check_steady_frame_allocations";
+    if (nullptr == device) {
+        result.m_Skipped = true;
+        return;
+    }
+    result.m_Passed = true;
+
+    SceneAttachmentSettings attachmentSettings;
+    attachmentSettings.m_Samples = 1;
+    attachmentSettings.m_Depth = true;
+    VulkanOffscreenRenderer* renderer = New<VulkanOffscreenRenderer>(MemoryTag::GraphicDriver);
+    if (!renderer->Create(device, 0, attachmentSettings)) {
+        ExpectTrue(false, "renderer not created", result);
+        renderer->Destroy();
+        Delete(renderer);
+        return;
+    }
+
+    // Two views taken in turn, every frame sorts the batches again.
+    OffscreenFrameDesc descs[2];
+    BuildProceduralFrameDesc(256, 256, 1024, glm::vec3(0.0f, 30.0f, 45.0f), glm::vec3(0.0f), 60.0f, descs[0]);
+    BuildProceduralFrameDesc(256, 256, 1024, glm::vec3(45.0f, 30.0f, 0.0f), glm::vec3(0.0f), 60.0f, descs[1]);
+    for (OffscreenFrameDesc& desc : descs) {
+        desc.m_Batched = true;
+        desc.m_ParticleCapacity = 4096;
+        desc.m_ParticleEmitRate = 2048.0f;
+    }
+
+    std::vector<uint8_t> rgba;
+    bool rendered = true;
+    size_t trackedBefore = 0;
+    size_t arenaBefore = 0;
+    for (uint32_t frame = 0; frame < STEADY_FRAME_WARM_UP + STEADY_FRAME_COUNT && rendered; frame++) {
+        if (STEADY_FRAME_WARM_UP == frame) {
+            trackedBefore = GetTrackedAllocations();
+            arenaBefore = FrameArena::GetHeapAllocations();
+        }
+        FrameArena::BeginFrame();
+        rendered = renderer->Render(descs[frame & 1], rgba);
+    }
+    ExpectTrue(rendered, "frame not rendered", result);
+    if (rendered) {
+        ExpectTrue(GetTrackedAllocations() == trackedBefore, "steady frames allocated tracked memory", result);
+        ExpectTrue(FrameArena::GetHeapAllocations() == arenaBefore, "frame arena grew during steady frames", result);
+    }
+
+    renderer->Destroy();
+    Delete(renderer);
+}
+
+void RunEngineChecks(VulkanHeadlessDevice* device, std::vector<EngineCheckResult>& results)
+{
+    results.clear();
+    results.emplace_back();
+    CheckMeshletBackfacing(results.back());
+    results.emplace_back();
+    CheckDrawBatcherDepthResort(device, results.back());
+    results.emplace_back();
+    CheckLinearAllocatorGrowth(results.back());
+    results.emplace_back();
+    CheckPoolAllocatorThreads(results.back());
+    results.emplace_back();
+    CheckSteadyFrameAllocations(device, results.back());
+}
+
+
+__END_NAMESPACE
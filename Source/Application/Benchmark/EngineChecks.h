@@ -0,0 +1,25 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+typedef struct EngineCheckResult {
+	std::string          m_Name;
+	bool                 m_Passed = false;
+	bool                 m_Skipped = false;    // Needs a device & none was created
+	std::string          m_Detail;             // What differed from the expectation, empty when passed
+} EngineCheckResult;
+
+
+/**
+ * Host side checks of engine code the scenes only exercise indirectly, like the CPU reference of a GPU test,
+ * against results worked out by hand. Each check is named check_<what>, run by BenchmarkRunner next to the
+ * queue cases & filtered by --scene alike, most of them need no device.
+ * Those that do get the benchmark's device for their resources & are skipped without one.
+ */
+class VulkanHeadlessDevice;
+void RunEngineChecks(VulkanHeadlessDevice* device, std::vector<EngineCheckResult>& results);
+
+
+__END_NAMESPACE
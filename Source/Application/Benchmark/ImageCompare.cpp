@@ -0,0 +1,68 @@
+#include "ImageCompare.h"
+
+
+__BEGIN_NAMESPACE
+
+// Largest YIQ distance, between black & white.
+static const double YIQ_MAX_DELTA = 35215.0;
+
+static double YiqDelta(const uint8_t* a, const uint8_t* b)
+{
+    double r0 = a[0], g0 = a[1], b0 = a[2];
+    double r1 = b[0], g1 = b[1], b1 = b[2];
+    double y = (r0 - r1) * 0.29889531 + (g0 - g1) * 0.58662247 + (b0 - b1) * 0.11448223;
+    double i = (r0 - r1) * 0.59597799 - (g0 - g1) * 0.27417610 - (b0 - b1) * 0.32180189;
+    double q = (r0 - r1) * 0.21147017 - (g0 - g1) * 0.52261711 + (b0 - b1) * 0.31114694;
+    return 0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q;
+}
+
+bool CompareImages(const uint8_t* expected, const uint8_t* actual, uint32_t width, uint32_t height,
+    const ImageCompareSettings& settings, ImageCompareResult& result, std::vector<uint8_t>* diff)
+{
+    result = ImageCompareResult();
+    if (nullptr == expected || nullptr == actual || 0 == width || 0 == height) {
+        return false;
+    }
+
+    size_t pixelCount = (size_t)width * height;
+    double maxDelta = YIQ_MAX_DELTA * settings.m_Threshold * settings.m_Threshold;
+    double squaredError = 0.0;
+    double largestDelta = 0.0;
+    if (nullptr != diff) {
+        diff->resize(pixelCount * 4);
+    }
+
+    for (size_t i = 0; i < pixelCount; i++) {
+        const uint8_t* a = expected + i * 4;
+        const uint8_t* b = actual + i * 4;
+        for (int c = 0; c < 3; c++) {
+            double error = (double)a[c] - (double)b[c];
+            squaredError += error * error;
+        }
+
+        double delta = YiqDelta(a, b);
+        largestDelta = std::max(largestDelta, delta);
+        bool different = delta > maxDelta;
+        if (different) {
+            result.m_DifferentPixels++;
+        }
+
+        if (nullptr != diff) {
+            uint8_t* d = diff->data() + i * 4;
+            uint8_t faded = (uint8_t)(255 - (255 - (a[0] * 0.299 + a[1] * 0.587 + a[2] * 0.114)) * 0.1);
+            d[0] = different ? 255 : faded;
+            d[1] = different ? 0 : faded;
+            d[2] = different ? 0 : faded;
+            d[3] = 255;
+        }
+    }
+
+    double meanSquaredError = squaredError / (pixelCount * 3.0);
+    result.m_Psnr = (meanSquaredError > 0.0) ? 10.0 * log10(255.0 * 255.0 / meanSquaredError) : 0.0;
+    result.m_MaxDistance = sqrt(largestDelta / YIQ_MAX_DELTA);
+    result.m_DifferentFraction = (double)result.m_DifferentPixels / (double)pixelCount;
+    result.m_Passed = result.m_DifferentFraction <= settings.m_MaxDifferentFraction;
+    return true;
+}
+
+__END_NAMESPACE
@@ -0,0 +1,30 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+typedef struct ImageCompareSettings {
+	double        m_Threshold = 0.1;                 // Per pixel perceptual distance in [0, 1] below which pixels match
+	double        m_MaxDifferentFraction = 0.001;    // Share of pixels allowed over the threshold
+} ImageCompareSettings;
+
+typedef struct ImageCompareResult {
+	uint64_t      m_DifferentPixels = 0;
+	double        m_DifferentFraction = 0.0;
+	double        m_MaxDistance = 0.0;
+	double        m_Psnr = 0.0;                      // Over RGB, infinity reported as 0 for identical images
+	bool          m_Passed = false;
+} ImageCompareResult;
+
+/**
+ * Perceptual comparison of two RGBA images of the same size. Per pixel distance is measured in YIQ with
+ * luma weighted most, like pixelmatch, so small shading changes from driver rounding or rasterization
+ * rules pass while a missing object doesn't. diff, when given, receives a faded copy of the expected
+ * image with differing pixels in red.
+ */
+bool CompareImages(const uint8_t* expected, const uint8_t* actual, uint32_t width, uint32_t height,
+	const ImageCompareSettings& settings, ImageCompareResult& result, std::vector<uint8_t>* diff = nullptr);
+
+
+__END_NAMESPACE
@@ -0,0 +1,12 @@
+#include "ImageCompare.h"
+#include "QueueBenchmark.h"
+#include "ProfilerBenchmark.h"
+#include "EngineChecks.h"
+#include "BenchmarkRunner.h"
+
+
+int main(int argc, char** argv)
+{
+    __NAMESPACE::BenchmarkRunner runner;
+    return runner.Run(argc, argv) ? 0 : 1;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+static const double PROFILER_ZONE_BUDGET_NANOSECONDS = 20.0;   // Begin & end of one zone
+
+typedef struct ProfilerBenchmarkResult {
+	std::string          m_Name;
+	bool                 m_Capturing = false;
+	uint64_t             m_Zones = 0;             // 0 when nothing was measured
+	double               m_NanosecondsPerZone = 0.0;   // Best of the runs, loop overhead included
+	bool                 m_WithinBudget = false;
+} ProfilerBenchmarkResult;
+
+
+// profiler_zone_idle or profiler_zone_capturing
+std::string GetProfilerBenchmarkName(bool capturing);
+
+// Opens & closes empty zones back to back on this thread, with a capture running or not. A capture already
+// running is left alone, otherwise one is begun for the capturing case & cancelled after it. Zones compile away
+// in RELEASE, there's nothing to measure.
+void RunProfilerBenchmark(bool capturing, uint64_t zones, ProfilerBenchmarkResult& result);
+
+
+__END_NAMESPACE
@@ -0,0 +1,156 @@
+#include "MPSCQueue.h"
+#include "QueueBenchmark.h"
+
+
+__BEGIN_NAMESPACE
+
+
+// Same capacity as the driver's render requests, so full queues are hit as often as they would be there.
+static const size_t QUEUE_BENCHMARK_CAPACITY = 4096;
+static const uint32_t QUEUE_BENCHMARK_PRODUCER_SHIFT = 48;    // Item = producer << shift | sequence
+
+static const char* GetQueueBenchmarkKindName(QueueBenchmarkKind kind)
+{
+    switch (kind) {
+    case QueueBenchmarkKind::LockFree: return "lockfree";
+    case QueueBenchmarkKind::Mutex: return "mutex";
+    default: return "unknown";
+    }
+}
+
+
+// The straightforward alternative, bounded like MPSCQueue.
+template <typename T, size_t Capacity>
+class MutexQueue
+{
+public:
+    template <typename U>
+    bool TryPush(U&& value)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Values.size() >= Capacity) {
+            return false;
+        }
+        m_Values.push_back(std::forward<U>(value));
+        return true;
+    }
+
+    bool TryPop(T& value)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (m_Values.empty()) {
+            return false;
+        }
+        value = std::move(m_Values.front());
+        m_Values.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex      m_Mutex;
+    std::deque<T>   m_Values;
+};
+
+
+template <typename Queue>
+static void MeasureQueue(Queue& queue, uint32_t producers, uint64_t itemsPerProducer, QueueBenchmarkResult& result)
+{
+    std::atomic<uint32_t> ready(0);
+    std::atomic<bool> start(false);
+    std::atomic<uint64_t> fullRetries(0);
+
+    std::vector<std::thread> threads;
+    threads.reserve(producers);
+    for (uint32_t producer = 0; producer < producers; producer++) {
+        threads.emplace_back([&, producer]() {
+            ready.fetch_add(1);
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            uint64_t retries = 0;
+            for (uint64_t sequence = 0; sequence < itemsPerProducer; sequence++) {
+                uint64_t item = ((uint64_t)producer << QUEUE_BENCHMARK_PRODUCER_SHIFT) | sequence;
+                while (!queue.TryPush(item)) {
+                    retries++;
+                    std::this_thread::yield();
+                }
+            }
+            fullRetries.fetch_add(retries);
+        });
+    }
+    while (ready.load() < producers) {
+        std::this_thread::yield();
+    }
+
+    std::vector<uint64_t> expected(producers, 0);
+    bool inOrder = true;
+    uint64_t total = itemsPerProducer * producers;
+    uint64_t received = 0;
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    uint64_t item = 0;
+    while (received < total) {
+        if (!queue.TryPop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        uint32_t producer = (uint32_t)(item >> QUEUE_BENCHMARK_PRODUCER_SHIFT);
+        uint64_t sequence = item & (((uint64_t)1 << QUEUE_BENCHMARK_PRODUCER_SHIFT) - 1);
+        if (producer >= producers || sequence != expected[producer]) {
+            inOrder = false;
+        } else {
+            expected[producer]++;
+        }
+        received++;
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    result.m_Items = total;
+    result.m_Ms = ms;
+    result.m_MillionItemsPerSecond = ms > 0.0 ? (double)total / (ms * 1000.0) : 0.0;
+    result.m_FullRetries = fullRetries.load();
+    result.m_Valid = inOrder && !queue.TryPop(item);
+}
+
+
+std::vector<uint32_t> GetQueueBenchmarkProducerCounts()
+{
+    uint32_t maxProducers = std::max(1u, std::thread::hardware_concurrency() - 1);
+    std::vector<uint32_t> counts;
+    for (uint32_t producers = 1; producers < maxProducers; producers *= 2) {
+        counts.push_back(producers);
+    }
+    counts.push_back(maxProducers);
+    return counts;
+}
+
+std::string GetQueueBenchmarkName(QueueBenchmarkKind kind, uint32_t producers)
+{
+    return std::string("queue_") + GetQueueBenchmarkKindName(kind) + "_" + std::to_string(producers);
+}
+
+void RunQueueBenchmark(QueueBenchmarkKind kind, uint32_t producers, uint64_t itemsPerProducer, QueueBenchmarkResult& result)
+{
+    PROFILE_ZONE("RunQueueBenchmark");
+    result.m_Kind = kind;
+    result.m_Producers = producers;
+    result.m_Name = GetQueueBenchmarkName(kind, producers);
+
+    // Too big for the stack, MPSCQueue keeps its cells inline.
+    if (QueueBenchmarkKind::LockFree == kind) {
+        MPSCQueue<uint64_t, QUEUE_BENCHMARK_CAPACITY>* queue = New<MPSCQueue<uint64_t, QUEUE_BENCHMARK_CAPACITY>>(MemoryTag::Container);
+        MeasureQueue(*queue, producers, itemsPerProducer, result);
+        Delete(queue);
+    } else {
+        MutexQueue<uint64_t, QUEUE_BENCHMARK_CAPACITY>* queue = New<MutexQueue<uint64_t, QUEUE_BENCHMARK_CAPACITY>>(MemoryTag::Container);
+        MeasureQueue(*queue, producers, itemsPerProducer, result);
+        Delete(queue);
+    }
+}
+
+__END_NAMESPACE
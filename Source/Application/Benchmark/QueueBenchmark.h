@@ -0,0 +1,37 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+enum class QueueBenchmarkKind
+{
+	LockFree = 0,     // MPSCQueue, what VulkanGraphicDriver::PostRenderRequest() uses
+	Mutex,            // std::deque behind a std::mutex, the baseline
+
+	Count,
+};
+
+typedef struct QueueBenchmarkResult {
+	std::string          m_Name;
+	QueueBenchmarkKind   m_Kind = QueueBenchmarkKind::LockFree;
+	uint32_t             m_Producers = 1;
+	uint64_t             m_Items = 0;          // Over all producers
+	double               m_Ms = 0.0;
+	double               m_MillionItemsPerSecond = 0.0;
+	uint64_t             m_FullRetries = 0;    // Pushes that found the queue full
+	bool                 m_Valid = false;      // Every item arrived once & in order per producer
+} QueueBenchmarkResult;
+
+
+// Producer counts to measure under contention: 1, 2, 4 ... up to the hardware threads left besides the consumer.
+std::vector<uint32_t> GetQueueBenchmarkProducerCounts();
+
+// e.g. queue_lockfree_4
+std::string GetQueueBenchmarkName(QueueBenchmarkKind kind, uint32_t producers);
+
+// Producers push itemsPerProducer values as fast as they can while one consumer drains them.
+void RunQueueBenchmark(QueueBenchmarkKind kind, uint32_t producers, uint64_t itemsPerProducer, QueueBenchmarkResult& result);
+
+
+__END_NAMESPACE
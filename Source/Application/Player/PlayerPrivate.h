@@ -3,6 +3,9 @@
 
 #include "CrossPlatform.h"
 #include "Platform.h"
+#include "StandardCXX.h"
+#include "Memory.h"
+#include "Profiler.h"
 
 
 #define GLFW_INCLUDE_VULKAN
@@ -16,6 +19,7 @@
 
 #include <iostream>
 #include <vector>
+#include <functional>
 #include <string>
 #include <set>
 #include <fstream>
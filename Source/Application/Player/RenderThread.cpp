@@ -0,0 +1,145 @@
+#include "FrameAllocator.h"
+#include "ImageEncoder.h"
+#include "SnapshotQueue.h"
+#include "MPSCQueue.h"
+#include "VulkanDeviceCapabilities.h"
+#include "VulkanUtility.h"
+#include "VulkanSceneAttachments.h"
+#include "VulkanReadback.h"
+#include "VulkanGraphicDriver.h"
+#include "RenderThread.h"
+
+
+__BEGIN_NAMESPACE
+
+// Runs on the render thread frames after the request, encoding there costs one hitch but never blocks on the GPU.
+static void SaveScreenshot(const ReadbackResult& result)
+{
+    std::vector<uint8_t> rgba(result.m_Data, result.m_Data + result.m_Size);
+    if (VK_FORMAT_B8G8R8A8_SRGB == result.m_Format || VK_FORMAT_B8G8R8A8_UNORM == result.m_Format) {
+        for (size_t i = 0; i + 3 < rgba.size(); i += 4) {
+            std::swap(rgba[i], rgba[i + 2]);
+        }
+    }
+
+    std::vector<uint8_t> png;
+    std::string path = "Screenshot_" + std::to_string(result.m_FrameIndex) + ".png";
+    std::ofstream file(path, std::ios::binary);
+    if (!EncodePNG(rgba.data(), result.m_Width, result.m_Height, png) || !file.write((const char*)png.data(), png.size())) {
+        std::cout << "Failed to save " << path << ".\n";
+        return;
+    }
+    std::cout << "Saved " << path << ", " << result.m_LatencyFrames << " frames after capture.\n";
+}
+
+RenderThread::RenderThread() :
+    m_GraphicDriver(nullptr),
+    m_NextFrameIndex(0),
+    m_RenderedFrames(0),
+    m_LastLatency(0.0)
+{
+}
+
+RenderThread::~RenderThread()
+{
+    Stop();
+}
+
+bool RenderThread::Start(VulkanGraphicDriver* graphicDriver)
+{
+    if (m_Thread.joinable()) {
+        return false;
+    }
+
+    m_GraphicDriver = graphicDriver;
+    m_Settings = RenderSettings();
+    m_Queue.Reset();
+    m_Thread = std::thread(&RenderThread::Run, this);
+    return true;
+}
+
+void RenderThread::Stop()
+{
+    if (!m_Thread.joinable()) {
+        return;
+    }
+
+    // Queued snapshots are still rendered before the thread exits.
+    m_Queue.Close();
+    m_Thread.join();
+}
+
+RenderFrameSnapshot* RenderThread::BeginFrame()
+{
+    PROFILE_ZONE("WaitForRenderThread");
+    RenderFrameSnapshot* snapshot = m_Queue.BeginWrite();
+    if (nullptr == snapshot) {
+        return nullptr;
+    }
+
+    snapshot->m_FrameIndex = m_NextFrameIndex++;
+    snapshot->m_InputTime = 0.0;
+    snapshot->m_Resized = false;
+    snapshot->m_Screenshot = false;
+    return snapshot;
+}
+
+void RenderThread::EndFrame()
+{
+    m_Queue.EndWrite();
+}
+
+void RenderThread::Run()
+{
+    PROFILE_THREAD_NAME("Render");
+
+    while (RenderFrameSnapshot* snapshot = m_Queue.BeginRead()) {
+        PROFILE_ZONE("RenderFrame");
+        FrameArena::BeginFrame();
+
+        if (snapshot->m_Resized) {
+            m_GraphicDriver->ResizeWindow(snapshot->m_ResizeInfo);
+        }
+        ApplySettings(snapshot->m_Settings);
+        if (snapshot->m_Screenshot) {
+            m_GraphicDriver->RequestCapture(SaveScreenshot);
+        }
+        m_GraphicDriver->SetFrameInputTime(snapshot->m_InputTime);
+        m_GraphicDriver->DrawFrame();
+
+        double latency = (glfwGetTime() - snapshot->m_InputTime) * 1000.0;
+        m_LastLatency.store(latency, std::memory_order_relaxed);
+        m_RenderedFrames.fetch_add(1, std::memory_order_relaxed);
+        PROFILE_COUNTER("InputLatencyMs", latency);
+
+        m_Queue.EndRead();
+    }
+}
+
+void RenderThread::ApplySettings(const RenderSettings& settings)
+{
+    if (settings.m_ParticleCapacity != m_Settings.m_ParticleCapacity) {
+        m_GraphicDriver->SetParticleCapacity(settings.m_ParticleCapacity);
+    }
+    if (settings.m_TemporalUpscaling != m_Settings.m_TemporalUpscaling) {
+        m_GraphicDriver->SetTemporalUpscaling(settings.m_TemporalUpscaling);
+    }
+    if (settings.m_DynamicResolution != m_Settings.m_DynamicResolution) {
+        m_GraphicDriver->SetDynamicResolution(settings.m_DynamicResolution);
+    }
+    if (settings.m_ContinuousCapture != m_Settings.m_ContinuousCapture) {
+        // Only measures the download, the pixels aren't used.
+        m_GraphicDriver->SetContinuousCapture(settings.m_ContinuousCapture ? [](const ReadbackResult&) {} : std::function<void(const ReadbackResult&)>());
+    }
+    if (settings.m_MsaaSamples != m_Settings.m_MsaaSamples) {
+        SceneAttachmentSettings attachmentSettings = m_GraphicDriver->GetSceneAttachments()->GetSettings();
+        attachmentSettings.m_Samples = settings.m_MsaaSamples;
+        m_GraphicDriver->SetSceneAttachmentSettings(attachmentSettings);
+    }
+    if (settings.m_PresentModePolicy != m_Settings.m_PresentModePolicy) {
+        m_GraphicDriver->SetPresentModePolicy(settings.m_PresentModePolicy);
+    }
+    m_Settings = settings;
+}
+
+__END_NAMESPACE
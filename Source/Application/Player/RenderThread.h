@@ -0,0 +1,64 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+class VulkanGraphicDriver;
+
+// Main thread runs at most RENDER_SNAPSHOT_COUNT - 1 frames ahead of the render thread.
+static const size_t RENDER_SNAPSHOT_COUNT = 2;
+
+// Renderer state the main thread wants, defaults match the driver's. Only what changed is passed on to the driver.
+typedef struct RenderSettings {
+	uint32_t                    m_ParticleCapacity = 0;     // 0 turns the fountain off
+	bool                        m_TemporalUpscaling = false;
+	bool                        m_DynamicResolution = true;
+	bool                        m_ContinuousCapture = false;
+	uint32_t                    m_MsaaSamples = 4;
+	PresentModePolicy           m_PresentModePolicy = PresentModePolicy::LowLatency;
+} RenderSettings;
+
+// Everything the render thread needs for one frame, built by the main thread. Plain values, nothing is allocated per frame.
+typedef struct RenderFrameSnapshot {
+	uint64_t                    m_FrameIndex = 0;
+	double                      m_InputTime = 0.0;     // glfwGetTime() right after polling events
+	bool                        m_Resized = false;
+	GraphicResizeInfo           m_ResizeInfo = {};
+	RenderSettings              m_Settings;
+	bool                        m_Screenshot = false;  // Saves the frame as a PNG once it's read back
+} RenderFrameSnapshot;
+
+
+class RenderThread
+{
+public:
+	RenderThread();
+	virtual ~RenderThread();
+
+	bool Start(VulkanGraphicDriver* graphicDriver);
+	void Stop();
+
+	// Main thread: blocks while the render thread is a full queue behind.
+	RenderFrameSnapshot* BeginFrame();
+	void EndFrame();
+
+	uint64_t GetRenderedFrames() const { return m_RenderedFrames.load(std::memory_order_relaxed); }
+	// Input poll to queue submit of the last rendered frame, in milliseconds.
+	double GetLastLatency() const { return m_LastLatency.load(std::memory_order_relaxed); }
+
+private:
+	void Run();
+	void ApplySettings(const RenderSettings& settings);
+
+	VulkanGraphicDriver*                                            m_GraphicDriver;
+	RenderSettings                                                  m_Settings;         // Last applied, render thread only
+	std::thread                                                     m_Thread;
+	SnapshotQueue<RenderFrameSnapshot, RENDER_SNAPSHOT_COUNT>       m_Queue;
+	uint64_t                                                        m_NextFrameIndex;
+	std::atomic<uint64_t>                                           m_RenderedFrames;
+	std::atomic<double>                                             m_LastLatency;
+};
+
+
+__END_NAMESPACE
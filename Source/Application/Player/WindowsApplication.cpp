@@ -1,5 +1,15 @@
 #include <cstdint> // Necessary for UINT32_MAX
+#include "Memory.h"
+#include "FrameAllocator.h"
+#include "Profiler.h"
+#include "FramePacer.h"
+#include "SnapshotQueue.h"
+#include "MPSCQueue.h"
+#include "VulkanDeviceCapabilities.h"
+#include "VulkanUtility.h"
+#include "VulkanSceneAttachments.h"
 #include "VulkanGraphicDriver.h"
+#include "RenderThread.h"
 #include "WindowsApplication.h"
 
 
@@ -8,6 +18,20 @@ __BEGIN_NAMESPACE
 
 static const uint32_t WIDTH = 1024;
 static const uint32_t HEIGHT = 768;
+static const size_t FRAME_ARENA_BYTES_PER_THREAD = 1024 * 1024;
+// F10 cycles through these, 0 is uncapped.
+static const double FRAME_RATE_LIMITS[] = { 0.0, 30.0, 60.0, 120.0, 144.0 };
+static const size_t FRAME_RATE_LIMIT_COUNT = sizeof(FRAME_RATE_LIMITS) / sizeof(FRAME_RATE_LIMITS[0]);
+// F8 cycles through these, the driver clamps to what the device supports.
+static const uint32_t MSAA_SAMPLE_COUNTS[] = { 4, 8, 1, 2 };
+static const size_t MSAA_SAMPLE_COUNT_COUNT = sizeof(MSAA_SAMPLE_COUNTS) / sizeof(MSAA_SAMPLE_COUNTS[0]);
+// F4 toggles a fountain of this many GPU particles.
+static const uint32_t PARTICLE_CAPACITY = 1 << 20;
+
+#if PROFILER_ENABLED
+static const size_t PROFILE_EVENTS_PER_THREAD = 256 * 1024;
+static const char* PROFILE_CAPTURE_PATH = "KaleidoscopeProfile.json";
+#endif
 
 
 WindowsApplication::WindowsApplication() :
@@ -15,7 +39,17 @@ WindowsApplication::WindowsApplication() :
     m_GraphicDriver(nullptr),
     m_WindowResized(false),
     m_CurrentWidth(-1),
-    m_CurrentHeight(-1)
+    m_CurrentHeight(-1),
+    m_RenderThread(nullptr),
+    m_FramePacer(nullptr),
+    m_FrameRateLimitIndex(0),
+    m_PresentModePolicy(PresentModePolicy::LowLatency),
+    m_MsaaSampleCountIndex(0),
+    m_ContinuousCapture(false),
+    m_TemporalUpscaling(false),
+    m_DynamicResolution(true),
+    m_Particles(false),
+    m_Screenshot(false)
 {
 }
 
@@ -41,7 +75,13 @@ void WindowsApplication::Run()
 
 bool WindowsApplication::Initial()
 {
-    m_GraphicDriver = new VulkanGraphicDriver();
+    FrameArena::Initial(FRAME_ARENA_BYTES_PER_THREAD);
+#if PROFILER_ENABLED
+    Profiler::Initial(PROFILE_EVENTS_PER_THREAD);
+#endif
+    PROFILE_THREAD_NAME("Main");
+
+    m_GraphicDriver = New<VulkanGraphicDriver>(MemoryTag::GraphicDriver);
     if (!m_GraphicDriver->Initial()) {
         return false;
     }
@@ -73,31 +113,149 @@ bool WindowsApplication::StartUp()
         return false;
     }
 
+    // Window & surface are created on this thread, everything after goes through the render thread.
+    m_FramePacer = New<FramePacer>(MemoryTag::Application);
+    m_FramePacer->SetTargetFrameRate(FRAME_RATE_LIMITS[m_FrameRateLimitIndex]);
+
+    m_RenderThread = New<RenderThread>(MemoryTag::Application);
+    if (!m_RenderThread->Start(m_GraphicDriver)) {
+        return false;
+    }
+
     return true;
 }
 
 
 bool WindowsApplication::MainLoop()
 {
+    bool presentPolicyKeyDown = false;
+    bool frameRateKeyDown = false;
+    bool msaaKeyDown = false;
+    bool screenshotKeyDown = false;
+    bool continuousCaptureKeyDown = false;
+    bool temporalKeyDown = false;
+    bool dynamicResolutionKeyDown = false;
+    bool particleKeyDown = false;
+#if PROFILER_ENABLED
+    bool captureKeyDown = false;
+#endif
     while (!glfwWindowShouldClose(m_MainWindow)) {
-        glfwPollEvents();
+        PROFILE_FRAME_MARK();
+        FrameArena::BeginFrame();
+
+        // Wait for a free snapshot before polling, so the input it carries is as fresh as possible.
+        RenderFrameSnapshot* snapshot = m_RenderThread->BeginFrame();
+        if (nullptr == snapshot) {
+            break;
+        }
+
+        // The cap delays input sampling rather than presentation, so the frame is shown right after it's built.
+        m_FramePacer->Wait();
+
+        {
+            PROFILE_ZONE("PollEvents");
+            glfwPollEvents();
+        }
+        snapshot->m_InputTime = glfwGetTime();
+
+        // F3 toggles dynamic resolution, F4 the GPU particle fountain.
+        bool dynamicResolutionKeyPressed = (GLFW_PRESS == glfwGetKey(m_MainWindow, GLFW_KEY_F3));
+        if (dynamicResolutionKeyPressed && !dynamicResolutionKeyDown) {
+            m_DynamicResolution = !m_DynamicResolution;
+            std::cout << "Dynamic resolution " << (m_DynamicResolution ? "on" : "off") << "\n";
+        }
+        dynamicResolutionKeyDown = dynamicResolutionKeyPressed;
+
+        bool particleKeyPressed = (GLFW_PRESS == glfwGetKey(m_MainWindow, GLFW_KEY_F4));
+        if (particleKeyPressed && !particleKeyDown) {
+            m_Particles = !m_Particles;
+            std::cout << "Particles " << (m_Particles ? "on" : "off") << "\n";
+        }
+        particleKeyDown = particleKeyPressed;
+
+        // F5 toggles the temporal resolve of the dynamic resolution scene.
+        bool temporalKeyPressed = (GLFW_PRESS == glfwGetKey(m_MainWindow, GLFW_KEY_F5));
+        if (temporalKeyPressed && !temporalKeyDown) {
+            m_TemporalUpscaling = !m_TemporalUpscaling;
+            std::cout << "Temporal upscaling " << (m_TemporalUpscaling ? "on" : "off") << "\n";
+        }
+        temporalKeyDown = temporalKeyPressed;
+
+        // F6 toggles reading back every frame, F7 saves a screenshot.
+        bool continuousCaptureKeyPressed = (GLFW_PRESS == glfwGetKey(m_MainWindow, GLFW_KEY_F6));
+        if (continuousCaptureKeyPressed && !continuousCaptureKeyDown) {
+            m_ContinuousCapture = !m_ContinuousCapture;
+            std::cout << "Continuous capture " << (m_ContinuousCapture ? "on" : "off") << "\n";
+        }
+        continuousCaptureKeyDown = continuousCaptureKeyPressed;
+
+        bool screenshotKeyPressed = (GLFW_PRESS == glfwGetKey(m_MainWindow, GLFW_KEY_F7));
+        if (screenshotKeyPressed && !screenshotKeyDown) {
+            m_Screenshot = true;
+        }
+        screenshotKeyDown = screenshotKeyPressed;
+
+        // F8 cycles the MSAA sample count, F9 the present mode policy, F10 the frame rate limit.
+        bool msaaKeyPressed = (GLFW_PRESS == glfwGetKey(m_MainWindow, GLFW_KEY_F8));
+        if (msaaKeyPressed && !msaaKeyDown) {
+            m_MsaaSampleCountIndex = (m_MsaaSampleCountIndex + 1) % MSAA_SAMPLE_COUNT_COUNT;
+        }
+        msaaKeyDown = msaaKeyPressed;
+
+        bool presentPolicyKeyPressed = (GLFW_PRESS == glfwGetKey(m_MainWindow, GLFW_KEY_F9));
+        if (presentPolicyKeyPressed && !presentPolicyKeyDown) {
+            m_PresentModePolicy = (PresentModePolicy)(((int)m_PresentModePolicy + 1) % (int)PresentModePolicy::Count);
+        }
+        presentPolicyKeyDown = presentPolicyKeyPressed;
+
+        bool frameRateKeyPressed = (GLFW_PRESS == glfwGetKey(m_MainWindow, GLFW_KEY_F10));
+        if (frameRateKeyPressed && !frameRateKeyDown) {
+            m_FrameRateLimitIndex = (m_FrameRateLimitIndex + 1) % FRAME_RATE_LIMIT_COUNT;
+            m_FramePacer->SetTargetFrameRate(FRAME_RATE_LIMITS[m_FrameRateLimitIndex]);
+            std::cout << "Frame rate limit: " << FRAME_RATE_LIMITS[m_FrameRateLimitIndex] << " (0 = uncapped)\n";
+        }
+        frameRateKeyDown = frameRateKeyPressed;
+
+#if PROFILER_ENABLED
+        // F11 starts/stops a trace capture.
+        bool captureKeyPressed = (GLFW_PRESS == glfwGetKey(m_MainWindow, GLFW_KEY_F11));
+        if (captureKeyPressed && !captureKeyDown) {
+            if (Profiler::IsCapturing()) {
+                Profiler::EndCapture(PROFILE_CAPTURE_PATH);
+            } else {
+                Profiler::BeginCapture();
+            }
+        }
+        captureKeyDown = captureKeyPressed;
+#endif
 
         if (m_WindowResized) {
-            ResizeWindow();
+            ResizeWindow(*snapshot);
             m_WindowResized = false;
-        } else {
-            DrawFrame();
         }
+        DrawFrame(*snapshot);
+
+        m_RenderThread->EndFrame();
     }    
     return true;
 }
 
-void WindowsApplication::DrawFrame()
+void WindowsApplication::DrawFrame(RenderFrameSnapshot& snapshot)
 {
-    m_GraphicDriver->DrawFrame();
+    // The whole state goes in every frame, the render thread passes on what changed.
+    RenderSettings& settings = snapshot.m_Settings;
+    settings.m_ParticleCapacity = m_Particles ? PARTICLE_CAPACITY : 0;
+    settings.m_TemporalUpscaling = m_TemporalUpscaling;
+    settings.m_DynamicResolution = m_DynamicResolution;
+    settings.m_ContinuousCapture = m_ContinuousCapture;
+    settings.m_MsaaSamples = MSAA_SAMPLE_COUNTS[m_MsaaSampleCountIndex];
+    settings.m_PresentModePolicy = m_PresentModePolicy;
+
+    snapshot.m_Screenshot = m_Screenshot;
+    m_Screenshot = false;
 }
 
-void WindowsApplication::ResizeWindow()
+void WindowsApplication::ResizeWindow(RenderFrameSnapshot& snapshot)
 {
     GraphicResizeInfo graphicResizeInfo;
     graphicResizeInfo.m_OldWidth = m_CurrentWidth;
@@ -110,11 +268,21 @@ void WindowsApplication::ResizeWindow()
     m_CurrentWidth = width;
     m_CurrentHeight = height;
 
-    m_GraphicDriver->ResizeWindow(graphicResizeInfo);
+    snapshot.m_Resized = true;
+    snapshot.m_ResizeInfo = graphicResizeInfo;
 }
 
 bool WindowsApplication::ShutDown()
 {
+    if (nullptr != m_RenderThread) {
+        m_RenderThread->Stop();
+        Delete(m_RenderThread);
+        m_RenderThread = nullptr;
+    }
+
+    Delete(m_FramePacer);
+    m_FramePacer = nullptr;
+
     m_GraphicDriver->ShutDown();
 
     glfwDestroyWindow(m_MainWindow);
@@ -126,8 +294,23 @@ bool WindowsApplication::ShutDown()
 
 void WindowsApplication::CleanUp()
 {
-    m_GraphicDriver->CleanUp();
-    m_GraphicDriver = nullptr;
+    if (nullptr != m_GraphicDriver) {
+        m_GraphicDriver->CleanUp();
+        Delete(m_GraphicDriver);
+        m_GraphicDriver = nullptr;
+    }
+
+    FrameArena::CleanUp();
+
+#if PROFILER_ENABLED
+    if (Profiler::IsCapturing()) {
+        Profiler::EndCapture(PROFILE_CAPTURE_PATH);
+    }
+    Profiler::CleanUp();
+#endif
+
+    ReportMemory();
+    ReportMemoryLeaks();
 }
 
 
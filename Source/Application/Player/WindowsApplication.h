@@ -8,6 +8,10 @@ __BEGIN_NAMESPACE
 
 
 class VulkanGraphicDriver;
+class RenderThread;
+class FramePacer;
+enum class PresentModePolicy;
+struct RenderFrameSnapshot;
 
 
 class WindowsApplication
@@ -24,8 +28,8 @@ private:
 	virtual bool Initial();
 	virtual bool StartUp();
 	virtual bool MainLoop();
-	virtual void DrawFrame();
-	virtual void ResizeWindow();
+	virtual void DrawFrame(RenderFrameSnapshot& snapshot);
+	virtual void ResizeWindow(RenderFrameSnapshot& snapshot);
 	virtual bool ShutDown();
 	virtual void CleanUp();
 
@@ -42,6 +46,16 @@ private:
 	 *  Vulkan
 	 */
 	VulkanGraphicDriver*      m_GraphicDriver;
+	RenderThread*             m_RenderThread;
+	FramePacer*               m_FramePacer;
+	size_t                    m_FrameRateLimitIndex;
+	PresentModePolicy         m_PresentModePolicy;
+	size_t                    m_MsaaSampleCountIndex;
+	bool                      m_ContinuousCapture;
+	bool                      m_TemporalUpscaling;
+	bool                      m_DynamicResolution;
+	bool                      m_Particles;
+	bool                      m_Screenshot;             // F7 was pressed since the last snapshot
 };
 
 
@@ -1,6 +1,9 @@
+#include "RenderJob.h"
+#include "RenderServer.h"
 
 
-int main()
+int main(int argc, char** argv)
 {
-	return 0;
-}
\ No newline at end of file
+    __NAMESPACE::RenderServer server;
+    return server.Run(argc, argv) ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+#include "VulkanUtility.h"
+#include "VulkanOffscreenRenderer.h"
+#include "RenderJob.h"
+
+
+__BEGIN_NAMESPACE
+
+static const uint32_t RENDER_JOB_MAX_DIMENSION = 8192;
+static const uint32_t RENDER_JOB_MAX_COUNT = 1024 * 1024;
+
+static bool ParseUnsigned(const std::string& value, uint32_t minValue, uint32_t maxValue, uint32_t& result)
+{
+    char* end = nullptr;
+    unsigned long parsed = strtoul(value.c_str(), &end, 10);
+    if (value.empty() || *end != '\0' || parsed < minValue || parsed > maxValue) {
+        return false;
+    }
+    result = (uint32_t)parsed;
+    return true;
+}
+
+static bool ParseVec3(const std::string& value, glm::vec3& result)
+{
+    float x, y, z;
+    char trailing;
+    if (3 != sscanf(value.c_str(), "%f,%f,%f%c", &x, &y, &z, &trailing)) {
+        return false;
+    }
+    result = glm::vec3(x, y, z);
+    return true;
+}
+
+bool ParseRenderJob(const std::string& arguments, RenderJob& job, std::string& error)
+{
+    std::istringstream stream(arguments);
+    std::string token;
+    while (stream >> token) {
+        size_t separator = token.find('=');
+        if (std::string::npos == separator) {
+            error = "expected key=value, got " + token;
+            return false;
+        }
+        std::string key = token.substr(0, separator);
+        std::string value = token.substr(separator + 1);
+
+        bool valid = true;
+        if ("id" == key) {
+            char* end = nullptr;
+            job.m_ID = strtoull(value.c_str(), &end, 10);
+            valid = !value.empty() && *end == '\0';
+        } else if ("scene" == key) {
+            job.m_Scene = value;
+            valid = ("grid" == value || "cube" == value);
+        } else if ("count" == key) {
+            valid = ParseUnsigned(value, 1, RENDER_JOB_MAX_COUNT, job.m_Count);
+        } else if ("width" == key) {
+            valid = ParseUnsigned(value, 1, RENDER_JOB_MAX_DIMENSION, job.m_Width);
+        } else if ("height" == key) {
+            valid = ParseUnsigned(value, 1, RENDER_JOB_MAX_DIMENSION, job.m_Height);
+        } else if ("eye" == key) {
+            valid = ParseVec3(value, job.m_Eye);
+        } else if ("target" == key) {
+            valid = ParseVec3(value, job.m_Target);
+        } else if ("fov" == key) {
+            job.m_FieldOfView = (float)atof(value.c_str());
+            valid = job.m_FieldOfView > 1.0f && job.m_FieldOfView < 179.0f;
+        } else if ("output" == key) {
+            job.m_Output = value;
+        } else {
+            valid = false;
+        }
+
+        if (!valid) {
+            error = "invalid " + token;
+            return false;
+        }
+    }
+    return true;
+}
+
+void BuildFrameDesc(const RenderJob& job, OffscreenFrameDesc& desc)
+{
+    uint32_t count = ("cube" == job.m_Scene) ? 1 : job.m_Count;
+    BuildProceduralFrameDesc(job.m_Width, job.m_Height, count, job.m_Eye, job.m_Target, job.m_FieldOfView, desc);
+}
+
+__END_NAMESPACE
@@ -0,0 +1,32 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+struct OffscreenFrameDesc;
+
+
+/**
+ * One frame to render, parsed from a text line:
+ *   render id=7 scene=grid count=256 width=1280 height=720 eye=0,8,16 target=0,0,0 fov=60 output=frame7.png
+ * Keys are optional, scenes are procedural: "cube" is a single cube, "grid" a square grid of count cubes.
+ */
+typedef struct RenderJob {
+	uint64_t      m_ID = 0;
+	std::string   m_Scene = "grid";
+	uint32_t      m_Count = 64;
+	uint32_t      m_Width = 640;
+	uint32_t      m_Height = 480;
+	glm::vec3     m_Eye = glm::vec3(0.0f, 8.0f, 14.0f);
+	glm::vec3     m_Target = glm::vec3(0.0f, 0.0f, 0.0f);
+	float         m_FieldOfView = 60.0f;      // Vertical, in degrees
+	std::string   m_Output;                   // File written in stdin mode, "<id>.png" when empty
+} RenderJob;
+
+// Fills job from the key=value pairs after the command word, error says which one is invalid.
+bool ParseRenderJob(const std::string& arguments, RenderJob& job, std::string& error);
+void BuildFrameDesc(const RenderJob& job, OffscreenFrameDesc& desc);
+
+
+__END_NAMESPACE
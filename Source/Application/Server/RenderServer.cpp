@@ -0,0 +1,522 @@
+#include <cstdint> // Necessary for UINT32_MAX
+#include "ImageEncoder.h"
+#include "VulkanUtility.h"
+#include "VulkanSceneAttachments.h"
+#include "VulkanHeadlessDevice.h"
+#include "VulkanOffscreenRenderer.h"
+#include "RenderJob.h"
+#include "RenderServer.h"
+
+
+__BEGIN_NAMESPACE
+
+
+static const uint32_t DEFAULT_MAX_WORKERS = 4;
+static const size_t SOCKET_RECEIVE_BYTES = 4096;
+// Longest command line accepted from a socket, the connection is dropped past it.
+static const size_t SOCKET_MAX_LINE = 64 * 1024;
+#if PROFILER_ENABLED
+static const size_t PROFILE_EVENTS_PER_THREAD = 256 * 1024;
+#endif
+
+
+// One client, closed once the reader and every job it queued are done with it.
+struct ServerConnection
+{
+#if( PLATFORM == PLATFORM_WINDOWS )
+    SOCKET        m_Socket = INVALID_SOCKET;
+    std::mutex    m_SendMutex;
+    bool          m_Broken = false;
+
+    ~ServerConnection()
+    {
+        if (INVALID_SOCKET != m_Socket) {
+            closesocket(m_Socket);
+        }
+    }
+
+    // Caller holds m_SendMutex.
+    void SendAll(const char* data, size_t size)
+    {
+        while (!m_Broken && size > 0) {
+            int sent = send(m_Socket, data, (int)std::min<size_t>(size, INT32_MAX), 0);
+            if (sent <= 0) {
+                m_Broken = true;
+                break;
+            }
+            data += sent;
+            size -= sent;
+        }
+    }
+#endif
+};
+
+
+// User & kernel time of every thread in the process, the denominator of frames per core.
+static double GetProcessCpuSeconds()
+{
+#if( PLATFORM == PLATFORM_WINDOWS )
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+        uint64_t kernel = ((uint64_t)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+        uint64_t user = ((uint64_t)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+        return (double)(kernel + user) * 1e-7;     // 100 ns units
+    }
+    return 0.0;
+#else
+    return (double)std::clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+static double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+RenderServer::RenderServer() :
+	m_HeadlessDevice(nullptr),
+	m_Stopping(false),
+	m_Started(false),
+	m_StartCpuSeconds(0.0),
+	m_FramesRendered(0),
+	m_FramesFailed(0),
+	m_BytesEncoded(0),
+	m_RenderMilliseconds(0.0),
+	m_EncodeMilliseconds(0.0)
+{
+}
+
+RenderServer::~RenderServer()
+{
+}
+
+bool RenderServer::Run(int argc, char** argv)
+{
+    if (!Initial(argc, argv)) {
+        return false;
+    }
+
+    bool succeeded = StartUp();
+    if (succeeded) {
+        succeeded = MainLoop();
+    }
+
+    ShutDown();
+    CleanUp();
+    return succeeded;
+}
+
+bool RenderServer::Initial(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if ("--validation" == argument) {
+            m_Settings.m_Validation = true;
+            continue;
+        }
+        if (nullptr == value) {
+            std::cout << "Missing value after " << argument << ".\n";
+            return false;
+        }
+        i++;
+        if ("--port" == argument) {
+            m_Settings.m_Port = (uint16_t)atoi(value);
+        } else if ("--workers" == argument) {
+            m_Settings.m_Workers = (uint32_t)atoi(value);
+        } else if ("--queues" == argument) {
+            m_Settings.m_Queues = (uint32_t)atoi(value);
+        } else if ("--msaa" == argument) {
+            m_Settings.m_Samples = std::max(1, atoi(value));
+        } else if ("--device" == argument) {
+            m_Settings.m_DeviceName = value;
+        } else if ("--profile" == argument) {
+            m_Settings.m_ProfilePath = value;
+        } else {
+            std::cout << "Unknown argument " << argument << ".\n"
+                "Usage: Server [--port N] [--workers N] [--queues N] [--msaa N] [--device NAME] [--validation] [--profile FILE]\n";
+            return false;
+        }
+    }
+
+    if (0 == m_Settings.m_Workers) {
+        m_Settings.m_Workers = std::min(DEFAULT_MAX_WORKERS, std::max(1u, std::thread::hardware_concurrency()));
+    }
+    if (0 == m_Settings.m_Queues) {
+        m_Settings.m_Queues = m_Settings.m_Workers;
+    }
+
+#if PROFILER_ENABLED
+    Profiler::Initial(PROFILE_EVENTS_PER_THREAD);
+    if (!m_Settings.m_ProfilePath.empty()) {
+        Profiler::BeginCapture();
+    }
+#endif
+    PROFILE_THREAD_NAME("Main");
+    return true;
+}
+
+bool RenderServer::StartUp()
+{
+    PROFILE_FUNCTION();
+
+    HeadlessDeviceSettings deviceSettings;
+    deviceSettings.m_DeviceName = m_Settings.m_DeviceName;
+    deviceSettings.m_MaxQueues = m_Settings.m_Queues;
+    deviceSettings.m_Validation = m_Settings.m_Validation;
+
+    m_HeadlessDevice = New<VulkanHeadlessDevice>(MemoryTag::GraphicDriver);
+    if (!m_HeadlessDevice->Create(deviceSettings)) {
+        return false;
+    }
+
+    SceneAttachmentSettings attachmentSettings;
+    attachmentSettings.m_Samples = m_Settings.m_Samples;
+    attachmentSettings.m_Depth = true;
+
+    // Workers share queues round robin when the device has fewer than asked.
+    // Each one renders a default job up front, so the first real job finds its target & pipeline ready.
+    RenderJob warmUpJob;
+    OffscreenFrameDesc warmUpDesc;
+    BuildFrameDesc(warmUpJob, warmUpDesc);
+    std::vector<uint8_t> warmUpPixels;
+    for (uint32_t i = 0; i < m_Settings.m_Workers; i++) {
+        VulkanOffscreenRenderer* renderer = New<VulkanOffscreenRenderer>(MemoryTag::GraphicDriver);
+        m_Renderers.push_back(renderer);
+        if (!renderer->Create(m_HeadlessDevice, i, attachmentSettings) || !renderer->Render(warmUpDesc, warmUpPixels)) {
+            std::cout << "Server failed to create render worker " << i << ".\n";
+            return false;
+        }
+    }
+
+#if( PLATFORM == PLATFORM_WINDOWS )
+    if (0 != m_Settings.m_Port) {
+        WSADATA wsaData;
+        if (0 != WSAStartup(MAKEWORD(2, 2), &wsaData)) {
+            std::cout << "Server failed to initialize Winsock.\n";
+            SetErrorCode(ErrorCode::UnKnow);
+            return false;
+        }
+    }
+#endif
+
+    for (uint32_t i = 0; i < m_Settings.m_Workers; i++) {
+        m_Workers.emplace_back(&RenderServer::WorkerLoop, this, i);
+    }
+
+    std::cout << "Server ready: " << m_Settings.m_Workers << " worker(s) on " << m_HeadlessDevice->GetQueueCount()
+        << " queue(s) of " << m_HeadlessDevice->GetDeviceName() << ", " << std::thread::hardware_concurrency() << " hardware thread(s), "
+        << (0 != m_Settings.m_Port ? "listening on 127.0.0.1:" + std::to_string(m_Settings.m_Port) : std::string("reading stdin")) << ".\n";
+    std::cout.flush();
+    return true;
+}
+
+bool RenderServer::MainLoop()
+{
+    return (0 != m_Settings.m_Port) ? ServeSocket() : ReadStdin();
+}
+
+bool RenderServer::ReadStdin()
+{
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        if (!HandleCommand(line, nullptr)) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool RenderServer::ServeSocket()
+{
+#if( PLATFORM == PLATFORM_WINDOWS )
+    SOCKET listenSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (INVALID_SOCKET == listenSocket) {
+        std::cout << "Server failed to create socket.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    // Loopback only, the protocol has no authentication.
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(m_Settings.m_Port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (SOCKET_ERROR == bind(listenSocket, (const sockaddr*)&address, sizeof(address)) || SOCKET_ERROR == listen(listenSocket, SOMAXCONN)) {
+        std::cout << "Server failed to listen on port " << m_Settings.m_Port << ".\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        closesocket(listenSocket);
+        return false;
+    }
+
+    // One client at a time, its jobs still run concurrently on every worker.
+    bool running = true;
+    while (running) {
+        SOCKET clientSocket = accept(listenSocket, nullptr, nullptr);
+        if (INVALID_SOCKET == clientSocket) {
+            continue;
+        }
+        std::shared_ptr<ServerConnection> connection = std::make_shared<ServerConnection>();
+        connection->m_Socket = clientSocket;
+
+        std::string pending;
+        char buffer[SOCKET_RECEIVE_BYTES];
+        while (running) {
+            int received = recv(clientSocket, buffer, sizeof(buffer), 0);
+            if (received <= 0) {
+                break;
+            }
+            pending.append(buffer, received);
+
+            size_t lineStart = 0;
+            size_t lineEnd;
+            while (running && std::string::npos != (lineEnd = pending.find('\n', lineStart))) {
+                running = HandleCommand(pending.substr(lineStart, lineEnd - lineStart), connection);
+                lineStart = lineEnd + 1;
+            }
+            pending.erase(0, lineStart);
+            if (pending.size() > SOCKET_MAX_LINE) {
+                Reply(connection, "error id=0 line too long\n");
+                break;
+            }
+        }
+    }
+
+    closesocket(listenSocket);
+    return true;
+#else
+    std::cout << "Server socket mode is only supported on Windows, use stdin.\n";
+    return false;
+#endif
+}
+
+bool RenderServer::HandleCommand(const std::string& line, const std::shared_ptr<ServerConnection>& connection)
+{
+    std::istringstream stream(line);
+    std::string command;
+    if (!(stream >> command) || '#' == command[0]) {
+        return true;
+    }
+
+    if ("quit" == command) {
+        return false;
+    }
+    if ("stats" == command) {
+        Reply(connection, GetThroughputReport());
+        return true;
+    }
+    if ("render" != command) {
+        Reply(connection, "error id=0 unknown command " + command + "\n");
+        return true;
+    }
+
+    PendingJob pending;
+    pending.m_Connection = connection;
+    std::string arguments;
+    std::getline(stream, arguments);
+    std::string error;
+    if (!ParseRenderJob(arguments, pending.m_Job, error)) {
+        Reply(connection, "error id=" + std::to_string(pending.m_Job.m_ID) + " " + error + "\n");
+        return true;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_JobMutex);
+        m_Jobs.push_back(std::move(pending));
+    }
+    m_JobReady.notify_one();
+    return true;
+}
+
+void RenderServer::Reply(const std::shared_ptr<ServerConnection>& connection, const std::string& text, const std::vector<uint8_t>* payload)
+{
+    if (nullptr == connection) {
+        std::lock_guard<std::mutex> lock(m_OutputMutex);
+        std::cout << text;
+        std::cout.flush();
+        return;
+    }
+
+#if( PLATFORM == PLATFORM_WINDOWS )
+    // Header & payload go out together, replies of concurrent jobs never interleave.
+    PROFILE_LOCK(connection->m_SendMutex, "ServerConnection::m_SendMutex");
+    connection->SendAll(text.data(), text.size());
+    if (nullptr != payload && !payload->empty()) {
+        connection->SendAll((const char*)payload->data(), payload->size());
+    }
+#endif
+}
+
+void RenderServer::WorkerLoop(uint32_t workerIndex)
+{
+#if PROFILER_ENABLED
+    char threadName[32];
+    snprintf(threadName, sizeof(threadName), "Worker %u", workerIndex);
+    PROFILE_THREAD_NAME(threadName);
+#endif
+
+    VulkanOffscreenRenderer* renderer = m_Renderers[workerIndex];
+    std::vector<uint8_t> pixels;
+    std::vector<uint8_t> png;
+    while (true) {
+        PendingJob pending;
+        {
+            std::unique_lock<std::mutex> lock(m_JobMutex);
+            m_JobReady.wait(lock, [this]() { return m_Stopping || !m_Jobs.empty(); });
+            if (m_Jobs.empty()) {
+                return;
+            }
+            pending = std::move(m_Jobs.front());
+            m_Jobs.pop_front();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_StatisticsMutex);
+            if (!m_Started) {
+                m_Started = true;
+                m_StartTime = std::chrono::steady_clock::now();
+                m_StartCpuSeconds = GetProcessCpuSeconds();
+            }
+        }
+
+        PROFILE_ZONE("RenderServer::Job");
+        auto jobStart = std::chrono::steady_clock::now();
+
+        OffscreenFrameDesc desc;
+        BuildFrameDesc(pending.m_Job, desc);
+        if (!renderer->Render(desc, pixels)) {
+            CompleteJob(pending, false, png, ElapsedMilliseconds(jobStart), "render failed");
+            continue;
+        }
+        double renderMs = ElapsedMilliseconds(jobStart);
+
+        auto encodeStart = std::chrono::steady_clock::now();
+        bool encoded = EncodePNG(pixels.data(), desc.m_Width, desc.m_Height, png);
+        double encodeMs = ElapsedMilliseconds(encodeStart);
+        {
+            std::lock_guard<std::mutex> lock(m_StatisticsMutex);
+            m_RenderMilliseconds += renderMs;
+            m_EncodeMilliseconds += encodeMs;
+        }
+        PROFILE_COUNTER("Server render ms", renderMs);
+        PROFILE_COUNTER("Server encode ms", encodeMs);
+
+        CompleteJob(pending, encoded, png, renderMs + encodeMs, encoded ? std::string() : "encode failed");
+    }
+}
+
+void RenderServer::CompleteJob(const PendingJob& pending, bool rendered, const std::vector<uint8_t>& png, double milliseconds, const std::string& error)
+{
+    const RenderJob& job = pending.m_Job;
+    std::string id = std::to_string(job.m_ID);
+
+    // Stdin mode writes the file here so a failed write is reported like a failed render.
+    std::string path = job.m_Output.empty() ? id + ".png" : job.m_Output;
+    std::string failure = error;
+    if (rendered && nullptr == pending.m_Connection) {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.write((const char*)png.data(), png.size())) {
+            rendered = false;
+            failure = "cannot write " + path;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_StatisticsMutex);
+        if (rendered) {
+            m_FramesRendered++;
+            m_BytesEncoded += png.size();
+        } else {
+            m_FramesFailed++;
+        }
+    }
+
+    if (!rendered) {
+        Reply(pending.m_Connection, "error id=" + id + " " + failure + "\n");
+        return;
+    }
+
+    char milliText[32];
+    snprintf(milliText, sizeof(milliText), "%.2f", milliseconds);
+    if (nullptr == pending.m_Connection) {
+        Reply(nullptr, "done id=" + id + " file=" + path + " ms=" + milliText + "\n");
+    } else {
+        Reply(pending.m_Connection, "image id=" + id + " width=" + std::to_string(job.m_Width) + " height=" + std::to_string(job.m_Height) +
+            " bytes=" + std::to_string(png.size()) + " ms=" + milliText + "\n", &png);
+    }
+}
+
+std::string RenderServer::GetThroughputReport()
+{
+    std::lock_guard<std::mutex> lock(m_StatisticsMutex);
+    double seconds = m_Started ? ElapsedMilliseconds(m_StartTime) * 1e-3 : 0.0;
+    double cpuSeconds = m_Started ? GetProcessCpuSeconds() - m_StartCpuSeconds : 0.0;
+    double frames = (double)m_FramesRendered;
+
+    char report[512];
+    snprintf(report, sizeof(report),
+        "stats frames=%llu failed=%llu seconds=%.3f fps=%.2f cpu_seconds=%.3f fps_per_core=%.2f render_ms=%.2f encode_ms=%.2f mb=%.2f workers=%u cores=%u device=\"%s\"\n",
+        (unsigned long long)m_FramesRendered, (unsigned long long)m_FramesFailed, seconds,
+        seconds > 0.0 ? frames / seconds : 0.0, cpuSeconds, cpuSeconds > 0.0 ? frames / cpuSeconds : 0.0,
+        frames > 0.0 ? m_RenderMilliseconds / frames : 0.0, frames > 0.0 ? m_EncodeMilliseconds / frames : 0.0,
+        (double)m_BytesEncoded / (1024.0 * 1024.0), m_Settings.m_Workers, std::thread::hardware_concurrency(),
+        nullptr != m_HeadlessDevice ? m_HeadlessDevice->GetDeviceName() : "");
+    return report;
+}
+
+bool RenderServer::ShutDown()
+{
+    // Pending jobs are drained before the workers exit.
+    {
+        std::lock_guard<std::mutex> lock(m_JobMutex);
+        m_Stopping = true;
+    }
+    m_JobReady.notify_all();
+    for (std::thread& worker : m_Workers) {
+        worker.join();
+    }
+    m_Workers.clear();
+
+    if (m_FramesRendered + m_FramesFailed > 0) {
+        std::lock_guard<std::mutex> lock(m_OutputMutex);
+        std::cout << GetThroughputReport();
+    }
+
+    for (VulkanOffscreenRenderer* renderer : m_Renderers) {
+        renderer->Destroy();
+        Delete(renderer);
+    }
+    m_Renderers.clear();
+
+    if (nullptr != m_HeadlessDevice) {
+        m_HeadlessDevice->Destroy();
+    }
+
+#if( PLATFORM == PLATFORM_WINDOWS )
+    if (0 != m_Settings.m_Port) {
+        WSACleanup();
+    }
+#endif
+    return true;
+}
+
+void RenderServer::CleanUp()
+{
+    if (nullptr != m_HeadlessDevice) {
+        Delete(m_HeadlessDevice);
+        m_HeadlessDevice = nullptr;
+    }
+
+#if PROFILER_ENABLED
+    if (Profiler::IsCapturing()) {
+        Profiler::EndCapture(m_Settings.m_ProfilePath.c_str());
+    }
+    Profiler::CleanUp();
+#endif
+
+    ReportMemory();
+    ReportMemoryLeaks();
+}
+
+__END_NAMESPACE
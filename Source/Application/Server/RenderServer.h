@@ -0,0 +1,85 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+class VulkanHeadlessDevice;
+class VulkanOffscreenRenderer;
+struct ServerConnection;
+
+
+typedef struct RenderServerSettings {
+	uint16_t      m_Port = 0;                 // 0 reads jobs from stdin & writes files, otherwise listens on 127.0.0.1
+	uint32_t      m_Workers = 0;              // 0 picks min(4, hardware threads)
+	uint32_t      m_Queues = 0;               // 0 asks one queue per worker, the device may give fewer
+	uint32_t      m_Samples = 1;
+	std::string   m_DeviceName;
+	bool          m_Validation = false;
+	std::string   m_ProfilePath;              // Trace of the whole run, written at shutdown
+} RenderServerSettings;
+
+
+/**
+ * Headless render service. Jobs arrive as text lines (see RenderJob.h), either on stdin or a local TCP
+ * socket, and are rendered by a pool of workers, each owning an offscreen renderer bound to its own
+ * queue. Device, pipelines & targets are created once and kept warm between jobs.
+ *
+ * Socket replies are "image id=<id> width=<w> height=<h> bytes=<n> ms=<t>\n" followed by n bytes of PNG,
+ * or "error id=<id> <message>\n". "stats" reports throughput, "quit" drains pending jobs and exits.
+ */
+class RenderServer
+{
+public:
+	RenderServer();
+	virtual ~RenderServer();
+
+	bool Run(int argc, char** argv);
+
+private:
+	typedef struct PendingJob {
+		RenderJob                           m_Job;
+		std::shared_ptr<ServerConnection>   m_Connection;   // Null in stdin mode
+	} PendingJob;
+
+	virtual bool Initial(int argc, char** argv);
+	virtual bool StartUp();
+	virtual bool MainLoop();
+	virtual bool ShutDown();
+	virtual void CleanUp();
+
+	bool ReadStdin();
+	bool ServeSocket();
+	// Returns false once "quit" is received.
+	bool HandleCommand(const std::string& line, const std::shared_ptr<ServerConnection>& connection);
+	void Reply(const std::shared_ptr<ServerConnection>& connection, const std::string& text, const std::vector<uint8_t>* payload = nullptr);
+
+	void WorkerLoop(uint32_t workerIndex);
+	void CompleteJob(const PendingJob& pending, bool rendered, const std::vector<uint8_t>& png, double milliseconds, const std::string& error);
+	std::string GetThroughputReport();
+
+	RenderServerSettings                    m_Settings;
+	VulkanHeadlessDevice*                   m_HeadlessDevice;
+	std::vector<VulkanOffscreenRenderer*>   m_Renderers;
+	std::vector<std::thread>                m_Workers;
+
+	std::mutex                              m_JobMutex;
+	std::condition_variable                 m_JobReady;
+	std::deque<PendingJob>                  m_Jobs;
+	bool                                    m_Stopping;
+	std::mutex                              m_OutputMutex;      // Orders stdout lines from the workers
+
+	// Throughput since the first job, per core is frames per second of process CPU time.
+	std::mutex                              m_StatisticsMutex;
+	bool                                    m_Started;
+	std::chrono::steady_clock::time_point   m_StartTime;
+	double                                  m_StartCpuSeconds;
+	uint64_t                                m_FramesRendered;
+	uint64_t                                m_FramesFailed;
+	uint64_t                                m_BytesEncoded;
+	double                                  m_RenderMilliseconds;
+	double                                  m_EncodeMilliseconds;
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,185 @@
+#include "CrossPlatform.h"
+#include "StandardC.h"
+#include "StandardCXX.h"
+#include "Memory.h"
+#include "FrameAllocator.h"
+
+
+__BEGIN_NAMESPACE
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+LinearAllocator::LinearAllocator() :
+    m_Buffer(nullptr),
+    m_Capacity(0),
+    m_Offset(0),
+    m_Peak(0),
+    m_HeapAllocations(0),
+    m_OverflowBlocks(nullptr),
+    m_OverflowUsed(0)
+{
+}
+
+LinearAllocator::~LinearAllocator()
+{
+    CleanUp();
+}
+
+bool LinearAllocator::Initial(size_t capacity)
+{
+    CleanUp();
+    m_Buffer = static_cast<uint8_t*>(MemoryAllocate(capacity, MemoryTag::FrameArena));
+    if (nullptr == m_Buffer) {
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    m_Capacity = capacity;
+    m_HeapAllocations++;
+    return true;
+}
+
+void* LinearAllocator::Allocate(size_t size, size_t alignment)
+{
+    // Alignment must be a power of two, buffer start is MemoryAllocate aligned.
+    size_t offset = AlignUp((size_t)(m_Buffer + m_Offset), alignment) - (size_t)m_Buffer;
+    if (nullptr != m_Buffer && offset + size <= m_Capacity) {
+        m_Offset = offset + size;
+        return m_Buffer + offset;
+    }
+
+    // Spill, the block keeps a link header in front of the aligned payload.
+    size_t header = AlignUp(sizeof(void*), alignment);
+    uint8_t* block = static_cast<uint8_t*>(MemoryAllocate(header + size + alignment, MemoryTag::FrameArena));
+    if (nullptr == block) {
+        SetErrorCode(ErrorCode::UnKnow);
+        return nullptr;
+    }
+    *reinterpret_cast<void**>(block) = m_OverflowBlocks;
+    m_OverflowBlocks = block;
+    m_OverflowUsed += size + alignment;
+    m_HeapAllocations++;
+    return reinterpret_cast<void*>(AlignUp((size_t)(block + header), alignment));
+}
+
+void LinearAllocator::FreeOverflowBlocks()
+{
+    while (nullptr != m_OverflowBlocks) {
+        void* next = *reinterpret_cast<void**>(m_OverflowBlocks);
+        MemoryFree(m_OverflowBlocks);
+        m_OverflowBlocks = next;
+    }
+}
+
+void LinearAllocator::Reset()
+{
+    size_t used = GetUsed();
+    m_Peak = std::max(m_Peak, used);
+    FreeOverflowBlocks();
+
+    // Grow once to the observed peak so the next frames fit without spilling.
+    if (m_OverflowUsed > 0) {
+        size_t capacity = AlignUp(m_Peak + m_Peak / 4, 4096);
+        MemoryFree(m_Buffer);
+        m_Buffer = static_cast<uint8_t*>(MemoryAllocate(capacity, MemoryTag::FrameArena));
+        m_Capacity = (nullptr != m_Buffer) ? capacity : 0;
+        m_HeapAllocations++;
+    }
+    m_OverflowUsed = 0;
+    m_Offset = 0;
+}
+
+void LinearAllocator::CleanUp()
+{
+    FreeOverflowBlocks();
+    m_OverflowUsed = 0;
+    m_Offset = 0;
+    MemoryFree(m_Buffer);
+    m_Buffer = nullptr;
+    m_Capacity = 0;
+    m_Peak = 0;
+}
+
+
+/****************************************************************************
+ * Frame arena, one allocator per thread registered for statistics & cleanup
+ ****************************************************************************/
+typedef struct FrameArenaThreadSlot {
+    LinearAllocator     m_Allocator;
+    bool                m_Initialized = false;
+    ~FrameArenaThreadSlot();
+} FrameArenaThreadSlot;
+
+static std::mutex g_FrameArenaMutex;
+static std::vector<FrameArenaThreadSlot*> g_FrameArenaThreads;
+static std::atomic<size_t> g_FrameArenaCapacity(0);
+static thread_local FrameArenaThreadSlot t_FrameArenaSlot;
+
+FrameArenaThreadSlot::~FrameArenaThreadSlot()
+{
+    if (m_Initialized) {
+        std::lock_guard<std::mutex> lock(g_FrameArenaMutex);
+        g_FrameArenaThreads.erase(std::remove(g_FrameArenaThreads.begin(), g_FrameArenaThreads.end(), this), g_FrameArenaThreads.end());
+    }
+}
+
+static LinearAllocator& GetThreadFrameAllocator()
+{
+    FrameArenaThreadSlot& slot = t_FrameArenaSlot;
+    if (!slot.m_Initialized) {
+        slot.m_Allocator.Initial(g_FrameArenaCapacity.load(std::memory_order_relaxed));
+        slot.m_Initialized = true;
+        std::lock_guard<std::mutex> lock(g_FrameArenaMutex);
+        g_FrameArenaThreads.push_back(&slot);
+    }
+    return slot.m_Allocator;
+}
+
+bool FrameArena::Initial(size_t perThreadCapacity)
+{
+    g_FrameArenaCapacity.store(perThreadCapacity, std::memory_order_relaxed);
+    return true;
+}
+
+void FrameArena::BeginFrame()
+{
+    GetThreadFrameAllocator().Reset();
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+    return GetThreadFrameAllocator().Allocate(size, alignment);
+}
+
+void FrameArena::CleanUp()
+{
+    // Other threads must have stopped using their arenas, their slots are released on thread exit.
+    std::lock_guard<std::mutex> lock(g_FrameArenaMutex);
+    for (FrameArenaThreadSlot* slot : g_FrameArenaThreads) {
+        slot->m_Allocator.CleanUp();
+    }
+}
+
+size_t FrameArena::GetHeapAllocations()
+{
+    std::lock_guard<std::mutex> lock(g_FrameArenaMutex);
+    size_t count = 0;
+    for (FrameArenaThreadSlot* slot : g_FrameArenaThreads) {
+        count += slot->m_Allocator.GetHeapAllocations();
+    }
+    return count;
+}
+
+size_t FrameArena::GetPeak()
+{
+    std::lock_guard<std::mutex> lock(g_FrameArenaMutex);
+    size_t peak = 0;
+    for (FrameArenaThreadSlot* slot : g_FrameArenaThreads) {
+        peak += slot->m_Allocator.GetPeak();
+    }
+    return peak;
+}
+
+__END_NAMESPACE
@@ -0,0 +1,66 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+/**
+ * Bump allocator, individual allocations are never freed, Reset() releases everything at once.
+ * Allocations beyond the capacity spill into overflow blocks and the next Reset() grows the main
+ * block to the peak usage, so a steady workload stops touching the heap after the first frames.
+ */
+class LinearAllocator
+{
+public:
+	LinearAllocator();
+	virtual ~LinearAllocator();
+
+	bool Initial(size_t capacity);
+	void* Allocate(size_t size, size_t alignment = 16);
+	void Reset();
+	void CleanUp();
+
+	template <typename T>
+	T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T))); }
+
+	size_t GetUsed() const { return m_Offset + m_OverflowUsed; }
+	size_t GetCapacity() const { return m_Capacity; }
+	size_t GetPeak() const { return m_Peak; }
+	size_t GetHeapAllocations() const { return m_HeapAllocations; }
+
+private:
+	uint8_t*              m_Buffer;
+	size_t                m_Capacity;
+	size_t                m_Offset;
+	size_t                m_Peak;
+	size_t                m_HeapAllocations;   // Main & overflow blocks allocated since Initial
+	void*                 m_OverflowBlocks;    // Singly linked list, first pointer of each block is the next one
+	size_t                m_OverflowUsed;
+
+	void FreeOverflowBlocks();
+};
+
+
+/**
+ * Per-thread frame scratch memory. Each thread owns one LinearAllocator, reset by that thread at its
+ * own frame boundary, so the main and render threads don't need to agree on when a frame ends.
+ * Memory returned by Allocate() is only valid until the calling thread's next BeginFrame().
+ */
+class FrameArena
+{
+public:
+	static bool Initial(size_t perThreadCapacity);
+	static void BeginFrame();
+	static void* Allocate(size_t size, size_t alignment = 16);
+	static void CleanUp();
+
+	template <typename T>
+	static T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T))); }
+
+	// Sum over all threads.
+	static size_t GetHeapAllocations();
+	static size_t GetPeak();
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,82 @@
+#include "CrossPlatform.h"
+#include "Platform.h"
+#include "StandardCXX.h"
+#include "Profiler.h"
+#include "FramePacer.h"
+
+
+__BEGIN_NAMESPACE
+
+static const std::chrono::microseconds FRAME_PACER_INITIAL_SLACK(2000);
+static const std::chrono::microseconds FRAME_PACER_MIN_SLACK(250);
+
+FramePacer::FramePacer() :
+	m_TargetFrameRate(0.0),
+	m_FrameInterval(Clock::duration::zero()),
+	m_NextFrame(Clock::now()),
+	m_LastFrame(Clock::now()),
+	m_SleepSlack(FRAME_PACER_INITIAL_SLACK),
+	m_FrameTime(0.0),
+	m_TimerPeriodRaised(false)
+{
+}
+
+FramePacer::~FramePacer()
+{
+    SetTargetFrameRate(0.0);
+}
+
+void FramePacer::SetTargetFrameRate(double framesPerSecond)
+{
+    m_TargetFrameRate = std::max(framesPerSecond, 0.0);
+    m_FrameInterval = (m_TargetFrameRate > 0.0) ?
+        std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_TargetFrameRate)) : Clock::duration::zero();
+    m_NextFrame = Clock::now() + m_FrameInterval;
+
+#if( PLATFORM == PLATFORM_WINDOWS )
+    // Default scheduler tick is ~15.6 ms, far too coarse to sleep inside a frame.
+    bool raise = m_TargetFrameRate > 0.0;
+    if (raise != m_TimerPeriodRaised) {
+        raise ? timeBeginPeriod(1) : timeEndPeriod(1);
+        m_TimerPeriodRaised = raise;
+    }
+#endif
+}
+
+double FramePacer::Wait()
+{
+    Clock::time_point waitStart = Clock::now();
+
+    if (Clock::duration::zero() != m_FrameInterval) {
+        PROFILE_ZONE("FramePacerWait");
+
+        // Sleep up to the slack before the deadline, learning how much the OS oversleeps.
+        // The slack jumps to the worst oversleep seen and decays slowly back.
+        Clock::time_point now = waitStart;
+        while (m_NextFrame - now > m_SleepSlack) {
+            Clock::duration requested = (m_NextFrame - now) - m_SleepSlack;
+            std::this_thread::sleep_for(requested);
+            Clock::time_point woke = Clock::now();
+            Clock::duration oversleep = (woke - now) - requested;
+            m_SleepSlack = std::max<Clock::duration>(FRAME_PACER_MIN_SLACK, std::max(oversleep, m_SleepSlack - m_SleepSlack / 64));
+            now = woke;
+        }
+        while (Clock::now() < m_NextFrame) {
+            std::this_thread::yield();
+        }
+
+        // A late frame re-anchors the schedule instead of bursting to catch up.
+        now = Clock::now();
+        m_NextFrame += m_FrameInterval;
+        if (m_NextFrame < now) {
+            m_NextFrame = now + m_FrameInterval;
+        }
+    }
+
+    Clock::time_point frameStart = Clock::now();
+    m_FrameTime = std::chrono::duration<double, std::milli>(frameStart - m_LastFrame).count();
+    m_LastFrame = frameStart;
+    return std::chrono::duration<double, std::milli>(frameStart - waitStart).count();
+}
+
+__END_NAMESPACE
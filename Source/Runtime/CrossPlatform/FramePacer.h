@@ -0,0 +1,41 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+/**
+ * Frame rate cap. Wait() sleeps while the deadline is further away than the measured sleep
+ * overshoot, then spins the rest, so frames start within a few microseconds of the target.
+ */
+class FramePacer
+{
+public:
+	FramePacer();
+	virtual ~FramePacer();
+
+	// 0 disables the cap, Wait() then only measures frame time.
+	void SetTargetFrameRate(double framesPerSecond);
+	double GetTargetFrameRate() const { return m_TargetFrameRate; }
+
+	// Blocks until the next frame should start, returns the time spent waiting in milliseconds.
+	double Wait();
+
+	// Milliseconds between the last two Wait() returns.
+	double GetFrameTime() const { return m_FrameTime; }
+	double GetSleepSlack() const { return std::chrono::duration<double, std::milli>(m_SleepSlack).count(); }
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	double              m_TargetFrameRate;
+	Clock::duration     m_FrameInterval;
+	Clock::time_point   m_NextFrame;
+	Clock::time_point   m_LastFrame;
+	Clock::duration     m_SleepSlack;      // Worst recent oversleep, spinning covers it
+	double              m_FrameTime;
+	bool                m_TimerPeriodRaised;
+};
+
+
+__END_NAMESPACE
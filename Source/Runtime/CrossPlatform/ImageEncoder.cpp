@@ -0,0 +1,500 @@
+#include "CrossPlatform.h"
+#include "StandardC.h"
+#include "StandardCXX.h"
+#include "ImageEncoder.h"
+
+
+__BEGIN_NAMESPACE
+
+static const uint8_t PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+static const size_t DEFLATE_MAX_STORED_BLOCK = 65535;
+static const uint32_t ADLER32_MODULO = 65521;
+// Largest run of bytes summed before the modulo, keeps the 32 bits sums from overflowing.
+static const size_t ADLER32_MAX_RUN = 5552;
+
+// Slicing by 8: table k holds the CRC of a byte followed by k zero bytes, so 8 bytes fold per step.
+static const uint32_t (*GetCrc32Tables())[256]
+{
+    static uint32_t tables[8][256];
+    static std::once_flag once;
+    std::call_once(once, []() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            tables[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; i++) {
+            for (int k = 1; k < 8; k++) {
+                tables[k][i] = tables[0][tables[k - 1][i] & 0xFF] ^ (tables[k - 1][i] >> 8);
+            }
+        }
+    });
+    return tables;
+}
+
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc)
+{
+    const uint32_t (*tables)[256] = GetCrc32Tables();
+    crc = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint32_t low = (data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24)) ^ crc;
+        uint32_t high = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+        crc = tables[7][low & 0xFF] ^ tables[6][(low >> 8) & 0xFF] ^ tables[5][(low >> 16) & 0xFF] ^ tables[4][low >> 24] ^
+            tables[3][high & 0xFF] ^ tables[2][(high >> 8) & 0xFF] ^ tables[1][(high >> 16) & 0xFF] ^ tables[0][high >> 24];
+    }
+    for (; size > 0; size--, data++) {
+        crc = tables[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void WriteBigEndian32(std::vector<uint8_t>& output, uint32_t value)
+{
+    output.push_back((uint8_t)(value >> 24));
+    output.push_back((uint8_t)(value >> 16));
+    output.push_back((uint8_t)(value >> 8));
+    output.push_back((uint8_t)value);
+}
+
+// Length, type, data, then the CRC over type & data.
+static void WriteChunk(std::vector<uint8_t>& output, const char* type, const uint8_t* data, size_t size)
+{
+    WriteBigEndian32(output, (uint32_t)size);
+    size_t typeOffset = output.size();
+    output.insert(output.end(), type, type + 4);
+    if (size > 0) {
+        output.insert(output.end(), data, data + size);
+    }
+    WriteBigEndian32(output, Crc32(output.data() + typeOffset, size + 4));
+}
+
+bool EncodePNG(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& output)
+{
+    if (nullptr == rgba || 0 == width || 0 == height) {
+        return false;
+    }
+
+    size_t rowBytes = (size_t)width * 4;
+    size_t rawSize = (rowBytes + 1) * height;       // Filter type byte in front of every row
+    size_t blockCount = std::max<size_t>(1, (rawSize + DEFLATE_MAX_STORED_BLOCK - 1) / DEFLATE_MAX_STORED_BLOCK);
+    size_t zlibSize = 2 + rawSize + blockCount * 5 + 4;
+
+    output.clear();
+    output.reserve(sizeof(PNG_SIGNATURE) + 25 + zlibSize + 12 + 12);
+    output.insert(output.end(), PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+
+    uint8_t header[13];
+    header[0] = (uint8_t)(width >> 24); header[1] = (uint8_t)(width >> 16); header[2] = (uint8_t)(width >> 8); header[3] = (uint8_t)width;
+    header[4] = (uint8_t)(height >> 24); header[5] = (uint8_t)(height >> 16); header[6] = (uint8_t)(height >> 8); header[7] = (uint8_t)height;
+    header[8] = 8;      // Bit depth
+    header[9] = 6;      // Truecolor with alpha
+    header[10] = 0;     // Deflate
+    header[11] = 0;     // Adaptive filtering, every row uses None
+    header[12] = 0;     // No interlace
+    WriteChunk(output, "IHDR", header, sizeof(header));
+
+    /****************************************************************************
+     * IDAT: zlib stream of stored blocks, written in place after the chunk header
+     ****************************************************************************/
+    WriteBigEndian32(output, (uint32_t)zlibSize);
+    size_t typeOffset = output.size();
+    output.insert(output.end(), { 'I', 'D', 'A', 'T' });
+    output.push_back(0x78);     // 32K window, deflate
+    output.push_back(0x01);     // No preset dictionary, fastest level; (0x78 << 8 | 0x01) % 31 == 0
+
+    // Unfiltered scanlines, each behind its filter type byte.
+    std::vector<uint8_t> raw(rawSize);
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t* line = raw.data() + (rowBytes + 1) * y;
+        line[0] = 0;
+        memcpy(line + 1, rgba + rowBytes * y, rowBytes);
+    }
+
+    for (size_t offset = 0; offset < rawSize; offset += DEFLATE_MAX_STORED_BLOCK) {
+        size_t blockSize = std::min(rawSize - offset, DEFLATE_MAX_STORED_BLOCK);
+        output.push_back(offset + blockSize == rawSize ? 1 : 0);    // BFINAL on the last block, BTYPE stored
+        output.push_back((uint8_t)blockSize);
+        output.push_back((uint8_t)(blockSize >> 8));
+        output.push_back((uint8_t)~blockSize);
+        output.push_back((uint8_t)(~blockSize >> 8));
+        output.insert(output.end(), raw.data() + offset, raw.data() + offset + blockSize);
+    }
+
+    uint32_t adlerA = 1;
+    uint32_t adlerB = 0;
+    for (size_t offset = 0; offset < rawSize; offset += ADLER32_MAX_RUN) {
+        size_t runEnd = std::min(rawSize, offset + ADLER32_MAX_RUN);
+        for (size_t i = offset; i < runEnd; i++) {
+            adlerA += raw[i];
+            adlerB += adlerA;
+        }
+        adlerA %= ADLER32_MODULO;
+        adlerB %= ADLER32_MODULO;
+    }
+    WriteBigEndian32(output, (adlerB << 16) | adlerA);
+    WriteBigEndian32(output, Crc32(output.data() + typeOffset, output.size() - typeOffset));
+
+    WriteChunk(output, "IEND", nullptr, 0);
+    return true;
+}
+
+/****************************************************************************
+ * Inflate, a straightforward canonical Huffman decoder: goldens are small,
+ * decoding speed doesn't matter
+ ****************************************************************************/
+static const int INFLATE_MAX_BITS = 15;
+static const int INFLATE_MAX_LENGTH_CODES = 286;
+static const int INFLATE_MAX_DISTANCE_CODES = 30;
+static const int INFLATE_FIXED_LENGTH_CODES = 288;
+
+typedef struct InflateHuffman {
+    uint16_t     m_Count[INFLATE_MAX_BITS + 1];     // Codes of each length
+    uint16_t     m_Symbol[INFLATE_FIXED_LENGTH_CODES];
+} InflateHuffman;
+
+typedef struct InflateState {
+    const uint8_t*           m_Input;
+    size_t                   m_InputSize;
+    size_t                   m_InputOffset;
+    uint32_t                 m_BitBuffer;
+    int                      m_BitCount;
+    bool                     m_Error;
+    std::vector<uint8_t>*    m_Output;
+} InflateState;
+
+static uint32_t InflateBits(InflateState& state, int count)
+{
+    while (state.m_BitCount < count) {
+        if (state.m_InputOffset >= state.m_InputSize) {
+            state.m_Error = true;
+            return 0;
+        }
+        state.m_BitBuffer |= (uint32_t)state.m_Input[state.m_InputOffset++] << state.m_BitCount;
+        state.m_BitCount += 8;
+    }
+    uint32_t value = state.m_BitBuffer & ((1u << count) - 1);
+    state.m_BitBuffer >>= count;
+    state.m_BitCount -= count;
+    return value;
+}
+
+// False for an over-subscribed set of lengths, incomplete sets are allowed like zlib does.
+static bool InflateBuildHuffman(InflateHuffman& huffman, const uint16_t* lengths, int count)
+{
+    memset(huffman.m_Count, 0, sizeof(huffman.m_Count));
+    for (int symbol = 0; symbol < count; symbol++) {
+        huffman.m_Count[lengths[symbol]]++;
+    }
+    if (huffman.m_Count[0] == count) {
+        return true;
+    }
+
+    int left = 1;
+    for (int length = 1; length <= INFLATE_MAX_BITS; length++) {
+        left <<= 1;
+        left -= huffman.m_Count[length];
+        if (left < 0) {
+            return false;
+        }
+    }
+
+    uint16_t offsets[INFLATE_MAX_BITS + 1];
+    offsets[1] = 0;
+    for (int length = 1; length < INFLATE_MAX_BITS; length++) {
+        offsets[length + 1] = offsets[length] + huffman.m_Count[length];
+    }
+    for (int symbol = 0; symbol < count; symbol++) {
+        if (0 != lengths[symbol]) {
+            huffman.m_Symbol[offsets[lengths[symbol]]++] = (uint16_t)symbol;
+        }
+    }
+    return true;
+}
+
+static int InflateDecodeSymbol(InflateState& state, const InflateHuffman& huffman)
+{
+    int code = 0;
+    int first = 0;
+    int index = 0;
+    for (int length = 1; length <= INFLATE_MAX_BITS; length++) {
+        code |= (int)InflateBits(state, 1);
+        int count = huffman.m_Count[length];
+        if (code - count < first) {
+            return huffman.m_Symbol[index + (code - first)];
+        }
+        index += count;
+        first += count;
+        first <<= 1;
+        code <<= 1;
+    }
+    state.m_Error = true;
+    return -1;
+}
+
+static bool InflateCodes(InflateState& state, const InflateHuffman& lengthCodes, const InflateHuffman& distanceCodes)
+{
+    static const uint16_t LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    static const uint8_t LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    static const uint16_t DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+        4097, 6145, 8193, 12289, 16385, 24577 };
+    static const uint8_t DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+    std::vector<uint8_t>& output = *state.m_Output;
+    while (!state.m_Error) {
+        int symbol = InflateDecodeSymbol(state, lengthCodes);
+        if (symbol < 256) {
+            if (symbol >= 0) {
+                output.push_back((uint8_t)symbol);
+            }
+            continue;
+        }
+        if (256 == symbol) {
+            return true;
+        }
+
+        symbol -= 257;
+        if (symbol >= 29) {
+            return false;
+        }
+        size_t length = LENGTH_BASE[symbol] + InflateBits(state, LENGTH_EXTRA[symbol]);
+        int distanceSymbol = InflateDecodeSymbol(state, distanceCodes);
+        if (distanceSymbol < 0 || distanceSymbol >= INFLATE_MAX_DISTANCE_CODES) {
+            return false;
+        }
+        size_t distance = DISTANCE_BASE[distanceSymbol] + InflateBits(state, DISTANCE_EXTRA[distanceSymbol]);
+        if (distance > output.size()) {
+            return false;
+        }
+        // Byte by byte, the copy may overlap what it produces.
+        size_t from = output.size() - distance;
+        for (size_t i = 0; i < length; i++) {
+            output.push_back(output[from + i]);
+        }
+    }
+    return false;
+}
+
+static bool InflateDynamicCodes(InflateState& state, InflateHuffman& lengthCodes, InflateHuffman& distanceCodes)
+{
+    static const uint8_t CODE_LENGTH_ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    int lengthCount = (int)InflateBits(state, 5) + 257;
+    int distanceCount = (int)InflateBits(state, 5) + 1;
+    int codeLengthCount = (int)InflateBits(state, 4) + 4;
+    if (state.m_Error || lengthCount > INFLATE_MAX_LENGTH_CODES || distanceCount > INFLATE_MAX_DISTANCE_CODES) {
+        return false;
+    }
+
+    uint16_t lengths[INFLATE_MAX_LENGTH_CODES + INFLATE_MAX_DISTANCE_CODES] = {};
+    for (int i = 0; i < codeLengthCount; i++) {
+        lengths[CODE_LENGTH_ORDER[i]] = (uint16_t)InflateBits(state, 3);
+    }
+    InflateHuffman codeLengthCodes;
+    if (!InflateBuildHuffman(codeLengthCodes, lengths, 19)) {
+        return false;
+    }
+
+    memset(lengths, 0, sizeof(lengths));
+    int index = 0;
+    while (index < lengthCount + distanceCount && !state.m_Error) {
+        int symbol = InflateDecodeSymbol(state, codeLengthCodes);
+        if (symbol < 0) {
+            return false;
+        }
+        if (symbol < 16) {
+            lengths[index++] = (uint16_t)symbol;
+            continue;
+        }
+
+        uint16_t repeated = 0;
+        int repeat = 0;
+        if (16 == symbol) {
+            if (0 == index) {
+                return false;
+            }
+            repeated = lengths[index - 1];
+            repeat = 3 + (int)InflateBits(state, 2);
+        } else if (17 == symbol) {
+            repeat = 3 + (int)InflateBits(state, 3);
+        } else {
+            repeat = 11 + (int)InflateBits(state, 7);
+        }
+        if (index + repeat > lengthCount + distanceCount) {
+            return false;
+        }
+        while (repeat-- > 0) {
+            lengths[index++] = repeated;
+        }
+    }
+
+    // The end of block code has to be there.
+    return !state.m_Error && 0 != lengths[256] &&
+        InflateBuildHuffman(lengthCodes, lengths, lengthCount) &&
+        InflateBuildHuffman(distanceCodes, lengths + lengthCount, distanceCount);
+}
+
+static bool InflateZlib(const uint8_t* input, size_t size, std::vector<uint8_t>& output)
+{
+    // CM 8, no preset dictionary, header check.
+    if (size < 6 || 8 != (input[0] & 0x0F) || 0 != (input[1] & 0x20) || 0 != (((uint32_t)input[0] << 8) | input[1]) % 31) {
+        return false;
+    }
+
+    InflateState state = { input + 2, size - 2, 0, 0, 0, false, &output };
+    bool last = false;
+    while (!last) {
+        last = (1 == InflateBits(state, 1));
+        uint32_t type = InflateBits(state, 2);
+        if (state.m_Error) {
+            return false;
+        }
+
+        if (0 == type) {
+            // Stored: the rest of the current byte is padding.
+            state.m_BitBuffer = 0;
+            state.m_BitCount = 0;
+            if (state.m_InputOffset + 4 > state.m_InputSize) {
+                return false;
+            }
+            const uint8_t* header = state.m_Input + state.m_InputOffset;
+            uint32_t length = header[0] | (header[1] << 8);
+            uint32_t lengthComplement = header[2] | (header[3] << 8);
+            state.m_InputOffset += 4;
+            if ((length ^ 0xFFFF) != lengthComplement || state.m_InputOffset + length > state.m_InputSize) {
+                return false;
+            }
+            output.insert(output.end(), state.m_Input + state.m_InputOffset, state.m_Input + state.m_InputOffset + length);
+            state.m_InputOffset += length;
+        } else if (1 == type) {
+            static InflateHuffman fixedLengthCodes;
+            static InflateHuffman fixedDistanceCodes;
+            static std::once_flag once;
+            std::call_once(once, []() {
+                uint16_t lengths[INFLATE_FIXED_LENGTH_CODES];
+                for (int symbol = 0; symbol < INFLATE_FIXED_LENGTH_CODES; symbol++) {
+                    lengths[symbol] = (symbol < 144) ? 8 : (symbol < 256) ? 9 : (symbol < 280) ? 7 : 8;
+                }
+                InflateBuildHuffman(fixedLengthCodes, lengths, INFLATE_FIXED_LENGTH_CODES);
+                for (int symbol = 0; symbol < INFLATE_MAX_DISTANCE_CODES; symbol++) {
+                    lengths[symbol] = 5;
+                }
+                InflateBuildHuffman(fixedDistanceCodes, lengths, INFLATE_MAX_DISTANCE_CODES);
+            });
+            if (!InflateCodes(state, fixedLengthCodes, fixedDistanceCodes)) {
+                return false;
+            }
+        } else if (2 == type) {
+            InflateHuffman lengthCodes;
+            InflateHuffman distanceCodes;
+            if (!InflateDynamicCodes(state, lengthCodes, distanceCodes) || !InflateCodes(state, lengthCodes, distanceCodes)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t ReadBigEndian32(const uint8_t* data)
+{
+    return ((uint32_t)data[0] << 24) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 8) | data[3];
+}
+
+static uint8_t PaethPredictor(int left, int up, int upLeft)
+{
+    int estimate = left + up - upLeft;
+    int distanceLeft = abs(estimate - left);
+    int distanceUp = abs(estimate - up);
+    int distanceUpLeft = abs(estimate - upLeft);
+    if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft) {
+        return (uint8_t)left;
+    }
+    return (uint8_t)((distanceUp <= distanceUpLeft) ? up : upLeft);
+}
+
+bool DecodePNG(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height, std::vector<uint8_t>& rgba)
+{
+    if (nullptr == data || size < sizeof(PNG_SIGNATURE) || 0 != memcmp(data, PNG_SIGNATURE, sizeof(PNG_SIGNATURE))) {
+        return false;
+    }
+
+    width = 0;
+    height = 0;
+    uint32_t channels = 0;
+    std::vector<uint8_t> compressed;
+    size_t offset = sizeof(PNG_SIGNATURE);
+    bool ended = false;
+    while (!ended && offset + 12 <= size) {
+        uint32_t length = ReadBigEndian32(data + offset);
+        const uint8_t* type = data + offset + 4;
+        const uint8_t* chunk = type + 4;
+        if (length > size - offset - 12 || ReadBigEndian32(chunk + length) != Crc32(type, length + 4)) {
+            return false;
+        }
+
+        if (0 == memcmp(type, "IHDR", 4)) {
+            // 8 bit RGB or RGBA, deflate, standard filters, no interlace.
+            if (length < 13 || 8 != chunk[8] || (2 != chunk[9] && 6 != chunk[9]) || 0 != chunk[10] || 0 != chunk[11] || 0 != chunk[12]) {
+                return false;
+            }
+            width = ReadBigEndian32(chunk);
+            height = ReadBigEndian32(chunk + 4);
+            channels = (6 == chunk[9]) ? 4 : 3;
+        } else if (0 == memcmp(type, "IDAT", 4)) {
+            compressed.insert(compressed.end(), chunk, chunk + length);
+        } else if (0 == memcmp(type, "IEND", 4)) {
+            ended = true;
+        }
+        offset += 12 + (size_t)length;
+    }
+    if (0 == width || 0 == height || 0 == channels) {
+        return false;
+    }
+
+    size_t rowBytes = (size_t)width * channels;
+    std::vector<uint8_t> raw;
+    raw.reserve((rowBytes + 1) * height);
+    if (!InflateZlib(compressed.data(), compressed.size(), raw) || raw.size() < (rowBytes + 1) * height) {
+        return false;
+    }
+
+    // Undo the per row filters in place, each row predicts from the reconstructed one above.
+    std::vector<uint8_t> pixels(rowBytes * height);
+    for (uint32_t y = 0; y < height; y++) {
+        uint8_t filter = raw[(rowBytes + 1) * y];
+        const uint8_t* source = raw.data() + (rowBytes + 1) * y + 1;
+        uint8_t* row = pixels.data() + rowBytes * y;
+        const uint8_t* previous = (y > 0) ? row - rowBytes : nullptr;
+        for (size_t x = 0; x < rowBytes; x++) {
+            int left = (x >= channels) ? row[x - channels] : 0;
+            int up = (nullptr != previous) ? previous[x] : 0;
+            int upLeft = (nullptr != previous && x >= channels) ? previous[x - channels] : 0;
+            switch (filter) {
+            case 0: row[x] = source[x]; break;
+            case 1: row[x] = (uint8_t)(source[x] + left); break;
+            case 2: row[x] = (uint8_t)(source[x] + up); break;
+            case 3: row[x] = (uint8_t)(source[x] + ((left + up) >> 1)); break;
+            case 4: row[x] = (uint8_t)(source[x] + PaethPredictor(left, up, upLeft)); break;
+            default: return false;
+            }
+        }
+    }
+
+    if (4 == channels) {
+        rgba.swap(pixels);
+        return true;
+    }
+    rgba.resize((size_t)width * height * 4);
+    for (size_t i = 0, count = (size_t)width * height; i < count; i++) {
+        rgba[i * 4 + 0] = pixels[i * 3 + 0];
+        rgba[i * 4 + 1] = pixels[i * 3 + 1];
+        rgba[i * 4 + 2] = pixels[i * 3 + 2];
+        rgba[i * 4 + 3] = 255;
+    }
+    return true;
+}
+
+__END_NAMESPACE
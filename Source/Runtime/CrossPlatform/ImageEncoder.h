@@ -0,0 +1,19 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+/**
+ * 8 bit RGBA to PNG. Rows are written unfiltered in stored deflate blocks: encoding is a memcpy plus
+ * checksums, so it never becomes the bottleneck of a render service, at the cost of larger files.
+ */
+bool EncodePNG(const uint8_t* rgba, uint32_t width, uint32_t height, std::vector<uint8_t>& output);
+
+// 8 bit RGB or RGBA PNG, any filter & deflate mode, to RGBA. Enough for golden images re-saved by other tools.
+bool DecodePNG(const uint8_t* data, size_t size, uint32_t& width, uint32_t& height, std::vector<uint8_t>& rgba);
+
+uint32_t Crc32(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+
+__END_NAMESPACE
@@ -0,0 +1,95 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+static const size_t MPSC_CACHE_LINE_SIZE = 64;
+
+
+/**
+ * Bounded lock-free queue for many producer threads & a single consumer thread.
+ * Each cell carries a sequence number: producers claim a position with one CAS on the tail, write the value
+ * and publish it by bumping the cell's sequence, the consumer only reads its own head and the cell sequences.
+ * Nobody ever blocks, TryPush() fails when the consumer is Capacity values behind.
+ */
+template <typename T, size_t Capacity>
+class MPSCQueue
+{
+	static_assert(Capacity >= 2 && 0 == (Capacity & (Capacity - 1)), "MPSCQueue capacity must be a power of two");
+
+public:
+	MPSCQueue() :
+		m_Tail(0),
+		m_Head(0)
+	{
+		for (size_t i = 0; i < Capacity; i++) {
+			m_Cells[i].m_Sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	MPSCQueue(const MPSCQueue&) = delete;
+	MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+	// Any thread. False when the queue is full, value is then left untouched.
+	template <typename U>
+	bool TryPush(U&& value)
+	{
+		size_t position = m_Tail.load(std::memory_order_relaxed);
+		for (;;) {
+			Cell& cell = m_Cells[position & (Capacity - 1)];
+			size_t sequence = cell.m_Sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+			if (0 == difference) {
+				// Free cell, on failure position is reloaded with the current tail.
+				if (m_Tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					cell.m_Value = std::forward<U>(value);
+					cell.m_Sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			} else if (difference < 0) {
+				// Still holds the value pushed one lap ago.
+				return false;
+			} else {
+				position = m_Tail.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	// Consumer thread only. False when empty, or when the oldest claimed cell isn't published yet.
+	bool TryPop(T& value)
+	{
+		Cell& cell = m_Cells[m_Head & (Capacity - 1)];
+		if (cell.m_Sequence.load(std::memory_order_acquire) != m_Head + 1) {
+			return false;
+		}
+		value = std::move(cell.m_Value);
+		cell.m_Value = T();    // Don't keep what the moved from value still owns alive for a lap
+		cell.m_Sequence.store(m_Head + Capacity, std::memory_order_release);
+		m_Head++;
+		return true;
+	}
+
+	// Consumer thread only, approximate while producers are pushing.
+	size_t GetSize() const
+	{
+		size_t tail = m_Tail.load(std::memory_order_relaxed);
+		return tail > m_Head ? tail - m_Head : 0;
+	}
+
+	static constexpr size_t GetCapacity() { return Capacity; }
+
+private:
+	typedef struct Cell {
+		std::atomic<size_t>   m_Sequence;
+		T                     m_Value;
+	} Cell;
+
+	// Producers hammer the tail, keep it off the consumer's line.
+	alignas(MPSC_CACHE_LINE_SIZE) std::atomic<size_t>   m_Tail;
+	alignas(MPSC_CACHE_LINE_SIZE) size_t                m_Head;
+	alignas(MPSC_CACHE_LINE_SIZE) Cell                  m_Cells[Capacity];
+};
+
+
+__END_NAMESPACE
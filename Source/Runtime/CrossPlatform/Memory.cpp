@@ -0,0 +1,433 @@
+#include "CrossPlatform.h"
+#include "Platform.h"
+#include "StandardC.h"
+#include "StandardCXX.h"
+#include "Memory.h"
+#include "Profiler.h"
+
+
+__BEGIN_NAMESPACE
+
+/*****************************************************************************************
+* Tagged heap
+*****************************************************************************************/
+static const uint32_t MEMORY_HEADER_MAGIC = 0x4B4D454D;   // "KMEM"
+
+// Sits right in front of every payload returned by MemoryAllocate().
+struct AllocationHeader
+{
+#if MEMORY_TRACK_LEAKS
+    AllocationHeader*   m_Prev;
+    AllocationHeader*   m_Next;
+    uint64_t            m_Serial;
+#endif
+    size_t              m_Size;
+    uint32_t            m_Offset;
+    uint32_t            m_Magic;
+    MemoryTag           m_Tag;
+    uint8_t             m_Padding[7];
+};
+
+struct TagCounters
+{
+    std::atomic<size_t> m_CurrentBytes;
+    std::atomic<size_t> m_PeakBytes;
+    std::atomic<size_t> m_CurrentAllocations;
+    std::atomic<size_t> m_TotalAllocations;
+};
+
+static TagCounters g_TagCounters[(size_t)MemoryTag::Count];
+
+#if MEMORY_TRACK_LEAKS
+static std::mutex g_LiveMutex;
+static AllocationHeader* g_LiveHead = nullptr;
+static std::atomic<uint64_t> g_AllocationSerial(0);
+#endif
+
+static const char* g_MemoryTagNames[(size_t)MemoryTag::Count] =
+{
+    "General",
+    "Application",
+    "GraphicDriver",
+    "Vulkan",
+    "FrameArena",
+    "Pool",
+    "Container",
+    "Profiler",
+};
+
+const char* GetMemoryTagName(MemoryTag tag)
+{
+    return (tag < MemoryTag::Count) ? g_MemoryTagNames[(size_t)tag] : "Unknown";
+}
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+static AllocationHeader* GetHeader(const void* memory)
+{
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(const_cast<uint8_t*>(static_cast<const uint8_t*>(memory)) - sizeof(AllocationHeader));
+    assert(MEMORY_HEADER_MAGIC == header->m_Magic && "Memory was not allocated by MemoryAllocate");
+    return header;
+}
+
+static void TrackAllocation(AllocationHeader* header)
+{
+    TagCounters& counters = g_TagCounters[(size_t)header->m_Tag];
+    size_t current = counters.m_CurrentBytes.fetch_add(header->m_Size, std::memory_order_relaxed) + header->m_Size;
+    size_t peak = counters.m_PeakBytes.load(std::memory_order_relaxed);
+    while (current > peak && !counters.m_PeakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+    }
+    counters.m_CurrentAllocations.fetch_add(1, std::memory_order_relaxed);
+    counters.m_TotalAllocations.fetch_add(1, std::memory_order_relaxed);
+
+#if MEMORY_TRACK_LEAKS
+    header->m_Serial = g_AllocationSerial.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(g_LiveMutex);
+    header->m_Prev = nullptr;
+    header->m_Next = g_LiveHead;
+    if (nullptr != g_LiveHead) {
+        g_LiveHead->m_Prev = header;
+    }
+    g_LiveHead = header;
+#endif
+}
+
+static void UntrackAllocation(AllocationHeader* header)
+{
+    TagCounters& counters = g_TagCounters[(size_t)header->m_Tag];
+    counters.m_CurrentBytes.fetch_sub(header->m_Size, std::memory_order_relaxed);
+    counters.m_CurrentAllocations.fetch_sub(1, std::memory_order_relaxed);
+
+#if MEMORY_TRACK_LEAKS
+    std::lock_guard<std::mutex> lock(g_LiveMutex);
+    if (nullptr != header->m_Prev) {
+        header->m_Prev->m_Next = header->m_Next;
+    }
+    else {
+        g_LiveHead = header->m_Next;
+    }
+    if (nullptr != header->m_Next) {
+        header->m_Next->m_Prev = header->m_Prev;
+    }
+#endif
+}
+
+void* MemoryAllocate(size_t size, MemoryTag tag, size_t alignment)
+{
+    // Alignment must be a power of two, the header needs at least pointer alignment.
+    alignment = std::max(alignment, alignof(AllocationHeader));
+    assert(0 == (alignment & (alignment - 1)));
+
+    uint8_t* raw = static_cast<uint8_t*>(malloc(sizeof(AllocationHeader) + alignment - 1 + size));
+    if (nullptr == raw) {
+        SetErrorCode(ErrorCode::UnKnow);
+        return nullptr;
+    }
+
+    uint8_t* memory = reinterpret_cast<uint8_t*>(AlignUp((size_t)(raw + sizeof(AllocationHeader)), alignment));
+    AllocationHeader* header = reinterpret_cast<AllocationHeader*>(memory - sizeof(AllocationHeader));
+    header->m_Size = size;
+    header->m_Offset = (uint32_t)(memory - raw);
+    header->m_Magic = MEMORY_HEADER_MAGIC;
+    header->m_Tag = (tag < MemoryTag::Count) ? tag : MemoryTag::General;
+    TrackAllocation(header);
+    return memory;
+}
+
+void* MemoryReallocate(void* memory, size_t size, MemoryTag tag, size_t alignment)
+{
+    if (nullptr == memory) {
+        return MemoryAllocate(size, tag, alignment);
+    }
+    if (0 == size) {
+        MemoryFree(memory);
+        return nullptr;
+    }
+
+    // Always moves, keeps the alignment contract simple for Vulkan reallocations.
+    void* resized = MemoryAllocate(size, tag, alignment);
+    if (nullptr == resized) {
+        return nullptr;
+    }
+    memcpy(resized, memory, std::min(size, GetHeader(memory)->m_Size));
+    MemoryFree(memory);
+    return resized;
+}
+
+void MemoryFree(void* memory)
+{
+    if (nullptr == memory) {
+        return;
+    }
+
+    AllocationHeader* header = GetHeader(memory);
+    UntrackAllocation(header);
+    header->m_Magic = 0;
+    free(static_cast<uint8_t*>(memory) - header->m_Offset);
+}
+
+size_t MemorySize(const void* memory)
+{
+    return (nullptr != memory) ? GetHeader(memory)->m_Size : 0;
+}
+
+void GetMemoryStatistics(MemoryTag tag, MemoryTagStatistics& statistics)
+{
+    const TagCounters& counters = g_TagCounters[(size_t)tag];
+    statistics.m_CurrentBytes = counters.m_CurrentBytes.load(std::memory_order_relaxed);
+    statistics.m_PeakBytes = counters.m_PeakBytes.load(std::memory_order_relaxed);
+    statistics.m_CurrentAllocations = counters.m_CurrentAllocations.load(std::memory_order_relaxed);
+    statistics.m_TotalAllocations = counters.m_TotalAllocations.load(std::memory_order_relaxed);
+}
+
+void ReportMemory()
+{
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    std::cout << "Memory report:\n";
+    std::cout << "  " << std::left << std::setw(16) << "Tag" << std::right
+        << " " << std::setw(14) << "Current(KB)" << " " << std::setw(14) << "Peak(KB)"
+        << " " << std::setw(10) << "Live" << " " << std::setw(12) << "Total" << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < (size_t)MemoryTag::Count; i++) {
+        MemoryTagStatistics statistics;
+        GetMemoryStatistics((MemoryTag)i, statistics);
+        std::cout << "  " << std::left << std::setw(16) << g_MemoryTagNames[i] << std::right
+            << " " << std::setw(14) << statistics.m_CurrentBytes / 1024.0 << " " << std::setw(14) << statistics.m_PeakBytes / 1024.0
+            << " " << std::setw(10) << statistics.m_CurrentAllocations << " " << std::setw(12) << statistics.m_TotalAllocations << "\n";
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
+size_t ReportMemoryLeaks(size_t maxReported)
+{
+    size_t leaks = 0;
+    for (size_t i = 0; i < (size_t)MemoryTag::Count; i++) {
+        leaks += g_TagCounters[i].m_CurrentAllocations.load(std::memory_order_relaxed);
+    }
+    if (0 == leaks) {
+        return 0;
+    }
+
+    std::cout << "Memory leaks: " << leaks << " allocation(s) still alive\n";
+#if MEMORY_TRACK_LEAKS
+    std::lock_guard<std::mutex> lock(g_LiveMutex);
+    size_t reported = 0;
+    for (AllocationHeader* header = g_LiveHead; nullptr != header && reported < maxReported; header = header->m_Next, reported++) {
+        std::cout << "  #" << header->m_Serial << " " << header->m_Size << " bytes [" << GetMemoryTagName(header->m_Tag)
+            << "] at " << static_cast<const void*>(reinterpret_cast<uint8_t*>(header) + sizeof(AllocationHeader)) << "\n";
+    }
+#else
+    (void)maxReported;
+#endif
+    return leaks;
+}
+
+
+
+/*****************************************************************************************
+* Pool allocator
+*****************************************************************************************/
+static const uint32_t POOL_MAX_COUNT = 64;
+static const uint32_t POOL_CACHE_CAPACITY = 32;
+static const uint32_t POOL_CACHE_BATCH = POOL_CACHE_CAPACITY / 2;
+
+struct PoolSlot
+{
+    PoolAllocator*  m_Pool;
+    uint32_t        m_Generation;
+};
+
+static std::mutex g_PoolSlotMutex;
+static PoolSlot g_PoolSlots[POOL_MAX_COUNT];
+static uint32_t g_PoolGeneration = 0;
+
+// Free blocks a thread holds back for one pool, dropped if the pool was recreated meanwhile.
+struct PoolThreadCache
+{
+    uint32_t    m_Generation;
+    uint32_t    m_Count;
+    void*       m_Blocks[POOL_CACHE_CAPACITY];
+};
+
+struct PoolThreadCaches
+{
+    PoolThreadCache m_Caches[POOL_MAX_COUNT];
+
+    PoolThreadCaches()
+    {
+        memset(m_Caches, 0, sizeof(m_Caches));
+    }
+
+    ~PoolThreadCaches()
+    {
+        // Give cached blocks back so they aren't lost when a worker thread exits.
+        std::lock_guard<std::mutex> lock(g_PoolSlotMutex);
+        for (uint32_t i = 0; i < POOL_MAX_COUNT; i++) {
+            PoolThreadCache& cache = m_Caches[i];
+            if (0 != cache.m_Count && nullptr != g_PoolSlots[i].m_Pool && cache.m_Generation == g_PoolSlots[i].m_Generation) {
+                g_PoolSlots[i].m_Pool->FreeBatch(cache.m_Count, cache.m_Blocks);
+            }
+            cache.m_Count = 0;
+        }
+    }
+};
+
+static thread_local PoolThreadCaches t_PoolThreadCaches;
+
+PoolAllocator::PoolAllocator() :
+	m_FreeList(nullptr),
+	m_BlockSize(0),
+	m_BlocksPerPage(0),
+	m_Tag(MemoryTag::Pool),
+	m_PoolIndex(POOL_MAX_COUNT),
+	m_Generation(0),
+	m_LiveBlocks(0)
+{
+}
+
+PoolAllocator::~PoolAllocator()
+{
+    CleanUp();
+}
+
+bool PoolAllocator::Initial(size_t blockSize, size_t blocksPerPage, MemoryTag tag)
+{
+    CleanUp();
+
+    std::lock_guard<std::mutex> lock(g_PoolSlotMutex);
+    for (uint32_t i = 0; i < POOL_MAX_COUNT; i++) {
+        if (nullptr == g_PoolSlots[i].m_Pool) {
+            m_PoolIndex = i;
+            break;
+        }
+    }
+    if (POOL_MAX_COUNT == m_PoolIndex) {
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    // A free block stores the next link in place.
+    m_BlockSize = AlignUp(std::max(blockSize, sizeof(void*)), sizeof(void*));
+    m_BlocksPerPage = std::max(blocksPerPage, (size_t)1);
+    m_Tag = tag;
+    m_Generation = ++g_PoolGeneration;
+    g_PoolSlots[m_PoolIndex].m_Pool = this;
+    g_PoolSlots[m_PoolIndex].m_Generation = m_Generation;
+    return true;
+}
+
+bool PoolAllocator::AllocatePage()
+{
+    uint8_t* page = static_cast<uint8_t*>(MemoryAllocate(m_BlockSize * m_BlocksPerPage, m_Tag));
+    if (nullptr == page) {
+        return false;
+    }
+    m_Pages.push_back(page);
+
+    for (size_t i = m_BlocksPerPage; i > 0; i--) {
+        void* block = page + (i - 1) * m_BlockSize;
+        *reinterpret_cast<void**>(block) = m_FreeList;
+        m_FreeList = block;
+    }
+    return true;
+}
+
+size_t PoolAllocator::AllocateBatch(size_t count, void** blocks)
+{
+    PROFILE_LOCK(m_Mutex, "PoolAllocator");
+    size_t allocated = 0;
+    while (allocated < count) {
+        if (nullptr == m_FreeList && !AllocatePage()) {
+            break;
+        }
+        blocks[allocated++] = m_FreeList;
+        m_FreeList = *reinterpret_cast<void**>(m_FreeList);
+    }
+    return allocated;
+}
+
+void PoolAllocator::FreeBatch(size_t count, void** blocks)
+{
+    PROFILE_LOCK(m_Mutex, "PoolAllocator");
+    for (size_t i = 0; i < count; i++) {
+        *reinterpret_cast<void**>(blocks[i]) = m_FreeList;
+        m_FreeList = blocks[i];
+    }
+}
+
+void* PoolAllocator::Allocate()
+{
+    if (POOL_MAX_COUNT == m_PoolIndex) {
+        return nullptr;
+    }
+
+    PoolThreadCache& cache = t_PoolThreadCaches.m_Caches[m_PoolIndex];
+    if (cache.m_Generation != m_Generation) {
+        cache.m_Generation = m_Generation;
+        cache.m_Count = 0;
+    }
+    if (0 == cache.m_Count) {
+        cache.m_Count = (uint32_t)AllocateBatch(POOL_CACHE_BATCH, cache.m_Blocks);
+        if (0 == cache.m_Count) {
+            SetErrorCode(ErrorCode::UnKnow);
+            return nullptr;
+        }
+    }
+
+    m_LiveBlocks.fetch_add(1, std::memory_order_relaxed);
+    return cache.m_Blocks[--cache.m_Count];
+}
+
+void PoolAllocator::Free(void* block)
+{
+    if (nullptr == block || POOL_MAX_COUNT == m_PoolIndex) {
+        return;
+    }
+
+    PoolThreadCache& cache = t_PoolThreadCaches.m_Caches[m_PoolIndex];
+    if (cache.m_Generation != m_Generation) {
+        cache.m_Generation = m_Generation;
+        cache.m_Count = 0;
+    }
+    if (POOL_CACHE_CAPACITY == cache.m_Count) {
+        cache.m_Count -= POOL_CACHE_BATCH;
+        FreeBatch(POOL_CACHE_BATCH, cache.m_Blocks + cache.m_Count);
+    }
+
+    cache.m_Blocks[cache.m_Count++] = block;
+    m_LiveBlocks.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void PoolAllocator::CleanUp()
+{
+    if (POOL_MAX_COUNT == m_PoolIndex) {
+        return;
+    }
+
+    size_t live = m_LiveBlocks.load(std::memory_order_relaxed);
+    if (0 != live) {
+        std::cout << "PoolAllocator (" << GetMemoryTagName(m_Tag) << ", " << m_BlockSize << " bytes) leaked " << live << " block(s)\n";
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(g_PoolSlotMutex);
+        g_PoolSlots[m_PoolIndex].m_Pool = nullptr;
+    }
+    // Other threads' caches notice the generation change and drop their stale blocks.
+    t_PoolThreadCaches.m_Caches[m_PoolIndex].m_Count = 0;
+
+    for (void* page : m_Pages) {
+        MemoryFree(page);
+    }
+    m_Pages.clear();
+    m_FreeList = nullptr;
+    m_PoolIndex = POOL_MAX_COUNT;
+    m_LiveBlocks.store(0, std::memory_order_relaxed);
+}
+
+__END_NAMESPACE
@@ -0,0 +1,143 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+// Heap allocations are tagged by the subsystem owning them, reported by ReportMemory().
+enum class MemoryTag : uint8_t
+{
+	General = 0,
+	Application,
+	GraphicDriver,
+	Vulkan,          // Host memory requested by the Vulkan implementation through VkAllocationCallbacks
+	FrameArena,
+	Pool,
+	Container,
+	Profiler,
+
+	Count,
+};
+
+static const size_t MEMORY_DEFAULT_ALIGNMENT = 16;
+
+// Leak tracking keeps every live allocation in a list, it's compiled out with the CRT debug heap.
+#if !defined(RELEASE) && !defined(_RELEASE)
+#define MEMORY_TRACK_LEAKS 1
+#else
+#define MEMORY_TRACK_LEAKS 0
+#endif
+
+
+typedef struct MemoryTagStatistics {
+	size_t      m_CurrentBytes;
+	size_t      m_PeakBytes;
+	size_t      m_CurrentAllocations;
+	size_t      m_TotalAllocations;
+} MemoryTagStatistics;
+
+
+const char* GetMemoryTagName(MemoryTag tag);
+
+void* MemoryAllocate(size_t size, MemoryTag tag, size_t alignment = MEMORY_DEFAULT_ALIGNMENT);
+void* MemoryReallocate(void* memory, size_t size, MemoryTag tag, size_t alignment = MEMORY_DEFAULT_ALIGNMENT);
+void MemoryFree(void* memory);
+size_t MemorySize(const void* memory);
+
+void GetMemoryStatistics(MemoryTag tag, MemoryTagStatistics& statistics);
+// Memory by subsystem, printed at shutdown.
+void ReportMemory();
+// Prints live allocations (up to maxReported) and returns how many are still alive.
+size_t ReportMemoryLeaks(size_t maxReported = 32);
+
+
+template <typename T, typename... Args>
+T* New(MemoryTag tag, Args&&... args)
+{
+	void* memory = MemoryAllocate(sizeof(T), tag, alignof(T) > MEMORY_DEFAULT_ALIGNMENT ? alignof(T) : MEMORY_DEFAULT_ALIGNMENT);
+	return (nullptr != memory) ? new (memory) T(std::forward<Args>(args)...) : nullptr;
+}
+
+template <typename T>
+void Delete(T* object)
+{
+	if (nullptr != object) {
+		object->~T();
+		MemoryFree(object);
+	}
+}
+
+
+// STL allocator charging a container's storage to a tag.
+template <typename T, MemoryTag Tag>
+class TaggedAllocator
+{
+public:
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind { typedef TaggedAllocator<U, Tag> other; };
+
+	TaggedAllocator() noexcept {}
+	template <typename U>
+	TaggedAllocator(const TaggedAllocator<U, Tag>&) noexcept {}
+
+	T* allocate(size_t count)
+	{
+		void* memory = MemoryAllocate(sizeof(T) * count, Tag, alignof(T) > MEMORY_DEFAULT_ALIGNMENT ? alignof(T) : MEMORY_DEFAULT_ALIGNMENT);
+		if (nullptr == memory) {
+			throw std::bad_alloc();
+		}
+		return static_cast<T*>(memory);
+	}
+	void deallocate(T* memory, size_t) noexcept { MemoryFree(memory); }
+
+	template <typename U>
+	bool operator==(const TaggedAllocator<U, Tag>&) const noexcept { return true; }
+	template <typename U>
+	bool operator!=(const TaggedAllocator<U, Tag>&) const noexcept { return false; }
+};
+
+template <typename T, MemoryTag Tag = MemoryTag::Container>
+using TaggedVector = std::vector<T, TaggedAllocator<T, Tag>>;
+
+
+/**
+ * Fixed-size block allocator. Blocks come from pages of the owner's tag, each thread keeps a small
+ * cache of free blocks per pool so steady allocate/free pairs don't touch the shared free list lock.
+ * CleanUp() must run after every other thread has stopped using the pool.
+ */
+class PoolAllocator
+{
+public:
+	PoolAllocator();
+	virtual ~PoolAllocator();
+
+	bool Initial(size_t blockSize, size_t blocksPerPage, MemoryTag tag);
+	void* Allocate();
+	void Free(void* block);
+	void CleanUp();
+
+	size_t GetBlockSize() const { return m_BlockSize; }
+	size_t GetLiveBlocks() const { return m_LiveBlocks.load(std::memory_order_relaxed); }
+
+	// Used by the thread caches.
+	size_t AllocateBatch(size_t count, void** blocks);
+	void FreeBatch(size_t count, void** blocks);
+
+private:
+	std::mutex             m_Mutex;
+	void*                  m_FreeList;
+	std::vector<void*>     m_Pages;
+	size_t                 m_BlockSize;
+	size_t                 m_BlocksPerPage;
+	MemoryTag              m_Tag;
+	uint32_t               m_PoolIndex;
+	uint32_t               m_Generation;
+	std::atomic<size_t>    m_LiveBlocks;
+
+	bool AllocatePage();
+};
+
+
+__END_NAMESPACE
@@ -13,6 +13,8 @@
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 #include <WinSock2.h>  
+#include <intrin.h>
+#include <timeapi.h>
 #else
 
 #endif
\ No newline at end of file
@@ -0,0 +1,181 @@
+#include "CrossPlatform.h"
+#include "Platform.h"
+#include "StandardC.h"
+#include "StandardCXX.h"
+#include "Memory.h"
+#include "Profiler.h"
+
+
+#if PROFILER_ENABLED
+
+__BEGIN_NAMESPACE
+
+static const size_t PROFILE_DEFAULT_EVENTS_PER_THREAD = 64 * 1024;
+
+thread_local ProfileThreadBuffer* t_ProfileThreadBuffer = nullptr;
+
+static std::mutex g_ProfileMutex;
+static std::vector<ProfileThreadBuffer*> g_ProfileThreads;
+static size_t g_ProfileEventsPerThread = PROFILE_DEFAULT_EVENTS_PER_THREAD;
+static uint32_t g_ProfileNextThreadID = 0;
+
+std::atomic<bool> g_ProfileCapturing(false);
+static uint64_t g_CaptureBeginTicks = 0;
+static std::chrono::steady_clock::time_point g_CaptureBeginTime;
+
+void Profiler::Initial(size_t eventsPerThread)
+{
+    size_t capacity = 1;
+    while (capacity < eventsPerThread) {
+        capacity <<= 1;
+    }
+    std::lock_guard<std::mutex> lock(g_ProfileMutex);
+    g_ProfileEventsPerThread = capacity;
+}
+
+ProfileThreadBuffer* Profiler::RegisterThread()
+{
+    std::lock_guard<std::mutex> lock(g_ProfileMutex);
+    ProfileThreadBuffer* buffer = New<ProfileThreadBuffer>(MemoryTag::Profiler);
+    buffer->m_Events = static_cast<ProfileEvent*>(MemoryAllocate(sizeof(ProfileEvent) * g_ProfileEventsPerThread, MemoryTag::Profiler, 64));
+    buffer->m_Mask = g_ProfileEventsPerThread - 1;
+    buffer->m_WriteIndex.store(0, std::memory_order_relaxed);
+    buffer->m_ThreadID = ++g_ProfileNextThreadID;
+    snprintf(buffer->m_Name, sizeof(buffer->m_Name), "Thread %u", buffer->m_ThreadID);
+    g_ProfileThreads.push_back(buffer);
+
+    t_ProfileThreadBuffer = buffer;
+    return buffer;
+}
+
+void Profiler::SetThreadName(const char* name)
+{
+    ProfileThreadBuffer* buffer = (nullptr != t_ProfileThreadBuffer) ? t_ProfileThreadBuffer : RegisterThread();
+    std::lock_guard<std::mutex> lock(g_ProfileMutex);
+    snprintf(buffer->m_Name, sizeof(buffer->m_Name), "%s", name);
+}
+
+void Profiler::CleanUp()
+{
+    std::lock_guard<std::mutex> lock(g_ProfileMutex);
+    for (ProfileThreadBuffer* buffer : g_ProfileThreads) {
+        MemoryFree(buffer->m_Events);
+        Delete(buffer);
+    }
+    g_ProfileThreads.clear();
+    g_ProfileThreads.shrink_to_fit();
+    t_ProfileThreadBuffer = nullptr;
+    g_ProfileCapturing.store(false, std::memory_order_relaxed);
+}
+
+void Profiler::BeginCapture()
+{
+    std::lock_guard<std::mutex> lock(g_ProfileMutex);
+    g_CaptureBeginTime = std::chrono::steady_clock::now();
+    g_CaptureBeginTicks = ProfileTicks();
+    g_ProfileCapturing.store(true, std::memory_order_relaxed);
+}
+
+void Profiler::CancelCapture()
+{
+    g_ProfileCapturing.store(false, std::memory_order_relaxed);
+}
+
+static void WriteJsonString(std::ofstream& file, const char* text)
+{
+    file << '"';
+    for (const char* c = text; '\0' != *c; c++) {
+        if ('"' == *c || '\\' == *c) {
+            file << '\\';
+        }
+        file << (((unsigned char)*c < 0x20) ? ' ' : *c);
+    }
+    file << '"';
+}
+
+bool Profiler::EndCapture(const char* path)
+{
+    if (!g_ProfileCapturing.exchange(false, std::memory_order_relaxed)) {
+        return false;
+    }
+
+    uint64_t endTicks = ProfileTicks();
+    std::chrono::steady_clock::time_point endTime = std::chrono::steady_clock::now();
+    double microseconds = std::chrono::duration<double, std::micro>(endTime - g_CaptureBeginTime).count();
+    // Tick rate is measured over the capture itself, no start-up calibration needed.
+    double ticksPerMicrosecond = (microseconds > 0.0 && endTicks > g_CaptureBeginTicks) ? (endTicks - g_CaptureBeginTicks) / microseconds : 1.0;
+
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "Profiler failed to open " << path << "\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    file.precision(3);
+    file << std::fixed << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    TaggedVector<ProfileEvent, MemoryTag::Profiler> events;
+    size_t written = 0;
+    bool first = true;
+
+    std::lock_guard<std::mutex> lock(g_ProfileMutex);
+    for (ProfileThreadBuffer* buffer : g_ProfileThreads) {
+        uint64_t capacity = buffer->m_Mask + 1;
+        uint64_t end = buffer->m_WriteIndex.load(std::memory_order_acquire);
+        uint64_t begin = (end > capacity) ? end - capacity : 0;
+        events.resize((size_t)(end - begin));
+        for (uint64_t i = begin; i < end; i++) {
+            events[(size_t)(i - begin)] = buffer->m_Events[i & buffer->m_Mask];
+        }
+
+        // Anything the owner may have overwritten while copying is dropped, plus the slot it may be writing now.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t after = buffer->m_WriteIndex.load(std::memory_order_relaxed);
+        uint64_t valid = (after + 1 > capacity) ? after + 1 - capacity : 0;
+        size_t skip = (valid > begin) ? (size_t)std::min(valid - begin, end - begin) : 0;
+
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->m_ThreadID << ",\"args\":{\"name\":";
+        WriteJsonString(file, buffer->m_Name);
+        file << "}}";
+        first = false;
+
+        for (size_t i = skip; i < events.size(); i++) {
+            const ProfileEvent& event = events[i];
+            if (event.m_Begin < g_CaptureBeginTicks) {
+                continue;
+            }
+
+            double timestamp = (event.m_Begin - g_CaptureBeginTicks) / ticksPerMicrosecond;
+            file << ",\n{\"name\":";
+            WriteJsonString(file, event.m_Name);
+            file << ",\"pid\":1,\"tid\":" << buffer->m_ThreadID << ",\"ts\":" << timestamp;
+            switch (event.m_Type) {
+            case ProfileEventType::Zone:
+                file << ",\"ph\":\"X\",\"dur\":" << (event.m_End - event.m_Begin) / ticksPerMicrosecond << "}";
+                break;
+            case ProfileEventType::LockWait:
+                file << ",\"ph\":\"X\",\"cat\":\"Lock\",\"dur\":" << (event.m_End - event.m_Begin) / ticksPerMicrosecond << "}";
+                break;
+            case ProfileEventType::Counter:
+                file << ",\"ph\":\"C\",\"args\":{\"value\":" << event.m_Value << "}}";
+                break;
+            case ProfileEventType::FrameMark:
+                file << ",\"ph\":\"i\",\"s\":\"g\"}";
+                break;
+            }
+            written++;
+        }
+    }
+    file << "\n]}\n";
+
+    std::ios_base::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    std::cout << "Profiler wrote " << written << " events (" << std::fixed << std::setprecision(1) << microseconds / 1000.0 << " ms) to " << path << "\n";
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+    return true;
+}
+
+__END_NAMESPACE
+
+#endif
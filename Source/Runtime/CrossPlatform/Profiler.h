@@ -0,0 +1,189 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+// Instrumentation is compiled in for DEBUG and PROFILE, RELEASE builds get empty macros.
+#if !defined(RELEASE) && !defined(_RELEASE)
+#define PROFILER_ENABLED 1
+#else
+#define PROFILER_ENABLED 0
+#endif
+
+#define PROFILE_CONCAT_IMPL(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_IMPL(a, b)
+
+
+#if PROFILER_ENABLED
+
+enum class ProfileEventType : uint8_t
+{
+	Zone = 0,
+	LockWait,
+	Counter,
+	FrameMark,
+};
+
+typedef struct ProfileEvent {
+	const char*         m_Name;     // Must outlive the capture, string literals only.
+	uint64_t            m_Begin;
+	union {
+		uint64_t        m_End;
+		double          m_Value;
+	};
+	ProfileEventType    m_Type;
+} ProfileEvent;
+
+// Single writer ring, the owner thread publishes m_WriteIndex and the capture reads behind it.
+typedef struct ProfileThreadBuffer {
+	ProfileEvent*           m_Events;
+	uint64_t                m_Mask;
+	std::atomic<uint64_t>   m_WriteIndex;
+	uint32_t                m_ThreadID;
+	char                    m_Name[32];
+} ProfileThreadBuffer;
+
+extern thread_local ProfileThreadBuffer* t_ProfileThreadBuffer;
+// Events are only kept between BeginCapture() & EndCapture(), outside of it instrumentation reads this & nothing else.
+extern std::atomic<bool> g_ProfileCapturing;
+
+
+FORCEINLINE uint64_t ProfileTicks()
+{
+#if COMPILER == COMPILER_MSVC
+	return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+
+class Profiler
+{
+public:
+	// eventsPerThread is rounded up to a power of two, the ring keeps the most recent events.
+	static void Initial(size_t eventsPerThread);
+	// Other threads must have stopped recording.
+	static void CleanUp();
+	static void SetThreadName(const char* name);
+
+	// Writes Chrome trace JSON (chrome://tracing, ui.perfetto.dev) of the events since BeginCapture().
+	static void BeginCapture();
+	static bool EndCapture(const char* path);
+	// Stops capturing without writing anything.
+	static void CancelCapture();
+	static FORCEINLINE bool IsCapturing() { return g_ProfileCapturing.load(std::memory_order_relaxed); }
+
+	static ProfileThreadBuffer* RegisterThread();
+
+	static FORCEINLINE void WriteEvent(ProfileEventType type, const char* name, uint64_t begin, uint64_t end)
+	{
+		ProfileThreadBuffer* buffer = t_ProfileThreadBuffer;
+		if (nullptr == buffer) {
+			buffer = RegisterThread();
+		}
+		uint64_t index = buffer->m_WriteIndex.load(std::memory_order_relaxed);
+		ProfileEvent& event = buffer->m_Events[index & buffer->m_Mask];
+		event.m_Name = name;
+		event.m_Begin = begin;
+		event.m_End = end;
+		event.m_Type = type;
+		buffer->m_WriteIndex.store(index + 1, std::memory_order_release);
+	}
+
+	static FORCEINLINE void Counter(const char* name, double value)
+	{
+		if (!IsCapturing()) {
+			return;
+		}
+		ProfileThreadBuffer* buffer = t_ProfileThreadBuffer;
+		if (nullptr == buffer) {
+			buffer = RegisterThread();
+		}
+		uint64_t index = buffer->m_WriteIndex.load(std::memory_order_relaxed);
+		ProfileEvent& event = buffer->m_Events[index & buffer->m_Mask];
+		event.m_Name = name;
+		event.m_Begin = ProfileTicks();
+		event.m_Value = value;
+		event.m_Type = ProfileEventType::Counter;
+		buffer->m_WriteIndex.store(index + 1, std::memory_order_release);
+	}
+
+	static FORCEINLINE void FrameMark()
+	{
+		if (!IsCapturing()) {
+			return;
+		}
+		uint64_t now = ProfileTicks();
+		WriteEvent(ProfileEventType::FrameMark, "Frame", now, now);
+	}
+};
+
+
+// Zones begun outside of a capture read no ticks & write nothing, see ProfilerBenchmark.h for what one costs.
+class ProfileZoneScope
+{
+public:
+	FORCEINLINE ProfileZoneScope(const char* name) : m_Name(name), m_Begin(Profiler::IsCapturing() ? ProfileTicks() : 0) {}
+	FORCEINLINE ~ProfileZoneScope()
+	{
+		if (0 != m_Begin) {
+			Profiler::WriteEvent(ProfileEventType::Zone, m_Name, m_Begin, ProfileTicks());
+		}
+	}
+
+private:
+	const char*     m_Name;
+	uint64_t        m_Begin;        // 0 when not capturing
+};
+
+// Uncontended locks record nothing, contended ones record the time spent waiting while capturing.
+template <typename Mutex>
+class ProfileScopedLock
+{
+public:
+	FORCEINLINE ProfileScopedLock(Mutex& mutex, const char* name) : m_Mutex(mutex)
+	{
+		if (m_Mutex.try_lock()) {
+			return;
+		}
+		if (!Profiler::IsCapturing()) {
+			m_Mutex.lock();
+			return;
+		}
+		uint64_t begin = ProfileTicks();
+		m_Mutex.lock();
+		Profiler::WriteEvent(ProfileEventType::LockWait, name, begin, ProfileTicks());
+	}
+	FORCEINLINE ~ProfileScopedLock() { m_Mutex.unlock(); }
+
+	ProfileScopedLock(const ProfileScopedLock&) = delete;
+	ProfileScopedLock& operator=(const ProfileScopedLock&) = delete;
+
+private:
+	Mutex&          m_Mutex;
+};
+
+#define PROFILE_ZONE(name)              __NAMESPACE::ProfileZoneScope PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FUNCTION()              PROFILE_ZONE(__FUNCTION__)
+#define PROFILE_COUNTER(name, value)    __NAMESPACE::Profiler::Counter(name, (double)(value))
+#define PROFILE_FRAME_MARK()            __NAMESPACE::Profiler::FrameMark()
+#define PROFILE_THREAD_NAME(name)       __NAMESPACE::Profiler::SetThreadName(name)
+#define PROFILE_LOCK(mutex, name)       __NAMESPACE::ProfileScopedLock<std::remove_reference<decltype(mutex)>::type> PROFILE_CONCAT(profileLock, __LINE__)(mutex, name)
+
+#else
+
+#define PROFILE_ZONE(name)              ((void)0)
+#define PROFILE_FUNCTION()              ((void)0)
+#define PROFILE_COUNTER(name, value)    ((void)0)
+#define PROFILE_FRAME_MARK()            ((void)0)
+#define PROFILE_THREAD_NAME(name)       ((void)0)
+#define PROFILE_LOCK(mutex, name)       std::lock_guard<std::remove_reference<decltype(mutex)>::type> PROFILE_CONCAT(profileLock, __LINE__)(mutex)
+
+#endif
+
+
+__END_NAMESPACE
@@ -0,0 +1,102 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+/**
+ * Bounded hand-off of per-frame snapshots between one producer and one consumer thread.
+ * Count slots are reused in order: the producer fills one while the consumer works on another,
+ * so the producer can run at most Count - 1 frames ahead before BeginWrite() blocks.
+ */
+template <typename T, size_t Count>
+class SnapshotQueue
+{
+	static_assert(Count >= 2, "SnapshotQueue needs at least double buffering");
+
+public:
+	SnapshotQueue() :
+		m_WriteSlot(0),
+		m_ReadSlot(0),
+		m_Queued(0),
+		m_InUse(0),
+		m_Closed(false)
+	{
+	}
+
+	// Producer side. Returns nullptr once the queue is closed.
+	T* BeginWrite()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_CanWrite.wait(lock, [this] { return m_InUse < Count || m_Closed; });
+		return m_Closed ? nullptr : &m_Slots[m_WriteSlot];
+	}
+
+	void EndWrite()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_WriteSlot = (m_WriteSlot + 1) % Count;
+			m_Queued++;
+			m_InUse++;
+		}
+		m_CanRead.notify_one();
+	}
+
+	// Consumer side. Returns nullptr once the queue is closed and drained.
+	T* BeginRead()
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_CanRead.wait(lock, [this] { return m_Queued > 0 || m_Closed; });
+		if (0 == m_Queued) {
+			return nullptr;
+		}
+		m_Queued--;
+		return &m_Slots[m_ReadSlot];
+	}
+
+	void EndRead()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_ReadSlot = (m_ReadSlot + 1) % Count;
+			m_InUse--;
+		}
+		m_CanWrite.notify_one();
+	}
+
+	// Wakes both sides, snapshots already queued are still handed to the consumer.
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Closed = true;
+		}
+		m_CanRead.notify_all();
+		m_CanWrite.notify_all();
+	}
+
+	void Reset()
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_WriteSlot = 0;
+		m_ReadSlot = 0;
+		m_Queued = 0;
+		m_InUse = 0;
+		m_Closed = false;
+	}
+
+private:
+	T                           m_Slots[Count];
+	std::mutex                  m_Mutex;
+	std::condition_variable     m_CanWrite;
+	std::condition_variable     m_CanRead;
+	size_t                      m_WriteSlot;
+	size_t                      m_ReadSlot;
+	size_t                      m_Queued;      // Written, not yet picked up by the consumer
+	size_t                      m_InUse;       // Written or being consumed
+	bool                        m_Closed;
+};
+
+
+__END_NAMESPACE
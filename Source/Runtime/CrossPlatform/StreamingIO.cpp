@@ -0,0 +1,174 @@
+#include "CrossPlatform.h"
+#include "Platform.h"
+#include "StandardCXX.h"
+#include "Memory.h"
+#include "Profiler.h"
+#include "StreamingIO.h"
+
+
+__BEGIN_NAMESPACE
+
+static const uint32_t STREAMING_DEFAULT_WORKERS = 2;
+static const size_t STREAMING_REQUESTS_PER_PAGE = 256;
+
+StreamingIO::StreamingIO() :
+	m_QueueHead(nullptr),
+	m_QueueTail(nullptr),
+	m_Quit(false),
+	m_Pending(0),
+	m_BytesRead(0)
+{
+}
+
+StreamingIO::~StreamingIO()
+{
+}
+
+bool StreamingIO::Create(uint32_t workerCount)
+{
+    Destroy();
+
+    if (!m_RequestPool.Initial(sizeof(StreamingRequestNode), STREAMING_REQUESTS_PER_PAGE, MemoryTag::Pool)) {
+        return false;
+    }
+
+    if (0 == workerCount) {
+        workerCount = STREAMING_DEFAULT_WORKERS;
+    }
+    m_Workers.reserve(workerCount);
+    for (uint32_t worker = 0; worker < workerCount; worker++) {
+        m_Workers.emplace_back(&StreamingIO::WorkerMain, this);
+    }
+    return true;
+}
+
+void StreamingIO::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+        while (nullptr != m_QueueHead) {
+            StreamingRequestNode* node = m_QueueHead;
+            m_QueueHead = node->m_Next;
+            m_RequestPool.Free(node);
+        }
+        m_QueueTail = nullptr;
+    }
+    m_WorkReady.notify_all();
+    for (std::thread& worker : m_Workers) {
+        worker.join();
+    }
+    m_Workers.clear();
+    // After the joins, the workers' cached blocks went back to the pool when they exited.
+    m_RequestPool.CleanUp();
+    m_Files.clear();
+    m_Completed.clear();
+    m_Pending = 0;
+    m_Quit = false;
+}
+
+uint32_t StreamingIO::OpenFile(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return STREAMING_INVALID_FILE;
+    }
+
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    StreamingFile entry = { path, (uint64_t)file.tellg() };
+    m_Files.push_back(entry);
+    return (uint32_t)m_Files.size() - 1;
+}
+
+uint64_t StreamingIO::GetFileSize(uint32_t file) const
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    return (file < m_Files.size()) ? m_Files[file].m_Size : 0;
+}
+
+void StreamingIO::Read(const StreamingRequest& request)
+{
+    m_Pending++;
+    StreamingRequestNode* node = static_cast<StreamingRequestNode*>(m_RequestPool.Allocate());
+    if (nullptr == node) {
+        // Not created, or out of memory: completes as a failed read.
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        StreamingCompletion completion = { request.m_UserData, false };
+        m_Completed.push_back(completion);
+        return;
+    }
+    node->m_Request = request;
+    node->m_Next = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (nullptr == m_QueueTail) {
+            m_QueueHead = node;
+        } else {
+            m_QueueTail->m_Next = node;
+        }
+        m_QueueTail = node;
+    }
+    m_WorkReady.notify_one();
+}
+
+void StreamingIO::CollectCompleted(std::vector<StreamingCompletion>& completions)
+{
+    std::lock_guard<std::mutex> lock(m_Mutex);
+    completions.insert(completions.end(), m_Completed.begin(), m_Completed.end());
+    m_Pending -= (uint32_t)m_Completed.size();
+    m_Completed.clear();
+}
+
+void StreamingIO::WorkerMain()
+{
+    PROFILE_THREAD_NAME("StreamingWorker");
+    // Opened on first use, a shared handle would serialize the seeks.
+    std::vector<std::ifstream> files;
+    for (;;) {
+        StreamingRequest request;
+        std::string path;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkReady.wait(lock, [&]() { return m_Quit || nullptr != m_QueueHead; });
+            if (m_Quit) {
+                return;
+            }
+            StreamingRequestNode* node = m_QueueHead;
+            m_QueueHead = node->m_Next;
+            if (nullptr == m_QueueHead) {
+                m_QueueTail = nullptr;
+            }
+            request = node->m_Request;
+            m_RequestPool.Free(node);
+            if (request.m_File < m_Files.size()) {
+                path = m_Files[request.m_File].m_Path;
+            }
+        }
+
+        bool succeeded = false;
+        if (!path.empty()) {
+            PROFILE_ZONE("StreamingRead");
+            if (request.m_File >= files.size()) {
+                files.resize(request.m_File + 1);
+            }
+            std::ifstream& file = files[request.m_File];
+            if (!file.is_open()) {
+                file.open(path, std::ios::binary);
+            }
+            file.clear();
+            file.seekg((std::streamoff)request.m_Offset);
+            file.read((char*)request.m_Destination, request.m_Size);
+            succeeded = (file.gcount() == (std::streamsize)request.m_Size);
+            if (succeeded) {
+                m_BytesRead += request.m_Size;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        StreamingCompletion completion = { request.m_UserData, succeeded };
+        m_Completed.push_back(completion);
+    }
+}
+
+__END_NAMESPACE
@@ -0,0 +1,81 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+static const uint32_t STREAMING_INVALID_FILE = UINT32_MAX;
+
+typedef struct StreamingRequest {
+	uint32_t    m_File;
+	uint64_t    m_Offset;
+	uint32_t    m_Size;
+	void*       m_Destination;      // Written by a worker, must stay valid until the request completes
+	uint64_t    m_UserData;         // Handed back with the completion
+} StreamingRequest;
+
+typedef struct StreamingCompletion {
+	uint64_t    m_UserData;
+	bool        m_Succeeded;        // False when the range couldn't be read whole
+} StreamingCompletion;
+
+
+/**
+ * Asynchronous reads of file ranges for streaming assets in while frames go on. A few worker threads
+ * serve the requests in submission order, each with its own handle per file so they seek independently,
+ * and the owner collects what finished once per frame. Requests are plain byte ranges: the formats
+ * streamed through it lay their data out so that one request is one contiguous read.
+ */
+class StreamingIO
+{
+public:
+	StreamingIO();
+	virtual ~StreamingIO();
+
+	// 0 picks two workers, enough to keep a disk's queue busy while one copies.
+	bool Create(uint32_t workerCount = 0);
+	// Waits for the reads in progress, the queued ones are dropped without completing.
+	void Destroy();
+
+	// STREAMING_INVALID_FILE when it can't be opened. Files stay registered until Destroy().
+	uint32_t OpenFile(const std::string& path);
+	uint64_t GetFileSize(uint32_t file) const;
+
+	// Any thread.
+	void Read(const StreamingRequest& request);
+	// Appends the requests finished since the last call, in completion order.
+	void CollectCompleted(std::vector<StreamingCompletion>& completions);
+
+	// Queued or being read, not collected yet.
+	uint32_t GetPendingCount() const { return m_Pending.load(std::memory_order_relaxed); }
+	uint64_t GetBytesRead() const { return m_BytesRead.load(std::memory_order_relaxed); }
+
+private:
+	typedef struct StreamingFile {
+		std::string   m_Path;
+		uint64_t      m_Size;
+	} StreamingFile;
+
+	// Queued requests are pool blocks linked in submission order, submitters allocate and workers free.
+	typedef struct StreamingRequestNode {
+		StreamingRequest               m_Request;
+		struct StreamingRequestNode*   m_Next;
+	} StreamingRequestNode;
+
+	std::vector<std::thread>          m_Workers;
+	mutable std::mutex                m_Mutex;
+	std::condition_variable           m_WorkReady;
+	std::vector<StreamingFile>        m_Files;
+	PoolAllocator                     m_RequestPool;
+	StreamingRequestNode*             m_QueueHead;
+	StreamingRequestNode*             m_QueueTail;
+	std::vector<StreamingCompletion>  m_Completed;
+	bool                              m_Quit;
+	std::atomic<uint32_t>             m_Pending;
+	std::atomic<uint64_t>             m_BytesRead;
+
+	void WorkerMain();
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,355 @@
+#include "Animation.h"
+
+#include <xmmintrin.h>
+
+
+__BEGIN_NAMESPACE
+
+static const uint32_t CHARACTER_RING_SEGMENTS = 12;
+static const uint32_t CHARACTER_FRAME_COUNT = 60;
+static const float CHARACTER_FRAME_RATE = 30.0f;
+// Radians per joint, the bend adds up along the chain.
+static const float CHARACTER_SWAY_AMPLITUDE = 0.12f;
+static const float CHARACTER_CURL_AMPLITUDE = 0.3f;
+// Instances handed out at a time, enough to amortize the atomic & few enough to balance the threads.
+static const uint32_t ANIMATION_BATCH_INSTANCES = 64;
+static const uint32_t ANIMATION_MAX_WORKERS = 7;
+static const float ANIMATION_TWO_PI = 6.28318531f;
+
+static glm::vec4 AxisAngle(const glm::vec3& axis, float angle)
+{
+    float s = sinf(0.5f * angle);
+    return glm::vec4(axis.x * s, axis.y * s, axis.z * s, cosf(0.5f * angle));
+}
+
+static JointMatrix TranslationMatrix(const glm::vec3& translation)
+{
+    JointMatrix matrix;
+    matrix.m_Rows[0] = glm::vec4(1.0f, 0.0f, 0.0f, translation.x);
+    matrix.m_Rows[1] = glm::vec4(0.0f, 1.0f, 0.0f, translation.y);
+    matrix.m_Rows[2] = glm::vec4(0.0f, 0.0f, 1.0f, translation.z);
+    return matrix;
+}
+
+JointMatrix MakeJointMatrix(const glm::vec3& translation, float yaw, float scale)
+{
+    float c = cosf(yaw) * scale;
+    float s = sinf(yaw) * scale;
+    JointMatrix matrix;
+    matrix.m_Rows[0] = glm::vec4(c, 0.0f, s, translation.x);
+    matrix.m_Rows[1] = glm::vec4(0.0f, scale, 0.0f, translation.y);
+    matrix.m_Rows[2] = glm::vec4(-s, 0.0f, c, translation.z);
+    return matrix;
+}
+
+void BuildProceduralCharacter(uint32_t jointCount, float height, float radius, AnimatedCharacter& character)
+{
+    AnimationSkeleton& skeleton = character.m_Skeleton;
+    std::vector<AnimationClip>& clips = character.m_Clips;
+    SkinnedMesh& mesh = character.m_Mesh;
+
+    jointCount = std::max(1u, std::min(jointCount, ANIMATION_MAX_JOINTS));
+    float segment = height / (float)jointCount;
+
+    skeleton.m_Parents.resize(jointCount);
+    skeleton.m_InverseBind.resize(jointCount);
+    for (uint32_t joint = 0; joint < jointCount; joint++) {
+        skeleton.m_Parents[joint] = (int32_t)joint - 1;
+        skeleton.m_InverseBind[joint] = TranslationMatrix(glm::vec3(0.0f, -segment * joint, 0.0f));
+    }
+
+    // Sway bends the chain side to side in a wave running up it, curl rolls it forward & back.
+    clips.resize(2);
+    for (uint32_t clip = 0; clip < 2; clip++) {
+        AnimationClip& animation = clips[clip];
+        animation.m_FrameRate = CHARACTER_FRAME_RATE;
+        animation.m_FrameCount = CHARACTER_FRAME_COUNT;
+        animation.m_Rotations.resize(CHARACTER_FRAME_COUNT * jointCount);
+        animation.m_Translations.resize(CHARACTER_FRAME_COUNT * jointCount);
+        for (uint32_t frame = 0; frame < CHARACTER_FRAME_COUNT; frame++) {
+            float phase = ANIMATION_TWO_PI * frame / CHARACTER_FRAME_COUNT;
+            for (uint32_t joint = 0; joint < jointCount; joint++) {
+                float angle = 0.0f;
+                glm::vec3 axis(0.0f, 0.0f, 1.0f);
+                if (joint > 0 && 0 == clip) {
+                    angle = CHARACTER_SWAY_AMPLITUDE * sinf(phase - 0.5f * joint);
+                } else if (joint > 0) {
+                    axis = glm::vec3(1.0f, 0.0f, 0.0f);
+                    angle = CHARACTER_CURL_AMPLITUDE * (0.5f - 0.5f * cosf(phase)) * joint / jointCount;
+                }
+                uint32_t key = frame * jointCount + joint;
+                animation.m_Rotations[key] = AxisAngle(axis, angle);
+                animation.m_Translations[key] = glm::vec4(0.0f, (joint > 0) ? segment : 0.0f, 0.0f, 0.0f);
+            }
+        }
+    }
+
+    // A tapering tube of two rings per joint, each ring blended between the two joints around it.
+    uint32_t ringCount = 2 * jointCount + 1;
+    mesh.m_Vertices.clear();
+    mesh.m_Indices.clear();
+    mesh.m_Vertices.reserve(ringCount * CHARACTER_RING_SEGMENTS + 1);
+    for (uint32_t ring = 0; ring < ringCount; ring++) {
+        float y = height * ring / (ringCount - 1);
+        float ringRadius = radius * (1.0f - 0.7f * y / height);
+        float bone = std::max(y / segment - 0.5f, 0.0f);
+        uint32_t joint0 = std::min((uint32_t)bone, jointCount - 1);
+        uint32_t joint1 = std::min(joint0 + 1, jointCount - 1);
+        uint32_t weight1 = (joint0 == joint1) ? 0 : (uint32_t)((bone - joint0) * 255.0f + 0.5f);
+        for (uint32_t side = 0; side < CHARACTER_RING_SEGMENTS; side++) {
+            float angle = ANIMATION_TWO_PI * side / CHARACTER_RING_SEGMENTS;
+            SkinnedMeshVertex vertex;
+            vertex.m_Normal = glm::vec3(cosf(angle), 0.0f, sinf(angle));
+            vertex.m_Position = glm::vec3(vertex.m_Normal.x * ringRadius, y, vertex.m_Normal.z * ringRadius);
+            vertex.m_Joints = joint0 | (joint1 << 8);
+            vertex.m_Weights = (255 - weight1) | (weight1 << 8);
+            mesh.m_Vertices.push_back(vertex);
+        }
+    }
+    SkinnedMeshVertex tip;
+    tip.m_Position = glm::vec3(0.0f, height + 0.3f * radius, 0.0f);
+    tip.m_Normal = glm::vec3(0.0f, 1.0f, 0.0f);
+    tip.m_Joints = jointCount - 1;
+    tip.m_Weights = 255;
+    mesh.m_Vertices.push_back(tip);
+
+    // Counter clockwise from outside.
+    for (uint32_t ring = 0; ring + 1 < ringCount; ring++) {
+        for (uint32_t side = 0; side < CHARACTER_RING_SEGMENTS; side++) {
+            uint32_t a = ring * CHARACTER_RING_SEGMENTS + side;
+            uint32_t b = ring * CHARACTER_RING_SEGMENTS + (side + 1) % CHARACTER_RING_SEGMENTS;
+            uint32_t c = a + CHARACTER_RING_SEGMENTS;
+            uint32_t d = b + CHARACTER_RING_SEGMENTS;
+            uint32_t quad[6] = { a, c, b, b, c, d };
+            mesh.m_Indices.insert(mesh.m_Indices.end(), quad, quad + 6);
+        }
+    }
+    uint32_t top = (ringCount - 1) * CHARACTER_RING_SEGMENTS;
+    for (uint32_t side = 0; side < CHARACTER_RING_SEGMENTS; side++) {
+        uint32_t cap[3] = { top + side, (uint32_t)mesh.m_Vertices.size() - 1, top + (side + 1) % CHARACTER_RING_SEGMENTS };
+        mesh.m_Indices.insert(mesh.m_Indices.end(), cap, cap + 3);
+    }
+}
+
+
+/******************************************************************************
+* SSE math, quaternions & translations as 4 floats, joint matrices as 3 rows
+******************************************************************************/
+static inline __m128 Dot4(__m128 a, __m128 b)
+{
+    __m128 products = _mm_mul_ps(a, b);
+    __m128 sums = _mm_add_ps(products, _mm_shuffle_ps(products, products, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_add_ps(sums, _mm_shuffle_ps(sums, sums, _MM_SHUFFLE(1, 0, 3, 2)));
+}
+
+static inline __m128 Lerp4(__m128 a, __m128 b, __m128 t)
+{
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+// Normalized lerp along the shorter arc, close enough to slerp between neighbouring keys & for blend weights.
+static inline __m128 Nlerp(__m128 a, __m128 b, __m128 t)
+{
+    __m128 sign = _mm_and_ps(_mm_cmplt_ps(Dot4(a, b), _mm_setzero_ps()), _mm_set1_ps(-0.0f));
+    __m128 q = Lerp4(a, _mm_xor_ps(b, sign), t);
+    return _mm_div_ps(q, _mm_sqrt_ps(Dot4(q, q)));
+}
+
+// Rotation & translation to the rows of an affine matrix.
+static inline void StorePose(__m128 rotation, __m128 translation, JointMatrix& matrix)
+{
+    alignas(16) float q[4];
+    alignas(16) float t[4];
+    _mm_store_ps(q, rotation);
+    _mm_store_ps(t, translation);
+    float xx = q[0] * q[0], yy = q[1] * q[1], zz = q[2] * q[2];
+    float xy = q[0] * q[1], xz = q[0] * q[2], yz = q[1] * q[2];
+    float wx = q[3] * q[0], wy = q[3] * q[1], wz = q[3] * q[2];
+    _mm_store_ps(&matrix.m_Rows[0].x, _mm_set_ps(t[0], 2.0f * (xz + wy), 2.0f * (xy - wz), 1.0f - 2.0f * (yy + zz)));
+    _mm_store_ps(&matrix.m_Rows[1].x, _mm_set_ps(t[1], 2.0f * (yz - wx), 1.0f - 2.0f * (xx + zz), 2.0f * (xy + wz)));
+    _mm_store_ps(&matrix.m_Rows[2].x, _mm_set_ps(t[2], 1.0f - 2.0f * (xx + yy), 2.0f * (yz + wx), 2.0f * (xz - wy)));
+}
+
+// a * b, rows of the result in out, which may alias neither.
+static inline void MultiplyRows(const JointMatrix& a, const JointMatrix& b, __m128 out[3])
+{
+    __m128 b0 = _mm_load_ps(&b.m_Rows[0].x);
+    __m128 b1 = _mm_load_ps(&b.m_Rows[1].x);
+    __m128 b2 = _mm_load_ps(&b.m_Rows[2].x);
+    __m128 unitW = _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f);
+    for (int row = 0; row < 3; row++) {
+        __m128 r = _mm_load_ps(&a.m_Rows[row].x);
+        __m128 result = _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(1, 1, 1, 1)), b1));
+        result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(2, 2, 2, 2)), b2));
+        out[row] = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3)), unitW));
+    }
+}
+
+// Keys around time & the fraction between them.
+static inline void FindKeys(const AnimationClip& clip, float time, uint32_t& key0, uint32_t& key1, __m128& fraction)
+{
+    float frame = fmodf(time * clip.m_FrameRate, (float)clip.m_FrameCount);
+    if (frame < 0.0f) {
+        frame += (float)clip.m_FrameCount;
+    }
+    key0 = std::min((uint32_t)frame, clip.m_FrameCount - 1);
+    key1 = (key0 + 1) % clip.m_FrameCount;
+    fraction = _mm_set1_ps(frame - (float)key0);
+}
+
+
+/******************************************************************************
+* AnimationEvaluator
+******************************************************************************/
+AnimationEvaluator::AnimationEvaluator() :
+	m_Job{},
+	m_Generation(0),
+	m_Busy(0),
+	m_Quit(false),
+	m_NextBatch(0)
+{
+}
+
+AnimationEvaluator::~AnimationEvaluator()
+{
+}
+
+bool AnimationEvaluator::Create(uint32_t workerCount)
+{
+    Destroy();
+
+    if (0 == workerCount) {
+        uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+        workerCount = std::min(hardwareThreads - 1, ANIMATION_MAX_WORKERS);
+    }
+    m_Workers.reserve(workerCount);
+    for (uint32_t worker = 0; worker < workerCount; worker++) {
+        m_Workers.emplace_back(&AnimationEvaluator::WorkerMain, this);
+    }
+    return true;
+}
+
+void AnimationEvaluator::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Quit = true;
+    }
+    m_WorkReady.notify_all();
+    for (std::thread& worker : m_Workers) {
+        worker.join();
+    }
+    m_Workers.clear();
+    m_Quit = false;
+}
+
+void AnimationEvaluator::Evaluate(const AnimationSkeleton& skeleton, const AnimationClip* clips, const AnimationInstance* instances, uint32_t instanceCount,
+    JointMatrix* palette)
+{
+    PROFILE_FUNCTION();
+    EvaluateJob job = { &skeleton, clips, instances, instanceCount, palette };
+    m_NextBatch = 0;
+    // Not worth waking anyone for a single batch.
+    if (m_Workers.empty() || instanceCount <= ANIMATION_BATCH_INSTANCES) {
+        RunBatches(job);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Job = job;
+        m_Busy = (uint32_t)m_Workers.size();
+        m_Generation++;
+    }
+    m_WorkReady.notify_all();
+    RunBatches(job);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_WorkDone.wait(lock, [this]() { return 0 == m_Busy; });
+}
+
+void AnimationEvaluator::WorkerMain()
+{
+    PROFILE_THREAD_NAME("AnimationWorker");
+    uint64_t generation = 0;
+    for (;;) {
+        EvaluateJob job;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WorkReady.wait(lock, [&]() { return m_Quit || m_Generation != generation; });
+            if (m_Quit) {
+                return;
+            }
+            generation = m_Generation;
+            job = m_Job;
+        }
+        RunBatches(job);
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Busy--;
+        }
+        m_WorkDone.notify_one();
+    }
+}
+
+void AnimationEvaluator::RunBatches(const EvaluateJob& job)
+{
+    PROFILE_ZONE("AnimationBatches");
+    const AnimationSkeleton& skeleton = *job.m_Skeleton;
+    uint32_t jointCount = (uint32_t)skeleton.m_Parents.size();
+    // Model space joints of the instance being evaluated.
+    std::vector<JointMatrix> globals(jointCount);
+
+    for (;;) {
+        uint32_t first = m_NextBatch.fetch_add(ANIMATION_BATCH_INSTANCES);
+        if (first >= job.m_InstanceCount) {
+            break;
+        }
+        uint32_t last = std::min(first + ANIMATION_BATCH_INSTANCES, job.m_InstanceCount);
+        for (uint32_t index = first; index < last; index++) {
+            const AnimationInstance& instance = job.m_Instances[index];
+            const AnimationClip& clipA = job.m_Clips[instance.m_ClipA];
+            const AnimationClip& clipB = job.m_Clips[instance.m_ClipB];
+            uint32_t keyA0, keyA1, keyB0, keyB1;
+            __m128 fractionA, fractionB;
+            FindKeys(clipA, instance.m_TimeA, keyA0, keyA1, fractionA);
+            FindKeys(clipB, instance.m_TimeB, keyB0, keyB1, fractionB);
+            const glm::vec4* rotationsA0 = &clipA.m_Rotations[keyA0 * jointCount];
+            const glm::vec4* rotationsA1 = &clipA.m_Rotations[keyA1 * jointCount];
+            const glm::vec4* rotationsB0 = &clipB.m_Rotations[keyB0 * jointCount];
+            const glm::vec4* rotationsB1 = &clipB.m_Rotations[keyB1 * jointCount];
+            const glm::vec4* translationsA0 = &clipA.m_Translations[keyA0 * jointCount];
+            const glm::vec4* translationsA1 = &clipA.m_Translations[keyA1 * jointCount];
+            const glm::vec4* translationsB0 = &clipB.m_Translations[keyB0 * jointCount];
+            const glm::vec4* translationsB1 = &clipB.m_Translations[keyB1 * jointCount];
+            __m128 weight = _mm_set1_ps(instance.m_Weight);
+            JointMatrix* palette = job.m_Palette + (size_t)index * jointCount;
+
+            for (uint32_t joint = 0; joint < jointCount; joint++) {
+                __m128 rotationA = Nlerp(_mm_loadu_ps(&rotationsA0[joint].x), _mm_loadu_ps(&rotationsA1[joint].x), fractionA);
+                __m128 rotationB = Nlerp(_mm_loadu_ps(&rotationsB0[joint].x), _mm_loadu_ps(&rotationsB1[joint].x), fractionB);
+                __m128 translationA = Lerp4(_mm_loadu_ps(&translationsA0[joint].x), _mm_loadu_ps(&translationsA1[joint].x), fractionA);
+                __m128 translationB = Lerp4(_mm_loadu_ps(&translationsB0[joint].x), _mm_loadu_ps(&translationsB1[joint].x), fractionB);
+                JointMatrix local;
+                StorePose(Nlerp(rotationA, rotationB, weight), Lerp4(translationA, translationB, weight), local);
+
+                int32_t parent = skeleton.m_Parents[joint];
+                __m128 rows[3];
+                MultiplyRows((parent < 0) ? instance.m_Root : globals[parent], local, rows);
+                for (int row = 0; row < 3; row++) {
+                    _mm_store_ps(&globals[joint].m_Rows[row].x, rows[row]);
+                }
+                // Streamed, the palette usually lives in write combined upload memory nothing reads back.
+                MultiplyRows(globals[joint], skeleton.m_InverseBind[joint], rows);
+                for (int row = 0; row < 3; row++) {
+                    _mm_stream_ps(&palette[joint].m_Rows[row].x, rows[row]);
+                }
+            }
+        }
+    }
+    _mm_sfence();
+}
+
+
+__END_NAMESPACE
@@ -0,0 +1,117 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+// Joints of a skeleton, skinned vertices index them with 8 bits.
+static const uint32_t ANIMATION_MAX_JOINTS = 256;
+
+
+// Affine transform as the first three rows of a 4x4 matrix, std430 layout of skin.shader.comp's palette.
+typedef struct alignas(16) JointMatrix {
+	glm::vec4    m_Rows[3];
+} JointMatrix;
+
+typedef struct AnimationSkeleton {
+	std::vector<int32_t>        m_Parents;          // -1 for the root, parents come before their children
+	std::vector<JointMatrix>    m_InverseBind;      // Model space to joint space in the bind pose
+} AnimationSkeleton;
+
+// Local joint poses sampled at a fixed rate, looping.
+typedef struct AnimationClip {
+	float                       m_FrameRate;
+	uint32_t                    m_FrameCount;
+	std::vector<glm::vec4>      m_Rotations;        // Unit quaternions (x, y, z, w), m_FrameCount rows of a rotation per joint
+	std::vector<glm::vec4>      m_Translations;     // xyz relative to the parent, w unused
+} AnimationClip;
+
+// Two clips playing at once & blended, per instance.
+typedef struct AnimationInstance {
+	uint32_t     m_ClipA;
+	uint32_t     m_ClipB;
+	float        m_TimeA;            // Seconds, wrapped to each clip's length
+	float        m_TimeB;
+	float        m_Weight;           // Of clip B, 0 plays clip A alone
+	JointMatrix  m_Root;             // Model to world
+} AnimationInstance;
+
+// Rest pose vertex, std430 layout of skin.shader.comp.
+typedef struct SkinnedMeshVertex {
+	glm::vec3    m_Position;
+	uint32_t     m_Joints;           // Four 8 bit joint indices
+	glm::vec3    m_Normal;
+	uint32_t     m_Weights;          // Four 8 bit unorm weights, summing to 255
+} SkinnedMeshVertex;
+
+typedef struct SkinnedMesh {
+	std::vector<SkinnedMeshVertex>  m_Vertices;
+	std::vector<uint32_t>           m_Indices;
+} SkinnedMesh;
+
+typedef struct AnimatedCharacter {
+	AnimationSkeleton           m_Skeleton;
+	std::vector<AnimationClip>  m_Clips;
+	SkinnedMesh                 m_Mesh;
+} AnimatedCharacter;
+
+
+/**
+ * A tentacle standing on the origin: a vertical chain of joints under a tube skinned to them, with a sway &
+ * a curl clip to blend between. Stands in for an imported character until the asset pipeline has one.
+ */
+void BuildProceduralCharacter(uint32_t jointCount, float height, float radius, AnimatedCharacter& character);
+
+// Scaled uniformly, turned by yaw radians about y, then moved to translation.
+JointMatrix MakeJointMatrix(const glm::vec3& translation, float yaw, float scale);
+
+/**
+ * Samples, blends & flattens the skeleton of every instance into joint palettes, skin matrix per joint.
+ *
+ * Keys are interpolated, the two clips blended & the hierarchy concatenated four floats at a time with SSE,
+ * one instance after the other so its joints stay in cache. Instances are split in batches handed out to a
+ * few persistent worker threads the calling thread works along with, so a frame's palettes are ready when
+ * Evaluate() returns & can be written straight into mapped upload memory.
+ */
+class AnimationEvaluator
+{
+public:
+	AnimationEvaluator();
+	virtual ~AnimationEvaluator();
+
+	// 0 picks one worker less than the hardware threads, the calling thread being the last one.
+	bool Create(uint32_t workerCount = 0);
+	void Destroy();
+
+	// palette receives instanceCount * joint count matrices, instance after instance, & must be 16 byte aligned.
+	void Evaluate(const AnimationSkeleton& skeleton, const AnimationClip* clips, const AnimationInstance* instances, uint32_t instanceCount,
+		JointMatrix* palette);
+
+	// Threads taking part in Evaluate(), the calling one included.
+	uint32_t GetThreadCount() const { return (uint32_t)m_Workers.size() + 1; }
+
+private:
+	typedef struct EvaluateJob {
+		const AnimationSkeleton*   m_Skeleton;
+		const AnimationClip*       m_Clips;
+		const AnimationInstance*   m_Instances;
+		uint32_t                   m_InstanceCount;
+		JointMatrix*               m_Palette;
+	} EvaluateJob;
+
+	std::vector<std::thread>   m_Workers;
+	std::mutex                 m_Mutex;
+	std::condition_variable    m_WorkReady;
+	std::condition_variable    m_WorkDone;
+	EvaluateJob                m_Job;
+	uint64_t                   m_Generation;        // Bumped per Evaluate(), wakes the workers
+	uint32_t                   m_Busy;              // Workers still on the current generation
+	bool                       m_Quit;
+	std::atomic<uint32_t>      m_NextBatch;
+
+	void WorkerMain();
+	void RunBatches(const EvaluateJob& job);
+};
+
+
+__END_NAMESPACE
@@ -4,6 +4,9 @@
 #include "CrossPlatform.h"
 #include "Platform.h"
 #include "StandardC.h"
+#include "StandardCXX.h"
+#include "Memory.h"
+#include "Profiler.h"
 
 
 #define GLFW_INCLUDE_VULKAN
@@ -15,12 +18,19 @@
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <vec3.hpp>
 #include <vec4.hpp>
 #include <mat4x4.hpp>
+#include <geometric.hpp>
+#include <gtc/matrix_transform.hpp>
 
 #include <iostream>
 #include <vector>
 #include <string>
+#include <functional>
 #include <set>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <filesystem>
@@ -0,0 +1,205 @@
+#include "Meshlet.h"
+
+
+__BEGIN_NAMESPACE
+
+// Local vertex indices are bytes, this one marks a mesh vertex the current meshlet doesn't use yet, so at most
+// 255 vertices fit a meshlet.
+static const uint8_t MESHLET_UNREFERENCED = 0xFF;
+static const uint32_t MESHLET_VERTEX_LIMIT = MESHLET_UNREFERENCED;
+
+static glm::vec4 ComputeBoundingSphere(const glm::vec3* positions, const uint32_t* vertices, uint32_t vertexCount)
+{
+    // Ritter's bounding sphere: start from the most separated pair along the main axes, then grow.
+    uint32_t pmin[3] = { 0, 0, 0 };
+    uint32_t pmax[3] = { 0, 0, 0 };
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        const glm::vec3& p = positions[vertices[i]];
+        for (int axis = 0; axis < 3; axis++) {
+            if (p[axis] < positions[vertices[pmin[axis]]][axis]) pmin[axis] = i;
+            if (p[axis] > positions[vertices[pmax[axis]]][axis]) pmax[axis] = i;
+        }
+    }
+
+    float maxSpan = -1.0f;
+    int spanAxis = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        glm::vec3 d = positions[vertices[pmax[axis]]] - positions[vertices[pmin[axis]]];
+        float span = glm::dot(d, d);
+        if (span > maxSpan) {
+            maxSpan = span;
+            spanAxis = axis;
+        }
+    }
+
+    glm::vec3 center = (positions[vertices[pmin[spanAxis]]] + positions[vertices[pmax[spanAxis]]]) * 0.5f;
+    float radius = sqrtf(maxSpan) * 0.5f;
+
+    for (uint32_t i = 0; i < vertexCount; i++) {
+        const glm::vec3& p = positions[vertices[i]];
+        float distance = glm::length(p - center);
+        if (distance > radius) {
+            float shift = (distance - radius) * 0.5f;
+            center += (p - center) * (shift / distance);
+            radius += shift;
+        }
+    }
+    return glm::vec4(center, radius);
+}
+
+static void ComputeMeshletBounds(const glm::vec3* positions, const MeshletMesh& mesh, const Meshlet& meshlet, MeshletBounds& bounds)
+{
+    const uint32_t* vertices = &mesh.m_MeshletVertices[meshlet.m_VertexOffset];
+    const uint8_t* triangles = &mesh.m_MeshletTriangles[meshlet.m_TriangleOffset * 3];
+
+    bounds.m_SphereCenterRadius = ComputeBoundingSphere(positions, vertices, meshlet.m_VertexCount);
+    glm::vec3 center = glm::vec3(bounds.m_SphereCenterRadius);
+
+    // Normal cone, axis is the average of triangle normals, degenerate triangles don't vote.
+    glm::vec3 normals[MESHLET_MAX_TRIANGLES];
+    uint32_t normalCount = 0;
+    glm::vec3 axis(0.0f);
+    for (uint32_t i = 0; i < meshlet.m_TriangleCount && normalCount < MESHLET_MAX_TRIANGLES; i++) {
+        const glm::vec3& p0 = positions[vertices[triangles[i * 3 + 0]]];
+        const glm::vec3& p1 = positions[vertices[triangles[i * 3 + 1]]];
+        const glm::vec3& p2 = positions[vertices[triangles[i * 3 + 2]]];
+        glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+        float area = glm::length(n);
+        if (area <= 0.0f) {
+            continue;
+        }
+        normals[normalCount++] = n / area;
+        axis += n / area;
+    }
+
+    float axisLength = glm::length(axis);
+    if (0 == normalCount || axisLength <= 0.0f) {
+        bounds.m_ConeApex = glm::vec4(center, 0.0f);
+        bounds.m_ConeAxisCutoff = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        return;
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (uint32_t i = 0; i < normalCount; i++) {
+        minDot = std::min(minDot, glm::dot(normals[i], axis));
+    }
+
+    // Cone wider than a hemisphere can't be backface culled from any viewpoint.
+    if (minDot <= 0.1f) {
+        bounds.m_ConeApex = glm::vec4(center, 0.0f);
+        bounds.m_ConeAxisCutoff = glm::vec4(axis, 1.0f);
+        return;
+    }
+
+    // Move the apex back along the axis until every triangle plane is in front of it.
+    float maxT = 0.0f;
+    uint32_t normalIndex = 0;
+    for (uint32_t i = 0; i < meshlet.m_TriangleCount && normalIndex < normalCount; i++) {
+        const glm::vec3& p0 = positions[vertices[triangles[i * 3 + 0]]];
+        const glm::vec3& p1 = positions[vertices[triangles[i * 3 + 1]]];
+        const glm::vec3& p2 = positions[vertices[triangles[i * 3 + 2]]];
+        if (glm::length(glm::cross(p1 - p0, p2 - p0)) <= 0.0f) {
+            continue;
+        }
+        const glm::vec3& n = normals[normalIndex++];
+        float dc = glm::dot(center - p0, n);
+        float dn = glm::dot(axis, n);
+        maxT = std::max(maxT, dc / dn);
+    }
+
+    bounds.m_ConeApex = glm::vec4(center - axis * maxT, 0.0f);
+    bounds.m_ConeAxisCutoff = glm::vec4(axis, sqrtf(1.0f - minDot * minDot));
+}
+
+bool BuildMeshlets(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount, MeshletMesh& output,
+    uint32_t maxVertices, uint32_t maxTriangles)
+{
+    if (nullptr == positions || nullptr == indices || 0 != indexCount % 3 ||
+        maxVertices < 3 || maxVertices > MESHLET_VERTEX_LIMIT || maxTriangles < 1 || maxTriangles > MESHLET_MAX_TRIANGLES) {
+        std::cout << "Invalid meshlet build input.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    output.m_Meshlets.clear();
+    output.m_Bounds.clear();
+    output.m_MeshletVertices.clear();
+    output.m_MeshletTriangles.clear();
+    output.m_MeshletIndices.clear();
+
+    size_t triangleCount = indexCount / 3;
+    output.m_Meshlets.reserve(triangleCount / maxTriangles + 1);
+    output.m_MeshletTriangles.reserve(indexCount);
+    output.m_MeshletIndices.reserve(indexCount);
+
+    // Mesh vertex -> local index in the meshlet being built, MESHLET_UNREFERENCED means not yet referenced.
+    std::vector<uint8_t> localIndex(vertexCount, MESHLET_UNREFERENCED);
+    Meshlet current = {};
+
+    auto flush = [&]() {
+        if (0 == current.m_TriangleCount) {
+            return;
+        }
+        for (uint32_t i = 0; i < current.m_VertexCount; i++) {
+            localIndex[output.m_MeshletVertices[current.m_VertexOffset + i]] = MESHLET_UNREFERENCED;
+        }
+        output.m_Meshlets.push_back(current);
+        current.m_VertexOffset = (uint32_t)output.m_MeshletVertices.size();
+        current.m_TriangleOffset = (uint32_t)(output.m_MeshletTriangles.size() / 3);
+        current.m_VertexCount = 0;
+        current.m_TriangleCount = 0;
+    };
+
+    for (size_t t = 0; t < triangleCount; t++) {
+        uint32_t a = indices[t * 3 + 0];
+        uint32_t b = indices[t * 3 + 1];
+        uint32_t c = indices[t * 3 + 2];
+        if (a >= vertexCount || b >= vertexCount || c >= vertexCount) {
+            std::cout << "Meshlet build index out of range.\n";
+            SetErrorCode(ErrorCode::UnKnow);
+            return false;
+        }
+
+        uint32_t newVertices = (localIndex[a] == MESHLET_UNREFERENCED) + (localIndex[b] == MESHLET_UNREFERENCED) + (localIndex[c] == MESHLET_UNREFERENCED);
+        if (current.m_VertexCount + newVertices > maxVertices || current.m_TriangleCount + 1 > maxTriangles) {
+            flush();
+        }
+
+        for (uint32_t v : { a, b, c }) {
+            if (localIndex[v] == MESHLET_UNREFERENCED) {
+                localIndex[v] = (uint8_t)current.m_VertexCount++;
+                output.m_MeshletVertices.push_back(v);
+            }
+            output.m_MeshletTriangles.push_back(localIndex[v]);
+            output.m_MeshletIndices.push_back(v);
+        }
+        current.m_TriangleCount++;
+    }
+    flush();
+
+    output.m_Bounds.resize(output.m_Meshlets.size());
+    for (size_t i = 0; i < output.m_Meshlets.size(); i++) {
+        ComputeMeshletBounds(positions, output, output.m_Meshlets[i], output.m_Bounds[i]);
+    }
+
+    // Shaders fetch the triangle bytes as uint words.
+    output.m_MeshletTriangles.resize((output.m_MeshletTriangles.size() + 3) & ~size_t(3), 0);
+    return true;
+}
+
+bool IsMeshletBackfacing(const MeshletBounds& bounds, const glm::vec3& cameraPosition)
+{
+    glm::vec3 apex = glm::vec3(bounds.m_ConeApex);
+    glm::vec3 axis = glm::vec3(bounds.m_ConeAxisCutoff);
+    float cutoff = bounds.m_ConeAxisCutoff.w;
+    if (cutoff >= 1.0f) {
+        return false;
+    }
+
+    glm::vec3 view = apex - cameraPosition;
+    float distance = glm::length(view);
+    return glm::dot(view, axis) >= cutoff * distance;
+}
+
+__END_NAMESPACE
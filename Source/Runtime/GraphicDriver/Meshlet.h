@@ -0,0 +1,49 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+// Meshlet limits, 64 vertices & 124 triangles fit well into the output limits of mesh shaders
+// and keep the per-meshlet triangle index list at 372 bytes.
+static const uint32_t MESHLET_MAX_VERTICES = 64;
+static const uint32_t MESHLET_MAX_TRIANGLES = 124;
+
+
+typedef struct Meshlet {
+	uint32_t    m_VertexOffset;     // First entry in MeshletMesh::m_MeshletVertices
+	uint32_t    m_TriangleOffset;   // First triangle in MeshletMesh::m_MeshletTriangles (3 bytes per triangle)
+	uint32_t    m_VertexCount;
+	uint32_t    m_TriangleCount;
+} Meshlet;
+
+// std430 layout, shared with meshlet_cull.shader.comp & meshlet.shader.task
+typedef struct MeshletBounds {
+	glm::vec4   m_SphereCenterRadius;   // xyz: bounding sphere center, w: radius
+	glm::vec4   m_ConeApex;             // xyz: normal cone apex
+	glm::vec4   m_ConeAxisCutoff;       // xyz: normal cone axis, w: sin(cone half angle), 1.0 means never backfacing
+} MeshletBounds;
+
+typedef struct MeshletMesh {
+	std::vector<Meshlet>         m_Meshlets;
+	std::vector<MeshletBounds>   m_Bounds;
+	std::vector<uint32_t>        m_MeshletVertices;    // Meshlet local vertex -> mesh vertex index
+	std::vector<uint8_t>         m_MeshletTriangles;   // Meshlet local triangle indices, padded to 4 bytes
+	std::vector<uint32_t>        m_MeshletIndices;     // Flat mesh index list ordered by meshlet, for the indirect draw path
+} MeshletMesh;
+
+
+/**
+ * Split an indexed triangle list into meshlets offline and compute per meshlet bounding sphere & normal cone.
+ * maxVertices is at most 255, local vertex indices are bytes.
+ */
+bool BuildMeshlets(const glm::vec3* positions, size_t vertexCount, const uint32_t* indices, size_t indexCount, MeshletMesh& output,
+	uint32_t maxVertices = MESHLET_MAX_VERTICES, uint32_t maxTriangles = MESHLET_MAX_TRIANGLES);
+
+/**
+ * CPU reference of the cluster backface test done on GPU.
+ */
+bool IsMeshletBackfacing(const MeshletBounds& bounds, const glm::vec3& cameraPosition);
+
+
+__END_NAMESPACE
@@ -0,0 +1,303 @@
+#include "VirtualTexture.h"
+
+
+__BEGIN_NAMESPACE
+
+static uint32_t CeilDivide(uint32_t value, uint32_t divisor)
+{
+    return (value + divisor - 1) / divisor;
+}
+
+// Mip by mip box filter, the odd texel out of a side is folded into the last one.
+static void DownsampleMip(const std::vector<uint8_t>& source, uint32_t sourceSize, std::vector<uint8_t>& target, uint32_t targetSize)
+{
+    target.resize((size_t)targetSize * targetSize * 4);
+    for (uint32_t y = 0; y < targetSize; y++) {
+        for (uint32_t x = 0; x < targetSize; x++) {
+            uint32_t x0 = std::min(x * 2, sourceSize - 1);
+            uint32_t y0 = std::min(y * 2, sourceSize - 1);
+            uint32_t x1 = std::min(x0 + 1, sourceSize - 1);
+            uint32_t y1 = std::min(y0 + 1, sourceSize - 1);
+            for (uint32_t channel = 0; channel < 4; channel++) {
+                uint32_t sum = source[((size_t)y0 * sourceSize + x0) * 4 + channel] + source[((size_t)y0 * sourceSize + x1) * 4 + channel] +
+                    source[((size_t)y1 * sourceSize + x0) * 4 + channel] + source[((size_t)y1 * sourceSize + x1) * 4 + channel];
+                target[((size_t)y * targetSize + x) * 4 + channel] = (uint8_t)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+bool WriteVirtualTextureSet(const std::string& path, uint32_t textureCount, uint32_t textureSize, const VirtualTextureGenerator& generator)
+{
+    PROFILE_FUNCTION();
+    if (0 == textureCount || 0 == textureSize || 0 != textureSize % VIRTUAL_TEXTURE_PAGE_PAYLOAD) {
+        std::cout << "Virtual texture sets need textures a multiple of " << VIRTUAL_TEXTURE_PAGE_PAYLOAD << " texels a side.\n";
+        return false;
+    }
+
+    VirtualTextureHeader header{};
+    header.m_Magic = VIRTUAL_TEXTURE_MAGIC;
+    header.m_Version = VIRTUAL_TEXTURE_VERSION;
+    header.m_TextureCount = textureCount;
+    header.m_TextureSize = textureSize;
+    header.m_TextureColumns = (uint32_t)ceil(sqrt((double)textureCount));
+    header.m_PagesPerSide = 1;
+    header.m_MipCount = 1;
+    uint32_t pagesNeeded = header.m_TextureColumns * (textureSize / VIRTUAL_TEXTURE_PAGE_PAYLOAD);
+    while (header.m_PagesPerSide < pagesNeeded) {
+        header.m_PagesPerSide *= 2;
+        header.m_MipCount++;
+    }
+    header.m_PagePayload = VIRTUAL_TEXTURE_PAGE_PAYLOAD;
+    header.m_PageBorder = VIRTUAL_TEXTURE_PAGE_BORDER;
+    if (header.m_MipCount > VIRTUAL_TEXTURE_MAX_MIPS) {
+        std::cout << "Virtual texture set of " << textureCount << " textures is too large.\n";
+        return false;
+    }
+
+    // Space past the last texture is mid grey, it's only ever seen through the coarse mips' filtering.
+    uint32_t mipSize = header.m_PagesPerSide * VIRTUAL_TEXTURE_PAGE_PAYLOAD;
+    std::vector<uint8_t> mip((size_t)mipSize * mipSize * 4, 128);
+    std::vector<uint8_t> texture((size_t)textureSize * textureSize * 4);
+    for (uint32_t i = 0; i < textureCount; i++) {
+        generator(i, textureSize, texture.data());
+        size_t originX = (size_t)(i % header.m_TextureColumns) * textureSize;
+        size_t originY = (size_t)(i / header.m_TextureColumns) * textureSize;
+        for (uint32_t row = 0; row < textureSize; row++) {
+            memcpy(&mip[((originY + row) * mipSize + originX) * 4], &texture[(size_t)row * textureSize * 4], (size_t)textureSize * 4);
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "Failed to open " << path << " for writing.\n";
+        return false;
+    }
+    file.write((const char*)&header, sizeof(header));
+
+    std::vector<uint8_t> page(VIRTUAL_TEXTURE_PAGE_BYTES);
+    std::vector<uint8_t> nextMip;
+    for (uint32_t level = 0; level < header.m_MipCount; level++) {
+        uint32_t pagesPerSide = GetVirtualTexturePagesPerSide(header, level);
+        for (uint32_t pageY = 0; pageY < pagesPerSide; pageY++) {
+            for (uint32_t pageX = 0; pageX < pagesPerSide; pageX++) {
+                // Borders clamp to the edge of the mip, like a sampler would.
+                int32_t originX = (int32_t)(pageX * VIRTUAL_TEXTURE_PAGE_PAYLOAD) - (int32_t)VIRTUAL_TEXTURE_PAGE_BORDER;
+                int32_t originY = (int32_t)(pageY * VIRTUAL_TEXTURE_PAGE_PAYLOAD) - (int32_t)VIRTUAL_TEXTURE_PAGE_BORDER;
+                for (uint32_t y = 0; y < VIRTUAL_TEXTURE_PAGE_SIZE; y++) {
+                    size_t sourceY = (size_t)std::min(std::max(originY + (int32_t)y, 0), (int32_t)mipSize - 1);
+                    for (uint32_t x = 0; x < VIRTUAL_TEXTURE_PAGE_SIZE; x++) {
+                        size_t sourceX = (size_t)std::min(std::max(originX + (int32_t)x, 0), (int32_t)mipSize - 1);
+                        memcpy(&page[((size_t)y * VIRTUAL_TEXTURE_PAGE_SIZE + x) * 4], &mip[(sourceY * mipSize + sourceX) * 4], 4);
+                    }
+                }
+                file.write((const char*)page.data(), page.size());
+            }
+        }
+        if (level + 1 < header.m_MipCount) {
+            DownsampleMip(mip, mipSize, nextMip, mipSize / 2);
+            mip.swap(nextMip);
+            mipSize /= 2;
+        }
+    }
+
+    if (!file.good()) {
+        std::cout << "Failed to write " << path << ".\n";
+        return false;
+    }
+    return true;
+}
+
+bool ReadVirtualTextureHeader(const std::string& path, VirtualTextureHeader& header)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+    uint64_t fileSize = (uint64_t)file.tellg();
+    file.seekg(0);
+    file.read((char*)&header, sizeof(header));
+    if (!file.good() || VIRTUAL_TEXTURE_MAGIC != header.m_Magic || VIRTUAL_TEXTURE_VERSION != header.m_Version ||
+        VIRTUAL_TEXTURE_PAGE_PAYLOAD != header.m_PagePayload || VIRTUAL_TEXTURE_PAGE_BORDER != header.m_PageBorder ||
+        0 == header.m_MipCount || header.m_MipCount > VIRTUAL_TEXTURE_MAX_MIPS || header.m_PagesPerSide != (1u << (header.m_MipCount - 1))) {
+        std::cout << path << " is not a virtual texture set.\n";
+        return false;
+    }
+    if (fileSize < GetVirtualTexturePageOffset(header, GetVirtualTexturePageCount(header))) {
+        std::cout << path << " is truncated.\n";
+        return false;
+    }
+    return true;
+}
+
+uint32_t GetVirtualTexturePagesPerSide(const VirtualTextureHeader& header, uint32_t mip)
+{
+    return std::max(header.m_PagesPerSide >> mip, 1u);
+}
+
+uint32_t GetVirtualTexturePageCount(const VirtualTextureHeader& header)
+{
+    uint32_t count = 0;
+    for (uint32_t mip = 0; mip < header.m_MipCount; mip++) {
+        uint32_t pagesPerSide = GetVirtualTexturePagesPerSide(header, mip);
+        count += pagesPerSide * pagesPerSide;
+    }
+    return count;
+}
+
+uint32_t GetVirtualTexturePageIndex(const VirtualTextureHeader& header, uint32_t mip, uint32_t x, uint32_t y)
+{
+    uint32_t first = 0;
+    for (uint32_t level = 0; level < mip; level++) {
+        uint32_t pagesPerSide = GetVirtualTexturePagesPerSide(header, level);
+        first += pagesPerSide * pagesPerSide;
+    }
+    return first + y * GetVirtualTexturePagesPerSide(header, mip) + x;
+}
+
+void DecodeVirtualTexturePage(const VirtualTextureHeader& header, uint32_t page, uint32_t& mip, uint32_t& x, uint32_t& y)
+{
+    mip = 0;
+    uint32_t pagesPerSide = GetVirtualTexturePagesPerSide(header, 0);
+    while (page >= pagesPerSide * pagesPerSide && mip + 1 < header.m_MipCount) {
+        page -= pagesPerSide * pagesPerSide;
+        pagesPerSide = GetVirtualTexturePagesPerSide(header, ++mip);
+    }
+    x = page % pagesPerSide;
+    y = page / pagesPerSide;
+}
+
+uint64_t GetVirtualTexturePageOffset(const VirtualTextureHeader& header, uint32_t page)
+{
+    return sizeof(VirtualTextureHeader) + (uint64_t)page * VIRTUAL_TEXTURE_PAGE_BYTES;
+}
+
+VirtualTexturePageCache::VirtualTexturePageCache() :
+	m_NextUnused(0),
+	m_Newest(UINT32_MAX),
+	m_Oldest(UINT32_MAX),
+	m_ResidentCount(0)
+{
+}
+
+VirtualTexturePageCache::~VirtualTexturePageCache()
+{
+}
+
+void VirtualTexturePageCache::Create(uint32_t slotCount)
+{
+    Destroy();
+    CacheSlot empty = { UINT32_MAX, UINT32_MAX, UINT32_MAX, 0, SLOT_FREE };
+    m_Slots.assign(slotCount, empty);
+    m_PageSlots.reserve(slotCount);
+}
+
+void VirtualTexturePageCache::Destroy()
+{
+    m_Slots.clear();
+    m_PageSlots.clear();
+    m_ReleasedSlots.clear();
+    m_NextUnused = 0;
+    m_Newest = UINT32_MAX;
+    m_Oldest = UINT32_MAX;
+    m_ResidentCount = 0;
+}
+
+uint32_t VirtualTexturePageCache::Touch(uint32_t page, uint64_t frame)
+{
+    auto found = m_PageSlots.find(page);
+    if (found == m_PageSlots.end()) {
+        return UINT32_MAX;
+    }
+    uint32_t slot = found->second;
+    m_Slots[slot].m_LastUsed = frame;
+    if (SLOT_RESIDENT == m_Slots[slot].m_State && slot != m_Newest) {
+        Unlink(slot);
+        Link(slot);
+    }
+    return slot;
+}
+
+uint32_t VirtualTexturePageCache::Find(uint32_t page) const
+{
+    auto found = m_PageSlots.find(page);
+    return (found != m_PageSlots.end()) ? found->second : UINT32_MAX;
+}
+
+uint32_t VirtualTexturePageCache::Allocate(uint32_t page, uint64_t minFrame, uint32_t& evictedPage)
+{
+    evictedPage = UINT32_MAX;
+    uint32_t slot = UINT32_MAX;
+    if (!m_ReleasedSlots.empty()) {
+        slot = m_ReleasedSlots.back();
+        m_ReleasedSlots.pop_back();
+    } else if (m_NextUnused < m_Slots.size()) {
+        slot = m_NextUnused++;
+    } else if (UINT32_MAX != m_Oldest && m_Slots[m_Oldest].m_LastUsed < minFrame) {
+        slot = m_Oldest;
+        Unlink(slot);
+        evictedPage = m_Slots[slot].m_Page;
+        m_PageSlots.erase(evictedPage);
+        m_ResidentCount--;
+    } else {
+        return UINT32_MAX;
+    }
+
+    CacheSlot& entry = m_Slots[slot];
+    entry.m_Page = page;
+    entry.m_LastUsed = minFrame;
+    entry.m_State = SLOT_LOADING;
+    m_PageSlots[page] = slot;
+    return slot;
+}
+
+void VirtualTexturePageCache::MakeResident(uint32_t slot, bool pinned)
+{
+    m_Slots[slot].m_State = pinned ? SLOT_PINNED : SLOT_RESIDENT;
+    if (!pinned) {
+        Link(slot);
+    }
+    m_ResidentCount++;
+}
+
+void VirtualTexturePageCache::Release(uint32_t slot)
+{
+    CacheSlot& entry = m_Slots[slot];
+    m_PageSlots.erase(entry.m_Page);
+    entry.m_Page = UINT32_MAX;
+    entry.m_State = SLOT_FREE;
+    m_ReleasedSlots.push_back(slot);
+}
+
+void VirtualTexturePageCache::Link(uint32_t slot)
+{
+    CacheSlot& entry = m_Slots[slot];
+    entry.m_Newer = UINT32_MAX;
+    entry.m_Older = m_Newest;
+    if (UINT32_MAX != m_Newest) {
+        m_Slots[m_Newest].m_Newer = slot;
+    }
+    m_Newest = slot;
+    if (UINT32_MAX == m_Oldest) {
+        m_Oldest = slot;
+    }
+}
+
+void VirtualTexturePageCache::Unlink(uint32_t slot)
+{
+    CacheSlot& entry = m_Slots[slot];
+    if (UINT32_MAX != entry.m_Newer) {
+        m_Slots[entry.m_Newer].m_Older = entry.m_Older;
+    } else {
+        m_Newest = entry.m_Older;
+    }
+    if (UINT32_MAX != entry.m_Older) {
+        m_Slots[entry.m_Older].m_Newer = entry.m_Newer;
+    } else {
+        m_Oldest = entry.m_Newer;
+    }
+    entry.m_Newer = UINT32_MAX;
+    entry.m_Older = UINT32_MAX;
+}
+
+__END_NAMESPACE
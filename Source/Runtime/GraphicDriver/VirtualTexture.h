@@ -0,0 +1,116 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+// Texels a page covers a side, plus the border repeated from its neighbours on each side for filtering across
+// pages: 128 texels a side in all, the standard sparse block of 32 bit 2D images, so a page is one sparse block.
+static const uint32_t VIRTUAL_TEXTURE_PAGE_PAYLOAD = 120;
+static const uint32_t VIRTUAL_TEXTURE_PAGE_BORDER = 4;
+static const uint32_t VIRTUAL_TEXTURE_PAGE_SIZE = VIRTUAL_TEXTURE_PAGE_PAYLOAD + 2 * VIRTUAL_TEXTURE_PAGE_BORDER;
+static const uint32_t VIRTUAL_TEXTURE_PAGE_BYTES = VIRTUAL_TEXTURE_PAGE_SIZE * VIRTUAL_TEXTURE_PAGE_SIZE * 4;
+// Of a virtual texture 4096 pages a side, about 491K texels.
+static const uint32_t VIRTUAL_TEXTURE_MAX_MIPS = 13;
+static const uint32_t VIRTUAL_TEXTURE_MAGIC = 0x5854564B;    // "KVTX"
+static const uint32_t VIRTUAL_TEXTURE_VERSION = 1;
+
+
+// Head of a tiled texture set file. The textures are laid side by side in one square virtual texture, whose pages
+// follow the header mip after mip, row after row, each VIRTUAL_TEXTURE_PAGE_SIZE squared RGBA8 texels, so any
+// page is a single read at an offset computed from its index.
+typedef struct VirtualTextureHeader {
+	uint32_t    m_Magic;
+	uint32_t    m_Version;
+	uint32_t    m_TextureCount;
+	uint32_t    m_TextureSize;          // Texels a side, a multiple of the page payload so textures don't share mip 0 pages
+	uint32_t    m_TextureColumns;       // Textures a row of the virtual texture
+	uint32_t    m_PagesPerSide;         // Of mip 0, a power of two
+	uint32_t    m_MipCount;             // Down to a single page
+	uint32_t    m_PagePayload;
+	uint32_t    m_PageBorder;
+	uint32_t    m_Reserved[3];
+} VirtualTextureHeader;
+
+// Fills size squared RGBA8 texels of a texture of the set.
+typedef std::function<void(uint32_t texture, uint32_t size, uint8_t* rgba)> VirtualTextureGenerator;
+
+/**
+ * Lays textureCount textures out in a virtual texture, box filters its mips & writes them tiled. The whole mip 0
+ * is built in memory, this is an offline step.
+ */
+bool WriteVirtualTextureSet(const std::string& path, uint32_t textureCount, uint32_t textureSize, const VirtualTextureGenerator& generator);
+bool ReadVirtualTextureHeader(const std::string& path, VirtualTextureHeader& header);
+
+uint32_t GetVirtualTexturePagesPerSide(const VirtualTextureHeader& header, uint32_t mip);
+// Pages are numbered over all mips, mip 0 first, the way the feedback reports them.
+uint32_t GetVirtualTexturePageCount(const VirtualTextureHeader& header);
+uint32_t GetVirtualTexturePageIndex(const VirtualTextureHeader& header, uint32_t mip, uint32_t x, uint32_t y);
+void DecodeVirtualTexturePage(const VirtualTextureHeader& header, uint32_t page, uint32_t& mip, uint32_t& x, uint32_t& y);
+uint64_t GetVirtualTexturePageOffset(const VirtualTextureHeader& header, uint32_t page);
+
+
+/**
+ * Which page each slot of a physical page cache holds, the least recently used page making room for new ones.
+ * A slot is out of the LRU order while its page loads, so it can't be handed out twice, & pinned slots never
+ * join it. Pages used since a given frame are never evicted, a view needing more pages than the cache holds
+ * keeps the coarser ones it has rather than thrashing.
+ */
+class VirtualTexturePageCache
+{
+public:
+	VirtualTexturePageCache();
+	virtual ~VirtualTexturePageCache();
+
+	void Create(uint32_t slotCount);
+	void Destroy();
+
+	// The slot holding the page, loaded or loading, UINT32_MAX when it has none. Marks it used in the frame.
+	uint32_t Touch(uint32_t page, uint64_t frame);
+	// Same without marking it used.
+	uint32_t Find(uint32_t page) const;
+	// A slot for the page to load into, never used ones first, else the least recently used page's, returned in
+	// evictedPage. UINT32_MAX when every resident page was used since minFrame.
+	uint32_t Allocate(uint32_t page, uint64_t minFrame, uint32_t& evictedPage);
+	// Loaded, the page joins the LRU order as the most recently used one unless pinned.
+	void MakeResident(uint32_t slot, bool pinned);
+	// Failed to load, the slot is free again.
+	void Release(uint32_t slot);
+
+	bool IsResident(uint32_t slot) const { return SLOT_LOADING != m_Slots[slot].m_State && SLOT_FREE != m_Slots[slot].m_State; }
+	uint32_t GetPage(uint32_t slot) const { return m_Slots[slot].m_Page; }
+	uint32_t GetSlotCount() const { return (uint32_t)m_Slots.size(); }
+	uint32_t GetResidentCount() const { return m_ResidentCount; }
+	// Slots ever handed out, they are handed out in order so a sparse cache only binds memory up to there.
+	uint32_t GetUsedSlotCount() const { return m_NextUnused; }
+
+private:
+	enum : uint8_t {
+		SLOT_FREE = 0,
+		SLOT_LOADING,
+		SLOT_RESIDENT,
+		SLOT_PINNED,
+	};
+
+	typedef struct CacheSlot {
+		uint32_t    m_Page;
+		uint32_t    m_Newer;            // LRU neighbours, UINT32_MAX at the ends
+		uint32_t    m_Older;
+		uint64_t    m_LastUsed;
+		uint8_t     m_State;
+	} CacheSlot;
+
+	std::vector<CacheSlot>                  m_Slots;
+	std::unordered_map<uint32_t, uint32_t>  m_PageSlots;
+	std::vector<uint32_t>                   m_ReleasedSlots;
+	uint32_t                                m_NextUnused;
+	uint32_t                                m_Newest;
+	uint32_t                                m_Oldest;
+	uint32_t                                m_ResidentCount;
+
+	void Link(uint32_t slot);
+	void Unlink(uint32_t slot);
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,53 @@
+#include "VulkanAllocator.h"
+
+
+__BEGIN_NAMESPACE
+
+static std::atomic<size_t> g_VulkanInternalAllocatedBytes(0);
+
+static void* VKAPI_PTR VulkanAllocation(void*, size_t size, size_t alignment, VkSystemAllocationScope)
+{
+    return MemoryAllocate(size, MemoryTag::Vulkan, alignment);
+}
+
+static void* VKAPI_PTR VulkanReallocation(void*, void* original, size_t size, size_t alignment, VkSystemAllocationScope)
+{
+    return MemoryReallocate(original, size, MemoryTag::Vulkan, alignment);
+}
+
+static void VKAPI_PTR VulkanFree(void*, void* memory)
+{
+    MemoryFree(memory);
+}
+
+static void VKAPI_PTR VulkanInternalAllocation(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope)
+{
+    g_VulkanInternalAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+static void VKAPI_PTR VulkanInternalFree(void*, size_t size, VkInternalAllocationType, VkSystemAllocationScope)
+{
+    g_VulkanInternalAllocatedBytes.fetch_sub(size, std::memory_order_relaxed);
+}
+
+static const VkAllocationCallbacks g_VulkanAllocationCallbacks =
+{
+    nullptr,
+    VulkanAllocation,
+    VulkanReallocation,
+    VulkanFree,
+    VulkanInternalAllocation,
+    VulkanInternalFree,
+};
+
+const VkAllocationCallbacks* GetVulkanAllocator()
+{
+    return &g_VulkanAllocationCallbacks;
+}
+
+size_t GetVulkanInternalAllocatedBytes()
+{
+    return g_VulkanInternalAllocatedBytes.load(std::memory_order_relaxed);
+}
+
+__END_NAMESPACE
@@ -0,0 +1,15 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+// Routes Vulkan host allocations through the tagged heap (MemoryTag::Vulkan).
+// Pass the same pointer to a vkCreate* call and its matching vkDestroy*.
+const VkAllocationCallbacks* GetVulkanAllocator();
+
+// Memory the implementation allocated on its own and only reported through the internal notifications.
+size_t GetVulkanInternalAllocatedBytes();
+
+
+__END_NAMESPACE
@@ -0,0 +1,575 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanCascadedShadows.h"
+
+
+__BEGIN_NAMESPACE
+
+// Smallest first, the static cache is copied every frame.
+static const VkFormat SHADOW_DEPTH_FORMATS[] = {
+    VK_FORMAT_D16_UNORM,
+    VK_FORMAT_D32_SFLOAT,
+};
+// Rounding of the cascade radii, so float noise in the frustum corners doesn't resize a cascade.
+static const float SHADOW_RADIUS_QUANTUM = 1.0f / 16.0f;
+
+enum ShadowBinding
+{
+    ShadowBinding_Params = 0,
+    ShadowBinding_Map,
+    ShadowBinding_Count,
+};
+
+static double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// NDC depth of a point at viewDepth in front of the camera.
+static float ViewDepthToNdc(const glm::mat4& projection, float viewDepth)
+{
+    glm::vec4 clip = projection * glm::vec4(0.0f, 0.0f, -viewDepth, 1.0f);
+    return clip.z / clip.w;
+}
+
+
+VulkanCascadedShadows::VulkanCascadedShadows() :
+	m_CreateInfo{},
+	m_DepthFormat(VK_FORMAT_UNDEFINED),
+	m_ShadowLayerViews{},
+	m_StaticLayerViews{},
+	m_ShadowFramebuffers{},
+	m_StaticFramebuffers{},
+	m_StaticRenderPass(VK_NULL_HANDLE),
+	m_DynamicRenderPass(VK_NULL_HANDLE),
+	m_Sampler(VK_NULL_HANDLE),
+	m_DescriptorSetLayout(VK_NULL_HANDLE),
+	m_DescriptorPool(VK_NULL_HANDLE),
+	m_DescriptorSet(VK_NULL_HANDLE),
+	m_QueryPool(VK_NULL_HANDLE),
+	m_TimestampPeriod(1.0),
+	m_TimestampMask(UINT64_MAX),
+	m_QueryWritten(false),
+	m_CascadeRadii{},
+	m_StaticValid{},
+	m_LightDirection(0.0f),
+	m_StaticVersion(0),
+	m_Params{},
+	m_LastTiming({ 0.0, 0.0, 0 })
+{
+}
+
+VulkanCascadedShadows::~VulkanCascadedShadows()
+{
+}
+
+bool VulkanCascadedShadows::Create(const VulkanCascadedShadowsCreateInfo& createInfo)
+{
+    m_CreateInfo = createInfo;
+    m_CreateInfo.m_Resolution = std::max(m_CreateInfo.m_Resolution, 1u);
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+
+    const VkFormatFeatureFlags depthFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    VkFormatFeatureFlags formatFeatures = 0;
+    m_DepthFormat = VK_FORMAT_UNDEFINED;
+    for (VkFormat format : SHADOW_DEPTH_FORMATS) {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+        if ((formatProperties.optimalTilingFeatures & depthFeatures) == depthFeatures) {
+            m_DepthFormat = format;
+            formatFeatures = formatProperties.optimalTilingFeatures;
+            break;
+        }
+    }
+    if (VK_FORMAT_UNDEFINED == m_DepthFormat) {
+        std::cout << "Vulkan has no sampled depth format for shadow maps.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    /****************************************************************************
+     * Create the shadow map, the static cache & their per cascade targets
+     ****************************************************************************/
+    VkExtent2D extent = { m_CreateInfo.m_Resolution, m_CreateInfo.m_Resolution };
+    VULKAN_DRIVER_CHECK_FUN(CreateImage2DArray(device, physicalDevice, extent, SHADOW_CASCADE_COUNT, m_DepthFormat,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+        VK_IMAGE_ASPECT_DEPTH_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_ShadowMap));
+    VULKAN_DRIVER_CHECK_FUN(CreateImage2DArray(device, physicalDevice, extent, SHADOW_CASCADE_COUNT, m_DepthFormat,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        VK_IMAGE_ASPECT_DEPTH_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_StaticCache));
+    VULKAN_DRIVER_CHECK_FUN(CreateRenderPass(true, m_StaticRenderPass));
+    VULKAN_DRIVER_CHECK_FUN(CreateRenderPass(false, m_DynamicRenderPass));
+    VULKAN_DRIVER_CHECK_FUN(CreateLayers(m_StaticCache, m_StaticRenderPass, m_StaticLayerViews, m_StaticFramebuffers));
+    VULKAN_DRIVER_CHECK_FUN(CreateLayers(m_ShadowMap, m_DynamicRenderPass, m_ShadowLayerViews, m_ShadowFramebuffers));
+
+    // Outside of the map is lit, 2x2 hardware PCF where the format filters.
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = (formatFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    samplerInfo.minFilter = samplerInfo.magFilter;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    samplerInfo.compareEnable = VK_TRUE;
+    samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    samplerInfo.maxLod = 0.0f;
+    if (vkCreateSampler(device, &samplerInfo, GetVulkanAllocator(), &m_Sampler) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create shadow sampler.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, sizeof(CascadedShadowParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_ParamsBuffer));
+    memset(m_ParamsBuffer.m_Mapped, 0, sizeof(CascadedShadowParams));
+    VULKAN_DRIVER_CHECK_FUN(CreateDescriptorSet());
+
+    /****************************************************************************
+     * Timestamps around the shadow pass
+     ****************************************************************************/
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    uint32_t validBits = (m_CreateInfo.m_QueueFamilyIndex < queueFamilyCount) ? queueFamilies[m_CreateInfo.m_QueueFamilyIndex].timestampValidBits : 0;
+
+    if (0 != validBits && deviceProperties.limits.timestampPeriod > 0.0f) {
+        m_TimestampPeriod = deviceProperties.limits.timestampPeriod;
+        m_TimestampMask = (validBits >= 64) ? UINT64_MAX : ((1ull << validBits) - 1);
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = 2;
+        if (vkCreateQueryPool(device, &queryPoolInfo, GetVulkanAllocator(), &m_QueryPool) != VK_SUCCESS) {
+            m_QueryPool = VK_NULL_HANDLE;
+        }
+    }
+
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        m_StaticValid[i] = false;
+    }
+    std::cout << "Vulkan cascaded shadows created, " << SHADOW_CASCADE_COUNT << " cascades of " << m_CreateInfo.m_Resolution << "x"
+        << m_CreateInfo.m_Resolution << (VK_NULL_HANDLE == m_QueryPool ? ", no GPU timestamps" : "") << ".\n";
+    return true;
+}
+
+bool VulkanCascadedShadows::CreateRenderPass(bool staticCache, VkRenderPass& renderPass)
+{
+    // The static pass redraws a cache layer from scratch, the dynamic one draws over the cache's copy.
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = m_DepthFormat;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = staticCache ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = staticCache ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    depthAttachment.finalLayout = staticCache ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 0;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+    // Static: after the previous copy out of the cache & before the next one.
+    // Dynamic: after the copy into the map & before the scene samples it.
+    VkSubpassDependency dependencies[2] = {};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[0].srcAccessMask = staticCache ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = staticCache ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    dependencies[1].dstAccessMask = staticCache ? VK_ACCESS_TRANSFER_READ_BIT : VK_ACCESS_SHADER_READ_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &depthAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 2;
+    renderPassInfo.pDependencies = dependencies;
+    if (vkCreateRenderPass(m_CreateInfo.m_Device, &renderPassInfo, GetVulkanAllocator(), &renderPass) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create shadow render pass.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanCascadedShadows::CreateLayers(VulkanImage& image, VkRenderPass renderPass, VkImageView* views, VkFramebuffer* framebuffers)
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image.m_Image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = m_DepthFormat;
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, i, 1 };
+        if (vkCreateImageView(device, &viewInfo, GetVulkanAllocator(), &views[i]) != VK_SUCCESS) {
+            std::cout << "Vulkan failed to create shadow cascade view.\n";
+            SetErrorCode(ErrorCode::UnKnow);
+            return false;
+        }
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.pAttachments = &views[i];
+        framebufferInfo.width = m_CreateInfo.m_Resolution;
+        framebufferInfo.height = m_CreateInfo.m_Resolution;
+        framebufferInfo.layers = 1;
+        if (vkCreateFramebuffer(device, &framebufferInfo, GetVulkanAllocator(), &framebuffers[i]) != VK_SUCCESS) {
+            std::cout << "Vulkan failed to create shadow cascade framebuffer.\n";
+            SetErrorCode(ErrorCode::UnKnow);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VulkanCascadedShadows::CreateDescriptorSet()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+
+    VkDescriptorSetLayoutBinding bindings[ShadowBinding_Count]{};
+    bindings[ShadowBinding_Params].binding = ShadowBinding_Params;
+    bindings[ShadowBinding_Params].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    bindings[ShadowBinding_Params].descriptorCount = 1;
+    bindings[ShadowBinding_Params].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[ShadowBinding_Map].binding = ShadowBinding_Map;
+    bindings[ShadowBinding_Map].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[ShadowBinding_Map].descriptorCount = 1;
+    bindings[ShadowBinding_Map].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = ShadowBinding_Count;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_DescriptorSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create shadow descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(device, &poolInfo, GetVulkanAllocator(), &m_DescriptorPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create shadow descriptor pool.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_DescriptorSetLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_DescriptorSet) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate shadow descriptor set.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = m_ParamsBuffer.m_Buffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = VK_WHOLE_SIZE;
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = m_Sampler;
+    imageInfo.imageView = m_ShadowMap.m_View;
+    imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkWriteDescriptorSet writes[ShadowBinding_Count]{};
+    writes[ShadowBinding_Params].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[ShadowBinding_Params].dstSet = m_DescriptorSet;
+    writes[ShadowBinding_Params].dstBinding = ShadowBinding_Params;
+    writes[ShadowBinding_Params].descriptorCount = 1;
+    writes[ShadowBinding_Params].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writes[ShadowBinding_Params].pBufferInfo = &bufferInfo;
+    writes[ShadowBinding_Map].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[ShadowBinding_Map].dstSet = m_DescriptorSet;
+    writes[ShadowBinding_Map].dstBinding = ShadowBinding_Map;
+    writes[ShadowBinding_Map].descriptorCount = 1;
+    writes[ShadowBinding_Map].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[ShadowBinding_Map].pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(device, ShadowBinding_Count, writes, 0, nullptr);
+    return true;
+}
+
+void VulkanCascadedShadows::GetPipelineState(VkPipelineRasterizationStateCreateInfo& rasterizer, VkPipelineDepthStencilStateCreateInfo& depthStencil) const
+{
+    // Thin casters shadow from both sides, the bias takes care of the acne culling front faces would hide.
+    rasterizer = {};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_TRUE;
+    rasterizer.depthBiasConstantFactor = 1.25f;
+    rasterizer.depthBiasSlopeFactor = 1.75f;
+
+    depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    depthStencil.minDepthBounds = 0.0f;
+    depthStencil.maxDepthBounds = 1.0f;
+}
+
+void VulkanCascadedShadows::Update(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec3& lightDirection,
+    uint64_t staticVersion)
+{
+    PROFILE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+
+    glm::vec3 direction = glm::normalize(lightDirection);
+    if (staticVersion != m_StaticVersion || glm::dot(direction, m_LightDirection) < 0.99999f) {
+        for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+            m_StaticValid[i] = false;
+        }
+        m_StaticVersion = staticVersion;
+        m_LightDirection = direction;
+    }
+
+    // Practical split scheme, a blend of uniform & logarithmic splits.
+    float shadowFar = std::max(std::min(farPlane, m_CreateInfo.m_MaxDistance), nearPlane * 2.0f);
+    glm::mat4 inverseProjection = glm::inverse(projection);
+    glm::mat4 inverseView = glm::inverse(view);
+    float cascadeNear = nearPlane;
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        float fraction = (float)(i + 1) / (float)SHADOW_CASCADE_COUNT;
+        float uniformSplit = nearPlane + (shadowFar - nearPlane) * fraction;
+        float logSplit = nearPlane * pow(shadowFar / nearPlane, fraction);
+        float cascadeFar = uniformSplit + (logSplit - uniformSplit) * m_CreateInfo.m_SplitLambda;
+
+        FitCascade(i, inverseProjection, inverseView, ViewDepthToNdc(projection, cascadeNear), ViewDepthToNdc(projection, cascadeFar));
+        m_Params.m_SplitDepths[i] = cascadeFar;
+        cascadeNear = cascadeFar;
+    }
+    m_Params.m_View = view;
+    m_Params.m_LightDirection = glm::vec4(m_LightDirection, 0.0f);
+    memcpy(m_ParamsBuffer.m_Mapped, &m_Params, sizeof(CascadedShadowParams));
+
+    m_LastTiming.m_CpuMs = ElapsedMilliseconds(start);
+}
+
+void VulkanCascadedShadows::FitCascade(uint32_t cascade, const glm::mat4& inverseProjection, const glm::mat4& inverseView, float nearNdc, float farNdc)
+{
+    // In view space, so the sphere is the same bit for bit whatever way the camera looks or moves.
+    glm::vec3 corners[8];
+    glm::vec3 viewCenter(0.0f);
+    for (uint32_t i = 0; i < 8; i++) {
+        glm::vec4 corner = inverseProjection * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? farNdc : nearNdc, 1.0f);
+        corners[i] = glm::vec3(corner) / corner.w;
+        viewCenter += corners[i];
+    }
+    viewCenter /= 8.0f;
+    float radius = 0.0f;
+    for (uint32_t i = 0; i < 8; i++) {
+        radius = std::max(radius, glm::length(corners[i] - viewCenter));
+    }
+    radius = ceil(radius / SHADOW_RADIUS_QUANTUM) * SHADOW_RADIUS_QUANTUM;
+
+    glm::vec3 up = (fabs(m_LightDirection.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), -m_LightDirection, up);
+    glm::vec3 lightCenter = glm::vec3(lightRotation * inverseView * glm::vec4(viewCenter, 1.0f));
+
+    bool keep = false;
+    if (cascade >= m_CreateInfo.m_CachedCascadeStart) {
+        float sliceRadius = radius;
+        radius = ceil(radius * (1.0f + m_CreateInfo.m_CachedMargin) / SHADOW_RADIUS_QUANTUM) * SHADOW_RADIUS_QUANTUM;
+        // Stays put while the slice is inside, so the static layer survives camera motion.
+        keep = m_StaticValid[cascade] && radius == m_CascadeRadii[cascade] &&
+            glm::length(lightCenter - m_CascadeCenters[cascade]) + sliceRadius <= radius;
+    }
+
+    // Whole texel steps in light space, a moving camera then only ever shifts the map by whole texels.
+    float texelSize = 2.0f * radius / (float)m_CreateInfo.m_Resolution;
+    if (keep) {
+        lightCenter = m_CascadeCenters[cascade];
+    } else {
+        lightCenter = glm::floor(lightCenter / texelSize) * texelSize;
+    }
+    if (!m_StaticValid[cascade] || lightCenter != m_CascadeCenters[cascade] || radius != m_CascadeRadii[cascade]) {
+        m_StaticValid[cascade] = false;
+        m_CascadeCenters[cascade] = lightCenter;
+        m_CascadeRadii[cascade] = radius;
+    }
+
+    // Casters between the light & the sphere are kept up to m_CasterExtension away.
+    glm::mat4 lightView = glm::translate(glm::mat4(1.0f), -lightCenter) * lightRotation;
+    glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, -(radius + m_CreateInfo.m_CasterExtension), radius);
+    m_Params.m_LightViewProjection[cascade] = lightProjection * lightView;
+    m_Params.m_TexelSizes[cascade] = texelSize;
+}
+
+void VulkanCascadedShadows::RecordPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer, uint32_t cascade,
+    const ShadowCasterCallback& draw)
+{
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = framebuffer;
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = { m_CreateInfo.m_Resolution, m_CreateInfo.m_Resolution };
+    VkClearValue clearValue{};
+    clearValue.depthStencil = { 1.0f, 0 };
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport = { 0.0f, 0.0f, (float)m_CreateInfo.m_Resolution, (float)m_CreateInfo.m_Resolution, 0.0f, 1.0f };
+    VkRect2D scissor = { { 0, 0 }, { m_CreateInfo.m_Resolution, m_CreateInfo.m_Resolution } };
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    if (draw) {
+        draw(commandBuffer, m_Params.m_LightViewProjection[cascade]);
+    }
+    vkCmdEndRenderPass(commandBuffer);
+}
+
+void VulkanCascadedShadows::RecordShadows(VkCommandBuffer commandBuffer, const ShadowCasterCallback& drawStatic, const ShadowCasterCallback& drawDynamic)
+{
+    PROFILE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdResetQueryPool(commandBuffer, m_QueryPool, 0, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, 0);
+    }
+
+    m_LastTiming.m_StaticCascades = 0;
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        if (!m_StaticValid[i]) {
+            RecordPass(commandBuffer, m_StaticRenderPass, m_StaticFramebuffers[i], i, drawStatic);
+            m_StaticValid[i] = true;
+            m_LastTiming.m_StaticCascades++;
+        }
+    }
+
+    // Every layer of the cache is in TRANSFER_SRC_OPTIMAL once it's been drawn, the map is overwritten whole.
+    CmdImageBarrier(commandBuffer, m_ShadowMap.m_Image, VK_IMAGE_ASPECT_DEPTH_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    VkImageCopy region{};
+    region.srcSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, SHADOW_CASCADE_COUNT };
+    region.dstSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, SHADOW_CASCADE_COUNT };
+    region.extent = { m_CreateInfo.m_Resolution, m_CreateInfo.m_Resolution, 1 };
+    vkCmdCopyImage(commandBuffer, m_StaticCache.m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        m_ShadowMap.m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        RecordPass(commandBuffer, m_DynamicRenderPass, m_ShadowFramebuffers[i], i, drawDynamic);
+    }
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, 1);
+        m_QueryWritten = true;
+    }
+    m_LastTiming.m_CpuMs += ElapsedMilliseconds(start);
+}
+
+void VulkanCascadedShadows::CollectGpuTiming()
+{
+    if (VK_NULL_HANDLE == m_QueryPool || !m_QueryWritten) {
+        return;
+    }
+
+    uint64_t timestamps[2] = {};
+    if (VK_SUCCESS != vkGetQueryPoolResults(m_CreateInfo.m_Device, m_QueryPool, 0, 2, sizeof(timestamps), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT)) {
+        return;
+    }
+    m_QueryWritten = false;
+    m_LastTiming.m_GpuMs = ((timestamps[1] - timestamps[0]) & m_TimestampMask) * m_TimestampPeriod / 1000000.0;
+    PROFILE_COUNTER("ShadowGpuMs", m_LastTiming.m_GpuMs);
+}
+
+void VulkanCascadedShadows::Destroy()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE == device) {
+        return;
+    }
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkDestroyQueryPool(device, m_QueryPool, GetVulkanAllocator());
+        m_QueryPool = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorPool) {
+        vkDestroyDescriptorPool(device, m_DescriptorPool, GetVulkanAllocator());
+        m_DescriptorPool = VK_NULL_HANDLE;
+        m_DescriptorSet = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorSetLayout) {
+        vkDestroyDescriptorSetLayout(device, m_DescriptorSetLayout, GetVulkanAllocator());
+        m_DescriptorSetLayout = VK_NULL_HANDLE;
+    }
+    DestroyBuffer(device, m_ParamsBuffer);
+    if (VK_NULL_HANDLE != m_Sampler) {
+        vkDestroySampler(device, m_Sampler, GetVulkanAllocator());
+        m_Sampler = VK_NULL_HANDLE;
+    }
+    for (uint32_t i = 0; i < SHADOW_CASCADE_COUNT; i++) {
+        if (VK_NULL_HANDLE != m_ShadowFramebuffers[i]) {
+            vkDestroyFramebuffer(device, m_ShadowFramebuffers[i], GetVulkanAllocator());
+            m_ShadowFramebuffers[i] = VK_NULL_HANDLE;
+        }
+        if (VK_NULL_HANDLE != m_StaticFramebuffers[i]) {
+            vkDestroyFramebuffer(device, m_StaticFramebuffers[i], GetVulkanAllocator());
+            m_StaticFramebuffers[i] = VK_NULL_HANDLE;
+        }
+        if (VK_NULL_HANDLE != m_ShadowLayerViews[i]) {
+            vkDestroyImageView(device, m_ShadowLayerViews[i], GetVulkanAllocator());
+            m_ShadowLayerViews[i] = VK_NULL_HANDLE;
+        }
+        if (VK_NULL_HANDLE != m_StaticLayerViews[i]) {
+            vkDestroyImageView(device, m_StaticLayerViews[i], GetVulkanAllocator());
+            m_StaticLayerViews[i] = VK_NULL_HANDLE;
+        }
+    }
+    if (VK_NULL_HANDLE != m_DynamicRenderPass) {
+        vkDestroyRenderPass(device, m_DynamicRenderPass, GetVulkanAllocator());
+        m_DynamicRenderPass = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_StaticRenderPass) {
+        vkDestroyRenderPass(device, m_StaticRenderPass, GetVulkanAllocator());
+        m_StaticRenderPass = VK_NULL_HANDLE;
+    }
+    DestroyImage(device, m_ShadowMap);
+    DestroyImage(device, m_StaticCache);
+    m_CreateInfo.m_Device = VK_NULL_HANDLE;
+}
+
+__END_NAMESPACE
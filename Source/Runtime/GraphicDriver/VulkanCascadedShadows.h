@@ -0,0 +1,120 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+static const uint32_t SHADOW_CASCADE_COUNT = 4;
+
+// Same std140 layout as the CascadedShadowParams block of shadow_common.glsl.
+typedef struct CascadedShadowParams {
+	glm::mat4            m_LightViewProjection[SHADOW_CASCADE_COUNT];   // World to shadow clip space, one per cascade
+	glm::mat4            m_View;                 // Of the camera, the cascade is picked by view depth
+	glm::vec4            m_SplitDepths;          // Far view depth of each cascade
+	glm::vec4            m_TexelSizes;           // World size of a shadow texel in each cascade, scales the normal offset
+	glm::vec4            m_LightDirection;       // xyz: towards the light
+} CascadedShadowParams;
+
+typedef struct VulkanCascadedShadowsCreateInfo {
+	VkDevice             m_Device;
+	VkPhysicalDevice     m_PhysicalDevice;
+	uint32_t             m_QueueFamilyIndex;            // Of the queue the shadows are recorded for, for timestamps
+	uint32_t             m_Resolution = 2048;
+	uint32_t             m_CachedCascadeStart = 2;      // Cascades from this one on only follow the camera once it leaves their margin
+	float                m_CachedMargin = 0.25f;        // Extra radius of the cached cascades, relative
+	float                m_MaxDistance = 150.0f;        // View depth the shadows stop at
+	float                m_SplitLambda = 0.75f;         // 0 uniform splits, 1 logarithmic
+	float                m_CasterExtension = 100.0f;    // World distance towards the light casters are kept from
+} VulkanCascadedShadowsCreateInfo;
+
+typedef struct CascadedShadowTiming {
+	double               m_CpuMs;                // Cascade fitting & recording
+	double               m_GpuMs;                // Whole shadow pass, 0 without timestamp support
+	uint32_t             m_StaticCascades;       // Cascades whose static casters were redrawn
+} CascadedShadowTiming;
+
+// Draws casters with a pipeline made from GetPipelineState() for GetRenderPass(), viewProjection being the cascade's.
+typedef std::function<void(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection)> ShadowCasterCallback;
+
+
+/**
+ * Cascaded shadow maps of one directional light. Cascades are fitted to bounding spheres of the view frustum
+ * slices, so their size doesn't change as the camera turns, and their origin snaps to whole shadow texels,
+ * which keeps the shadow edges from shimmering as the camera moves.
+ *
+ * Static casters are rendered into a cache of their own, a cascade's static layer being redrawn only when the
+ * light, the static geometry or the cascade's placement changes. Every frame the cache is copied into the
+ * sampled map & only the dynamic casters are drawn on top. Cascades from m_CachedCascadeStart on are fitted
+ * with a margin & stay put until the camera leaves it, so they're redrawn about only when the light or the static
+ * geometry moves.
+ */
+class VulkanCascadedShadows
+{
+public:
+	VulkanCascadedShadows();
+	virtual ~VulkanCascadedShadows();
+
+	bool Create(const VulkanCascadedShadowsCreateInfo& createInfo);
+	void Destroy();
+
+	// Fits the cascades to the camera, projection depth range being [0, 1], lightDirection pointing towards the light.
+	// Bump staticVersion whenever a static caster moves. The parameters are written on the host, so call it while no
+	// submitted frame samples the shadows.
+	void Update(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, const glm::vec3& lightDirection,
+		uint64_t staticVersion);
+	// Record outside of a render pass, before the draws sampling the shadows. The previous shadow pass must be complete.
+	void RecordShadows(VkCommandBuffer commandBuffer, const ShadowCasterCallback& drawStatic, const ShadowCasterCallback& drawDynamic);
+	// Once the recorded frame's fence signaled, reads back the GPU time of its shadow pass.
+	void CollectGpuTiming();
+	const CascadedShadowTiming& GetLastTiming() const { return m_LastTiming; }
+
+	// Depth only pass the casters are drawn in, compatible with both the static & dynamic ones.
+	VkRenderPass GetRenderPass() const { return m_DynamicRenderPass; }
+	// Rasterization, with depth bias & no culling, and depth state of caster pipelines.
+	void GetPipelineState(VkPipelineRasterizationStateCreateInfo& rasterizer, VkPipelineDepthStencilStateCreateInfo& depthStencil) const;
+	// Fragment stage, the parameters & the shadow map with a compare sampler, see shadow_common.glsl.
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout; }
+	VkDescriptorSet GetDescriptorSet() const { return m_DescriptorSet; }
+
+private:
+	VulkanCascadedShadowsCreateInfo   m_CreateInfo;
+	VkFormat                          m_DepthFormat;
+	VulkanImage                       m_ShadowMap;          // Sampled, static cache copy & dynamic casters
+	VulkanImage                       m_StaticCache;
+	VkImageView                       m_ShadowLayerViews[SHADOW_CASCADE_COUNT];
+	VkImageView                       m_StaticLayerViews[SHADOW_CASCADE_COUNT];
+	VkFramebuffer                     m_ShadowFramebuffers[SHADOW_CASCADE_COUNT];
+	VkFramebuffer                     m_StaticFramebuffers[SHADOW_CASCADE_COUNT];
+	VkRenderPass                      m_StaticRenderPass;
+	VkRenderPass                      m_DynamicRenderPass;
+	VkSampler                         m_Sampler;
+	VulkanBuffer                      m_ParamsBuffer;
+
+	VkDescriptorSetLayout             m_DescriptorSetLayout;
+	VkDescriptorPool                  m_DescriptorPool;
+	VkDescriptorSet                   m_DescriptorSet;
+
+	VkQueryPool                       m_QueryPool;
+	double                            m_TimestampPeriod;    // Nanoseconds per tick
+	uint64_t                          m_TimestampMask;
+	bool                              m_QueryWritten;
+
+	// Placement of each cascade, its static layer is valid while these match what it was drawn with.
+	glm::vec3                         m_CascadeCenters[SHADOW_CASCADE_COUNT];    // Light space, snapped to texels
+	float                             m_CascadeRadii[SHADOW_CASCADE_COUNT];
+	bool                              m_StaticValid[SHADOW_CASCADE_COUNT];
+	glm::vec3                         m_LightDirection;
+	uint64_t                          m_StaticVersion;
+	CascadedShadowParams              m_Params;
+	CascadedShadowTiming              m_LastTiming;
+
+	bool CreateRenderPass(bool staticCache, VkRenderPass& renderPass);
+	bool CreateLayers(VulkanImage& image, VkRenderPass renderPass, VkImageView* views, VkFramebuffer* framebuffers);
+	bool CreateDescriptorSet();
+	void FitCascade(uint32_t cascade, const glm::mat4& inverseProjection, const glm::mat4& inverseView, float nearNdc, float farNdc);
+	void RecordPass(VkCommandBuffer commandBuffer, VkRenderPass renderPass, VkFramebuffer framebuffer, uint32_t cascade,
+		const ShadowCasterCallback& draw);
+};
+
+
+__END_NAMESPACE
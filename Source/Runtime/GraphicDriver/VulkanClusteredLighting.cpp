@@ -0,0 +1,300 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanClusteredLighting.h"
+
+
+__BEGIN_NAMESPACE
+
+// Keep in sync with clustered_lighting_common.glsl & light_cluster.shader.comp
+static const uint32_t CLUSTER_CULL_GROUP_SIZE = 64;
+static const uint32_t CLUSTER_MAX_LIGHTS = 256;
+
+enum ClusterBinding
+{
+    ClusterBinding_Params = 0,
+    ClusterBinding_Lights,
+    ClusterBinding_Counts,
+    ClusterBinding_Indices,
+    ClusterBinding_Count,
+};
+
+
+VulkanClusteredLighting::VulkanClusteredLighting() :
+	m_CreateInfo{},
+	m_LightCount(0),
+	m_LightsDirty(false),
+	m_DescriptorSetLayout(VK_NULL_HANDLE),
+	m_DescriptorPool(VK_NULL_HANDLE),
+	m_DescriptorSet(VK_NULL_HANDLE),
+	m_PipelineLayout(VK_NULL_HANDLE),
+	m_CullPipeline(VK_NULL_HANDLE)
+{
+}
+
+VulkanClusteredLighting::~VulkanClusteredLighting()
+{
+}
+
+bool VulkanClusteredLighting::Create(const VulkanClusteredLightingCreateInfo& createInfo)
+{
+    m_CreateInfo = createInfo;
+    m_CreateInfo.m_MaxLights = std::max(m_CreateInfo.m_MaxLights, 1u);
+    if (0 == GetClusterCount()) {
+        std::cout << "Vulkan clustered lighting created with an empty cluster grid.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+
+    /****************************************************************************
+     * Create buffers
+     ****************************************************************************/
+    // Lights are read once per cluster group & per shaded fragment, keep them in device memory.
+    VkDeviceSize lightBytes = sizeof(ClusteredLight) * m_CreateInfo.m_MaxLights;
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, sizeof(ClusteredLightingParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_ParamsBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, lightBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_LightStagingBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, lightBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_LightBuffer));
+    // Fixed slots of CLUSTER_MAX_LIGHTS per cluster, no global counter to clear & no compaction pass.
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, sizeof(uint32_t) * GetClusterCount(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_ClusterCountBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, sizeof(uint32_t) * GetClusterCount() * CLUSTER_MAX_LIGHTS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_ClusterIndexBuffer));
+    memset(m_ParamsBuffer.m_Mapped, 0, sizeof(ClusteredLightingParams));
+
+    VULKAN_DRIVER_CHECK_FUN(CreateDescriptorSet());
+    VULKAN_DRIVER_CHECK_FUN(CreateCullPipeline());
+
+    std::cout << "Vulkan clustered lighting created, " << m_CreateInfo.m_GridX << "x" << m_CreateInfo.m_GridY << "x" << m_CreateInfo.m_GridZ
+        << " clusters, up to " << m_CreateInfo.m_MaxLights << " lights.\n";
+    return true;
+}
+
+bool VulkanClusteredLighting::CreateDescriptorSet()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+
+    VkDescriptorSetLayoutBinding bindings[ClusterBinding_Count]{};
+    for (uint32_t i = 0; i < ClusterBinding_Count; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = (ClusterBinding_Params == i) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = ClusterBinding_Count;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_DescriptorSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create cluster descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = ClusterBinding_Count - 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(device, &poolInfo, GetVulkanAllocator(), &m_DescriptorPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create cluster descriptor pool.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_DescriptorSetLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_DescriptorSet) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate cluster descriptor set.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    const VulkanBuffer* buffers[ClusterBinding_Count] = {
+        &m_ParamsBuffer, &m_LightBuffer, &m_ClusterCountBuffer, &m_ClusterIndexBuffer,
+    };
+    VkDescriptorBufferInfo bufferInfos[ClusterBinding_Count]{};
+    VkWriteDescriptorSet writes[ClusterBinding_Count]{};
+    for (uint32_t i = 0; i < ClusterBinding_Count; i++) {
+        bufferInfos[i].buffer = buffers[i]->m_Buffer;
+        bufferInfos[i].offset = 0;
+        bufferInfos[i].range = VK_WHOLE_SIZE;
+
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_DescriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = bindings[i].descriptorType;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(device, ClusterBinding_Count, writes, 0, nullptr);
+    return true;
+}
+
+bool VulkanClusteredLighting::CreateCullPipeline()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_PipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create cluster pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkShaderModule cullShaderModule = LoadShaderModule(device, "Data/Engine/light_cluster.cs.spv");
+    if (VK_NULL_HANDLE == cullShaderModule) {
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = cullShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_PipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, GetVulkanAllocator(), &m_CullPipeline);
+    vkDestroyShaderModule(device, cullShaderModule, GetVulkanAllocator());
+    if (result != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create light cluster pipeline.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+void VulkanClusteredLighting::SetLights(const ClusteredLight* lights, uint32_t count)
+{
+    if (nullptr == m_LightStagingBuffer.m_Mapped) {
+        return;
+    }
+    m_LightCount = std::min(count, m_CreateInfo.m_MaxLights);
+    if (m_LightCount > 0) {
+        memcpy(m_LightStagingBuffer.m_Mapped, lights, sizeof(ClusteredLight) * m_LightCount);
+    }
+    m_LightsDirty = true;
+}
+
+void VulkanClusteredLighting::RecordCull(VkCommandBuffer commandBuffer, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, VkExtent2D extent)
+{
+    PROFILE_FUNCTION();
+    if (VK_NULL_HANDLE == m_CullPipeline) {
+        return;
+    }
+
+    // Slice k spans [near * (far / near)^(k / Z), near * (far / near)^((k + 1) / Z)], so slice = log(depth) * scale + bias.
+    float logDepthRange = log(farPlane / nearPlane);
+    ClusteredLightingParams params;
+    params.m_View = view;
+    params.m_InverseProjection = glm::inverse(projection);
+    params.m_InverseView = glm::inverse(view);
+    params.m_CameraPosition = params.m_InverseView[3];
+    params.m_ScreenSize = glm::vec4((float)extent.width, (float)extent.height,
+        (float)((extent.width + m_CreateInfo.m_GridX - 1) / m_CreateInfo.m_GridX),
+        (float)((extent.height + m_CreateInfo.m_GridY - 1) / m_CreateInfo.m_GridY));
+    params.m_DepthSlicing = glm::vec4(nearPlane, farPlane, (float)m_CreateInfo.m_GridZ / logDepthRange,
+        -(float)m_CreateInfo.m_GridZ * log(nearPlane) / logDepthRange);
+    params.m_GridSize[0] = m_CreateInfo.m_GridX;
+    params.m_GridSize[1] = m_CreateInfo.m_GridY;
+    params.m_GridSize[2] = m_CreateInfo.m_GridZ;
+    params.m_GridSize[3] = m_LightCount;
+    memcpy(m_ParamsBuffer.m_Mapped, &params, sizeof(params));
+
+    if (m_LightsDirty && m_LightCount > 0) {
+        // Previous frame's reads of the lights must finish before they're overwritten.
+        VkMemoryBarrier readBarrier{};
+        readBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        readBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        readBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0, 1, &readBarrier, 0, nullptr, 0, nullptr);
+
+        VkBufferCopy region{};
+        region.size = sizeof(ClusteredLight) * m_LightCount;
+        vkCmdCopyBuffer(commandBuffer, m_LightStagingBuffer.m_Buffer, m_LightBuffer.m_Buffer, 1, &region);
+
+        VkMemoryBarrier copyBarrier{};
+        copyBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        copyBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        copyBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            0, 1, &copyBarrier, 0, nullptr, 0, nullptr);
+    }
+    m_LightsDirty = false;
+
+    // Previous frame's fragment reads of the clusters must finish before they're rebinned.
+    VkMemoryBarrier clusterReadBarrier{};
+    clusterReadBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clusterReadBarrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    clusterReadBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &clusterReadBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_DescriptorSet, 0, nullptr);
+    vkCmdDispatch(commandBuffer, (GetClusterCount() + CLUSTER_CULL_GROUP_SIZE - 1) / CLUSTER_CULL_GROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier cullBarrier{};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+        0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanClusteredLighting::Destroy()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE == device) {
+        return;
+    }
+
+    if (VK_NULL_HANDLE != m_CullPipeline) {
+        vkDestroyPipeline(device, m_CullPipeline, GetVulkanAllocator());
+        m_CullPipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_PipelineLayout) {
+        vkDestroyPipelineLayout(device, m_PipelineLayout, GetVulkanAllocator());
+        m_PipelineLayout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorPool) {
+        vkDestroyDescriptorPool(device, m_DescriptorPool, GetVulkanAllocator());
+        m_DescriptorPool = VK_NULL_HANDLE;
+        m_DescriptorSet = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorSetLayout) {
+        vkDestroyDescriptorSetLayout(device, m_DescriptorSetLayout, GetVulkanAllocator());
+        m_DescriptorSetLayout = VK_NULL_HANDLE;
+    }
+
+    DestroyBuffer(device, m_ParamsBuffer);
+    DestroyBuffer(device, m_LightStagingBuffer);
+    DestroyBuffer(device, m_LightBuffer);
+    DestroyBuffer(device, m_ClusterCountBuffer);
+    DestroyBuffer(device, m_ClusterIndexBuffer);
+    m_LightCount = 0;
+    m_LightsDirty = false;
+    m_CreateInfo.m_Device = VK_NULL_HANDLE;
+}
+
+__END_NAMESPACE
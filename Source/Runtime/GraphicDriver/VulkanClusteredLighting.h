@@ -0,0 +1,92 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+enum class ClusteredLightType : uint32_t
+{
+	Point = 0,
+	Spot,
+};
+
+// Same std430 layout as clustered_lighting_common.glsl.
+typedef struct ClusteredLight {
+	glm::vec4            m_PositionRange;     // xyz: world position, w: range, the light fades out to zero there
+	glm::vec4            m_ColorIntensity;    // rgb: linear color, w: intensity
+	glm::vec4            m_DirectionType;     // xyz: spot direction, w: ClusteredLightType
+	glm::vec4            m_SpotCosines;       // x: cosine of the outer angle, y: of the inner angle
+} ClusteredLight;
+
+// Same std140 layout as the ClusteredLightingParams block of clustered_lighting_common.glsl.
+typedef struct ClusteredLightingParams {
+	glm::mat4            m_View;
+	glm::mat4            m_InverseProjection;
+	glm::mat4            m_InverseView;
+	glm::vec4            m_CameraPosition;
+	glm::vec4            m_ScreenSize;        // xy: pixels, zw: pixels per cluster tile
+	glm::vec4            m_DepthSlicing;      // x: near, y: far, z: slice scale, w: slice bias
+	uint32_t             m_GridSize[4];       // xyz: clusters, w: light count
+} ClusteredLightingParams;
+
+typedef struct VulkanClusteredLightingCreateInfo {
+	VkDevice             m_Device;
+	VkPhysicalDevice     m_PhysicalDevice;
+	uint32_t             m_MaxLights;
+	uint32_t             m_GridX = 16;       // Screen tiles
+	uint32_t             m_GridY = 9;
+	uint32_t             m_GridZ = 24;       // Exponential depth slices
+} VulkanClusteredLightingCreateInfo;
+
+
+/**
+ * Clustered forward+ light culling: the view frustum is split into a grid of froxels, screen tiles by
+ * exponential depth slices, and a compute pass bins the point & spot lights touching each one into an SSBO.
+ * Forward shaders bind GetDescriptorSet() & shade with only the lights of their fragment's cluster, so the cost
+ * follows the lights per pixel rather than the total, see clustered_pbr.shader.frag.
+ */
+class VulkanClusteredLighting
+{
+public:
+	VulkanClusteredLighting();
+	virtual ~VulkanClusteredLighting();
+
+	bool Create(const VulkanClusteredLightingCreateInfo& createInfo);
+	void Destroy();
+
+	// Copied to the staging buffer, lights past GetMaxLights() are dropped. Call while no submitted frame reads them.
+	void SetLights(const ClusteredLight* lights, uint32_t count);
+	// Record outside of a render pass, before the draws reading the clusters. Projection depth range is [0, 1].
+	// The parameters are written on the host, same rule as SetLights().
+	void RecordCull(VkCommandBuffer commandBuffer, const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane, VkExtent2D extent);
+
+	// Compute & fragment stages, set it as the set the forward shaders declare.
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout; }
+	VkDescriptorSet GetDescriptorSet() const { return m_DescriptorSet; }
+	uint32_t GetMaxLights() const { return m_CreateInfo.m_MaxLights; }
+	uint32_t GetLightCount() const { return m_LightCount; }
+	uint32_t GetClusterCount() const { return m_CreateInfo.m_GridX * m_CreateInfo.m_GridY * m_CreateInfo.m_GridZ; }
+
+private:
+	VulkanClusteredLightingCreateInfo   m_CreateInfo;
+	uint32_t                            m_LightCount;
+	bool                                m_LightsDirty;
+
+	VulkanBuffer                        m_ParamsBuffer;
+	VulkanBuffer                        m_LightStagingBuffer;
+	VulkanBuffer                        m_LightBuffer;
+	VulkanBuffer                        m_ClusterCountBuffer;
+	VulkanBuffer                        m_ClusterIndexBuffer;
+
+	VkDescriptorSetLayout               m_DescriptorSetLayout;
+	VkDescriptorPool                    m_DescriptorPool;
+	VkDescriptorSet                     m_DescriptorSet;
+	VkPipelineLayout                    m_PipelineLayout;
+	VkPipeline                          m_CullPipeline;
+
+	bool CreateDescriptorSet();
+	bool CreateCullPipeline();
+};
+
+
+__END_NAMESPACE
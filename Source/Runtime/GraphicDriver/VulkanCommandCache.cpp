@@ -0,0 +1,134 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanCommandCache.h"
+
+
+__BEGIN_NAMESPACE
+
+uint64_t HashCommandContent(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+
+VulkanCommandCache::VulkanCommandCache() :
+    m_Device(VK_NULL_HANDLE),
+    m_CommandPool(VK_NULL_HANDLE),
+    m_FramesInFlight(0),
+    m_Statistics{}
+{
+}
+
+VulkanCommandCache::~VulkanCommandCache()
+{
+}
+
+bool VulkanCommandCache::Create(VkDevice device, VkCommandPool commandPool, uint32_t framesInFlight, uint32_t passCount)
+{
+    if (0 == framesInFlight || 0 == passCount) {
+        std::cout << "Invalid frames in flight or pass count for command cache.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    m_Device = device;
+    m_CommandPool = commandPool;
+    m_FramesInFlight = framesInFlight;
+
+    std::vector<VkCommandBuffer> commandBuffers(framesInFlight * passCount);
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+    allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
+    if (vkAllocateCommandBuffers(device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate cached secondary command buffers.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    m_Commands.resize(commandBuffers.size());
+    for (size_t i = 0; i < commandBuffers.size(); i++) {
+        m_Commands[i].m_CommandBuffer = commandBuffers[i];
+        m_Commands[i].m_Hash = 0;
+        m_Commands[i].m_Valid = false;
+    }
+    return true;
+}
+
+void VulkanCommandCache::Destroy()
+{
+    if (VK_NULL_HANDLE == m_Device) {
+        return;
+    }
+
+    std::vector<VkCommandBuffer> commandBuffers;
+    for (const auto& commands : m_Commands) {
+        commandBuffers.push_back(commands.m_CommandBuffer);
+    }
+    if (!commandBuffers.empty()) {
+        vkFreeCommandBuffers(m_Device, m_CommandPool, (uint32_t)commandBuffers.size(), commandBuffers.data());
+    }
+    m_Commands.clear();
+
+    m_Device = VK_NULL_HANDLE;
+    m_CommandPool = VK_NULL_HANDLE;
+}
+
+void VulkanCommandCache::Invalidate()
+{
+    for (auto& commands : m_Commands) {
+        commands.m_Valid = false;
+    }
+}
+
+VkCommandBuffer VulkanCommandCache::Acquire(uint32_t pass, uint32_t frameIndex, uint64_t contentHash, const VkCommandBufferInheritanceInfo& inheritance,
+    const std::function<void(VkCommandBuffer)>& record)
+{
+    uint32_t index = pass * m_FramesInFlight + frameIndex;
+    if (frameIndex >= m_FramesInFlight || index >= m_Commands.size()) {
+        return VK_NULL_HANDLE;
+    }
+
+    // Framebuffers are left out on purpose: they're optional for secondaries, so one recording serves every swapchain image.
+    uint64_t hash = HashCommandValue(contentHash, inheritance.renderPass);
+    hash = HashCommandValue(hash, inheritance.subpass);
+    CachedCommands& commands = m_Commands[index];
+    if (commands.m_Valid && commands.m_Hash == hash) {
+        m_Statistics.m_Reused++;
+        return commands.m_CommandBuffer;
+    }
+
+    PROFILE_ZONE("RecordSecondary");
+    commands.m_Valid = false;
+    vkResetCommandBuffer(commands.m_CommandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+    if (vkBeginCommandBuffer(commands.m_CommandBuffer, &beginInfo) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to begin recording secondary command buffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return VK_NULL_HANDLE;
+    }
+
+    record(commands.m_CommandBuffer);
+
+    if (vkEndCommandBuffer(commands.m_CommandBuffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to record secondary command buffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return VK_NULL_HANDLE;
+    }
+
+    commands.m_Hash = hash;
+    commands.m_Valid = true;
+    m_Statistics.m_Recorded++;
+    return commands.m_CommandBuffer;
+}
+
+__END_NAMESPACE
@@ -0,0 +1,65 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+static const uint64_t COMMAND_HASH_SEED = 0xcbf29ce484222325ull;
+
+// FNV-1a over size bytes, folded into hash. Chain calls starting from COMMAND_HASH_SEED.
+uint64_t HashCommandContent(uint64_t hash, const void* data, size_t size);
+template <typename T>
+FORCEINLINE uint64_t HashCommandValue(uint64_t hash, const T& value) { return HashCommandContent(hash, &value, sizeof(T)); }
+
+
+typedef struct CommandCacheStatistics {
+	uint64_t     m_Reused;            // Secondaries executed as previously recorded
+	uint64_t     m_Recorded;          // Secondaries recorded again, their content hash changed
+} CommandCacheStatistics;
+
+
+/**
+ * Secondary command buffers of the passes inside a render pass, kept across frames. Each pass has one per frame in
+ * flight, stamped with a hash of everything its commands depend on: while the hash stays the same the buffer is
+ * executed again as it is, only a pass whose hash changed is recorded again. Per frame instance data the commands
+ * read, rather than record, can change freely.
+ *
+ * Every buffer is recorded for its pass alone, it sets its own viewport & scissor, as secondaries inherit no state.
+ * Everything a hash leaves out, like pipelines or framebuffers recreated with the swapchain, goes with Invalidate(),
+ * which the owner calls when recreating them: the new handles may reuse the old values.
+ */
+class VulkanCommandCache
+{
+public:
+	VulkanCommandCache();
+	virtual ~VulkanCommandCache();
+
+	// Secondaries come from commandPool, which must allow resetting them one by one.
+	bool Create(VkDevice device, VkCommandPool commandPool, uint32_t framesInFlight, uint32_t passCount);
+	void Destroy();
+	// Every pass is recorded again on its next use.
+	void Invalidate();
+
+	// The frame slot's secondary for pass, recorded again by record when contentHash or the inheritance's render pass
+	// changed since it last was. Call once its previous submission finished, VK_NULL_HANDLE when recording failed.
+	VkCommandBuffer Acquire(uint32_t pass, uint32_t frameIndex, uint64_t contentHash, const VkCommandBufferInheritanceInfo& inheritance,
+		const std::function<void(VkCommandBuffer)>& record);
+
+	const CommandCacheStatistics& GetStatistics() const { return m_Statistics; }
+
+private:
+	typedef struct CachedCommands {
+		VkCommandBuffer  m_CommandBuffer;
+		uint64_t         m_Hash;
+		bool             m_Valid;
+	} CachedCommands;
+
+	VkDevice                           m_Device;
+	VkCommandPool                      m_CommandPool;
+	uint32_t                           m_FramesInFlight;
+	std::vector<CachedCommands>        m_Commands;           // Pass major, a slot per frame in flight
+	CommandCacheStatistics             m_Statistics;
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,481 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanDeferredPass.h"
+
+
+__BEGIN_NAMESPACE
+
+// Keep in sync with gbuffer_common.glsl
+static const VkFormat GBUFFER_ALBEDO_METALLIC_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+static const VkFormat GBUFFER_NORMAL_ROUGHNESS_FORMAT = VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+// Depth is read back as an input attachment, stencil formats would need a separate depth only view.
+static const VkFormat GBUFFER_DEPTH_FORMATS[] = {
+    VK_FORMAT_D32_SFLOAT,
+    VK_FORMAT_X8_D24_UNORM_PACK32,
+    VK_FORMAT_D16_UNORM,
+};
+
+enum DeferredAttachment
+{
+    DeferredAttachment_Output = 0,
+    DeferredAttachment_AlbedoMetallic,
+    DeferredAttachment_NormalRoughness,
+    DeferredAttachment_Depth,
+};
+
+enum DeferredSubpass
+{
+    DeferredSubpass_Geometry = 0,
+    DeferredSubpass_Lighting,
+};
+
+
+VulkanDeferredPass::VulkanDeferredPass() :
+	m_CreateInfo{},
+	m_DepthFormat(VK_FORMAT_UNDEFINED),
+	m_TransientMemoryProperties(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+	m_RenderPass(VK_NULL_HANDLE),
+	m_InputSetLayout(VK_NULL_HANDLE),
+	m_DescriptorPool(VK_NULL_HANDLE),
+	m_InputSet(VK_NULL_HANDLE),
+	m_LightingPipelineLayout(VK_NULL_HANDLE),
+	m_LightingPipeline(VK_NULL_HANDLE)
+{
+}
+
+VulkanDeferredPass::~VulkanDeferredPass()
+{
+}
+
+bool VulkanDeferredPass::Create(const VulkanDeferredPassCreateInfo& createInfo)
+{
+    m_CreateInfo = createInfo;
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+
+    m_DepthFormat = VK_FORMAT_UNDEFINED;
+    for (VkFormat format : GBUFFER_DEPTH_FORMATS) {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+        if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            m_DepthFormat = format;
+            break;
+        }
+    }
+    if (VK_FORMAT_UNDEFINED == m_DepthFormat) {
+        std::cout << "Vulkan has no depth format for the G-buffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    m_TransientMemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if (UINT32_MAX != FindMemoryType(physicalDevice, UINT32_MAX, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+        m_TransientMemoryProperties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    }
+
+    /****************************************************************************
+     * Create input attachment descriptors
+     ****************************************************************************/
+    VkDescriptorSetLayoutBinding bindings[3]{};
+    for (uint32_t i = 0; i < 3; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_InputSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create G-buffer descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    poolSize.descriptorCount = 3;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    if (vkCreateDescriptorPool(device, &poolInfo, GetVulkanAllocator(), &m_DescriptorPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create G-buffer descriptor pool.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_InputSetLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_InputSet) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate G-buffer descriptor set.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VULKAN_DRIVER_CHECK_FUN(CreateRenderPass());
+    VULKAN_DRIVER_CHECK_FUN(CreateLightingPipeline());
+
+    std::cout << "Vulkan deferred pass: G-buffer depth format " << m_DepthFormat << (IsLazilyAllocated() ? ", lazily allocated" : "") << ".\n";
+    return true;
+}
+
+bool VulkanDeferredPass::CreateRenderPass()
+{
+    VkAttachmentDescription attachments[ATTACHMENT_COUNT] = {};
+
+    // Every pixel is written by the lighting triangle, no need to clear the output.
+    VkAttachmentDescription& outputAttachment = attachments[DeferredAttachment_Output];
+    outputAttachment.format = m_CreateInfo.m_OutputFormat;
+    outputAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    outputAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    outputAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    outputAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    outputAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    outputAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    outputAttachment.finalLayout = m_CreateInfo.m_FinalLayout;
+
+    const VkFormat gbufferFormats[ATTACHMENT_COUNT] = { VK_FORMAT_UNDEFINED, GBUFFER_ALBEDO_METALLIC_FORMAT, GBUFFER_NORMAL_ROUGHNESS_FORMAT, m_DepthFormat };
+    for (uint32_t i = DeferredAttachment_AlbedoMetallic; i <= DeferredAttachment_Depth; i++) {
+        VkAttachmentDescription& attachment = attachments[i];
+        attachment.format = gbufferFormats[i];
+        attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachment.finalLayout = (DeferredAttachment_Depth == i) ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
+    VkAttachmentReference gbufferColorRefs[GBUFFER_COLOR_COUNT] = {
+        { DeferredAttachment_AlbedoMetallic, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+        { DeferredAttachment_NormalRoughness, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL },
+    };
+    VkAttachmentReference depthRef = { DeferredAttachment_Depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+    VkAttachmentReference inputRefs[3] = {
+        { DeferredAttachment_AlbedoMetallic, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+        { DeferredAttachment_NormalRoughness, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+        { DeferredAttachment_Depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL },
+    };
+    VkAttachmentReference outputRef = { DeferredAttachment_Output, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+
+    VkSubpassDescription subpasses[2] = {};
+    subpasses[DeferredSubpass_Geometry].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[DeferredSubpass_Geometry].colorAttachmentCount = GBUFFER_COLOR_COUNT;
+    subpasses[DeferredSubpass_Geometry].pColorAttachments = gbufferColorRefs;
+    subpasses[DeferredSubpass_Geometry].pDepthStencilAttachment = &depthRef;
+    subpasses[DeferredSubpass_Lighting].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpasses[DeferredSubpass_Lighting].inputAttachmentCount = 3;
+    subpasses[DeferredSubpass_Lighting].pInputAttachments = inputRefs;
+    subpasses[DeferredSubpass_Lighting].colorAttachmentCount = 1;
+    subpasses[DeferredSubpass_Lighting].pColorAttachments = &outputRef;
+
+    VkSubpassDependency dependencies[6] = {};
+    uint32_t dependencyCount = 0;
+
+    // The G-buffer is shared by all frames in flight, the previous frame's writes & reads of it must finish first.
+    VkSubpassDependency& gbufferDependency = dependencies[dependencyCount++];
+    gbufferDependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    gbufferDependency.dstSubpass = DeferredSubpass_Geometry;
+    gbufferDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    gbufferDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    gbufferDependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    gbufferDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    // Per pixel, so the lighting subpass reads the G-buffer straight from tile memory.
+    VkSubpassDependency& inputDependency = dependencies[dependencyCount++];
+    inputDependency.srcSubpass = DeferredSubpass_Geometry;
+    inputDependency.dstSubpass = DeferredSubpass_Lighting;
+    inputDependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    inputDependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    inputDependency.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    inputDependency.dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+    inputDependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+
+    // The caller's dependencies are about the output, which only the lighting subpass touches.
+    uint32_t externalCount = std::min(m_CreateInfo.m_DependencyCount, 4u);
+    for (uint32_t i = 0; i < externalCount; i++) {
+        VkSubpassDependency& dependency = dependencies[dependencyCount++];
+        dependency = m_CreateInfo.m_Dependencies[i];
+        if (VK_SUBPASS_EXTERNAL != dependency.srcSubpass) {
+            dependency.srcSubpass = DeferredSubpass_Lighting;
+        }
+        if (VK_SUBPASS_EXTERNAL != dependency.dstSubpass) {
+            dependency.dstSubpass = DeferredSubpass_Lighting;
+        }
+    }
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = ATTACHMENT_COUNT;
+    renderPassInfo.pAttachments = attachments;
+    renderPassInfo.subpassCount = 2;
+    renderPassInfo.pSubpasses = subpasses;
+    renderPassInfo.dependencyCount = dependencyCount;
+    renderPassInfo.pDependencies = dependencies;
+    if (vkCreateRenderPass(m_CreateInfo.m_Device, &renderPassInfo, GetVulkanAllocator(), &m_RenderPass) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create deferred render pass.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanDeferredPass::CreateLightingPipeline()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+
+    VkDescriptorSetLayout setLayouts[2] = { m_CreateInfo.m_LightingSetLayout, m_InputSetLayout };
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 2;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_LightingPipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create deferred lighting pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkShaderModule vertShaderModule = LoadShaderModule(device, "Data/Engine/fullscreen.vs.spv");
+    VkShaderModule fragShaderModule = LoadShaderModule(device, "Data/Engine/deferred_lighting.fs.spv");
+    if (VK_NULL_HANDLE == vertShaderModule || VK_NULL_HANDLE == fragShaderModule) {
+        if (VK_NULL_HANDLE != vertShaderModule) {
+            vkDestroyShaderModule(device, vertShaderModule, GetVulkanAllocator());
+        }
+        if (VK_NULL_HANDLE != fragShaderModule) {
+            vkDestroyShaderModule(device, fragShaderModule, GetVulkanAllocator());
+        }
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName = "main";
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.maxDepthBounds = 1.0f;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_LightingPipelineLayout;
+    pipelineInfo.renderPass = m_RenderPass;
+    pipelineInfo.subpass = DeferredSubpass_Lighting;
+
+    VkResult result = vkCreateGraphicsPipelines(device, m_CreateInfo.m_PipelineCache, 1, &pipelineInfo, GetVulkanAllocator(), &m_LightingPipeline);
+    vkDestroyShaderModule(device, fragShaderModule, GetVulkanAllocator());
+    vkDestroyShaderModule(device, vertShaderModule, GetVulkanAllocator());
+    if (VK_SUCCESS != result) {
+        std::cout << "Vulkan failed to create deferred lighting pipeline.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanDeferredPass::CreateImages(VkExtent2D extent)
+{
+    DestroyImages();
+
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+    const VkImageUsageFlags colorUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    const VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    if (!CreateImage2D(device, physicalDevice, extent, GBUFFER_ALBEDO_METALLIC_FORMAT, colorUsage, VK_IMAGE_ASPECT_COLOR_BIT,
+            m_TransientMemoryProperties, m_AlbedoMetallic) ||
+        !CreateImage2D(device, physicalDevice, extent, GBUFFER_NORMAL_ROUGHNESS_FORMAT, colorUsage, VK_IMAGE_ASPECT_COLOR_BIT,
+            m_TransientMemoryProperties, m_NormalRoughness) ||
+        !CreateImage2D(device, physicalDevice, extent, m_DepthFormat, depthUsage, VK_IMAGE_ASPECT_DEPTH_BIT,
+            m_TransientMemoryProperties, m_Depth)) {
+        DestroyImages();
+        return false;
+    }
+
+    VkDescriptorImageInfo imageInfos[3]{};
+    imageInfos[0] = { VK_NULL_HANDLE, m_AlbedoMetallic.m_View, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    imageInfos[1] = { VK_NULL_HANDLE, m_NormalRoughness.m_View, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+    imageInfos[2] = { VK_NULL_HANDLE, m_Depth.m_View, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+    VkWriteDescriptorSet writes[3]{};
+    for (uint32_t i = 0; i < 3; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_InputSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+        writes[i].pImageInfo = &imageInfos[i];
+    }
+    vkUpdateDescriptorSets(device, 3, writes, 0, nullptr);
+    return true;
+}
+
+void VulkanDeferredPass::DestroyImages()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE == device) {
+        return;
+    }
+    DestroyImage(device, m_AlbedoMetallic);
+    DestroyImage(device, m_NormalRoughness);
+    DestroyImage(device, m_Depth);
+}
+
+uint32_t VulkanDeferredPass::GetFramebufferAttachments(VkImageView outputView, VkImageView* views) const
+{
+    views[DeferredAttachment_Output] = outputView;
+    views[DeferredAttachment_AlbedoMetallic] = m_AlbedoMetallic.m_View;
+    views[DeferredAttachment_NormalRoughness] = m_NormalRoughness.m_View;
+    views[DeferredAttachment_Depth] = m_Depth.m_View;
+    return ATTACHMENT_COUNT;
+}
+
+uint32_t VulkanDeferredPass::GetClearValues(VkClearValue* clearValues) const
+{
+    // The output isn't cleared, the entry only keeps indices matching attachments.
+    clearValues[DeferredAttachment_Output].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+    clearValues[DeferredAttachment_AlbedoMetallic].color = { { 0.0f, 0.0f, 0.0f, 0.0f } };
+    clearValues[DeferredAttachment_NormalRoughness].color = { { 0.5f, 0.5f, 1.0f, 0.0f } };
+    clearValues[DeferredAttachment_Depth].depthStencil = { 1.0f, 0 };
+    return ATTACHMENT_COUNT;
+}
+
+void VulkanDeferredPass::GetGeometryPipelineState(VkPipelineMultisampleStateCreateInfo& multisampling, VkPipelineDepthStencilStateCreateInfo& depthStencil,
+    VkPipelineColorBlendAttachmentState* colorBlendAttachments) const
+{
+    multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampling.minSampleShading = 1.0f;
+
+    depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    depthStencil.minDepthBounds = 0.0f;
+    depthStencil.maxDepthBounds = 1.0f;
+
+    for (uint32_t i = 0; i < GBUFFER_COLOR_COUNT; i++) {
+        colorBlendAttachments[i] = {};
+        colorBlendAttachments[i].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachments[i].blendEnable = VK_FALSE;
+    }
+}
+
+void VulkanDeferredPass::RecordLighting(VkCommandBuffer commandBuffer, VkDescriptorSet lightingSet)
+{
+    vkCmdNextSubpass(commandBuffer, VK_SUBPASS_CONTENTS_INLINE);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_LightingPipeline);
+    VkDescriptorSet descriptorSets[2] = { lightingSet, m_InputSet };
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_LightingPipelineLayout, 0, 2, descriptorSets, 0, nullptr);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+void VulkanDeferredPass::GetBandwidth(VkExtent2D extent, AttachmentBandwidth& bandwidth) const
+{
+    // The G-buffer is written by the geometry subpass then read by the lighting one, only the output is stored.
+    VkDeviceSize pixels = (VkDeviceSize)extent.width * extent.height;
+    VkDeviceSize gbufferSize = GetFormatSize(GBUFFER_ALBEDO_METALLIC_FORMAT) + GetFormatSize(GBUFFER_NORMAL_ROUGHNESS_FORMAT) + GetFormatSize(m_DepthFormat);
+    bandwidth.m_MemoryBytes = pixels * GetFormatSize(m_CreateInfo.m_OutputFormat);
+    bandwidth.m_OnChipBytes = pixels * gbufferSize * 2;
+}
+
+void VulkanDeferredPass::Destroy()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE == device) {
+        return;
+    }
+
+    DestroyImages();
+    if (VK_NULL_HANDLE != m_LightingPipeline) {
+        vkDestroyPipeline(device, m_LightingPipeline, GetVulkanAllocator());
+        m_LightingPipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_LightingPipelineLayout) {
+        vkDestroyPipelineLayout(device, m_LightingPipelineLayout, GetVulkanAllocator());
+        m_LightingPipelineLayout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_RenderPass) {
+        vkDestroyRenderPass(device, m_RenderPass, GetVulkanAllocator());
+        m_RenderPass = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorPool) {
+        vkDestroyDescriptorPool(device, m_DescriptorPool, GetVulkanAllocator());
+        m_DescriptorPool = VK_NULL_HANDLE;
+        m_InputSet = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_InputSetLayout) {
+        vkDestroyDescriptorSetLayout(device, m_InputSetLayout, GetVulkanAllocator());
+        m_InputSetLayout = VK_NULL_HANDLE;
+    }
+    m_CreateInfo.m_Device = VK_NULL_HANDLE;
+}
+
+__END_NAMESPACE
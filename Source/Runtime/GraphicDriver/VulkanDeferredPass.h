@@ -0,0 +1,82 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+typedef struct VulkanDeferredPassCreateInfo {
+	VkDevice                    m_Device;
+	VkPhysicalDevice            m_PhysicalDevice;
+	VkPipelineCache             m_PipelineCache;
+	VkFormat                    m_OutputFormat;
+	VkImageLayout               m_FinalLayout;           // Of the output once the pass ends
+	const VkSubpassDependency*  m_Dependencies;          // External ones of the output, as for a single subpass pass
+	uint32_t                    m_DependencyCount;
+	VkDescriptorSetLayout       m_LightingSetLayout;     // Set 0 of the lighting subpass, see VulkanClusteredLighting
+} VulkanDeferredPassCreateInfo;
+
+
+/**
+ * Deferred shading in one render pass of two subpasses:
+ *
+ *   0: geometry, fills a packed G-buffer, albedo & metallic in RGBA8, octahedral normal & roughness in RGB10A2, plus depth
+ *   1: lighting, reads the G-buffer back as input attachments & shades every pixel with a fullscreen triangle
+ *
+ * The G-buffer only lives for the pass, TRANSIENT_ATTACHMENT images on lazily allocated memory where the device
+ * has it, with DONT_CARE store ops and a BY_REGION dependency between the subpasses, so tilers keep it in tile
+ * memory and only the lit output reaches memory. Lights are binned per froxel in compute by VulkanClusteredLighting.
+ *
+ * Attachments: 0 output, 1 & 2 G-buffer colors, 3 depth.
+ */
+class VulkanDeferredPass
+{
+public:
+	VulkanDeferredPass();
+	virtual ~VulkanDeferredPass();
+
+	bool Create(const VulkanDeferredPassCreateInfo& createInfo);
+	// G-buffer images, large enough for every framebuffer they're used in.
+	bool CreateImages(VkExtent2D extent);
+	void DestroyImages();
+	void Destroy();
+
+	VkRenderPass GetRenderPass() const { return m_RenderPass; }
+	// Framebuffer views in attachment order, returns the count.
+	uint32_t GetFramebufferAttachments(VkImageView outputView, VkImageView* views) const;
+	// Clear values in attachment order, returns the count.
+	uint32_t GetClearValues(VkClearValue* clearValues) const;
+	// Multisample, depth & blend state for pipelines drawn in the geometry subpass, colorBlendAttachments holds GBUFFER_COLOR_COUNT.
+	void GetGeometryPipelineState(VkPipelineMultisampleStateCreateInfo& multisampling, VkPipelineDepthStencilStateCreateInfo& depthStencil,
+		VkPipelineColorBlendAttachmentState* colorBlendAttachments) const;
+	// Record after the geometry draws: moves to the lighting subpass & resolves the G-buffer, the render pass is left for the caller to end.
+	// Viewport & scissor stay as set for the geometry.
+	void RecordLighting(VkCommandBuffer commandBuffer, VkDescriptorSet lightingSet);
+
+	// Attachment traffic of one pass over extent.
+	void GetBandwidth(VkExtent2D extent, AttachmentBandwidth& bandwidth) const;
+	bool IsLazilyAllocated() const { return 0 != (m_TransientMemoryProperties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT); }
+
+	static const uint32_t GBUFFER_COLOR_COUNT = 2;
+	static const uint32_t ATTACHMENT_COUNT = 4;
+
+private:
+	VulkanDeferredPassCreateInfo  m_CreateInfo;
+	VkFormat                      m_DepthFormat;
+	VkMemoryPropertyFlags         m_TransientMemoryProperties;
+	VulkanImage                   m_AlbedoMetallic;
+	VulkanImage                   m_NormalRoughness;
+	VulkanImage                   m_Depth;
+
+	VkRenderPass                  m_RenderPass;
+	VkDescriptorSetLayout         m_InputSetLayout;
+	VkDescriptorPool              m_DescriptorPool;
+	VkDescriptorSet               m_InputSet;
+	VkPipelineLayout              m_LightingPipelineLayout;
+	VkPipeline                    m_LightingPipeline;
+
+	bool CreateRenderPass();
+	bool CreateLightingPipeline();
+};
+
+
+__END_NAMESPACE
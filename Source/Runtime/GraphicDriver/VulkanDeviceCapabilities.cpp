@@ -0,0 +1,406 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanDeviceCapabilities.h"
+
+
+__BEGIN_NAMESPACE
+
+
+// Device type dominates the score, a discrete GPU without any fast path still beats an integrated one with all of them.
+static const int DEVICE_TYPE_SCORE = 100000;
+static const VkDeviceSize DEVICE_LOCAL_SCORE_UNIT = 256 * 1024 * 1024;
+static const int DEVICE_LOCAL_SCORE_MAX = 1000;
+
+
+// Appends structures to a pNext chain in order.
+class FeatureChainLinker
+{
+public:
+    explicit FeatureChainLinker(void** head) : m_Next(head) {}
+
+    template <typename T>
+    void Link(T& structure)
+    {
+        structure.pNext = nullptr;
+        *m_Next = &structure;
+        m_Next = &structure.pNext;
+    }
+
+private:
+    void** m_Next;
+};
+
+static bool IsApiVersionAtLeast(uint32_t apiVersion, uint32_t major, uint32_t minor)
+{
+    return VK_MAKE_VERSION(VK_VERSION_MAJOR(apiVersion), VK_VERSION_MINOR(apiVersion), 0) >= VK_MAKE_VERSION(major, minor, 0);
+}
+
+static const char* GetDeviceTypeName(VkPhysicalDeviceType type)
+{
+    switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return "discrete";
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return "integrated";
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return "virtual";
+    case VK_PHYSICAL_DEVICE_TYPE_CPU: return "cpu";
+    default: return "other";
+    }
+}
+
+static int GetDeviceTypeRank(VkPhysicalDeviceType type)
+{
+    switch (type) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU: return 4;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 3;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU: return 2;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU: return 1;
+    default: return 0;
+    }
+}
+
+
+uint32_t GetInstanceApiVersion()
+{
+    uint32_t loaderVersion = VK_API_VERSION_1_1;
+    if (VK_SUCCESS != vkEnumerateInstanceVersion(&loaderVersion)) {
+        loaderVersion = VK_API_VERSION_1_1;
+    }
+
+#if defined(VK_API_VERSION_1_3)
+    uint32_t headerVersion = VK_API_VERSION_1_3;
+#elif defined(VK_API_VERSION_1_2)
+    uint32_t headerVersion = VK_API_VERSION_1_2;
+#else
+    uint32_t headerVersion = VK_API_VERSION_1_1;
+#endif
+    uint32_t loaderMinor = VK_MAKE_VERSION(VK_VERSION_MAJOR(loaderVersion), VK_VERSION_MINOR(loaderVersion), 0);
+    return std::max((uint32_t)VK_API_VERSION_1_1, std::min(loaderMinor, headerVersion));
+}
+
+bool QueryDeviceCapabilities(VkPhysicalDevice physicalDevice, uint32_t instanceApiVersion, VulkanDeviceCapabilities& capabilities)
+{
+    capabilities = VulkanDeviceCapabilities();
+    capabilities.m_PhysicalDevice = physicalDevice;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    capabilities.m_DeviceName = properties.deviceName;
+    capabilities.m_DeviceType = properties.deviceType;
+    capabilities.m_ApiVersion = IsApiVersionAtLeast(properties.apiVersion, VK_VERSION_MAJOR(instanceApiVersion), VK_VERSION_MINOR(instanceApiVersion))
+        ? instanceApiVersion : properties.apiVersion;
+    capabilities.m_MaxImageDimension2D = properties.limits.maxImageDimension2D;
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+        if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            capabilities.m_DeviceLocalBytes += memoryProperties.memoryHeaps[i].size;
+        }
+    }
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    for (const VkQueueFamilyProperties& queueFamily : queueFamilies) {
+        capabilities.m_GraphicsQueue |= (0 != (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT));
+    }
+
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    capabilities.m_Extensions.resize(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, capabilities.m_Extensions.data());
+    const std::vector<VkExtensionProperties>& extensions = capabilities.m_Extensions;
+
+    capabilities.m_Swapchain = HasDeviceExtension(extensions, VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    capabilities.m_DrawIndirectCount = HasDeviceExtension(extensions, VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+
+    /****************************************************************************
+     * One vkGetPhysicalDeviceFeatures2 over every structure the device knows of
+     ****************************************************************************/
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    FeatureChainLinker linker(&features2.pNext);
+
+    bool core12 = IsApiVersionAtLeast(capabilities.m_ApiVersion, 1, 2);
+    bool core13 = IsApiVersionAtLeast(capabilities.m_ApiVersion, 1, 3);
+    (void)core13;
+
+#if defined(VK_VERSION_1_2)
+    VkPhysicalDeviceVulkan12Features vulkan12{};
+    vulkan12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    if (core12) {
+        linker.Link(vulkan12);
+    }
+#endif
+#if defined(VK_VERSION_1_3)
+    VkPhysicalDeviceVulkan13Features vulkan13{};
+    vulkan13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    if (core13) {
+        linker.Link(vulkan13);
+    }
+#endif
+#if defined(VK_KHR_timeline_semaphore)
+    VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timelineSemaphore{};
+    timelineSemaphore.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    if (!core12 && HasDeviceExtension(extensions, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+        linker.Link(timelineSemaphore);
+    }
+#endif
+#if defined(VK_EXT_descriptor_indexing)
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptorIndexing{};
+    descriptorIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    if (!core12 && HasDeviceExtension(extensions, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        linker.Link(descriptorIndexing);
+    }
+#endif
+#if defined(VK_KHR_dynamic_rendering)
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRendering{};
+    dynamicRendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    if (!core13 && HasDeviceExtension(extensions, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+        linker.Link(dynamicRendering);
+    }
+#endif
+#if defined(VK_KHR_synchronization2)
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2{};
+    synchronization2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    if (!core13 && HasDeviceExtension(extensions, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME)) {
+        linker.Link(synchronization2);
+    }
+#endif
+#if defined(VK_EXT_mesh_shader)
+    // Mesh shaders need SPIR-V 1.4, which is an extension below Vulkan 1.2.
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShader{};
+    meshShader.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    if (HasDeviceExtension(extensions, VK_EXT_MESH_SHADER_EXTENSION_NAME) &&
+        (core12 || (HasDeviceExtension(extensions, VK_KHR_SPIRV_1_4_EXTENSION_NAME) &&
+                    HasDeviceExtension(extensions, VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME)))) {
+        linker.Link(meshShader);
+    }
+#endif
+#if defined(VK_KHR_present_id) && defined(VK_KHR_present_wait)
+    VkPhysicalDevicePresentIdFeaturesKHR presentId{};
+    presentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWait{};
+    presentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    if (HasDeviceExtension(extensions, VK_KHR_PRESENT_ID_EXTENSION_NAME) && HasDeviceExtension(extensions, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        linker.Link(presentId);
+        linker.Link(presentWait);
+    }
+#endif
+
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+    capabilities.m_Features = features2.features;
+
+#if defined(VK_VERSION_1_2)
+    if (core12) {
+        capabilities.m_TimelineSemaphore = (VK_TRUE == vulkan12.timelineSemaphore);
+        capabilities.m_DescriptorIndexing = vulkan12.descriptorIndexing && vulkan12.runtimeDescriptorArray && vulkan12.descriptorBindingPartiallyBound &&
+            vulkan12.shaderSampledImageArrayNonUniformIndexing && vulkan12.descriptorBindingSampledImageUpdateAfterBind;
+    }
+#endif
+#if defined(VK_VERSION_1_3)
+    if (core13) {
+        capabilities.m_DynamicRendering = (VK_TRUE == vulkan13.dynamicRendering);
+        capabilities.m_Synchronization2 = (VK_TRUE == vulkan13.synchronization2);
+    }
+#endif
+#if defined(VK_KHR_timeline_semaphore)
+    if (!core12) {
+        capabilities.m_TimelineSemaphore = (VK_TRUE == timelineSemaphore.timelineSemaphore);
+    }
+#endif
+#if defined(VK_EXT_descriptor_indexing)
+    if (!core12) {
+        capabilities.m_DescriptorIndexing = descriptorIndexing.runtimeDescriptorArray && descriptorIndexing.descriptorBindingPartiallyBound &&
+            descriptorIndexing.shaderSampledImageArrayNonUniformIndexing && descriptorIndexing.descriptorBindingSampledImageUpdateAfterBind;
+    }
+#endif
+#if defined(VK_KHR_dynamic_rendering)
+    if (!core13) {
+        capabilities.m_DynamicRendering = (VK_TRUE == dynamicRendering.dynamicRendering);
+    }
+#endif
+#if defined(VK_KHR_synchronization2)
+    if (!core13) {
+        capabilities.m_Synchronization2 = (VK_TRUE == synchronization2.synchronization2);
+    }
+#endif
+#if defined(VK_EXT_mesh_shader)
+    capabilities.m_MeshShader = meshShader.taskShader && meshShader.meshShader;
+#endif
+#if defined(VK_KHR_present_id) && defined(VK_KHR_present_wait)
+    capabilities.m_PresentWait = presentId.presentId && presentWait.presentWait;
+#endif
+    return true;
+}
+
+int RateDeviceCapabilities(const VulkanDeviceCapabilities& capabilities)
+{
+    if (!capabilities.m_GraphicsQueue) {
+        return 0;
+    }
+
+    int score = 1 + GetDeviceTypeRank(capabilities.m_DeviceType) * DEVICE_TYPE_SCORE;
+    score += (int)std::min<VkDeviceSize>(capabilities.m_DeviceLocalBytes / DEVICE_LOCAL_SCORE_UNIT, DEVICE_LOCAL_SCORE_MAX);
+
+    // Among devices of a kind, the one with more fast paths runs the same frame with less work.
+    score += capabilities.m_MeshShader ? 4000 : 0;
+    score += capabilities.m_DrawIndirectCount ? 2000 : 0;
+    score += capabilities.m_Features.multiDrawIndirect ? 2000 : 0;
+    score += capabilities.m_DescriptorIndexing ? 2000 : 0;
+    score += capabilities.m_DynamicRendering ? 1000 : 0;
+    score += capabilities.m_Synchronization2 ? 1000 : 0;
+    score += capabilities.m_TimelineSemaphore ? 1000 : 0;
+    return score;
+}
+
+void ChooseRenderPath(const VulkanDeviceCapabilities& capabilities, bool presentation, VulkanRenderPath& path)
+{
+    path = VulkanRenderPath();
+    // On a software rasterizer task/mesh shading is emulated and loses to the compute cull.
+    path.m_MeshShaders = capabilities.m_MeshShader && VK_PHYSICAL_DEVICE_TYPE_CPU != capabilities.m_DeviceType;
+    path.m_MultiDrawIndirect = (VK_TRUE == capabilities.m_Features.multiDrawIndirect);
+    path.m_DrawIndirectFirstInstance = (VK_TRUE == capabilities.m_Features.drawIndirectFirstInstance);
+    path.m_DrawIndirectCount = capabilities.m_DrawIndirectCount;
+    path.m_DynamicRendering = capabilities.m_DynamicRendering;
+    path.m_Synchronization2 = capabilities.m_Synchronization2;
+    path.m_TimelineSemaphores = capabilities.m_TimelineSemaphore;
+    path.m_BindlessDescriptors = capabilities.m_DescriptorIndexing;
+    path.m_PresentWait = presentation && capabilities.m_PresentWait;
+}
+
+void BuildDeviceFeatureChain(const VulkanDeviceCapabilities& capabilities, const VulkanRenderPath& path, VulkanDeviceFeatureChain& chain)
+{
+    bool core12 = IsApiVersionAtLeast(capabilities.m_ApiVersion, 1, 2);
+    bool core13 = IsApiVersionAtLeast(capabilities.m_ApiVersion, 1, 3);
+    (void)core13;
+
+    chain.m_Extensions.clear();
+    chain.m_Features2 = {};
+    chain.m_Features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    chain.m_Features2.features.multiDrawIndirect = path.m_MultiDrawIndirect ? VK_TRUE : VK_FALSE;
+    chain.m_Features2.features.drawIndirectFirstInstance = path.m_DrawIndirectFirstInstance ? VK_TRUE : VK_FALSE;
+    FeatureChainLinker linker(&chain.m_Features2.pNext);
+
+    if (path.m_DrawIndirectCount) {
+        chain.m_Extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+    }
+
+#if defined(VK_VERSION_1_2)
+    chain.m_Vulkan12 = {};
+    chain.m_Vulkan12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    if (core12) {
+        chain.m_Vulkan12.timelineSemaphore = path.m_TimelineSemaphores ? VK_TRUE : VK_FALSE;
+        if (path.m_BindlessDescriptors) {
+            chain.m_Vulkan12.descriptorIndexing = VK_TRUE;
+            chain.m_Vulkan12.runtimeDescriptorArray = VK_TRUE;
+            chain.m_Vulkan12.descriptorBindingPartiallyBound = VK_TRUE;
+            chain.m_Vulkan12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            chain.m_Vulkan12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        }
+        linker.Link(chain.m_Vulkan12);
+    }
+#endif
+#if defined(VK_VERSION_1_3)
+    chain.m_Vulkan13 = {};
+    chain.m_Vulkan13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    if (core13) {
+        chain.m_Vulkan13.dynamicRendering = path.m_DynamicRendering ? VK_TRUE : VK_FALSE;
+        chain.m_Vulkan13.synchronization2 = path.m_Synchronization2 ? VK_TRUE : VK_FALSE;
+        linker.Link(chain.m_Vulkan13);
+    }
+#endif
+#if defined(VK_KHR_timeline_semaphore)
+    chain.m_TimelineSemaphore = {};
+    chain.m_TimelineSemaphore.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+    if (!core12 && path.m_TimelineSemaphores) {
+        chain.m_TimelineSemaphore.timelineSemaphore = VK_TRUE;
+        linker.Link(chain.m_TimelineSemaphore);
+        chain.m_Extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+    }
+#endif
+#if defined(VK_EXT_descriptor_indexing)
+    chain.m_DescriptorIndexing = {};
+    chain.m_DescriptorIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    if (!core12 && path.m_BindlessDescriptors) {
+        chain.m_DescriptorIndexing.runtimeDescriptorArray = VK_TRUE;
+        chain.m_DescriptorIndexing.descriptorBindingPartiallyBound = VK_TRUE;
+        chain.m_DescriptorIndexing.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        chain.m_DescriptorIndexing.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        linker.Link(chain.m_DescriptorIndexing);
+        // Its dependency VK_KHR_maintenance3 is core in 1.1.
+        chain.m_Extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    }
+#endif
+#if defined(VK_KHR_dynamic_rendering)
+    chain.m_DynamicRendering = {};
+    chain.m_DynamicRendering.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    if (!core13 && path.m_DynamicRendering) {
+        chain.m_DynamicRendering.dynamicRendering = VK_TRUE;
+        linker.Link(chain.m_DynamicRendering);
+        chain.m_Extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        // Required by dynamic rendering below 1.2.
+        if (!core12) {
+            chain.m_Extensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+            chain.m_Extensions.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+        }
+    }
+#endif
+#if defined(VK_KHR_synchronization2)
+    chain.m_Synchronization2 = {};
+    chain.m_Synchronization2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    if (!core13 && path.m_Synchronization2) {
+        chain.m_Synchronization2.synchronization2 = VK_TRUE;
+        linker.Link(chain.m_Synchronization2);
+        chain.m_Extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+    }
+#endif
+#if defined(VK_EXT_mesh_shader)
+    chain.m_MeshShader = {};
+    chain.m_MeshShader.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    if (path.m_MeshShaders) {
+        // Only the task & mesh stages are needed, the rest would require extra features.
+        chain.m_MeshShader.taskShader = VK_TRUE;
+        chain.m_MeshShader.meshShader = VK_TRUE;
+        linker.Link(chain.m_MeshShader);
+        chain.m_Extensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+        if (!core12) {
+            chain.m_Extensions.push_back(VK_KHR_SPIRV_1_4_EXTENSION_NAME);
+            chain.m_Extensions.push_back(VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME);
+        }
+    }
+#endif
+#if defined(VK_KHR_present_id) && defined(VK_KHR_present_wait)
+    chain.m_PresentId = {};
+    chain.m_PresentId.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    chain.m_PresentWait = {};
+    chain.m_PresentWait.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    if (path.m_PresentWait) {
+        chain.m_PresentId.presentId = VK_TRUE;
+        chain.m_PresentWait.presentWait = VK_TRUE;
+        linker.Link(chain.m_PresentId);
+        linker.Link(chain.m_PresentWait);
+        chain.m_Extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        chain.m_Extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+    }
+#endif
+}
+
+std::string DescribeRenderPath(const VulkanDeviceCapabilities& capabilities, const VulkanRenderPath& path)
+{
+    std::string description = capabilities.m_DeviceName + " (" + GetDeviceTypeName(capabilities.m_DeviceType) + ", Vulkan " +
+        std::to_string(VK_VERSION_MAJOR(capabilities.m_ApiVersion)) + "." + std::to_string(VK_VERSION_MINOR(capabilities.m_ApiVersion)) + "." +
+        std::to_string(VK_VERSION_PATCH(capabilities.m_ApiVersion)) + "): ";
+
+    description += path.m_MeshShaders ? "task/mesh shader meshlets" : "compute cull + indirect draw meshlets";
+    description += path.m_DrawIndirectCount ? ", draw indirect count" : "";
+    description += path.m_MultiDrawIndirect ? ", multi draw indirect" : ", single draw indirect";
+    description += path.m_DynamicRendering ? ", dynamic rendering" : ", render pass objects";
+    description += path.m_Synchronization2 ? ", synchronization2 barriers" : ", legacy barriers";
+    description += path.m_TimelineSemaphores ? ", timeline semaphores" : ", binary semaphores & fences";
+    description += path.m_BindlessDescriptors ? ", bindless descriptors" : ", bound descriptor sets";
+    description += path.m_PresentWait ? ", present wait" : "";
+    return description;
+}
+
+__END_NAMESPACE
@@ -0,0 +1,93 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+// What a physical device can do, within what both the instance & the headers the engine was built with know of.
+typedef struct VulkanDeviceCapabilities {
+	VkPhysicalDevice            m_PhysicalDevice = VK_NULL_HANDLE;
+	std::string                 m_DeviceName;
+	VkPhysicalDeviceType        m_DeviceType = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+	uint32_t                    m_ApiVersion = 0;                 // Lowest of the device's & the instance's
+	VkDeviceSize                m_DeviceLocalBytes = 0;
+	uint32_t                    m_MaxImageDimension2D = 0;
+	bool                        m_GraphicsQueue = false;
+	std::vector<VkExtensionProperties> m_Extensions;
+	VkPhysicalDeviceFeatures    m_Features = {};
+
+	bool                        m_Swapchain = false;
+	bool                        m_DrawIndirectCount = false;      // VK_KHR_draw_indirect_count, the culler loads the KHR entry point
+	bool                        m_TimelineSemaphore = false;      // Core in 1.2
+	bool                        m_DescriptorIndexing = false;     // Non uniform, partially bound, update after bind sampled image arrays, core in 1.2
+	bool                        m_DynamicRendering = false;       // Core in 1.3
+	bool                        m_Synchronization2 = false;       // Core in 1.3
+	bool                        m_MeshShader = false;             // VK_EXT_mesh_shader task & mesh stages
+	bool                        m_PresentWait = false;            // VK_KHR_present_id & VK_KHR_present_wait
+} VulkanDeviceCapabilities;
+
+// The fastest way to render on a device, picked from its capabilities.
+typedef struct VulkanRenderPath {
+	bool   m_MeshShaders = false;                 // Task/mesh meshlets, else compute cull + indirect draws
+	bool   m_MultiDrawIndirect = false;
+	bool   m_DrawIndirectFirstInstance = false;
+	bool   m_DrawIndirectCount = false;           // GPU compacted draw lists
+	bool   m_DynamicRendering = false;            // vkCmdBeginRendering, else render pass & framebuffer objects
+	bool   m_Synchronization2 = false;            // vkCmdPipelineBarrier2
+	bool   m_TimelineSemaphores = false;          // One counter per queue instead of per frame fences
+	bool   m_BindlessDescriptors = false;         // One partially bound descriptor array for every texture
+	bool   m_PresentWait = false;
+} VulkanRenderPath;
+
+/**
+ * Feature structures & extensions to enable a render path with, pass GetCreateNext() as VkDeviceCreateInfo::pNext
+ * with pEnabledFeatures left null. Features promoted to the device's API version go through the core structures,
+ * the rest through their extension's. Links point inside the object, so it must not be copied once built.
+ */
+typedef struct VulkanDeviceFeatureChain {
+	VkPhysicalDeviceFeatures2                         m_Features2;
+#if defined(VK_VERSION_1_2)
+	VkPhysicalDeviceVulkan12Features                  m_Vulkan12;
+#endif
+#if defined(VK_VERSION_1_3)
+	VkPhysicalDeviceVulkan13Features                  m_Vulkan13;
+#endif
+#if defined(VK_KHR_timeline_semaphore)
+	VkPhysicalDeviceTimelineSemaphoreFeaturesKHR      m_TimelineSemaphore;
+#endif
+#if defined(VK_EXT_descriptor_indexing)
+	VkPhysicalDeviceDescriptorIndexingFeaturesEXT     m_DescriptorIndexing;
+#endif
+#if defined(VK_KHR_dynamic_rendering)
+	VkPhysicalDeviceDynamicRenderingFeaturesKHR       m_DynamicRendering;
+#endif
+#if defined(VK_KHR_synchronization2)
+	VkPhysicalDeviceSynchronization2FeaturesKHR       m_Synchronization2;
+#endif
+#if defined(VK_EXT_mesh_shader)
+	VkPhysicalDeviceMeshShaderFeaturesEXT             m_MeshShader;
+#endif
+#if defined(VK_KHR_present_id) && defined(VK_KHR_present_wait)
+	VkPhysicalDevicePresentIdFeaturesKHR              m_PresentId;
+	VkPhysicalDevicePresentWaitFeaturesKHR            m_PresentWait;
+#endif
+	std::vector<const char*>                          m_Extensions;
+
+	const void* GetCreateNext() const { return &m_Features2; }
+} VulkanDeviceFeatureChain;
+
+
+// Highest API version both the loader & the headers support, to request in VkApplicationInfo.
+uint32_t GetInstanceApiVersion();
+
+bool QueryDeviceCapabilities(VkPhysicalDevice physicalDevice, uint32_t instanceApiVersion, VulkanDeviceCapabilities& capabilities);
+// 0 when the device can't render, then device type first and the fast paths it has.
+int RateDeviceCapabilities(const VulkanDeviceCapabilities& capabilities);
+// presentation: the device drives a swapchain.
+void ChooseRenderPath(const VulkanDeviceCapabilities& capabilities, bool presentation, VulkanRenderPath& path);
+void BuildDeviceFeatureChain(const VulkanDeviceCapabilities& capabilities, const VulkanRenderPath& path, VulkanDeviceFeatureChain& chain);
+// e.g. "NVIDIA GeForce RTX 3080 (discrete, Vulkan 1.3.224): mesh shaders, dynamic rendering, ..."
+std::string DescribeRenderPath(const VulkanDeviceCapabilities& capabilities, const VulkanRenderPath& path);
+
+
+__END_NAMESPACE
@@ -0,0 +1,407 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanCommandCache.h"
+#include "VulkanFrameRing.h"
+#include "VulkanDrawBatcher.h"
+
+
+__BEGIN_NAMESPACE
+
+static const uint64_t DRAW_SORT_DEPTH_BITS = 20;
+static const uint64_t DRAW_SORT_DEPTH_MASK = (1ull << DRAW_SORT_DEPTH_BITS) - 1;
+
+uint64_t MakeDrawSortKey(uint32_t pipelineID, uint32_t materialID, uint32_t meshID, float depth01)
+{
+    float depth = std::min(std::max(depth01, 0.0f), 1.0f);
+    uint64_t quantizedDepth = (uint64_t)(depth * (float)DRAW_SORT_DEPTH_MASK);
+    return ((uint64_t)(pipelineID & 0xFF) << 56) |
+        ((uint64_t)(materialID & 0xFFFF) << 40) |
+        ((uint64_t)(meshID & 0xFFFFF) << 20) |
+        quantizedDepth;
+}
+
+
+VulkanDrawBatcher::VulkanDrawBatcher() :
+    m_Device(VK_NULL_HANDLE),
+    m_FrameRing(nullptr),
+    m_MaxInstances(0),
+    m_InstanceCount(0),
+    m_InstanceSetLayout(VK_NULL_HANDLE),
+    m_DescriptorPool(VK_NULL_HANDLE),
+    m_InstanceSet(VK_NULL_HANDLE),
+    m_InstanceRingGeneration(0),
+    m_InstanceRingOffset(0),
+    m_LayoutDirty(false),
+    m_Registrations(0),
+    m_DrawListHash(COMMAND_HASH_SEED),
+    m_Statistics{}
+{
+}
+
+VulkanDrawBatcher::~VulkanDrawBatcher()
+{
+}
+
+bool VulkanDrawBatcher::Create(VkDevice device, VulkanFrameRing* frameRing, uint32_t maxInstances)
+{
+    if (nullptr == frameRing || 0 == maxInstances) {
+        std::cout << "Invalid frame ring or capacity for draw batcher.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    m_Device = device;
+    m_FrameRing = frameRing;
+    m_MaxInstances = maxInstances;
+    m_Instances.resize(maxInstances);
+
+    // The instances move through the ring every frame, the offset is given when the set is bound.
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_InstanceSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create draw batch descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    poolSize.descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    if (vkCreateDescriptorPool(device, &poolInfo, GetVulkanAllocator(), &m_DescriptorPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create draw batch descriptor pool.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_InstanceSetLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_InstanceSet) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate draw batch descriptor set.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+void VulkanDrawBatcher::Destroy()
+{
+    if (VK_NULL_HANDLE == m_Device) {
+        return;
+    }
+
+    if (VK_NULL_HANDLE != m_DescriptorPool) {
+        vkDestroyDescriptorPool(m_Device, m_DescriptorPool, GetVulkanAllocator());
+        m_DescriptorPool = VK_NULL_HANDLE;
+    }
+    m_InstanceSet = VK_NULL_HANDLE;
+    m_InstanceRingGeneration = 0;
+
+    if (VK_NULL_HANDLE != m_InstanceSetLayout) {
+        vkDestroyDescriptorSetLayout(m_Device, m_InstanceSetLayout, GetVulkanAllocator());
+        m_InstanceSetLayout = VK_NULL_HANDLE;
+    }
+
+    m_Pipelines.clear();
+    m_Materials.clear();
+    m_Meshes.clear();
+    m_Objects.clear();
+    m_FreeObjects.clear();
+    m_Batches.clear();
+    m_BatchLookup.clear();
+    m_SortedBatches.clear();
+    m_Instances.clear();
+    m_InstanceCount = 0;
+    m_FrameRing = nullptr;
+    m_Device = VK_NULL_HANDLE;
+}
+
+void VulkanDrawBatcher::RegisterPipeline(uint32_t pipelineID, VkPipeline pipeline, VkPipelineLayout layout)
+{
+    if (pipelineID >= m_Pipelines.size()) {
+        m_Pipelines.resize(pipelineID + 1, DrawPipeline{ VK_NULL_HANDLE, VK_NULL_HANDLE });
+    }
+    m_Pipelines[pipelineID].m_Pipeline = pipeline;
+    m_Pipelines[pipelineID].m_Layout = layout;
+    m_Registrations++;
+}
+
+void VulkanDrawBatcher::RegisterMaterial(uint32_t materialID, VkDescriptorSet descriptorSet)
+{
+    if (materialID >= m_Materials.size()) {
+        m_Materials.resize(materialID + 1, VK_NULL_HANDLE);
+    }
+    m_Materials[materialID] = descriptorSet;
+    m_Registrations++;
+}
+
+void VulkanDrawBatcher::RegisterMesh(uint32_t meshID, const DrawMesh& mesh)
+{
+    if (meshID >= m_Meshes.size()) {
+        m_Meshes.resize(meshID + 1, DrawMesh{ VK_NULL_HANDLE, VK_NULL_HANDLE, VK_INDEX_TYPE_UINT32, 0, 0, 0 });
+    }
+    m_Meshes[meshID] = mesh;
+    m_Registrations++;
+}
+
+uint32_t VulkanDrawBatcher::AddObject(const DrawObjectDesc& desc)
+{
+    uint32_t liveObjects = (uint32_t)(m_Objects.size() - m_FreeObjects.size());
+    if (liveObjects >= m_MaxInstances) {
+        std::cout << "Draw batcher instance capacity exceeded.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return DRAW_BATCH_INVALID_ID;
+    }
+
+    uint64_t stateKey = DrawSortKeyState(MakeDrawSortKey(desc.m_PipelineID, desc.m_MaterialID, desc.m_MeshID, 0.0f));
+    uint32_t batchIndex;
+    auto found = m_BatchLookup.find(stateKey);
+    if (found == m_BatchLookup.end()) {
+        batchIndex = (uint32_t)m_Batches.size();
+        DrawBatch batch;
+        batch.m_StateKey = stateKey;
+        batch.m_InstanceOffset = 0;
+        batch.m_Dirty = true;
+        m_Batches.push_back(batch);
+        m_BatchLookup.emplace(stateKey, batchIndex);
+    } else {
+        batchIndex = found->second;
+    }
+
+    uint32_t objectID;
+    if (!m_FreeObjects.empty()) {
+        objectID = m_FreeObjects.back();
+        m_FreeObjects.pop_back();
+    } else {
+        objectID = (uint32_t)m_Objects.size();
+        m_Objects.emplace_back();
+    }
+
+    DrawBatch& batch = m_Batches[batchIndex];
+    DrawObject& object = m_Objects[objectID];
+    object.m_StateKey = stateKey;
+    object.m_BatchIndex = batchIndex;
+    object.m_IndexInBatch = (uint32_t)batch.m_Objects.size();
+    object.m_Depth = desc.m_Depth;
+    object.m_Instance = desc.m_Instance;
+    object.m_Alive = true;
+    batch.m_Objects.push_back(objectID);
+
+    // Instance ranges shift, every batch after this one moves.
+    m_LayoutDirty = true;
+    return objectID;
+}
+
+void VulkanDrawBatcher::UpdateObject(uint32_t objectID, const DrawInstanceData& instance, float depth)
+{
+    if (objectID >= m_Objects.size() || !m_Objects[objectID].m_Alive) {
+        return;
+    }
+    DrawObject& object = m_Objects[objectID];
+    object.m_Instance = instance;
+    object.m_Depth = depth;
+    MarkBatchDirty(object.m_BatchIndex);
+}
+
+void VulkanDrawBatcher::RemoveObject(uint32_t objectID)
+{
+    if (objectID >= m_Objects.size() || !m_Objects[objectID].m_Alive) {
+        return;
+    }
+
+    DrawObject& object = m_Objects[objectID];
+    DrawBatch& batch = m_Batches[object.m_BatchIndex];
+    uint32_t lastObjectID = batch.m_Objects.back();
+    batch.m_Objects[object.m_IndexInBatch] = lastObjectID;
+    m_Objects[lastObjectID].m_IndexInBatch = object.m_IndexInBatch;
+    batch.m_Objects.pop_back();
+
+    object.m_Alive = false;
+    m_FreeObjects.push_back(objectID);
+    m_LayoutDirty = true;
+}
+
+void VulkanDrawBatcher::MarkBatchDirty(uint32_t batchIndex)
+{
+    m_Batches[batchIndex].m_Dirty = true;
+}
+
+void VulkanDrawBatcher::LayoutBatches()
+{
+    uint32_t instanceOffset = 0;
+    for (uint32_t i = 0; i < (uint32_t)m_Batches.size(); i++) {
+        m_Batches[i].m_InstanceOffset = instanceOffset;
+        instanceOffset += (uint32_t)m_Batches[i].m_Objects.size();
+        MarkBatchDirty(i);
+    }
+    m_InstanceCount = instanceOffset;
+    m_LayoutDirty = false;
+}
+
+bool VulkanDrawBatcher::IsDrawable(uint64_t stateKey) const
+{
+    uint32_t pipelineID = (uint32_t)(stateKey >> 36) & 0xFF;
+    uint32_t meshID = (uint32_t)stateKey & 0xFFFFF;
+    return pipelineID < m_Pipelines.size() && VK_NULL_HANDLE != m_Pipelines[pipelineID].m_Pipeline &&
+        meshID < m_Meshes.size() && VK_NULL_HANDLE != m_Meshes[meshID].m_VertexBuffer;
+}
+
+void VulkanDrawBatcher::Prepare()
+{
+    PROFILE_FUNCTION();
+    auto prepareStart = std::chrono::high_resolution_clock::now();
+
+    m_Statistics = DrawBatchStatistics{};
+    m_SortedBatches.clear();
+    m_DrawListHash = HashCommandValue(COMMAND_HASH_SEED, m_Registrations);
+    if (m_Batches.empty()) {
+        return;
+    }
+
+    if (m_LayoutDirty) {
+        LayoutBatches();
+    }
+
+    /****************************************************************************
+     * Rebuild dirty batches & sort
+     ****************************************************************************/
+    for (uint32_t batchIndex = 0; batchIndex < (uint32_t)m_Batches.size(); batchIndex++) {
+        DrawBatch& batch = m_Batches[batchIndex];
+        if (batch.m_Objects.empty()) {
+            continue;
+        }
+
+        float minDepth = 1.0f;
+        for (uint32_t i = 0; i < (uint32_t)batch.m_Objects.size(); i++) {
+            const DrawObject& object = m_Objects[batch.m_Objects[i]];
+            minDepth = std::min(minDepth, object.m_Depth);
+            if (batch.m_Dirty) {
+                m_Instances[batch.m_InstanceOffset + i] = object.m_Instance;
+            }
+        }
+        if (batch.m_Dirty) {
+            batch.m_Dirty = false;
+            m_Statistics.m_DirtyBatches++;
+        }
+
+        uint64_t sortKey = (batch.m_StateKey << DRAW_SORT_DEPTH_BITS) |
+            (uint64_t)(std::min(std::max(minDepth, 0.0f), 1.0f) * (float)DRAW_SORT_DEPTH_MASK);
+        m_SortedBatches.emplace_back(sortKey, batchIndex);
+        m_Statistics.m_Objects += (uint32_t)batch.m_Objects.size();
+    }
+    std::sort(m_SortedBatches.begin(), m_SortedBatches.end());
+
+    /****************************************************************************
+     * Upload, the descriptor covers GetInstanceBytes() past the dynamic offset
+     ****************************************************************************/
+    FrameRingAllocation allocation;
+    if (!m_FrameRing->AllocateStorage(GetInstanceBytes(), allocation)) {
+        m_SortedBatches.clear();
+        return;
+    }
+    memcpy(allocation.m_Mapped, m_Instances.data(), sizeof(DrawInstanceData) * m_InstanceCount);
+    m_Statistics.m_UploadedBytes = sizeof(DrawInstanceData) * m_InstanceCount;
+    // A recreated ring has a new buffer, the previous frame using the set is done by then.
+    if (m_FrameRing->GetGeneration() != m_InstanceRingGeneration) {
+        VkDescriptorBufferInfo bufferInfo = { allocation.m_Buffer, 0, GetInstanceBytes() };
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_InstanceSet;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+        write.pBufferInfo = &bufferInfo;
+        vkUpdateDescriptorSets(m_Device, 1, &write, 0, nullptr);
+        m_InstanceRingGeneration = m_FrameRing->GetGeneration();
+    }
+    m_InstanceRingOffset = (uint32_t)allocation.m_Offset;
+    m_DrawListHash = HashCommandValue(HashCommandValue(m_DrawListHash, m_InstanceRingGeneration), m_InstanceRingOffset);
+
+    // Depth only matters through the order, each batch's draw is its state, instance count & offset. Counted here
+    // rather than while recording, the draws may be executed from a previous recording.
+    uint32_t boundPipeline = UINT32_MAX;
+    for (const auto& sorted : m_SortedBatches) {
+        const DrawBatch& batch = m_Batches[sorted.second];
+        if (!IsDrawable(batch.m_StateKey)) {
+            continue;
+        }
+        uint32_t range[2] = { (uint32_t)batch.m_Objects.size(), batch.m_InstanceOffset };
+        m_DrawListHash = HashCommandValue(HashCommandValue(m_DrawListHash, batch.m_StateKey), range);
+
+        uint32_t pipelineID = (uint32_t)(batch.m_StateKey >> 36) & 0xFF;
+        if (pipelineID != boundPipeline) {
+            boundPipeline = pipelineID;
+            m_Statistics.m_PipelineBinds++;
+        }
+        m_Statistics.m_DrawCalls++;
+    }
+
+    m_Statistics.m_RecordMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - prepareStart).count();
+}
+
+void VulkanDrawBatcher::RecordDraws(VkCommandBuffer commandBuffer)
+{
+    PROFILE_FUNCTION();
+    auto recordStart = std::chrono::high_resolution_clock::now();
+
+    /****************************************************************************
+     * Record merged draws, state is only rebound when it changes between batches
+     ****************************************************************************/
+    uint32_t boundPipeline = UINT32_MAX;
+    uint32_t boundMaterial = UINT32_MAX;
+    uint32_t boundMesh = UINT32_MAX;
+    for (const auto& sorted : m_SortedBatches) {
+        const DrawBatch& batch = m_Batches[sorted.second];
+        uint32_t pipelineID = (uint32_t)(batch.m_StateKey >> 36) & 0xFF;
+        uint32_t materialID = (uint32_t)(batch.m_StateKey >> 20) & 0xFFFF;
+        uint32_t meshID = (uint32_t)batch.m_StateKey & 0xFFFFF;
+        if (!IsDrawable(batch.m_StateKey)) {
+            continue;
+        }
+
+        const DrawPipeline& pipeline = m_Pipelines[pipelineID];
+        if (pipelineID != boundPipeline) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.m_Pipeline);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.m_Layout,
+                DRAW_BATCH_INSTANCE_SET, 1, &m_InstanceSet, 1, &m_InstanceRingOffset);
+            boundPipeline = pipelineID;
+            boundMaterial = UINT32_MAX;
+        }
+
+        if (materialID != boundMaterial && materialID < m_Materials.size() && VK_NULL_HANDLE != m_Materials[materialID]) {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.m_Layout,
+                DRAW_BATCH_MATERIAL_SET, 1, &m_Materials[materialID], 0, nullptr);
+            boundMaterial = materialID;
+        }
+
+        const DrawMesh& mesh = m_Meshes[meshID];
+        if (meshID != boundMesh) {
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, &mesh.m_VertexBuffer, &offset);
+            vkCmdBindIndexBuffer(commandBuffer, mesh.m_IndexBuffer, 0, mesh.m_IndexType);
+            boundMesh = meshID;
+        }
+
+        vkCmdDrawIndexed(commandBuffer, mesh.m_IndexCount, (uint32_t)batch.m_Objects.size(), mesh.m_FirstIndex, mesh.m_VertexOffset, batch.m_InstanceOffset);
+    }
+
+    m_Statistics.m_RecordMicroseconds += std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - recordStart).count();
+}
+
+__END_NAMESPACE
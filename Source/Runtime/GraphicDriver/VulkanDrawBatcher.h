@@ -0,0 +1,150 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+static const uint32_t DRAW_BATCH_INVALID_ID = UINT32_MAX;
+static const uint32_t DRAW_BATCH_MATERIAL_SET = 0;   // Descriptor set index of registered materials
+static const uint32_t DRAW_BATCH_INSTANCE_SET = 1;   // Descriptor set index of the per instance storage buffer
+
+
+/**
+ * 64 bits draw sort key, most significant first:
+ *   | pipeline 8 | material 16 | mesh 20 | depth 20 |
+ * Draws sharing pipeline, material & mesh (the state key) are merged into one instanced draw.
+ */
+uint64_t MakeDrawSortKey(uint32_t pipelineID, uint32_t materialID, uint32_t meshID, float depth01);
+FORCEINLINE uint64_t DrawSortKeyState(uint64_t sortKey) { return sortKey >> 20; }
+
+
+// std430 layout of one element in the instance storage buffer, indexed by gl_InstanceIndex.
+typedef struct DrawInstanceData {
+	glm::mat4    m_Transform;
+	glm::vec4    m_Params;
+} DrawInstanceData;
+
+typedef struct DrawMesh {
+	VkBuffer     m_VertexBuffer;
+	VkBuffer     m_IndexBuffer;
+	VkIndexType  m_IndexType;
+	uint32_t     m_IndexCount;
+	uint32_t     m_FirstIndex;
+	int32_t      m_VertexOffset;
+} DrawMesh;
+
+typedef struct DrawObjectDesc {
+	uint32_t          m_PipelineID;
+	uint32_t          m_MaterialID;
+	uint32_t          m_MeshID;
+	float             m_Depth;        // Normalized view depth, batches are sorted front to back
+	DrawInstanceData  m_Instance;
+} DrawObjectDesc;
+
+typedef struct DrawBatchStatistics {
+	uint32_t     m_Objects;           // Draw calls without batching
+	uint32_t     m_DrawCalls;         // Instanced draw calls recorded
+	uint32_t     m_PipelineBinds;
+	uint32_t     m_DirtyBatches;      // Batches whose instance data was rebuilt this frame
+	uint64_t     m_UploadedBytes;
+	double       m_RecordMicroseconds;
+} DrawBatchStatistics;
+
+
+class VulkanFrameRing;
+
+
+/**
+ * Batching stage between the scene and command recording. Objects are grouped by state key into
+ * persistent batches, only batches touched since the last Prepare() are gathered again into a host copy
+ * of the instances, which each frame uploads into its frame ring segment.
+ */
+class VulkanDrawBatcher
+{
+public:
+	VulkanDrawBatcher();
+	virtual ~VulkanDrawBatcher();
+
+	// Every Prepare() takes GetInstanceBytes() out of frameRing, which must outlive the batcher.
+	bool Create(VkDevice device, VulkanFrameRing* frameRing, uint32_t maxInstances);
+	void Destroy();
+
+	// Pipeline layouts must use GetInstanceSetLayout() at DRAW_BATCH_INSTANCE_SET.
+	void RegisterPipeline(uint32_t pipelineID, VkPipeline pipeline, VkPipelineLayout layout);
+	void RegisterMaterial(uint32_t materialID, VkDescriptorSet descriptorSet);
+	void RegisterMesh(uint32_t meshID, const DrawMesh& mesh);
+	VkDescriptorSetLayout GetInstanceSetLayout() const { return m_InstanceSetLayout; }
+	uint32_t GetMaxInstances() const { return m_MaxInstances; }
+	VkDeviceSize GetInstanceBytes() const { return sizeof(DrawInstanceData) * (VkDeviceSize)m_MaxInstances; }
+
+	uint32_t AddObject(const DrawObjectDesc& desc);
+	void UpdateObject(uint32_t objectID, const DrawInstanceData& instance, float depth);
+	void RemoveObject(uint32_t objectID);
+
+	// Rebuild dirty batches, upload the instances into the frame ring & sort the batches, which settles the draw
+	// list hash. After the frame ring's BeginFrame() for the frame being recorded.
+	void Prepare();
+	// Record the merged draws of the last Prepare(), which has to be for the same frame.
+	void RecordDraws(VkCommandBuffer commandBuffer);
+	// Changes whenever RecordDraws() would record different commands: draw order, instance ranges, registrations
+	// & where in the frame ring the instances are. Instance data alone never changes it, it's read rather than recorded.
+	uint64_t GetDrawListHash() const { return m_DrawListHash; }
+
+	const DrawBatchStatistics& GetStatistics() const { return m_Statistics; }
+
+private:
+	typedef struct DrawObject {
+		uint64_t          m_StateKey;
+		uint32_t          m_BatchIndex;
+		uint32_t          m_IndexInBatch;
+		float             m_Depth;
+		DrawInstanceData  m_Instance;
+		bool              m_Alive;
+	} DrawObject;
+
+	typedef struct DrawBatch {
+		uint64_t               m_StateKey;
+		std::vector<uint32_t>  m_Objects;
+		uint32_t               m_InstanceOffset;
+		bool                   m_Dirty;
+	} DrawBatch;
+
+	typedef struct DrawPipeline {
+		VkPipeline        m_Pipeline;
+		VkPipelineLayout  m_Layout;
+	} DrawPipeline;
+
+	VkDevice                                 m_Device;
+	VulkanFrameRing*                         m_FrameRing;
+	uint32_t                                 m_MaxInstances;
+	uint32_t                                 m_InstanceCount;        // Laid out by the batches, uploaded every frame
+	std::vector<DrawInstanceData>            m_Instances;            // Host copy, only dirty batches are gathered again
+	VkDescriptorSetLayout                    m_InstanceSetLayout;
+	VkDescriptorPool                         m_DescriptorPool;
+	VkDescriptorSet                          m_InstanceSet;          // Dynamic, over the frame ring's buffer
+	uint32_t                                 m_InstanceRingGeneration; // Of the ring buffer m_InstanceSet was written with
+	uint32_t                                 m_InstanceRingOffset;   // Of this frame's instances
+
+	std::vector<DrawPipeline>                m_Pipelines;
+	std::vector<VkDescriptorSet>             m_Materials;
+	std::vector<DrawMesh>                    m_Meshes;
+
+	std::vector<DrawObject>                  m_Objects;
+	std::vector<uint32_t>                    m_FreeObjects;
+	std::vector<DrawBatch>                   m_Batches;
+	std::unordered_map<uint64_t, uint32_t>   m_BatchLookup;           // State key -> batch index
+	std::vector<std::pair<uint64_t, uint32_t>> m_SortedBatches;       // Sort key -> batch index
+	bool                                     m_LayoutDirty;
+	uint32_t                                 m_Registrations;         // Bumped by every Register*() call, handles behind the same IDs may change
+	uint64_t                                 m_DrawListHash;
+
+	DrawBatchStatistics                      m_Statistics;
+
+	void LayoutBatches();
+	// Its pipeline & mesh are registered.
+	bool IsDrawable(uint64_t stateKey) const;
+	void MarkBatchDirty(uint32_t batchIndex);
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,330 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanSceneAttachments.h"
+#include "VulkanDynamicResolution.h"
+
+
+__BEGIN_NAMESPACE
+
+// Hysteresis band around the budget, keeps the scale from oscillating every adjustment.
+static const double DYNAMIC_RESOLUTION_DOWNSCALE_THRESHOLD = 0.95;
+static const double DYNAMIC_RESOLUTION_UPSCALE_THRESHOLD = 0.80;
+// Drop fast under a spike, come back slowly.
+static const float DYNAMIC_RESOLUTION_MAX_DECREASE = 0.80f;
+static const float DYNAMIC_RESOLUTION_MAX_INCREASE = 1.05f;
+
+VulkanDynamicResolution::VulkanDynamicResolution() :
+	m_Device(VK_NULL_HANDLE),
+	m_PhysicalDevice(VK_NULL_HANDLE),
+	m_ColorFormat(VK_FORMAT_UNDEFINED),
+	m_BlitFilter(VK_FILTER_NEAREST),
+	m_SceneAttachments(nullptr),
+	m_RenderPass(VK_NULL_HANDLE),
+	m_Framebuffer(VK_NULL_HANDLE),
+	m_QueryPool(VK_NULL_HANDLE),
+	m_TimestampPeriod(1.0),
+	m_TimestampMask(UINT64_MAX),
+	m_OutputExtent({ 0, 0 }),
+	m_RenderExtent({ 0, 0 }),
+	m_Jitter(0.0f),
+	m_Scale(1.0f),
+	m_GpuTime(0.0),
+	m_GpuTimeSum(0.0),
+	m_GpuTimeSamples(0)
+{
+}
+
+VulkanDynamicResolution::~VulkanDynamicResolution()
+{
+}
+
+bool VulkanDynamicResolution::Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight,
+    VkFormat colorFormat, const VulkanSceneAttachments* sceneAttachments)
+{
+    m_Device = device;
+    m_PhysicalDevice = physicalDevice;
+    m_ColorFormat = colorFormat;
+    m_SceneAttachments = sceneAttachments;
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, colorFormat, &formatProperties);
+    VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+    if ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures) {
+        std::cout << "Vulkan dynamic resolution needs blit support for the swapchain format.\n";
+        return false;
+    }
+    m_BlitFilter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+    /****************************************************************************
+     * Timestamps around the scene pass, two per frame in flight
+     ****************************************************************************/
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    uint32_t validBits = (queueFamilyIndex < queueFamilyCount) ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+
+    if (0 != validBits && deviceProperties.limits.timestampPeriod > 0.0f) {
+        m_TimestampPeriod = deviceProperties.limits.timestampPeriod;
+        m_TimestampMask = (validBits >= 64) ? UINT64_MAX : ((1ull << validBits) - 1);
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = framesInFlight * 2;
+        if (vkCreateQueryPool(device, &queryPoolInfo, GetVulkanAllocator(), &m_QueryPool) != VK_SUCCESS) {
+            m_QueryPool = VK_NULL_HANDLE;
+        }
+    }
+    if (VK_NULL_HANDLE == m_QueryPool) {
+        std::cout << "Vulkan dynamic resolution has no GPU timestamps, scale stays fixed.\n";
+    }
+    m_QueryWritten.assign(framesInFlight, false);
+    return true;
+}
+
+bool VulkanDynamicResolution::CreateTarget(VkExtent2D outputExtent)
+{
+    DestroyTarget();
+
+    // Rebuilt with the target since the scene attachment setup may have changed.
+    // The previous frame's blit still reads the target, the next frame's blit reads what this pass wrote.
+    VkSubpassDependency dependencies[2] = {};
+    dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[0].dstSubpass = 0;
+    dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].srcAccessMask = 0;
+    dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].srcSubpass = 0;
+    dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+    dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    if (!m_SceneAttachments->UsesDynamicRendering() &&
+        !m_SceneAttachments->CreateRenderPass(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, dependencies, 2, m_RenderPass)) {
+        return false;
+    }
+
+    // Sized for the largest scale, smaller scales only shrink the render area.
+    VkExtent2D targetExtent;
+    targetExtent.width = std::max(1u, (uint32_t)(outputExtent.width * m_Settings.m_MaxScale + 0.5f));
+    targetExtent.height = std::max(1u, (uint32_t)(outputExtent.height * m_Settings.m_MaxScale + 0.5f));
+    if (!CreateImage2D(m_Device, m_PhysicalDevice, targetExtent, m_ColorFormat,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_Target)) {
+        return false;
+    }
+
+    if (m_SceneAttachments->UsesDynamicRendering()) {
+        m_OutputExtent = outputExtent;
+        UpdateRenderExtent();
+        return true;
+    }
+
+    VkImageView attachments[VulkanSceneAttachments::MAX_ATTACHMENTS];
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_RenderPass;
+    framebufferInfo.attachmentCount = m_SceneAttachments->GetFramebufferAttachments(m_Target.m_View, attachments);
+    framebufferInfo.pAttachments = attachments;
+    framebufferInfo.width = targetExtent.width;
+    framebufferInfo.height = targetExtent.height;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(m_Device, &framebufferInfo, GetVulkanAllocator(), &m_Framebuffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create dynamic resolution framebuffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    m_OutputExtent = outputExtent;
+    UpdateRenderExtent();
+    return true;
+}
+
+void VulkanDynamicResolution::DestroyTarget()
+{
+    if (VK_NULL_HANDLE != m_Framebuffer) {
+        vkDestroyFramebuffer(m_Device, m_Framebuffer, GetVulkanAllocator());
+        m_Framebuffer = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_RenderPass) {
+        vkDestroyRenderPass(m_Device, m_RenderPass, GetVulkanAllocator());
+        m_RenderPass = VK_NULL_HANDLE;
+    }
+    DestroyImage(m_Device, m_Target);
+}
+
+void VulkanDynamicResolution::Destroy()
+{
+    if (VK_NULL_HANDLE == m_Device) {
+        return;
+    }
+
+    DestroyTarget();
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkDestroyQueryPool(m_Device, m_QueryPool, GetVulkanAllocator());
+        m_QueryPool = VK_NULL_HANDLE;
+    }
+    m_QueryWritten.clear();
+    m_Device = VK_NULL_HANDLE;
+}
+
+void VulkanDynamicResolution::SetSettings(const DynamicResolutionSettings& settings)
+{
+    float maxScale = m_Settings.m_MaxScale;
+    m_Settings = settings;
+    // The scene's depth & MSAA attachments are sized for the output, the target can't be larger.
+    m_Settings.m_MaxScale = std::max(0.1f, std::min(m_Settings.m_MaxScale, 1.0f));
+    m_Settings.m_MinScale = std::max(0.1f, std::min(m_Settings.m_MinScale, m_Settings.m_MaxScale));
+    if (m_Settings.m_FixedScale > 0.0f) {
+        m_Scale = m_Settings.m_FixedScale;
+    }
+    m_Scale = std::max(m_Settings.m_MinScale, std::min(m_Scale, m_Settings.m_MaxScale));
+    m_GpuTimeSum = 0.0;
+    m_GpuTimeSamples = 0;
+
+    if (maxScale != m_Settings.m_MaxScale && VK_NULL_HANDLE != m_Target.m_Image) {
+        vkDeviceWaitIdle(m_Device);
+        CreateTarget(m_OutputExtent);
+    } else {
+        UpdateRenderExtent();
+    }
+}
+
+void VulkanDynamicResolution::BeginFrame(uint32_t frameIndex)
+{
+    if (VK_NULL_HANDLE == m_QueryPool || !m_QueryWritten[frameIndex]) {
+        return;
+    }
+
+    // The slot's fence has signaled, so the results are available without waiting.
+    uint64_t timestamps[2] = {};
+    if (VK_SUCCESS != vkGetQueryPoolResults(m_Device, m_QueryPool, frameIndex * 2, 2, sizeof(timestamps), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT)) {
+        return;
+    }
+    m_QueryWritten[frameIndex] = false;
+
+    m_GpuTime = ((timestamps[1] - timestamps[0]) & m_TimestampMask) * m_TimestampPeriod / 1000000.0;
+    m_GpuTimeSum += m_GpuTime;
+    PROFILE_COUNTER("SceneGpuMs", m_GpuTime);
+
+    if (++m_GpuTimeSamples >= std::max(m_Settings.m_AdjustInterval, 1u)) {
+        Adjust(m_GpuTimeSum / m_GpuTimeSamples);
+        m_GpuTimeSum = 0.0;
+        m_GpuTimeSamples = 0;
+    }
+}
+
+void VulkanDynamicResolution::Adjust(double averageGpuTime)
+{
+    double budget = m_Settings.m_TargetGpuTime;
+    if (m_Settings.m_FixedScale > 0.0f || averageGpuTime <= 0.0 ||
+        (averageGpuTime < budget * DYNAMIC_RESOLUTION_DOWNSCALE_THRESHOLD && averageGpuTime > budget * DYNAMIC_RESOLUTION_UPSCALE_THRESHOLD)) {
+        return;
+    }
+
+    // GPU time follows pixel count, which goes with the square of the scale.
+    float step = (float)sqrt(budget * DYNAMIC_RESOLUTION_UPSCALE_THRESHOLD / averageGpuTime);
+    if (averageGpuTime >= budget * DYNAMIC_RESOLUTION_DOWNSCALE_THRESHOLD) {
+        step = (float)sqrt(budget * DYNAMIC_RESOLUTION_DOWNSCALE_THRESHOLD / averageGpuTime);
+    }
+    step = std::max(DYNAMIC_RESOLUTION_MAX_DECREASE, std::min(step, DYNAMIC_RESOLUTION_MAX_INCREASE));
+    m_Scale = std::max(m_Settings.m_MinScale, std::min(m_Scale * step, m_Settings.m_MaxScale));
+    UpdateRenderExtent();
+    PROFILE_COUNTER("RenderScale", m_Scale);
+}
+
+void VulkanDynamicResolution::UpdateRenderExtent()
+{
+    m_RenderExtent.width = std::max(1u, std::min(m_Target.m_Extent.width, (uint32_t)(m_OutputExtent.width * m_Scale + 0.5f)));
+    m_RenderExtent.height = std::max(1u, std::min(m_Target.m_Extent.height, (uint32_t)(m_OutputExtent.height * m_Scale + 0.5f)));
+}
+
+void VulkanDynamicResolution::BeginScene(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkSubpassContents contents)
+{
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdResetQueryPool(commandBuffer, m_QueryPool, frameIndex * 2, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, frameIndex * 2);
+    }
+
+    // The previous frame's blit still reads the target.
+    if (m_SceneAttachments->UsesDynamicRendering()) {
+        m_SceneAttachments->CmdBeginRendering(commandBuffer, m_Target.m_Image, m_Target.m_View, m_RenderExtent,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS == contents);
+    } else {
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = m_RenderPass;
+        renderPassInfo.framebuffer = m_Framebuffer;
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = m_RenderExtent;
+
+        VkClearValue clearValues[VulkanSceneAttachments::MAX_ATTACHMENTS];
+        renderPassInfo.clearValueCount = m_SceneAttachments->GetClearValues(clearValues);
+        renderPassInfo.pClearValues = clearValues;
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+    }
+    if (VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS == contents) {
+        return;
+    }
+
+    VkViewport viewport;
+    VkRect2D scissor;
+    GetSceneViewport(viewport, scissor);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void VulkanDynamicResolution::GetSceneViewport(VkViewport& viewport, VkRect2D& scissor) const
+{
+    // Moving the viewport moves the scene under the pixel centers, the scissor keeps it in the render area.
+    viewport = { m_Jitter.x, m_Jitter.y, (float)m_RenderExtent.width, (float)m_RenderExtent.height, 0.0f, 1.0f };
+    scissor = { { 0, 0 }, m_RenderExtent };
+}
+
+void VulkanDynamicResolution::EndScene(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    if (m_SceneAttachments->UsesDynamicRendering()) {
+        m_SceneAttachments->CmdEndRendering(commandBuffer, m_Target.m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    } else {
+        vkCmdEndRenderPass(commandBuffer);
+    }
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, frameIndex * 2 + 1);
+        m_QueryWritten[frameIndex] = true;
+    }
+}
+
+void VulkanDynamicResolution::Upscale(VkCommandBuffer commandBuffer, VkImage outputImage, VkExtent2D outputExtent)
+{
+    PROFILE_FUNCTION();
+
+    // Chained to the acquire semaphore wait, which is at the color output stage.
+    CmdImageBarrier(commandBuffer, outputImage, VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    VkImageBlit region{};
+    region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.srcOffsets[1] = { (int32_t)m_RenderExtent.width, (int32_t)m_RenderExtent.height, 1 };
+    region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.dstOffsets[1] = { (int32_t)outputExtent.width, (int32_t)outputExtent.height, 1 };
+    vkCmdBlitImage(commandBuffer, m_Target.m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        outputImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, m_BlitFilter);
+
+    CmdImageBarrier(commandBuffer, outputImage, VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+}
+
+__END_NAMESPACE
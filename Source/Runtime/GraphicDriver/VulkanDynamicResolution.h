@@ -0,0 +1,93 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+class VulkanSceneAttachments;
+
+
+typedef struct DynamicResolutionSettings {
+	float       m_TargetGpuTime = 14.0f;    // Scene budget in milliseconds, leaves headroom under 16.6 ms
+	float       m_MinScale = 0.5f;
+	float       m_MaxScale = 1.0f;          // At most 1, the scene attachments are sized for the output
+	uint32_t    m_AdjustInterval = 8;       // Frames of GPU time averaged per adjustment
+	float       m_FixedScale = 0.0f;        // Above 0 pins the scale within the range, GPU time is still measured
+} DynamicResolutionSettings;
+
+
+/**
+ * Renders the scene into a sub-rectangle of an offscreen target sized for the output, and blits
+ * it up to the swapchain image. The rectangle follows the scene GPU time measured with timestamps,
+ * so resizing never reallocates the target.
+ */
+class VulkanDynamicResolution
+{
+public:
+	VulkanDynamicResolution();
+	virtual ~VulkanDynamicResolution();
+
+	// The target's render pass uses sceneAttachments' layout, whose images are sized for the output.
+	bool Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight,
+		VkFormat colorFormat, const VulkanSceneAttachments* sceneAttachments);
+	// Called again whenever the swapchain or the scene attachments are recreated.
+	bool CreateTarget(VkExtent2D outputExtent);
+	void DestroyTarget();
+	void Destroy();
+
+	void SetSettings(const DynamicResolutionSettings& settings);
+	const DynamicResolutionSettings& GetSettings() const { return m_Settings; }
+
+	// Once the frame slot's fence has signaled: reads its GPU time back and adjusts the scale.
+	void BeginFrame(uint32_t frameIndex);
+	// Scene render pass over the scaled area, viewport & scissor are set to it, the viewport moved by the jitter.
+	// With secondary contents they're left to the secondaries, see GetSceneViewport().
+	void BeginScene(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+	void GetSceneViewport(VkViewport& viewport, VkRect2D& scissor) const;
+	void EndScene(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	// Scaled area to the whole output image, which is left in PRESENT_SRC_KHR.
+	void Upscale(VkCommandBuffer commandBuffer, VkImage outputImage, VkExtent2D outputExtent);
+	// Sub-pixel offset of the next scenes in render pixels, for a temporal resolve instead of Upscale().
+	void SetJitter(const glm::vec2& jitter) { m_Jitter = jitter; }
+
+	// Compatible with the swapchain render pass, pipelines built for one work in the other. VK_NULL_HANDLE with dynamic rendering.
+	VkRenderPass GetRenderPass() const { return m_RenderPass; }
+	VkExtent2D GetRenderExtent() const { return m_RenderExtent; }
+	float GetScale() const { return m_Scale; }
+	double GetGpuTime() const { return m_GpuTime; }
+	bool IsTimingSupported() const { return VK_NULL_HANDLE != m_QueryPool; }
+	// Left in TRANSFER_SRC_OPTIMAL by EndScene(), sized for the largest scale.
+	VkImage GetTargetImage() const { return m_Target.m_Image; }
+	VkImageView GetTargetView() const { return m_Target.m_View; }
+	VkExtent2D GetTargetExtent() const { return m_Target.m_Extent; }
+
+private:
+	VkDevice                    m_Device;
+	VkPhysicalDevice            m_PhysicalDevice;
+	VkFormat                    m_ColorFormat;
+	VkFilter                    m_BlitFilter;
+	const VulkanSceneAttachments* m_SceneAttachments;
+	VkRenderPass                m_RenderPass;
+	VulkanImage                 m_Target;
+	VkFramebuffer               m_Framebuffer;
+
+	VkQueryPool                 m_QueryPool;
+	std::vector<bool>           m_QueryWritten;
+	double                      m_TimestampPeriod;      // Nanoseconds per tick
+	uint64_t                    m_TimestampMask;
+
+	DynamicResolutionSettings   m_Settings;
+	VkExtent2D                  m_OutputExtent;
+	VkExtent2D                  m_RenderExtent;
+	glm::vec2                   m_Jitter;
+	float                       m_Scale;
+	double                      m_GpuTime;
+	double                      m_GpuTimeSum;
+	uint32_t                    m_GpuTimeSamples;
+
+	void Adjust(double averageGpuTime);
+	void UpdateRenderExtent();
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,91 @@
+#include "VulkanUtility.h"
+#include "VulkanFrameRing.h"
+
+
+__BEGIN_NAMESPACE
+
+VulkanFrameRing::VulkanFrameRing() :
+    m_Device(VK_NULL_HANDLE),
+    m_FramesInFlight(0),
+    m_BytesPerFrame(0),
+    m_UniformAlignment(256),
+    m_StorageAlignment(256),
+    m_FrameBegin(0),
+    m_FrameEnd(0),
+    m_Offset(0),
+    m_Peak(0),
+    m_Generation(0),
+    m_OverflowReported(false)
+{
+}
+
+VulkanFrameRing::~VulkanFrameRing()
+{
+}
+
+bool VulkanFrameRing::Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, VkDeviceSize bytesPerFrame)
+{
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    m_UniformAlignment = std::max<VkDeviceSize>(deviceProperties.limits.minUniformBufferOffsetAlignment, 16);
+    m_StorageAlignment = std::max<VkDeviceSize>(deviceProperties.limits.minStorageBufferOffsetAlignment, 16);
+
+    // Segments start on an alignment every kind of sub-allocation accepts.
+    VkDeviceSize segmentAlignment = std::max(m_UniformAlignment, m_StorageAlignment);
+    m_BytesPerFrame = (bytesPerFrame + segmentAlignment - 1) / segmentAlignment * segmentAlignment;
+    m_FramesInFlight = framesInFlight;
+    m_Device = device;
+
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    // Prefer device local host visible memory (UMA / resizable BAR), GPU reads then skip the PCIe round trip.
+    VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (UINT32_MAX == FindMemoryType(physicalDevice, UINT32_MAX, properties)) {
+        properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    }
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, m_BytesPerFrame * framesInFlight, usage, properties, m_Buffer));
+
+    m_Generation++;
+    m_OverflowReported = false;
+    BeginFrame(0);
+    return true;
+}
+
+void VulkanFrameRing::Destroy()
+{
+    if (VK_NULL_HANDLE == m_Device) {
+        return;
+    }
+    DestroyBuffer(m_Device, m_Buffer);
+    m_Device = VK_NULL_HANDLE;
+}
+
+void VulkanFrameRing::BeginFrame(uint32_t frameIndex)
+{
+    m_Peak = std::max(m_Peak, m_Offset - m_FrameBegin);
+    m_FrameBegin = m_BytesPerFrame * (frameIndex % std::max(m_FramesInFlight, 1u));
+    m_FrameEnd = m_FrameBegin + m_BytesPerFrame;
+    m_Offset = m_FrameBegin;
+}
+
+bool VulkanFrameRing::Allocate(VkDeviceSize size, VkDeviceSize alignment, FrameRingAllocation& allocation)
+{
+    VkDeviceSize offset = (m_Offset + alignment - 1) / alignment * alignment;
+    if (nullptr == m_Buffer.m_Mapped || offset + size > m_FrameEnd) {
+        if (!m_OverflowReported) {
+            std::cout << "Vulkan frame ring exhausted, " << m_BytesPerFrame << " bytes per frame.\n";
+            m_OverflowReported = true;
+        }
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    m_Offset = offset + size;
+    allocation.m_Buffer = m_Buffer.m_Buffer;
+    allocation.m_Offset = offset;
+    allocation.m_Size = size;
+    allocation.m_Mapped = static_cast<uint8_t*>(m_Buffer.m_Mapped) + offset;
+    return true;
+}
+
+__END_NAMESPACE
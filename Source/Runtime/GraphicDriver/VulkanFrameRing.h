@@ -0,0 +1,59 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+typedef struct FrameRingAllocation {
+	VkBuffer         m_Buffer;
+	VkDeviceSize     m_Offset;
+	VkDeviceSize     m_Size;
+	void*            m_Mapped;
+} FrameRingAllocation;
+
+
+/**
+ * Transient GPU data (uniforms, dynamic vertices & indices) for the frame being recorded.
+ * One persistently mapped host visible buffer is split into a segment per frame in flight,
+ * BeginFrame() rewinds the segment once the frame's fence has signaled.
+ */
+class VulkanFrameRing
+{
+public:
+	VulkanFrameRing();
+	virtual ~VulkanFrameRing();
+
+	bool Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t framesInFlight, VkDeviceSize bytesPerFrame);
+	void Destroy();
+
+	void BeginFrame(uint32_t frameIndex);
+
+	bool Allocate(VkDeviceSize size, VkDeviceSize alignment, FrameRingAllocation& allocation);
+	bool AllocateUniform(VkDeviceSize size, FrameRingAllocation& allocation) { return Allocate(size, m_UniformAlignment, allocation); }
+	bool AllocateStorage(VkDeviceSize size, FrameRingAllocation& allocation) { return Allocate(size, m_StorageAlignment, allocation); }
+	bool AllocateVertex(VkDeviceSize size, FrameRingAllocation& allocation) { return Allocate(size, 16, allocation); }
+
+	VkBuffer GetBuffer() const { return m_Buffer.m_Buffer; }
+	VkDeviceSize GetBytesPerFrame() const { return m_BytesPerFrame; }
+	// Bumped by every Create(), descriptors written with the buffer of an older one are stale.
+	uint32_t GetGeneration() const { return m_Generation; }
+	VkDeviceSize GetFrameUsed() const { return m_Offset - m_FrameBegin; }
+	VkDeviceSize GetPeak() const { return m_Peak; }
+
+private:
+	VkDevice         m_Device;
+	VulkanBuffer     m_Buffer;
+	uint32_t         m_FramesInFlight;
+	VkDeviceSize     m_BytesPerFrame;
+	VkDeviceSize     m_UniformAlignment;
+	VkDeviceSize     m_StorageAlignment;
+	VkDeviceSize     m_FrameBegin;
+	VkDeviceSize     m_FrameEnd;
+	VkDeviceSize     m_Offset;
+	VkDeviceSize     m_Peak;
+	uint32_t         m_Generation;
+	bool             m_OverflowReported;
+};
+
+
+__END_NAMESPACE
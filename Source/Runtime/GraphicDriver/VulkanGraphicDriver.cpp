@@ -1,17 +1,42 @@
 #include <cstdint> // Necessary for UINT32_MAX
+#include "MPSCQueue.h"
+#include "FrameAllocator.h"
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanDeviceCapabilities.h"
+#include "VulkanMeshletCuller.h"
+#include "VulkanDrawBatcher.h"
+#include "VulkanCommandCache.h"
+#include "VulkanFrameRing.h"
+#include "VulkanSceneAttachments.h"
+#include "VulkanDynamicResolution.h"
+#include "VulkanTemporalUpscaler.h"
+#include "VulkanParticleSystem.h"
+#include "VulkanReadback.h"
 #include "VulkanGraphicDriver.h"
 
 
 __BEGIN_NAMESPACE
 
 static const size_t MAX_FRAMES_IN_FLIGHT = 2;
+// Every frame takes the instances of all of them from the frame ring, about 1.3 MB of its 4 MB.
+static const uint32_t MAX_BATCHED_INSTANCES = 16384;
+static const VkDeviceSize FRAME_RING_BYTES_PER_FRAME = 4 * 1024 * 1024;
+static const uint64_t READBACK_REPORT_INTERVAL = 600;
+// Longer gaps, a hitch or the window being dragged, are simulated as this much so the fountain doesn't jump.
+static const double PARTICLE_MAX_TIMESTEP = 0.1;
 static const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation"};
 static const bool enableValidationLayers = true; 
 
-#define VULKAN_DRIVER_CHECK_FUN(fun) {bool ok = fun; \
-if (!ok) { \
-    return false; \
-}}
+// Secondaries the scene pass is made of, in execution order.
+enum ScenePass : uint32_t
+{
+    ScenePass_Background = 0,
+    ScenePass_Batches,
+    ScenePass_Particles,
+
+    ScenePass_Count,
+};
 
 static bool CheckValidationLayerSupport()
 {
@@ -39,32 +64,7 @@ static bool CheckValidationLayerSupport()
     return true;
 }
 
-static int RateDeviceSuitabilityScore(VkPhysicalDevice device) 
-{
-    VkPhysicalDeviceProperties deviceProperties;
-    VkPhysicalDeviceFeatures deviceFeatures;
-    vkGetPhysicalDeviceProperties(device, &deviceProperties);
-    vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
-
-    int score = 0;
-
-    // Discrete GPUs have a significant performance advantage
-    if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-        score += 1000;
-    }
-
-    // Maximum possible size of textures affects graphics quality
-    score += deviceProperties.limits.maxImageDimension2D;
-
-    // Application can't function without geometry shaders
-    if (!deviceFeatures.geometryShader) {
-        return 0;
-    }
-
-    return score;
-}
-
-VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats)
+VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const DriverVector<VkSurfaceFormatKHR>& availableFormats)
 {
     for (const auto& availableFormat : availableFormats) {
         if (availableFormat.format == VK_FORMAT_B8G8R8A8_SRGB && availableFormat.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
@@ -75,14 +75,33 @@ VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>
     return availableFormats[0];
 }
 
-VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+const char* GetPresentModePolicyName(PresentModePolicy policy)
 {
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
-        }
+    switch (policy) {
+    case PresentModePolicy::LowLatency:     return "LowLatency";
+    case PresentModePolicy::Uncapped:       return "Uncapped";
+    case PresentModePolicy::PowerSaving:    return "PowerSaving";
+    default:                                return "Unknown";
     }
+}
 
+VkPresentModeKHR ChooseSwapPresentMode(const DriverVector<VkPresentModeKHR>& availablePresentModes, PresentModePolicy policy)
+{
+    // FIFO is always available, everything else is a preference list.
+    VkPresentModeKHR preferences[2] = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_KHR };
+    if (PresentModePolicy::LowLatency == policy) {
+        preferences[0] = VK_PRESENT_MODE_MAILBOX_KHR;
+        preferences[1] = VK_PRESENT_MODE_IMMEDIATE_KHR;
+    } else if (PresentModePolicy::Uncapped == policy) {
+        preferences[0] = VK_PRESENT_MODE_IMMEDIATE_KHR;
+        preferences[1] = VK_PRESENT_MODE_MAILBOX_KHR;
+    }
+
+    for (VkPresentModeKHR preference : preferences) {
+        if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preference) != availablePresentModes.end()) {
+            return preference;
+        }
+    }
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -99,47 +118,6 @@ VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, uint32
     return actualExtent;
 }
 
-static int ReadFile(const std::string& filename, std::vector<char>& output)
-{
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open()) {
-        std::cout << "failed to open file!\n";
-        return -1;
-    }
-
-    size_t fileSize = (size_t)file.tellg();
-    output.resize(fileSize);
-    file.seekg(0);
-    file.read(output.data(), fileSize);
-    file.close();
-    return 0;
-}
-
-std::string CurExePath()
-{
-    char buffer[MAX_PATH];
-    ::GetModuleFileName(NULL, buffer, MAX_PATH);
-    std::string::size_type pos = std::string(buffer).find_last_of("\\/");
-    return std::string(buffer).substr(0, pos);
-}
-
-VkShaderModule CreateShaderModule(const VkDevice& device, const std::vector<char>& code)
-{
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-        std::cout << "Vulkan failed to create shader module.\n";
-        return VK_NULL_HANDLE;
-    }
-
-    return shaderModule;
-}
-
 
 VulkanGraphicDriver::VulkanGraphicDriver():
 	m_VulkanInstance(VK_NULL_HANDLE),
@@ -156,9 +134,37 @@ VulkanGraphicDriver::VulkanGraphicDriver():
 	m_VulkanPipelineLayout(VK_NULL_HANDLE),
 	m_VulkanGraphicsPipeline(VK_NULL_HANDLE),
 	m_VulkanCommandPool(VK_NULL_HANDLE),
+	m_CommandCache(nullptr),
 	m_CurrentFrame(0),
-    m_SkipFrame(false)
+    m_SkipFrame(false),
+    m_FrameCount(0),
+    m_DrawBatcher(nullptr),
+    m_FrameRing(nullptr),
+    m_PresentModePolicy(PresentModePolicy::LowLatency),
+    m_SwapChainDirty(false),
+    m_PresentWaitSupported(false),
+    m_PresentID(0),
+    m_FrameInputTime(0.0),
+    m_PresentLatency(0.0),
+#if defined(VK_KHR_present_wait)
+    m_vkWaitForPresentKHR(nullptr),
+#endif
+    m_DynamicResolution(nullptr),
+    m_DynamicResolutionEnabled(false),
+    m_DynamicResolutionSupported(false),
+    m_DynamicResolutionRequested(true),
+    m_TemporalUpscaler(nullptr),
+    m_TemporalUpscalingRequested(false),
+    m_ParticleSystem(nullptr),
+    m_ParticleCapacity(0),
+    m_ParticleInputTime(0.0),
+    m_SceneAttachments(nullptr),
+    m_Readback(nullptr),
+    m_VulkanReadbackQueue(VK_NULL_HANDLE),
+    m_CaptureSupported(false),
+    m_RejectedRenderRequests(0)
 {
+    memset(m_PresentInputTimes, 0, sizeof(m_PresentInputTimes));
     m_VulkanSurfaceFormat.format = VK_FORMAT_B8G8R8A8_SRGB;
     m_VulkanSurfaceFormat.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
     m_VulkanSwapExtent.width = 0;
@@ -197,6 +203,15 @@ bool VulkanGraphicDriver::CreateSwapChain(uint32_t width, uint32_t height)
     createInfo.imageExtent = m_VulkanSwapExtent;
     createInfo.imageArrayLayers = 1;
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    // Dynamic resolution blits the scene into the swapchain image.
+    if (m_SurfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    }
+    // Captures copy the presented image back to the CPU.
+    m_CaptureSupported = (0 != (m_SurfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT));
+    if (m_CaptureSupported) {
+        createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
 
     if (m_VulkanGraphicQueueFamilyID != m_VulkanPresentQueueFamilyID) {
         uint32_t queueFamilyIndices[] = { m_VulkanGraphicQueueFamilyID, m_VulkanPresentQueueFamilyID };
@@ -215,7 +230,7 @@ bool VulkanGraphicDriver::CreateSwapChain(uint32_t width, uint32_t height)
     createInfo.clipped = VK_TRUE;
     createInfo.oldSwapchain = VK_NULL_HANDLE;
 
-    if (vkCreateSwapchainKHR(m_VulkanLogicDevice, &createInfo, nullptr, &m_VulkanSwapChain) != VK_SUCCESS) {
+    if (vkCreateSwapchainKHR(m_VulkanLogicDevice, &createInfo, GetVulkanAllocator(), &m_VulkanSwapChain) != VK_SUCCESS) {
         std::cout << "Failed to create Vulkan swap chain.\n";
         SetErrorCode(ErrorCode::Vulkan_Invalid_SwapChain);
         return false;
@@ -242,7 +257,7 @@ bool VulkanGraphicDriver::CreateSwapChain(uint32_t width, uint32_t height)
         createInfo.subresourceRange.baseArrayLayer = 0;
         createInfo.subresourceRange.layerCount = 1;
 
-        if (vkCreateImageView(m_VulkanLogicDevice, &createInfo, nullptr, &m_VulkanSwapChainImageViews[i]) != VK_SUCCESS) {
+        if (vkCreateImageView(m_VulkanLogicDevice, &createInfo, GetVulkanAllocator(), &m_VulkanSwapChainImageViews[i]) != VK_SUCCESS) {
             std::cout << "Failed to create vulkan swapchain image views.\n";
             SetErrorCode(ErrorCode::Vulkan_InvalidSwapChainImageView);
             return false;
@@ -323,16 +338,10 @@ bool VulkanGraphicDriver::CreateShaderAndPipeline()
     rasterizer.depthBiasClamp = 0.0f; // Optional
     rasterizer.depthBiasSlopeFactor = 0.0f; // Optional
 
+    // Sample count & depth test follow the scene attachment settings.
     VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    multisampling.minSampleShading = 1.0f; // Optional
-    multisampling.pSampleMask = nullptr; // Optional
-    multisampling.alphaToCoverageEnable = VK_FALSE; // Optional
-    multisampling.alphaToOneEnable = VK_FALSE; // Optional
-
-    //VkPipelineDepthStencilStateCreateInfo
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    m_SceneAttachments->GetPipelineState(multisampling, depthStencil);
 
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -355,17 +364,16 @@ bool VulkanGraphicDriver::CreateShaderAndPipeline()
     colorBlending.blendConstants[2] = 0.0f; // Optional
     colorBlending.blendConstants[3] = 0.0f; // Optional
 
-    /*
+    // Viewport follows the dynamic resolution render area.
     VkDynamicState dynamicStates[] = {
         VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_LINE_WIDTH
+        VK_DYNAMIC_STATE_SCISSOR
     };
 
     VkPipelineDynamicStateCreateInfo dynamicState{};
     dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
     dynamicState.dynamicStateCount = 2;
     dynamicState.pDynamicStates = dynamicStates;
-    */
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -374,38 +382,12 @@ bool VulkanGraphicDriver::CreateShaderAndPipeline()
     pipelineLayoutInfo.pushConstantRangeCount = 0; // Optional
     pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
 
-    if (vkCreatePipelineLayout(m_VulkanLogicDevice, &pipelineLayoutInfo, nullptr, &m_VulkanPipelineLayout) != VK_SUCCESS) {
+    if (vkCreatePipelineLayout(m_VulkanLogicDevice, &pipelineLayoutInfo, GetVulkanAllocator(), &m_VulkanPipelineLayout) != VK_SUCCESS) {
         std::cout << "Vulkan failed to create pipeline layout.\n";
         SetErrorCode(ErrorCode::UnKnow);
         return false;
     }
 
-    VkAttachmentDescription colorAttachment{};
-    colorAttachment.format = m_VulkanSurfaceFormat.format;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass{};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-
-    VkRenderPassCreateInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-
     VkSubpassDependency dependency{};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
@@ -414,12 +396,10 @@ bool VulkanGraphicDriver::CreateShaderAndPipeline()
     dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
     dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
 
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(m_VulkanLogicDevice, &renderPassInfo, nullptr, &m_VulkanRenderPass) != VK_SUCCESS) {
-        std::cout << "Vulkan failed to create render pass.\n";
-        SetErrorCode(ErrorCode::UnKnow);
+    // MSAA color & depth come from the scene attachments, the swapchain image is the (resolve) output.
+    // Dynamic rendering binds them at record time, there is no pass object to build.
+    if (!m_SceneAttachments->UsesDynamicRendering() &&
+        !m_SceneAttachments->CreateRenderPass(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, &dependency, 1, m_VulkanRenderPass)) {
         return false;
     }
 
@@ -432,23 +412,22 @@ bool VulkanGraphicDriver::CreateShaderAndPipeline()
     pipelineInfo.pViewportState = &viewportState;
     pipelineInfo.pRasterizationState = &rasterizer;
     pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = nullptr; // Optional
+    pipelineInfo.pDepthStencilState = &depthStencil;
     pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = nullptr; // Optional
+    pipelineInfo.pDynamicState = &dynamicState;
     pipelineInfo.layout = m_VulkanPipelineLayout;
-    pipelineInfo.renderPass = m_VulkanRenderPass;
-    pipelineInfo.subpass = 0;
+    m_SceneAttachments->SetPipelineTarget(pipelineInfo, m_VulkanRenderPass);
     pipelineInfo.basePipelineHandle = VK_NULL_HANDLE; // Optional
     pipelineInfo.basePipelineIndex = -1; // Optional
 
-    if (vkCreateGraphicsPipelines(m_VulkanLogicDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_VulkanGraphicsPipeline) != VK_SUCCESS) {
+    if (vkCreateGraphicsPipelines(m_VulkanLogicDevice, VK_NULL_HANDLE, 1, &pipelineInfo, GetVulkanAllocator(), &m_VulkanGraphicsPipeline) != VK_SUCCESS) {
         std::cout << "Vulkan failed to create graphics pipeline.\n";
         SetErrorCode(ErrorCode::UnKnow);
         return false;
     }
 
-    vkDestroyShaderModule(m_VulkanLogicDevice, fragShaderModule, nullptr);
-    vkDestroyShaderModule(m_VulkanLogicDevice, vertShaderModule, nullptr);
+    vkDestroyShaderModule(m_VulkanLogicDevice, fragShaderModule, GetVulkanAllocator());
+    vkDestroyShaderModule(m_VulkanLogicDevice, vertShaderModule, GetVulkanAllocator());
     return true;
 }
 
@@ -457,20 +436,24 @@ bool VulkanGraphicDriver::CreateShaderAndPipeline()
  ****************************************************************************/
 bool VulkanGraphicDriver::CreateFrameBuffers()
 {
+    if (m_SceneAttachments->UsesDynamicRendering()) {
+        return true;
+    }
+
     m_VulkanSwapChainFramebuffers.resize(m_VulkanSwapChainImageViews.size());
     for (size_t i = 0; i < m_VulkanSwapChainImageViews.size(); i++) {
-        VkImageView attachments[] = { m_VulkanSwapChainImageViews[i] };
+        VkImageView attachments[VulkanSceneAttachments::MAX_ATTACHMENTS];
 
         VkFramebufferCreateInfo framebufferInfo{};
         framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferInfo.renderPass = m_VulkanRenderPass;
-        framebufferInfo.attachmentCount = 1;
+        framebufferInfo.attachmentCount = m_SceneAttachments->GetFramebufferAttachments(m_VulkanSwapChainImageViews[i], attachments);
         framebufferInfo.pAttachments = attachments;
         framebufferInfo.width = m_VulkanSwapExtent.width;
         framebufferInfo.height = m_VulkanSwapExtent.height;
         framebufferInfo.layers = 1;
 
-        if (vkCreateFramebuffer(m_VulkanLogicDevice, &framebufferInfo, nullptr, &m_VulkanSwapChainFramebuffers[i]) != VK_SUCCESS) {
+        if (vkCreateFramebuffer(m_VulkanLogicDevice, &framebufferInfo, GetVulkanAllocator(), &m_VulkanSwapChainFramebuffers[i]) != VK_SUCCESS) {
             std::cout << "Vulkan failed to create framebuffer.\n";
             SetErrorCode(ErrorCode::UnKnow);
             return false;
@@ -480,11 +463,12 @@ bool VulkanGraphicDriver::CreateFrameBuffers()
 }
 
 /****************************************************************************
-* Create command buffers
+* Create command buffers, one per frame in flight, recorded every frame. The
+* scene pass executes cached secondaries, recorded again only when they change
 ****************************************************************************/
 bool VulkanGraphicDriver::CreateCommandBuffers()
 {
-    m_VulkanCommandBuffers.resize(m_VulkanSwapChainFramebuffers.size());
+    m_VulkanCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -497,44 +481,168 @@ bool VulkanGraphicDriver::CreateCommandBuffers()
         SetErrorCode(ErrorCode::UnKnow);
         return false;
     }
+    return true;
+}
 
-    for (size_t i = 0; i < m_VulkanCommandBuffers.size(); i++) {
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-        beginInfo.flags = 0; // Optional
-        beginInfo.pInheritanceInfo = nullptr; // Optional
+bool VulkanGraphicDriver::RecordCommandBuffer(uint32_t imageIndex, bool capture)
+{
+    PROFILE_FUNCTION();
+    VkCommandBuffer commandBuffer = m_VulkanCommandBuffers[m_CurrentFrame];
+    vkResetCommandBuffer(commandBuffer, 0);
 
-        if (vkBeginCommandBuffer(m_VulkanCommandBuffers[i], &beginInfo) != VK_SUCCESS) {
-            std::cout << "Vulkan failed to begin recording command buffer.\n";
-            SetErrorCode(ErrorCode::UnKnow);
-            return false;
-        }
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = nullptr; // Optional
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to begin recording command buffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
     }
 
-    for (size_t i = 0; i < m_VulkanCommandBuffers.size(); i++)
-    {
+    if (nullptr != m_ParticleSystem) {
+        // The sample scene has no camera, the fountain is seen from a fixed one.
+        float aspect = (float)m_VulkanSwapExtent.width / (float)std::max(m_VulkanSwapExtent.height, 1u);
+        glm::vec3 eye(0.0f, 4.0f, 12.0f);
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), aspect, 0.1f, 100.0f);
+        projection[1][1] *= -1.0f;
+
+        ParticleFrameParams params;
+        params.m_ViewProjection = projection * glm::lookAt(eye, glm::vec3(0.0f, 3.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        params.m_CameraPosition = eye;
+        params.m_DeltaTime = (float)std::min(std::max(m_FrameInputTime - m_ParticleInputTime, 0.0), PARTICLE_MAX_TIMESTEP);
+        params.m_EmitterPosition = glm::vec3(0.0f, 0.5f, 0.0f);
+        params.m_EmitterRadius = 0.2f;
+        params.m_EmitterVelocity = glm::vec3(0.0f, 8.0f, 0.0f);
+        params.m_VelocitySpread = 3.0f;
+        // About the capacity alive at the mean lifetime.
+        params.m_EmitRate = (float)m_ParticleSystem->GetCapacity() / 2.5f;
+        m_ParticleSystem->RecordSimulate(commandBuffer, (uint32_t)m_CurrentFrame, params);
+        m_ParticleInputTime = m_FrameInputTime;
+    }
+
+    /****************************************************************************
+     * Scene pass, all its contents come from cached secondaries
+     ****************************************************************************/
+    VkViewport viewport = { 0.0f, 0.0f, (float)m_VulkanSwapExtent.width, (float)m_VulkanSwapExtent.height, 0.0f, 1.0f };
+    VkRect2D scissor = { { 0, 0 }, m_VulkanSwapExtent };
+    VkRenderPass renderPass = m_VulkanRenderPass;
+    if (m_DynamicResolutionEnabled) {
+        m_DynamicResolution->BeginScene(commandBuffer, (uint32_t)m_CurrentFrame, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        m_DynamicResolution->GetSceneViewport(viewport, scissor);
+        renderPass = m_DynamicResolution->GetRenderPass();
+    } else if (m_SceneAttachments->UsesDynamicRendering()) {
+        // Chained to the acquire semaphore wait, which is at the color output stage.
+        m_SceneAttachments->CmdBeginRendering(commandBuffer, m_VulkanSwapChainImages[imageIndex], m_VulkanSwapChainImageViews[imageIndex],
+            m_VulkanSwapExtent, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, true);
+    } else {
         VkRenderPassBeginInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
         renderPassInfo.renderPass = m_VulkanRenderPass;
-        renderPassInfo.framebuffer = m_VulkanSwapChainFramebuffers[i];
+        renderPassInfo.framebuffer = m_VulkanSwapChainFramebuffers[imageIndex];
         renderPassInfo.renderArea.offset = { 0, 0 };
         renderPassInfo.renderArea.extent = m_VulkanSwapExtent;
 
-        VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
+        VkClearValue clearValues[VulkanSceneAttachments::MAX_ATTACHMENTS];
+        renderPassInfo.clearValueCount = m_SceneAttachments->GetClearValues(clearValues);
+        renderPassInfo.pClearValues = clearValues;
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+    }
 
-        vkCmdBeginRenderPass(m_VulkanCommandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(m_VulkanCommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_VulkanGraphicsPipeline);
-        vkCmdDraw(m_VulkanCommandBuffers[i], 3, 1, 0, 0);
-        vkCmdEndRenderPass(m_VulkanCommandBuffers[i]);
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    m_SceneAttachments->SetInheritanceTarget(inheritance, renderPass);
 
-        if (vkEndCommandBuffer(m_VulkanCommandBuffers[i]) != VK_SUCCESS) {
-            std::cout << "Vulkan failed to record command buffer.\n";
-            SetErrorCode(ErrorCode::UnKnow);
+    // Secondaries inherit no dynamic state, each sets the viewport, so it's part of every pass's content.
+    uint64_t targetHash = HashCommandValue(HashCommandValue(COMMAND_HASH_SEED, viewport), scissor);
+    auto setViewport = [&viewport, &scissor](VkCommandBuffer secondary) {
+        vkCmdSetViewport(secondary, 0, 1, &viewport);
+        vkCmdSetScissor(secondary, 0, 1, &scissor);
+    };
+
+    VkCommandBuffer secondaries[ScenePass_Count];
+    uint32_t secondaryCount = 0;
+#if PROFILER_ENABLED
+    CommandCacheStatistics cacheBefore = m_CommandCache->GetStatistics();
+#endif
+    secondaries[secondaryCount++] = m_CommandCache->Acquire(ScenePass_Background, (uint32_t)m_CurrentFrame,
+        HashCommandValue(targetHash, m_VulkanGraphicsPipeline), inheritance, [&](VkCommandBuffer secondary) {
+            setViewport(secondary);
+            vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, m_VulkanGraphicsPipeline);
+            vkCmdDraw(secondary, 3, 1, 0, 0);
+        });
+    // Instance data is uploaded whatever happens, the draws only when the list changed.
+    m_DrawBatcher->Prepare();
+    secondaries[secondaryCount++] = m_CommandCache->Acquire(ScenePass_Batches, (uint32_t)m_CurrentFrame,
+        HashCommandValue(targetHash, m_DrawBatcher->GetDrawListHash()), inheritance, [&](VkCommandBuffer secondary) {
+            setViewport(secondary);
+            m_DrawBatcher->RecordDraws(secondary);
+        });
+    if (nullptr != m_ParticleSystem) {
+        secondaries[secondaryCount++] = m_CommandCache->Acquire(ScenePass_Particles, (uint32_t)m_CurrentFrame,
+            HashCommandValue(targetHash, m_ParticleSystem->GetDrawHash()), inheritance, [&](VkCommandBuffer secondary) {
+                setViewport(secondary);
+                m_ParticleSystem->RecordDraw(secondary);
+            });
+    }
+    for (uint32_t i = 0; i < secondaryCount; i++) {
+        if (VK_NULL_HANDLE == secondaries[i]) {
             return false;
         }
     }
+    vkCmdExecuteCommands(commandBuffer, secondaryCount, secondaries);
+#if PROFILER_ENABLED
+    PROFILE_COUNTER("ReusedSecondaries", m_CommandCache->GetStatistics().m_Reused - cacheBefore.m_Reused);
+    PROFILE_COUNTER("RecordedSecondaries", m_CommandCache->GetStatistics().m_Recorded - cacheBefore.m_Recorded);
+#endif
+
+    if (m_DynamicResolutionEnabled && nullptr != m_TemporalUpscaler) {
+        m_DynamicResolution->EndScene(commandBuffer, (uint32_t)m_CurrentFrame);
+        // The scene's camera never moves, the unjittered view projection only has to stay the same.
+        VkImage target = m_DynamicResolution->GetTargetImage();
+        CmdImageBarrier(commandBuffer, target, VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        TemporalUpscaleFrame frame = { m_DynamicResolution->GetRenderExtent(), glm::mat4(1.0f) };
+        m_TemporalUpscaler->Record(commandBuffer, (uint32_t)m_CurrentFrame, frame, m_VulkanSwapChainImages[imageIndex],
+            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+        // Back to where EndScene() leaves it, the next scene pass waits on the transfer stage.
+        CmdImageBarrier(commandBuffer, target, VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, 0);
+    } else if (m_DynamicResolutionEnabled) {
+        m_DynamicResolution->EndScene(commandBuffer, (uint32_t)m_CurrentFrame);
+        m_DynamicResolution->Upscale(commandBuffer, m_VulkanSwapChainImages[imageIndex], m_VulkanSwapExtent);
+    } else if (m_SceneAttachments->UsesDynamicRendering()) {
+        m_SceneAttachments->CmdEndRendering(commandBuffer, m_VulkanSwapChainImages[imageIndex], VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+    } else {
+        vkCmdEndRenderPass(commandBuffer);
+    }
+
+    // The readback submit copies it & puts it back to PRESENT_SRC.
+    if (capture) {
+        CmdImageBarrier(commandBuffer, m_VulkanSwapChainImages[imageIndex], VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    }
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to record command buffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+#if PROFILER_ENABLED
+    const DrawBatchStatistics& statistics = m_DrawBatcher->GetStatistics();
+    PROFILE_COUNTER("BatchedObjects", statistics.m_Objects);
+    PROFILE_COUNTER("DrawCalls", statistics.m_DrawCalls);
+    PROFILE_COUNTER("DirtyBatches", statistics.m_DirtyBatches);
+    PROFILE_COUNTER("BatchUploadBytes", statistics.m_UploadedBytes);
+#endif
     return true;
 }
 
@@ -559,6 +667,7 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
     /*******************************************************************************************
     * Create instance
     *******************************************************************************************/
+    uint32_t instanceApiVersion = GetInstanceApiVersion();
     {
         VkApplicationInfo appInfo{};
         appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -566,7 +675,7 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
         appInfo.applicationVersion = VK_MAKE_VERSION(0, 1, 0);
         appInfo.pEngineName = "Kaleidoscope";
         appInfo.engineVersion = VK_MAKE_VERSION(0, 1, 0);
-        appInfo.apiVersion = VK_API_VERSION_1_0;
+        appInfo.apiVersion = instanceApiVersion;
 
         VkInstanceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -592,7 +701,7 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
             createInfo.enabledLayerCount = 0;
         }
 
-        VkResult result = vkCreateInstance(&createInfo, nullptr, &m_VulkanInstance);
+        VkResult result = vkCreateInstance(&createInfo, GetVulkanAllocator(), &m_VulkanInstance);
         if (VK_SUCCESS != result)
         {
             std::cout << "Vulkan instance creation failed.\n";
@@ -601,7 +710,7 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
         }
     }
 
-    if (glfwCreateWindowSurface(m_VulkanInstance, initialInfo.m_Window, nullptr, &m_VulkanWindowSurface) != VK_SUCCESS) {
+    if (glfwCreateWindowSurface(m_VulkanInstance, initialInfo.m_Window, GetVulkanAllocator(), &m_VulkanWindowSurface) != VK_SUCCESS) {
         std::cout << "Vulkan window surface creation failed.\n";
         SetErrorCode(ErrorCode::Vulkan_Invalid_WindowSurface);
         return false;
@@ -611,7 +720,6 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
      * Pick physical device & queue family & logic device and queue
      *******************************************************************************************/
     {
-        const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
         uint32_t deviceCount = 0;
         vkEnumeratePhysicalDevices(m_VulkanInstance, &deviceCount, nullptr);
         if (deviceCount <= 0) {
@@ -623,29 +731,40 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
         std::vector<VkPhysicalDevice> devices(deviceCount);
         vkEnumeratePhysicalDevices(m_VulkanInstance, &deviceCount, devices.data());
 
-        int maxDeviceScore = 1; //SKIP '0' score
-        //assert(VK_NULL_HANDLE==m_VulkanPhysicalDevice);
+        int maxDeviceScore = 0; // SKIP '0' score
+        uint32_t deviceQueueFamily = UINT32_MAX;
         for (const auto& device : devices) {
-            uint32_t extensionCount;
-            vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
-
-            std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-            vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
-
-            std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
-            for (const auto& extension : availableExtensions) {
-                requiredExtensions.erase(extension.extensionName);
+            VulkanDeviceCapabilities capabilities;
+            if (!QueryDeviceCapabilities(device, instanceApiVersion, capabilities) || !capabilities.m_Swapchain) {
+                continue;
             }
 
-            // swapchain extension supported
-            if (!requiredExtensions.empty()) {
+            // Only devices with a family that both draws & presents to the surface are rated at all.
+            uint32_t queueFamily = UINT32_MAX;
+            uint32_t queueFamilyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+            std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+            for (uint32_t qfid = 0; qfid < queueFamilyCount && UINT32_MAX == queueFamily; ++qfid) {
+                if (0 == queueFamilies[qfid].queueCount || !(queueFamilies[qfid].queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+                    continue;
+                }
+                VkBool32 presentSupport = VK_FALSE;
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, qfid, m_VulkanWindowSurface, &presentSupport);
+                if (VK_TRUE == presentSupport) {
+                    queueFamily = qfid;
+                }
+            }
+            if (UINT32_MAX == queueFamily) {
                 continue;
             }
 
-            int deviceScore = RateDeviceSuitabilityScore(device);
+            int deviceScore = RateDeviceCapabilities(capabilities);
             if (deviceScore > maxDeviceScore) {
+                maxDeviceScore = deviceScore;
                 m_VulkanPhysicalDevice = device;
-                break;
+                m_DeviceCapabilities = capabilities;
+                deviceQueueFamily = queueFamily;
             }
         }
 
@@ -661,34 +780,9 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
         std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
         vkGetPhysicalDeviceQueueFamilyProperties(m_VulkanPhysicalDevice, &queueFamilyCount, queueFamilies.data());
 
-        for (uint32_t qfid = 0; qfid < queueFamilyCount; ++qfid) {
-            if (queueFamilies[qfid].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                m_VulkanGraphicQueueFamilyID = qfid;
-            }
-
-            VkBool32 presentSupport = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(m_VulkanPhysicalDevice, qfid, m_VulkanWindowSurface, &presentSupport);
-            if (presentSupport) {
-                m_VulkanPresentQueueFamilyID = qfid;
-            }
-
-            if ((UINT32_MAX != m_VulkanGraphicQueueFamilyID) && (UINT32_MAX != m_VulkanPresentQueueFamilyID)) {
-                break;
-            }
-        }
-
-        if ((UINT32_MAX == m_VulkanGraphicQueueFamilyID)) {
-            std::cout << "Vulkan physical device doesn't have graphic queue family.\n";
-            SetErrorCode(ErrorCode::Vulkan_No_GraphicQueueFamily);
-            return false;
-        }
-
-        if ((UINT32_MAX == m_VulkanPresentQueueFamilyID))
-        {
-            std::cout << "Vulkan physical device doesn't have present queue family.\n";
-            SetErrorCode(ErrorCode::Vulkan_No_PresentQueueFamily);
-            return false;
-        }
+        // The family the device was rated for, drawing & presenting from one queue needs no ownership transfers.
+        m_VulkanGraphicQueueFamilyID = deviceQueueFamily;
+        m_VulkanPresentQueueFamilyID = deviceQueueFamily;
 
         uint32_t formatCount;
         vkGetPhysicalDeviceSurfaceFormatsKHR(m_VulkanPhysicalDevice, m_VulkanWindowSurface, &formatCount, nullptr);
@@ -707,12 +801,16 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         float queuePriority = 1.0f;
+        // Readbacks go on a second queue of the graphics family when there is one, so frame & copy submits
+        // don't serialize. A transfer only family would need an ownership transfer of the swapchain image.
+        float graphicQueuePriorities[2] = { 1.0f, 0.5f };
+        uint32_t graphicQueueCount = std::min(queueFamilies[m_VulkanGraphicQueueFamilyID].queueCount, 2u);
         {
             VkDeviceQueueCreateInfo queueCreateInfo{};
             queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
             queueCreateInfo.queueFamilyIndex = m_VulkanGraphicQueueFamilyID;
-            queueCreateInfo.queueCount = 1;
-            queueCreateInfo.pQueuePriorities = &queuePriority;
+            queueCreateInfo.queueCount = graphicQueueCount;
+            queueCreateInfo.pQueuePriorities = graphicQueuePriorities;
             queueCreateInfos.push_back(queueCreateInfo);
         }
         if(m_VulkanPresentQueueFamilyID!= m_VulkanGraphicQueueFamilyID)
@@ -725,19 +823,33 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
             queueCreateInfos.push_back(queueCreateInfo);
         }
 
-        VkPhysicalDeviceFeatures deviceFeatures{};
+        /****************************************************************************
+         * Pick the fastest render path of the device & enable what it uses
+         ****************************************************************************/
+        ChooseRenderPath(m_DeviceCapabilities, true, m_RenderPath);
+        m_PresentWaitSupported = m_RenderPath.m_PresentWait;
+        std::cout << "Vulkan render path: " << DescribeRenderPath(m_DeviceCapabilities, m_RenderPath) << "\n";
+
+        // Built in place, the feature structures link to each other.
+        VulkanDeviceFeatureChain* featureChain = New<VulkanDeviceFeatureChain>(MemoryTag::GraphicDriver);
+        BuildDeviceFeatureChain(m_DeviceCapabilities, m_RenderPath, *featureChain);
+        std::vector<const char*> enabledExtensions = featureChain->m_Extensions;
+        enabledExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pNext = featureChain->GetCreateNext();
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-        createInfo.pEnabledFeatures = &deviceFeatures;
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.pEnabledFeatures = nullptr;
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(enabledExtensions.size());
+        createInfo.ppEnabledExtensionNames = enabledExtensions.data();
         // Don't set validateLayer
         createInfo.enabledLayerCount = 0;
 
-        if (vkCreateDevice(m_VulkanPhysicalDevice, &createInfo, nullptr, &m_VulkanLogicDevice) != VK_SUCCESS) {
+        VkResult deviceResult = vkCreateDevice(m_VulkanPhysicalDevice, &createInfo, GetVulkanAllocator(), &m_VulkanLogicDevice);
+        Delete(featureChain);
+        if (deviceResult != VK_SUCCESS) {
             std::cout << "Vulkan failed to create logic device.\n";
             SetErrorCode(ErrorCode::Vulkan_Invalid_LogicDevice);
             return false;
@@ -745,6 +857,15 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
 
         vkGetDeviceQueue(m_VulkanLogicDevice, m_VulkanGraphicQueueFamilyID, 0, &m_VulkanGraphicQueue);
         vkGetDeviceQueue(m_VulkanLogicDevice, m_VulkanPresentQueueFamilyID, 0, &m_VulkanPresentQueue);
+        vkGetDeviceQueue(m_VulkanLogicDevice, m_VulkanGraphicQueueFamilyID, graphicQueueCount - 1, &m_VulkanReadbackQueue);
+
+#if defined(VK_KHR_present_wait)
+        if (m_PresentWaitSupported) {
+            m_vkWaitForPresentKHR = (PFN_vkWaitForPresentKHR)vkGetDeviceProcAddr(m_VulkanLogicDevice, "vkWaitForPresentKHR");
+            m_PresentWaitSupported = (nullptr != m_vkWaitForPresentKHR);
+        }
+#endif
+        std::cout << "Vulkan present: " << GetPresentModePolicyName(m_PresentModePolicy) << " policy, present wait " << m_PresentWaitSupported << "\n";
 
 
         // swapchain detail supported
@@ -760,7 +881,7 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
         }
 
         m_VulkanSurfaceFormat = ChooseSwapSurfaceFormat(m_SurfaceFormats);
-        m_VulkanSwapPresentMode = ChooseSwapPresentMode(m_PresentModes);
+        m_VulkanSwapPresentMode = ChooseSwapPresentMode(m_PresentModes, m_PresentModePolicy);
     }
 
     /****************************************************************************
@@ -770,9 +891,9 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
         VkCommandPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         poolInfo.queueFamilyIndex = m_VulkanGraphicQueueFamilyID;
-        poolInfo.flags = 0; // Optional
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
-        if (vkCreateCommandPool(m_VulkanLogicDevice, &poolInfo, nullptr, &m_VulkanCommandPool) != VK_SUCCESS) {
+        if (vkCreateCommandPool(m_VulkanLogicDevice, &poolInfo, GetVulkanAllocator(), &m_VulkanCommandPool) != VK_SUCCESS) {
             std::cout << "Vulkan failed to create command pool.\n";
             SetErrorCode(ErrorCode::Vulkan_Invalid_CommandPool);
             return false;
@@ -783,16 +904,48 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
     uint32_t h = (uint32_t)initialInfo.m_Height;
 
     VULKAN_DRIVER_CHECK_FUN(CreateSwapChain(w,h));
+
+    m_SceneAttachments = New<VulkanSceneAttachments>(MemoryTag::GraphicDriver);
+    VULKAN_DRIVER_CHECK_FUN(m_SceneAttachments->Create(m_VulkanLogicDevice, m_VulkanPhysicalDevice, m_VulkanSurfaceFormat.format, SceneAttachmentSettings()));
+    // Falls back to render pass & framebuffer objects when the entry points are missing.
+    if (m_RenderPath.m_DynamicRendering && !m_SceneAttachments->EnableDynamicRendering(m_RenderPath.m_Synchronization2)) {
+        std::cout << "Vulkan dynamic rendering entry points missing, using render passes.\n";
+        m_RenderPath.m_DynamicRendering = false;
+    }
+    VULKAN_DRIVER_CHECK_FUN(m_SceneAttachments->CreateImages(m_VulkanSwapExtent));
+
     VULKAN_DRIVER_CHECK_FUN(CreateShaderAndPipeline());
     VULKAN_DRIVER_CHECK_FUN(CreateFrameBuffers());
     VULKAN_DRIVER_CHECK_FUN(CreateCommandBuffers());
 
+    // Kept across swapchain recreations, which invalidate it.
+    m_CommandCache = New<VulkanCommandCache>(MemoryTag::GraphicDriver);
+    VULKAN_DRIVER_CHECK_FUN(m_CommandCache->Create(m_VulkanLogicDevice, m_VulkanCommandPool, MAX_FRAMES_IN_FLIGHT, ScenePass_Count));
+
+    m_FrameRing = New<VulkanFrameRing>(MemoryTag::GraphicDriver);
+    VULKAN_DRIVER_CHECK_FUN(m_FrameRing->Create(m_VulkanLogicDevice, m_VulkanPhysicalDevice, MAX_FRAMES_IN_FLIGHT, FRAME_RING_BYTES_PER_FRAME));
+
+    m_DrawBatcher = New<VulkanDrawBatcher>(MemoryTag::GraphicDriver);
+    VULKAN_DRIVER_CHECK_FUN(m_DrawBatcher->Create(m_VulkanLogicDevice, m_FrameRing, MAX_BATCHED_INSTANCES));
+
+    // One more slot than frames in flight, capturing every frame never waits for a copy.
+    m_Readback = New<VulkanReadback>(MemoryTag::GraphicDriver);
+    VULKAN_DRIVER_CHECK_FUN(m_Readback->Create(m_VulkanLogicDevice, m_VulkanPhysicalDevice, m_VulkanGraphicQueueFamilyID, m_VulkanReadbackQueue, MAX_FRAMES_IN_FLIGHT + 1));
+
+    // Optional, the scene renders straight into the swapchain when it can't be used.
+    m_DynamicResolution = New<VulkanDynamicResolution>(MemoryTag::GraphicDriver);
+    m_DynamicResolutionSupported = (m_SurfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) &&
+        m_DynamicResolution->Create(m_VulkanLogicDevice, m_VulkanPhysicalDevice, m_VulkanGraphicQueueFamilyID, MAX_FRAMES_IN_FLIGHT, m_VulkanSurfaceFormat.format, m_SceneAttachments);
+    m_DynamicResolutionEnabled = m_DynamicResolutionSupported && m_DynamicResolutionRequested && m_DynamicResolution->CreateTarget(m_VulkanSwapExtent);
+    std::cout << "Vulkan dynamic resolution " << (m_DynamicResolutionEnabled ? "enabled" : (m_DynamicResolutionSupported ? "disabled" : "unavailable")) << ".\n";
+
     /****************************************************************************
     * Create synchronization objects
     ****************************************************************************/
     {
         m_ImageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
         m_RenderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+        m_ReadbackFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
         m_InFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
         m_InFlightImageFences.resize(m_VulkanSwapChainImages.size(), VK_NULL_HANDLE);
 
@@ -805,9 +958,10 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
 
         for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
         {
-            if (vkCreateSemaphore(m_VulkanLogicDevice, &semaphoreInfo, nullptr, &m_ImageAvailableSemaphores[i]) != VK_SUCCESS ||
-                vkCreateSemaphore(m_VulkanLogicDevice, &semaphoreInfo, nullptr, &m_RenderFinishedSemaphores[i]) != VK_SUCCESS ||
-                vkCreateFence(m_VulkanLogicDevice, &fenceInfo, nullptr, &m_InFlightFences[i]) != VK_SUCCESS)
+            if (vkCreateSemaphore(m_VulkanLogicDevice, &semaphoreInfo, GetVulkanAllocator(), &m_ImageAvailableSemaphores[i]) != VK_SUCCESS ||
+                vkCreateSemaphore(m_VulkanLogicDevice, &semaphoreInfo, GetVulkanAllocator(), &m_RenderFinishedSemaphores[i]) != VK_SUCCESS ||
+                vkCreateSemaphore(m_VulkanLogicDevice, &semaphoreInfo, GetVulkanAllocator(), &m_ReadbackFinishedSemaphores[i]) != VK_SUCCESS ||
+                vkCreateFence(m_VulkanLogicDevice, &fenceInfo, GetVulkanAllocator(), &m_InFlightFences[i]) != VK_SUCCESS)
             {
 
                 std::cout << "Vulkan failed to create semaphores.";
@@ -821,16 +975,63 @@ bool VulkanGraphicDriver::StartUp(const GraphicInitialInfo& initialInfo)
     return true;
 }
 
+void VulkanGraphicDriver::GetMeshletCullerCreateInfo(VulkanMeshletCullerCreateInfo& createInfo) const
+{
+    createInfo.m_Device = m_VulkanLogicDevice;
+    createInfo.m_PhysicalDevice = m_VulkanPhysicalDevice;
+    createInfo.m_MeshShaderSupported = m_RenderPath.m_MeshShaders;
+    createInfo.m_MultiDrawIndirectSupported = m_RenderPath.m_MultiDrawIndirect;
+    createInfo.m_DrawIndirectCountSupported = m_RenderPath.m_DrawIndirectCount;
+    createInfo.m_DrawIndirectFirstInstanceSupported = m_RenderPath.m_DrawIndirectFirstInstance;
+}
+
 bool VulkanGraphicDriver::DrawFrame()
 {
+    PROFILE_FUNCTION();
     if (m_SkipFrame) {
         return true;
     }
 
-    vkWaitForFences(m_VulkanLogicDevice, 1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, UINT64_MAX);
+    {
+        PROFILE_ZONE("WaitForFrameFence");
+        vkWaitForFences(m_VulkanLogicDevice, 1, &m_InFlightFences[m_CurrentFrame], VK_TRUE, UINT64_MAX);
+    }
+    // GPU is done with this frame slot, its transient data can be overwritten.
+    m_FrameRing->BeginFrame((uint32_t)m_CurrentFrame);
+    m_Readback->Update(m_FrameCount);
+    DrainRenderRequests();
+    if (m_ContinuousCaptureCallback && 0 == (m_FrameCount % READBACK_REPORT_INTERVAL)) {
+        std::cout << "Readback: " << m_Readback->GetThroughputMBps() << " MB/s, " << m_Readback->GetCompletedCount() << " captured, "
+            << m_Readback->GetDroppedCount() << " dropped.\n";
+    }
+    if (m_DynamicResolutionEnabled) {
+        m_DynamicResolution->BeginFrame((uint32_t)m_CurrentFrame);
+    }
+    // After the scale was adjusted, the jitter phases follow the render extent.
+    if (nullptr != m_TemporalUpscaler) {
+        m_TemporalUpscaler->CollectGpuTiming((uint32_t)m_CurrentFrame);
+        m_DynamicResolution->SetJitter(m_TemporalUpscaler->GetJitter(m_DynamicResolution->GetRenderExtent()));
+    }
+    if (nullptr != m_ParticleSystem) {
+        m_ParticleSystem->CollectGpuTiming((uint32_t)m_CurrentFrame);
+    }
+
+    if (m_SwapChainDirty) {
+        std::cout << "Vulkan present mode policy " << GetPresentModePolicyName(m_PresentModePolicy) << ", "
+            << (uint32_t)m_SceneAttachments->GetSamples() << "x MSAA, recreating swapchain.\n";
+        if (!RecreateSwapChain(m_VulkanSwapExtent.width, m_VulkanSwapExtent.height)) {
+            return false;
+        }
+    }
+    // Low latency starts a frame only once the one before the frames in flight is on screen.
+    WaitForPreviousPresent();
 
     uint32_t imageIndex = 0;
-    VkResult result = vkAcquireNextImageKHR(m_VulkanLogicDevice, m_VulkanSwapChain, UINT64_MAX, m_ImageAvailableSemaphores[m_CurrentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult result = VK_SUCCESS;
+    {
+        PROFILE_ZONE("AcquireNextImage");
+        result = vkAcquireNextImageKHR(m_VulkanLogicDevice, m_VulkanSwapChain, UINT64_MAX, m_ImageAvailableSemaphores[m_CurrentFrame], VK_NULL_HANDLE, &imageIndex);
+    }
     if (result == VK_ERROR_OUT_OF_DATE_KHR) {
         std::cout << "Vulkan skip a frame draw because of window resize happened.\n";
         SetErrorCode(ErrorCode::UnKnow);
@@ -843,11 +1044,22 @@ bool VulkanGraphicDriver::DrawFrame()
 
     // Check if a previous frame is using this image (i.e. there is its fence to wait on)
     if (m_InFlightImageFences[imageIndex] != VK_NULL_HANDLE) {
+        PROFILE_ZONE("WaitForImageFence");
         vkWaitForFences(m_VulkanLogicDevice, 1, &m_InFlightImageFences[imageIndex], VK_TRUE, UINT64_MAX);
     }
     // Mark the image as now being in use by this frame
     m_InFlightImageFences[imageIndex] = m_InFlightFences[m_CurrentFrame];
 
+    // A dropped one-shot capture is retried next frame, continuous captures just skip the frame.
+    bool capture = false;
+    if (m_CaptureSupported && (m_CaptureCallback || m_ContinuousCaptureCallback)) {
+        capture = m_Readback->BeginCapture(m_VulkanSwapExtent);
+    }
+
+    if (!RecordCommandBuffer(imageIndex, capture)) {
+        return false;
+    }
+
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
@@ -857,7 +1069,7 @@ bool VulkanGraphicDriver::DrawFrame()
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_VulkanCommandBuffers[imageIndex];
+    submitInfo.pCommandBuffers = &m_VulkanCommandBuffers[m_CurrentFrame];
 
     VkSemaphore signalSemaphores[] = { m_RenderFinishedSemaphores[m_CurrentFrame] };
     submitInfo.signalSemaphoreCount = 1;
@@ -865,8 +1077,25 @@ bool VulkanGraphicDriver::DrawFrame()
 
     vkResetFences(m_VulkanLogicDevice, 1, &m_InFlightFences[m_CurrentFrame]);
 
-    if (vkQueueSubmit(m_VulkanGraphicQueue, 1, &submitInfo, m_InFlightFences[m_CurrentFrame]) != VK_SUCCESS) {
-        std::cout << "Vulkan failed to submit draw command buffer.\n";
+    {
+        PROFILE_ZONE("QueueSubmit");
+        if (vkQueueSubmit(m_VulkanGraphicQueue, 1, &submitInfo, m_InFlightFences[m_CurrentFrame]) != VK_SUCCESS) {
+            std::cout << "Vulkan failed to submit draw command buffer.\n";
+        }
+    }
+
+    if (capture) {
+        ReadbackRequest request;
+        request.m_Image = m_VulkanSwapChainImages[imageIndex];
+        request.m_Extent = m_VulkanSwapExtent;
+        request.m_Format = m_VulkanSurfaceFormat.format;
+        request.m_FinalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        request.m_Callback = m_CaptureCallback ? m_CaptureCallback : m_ContinuousCaptureCallback;
+        if (m_Readback->Submit(request, m_FrameCount, m_RenderFinishedSemaphores[m_CurrentFrame], m_ReadbackFinishedSemaphores[m_CurrentFrame])) {
+            // Present waits for the copy instead of the frame.
+            signalSemaphores[0] = m_ReadbackFinishedSemaphores[m_CurrentFrame];
+            m_CaptureCallback = nullptr;
+        }
     }
 
     VkPresentInfoKHR presentInfo{};
@@ -880,10 +1109,32 @@ bool VulkanGraphicDriver::DrawFrame()
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = nullptr; // Optional
 
-    vkQueuePresentKHR(m_VulkanPresentQueue, &presentInfo);
-    vkQueueWaitIdle(m_VulkanPresentQueue);
+    uint64_t presentID = m_PresentID + 1;
+#if defined(VK_KHR_present_id)
+    VkPresentIdKHR presentIdInfo{};
+    if (m_PresentWaitSupported) {
+        presentIdInfo.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        presentIdInfo.swapchainCount = 1;
+        presentIdInfo.pPresentIds = &presentID;
+        presentInfo.pNext = &presentIdInfo;
+    }
+#endif
+    m_PresentInputTimes[presentID % PRESENT_HISTORY] = m_FrameInputTime;
+    m_PresentID = presentID;
+
+    {
+        PROFILE_ZONE("QueuePresent");
+        vkQueuePresentKHR(m_VulkanPresentQueue, &presentInfo);
+        if (PresentModePolicy::LowLatency == m_PresentModePolicy && !m_PresentWaitSupported) {
+            // Without present wait the best estimate is the present queue draining, only worth its stall for low latency.
+            vkQueueWaitIdle(m_VulkanPresentQueue);
+            m_PresentLatency = (glfwGetTime() - m_FrameInputTime) * 1000.0;
+            PROFILE_COUNTER("InputToPresentMs", m_PresentLatency);
+        }
+    }
 
     m_CurrentFrame = (m_CurrentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    m_FrameCount++;
     return true;
 }
 
@@ -900,21 +1151,202 @@ bool VulkanGraphicDriver::ResizeWindow(const GraphicResizeInfo& resizeInfo)
         return true;
     }
 
+    return RecreateSwapChain((uint32_t)resizeInfo.m_NewWidth, (uint32_t)resizeInfo.m_NewHeight);
+}
+
+bool VulkanGraphicDriver::RecreateSwapChain(uint32_t width, uint32_t height)
+{
     vkDeviceWaitIdle(m_VulkanLogicDevice);
 
+    // The secondaries were recorded with the pipelines & render pass destroyed below, handles the new ones may reuse.
+    m_CommandCache->Invalidate();
     DestroyCommandBuffers();
     DestroyFrameBuffers();
     DestroyShaderAndPipeline();
     DestroySwapChain();
+    // Its framebuffer references the scene attachment images, the temporal resolve samples its target.
+    if (nullptr != m_TemporalUpscaler) {
+        m_TemporalUpscaler->DestroyTargets();
+    }
+    if (m_DynamicResolutionEnabled) {
+        m_DynamicResolution->DestroyTarget();
+    }
 
-    CreateSwapChain((uint32_t)resizeInfo.m_NewWidth, (uint32_t)resizeInfo.m_NewHeight);
-    CreateShaderAndPipeline();
-    CreateFrameBuffers();
-    CreateCommandBuffers();
+    m_VulkanSwapPresentMode = ChooseSwapPresentMode(m_PresentModes, m_PresentModePolicy);
+    m_SwapChainDirty = false;
+    // Ids restart with the new swapchain.
+    m_PresentID = 0;
 
+    VULKAN_DRIVER_CHECK_FUN(CreateSwapChain(width, height));
+    // The image count may change, and after the idle wait no image is in use by a frame anymore.
+    m_InFlightImageFences.assign(m_VulkanSwapChainImages.size(), VK_NULL_HANDLE);
+    VULKAN_DRIVER_CHECK_FUN(m_SceneAttachments->CreateImages(m_VulkanSwapExtent));
+    VULKAN_DRIVER_CHECK_FUN(CreateShaderAndPipeline());
+    VULKAN_DRIVER_CHECK_FUN(CreateFrameBuffers());
+    VULKAN_DRIVER_CHECK_FUN(CreateCommandBuffers());
+
+    m_DynamicResolutionEnabled = m_DynamicResolutionSupported && m_DynamicResolutionRequested && m_DynamicResolution->CreateTarget(m_VulkanSwapExtent);
+    UpdateTemporalUpscaler();
+    UpdateParticleSystem();
     return true;
 }
 
+void VulkanGraphicDriver::UpdateTemporalUpscaler()
+{
+    bool enabled = m_TemporalUpscalingRequested && m_DynamicResolutionEnabled;
+    if (enabled && nullptr == m_TemporalUpscaler) {
+        // No depth motion: the swapchain scene has no camera & its depth is transient.
+        VulkanTemporalUpscalerCreateInfo createInfo;
+        createInfo.m_Device = m_VulkanLogicDevice;
+        createInfo.m_PhysicalDevice = m_VulkanPhysicalDevice;
+        createInfo.m_PipelineCache = VK_NULL_HANDLE;
+        createInfo.m_FrameRing = m_FrameRing;
+        createInfo.m_QueueFamilyIndex = m_VulkanGraphicQueueFamilyID;
+        createInfo.m_FramesInFlight = MAX_FRAMES_IN_FLIGHT;
+        createInfo.m_DepthMotion = false;
+        m_TemporalUpscaler = New<VulkanTemporalUpscaler>(MemoryTag::GraphicDriver);
+        enabled = m_TemporalUpscaler->Create(createInfo);
+    }
+    if (enabled) {
+        enabled = m_TemporalUpscaler->CreateTargets(m_DynamicResolution->GetTargetExtent(), m_VulkanSwapExtent,
+            m_DynamicResolution->GetTargetView(), VK_NULL_HANDLE);
+    }
+    if (!enabled && nullptr != m_TemporalUpscaler) {
+        m_TemporalUpscaler->Destroy();
+        Delete(m_TemporalUpscaler);
+        m_TemporalUpscaler = nullptr;
+    }
+    // The frame after a recreation was begun with the previous setup.
+    if (nullptr != m_DynamicResolution) {
+        m_DynamicResolution->SetJitter(enabled ? m_TemporalUpscaler->GetJitter(m_DynamicResolution->GetRenderExtent()) : glm::vec2(0.0f));
+    }
+    if (m_TemporalUpscalingRequested) {
+        std::cout << "Vulkan temporal upscaling " << (enabled ? "enabled" : "unavailable") << ".\n";
+    }
+}
+
+void VulkanGraphicDriver::UpdateParticleSystem()
+{
+    if (nullptr != m_ParticleSystem && m_ParticleSystem->GetCapacity() != m_ParticleCapacity) {
+        m_ParticleSystem->Destroy();
+        Delete(m_ParticleSystem);
+        m_ParticleSystem = nullptr;
+    }
+    if (0 == m_ParticleCapacity) {
+        return;
+    }
+
+    bool created = true;
+    if (nullptr == m_ParticleSystem) {
+        VulkanParticleSystemCreateInfo createInfo;
+        createInfo.m_Device = m_VulkanLogicDevice;
+        createInfo.m_PhysicalDevice = m_VulkanPhysicalDevice;
+        createInfo.m_PipelineCache = VK_NULL_HANDLE;
+        createInfo.m_FrameRing = m_FrameRing;
+        createInfo.m_QueueFamilyIndex = m_VulkanGraphicQueueFamilyID;
+        createInfo.m_FramesInFlight = MAX_FRAMES_IN_FLIGHT;
+        createInfo.m_Capacity = m_ParticleCapacity;
+        m_ParticleSystem = New<VulkanParticleSystem>(MemoryTag::GraphicDriver);
+        created = m_ParticleSystem->Create(createInfo);
+        m_ParticleInputTime = m_FrameInputTime;
+    }
+    // The scene pass may have changed its samples or depth.
+    if (!created || !m_ParticleSystem->CreateDrawPipeline(*m_SceneAttachments, m_VulkanRenderPass)) {
+        std::cout << "Vulkan particles unavailable.\n";
+        m_ParticleSystem->Destroy();
+        Delete(m_ParticleSystem);
+        m_ParticleSystem = nullptr;
+        m_ParticleCapacity = 0;
+    }
+}
+
+void VulkanGraphicDriver::SetParticleCapacity(uint32_t capacity)
+{
+    if (capacity != m_ParticleCapacity) {
+        m_ParticleCapacity = capacity;
+        m_SwapChainDirty = true;
+    }
+}
+
+void VulkanGraphicDriver::SetTemporalUpscaling(bool enabled)
+{
+    if (enabled != m_TemporalUpscalingRequested) {
+        m_TemporalUpscalingRequested = enabled;
+        m_SwapChainDirty = true;
+    }
+}
+
+void VulkanGraphicDriver::SetDynamicResolution(bool enabled)
+{
+    if (enabled != m_DynamicResolutionRequested) {
+        m_DynamicResolutionRequested = enabled;
+        m_SwapChainDirty = true;
+    }
+}
+
+void VulkanGraphicDriver::SetDynamicResolutionScale(float scale)
+{
+    if (nullptr == m_DynamicResolution) {
+        return;
+    }
+    DynamicResolutionSettings settings = m_DynamicResolution->GetSettings();
+    settings.m_FixedScale = std::max(scale, 0.0f);
+    m_DynamicResolution->SetSettings(settings);
+}
+
+void VulkanGraphicDriver::SetPresentModePolicy(PresentModePolicy policy)
+{
+    if (policy != m_PresentModePolicy && policy < PresentModePolicy::Count) {
+        m_PresentModePolicy = policy;
+        m_SwapChainDirty = true;
+    }
+}
+
+void VulkanGraphicDriver::SetSceneAttachmentSettings(const SceneAttachmentSettings& settings)
+{
+    // Only picks sample count & depth format, the images & passes using them are rebuilt with the swapchain.
+    m_SceneAttachments->Create(m_VulkanLogicDevice, m_VulkanPhysicalDevice, m_VulkanSurfaceFormat.format, settings);
+    m_SwapChainDirty = true;
+}
+
+bool VulkanGraphicDriver::RequestCapture(const std::function<void(const ReadbackResult&)>& callback)
+{
+    if (!m_CaptureSupported) {
+        std::cout << "Vulkan swapchain images can't be copied, capture unavailable.\n";
+        return false;
+    }
+    m_CaptureCallback = callback;
+    return true;
+}
+
+bool VulkanGraphicDriver::SetContinuousCapture(const std::function<void(const ReadbackResult&)>& callback)
+{
+    if (!m_CaptureSupported && callback) {
+        std::cout << "Vulkan swapchain images can't be copied, capture unavailable.\n";
+        return false;
+    }
+    m_ContinuousCaptureCallback = callback;
+    return true;
+}
+
+void VulkanGraphicDriver::WaitForPreviousPresent()
+{
+#if defined(VK_KHR_present_wait)
+    static const uint64_t PRESENT_WAIT_TIMEOUT_NS = 100 * 1000 * 1000;
+    if (PresentModePolicy::LowLatency != m_PresentModePolicy || !m_PresentWaitSupported || m_PresentID < MAX_FRAMES_IN_FLIGHT) {
+        return;
+    }
+
+    // Waiting on the latest present would leave a single frame in flight, the frames still queued before it are kept.
+    uint64_t presentID = m_PresentID + 1 - MAX_FRAMES_IN_FLIGHT;
+    PROFILE_ZONE("WaitForPresent");
+    if (VK_SUCCESS == m_vkWaitForPresentKHR(m_VulkanLogicDevice, m_VulkanSwapChain, presentID, PRESENT_WAIT_TIMEOUT_NS)) {
+        m_PresentLatency = (glfwGetTime() - m_PresentInputTimes[presentID % PRESENT_HISTORY]) * 1000.0;
+        PROFILE_COUNTER("InputToPresentMs", m_PresentLatency);
+    }
+#endif
+}
+
 bool VulkanGraphicDriver::DestroyCommandBuffers()
 {
     if (!m_VulkanCommandBuffers.empty()) {
@@ -928,7 +1360,7 @@ bool VulkanGraphicDriver::DestroyFrameBuffers()
 {
     if (!m_VulkanSwapChainFramebuffers.empty()) {
         for (size_t i = 0; i < m_VulkanSwapChainFramebuffers.size(); i++) {
-            vkDestroyFramebuffer(m_VulkanLogicDevice, m_VulkanSwapChainFramebuffers[i], nullptr);
+            vkDestroyFramebuffer(m_VulkanLogicDevice, m_VulkanSwapChainFramebuffers[i], GetVulkanAllocator());
         }
         m_VulkanSwapChainFramebuffers.clear();
     }
@@ -938,17 +1370,17 @@ bool VulkanGraphicDriver::DestroyFrameBuffers()
 bool VulkanGraphicDriver::DestroyShaderAndPipeline()
 {
     if (VK_NULL_HANDLE != m_VulkanRenderPass) {
-        vkDestroyRenderPass(m_VulkanLogicDevice, m_VulkanRenderPass, nullptr);
+        vkDestroyRenderPass(m_VulkanLogicDevice, m_VulkanRenderPass, GetVulkanAllocator());
         m_VulkanRenderPass = VK_NULL_HANDLE;
     }
 
     if (VK_NULL_HANDLE != m_VulkanGraphicsPipeline) {
-        vkDestroyPipeline(m_VulkanLogicDevice, m_VulkanGraphicsPipeline, nullptr);
+        vkDestroyPipeline(m_VulkanLogicDevice, m_VulkanGraphicsPipeline, GetVulkanAllocator());
         m_VulkanGraphicsPipeline = VK_NULL_HANDLE;
     }
 
     if (VK_NULL_HANDLE != m_VulkanPipelineLayout) {
-        vkDestroyPipelineLayout(m_VulkanLogicDevice, m_VulkanPipelineLayout, nullptr);
+        vkDestroyPipelineLayout(m_VulkanLogicDevice, m_VulkanPipelineLayout, GetVulkanAllocator());
         m_VulkanPipelineLayout = VK_NULL_HANDLE;
     }
     return true;
@@ -958,48 +1390,151 @@ bool VulkanGraphicDriver::DestroySwapChain()
 {
     if (!m_VulkanSwapChainImageViews.empty()) {
         for (size_t i = 0; i < m_VulkanSwapChainImageViews.size(); i++) {
-            vkDestroyImageView(m_VulkanLogicDevice, m_VulkanSwapChainImageViews[i], nullptr);
+            vkDestroyImageView(m_VulkanLogicDevice, m_VulkanSwapChainImageViews[i], GetVulkanAllocator());
         }
         m_VulkanSwapChainImageViews.clear();
     }
 
     if (VK_NULL_HANDLE != m_VulkanSwapChain) {
-        vkDestroySwapchainKHR(m_VulkanLogicDevice, m_VulkanSwapChain, nullptr);
+        vkDestroySwapchainKHR(m_VulkanLogicDevice, m_VulkanSwapChain, GetVulkanAllocator());
         m_VulkanSwapChain = VK_NULL_HANDLE;
     }
     return true;
 }
 
+bool VulkanGraphicDriver::PostRenderRequest(RenderRequest&& request)
+{
+    if (!m_RenderRequests.TryPush(std::move(request))) {
+        m_RejectedRenderRequests.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+uint32_t VulkanGraphicDriver::DrainRenderRequests()
+{
+    PROFILE_FUNCTION();
+    // Only what's queued now, a producer posting as fast as this runs can't hold the frame back. They're moved
+    // out into the frame arena first so the slots are free for producers while the requests run.
+    size_t pending = m_RenderRequests.GetSize();
+    RenderRequest* requests = (pending > 0) ? FrameArena::AllocateArray<RenderRequest>(pending) : nullptr;
+    if (nullptr == requests) {
+        pending = 0;
+    }
+    for (size_t i = 0; i < pending; i++) {
+        new (&requests[i]) RenderRequest();
+    }
+    uint32_t popped = 0;
+    while (popped < pending && m_RenderRequests.TryPop(requests[popped])) {
+        popped++;
+    }
+    for (uint32_t i = 0; i < popped; i++) {
+        requests[i](*this);
+    }
+    // The arena only releases their storage.
+    for (size_t i = 0; i < pending; i++) {
+        requests[i].~RenderRequest();
+    }
+    PROFILE_COUNTER("RenderRequests", popped);
+    PROFILE_COUNTER("RenderRequestsRejected", m_RejectedRenderRequests.load(std::memory_order_relaxed));
+    return popped;
+}
+
 bool VulkanGraphicDriver::ShutDown()
 {
     vkDeviceWaitIdle(m_VulkanLogicDevice);
 
+    // Nothing is drawn anymore, whatever was posted since the last frame is dropped.
+    uint32_t droppedRequests = 0;
+    RenderRequest request;
+    while (m_RenderRequests.TryPop(request)) {
+        droppedRequests++;
+    }
+    request = nullptr;
+    if (droppedRequests > 0) {
+        std::cout << "Vulkan dropped " << droppedRequests << " render requests posted after the last frame.\n";
+    }
+
+    if (nullptr != m_CommandCache) {
+        m_CommandCache->Destroy();
+        Delete(m_CommandCache);
+        m_CommandCache = nullptr;
+    }
     DestroyCommandBuffers();
     DestroyFrameBuffers();
     DestroyShaderAndPipeline();
     DestroySwapChain();
 
+    if (nullptr != m_TemporalUpscaler) {
+        m_TemporalUpscaler->Destroy();
+        Delete(m_TemporalUpscaler);
+        m_TemporalUpscaler = nullptr;
+    }
+    if (nullptr != m_ParticleSystem) {
+        m_ParticleSystem->Destroy();
+        Delete(m_ParticleSystem);
+        m_ParticleSystem = nullptr;
+    }
+    if (nullptr != m_DynamicResolution) {
+        m_DynamicResolution->Destroy();
+        Delete(m_DynamicResolution);
+        m_DynamicResolution = nullptr;
+    }
+
+    if (nullptr != m_SceneAttachments) {
+        m_SceneAttachments->Destroy();
+        Delete(m_SceneAttachments);
+        m_SceneAttachments = nullptr;
+    }
+
+    if (nullptr != m_DrawBatcher) {
+        m_DrawBatcher->Destroy();
+        Delete(m_DrawBatcher);
+        m_DrawBatcher = nullptr;
+    }
+
+    if (nullptr != m_FrameRing) {
+        m_FrameRing->Destroy();
+        Delete(m_FrameRing);
+        m_FrameRing = nullptr;
+    }
+
+    if (nullptr != m_Readback) {
+        m_Readback->Flush(m_FrameCount);
+        m_Readback->Destroy();
+        Delete(m_Readback);
+        m_Readback = nullptr;
+    }
+    m_CaptureCallback = nullptr;
+    m_ContinuousCaptureCallback = nullptr;
+
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        vkDestroySemaphore(m_VulkanLogicDevice, m_ImageAvailableSemaphores[i], nullptr);
-        vkDestroySemaphore(m_VulkanLogicDevice, m_RenderFinishedSemaphores[i], nullptr);
-        vkDestroyFence(m_VulkanLogicDevice, m_InFlightFences[i], nullptr);
+        vkDestroySemaphore(m_VulkanLogicDevice, m_ImageAvailableSemaphores[i], GetVulkanAllocator());
+        vkDestroySemaphore(m_VulkanLogicDevice, m_RenderFinishedSemaphores[i], GetVulkanAllocator());
+        vkDestroySemaphore(m_VulkanLogicDevice, m_ReadbackFinishedSemaphores[i], GetVulkanAllocator());
+        vkDestroyFence(m_VulkanLogicDevice, m_InFlightFences[i], GetVulkanAllocator());
     }
     m_ImageAvailableSemaphores.clear();
     m_RenderFinishedSemaphores.clear();
+    m_ReadbackFinishedSemaphores.clear();
     m_InFlightFences.clear();
 
-    vkDestroyCommandPool(m_VulkanLogicDevice, m_VulkanCommandPool, nullptr);
+    vkDestroyCommandPool(m_VulkanLogicDevice, m_VulkanCommandPool, GetVulkanAllocator());
     m_VulkanCommandPool = VK_NULL_HANDLE;
 
-    vkDestroyDevice(m_VulkanLogicDevice, nullptr);
+    vkDestroyDevice(m_VulkanLogicDevice, GetVulkanAllocator());
     m_VulkanLogicDevice = VK_NULL_HANDLE;
 
-    vkDestroySurfaceKHR(m_VulkanInstance, m_VulkanWindowSurface, nullptr);
+    vkDestroySurfaceKHR(m_VulkanInstance, m_VulkanWindowSurface, GetVulkanAllocator());
     m_VulkanWindowSurface = VK_NULL_HANDLE;
 
-    vkDestroyInstance(m_VulkanInstance, nullptr);
+    vkDestroyInstance(m_VulkanInstance, GetVulkanAllocator());
     m_VulkanInstance = VK_NULL_HANDLE;
 
+    if (0 != GetVulkanInternalAllocatedBytes()) {
+        std::cout << "Vulkan internal allocations still alive: " << GetVulkanInternalAllocatedBytes() << " bytes\n";
+    }
+
     return true;
 }
 
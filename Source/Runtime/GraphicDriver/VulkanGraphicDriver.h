@@ -7,6 +7,41 @@ class GLFWwindow;
 __BEGIN_NAMESPACE
 
 
+struct VulkanMeshletCullerCreateInfo;
+class VulkanDrawBatcher;
+class VulkanCommandCache;
+class VulkanFrameRing;
+class VulkanDynamicResolution;
+class VulkanTemporalUpscaler;
+class VulkanParticleSystem;
+class VulkanSceneAttachments;
+struct SceneAttachmentSettings;
+class VulkanReadback;
+struct ReadbackResult;
+
+class VulkanGraphicDriver;
+
+template <typename T>
+using DriverVector = TaggedVector<T, MemoryTag::GraphicDriver>;
+
+
+// How the swapchain present mode is picked, can be switched while running.
+enum class PresentModePolicy
+{
+	LowLatency = 0,   // MAILBOX, then IMMEDIATE: newest frame at vblank without tearing
+	Uncapped,         // IMMEDIATE, then MAILBOX: lowest latency, may tear
+	PowerSaving,      // FIFO: vsync, the GPU idles until the next vblank
+
+	Count,
+};
+
+const char* GetPresentModePolicyName(PresentModePolicy policy);
+
+
+// Resource creation, upload or draw submission posted from another thread, runs on the thread calling DrawFrame().
+typedef std::function<void(VulkanGraphicDriver&)> RenderRequest;
+
+
 typedef struct GraphicInitialInfo {
 	GLFWwindow* m_Window;
 	int         m_Width;
@@ -34,6 +69,69 @@ public:
 	virtual bool ShutDown();
 	virtual void CleanUp();
 
+	// What the picked device supports & the paths chosen from it, valid after StartUp().
+	const VulkanDeviceCapabilities& GetDeviceCapabilities() const { return m_DeviceCapabilities; }
+	const VulkanRenderPath& GetRenderPath() const { return m_RenderPath; }
+
+	// Device & feature set for creating VulkanMeshletCuller on this driver's device.
+	void GetMeshletCullerCreateInfo(VulkanMeshletCullerCreateInfo& createInfo) const;
+
+	// Scene objects submitted here are merged into instanced draws every frame.
+	VulkanDrawBatcher* GetDrawBatcher() { return m_DrawBatcher; }
+	// Scene pass secondaries reused & recorded since StartUp(), nullptr before it.
+	const VulkanCommandCache* GetCommandCache() const { return m_CommandCache; }
+	// Transient uniforms & dynamic geometry for the frame being recorded.
+	VulkanFrameRing* GetFrameRing() { return m_FrameRing; }
+
+	// Takes effect on the next DrawFrame(), which recreates the swapchain.
+	void SetPresentModePolicy(PresentModePolicy policy);
+	PresentModePolicy GetPresentModePolicy() const { return m_PresentModePolicy; }
+	// glfwGetTime() of the input the next DrawFrame() shows.
+	void SetFrameInputTime(double inputTime) { m_FrameInputTime = inputTime; }
+	// Input to present in milliseconds, measured to the actual present with VK_KHR_present_wait.
+	double GetPresentLatency() const { return m_PresentLatency; }
+	bool IsPresentWaitSupported() const { return m_PresentWaitSupported; }
+
+	// Scene render scale driven by GPU time, nullptr before StartUp().
+	VulkanDynamicResolution* GetDynamicResolution() { return m_DynamicResolution; }
+	bool IsDynamicResolutionEnabled() const { return m_DynamicResolutionEnabled; }
+	// On by default where the swapchain can be blitted to, off renders the scene straight into the swapchain.
+	// Takes effect on the next DrawFrame(), which recreates the swapchain.
+	void SetDynamicResolution(bool enabled);
+	// Pins the render scale within the settings' range, 0 lets the scene GPU time drive it again.
+	void SetDynamicResolutionScale(float scale);
+	// Resolves the jittered dynamic resolution scene into the swapchain image instead of its blit, needs dynamic resolution.
+	// Takes effect on the next DrawFrame(), which recreates the swapchain.
+	void SetTemporalUpscaling(bool enabled);
+	VulkanTemporalUpscaler* GetTemporalUpscaler() { return m_TemporalUpscaler; }
+	bool IsTemporalUpscalingEnabled() const { return nullptr != m_TemporalUpscaler; }
+	// A fountain of up to capacity GPU particles drawn over the scene, 0 turns it off. Simulated by the input time between frames.
+	// Takes effect on the next DrawFrame(), which recreates the swapchain.
+	void SetParticleCapacity(uint32_t capacity);
+	// nullptr while off.
+	const VulkanParticleSystem* GetParticleSystem() const { return m_ParticleSystem; }
+
+	// MSAA & depth of every scene pass, pipelines drawn in them take their multisample & depth state from here.
+	const VulkanSceneAttachments* GetSceneAttachments() const { return m_SceneAttachments; }
+	// Pass pipelines drawn in the scene are built against, VK_NULL_HANDLE with dynamic rendering, see VulkanSceneAttachments::SetPipelineTarget().
+	VkRenderPass GetSceneRenderPass() const { return m_VulkanRenderPass; }
+	// Takes effect on the next DrawFrame(), which recreates the swapchain.
+	void SetSceneAttachmentSettings(const SceneAttachmentSettings& settings);
+
+	// Copies the next presented frame back to the CPU, the callback runs in a later DrawFrame().
+	// Swapchain format, usually BGRA. False when the swapchain can't be read.
+	bool RequestCapture(const std::function<void(const ReadbackResult&)>& callback);
+	// Captures every frame until called with an empty callback, frames are dropped rather than waited for.
+	bool SetContinuousCapture(const std::function<void(const ReadbackResult&)>& callback);
+	// Throughput & dropped captures, nullptr before StartUp().
+	const VulkanReadback* GetReadback() const { return m_Readback; }
+
+	// Thread safe without locking. Requests run in order per posting thread at the start of the next DrawFrame(),
+	// once the frame slot is free, so they may fill the frame ring & submit to the draw batcher.
+	// False when RENDER_REQUEST_CAPACITY requests are already waiting, post again after a frame.
+	bool PostRenderRequest(RenderRequest&& request);
+	static const size_t RENDER_REQUEST_CAPACITY = 4096;
+
 private:
 	VkInstance                        m_VulkanInstance;
 	VkSurfaceKHR                      m_VulkanWindowSurface;
@@ -41,8 +139,8 @@ private:
 	uint32_t                          m_VulkanGraphicQueueFamilyID;
 	uint32_t                          m_VulkanPresentQueueFamilyID;
 	VkSurfaceCapabilitiesKHR          m_SurfaceCapabilities;
-	std::vector<VkSurfaceFormatKHR>   m_SurfaceFormats;
-	std::vector<VkPresentModeKHR>     m_PresentModes;
+	DriverVector<VkSurfaceFormatKHR>  m_SurfaceFormats;
+	DriverVector<VkPresentModeKHR>    m_PresentModes;
 	VkDevice                          m_VulkanLogicDevice;
 	VkQueue                           m_VulkanGraphicQueue;
 	VkQueue                           m_VulkanPresentQueue;
@@ -50,26 +148,72 @@ private:
 	VkPresentModeKHR                  m_VulkanSwapPresentMode;
 	VkExtent2D                        m_VulkanSwapExtent;
 	VkSwapchainKHR                    m_VulkanSwapChain;
-	std::vector<VkImage>              m_VulkanSwapChainImages;
-	std::vector<VkImageView>          m_VulkanSwapChainImageViews;
+	DriverVector<VkImage>             m_VulkanSwapChainImages;
+	DriverVector<VkImageView>         m_VulkanSwapChainImageViews;
 	VkRenderPass                      m_VulkanRenderPass;
 	VkPipelineLayout                  m_VulkanPipelineLayout;
 	VkPipeline                        m_VulkanGraphicsPipeline;
-	std::vector<VkFramebuffer>        m_VulkanSwapChainFramebuffers;
+	DriverVector<VkFramebuffer>       m_VulkanSwapChainFramebuffers;
 	VkCommandPool                     m_VulkanCommandPool;
-	std::vector<VkCommandBuffer>      m_VulkanCommandBuffers;
+	DriverVector<VkCommandBuffer>     m_VulkanCommandBuffers;
+	VulkanCommandCache*               m_CommandCache;              // Secondaries of the scene pass, re-recorded only when their content changes
 
-	std::vector<VkSemaphore>          m_ImageAvailableSemaphores;
-	std::vector<VkSemaphore>          m_RenderFinishedSemaphores;
-	std::vector<VkFence>              m_InFlightFences;
-	std::vector<VkFence>              m_InFlightImageFences;
+	DriverVector<VkSemaphore>         m_ImageAvailableSemaphores;
+	DriverVector<VkSemaphore>         m_RenderFinishedSemaphores;
+	DriverVector<VkFence>             m_InFlightFences;
+	DriverVector<VkFence>             m_InFlightImageFences;
 	size_t                            m_CurrentFrame;
 	bool                              m_SkipFrame;
+	uint64_t                          m_FrameCount;
+	VulkanDrawBatcher*                m_DrawBatcher;
+	VulkanFrameRing*                  m_FrameRing;
+
+	VulkanDeviceCapabilities          m_DeviceCapabilities;
+	VulkanRenderPath                  m_RenderPath;
+
+	static const uint32_t             PRESENT_HISTORY = 4;
+	PresentModePolicy                 m_PresentModePolicy;
+	bool                              m_SwapChainDirty;
+	bool                              m_PresentWaitSupported;
+	uint64_t                          m_PresentID;
+	double                            m_FrameInputTime;
+	double                            m_PresentInputTimes[PRESENT_HISTORY];   // By present id
+	double                            m_PresentLatency;
+#if defined(VK_KHR_present_wait)
+	PFN_vkWaitForPresentKHR           m_vkWaitForPresentKHR;
+#endif
+
+	VulkanDynamicResolution*          m_DynamicResolution;
+	bool                              m_DynamicResolutionEnabled;
+	bool                              m_DynamicResolutionSupported;
+	bool                              m_DynamicResolutionRequested;
+	VulkanTemporalUpscaler*           m_TemporalUpscaler;
+	bool                              m_TemporalUpscalingRequested;
+	VulkanParticleSystem*             m_ParticleSystem;
+	uint32_t                          m_ParticleCapacity;
+	double                            m_ParticleInputTime;         // Input time the particles were last simulated to
+	VulkanSceneAttachments*           m_SceneAttachments;
+
+	VulkanReadback*                   m_Readback;
+	VkQueue                           m_VulkanReadbackQueue;       // Second graphics family queue when there is one
+	bool                              m_CaptureSupported;
+	DriverVector<VkSemaphore>         m_ReadbackFinishedSemaphores;
+	std::function<void(const ReadbackResult&)> m_CaptureCallback;
+	std::function<void(const ReadbackResult&)> m_ContinuousCaptureCallback;
+
+	MPSCQueue<RenderRequest, RENDER_REQUEST_CAPACITY> m_RenderRequests;
+	std::atomic<uint64_t>             m_RejectedRenderRequests;
 
+	uint32_t DrainRenderRequests();
 	bool CreateSwapChain(uint32_t width, uint32_t height);
+	bool RecreateSwapChain(uint32_t width, uint32_t height);
+	void UpdateTemporalUpscaler();
+	void UpdateParticleSystem();
+	void WaitForPreviousPresent();
 	bool CreateShaderAndPipeline();
 	bool CreateFrameBuffers();
 	bool CreateCommandBuffers();	
+	bool RecordCommandBuffer(uint32_t imageIndex, bool capture);
 	bool DestroyCommandBuffers();
 	bool DestroyFrameBuffers();
 	bool DestroyShaderAndPipeline();		
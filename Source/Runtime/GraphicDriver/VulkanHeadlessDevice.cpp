@@ -0,0 +1,208 @@
+#include <cstdint> // Necessary for UINT32_MAX
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanHeadlessDevice.h"
+
+
+__BEGIN_NAMESPACE
+
+static const char* HEADLESS_VALIDATION_LAYER = "VK_LAYER_KHRONOS_validation";
+
+VulkanHeadlessDevice::VulkanHeadlessDevice() :
+	m_Instance(VK_NULL_HANDLE),
+	m_PhysicalDevice(VK_NULL_HANDLE),
+	m_Device(VK_NULL_HANDLE),
+	m_PipelineCache(VK_NULL_HANDLE),
+	m_QueueFamilyIndex(UINT32_MAX),
+	m_QueueCount(0),
+	m_SparseResidency(false),
+	m_MultiDrawIndirect(false),
+	m_DrawIndirectFirstInstance(false)
+{
+    memset(m_Queues, 0, sizeof(m_Queues));
+    m_DeviceName[0] = '\0';
+}
+
+VulkanHeadlessDevice::~VulkanHeadlessDevice()
+{
+}
+
+bool VulkanHeadlessDevice::Create(const HeadlessDeviceSettings& settings)
+{
+    /****************************************************************************
+     * Instance, no surface extensions
+     ****************************************************************************/
+    {
+        VkApplicationInfo appInfo{};
+        appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        appInfo.pApplicationName = "Server";
+        appInfo.applicationVersion = VK_MAKE_VERSION(0, 1, 0);
+        appInfo.pEngineName = "Kaleidoscope";
+        appInfo.engineVersion = VK_MAKE_VERSION(0, 1, 0);
+        appInfo.apiVersion = VK_API_VERSION_1_1;
+
+        VkInstanceCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        createInfo.pApplicationInfo = &appInfo;
+
+        bool useValidationLayers = false;
+        if (settings.m_Validation) {
+            uint32_t layerCount = 0;
+            vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+            std::vector<VkLayerProperties> availableLayers(layerCount);
+            vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+            for (const auto& layerProperties : availableLayers) {
+                useValidationLayers |= (strcmp(HEADLESS_VALIDATION_LAYER, layerProperties.layerName) == 0);
+            }
+            if (!useValidationLayers) {
+                std::cout << "Vulkan ValidationLayer doesn't supported.\n";
+            }
+        }
+        createInfo.enabledLayerCount = useValidationLayers ? 1 : 0;
+        createInfo.ppEnabledLayerNames = useValidationLayers ? &HEADLESS_VALIDATION_LAYER : nullptr;
+
+        if (vkCreateInstance(&createInfo, GetVulkanAllocator(), &m_Instance) != VK_SUCCESS) {
+            std::cout << "Vulkan instance creation failed.\n";
+            SetErrorCode(ErrorCode::Vulkan_Invalid_Instance);
+            return false;
+        }
+    }
+
+    /****************************************************************************
+     * Physical device: the named one, otherwise discrete before integrated before CPU
+     ****************************************************************************/
+    {
+        uint32_t deviceCount = 0;
+        vkEnumeratePhysicalDevices(m_Instance, &deviceCount, nullptr);
+        std::vector<VkPhysicalDevice> devices(deviceCount);
+        vkEnumeratePhysicalDevices(m_Instance, &deviceCount, devices.data());
+
+        int bestScore = 0;
+        for (VkPhysicalDevice device : devices) {
+            VkPhysicalDeviceProperties deviceProperties;
+            vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+            uint32_t queueFamilyCount = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+            std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+            vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
+
+            // The graphics family with the most queues.
+            uint32_t queueFamilyIndex = UINT32_MAX;
+            for (uint32_t qfid = 0; qfid < queueFamilyCount; ++qfid) {
+                if ((queueFamilies[qfid].queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+                    (UINT32_MAX == queueFamilyIndex || queueFamilies[qfid].queueCount > queueFamilies[queueFamilyIndex].queueCount)) {
+                    queueFamilyIndex = qfid;
+                }
+            }
+            if (UINT32_MAX == queueFamilyIndex) {
+                continue;
+            }
+
+            int score = 1;
+            if (!settings.m_DeviceName.empty() && nullptr != strstr(deviceProperties.deviceName, settings.m_DeviceName.c_str())) {
+                score += 100000;
+            } else if (VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU == deviceProperties.deviceType) {
+                score += 1000;
+            } else if (VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU == deviceProperties.deviceType) {
+                score += 100;
+            }
+            if (score > bestScore) {
+                bestScore = score;
+                m_PhysicalDevice = device;
+                m_QueueFamilyIndex = queueFamilyIndex;
+                m_QueueCount = std::min(std::min(std::max(settings.m_MaxQueues, 1u), MAX_QUEUES), queueFamilies[queueFamilyIndex].queueCount);
+                strncpy(m_DeviceName, deviceProperties.deviceName, sizeof(m_DeviceName) - 1);
+                m_DeviceName[sizeof(m_DeviceName) - 1] = '\0';
+            }
+        }
+
+        if (VK_NULL_HANDLE == m_PhysicalDevice) {
+            std::cout << "Vulkan no suitabel physical device.\n";
+            SetErrorCode(ErrorCode::Vulkan_Invalid_PhysicalDevice);
+            return false;
+        }
+        if (!settings.m_DeviceName.empty() && nullptr == strstr(m_DeviceName, settings.m_DeviceName.c_str())) {
+            std::cout << "Vulkan device \"" << settings.m_DeviceName << "\" not found, using " << m_DeviceName << ".\n";
+        }
+    }
+
+    /****************************************************************************
+     * Device with up to m_MaxQueues queues of the graphics family
+     ****************************************************************************/
+    {
+        std::vector<float> queuePriorities(m_QueueCount, 1.0f);
+        VkDeviceQueueCreateInfo queueCreateInfo{};
+        queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueCreateInfo.queueFamilyIndex = m_QueueFamilyIndex;
+        queueCreateInfo.queueCount = m_QueueCount;
+        queueCreateInfo.pQueuePriorities = queuePriorities.data();
+
+        // Sparse residency lets virtual textures commit their page cache as it fills, the family must bind sparse memory too.
+        VkPhysicalDeviceFeatures supportedFeatures;
+        vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        VkPhysicalDeviceFeatures deviceFeatures{};
+        m_SparseResidency = supportedFeatures.sparseBinding && supportedFeatures.sparseResidencyImage2D &&
+            0 != (queueFamilies[m_QueueFamilyIndex].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT);
+        deviceFeatures.sparseBinding = m_SparseResidency ? VK_TRUE : VK_FALSE;
+        deviceFeatures.sparseResidencyImage2D = m_SparseResidency ? VK_TRUE : VK_FALSE;
+        m_MultiDrawIndirect = (VK_TRUE == supportedFeatures.multiDrawIndirect);
+        m_DrawIndirectFirstInstance = (VK_TRUE == supportedFeatures.drawIndirectFirstInstance);
+        deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+        deviceFeatures.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+
+        VkDeviceCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        createInfo.pQueueCreateInfos = &queueCreateInfo;
+        createInfo.queueCreateInfoCount = 1;
+        createInfo.pEnabledFeatures = &deviceFeatures;
+
+        if (vkCreateDevice(m_PhysicalDevice, &createInfo, GetVulkanAllocator(), &m_Device) != VK_SUCCESS) {
+            std::cout << "Vulkan failed to create logic device.\n";
+            SetErrorCode(ErrorCode::Vulkan_Invalid_LogicDevice);
+            return false;
+        }
+        for (uint32_t i = 0; i < m_QueueCount; i++) {
+            vkGetDeviceQueue(m_Device, m_QueueFamilyIndex, i, &m_Queues[i]);
+        }
+
+        VkPipelineCacheCreateInfo pipelineCacheInfo{};
+        pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        if (vkCreatePipelineCache(m_Device, &pipelineCacheInfo, GetVulkanAllocator(), &m_PipelineCache) != VK_SUCCESS) {
+            m_PipelineCache = VK_NULL_HANDLE;
+        }
+    }
+
+    std::cout << "Vulkan headless device " << m_DeviceName << ", " << m_QueueCount << " queue(s) of family " << m_QueueFamilyIndex
+        << (m_SparseResidency ? ", sparse residency" : "") << ".\n";
+    return true;
+}
+
+void VulkanHeadlessDevice::Destroy()
+{
+    if (VK_NULL_HANDLE != m_Device) {
+        vkDeviceWaitIdle(m_Device);
+        if (VK_NULL_HANDLE != m_PipelineCache) {
+            vkDestroyPipelineCache(m_Device, m_PipelineCache, GetVulkanAllocator());
+            m_PipelineCache = VK_NULL_HANDLE;
+        }
+        vkDestroyDevice(m_Device, GetVulkanAllocator());
+        m_Device = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_Instance) {
+        vkDestroyInstance(m_Instance, GetVulkanAllocator());
+        m_Instance = VK_NULL_HANDLE;
+    }
+    m_PhysicalDevice = VK_NULL_HANDLE;
+    m_QueueCount = 0;
+    m_SparseResidency = false;
+    m_MultiDrawIndirect = false;
+    m_DrawIndirectFirstInstance = false;
+}
+
+__END_NAMESPACE
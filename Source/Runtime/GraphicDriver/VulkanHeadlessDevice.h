@@ -0,0 +1,61 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+typedef struct HeadlessDeviceSettings {
+	std::string   m_DeviceName;           // Substring of the device name to pick, e.g. "llvmpipe" for lavapipe, empty picks the best
+	uint32_t      m_MaxQueues = 4;        // Graphics queues requested, jobs on different queues submit without contention
+	bool          m_Validation = false;
+} HeadlessDeviceSettings;
+
+
+/**
+ * Vulkan instance & device without a window surface, for rendering offscreen. Queues may be shared by
+ * several threads, submit under GetQueueMutex(). The pipeline cache is shared by every pipeline built
+ * on the device, so workers created after the first one get their pipelines warm.
+ */
+class VulkanHeadlessDevice
+{
+public:
+	VulkanHeadlessDevice();
+	virtual ~VulkanHeadlessDevice();
+
+	bool Create(const HeadlessDeviceSettings& settings);
+	void Destroy();
+
+	VkInstance GetInstance() const { return m_Instance; }
+	VkPhysicalDevice GetPhysicalDevice() const { return m_PhysicalDevice; }
+	VkDevice GetDevice() const { return m_Device; }
+	VkPipelineCache GetPipelineCache() const { return m_PipelineCache; }
+	uint32_t GetQueueFamilyIndex() const { return m_QueueFamilyIndex; }
+	uint32_t GetQueueCount() const { return m_QueueCount; }
+	VkQueue GetQueue(uint32_t index) const { return m_Queues[index % m_QueueCount]; }
+	std::mutex& GetQueueMutex(uint32_t index) { return m_QueueMutexes[index % m_QueueCount]; }
+	const char* GetDeviceName() const { return m_DeviceName; }
+	// sparseBinding & sparseResidencyImage2D are enabled, and the queues bind sparse memory.
+	bool IsSparseResidencyEnabled() const { return m_SparseResidency; }
+	// multiDrawIndirect & drawIndirectFirstInstance, enabled when supported, for the meshlet culler's indirect draws.
+	bool IsMultiDrawIndirectEnabled() const { return m_MultiDrawIndirect; }
+	bool IsDrawIndirectFirstInstanceEnabled() const { return m_DrawIndirectFirstInstance; }
+
+	static const uint32_t MAX_QUEUES = 16;
+
+private:
+	VkInstance          m_Instance;
+	VkPhysicalDevice    m_PhysicalDevice;
+	VkDevice            m_Device;
+	VkPipelineCache     m_PipelineCache;
+	uint32_t            m_QueueFamilyIndex;
+	uint32_t            m_QueueCount;
+	VkQueue             m_Queues[MAX_QUEUES];
+	std::mutex          m_QueueMutexes[MAX_QUEUES];
+	char                m_DeviceName[VK_MAX_PHYSICAL_DEVICE_NAME_SIZE];
+	bool                m_SparseResidency;
+	bool                m_MultiDrawIndirect;
+	bool                m_DrawIndirectFirstInstance;
+};
+
+
+__END_NAMESPACE
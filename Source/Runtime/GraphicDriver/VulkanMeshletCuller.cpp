@@ -0,0 +1,521 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "Meshlet.h"
+#include "VulkanSceneAttachments.h"
+#include "VulkanMeshletCuller.h"
+
+
+__BEGIN_NAMESPACE
+
+// Keep in sync with meshlet_cull.shader.comp & meshlet.shader.task
+static const uint32_t MESHLET_CULL_GROUP_SIZE = 64;
+static const uint32_t MESHLET_TASK_GROUP_SIZE = 32;
+static const uint32_t MESHLET_FLAG_COMPACT = 0x1;
+static const uint32_t MESHLET_FLAG_FIRST_INSTANCE = 0x2;
+
+enum MeshletBinding
+{
+    MeshletBinding_Bounds = 0,
+    MeshletBinding_Meshlets,
+    MeshletBinding_DrawCommands,
+    MeshletBinding_DrawCount,
+    MeshletBinding_Positions,
+    MeshletBinding_MeshletVertices,
+    MeshletBinding_MeshletTriangles,
+    MeshletBinding_Count,
+};
+
+
+VulkanMeshletCuller::VulkanMeshletCuller() :
+    m_CreateInfo{},
+    m_MeshletCount(0),
+    m_TriangleCount(0),
+    m_Params{},
+    m_PushConstantStages(0),
+    m_DescriptorSetLayout(VK_NULL_HANDLE),
+    m_DescriptorPool(VK_NULL_HANDLE),
+    m_DescriptorSet(VK_NULL_HANDLE),
+    m_PipelineLayout(VK_NULL_HANDLE),
+    m_CullPipeline(VK_NULL_HANDLE),
+    m_DrawPipeline(VK_NULL_HANDLE),
+    m_CmdDrawIndexedIndirectCount(nullptr)
+#if defined(VK_EXT_mesh_shader)
+    , m_CmdDrawMeshTasks(nullptr)
+#endif
+{
+}
+
+VulkanMeshletCuller::~VulkanMeshletCuller()
+{
+}
+
+bool VulkanMeshletCuller::Create(const VulkanMeshletCullerCreateInfo& createInfo, const MeshletMesh& mesh, const glm::vec3* positions, size_t vertexCount)
+{
+    m_CreateInfo = createInfo;
+#if !defined(VK_EXT_mesh_shader)
+    m_CreateInfo.m_MeshShaderSupported = false;
+#endif
+    if (!m_CreateInfo.m_MultiDrawIndirectSupported) {
+        m_CreateInfo.m_DrawIndirectCountSupported = false;
+    }
+
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+
+    m_MeshletCount = (uint32_t)mesh.m_Meshlets.size();
+    m_TriangleCount = (uint32_t)(mesh.m_MeshletIndices.size() / 3);
+    if (0 == m_MeshletCount) {
+        std::cout << "Vulkan meshlet culler created without meshlets.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    /****************************************************************************
+     * Upload cluster data
+     ****************************************************************************/
+    std::vector<glm::vec4> positions4(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        positions4[i] = glm::vec4(positions[i], 1.0f);
+    }
+
+    const VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    VULKAN_DRIVER_CHECK_FUN(UploadBuffer(device, physicalDevice, mesh.m_Bounds.data(), sizeof(MeshletBounds) * mesh.m_Bounds.size(), storage, m_BoundsBuffer));
+    VULKAN_DRIVER_CHECK_FUN(UploadBuffer(device, physicalDevice, mesh.m_Meshlets.data(), sizeof(Meshlet) * mesh.m_Meshlets.size(), storage, m_MeshletBuffer));
+    VULKAN_DRIVER_CHECK_FUN(UploadBuffer(device, physicalDevice, positions4.data(), sizeof(glm::vec4) * positions4.size(), storage | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_PositionBuffer));
+    VULKAN_DRIVER_CHECK_FUN(UploadBuffer(device, physicalDevice, mesh.m_MeshletIndices.data(), sizeof(uint32_t) * mesh.m_MeshletIndices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_IndexBuffer));
+    VULKAN_DRIVER_CHECK_FUN(UploadBuffer(device, physicalDevice, mesh.m_MeshletVertices.data(), sizeof(uint32_t) * mesh.m_MeshletVertices.size(), storage, m_MeshletVertexBuffer));
+    VULKAN_DRIVER_CHECK_FUN(UploadBuffer(device, physicalDevice, mesh.m_MeshletTriangles.data(), mesh.m_MeshletTriangles.size(), storage, m_MeshletTriangleBuffer));
+
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, sizeof(VkDrawIndexedIndirectCommand) * m_MeshletCount,
+        storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_DrawCommandBuffer));
+    // Draw count & visible triangle count, read back on host for statistics.
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, sizeof(uint32_t) * 2,
+        storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_DrawCountBuffer));
+    memset(m_DrawCountBuffer.m_Mapped, 0, sizeof(uint32_t) * 2);
+
+    if (m_CreateInfo.m_DrawIndirectCountSupported) {
+        m_CmdDrawIndexedIndirectCount = (PFN_vkCmdDrawIndexedIndirectCountKHR)vkGetDeviceProcAddr(device, "vkCmdDrawIndexedIndirectCountKHR");
+        m_CreateInfo.m_DrawIndirectCountSupported = (nullptr != m_CmdDrawIndexedIndirectCount);
+    }
+#if defined(VK_EXT_mesh_shader)
+    if (m_CreateInfo.m_MeshShaderSupported) {
+        m_CmdDrawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksEXT");
+        m_CreateInfo.m_MeshShaderSupported = (nullptr != m_CmdDrawMeshTasks);
+    }
+#endif
+
+    /****************************************************************************
+     * Create descriptor set
+     ****************************************************************************/
+    m_PushConstantStages = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+#if defined(VK_EXT_mesh_shader)
+    if (m_CreateInfo.m_MeshShaderSupported) {
+        m_PushConstantStages |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+    }
+#endif
+
+    VkDescriptorSetLayoutBinding bindings[MeshletBinding_Count]{};
+    for (uint32_t i = 0; i < MeshletBinding_Count; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = m_PushConstantStages;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = MeshletBinding_Count;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_DescriptorSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create meshlet descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = MeshletBinding_Count;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    if (vkCreateDescriptorPool(device, &poolInfo, GetVulkanAllocator(), &m_DescriptorPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create meshlet descriptor pool.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_DescriptorSetLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_DescriptorSet) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate meshlet descriptor set.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    const VulkanBuffer* buffers[MeshletBinding_Count] = {
+        &m_BoundsBuffer, &m_MeshletBuffer, &m_DrawCommandBuffer, &m_DrawCountBuffer,
+        &m_PositionBuffer, &m_MeshletVertexBuffer, &m_MeshletTriangleBuffer,
+    };
+    VkDescriptorBufferInfo bufferInfos[MeshletBinding_Count]{};
+    VkWriteDescriptorSet writes[MeshletBinding_Count]{};
+    for (uint32_t i = 0; i < MeshletBinding_Count; i++) {
+        bufferInfos[i].buffer = buffers[i]->m_Buffer;
+        bufferInfos[i].offset = 0;
+        bufferInfos[i].range = VK_WHOLE_SIZE;
+
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_DescriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(device, MeshletBinding_Count, writes, 0, nullptr);
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = m_PushConstantStages;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(MeshletCullParams);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_PipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create meshlet pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    if (!m_CreateInfo.m_MeshShaderSupported) {
+        VULKAN_DRIVER_CHECK_FUN(CreateCullPipeline());
+    }
+
+    m_Params.m_MeshletCount = m_MeshletCount;
+    m_Params.m_Flags = (m_CreateInfo.m_DrawIndirectCountSupported ? MESHLET_FLAG_COMPACT : 0) |
+        (m_CreateInfo.m_DrawIndirectFirstInstanceSupported ? MESHLET_FLAG_FIRST_INSTANCE : 0);
+
+    std::cout << "Vulkan meshlet culler created, " << m_MeshletCount << " meshlets, " << m_TriangleCount << " triangles, "
+        << (m_CreateInfo.m_MeshShaderSupported ? "task/mesh shader" : "compute + indirect draw") << " path.\n";
+    return true;
+}
+
+bool VulkanMeshletCuller::CreateCullPipeline()
+{
+    VkShaderModule cullShaderModule = LoadShaderModule(m_CreateInfo.m_Device, "Data/Engine/meshlet_cull.cs.spv");
+    if (VK_NULL_HANDLE == cullShaderModule) {
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = cullShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_PipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(m_CreateInfo.m_Device, VK_NULL_HANDLE, 1, &pipelineInfo, GetVulkanAllocator(), &m_CullPipeline);
+    vkDestroyShaderModule(m_CreateInfo.m_Device, cullShaderModule, GetVulkanAllocator());
+    if (result != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create meshlet cull pipeline.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanMeshletCuller::CreateDrawPipeline(VkRenderPass renderPass, VkSampleCountFlagBits samples, bool depthTest)
+{
+    return BuildDrawPipeline(renderPass, samples, depthTest, nullptr);
+}
+
+bool VulkanMeshletCuller::CreateDrawPipeline(const VulkanSceneAttachments& sceneAttachments, VkRenderPass sceneRenderPass)
+{
+    return BuildDrawPipeline(sceneRenderPass, sceneAttachments.GetSamples(), sceneAttachments.HasDepth(), &sceneAttachments);
+}
+
+bool VulkanMeshletCuller::BuildDrawPipeline(VkRenderPass renderPass, VkSampleCountFlagBits samples, bool depthTest, const VulkanSceneAttachments* sceneAttachments)
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE != m_DrawPipeline) {
+        vkDestroyPipeline(device, m_DrawPipeline, GetVulkanAllocator());
+        m_DrawPipeline = VK_NULL_HANDLE;
+    }
+
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+    std::vector<VkShaderModule> shaderModules;
+    auto addStage = [&](VkShaderStageFlagBits stage, const char* path) {
+        VkShaderModule shaderModule = LoadShaderModule(device, path);
+        if (VK_NULL_HANDLE == shaderModule) {
+            return false;
+        }
+        VkPipelineShaderStageCreateInfo stageInfo{};
+        stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stageInfo.stage = stage;
+        stageInfo.module = shaderModule;
+        stageInfo.pName = "main";
+        shaderStages.push_back(stageInfo);
+        shaderModules.push_back(shaderModule);
+        return true;
+    };
+
+    bool stagesLoaded = true;
+#if defined(VK_EXT_mesh_shader)
+    if (m_CreateInfo.m_MeshShaderSupported) {
+        stagesLoaded = addStage(VK_SHADER_STAGE_TASK_BIT_EXT, "Data/Engine/meshlet.ts.spv") &&
+            addStage(VK_SHADER_STAGE_MESH_BIT_EXT, "Data/Engine/meshlet.ms.spv");
+    } else
+#endif
+    {
+        stagesLoaded = addStage(VK_SHADER_STAGE_VERTEX_BIT, "Data/Engine/meshlet.vs.spv");
+    }
+    stagesLoaded = stagesLoaded && addStage(VK_SHADER_STAGE_FRAGMENT_BIT, "Data/Engine/sample.fs.spv");
+
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+    if (stagesLoaded) {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 0;
+        bindingDescription.stride = sizeof(glm::vec4);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        VkVertexInputAttributeDescription attributeDescription{};
+        attributeDescription.binding = 0;
+        attributeDescription.location = 0;
+        attributeDescription.format = VK_FORMAT_R32G32B32_SFLOAT;
+        attributeDescription.offset = 0;
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+        vertexInputInfo.vertexAttributeDescriptionCount = 1;
+        vertexInputInfo.pVertexAttributeDescriptions = &attributeDescription;
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        VkPipelineViewportStateCreateInfo viewportState{};
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount = 1;
+
+        VkPipelineRasterizationStateCreateInfo rasterizer{};
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.lineWidth = 1.0f;
+        rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+        rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+        VkPipelineMultisampleStateCreateInfo multisampling{};
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.rasterizationSamples = samples;
+
+        VkPipelineDepthStencilStateCreateInfo depthStencil{};
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable = depthTest ? VK_TRUE : VK_FALSE;
+        depthStencil.depthWriteEnable = depthTest ? VK_TRUE : VK_FALSE;
+        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+        depthStencil.maxDepthBounds = 1.0f;
+
+        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachment.blendEnable = VK_FALSE;
+
+        VkPipelineColorBlendStateCreateInfo colorBlending{};
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments = &colorBlendAttachment;
+
+        VkDynamicState dynamicStates[] = {
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+        };
+
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = 2;
+        dynamicState.pDynamicStates = dynamicStates;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = (uint32_t)shaderStages.size();
+        pipelineInfo.pStages = shaderStages.data();
+        // Mesh shader pipelines must not have vertex input & input assembly state.
+        pipelineInfo.pVertexInputState = m_CreateInfo.m_MeshShaderSupported ? nullptr : &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = m_CreateInfo.m_MeshShaderSupported ? nullptr : &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.pMultisampleState = &multisampling;
+        pipelineInfo.pDepthStencilState = &depthStencil;
+        pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicState;
+        pipelineInfo.layout = m_PipelineLayout;
+        pipelineInfo.renderPass = renderPass;
+        pipelineInfo.subpass = 0;
+        if (nullptr != sceneAttachments) {
+            sceneAttachments->SetPipelineTarget(pipelineInfo, renderPass);
+        }
+        pipelineInfo.basePipelineIndex = -1;
+
+        result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, GetVulkanAllocator(), &m_DrawPipeline);
+    }
+
+    for (VkShaderModule shaderModule : shaderModules) {
+        vkDestroyShaderModule(device, shaderModule, GetVulkanAllocator());
+    }
+
+    if (result != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create meshlet draw pipeline.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+void VulkanMeshletCuller::RecordCull(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, const glm::vec3& cameraPosition)
+{
+    m_Params.m_ViewProjection = viewProjection;
+    m_Params.m_CameraPosition = glm::vec4(cameraPosition, 1.0f);
+    if (m_CreateInfo.m_MeshShaderSupported || VK_NULL_HANDLE == m_CullPipeline) {
+        return;
+    }
+
+    // The previous cull's count is read by its indirect draws until they're done, only then may it be cleared.
+    VkMemoryBarrier countBarrier{};
+    countBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    countBarrier.srcAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    countBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0, 1, &countBarrier, 0, nullptr, 0, nullptr);
+    vkCmdFillBuffer(commandBuffer, m_DrawCountBuffer.m_Buffer, 0, VK_WHOLE_SIZE, 0);
+
+    // The cleared count before the cull adds to it, & the previous draws' reads of the commands before the cull
+    // rewrites them.
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_DescriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_PipelineLayout, m_PushConstantStages, 0, sizeof(MeshletCullParams), &m_Params);
+    vkCmdDispatch(commandBuffer, (m_MeshletCount + MESHLET_CULL_GROUP_SIZE - 1) / MESHLET_CULL_GROUP_SIZE, 1, 1);
+
+    VkMemoryBarrier cullBarrier{};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+        0, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanMeshletCuller::RecordDraw(VkCommandBuffer commandBuffer, const VkViewport& viewport, const VkRect2D& scissor)
+{
+    if (VK_NULL_HANDLE == m_DrawPipeline) {
+        return;
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_DrawPipeline);
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSet, 0, nullptr);
+
+#if defined(VK_EXT_mesh_shader)
+    if (m_CreateInfo.m_MeshShaderSupported) {
+        vkCmdPushConstants(commandBuffer, m_PipelineLayout, m_PushConstantStages, 0, sizeof(MeshletCullParams), &m_Params);
+        m_CmdDrawMeshTasks(commandBuffer, (m_MeshletCount + MESHLET_TASK_GROUP_SIZE - 1) / MESHLET_TASK_GROUP_SIZE, 1, 1);
+        return;
+    }
+#endif
+
+    vkCmdPushConstants(commandBuffer, m_PipelineLayout, m_PushConstantStages, 0, sizeof(MeshletCullParams), &m_Params);
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_PositionBuffer.m_Buffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer.m_Buffer, 0, VK_INDEX_TYPE_UINT32);
+
+    const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (m_CreateInfo.m_DrawIndirectCountSupported) {
+        m_CmdDrawIndexedIndirectCount(commandBuffer, m_DrawCommandBuffer.m_Buffer, 0, m_DrawCountBuffer.m_Buffer, 0, m_MeshletCount, stride);
+    } else if (m_CreateInfo.m_MultiDrawIndirectSupported) {
+        // Culled meshlets are written with zero instances.
+        vkCmdDrawIndexedIndirect(commandBuffer, m_DrawCommandBuffer.m_Buffer, 0, m_MeshletCount, stride);
+    } else {
+        for (uint32_t i = 0; i < m_MeshletCount; i++) {
+            vkCmdDrawIndexedIndirect(commandBuffer, m_DrawCommandBuffer.m_Buffer, (VkDeviceSize)i * stride, 1, stride);
+        }
+    }
+}
+
+MeshletCullStatistics VulkanMeshletCuller::GetStatistics() const
+{
+    MeshletCullStatistics statistics{};
+    statistics.m_TotalMeshlets = m_MeshletCount;
+    statistics.m_TotalTriangles = m_TriangleCount;
+    if (nullptr != m_DrawCountBuffer.m_Mapped && !m_CreateInfo.m_MeshShaderSupported) {
+        const uint32_t* counters = (const uint32_t*)m_DrawCountBuffer.m_Mapped;
+        statistics.m_VisibleMeshlets = counters[0];
+        statistics.m_VisibleTriangles = counters[1];
+    } else {
+        statistics.m_VisibleMeshlets = m_MeshletCount;
+        statistics.m_VisibleTriangles = m_TriangleCount;
+    }
+    return statistics;
+}
+
+void VulkanMeshletCuller::Destroy()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE == device) {
+        return;
+    }
+
+    if (VK_NULL_HANDLE != m_DrawPipeline) {
+        vkDestroyPipeline(device, m_DrawPipeline, GetVulkanAllocator());
+        m_DrawPipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_CullPipeline) {
+        vkDestroyPipeline(device, m_CullPipeline, GetVulkanAllocator());
+        m_CullPipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_PipelineLayout) {
+        vkDestroyPipelineLayout(device, m_PipelineLayout, GetVulkanAllocator());
+        m_PipelineLayout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorPool) {
+        vkDestroyDescriptorPool(device, m_DescriptorPool, GetVulkanAllocator());
+        m_DescriptorPool = VK_NULL_HANDLE;
+        m_DescriptorSet = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorSetLayout) {
+        vkDestroyDescriptorSetLayout(device, m_DescriptorSetLayout, GetVulkanAllocator());
+        m_DescriptorSetLayout = VK_NULL_HANDLE;
+    }
+
+    DestroyBuffer(device, m_BoundsBuffer);
+    DestroyBuffer(device, m_MeshletBuffer);
+    DestroyBuffer(device, m_DrawCommandBuffer);
+    DestroyBuffer(device, m_DrawCountBuffer);
+    DestroyBuffer(device, m_PositionBuffer);
+    DestroyBuffer(device, m_IndexBuffer);
+    DestroyBuffer(device, m_MeshletVertexBuffer);
+    DestroyBuffer(device, m_MeshletTriangleBuffer);
+    m_MeshletCount = 0;
+    m_TriangleCount = 0;
+}
+
+__END_NAMESPACE
@@ -0,0 +1,99 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+struct MeshletMesh;
+class VulkanSceneAttachments;
+
+
+typedef struct VulkanMeshletCullerCreateInfo {
+	VkDevice             m_Device;
+	VkPhysicalDevice     m_PhysicalDevice;
+	bool                 m_MeshShaderSupported;           // VK_EXT_mesh_shader task & mesh stages enabled on m_Device
+	bool                 m_MultiDrawIndirectSupported;
+	bool                 m_DrawIndirectCountSupported;    // VK_KHR_draw_indirect_count enabled on m_Device
+	bool                 m_DrawIndirectFirstInstanceSupported;
+} VulkanMeshletCullerCreateInfo;
+
+// Camera in mesh space, same layout as the push constant block of the meshlet shaders.
+typedef struct MeshletCullParams {
+	glm::mat4            m_ViewProjection;
+	glm::vec4            m_CameraPosition;
+	uint32_t             m_MeshletCount;
+	uint32_t             m_Flags;
+} MeshletCullParams;
+
+typedef struct MeshletCullStatistics {
+	uint32_t             m_TotalMeshlets;
+	uint32_t             m_TotalTriangles;
+	uint32_t             m_VisibleMeshlets;
+	uint32_t             m_VisibleTriangles;
+} MeshletCullStatistics;
+
+
+/**
+ * GPU meshlet (cluster) culling, frustum & normal cone tests run before rasterization either in a
+ * compute pass feeding indexed indirect draws, or in a task shader when VK_EXT_mesh_shader is available.
+ */
+class VulkanMeshletCuller
+{
+public:
+	VulkanMeshletCuller();
+	virtual ~VulkanMeshletCuller();
+
+	bool Create(const VulkanMeshletCullerCreateInfo& createInfo, const MeshletMesh& mesh, const glm::vec3* positions, size_t vertexCount);
+	// Match the render pass' attachments, see VulkanSceneAttachments for the driver's scene passes.
+	bool CreateDrawPipeline(VkRenderPass renderPass, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT, bool depthTest = false);
+	// For the driver's scene passes, with render pass objects or dynamic rendering.
+	bool CreateDrawPipeline(const VulkanSceneAttachments& sceneAttachments, VkRenderPass sceneRenderPass);
+	void Destroy();
+
+	// Record outside of a render pass, no-op on the mesh shader path since culling happens in the task shader.
+	void RecordCull(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, const glm::vec3& cameraPosition);
+	// Record inside the pass the draw pipeline was created for, viewport & scissor are dynamic.
+	void RecordDraw(VkCommandBuffer commandBuffer, const VkViewport& viewport, const VkRect2D& scissor);
+
+	// Counters of the last cull, read straight from mapped memory without synchronization: call it only after waiting on
+	// the fence of the submission that recorded RecordCull(), & before another one is submitted, a later cull in flight
+	// rewrites them. There is a single set of counters whatever the frames in flight.
+	MeshletCullStatistics GetStatistics() const;
+
+	bool UseMeshShader() const { return m_CreateInfo.m_MeshShaderSupported; }
+
+private:
+	bool BuildDrawPipeline(VkRenderPass renderPass, VkSampleCountFlagBits samples, bool depthTest, const VulkanSceneAttachments* sceneAttachments);
+
+	VulkanMeshletCullerCreateInfo       m_CreateInfo;
+	uint32_t                            m_MeshletCount;
+	uint32_t                            m_TriangleCount;
+	MeshletCullParams                   m_Params;
+	VkShaderStageFlags                  m_PushConstantStages;
+
+	VulkanBuffer                        m_BoundsBuffer;
+	VulkanBuffer                        m_MeshletBuffer;
+	VulkanBuffer                        m_DrawCommandBuffer;
+	VulkanBuffer                        m_DrawCountBuffer;
+	VulkanBuffer                        m_PositionBuffer;
+	VulkanBuffer                        m_IndexBuffer;
+	VulkanBuffer                        m_MeshletVertexBuffer;
+	VulkanBuffer                        m_MeshletTriangleBuffer;
+
+	VkDescriptorSetLayout               m_DescriptorSetLayout;
+	VkDescriptorPool                    m_DescriptorPool;
+	VkDescriptorSet                     m_DescriptorSet;
+	VkPipelineLayout                    m_PipelineLayout;
+	VkPipeline                          m_CullPipeline;
+	VkPipeline                          m_DrawPipeline;
+
+	PFN_vkCmdDrawIndexedIndirectCountKHR m_CmdDrawIndexedIndirectCount;
+#if defined(VK_EXT_mesh_shader)
+	PFN_vkCmdDrawMeshTasksEXT           m_CmdDrawMeshTasks;
+#endif
+
+	bool CreateCullPipeline();
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,729 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanOcclusionCuller.h"
+
+
+__BEGIN_NAMESPACE
+
+// OCCLUSION_GROUP_SIZE, HIZ_TILE_SIZE & HIZ_MAX_LEVELS of occlusion_common.glsl.
+static const uint32_t OCCLUSION_GROUP_SIZE = 64;
+static const uint32_t HIZ_TILE_SIZE = 64;
+static const uint32_t HIZ_MAX_SIZE = 1u << (VulkanOcclusionCuller::MAX_PYRAMID_LEVELS - 1);
+// The early phase's dispatch stays within the 65535 groups all devices support.
+static const uint32_t OCCLUSION_MAX_INSTANCES = 65535 * OCCLUSION_GROUP_SIZE;
+static const VkFormat HIZ_FORMAT = VK_FORMAT_R32_SFLOAT;
+// Early phase start & end, late phase start, pyramid end & late phase end.
+static const uint32_t OCCLUSION_TIMESTAMPS = 5;
+
+enum CullBinding
+{
+    CullBinding_Frame = 0,
+    CullBinding_Bounds,
+    CullBinding_Pyramid,
+    CullBinding_Counters,
+    CullBinding_VisibleList,
+    CullBinding_RetestList,
+    CullBinding_Count,
+};
+
+enum PyramidBinding
+{
+    PyramidBinding_Depth = 0,
+    PyramidBinding_Levels,
+    PyramidBinding_Counter,
+    PyramidBinding_Count,
+};
+
+// Same layout as OcclusionCounters of occlusion_common.glsl.
+typedef struct OcclusionCounters {
+	VkDrawIndirectCommand    m_EarlyDraw;
+	VkDrawIndirectCommand    m_LateDraw;
+	uint32_t                 m_RetestCount;
+	uint32_t                 m_LateDispatch[3];
+} OcclusionCounters;
+
+// Same layout as the OcclusionFrame uniform block of occlusion_cull.shader.comp.
+typedef struct OcclusionFrameConstants {
+	glm::mat4                m_ViewProjection;
+	glm::mat4                m_OcclusionViewProjection;
+	glm::vec4                m_PyramidSize;
+	glm::uvec4               m_Params;           // x: instance count, y: pyramid valid, z: pyramid levels
+} OcclusionFrameConstants;
+
+// Same layout as the OcclusionPhase push constants of occlusion_cull.shader.comp.
+typedef struct OcclusionPhaseConstants {
+	uint32_t                 m_Late;
+	uint32_t                 m_MaxInstances;
+} OcclusionPhaseConstants;
+
+// Same layout as the HiZConstants push constants of hiz_build.shader.comp.
+typedef struct HiZConstants {
+	uint32_t                 m_DepthSize[2];
+	uint32_t                 m_PyramidSize[2];
+	uint32_t                 m_LevelCount;
+} HiZConstants;
+
+// Largest power of two not above value, so every pyramid level halves the one below exactly.
+static uint32_t PreviousPowerOfTwo(uint32_t value)
+{
+    uint32_t power = 1;
+    while (power * 2 <= value) {
+        power <<= 1;
+    }
+    return power;
+}
+
+
+VulkanOcclusionCuller::VulkanOcclusionCuller() :
+	m_CreateInfo{},
+	m_InstanceCount(0),
+	m_ViewProjection(1.0f),
+	m_PyramidViewProjection(1.0f),
+	m_PyramidValid(false),
+	m_DepthExtent({ 0, 0 }),
+	m_PyramidExtent({ 0, 0 }),
+	m_PyramidLevels(0),
+	m_LevelViews{},
+	m_PyramidInitialized(false),
+	m_Sampler(VK_NULL_HANDLE),
+	m_CullSetLayout(VK_NULL_HANDLE),
+	m_PyramidSetLayout(VK_NULL_HANDLE),
+	m_DescriptorPool(VK_NULL_HANDLE),
+	m_PyramidSet(VK_NULL_HANDLE),
+	m_CullPipelineLayout(VK_NULL_HANDLE),
+	m_PyramidPipelineLayout(VK_NULL_HANDLE),
+	m_CullPipeline(VK_NULL_HANDLE),
+	m_PyramidPipeline(VK_NULL_HANDLE),
+	m_QueryPool(VK_NULL_HANDLE),
+	m_TimestampPeriod(1.0),
+	m_TimestampMask(UINT64_MAX),
+	m_LastStats({ 0, 0, 0, 0, 0.0, 0.0 })
+{
+}
+
+VulkanOcclusionCuller::~VulkanOcclusionCuller()
+{
+}
+
+bool VulkanOcclusionCuller::Create(const VulkanOcclusionCullerCreateInfo& createInfo)
+{
+    m_CreateInfo = createInfo;
+    m_CreateInfo.m_FramesInFlight = std::max(m_CreateInfo.m_FramesInFlight, 1u);
+    m_CreateInfo.m_MaxInstances = std::max(1u, std::min(m_CreateInfo.m_MaxInstances, OCCLUSION_MAX_INSTANCES));
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+
+    /****************************************************************************
+     * Bounds & constants from the host, lists & counters only ever touched by
+     * the GPU but for the counters' copy back
+     ****************************************************************************/
+    VkDeviceSize maxInstances = m_CreateInfo.m_MaxInstances;
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, maxInstances * sizeof(OcclusionBounds), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_BoundsBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, maxInstances * 2 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_VisibleBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, maxInstances * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_RetestBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, sizeof(OcclusionCounters),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_CounterBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_PyramidCounterBuffer));
+    m_FrameBuffers.resize(m_CreateInfo.m_FramesInFlight);
+    m_StatsBuffers.resize(m_CreateInfo.m_FramesInFlight);
+    for (uint32_t i = 0; i < m_CreateInfo.m_FramesInFlight; i++) {
+        VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, sizeof(OcclusionFrameConstants), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_FrameBuffers[i]));
+        VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, sizeof(OcclusionCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_StatsBuffers[i]));
+        memset(m_StatsBuffers[i].m_Mapped, 0, sizeof(OcclusionCounters));
+    }
+
+    // Texels are read exactly, a filtered depth would no longer be the farthest.
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = (float)VulkanOcclusionCuller::MAX_PYRAMID_LEVELS;
+    if (vkCreateSampler(device, &samplerInfo, GetVulkanAllocator(), &m_Sampler) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create occlusion culling sampler.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VULKAN_DRIVER_CHECK_FUN(CreateDescriptors());
+    VULKAN_DRIVER_CHECK_FUN(CreatePipelines());
+
+    /****************************************************************************
+     * Timestamps around both phases & the pyramid, five per frame in flight
+     ****************************************************************************/
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    uint32_t validBits = (m_CreateInfo.m_QueueFamilyIndex < queueFamilyCount) ? queueFamilies[m_CreateInfo.m_QueueFamilyIndex].timestampValidBits : 0;
+
+    if (0 != validBits && deviceProperties.limits.timestampPeriod > 0.0f) {
+        m_TimestampPeriod = deviceProperties.limits.timestampPeriod;
+        m_TimestampMask = (validBits >= 64) ? UINT64_MAX : ((1ull << validBits) - 1);
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = m_CreateInfo.m_FramesInFlight * OCCLUSION_TIMESTAMPS;
+        if (vkCreateQueryPool(device, &queryPoolInfo, GetVulkanAllocator(), &m_QueryPool) != VK_SUCCESS) {
+            m_QueryPool = VK_NULL_HANDLE;
+        }
+    }
+    m_QueryWritten.assign(m_CreateInfo.m_FramesInFlight, false);
+
+    std::cout << "Vulkan occlusion culler created, " << m_CreateInfo.m_MaxInstances << " instances.\n";
+    return true;
+}
+
+bool VulkanOcclusionCuller::CreateDescriptors()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    uint32_t framesInFlight = m_CreateInfo.m_FramesInFlight;
+
+    VkDescriptorSetLayoutBinding cullBindings[CullBinding_Count]{};
+    for (uint32_t i = 0; i < CullBinding_Count; i++) {
+        cullBindings[i].binding = i;
+        cullBindings[i].descriptorCount = 1;
+        cullBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    cullBindings[CullBinding_Frame].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    cullBindings[CullBinding_Pyramid].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    VkDescriptorSetLayoutBinding pyramidBindings[PyramidBinding_Count]{};
+    for (uint32_t i = 0; i < PyramidBinding_Count; i++) {
+        pyramidBindings[i].binding = i;
+        pyramidBindings[i].descriptorCount = 1;
+        pyramidBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    pyramidBindings[PyramidBinding_Depth].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pyramidBindings[PyramidBinding_Levels].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    pyramidBindings[PyramidBinding_Levels].descriptorCount = MAX_PYRAMID_LEVELS;
+    pyramidBindings[PyramidBinding_Counter].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = CullBinding_Count;
+    layoutInfo.pBindings = cullBindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_CullSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create occlusion culling descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    layoutInfo.bindingCount = PyramidBinding_Count;
+    layoutInfo.pBindings = pyramidBindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_PyramidSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create depth pyramid descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSizes[4] = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, framesInFlight },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, framesInFlight * 4 + 1 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, framesInFlight + 1 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_PYRAMID_LEVELS },
+    };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = framesInFlight + 1;
+    poolInfo.poolSizeCount = 4;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(device, &poolInfo, GetVulkanAllocator(), &m_DescriptorPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create occlusion culling descriptor pool.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    std::vector<VkDescriptorSetLayout> setLayouts(framesInFlight, m_CullSetLayout);
+    m_CullSets.resize(framesInFlight);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = framesInFlight;
+    allocInfo.pSetLayouts = setLayouts.data();
+    if (vkAllocateDescriptorSets(device, &allocInfo, m_CullSets.data()) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate occlusion culling descriptor sets.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_PyramidSetLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_PyramidSet) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate depth pyramid descriptor set.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    // The buffers never change, the images are written by CreateTargets().
+    std::vector<VkDescriptorBufferInfo> bufferInfos(framesInFlight * 5 + 1);
+    std::vector<VkWriteDescriptorSet> writes(framesInFlight * 5 + 1);
+    const VulkanBuffer* sharedBuffers[4] = { &m_BoundsBuffer, &m_CounterBuffer, &m_VisibleBuffer, &m_RetestBuffer };
+    const uint32_t sharedBindings[4] = { CullBinding_Bounds, CullBinding_Counters, CullBinding_VisibleList, CullBinding_RetestList };
+    uint32_t writeCount = 0;
+    for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+        for (uint32_t i = 0; i < 5; i++) {
+            const VulkanBuffer& buffer = (0 == i) ? m_FrameBuffers[frame] : *sharedBuffers[i - 1];
+            bufferInfos[writeCount] = { buffer.m_Buffer, 0, VK_WHOLE_SIZE };
+            writes[writeCount].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[writeCount].dstSet = m_CullSets[frame];
+            writes[writeCount].dstBinding = (0 == i) ? (uint32_t)CullBinding_Frame : sharedBindings[i - 1];
+            writes[writeCount].descriptorCount = 1;
+            writes[writeCount].descriptorType = (0 == i) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[writeCount].pBufferInfo = &bufferInfos[writeCount];
+            writeCount++;
+        }
+    }
+    bufferInfos[writeCount] = { m_PyramidCounterBuffer.m_Buffer, 0, VK_WHOLE_SIZE };
+    writes[writeCount].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[writeCount].dstSet = m_PyramidSet;
+    writes[writeCount].dstBinding = PyramidBinding_Counter;
+    writes[writeCount].descriptorCount = 1;
+    writes[writeCount].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[writeCount].pBufferInfo = &bufferInfos[writeCount];
+    writeCount++;
+    vkUpdateDescriptorSets(device, writeCount, writes.data(), 0, nullptr);
+    return true;
+}
+
+bool VulkanOcclusionCuller::CreatePipelines()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(OcclusionPhaseConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_CullSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_CullPipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create occlusion culling pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    pushConstantRange.size = sizeof(HiZConstants);
+    pipelineLayoutInfo.pSetLayouts = &m_PyramidSetLayout;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_PyramidPipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create depth pyramid pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkShaderModule cullModule = LoadShaderModule(device, "Data/Engine/occlusion_cull.cs.spv");
+    VkShaderModule pyramidModule = LoadShaderModule(device, "Data/Engine/hiz_build.cs.spv");
+
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+    if (VK_NULL_HANDLE != cullModule && VK_NULL_HANDLE != pyramidModule) {
+        VkComputePipelineCreateInfo pipelineInfos[2]{};
+        VkShaderModule modules[2] = { cullModule, pyramidModule };
+        VkPipelineLayout layouts[2] = { m_CullPipelineLayout, m_PyramidPipelineLayout };
+        for (uint32_t i = 0; i < 2; i++) {
+            pipelineInfos[i].sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineInfos[i].stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            pipelineInfos[i].stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            pipelineInfos[i].stage.module = modules[i];
+            pipelineInfos[i].stage.pName = "main";
+            pipelineInfos[i].layout = layouts[i];
+        }
+        VkPipeline pipelines[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+        result = vkCreateComputePipelines(device, m_CreateInfo.m_PipelineCache, 2, pipelineInfos, GetVulkanAllocator(), pipelines);
+        m_CullPipeline = pipelines[0];
+        m_PyramidPipeline = pipelines[1];
+    }
+
+    VkShaderModule shaderModules[2] = { cullModule, pyramidModule };
+    for (VkShaderModule shaderModule : shaderModules) {
+        if (VK_NULL_HANDLE != shaderModule) {
+            vkDestroyShaderModule(device, shaderModule, GetVulkanAllocator());
+        }
+    }
+
+    if (VK_SUCCESS != result) {
+        std::cout << "Vulkan failed to create occlusion culling pipelines.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanOcclusionCuller::CreateTargets(VkExtent2D depthExtent, VkImageView depthView)
+{
+    DestroyTargets();
+    VkDevice device = m_CreateInfo.m_Device;
+
+    // Level 0 is at most the depth's size, its texels straddle up to two depth texels a side.
+    m_PyramidExtent.width = PreviousPowerOfTwo(std::max(1u, std::min(depthExtent.width, HIZ_MAX_SIZE)));
+    m_PyramidExtent.height = PreviousPowerOfTwo(std::max(1u, std::min(depthExtent.height, HIZ_MAX_SIZE)));
+    m_PyramidLevels = 1;
+    while ((1u << (m_PyramidLevels - 1)) < std::max(m_PyramidExtent.width, m_PyramidExtent.height)) {
+        m_PyramidLevels++;
+    }
+    VULKAN_DRIVER_CHECK_FUN(CreateImage2DMips(device, m_CreateInfo.m_PhysicalDevice, m_PyramidExtent, m_PyramidLevels, HIZ_FORMAT,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_Pyramid));
+
+    for (uint32_t level = 0; level < m_PyramidLevels; level++) {
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = m_Pyramid.m_Image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = HIZ_FORMAT;
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+        if (vkCreateImageView(device, &viewInfo, GetVulkanAllocator(), &m_LevelViews[level]) != VK_SUCCESS) {
+            std::cout << "Vulkan failed to create depth pyramid level view.\n";
+            SetErrorCode(ErrorCode::UnKnow);
+            DestroyTargets();
+            return false;
+        }
+    }
+    // The shader's array is always full, levels past the pyramid's are never written.
+    for (uint32_t level = m_PyramidLevels; level < MAX_PYRAMID_LEVELS; level++) {
+        m_LevelViews[level] = m_LevelViews[m_PyramidLevels - 1];
+    }
+
+    UpdateDescriptors(depthView);
+    m_DepthExtent = depthExtent;
+    m_PyramidInitialized = false;
+    m_PyramidValid = false;
+    return true;
+}
+
+void VulkanOcclusionCuller::UpdateDescriptors(VkImageView depthView)
+{
+    uint32_t framesInFlight = m_CreateInfo.m_FramesInFlight;
+    std::vector<VkWriteDescriptorSet> writes(framesInFlight + 2);
+    // Written by the build & sampled by the culling in the general layout, the pyramid never leaves it.
+    VkDescriptorImageInfo pyramidInfo = { m_Sampler, m_Pyramid.m_View, VK_IMAGE_LAYOUT_GENERAL };
+    for (uint32_t frame = 0; frame < framesInFlight; frame++) {
+        writes[frame].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[frame].dstSet = m_CullSets[frame];
+        writes[frame].dstBinding = CullBinding_Pyramid;
+        writes[frame].descriptorCount = 1;
+        writes[frame].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[frame].pImageInfo = &pyramidInfo;
+    }
+
+    VkDescriptorImageInfo depthInfo = { m_Sampler, depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+    VkWriteDescriptorSet& depthWrite = writes[framesInFlight];
+    depthWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    depthWrite.dstSet = m_PyramidSet;
+    depthWrite.dstBinding = PyramidBinding_Depth;
+    depthWrite.descriptorCount = 1;
+    depthWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    depthWrite.pImageInfo = &depthInfo;
+
+    VkDescriptorImageInfo levelInfos[MAX_PYRAMID_LEVELS];
+    for (uint32_t level = 0; level < MAX_PYRAMID_LEVELS; level++) {
+        levelInfos[level] = { VK_NULL_HANDLE, m_LevelViews[level], VK_IMAGE_LAYOUT_GENERAL };
+    }
+    VkWriteDescriptorSet& levelsWrite = writes[framesInFlight + 1];
+    levelsWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    levelsWrite.dstSet = m_PyramidSet;
+    levelsWrite.dstBinding = PyramidBinding_Levels;
+    levelsWrite.descriptorCount = MAX_PYRAMID_LEVELS;
+    levelsWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    levelsWrite.pImageInfo = levelInfos;
+
+    vkUpdateDescriptorSets(m_CreateInfo.m_Device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+}
+
+void VulkanOcclusionCuller::DestroyTargets()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    for (uint32_t level = 0; level < m_PyramidLevels; level++) {
+        if (VK_NULL_HANDLE != m_LevelViews[level]) {
+            vkDestroyImageView(device, m_LevelViews[level], GetVulkanAllocator());
+        }
+    }
+    for (VkImageView& view : m_LevelViews) {
+        view = VK_NULL_HANDLE;
+    }
+    DestroyImage(device, m_Pyramid);
+    m_DepthExtent = { 0, 0 };
+    m_PyramidExtent = { 0, 0 };
+    m_PyramidLevels = 0;
+    m_PyramidValid = false;
+}
+
+void VulkanOcclusionCuller::SetBounds(const OcclusionBounds* bounds, uint32_t instanceCount)
+{
+    m_InstanceCount = std::min(instanceCount, m_CreateInfo.m_MaxInstances);
+    memcpy(m_BoundsBuffer.m_Mapped, bounds, (size_t)m_InstanceCount * sizeof(OcclusionBounds));
+}
+
+void VulkanOcclusionCuller::GetVertexInputState(VkVertexInputBindingDescription& binding, VkVertexInputAttributeDescription& attribute)
+{
+    binding.binding = 0;
+    binding.stride = sizeof(uint32_t);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+    attribute.location = 0;
+    attribute.binding = 0;
+    attribute.format = VK_FORMAT_R32_UINT;
+    attribute.offset = 0;
+}
+
+VkDeviceSize VulkanOcclusionCuller::GetMemoryBytes() const
+{
+    VkDeviceSize pyramidBytes = 0;
+    for (uint32_t level = 0; level < m_PyramidLevels; level++) {
+        pyramidBytes += (VkDeviceSize)std::max(m_PyramidExtent.width >> level, 1u) * std::max(m_PyramidExtent.height >> level, 1u) * GetFormatSize(HIZ_FORMAT);
+    }
+    return m_BoundsBuffer.m_Size + m_VisibleBuffer.m_Size + m_RetestBuffer.m_Size + m_CounterBuffer.m_Size + pyramidBytes;
+}
+
+void VulkanOcclusionCuller::RecordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex, bool late)
+{
+    OcclusionPhaseConstants constants = { late ? 1u : 0u, m_CreateInfo.m_MaxInstances };
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_CullPipelineLayout, 0, 1, &m_CullSets[frameIndex], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_CullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(OcclusionPhaseConstants), &constants);
+    if (late) {
+        vkCmdDispatchIndirect(commandBuffer, m_CounterBuffer.m_Buffer, offsetof(OcclusionCounters, m_LateDispatch));
+    } else {
+        vkCmdDispatch(commandBuffer, (m_InstanceCount + OCCLUSION_GROUP_SIZE - 1) / OCCLUSION_GROUP_SIZE, 1, 1);
+    }
+
+    // Drawn from the lists, & the early phase sizes the late one's dispatch.
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_SHADER_READ_BIT |
+        VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanOcclusionCuller::RecordEarlyCull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4& viewProjection)
+{
+    PROFILE_FUNCTION();
+    if (VK_NULL_HANDLE == m_CullPipeline || VK_NULL_HANDLE == m_Pyramid.m_Image) {
+        return;
+    }
+
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdResetQueryPool(commandBuffer, m_QueryPool, frameIndex * OCCLUSION_TIMESTAMPS, OCCLUSION_TIMESTAMPS);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, frameIndex * OCCLUSION_TIMESTAMPS);
+    }
+
+    // The frame slot's fence signaled, its constants are free.
+    m_ViewProjection = viewProjection;
+    OcclusionFrameConstants* frame = (OcclusionFrameConstants*)m_FrameBuffers[frameIndex].m_Mapped;
+    frame->m_ViewProjection = viewProjection;
+    frame->m_OcclusionViewProjection = m_PyramidViewProjection;
+    frame->m_PyramidSize = glm::vec4((float)m_PyramidExtent.width, (float)m_PyramidExtent.height, 0.0f, 0.0f);
+    frame->m_Params = glm::uvec4(m_InstanceCount, m_PyramidValid ? 1u : 0u, m_PyramidLevels, 0u);
+
+    if (!m_PyramidInitialized) {
+        CmdImageBarrier(commandBuffer, m_Pyramid.m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+        m_PyramidInitialized = true;
+    }
+
+    // The previous frame's draws & culling read the counters this one restarts.
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+    OcclusionCounters counters{};
+    counters.m_EarlyDraw.vertexCount = m_CreateInfo.m_VertexCount;
+    counters.m_LateDraw.vertexCount = m_CreateInfo.m_VertexCount;
+    counters.m_LateDispatch[1] = 1;
+    counters.m_LateDispatch[2] = 1;
+    vkCmdUpdateBuffer(commandBuffer, m_CounterBuffer.m_Buffer, 0, sizeof(OcclusionCounters), &counters);
+
+    VkMemoryBarrier resetBarrier{};
+    resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    resetBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    resetBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &resetBarrier, 0, nullptr, 0, nullptr);
+
+    RecordCull(commandBuffer, frameIndex, false);
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, frameIndex * OCCLUSION_TIMESTAMPS + 1);
+    }
+}
+
+void VulkanOcclusionCuller::RecordEarlyDraw(VkCommandBuffer commandBuffer)
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_VisibleBuffer.m_Buffer, &offset);
+    vkCmdDrawIndirect(commandBuffer, m_CounterBuffer.m_Buffer, offsetof(OcclusionCounters, m_EarlyDraw), 1, sizeof(VkDrawIndirectCommand));
+}
+
+void VulkanOcclusionCuller::RecordPyramid(VkCommandBuffer commandBuffer)
+{
+    // The early phase sampled the previous pyramid, the pass out of which the depth comes made it readable.
+    vkCmdFillBuffer(commandBuffer, m_PyramidCounterBuffer.m_Buffer, 0, sizeof(uint32_t), 0);
+    VkMemoryBarrier fillBarrier{};
+    fillBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    fillBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    fillBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+        1, &fillBarrier, 0, nullptr, 0, nullptr);
+
+    HiZConstants constants = { { m_DepthExtent.width, m_DepthExtent.height }, { m_PyramidExtent.width, m_PyramidExtent.height }, m_PyramidLevels };
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PyramidPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PyramidPipelineLayout, 0, 1, &m_PyramidSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_PyramidPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HiZConstants), &constants);
+    vkCmdDispatch(commandBuffer, (m_PyramidExtent.width + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE, (m_PyramidExtent.height + HIZ_TILE_SIZE - 1) / HIZ_TILE_SIZE, 1);
+
+    VkMemoryBarrier pyramidBarrier{};
+    pyramidBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    pyramidBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    pyramidBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &pyramidBarrier, 0, nullptr, 0, nullptr);
+
+    // The next frame's early phase reprojects through this frame's camera.
+    m_PyramidViewProjection = m_ViewProjection;
+    m_PyramidValid = true;
+}
+
+void VulkanOcclusionCuller::RecordLateCull(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    PROFILE_FUNCTION();
+    if (VK_NULL_HANDLE == m_CullPipeline || VK_NULL_HANDLE == m_Pyramid.m_Image) {
+        return;
+    }
+
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    uint32_t firstQuery = frameIndex * OCCLUSION_TIMESTAMPS;
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, firstQuery + 2);
+    }
+    RecordPyramid(commandBuffer);
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, firstQuery + 3);
+    }
+    RecordCull(commandBuffer, frameIndex, true);
+
+    // Both phases' counts are final, copied for CollectStats().
+    VkBufferCopy region = { 0, 0, sizeof(OcclusionCounters) };
+    vkCmdCopyBuffer(commandBuffer, m_CounterBuffer.m_Buffer, m_StatsBuffers[frameIndex].m_Buffer, 1, &region);
+    VkBufferMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.buffer = m_StatsBuffers[frameIndex].m_Buffer;
+    hostBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, firstQuery + 4);
+        m_QueryWritten[frameIndex] = true;
+    }
+}
+
+void VulkanOcclusionCuller::RecordLateDraw(VkCommandBuffer commandBuffer)
+{
+    VkDeviceSize offset = (VkDeviceSize)m_CreateInfo.m_MaxInstances * sizeof(uint32_t);
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_VisibleBuffer.m_Buffer, &offset);
+    vkCmdDrawIndirect(commandBuffer, m_CounterBuffer.m_Buffer, offsetof(OcclusionCounters, m_LateDraw), 1, sizeof(VkDrawIndirectCommand));
+}
+
+void VulkanOcclusionCuller::CollectStats(uint32_t frameIndex)
+{
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    const OcclusionCounters* counters = (const OcclusionCounters*)m_StatsBuffers[frameIndex].m_Mapped;
+    uint32_t earlyVisible = counters->m_EarlyDraw.instanceCount;
+    uint32_t retested = counters->m_RetestCount;
+    m_LastStats.m_EarlyVisible = earlyVisible;
+    m_LastStats.m_LateVisible = counters->m_LateDraw.instanceCount;
+    m_LastStats.m_Occluded = retested - std::min(m_LastStats.m_LateVisible, retested);
+    m_LastStats.m_FrustumCulled = m_InstanceCount - std::min(earlyVisible + retested, m_InstanceCount);
+
+    if (VK_NULL_HANDLE == m_QueryPool || !m_QueryWritten[frameIndex]) {
+        return;
+    }
+    uint64_t timestamps[OCCLUSION_TIMESTAMPS] = {};
+    if (VK_SUCCESS != vkGetQueryPoolResults(m_CreateInfo.m_Device, m_QueryPool, frameIndex * OCCLUSION_TIMESTAMPS, OCCLUSION_TIMESTAMPS,
+        sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT)) {
+        return;
+    }
+    m_QueryWritten[frameIndex] = false;
+    uint64_t cullTicks = ((timestamps[1] - timestamps[0]) & m_TimestampMask) + ((timestamps[4] - timestamps[3]) & m_TimestampMask);
+    m_LastStats.m_CullGpuMs = cullTicks * m_TimestampPeriod / 1000000.0;
+    m_LastStats.m_PyramidGpuMs = ((timestamps[3] - timestamps[2]) & m_TimestampMask) * m_TimestampPeriod / 1000000.0;
+    PROFILE_COUNTER("OcclusionCullGpuMs", m_LastStats.m_CullGpuMs);
+    PROFILE_COUNTER("HiZPyramidGpuMs", m_LastStats.m_PyramidGpuMs);
+}
+
+void VulkanOcclusionCuller::Destroy()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE == device) {
+        return;
+    }
+
+    DestroyTargets();
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkDestroyQueryPool(device, m_QueryPool, GetVulkanAllocator());
+        m_QueryPool = VK_NULL_HANDLE;
+    }
+    m_QueryWritten.clear();
+    VkPipeline* pipelines[2] = { &m_CullPipeline, &m_PyramidPipeline };
+    VkPipelineLayout* layouts[2] = { &m_CullPipelineLayout, &m_PyramidPipelineLayout };
+    VkDescriptorSetLayout* setLayouts[2] = { &m_CullSetLayout, &m_PyramidSetLayout };
+    for (uint32_t i = 0; i < 2; i++) {
+        if (VK_NULL_HANDLE != *pipelines[i]) {
+            vkDestroyPipeline(device, *pipelines[i], GetVulkanAllocator());
+            *pipelines[i] = VK_NULL_HANDLE;
+        }
+        if (VK_NULL_HANDLE != *layouts[i]) {
+            vkDestroyPipelineLayout(device, *layouts[i], GetVulkanAllocator());
+            *layouts[i] = VK_NULL_HANDLE;
+        }
+    }
+    if (VK_NULL_HANDLE != m_DescriptorPool) {
+        vkDestroyDescriptorPool(device, m_DescriptorPool, GetVulkanAllocator());
+        m_DescriptorPool = VK_NULL_HANDLE;
+        m_CullSets.clear();
+        m_PyramidSet = VK_NULL_HANDLE;
+    }
+    for (uint32_t i = 0; i < 2; i++) {
+        if (VK_NULL_HANDLE != *setLayouts[i]) {
+            vkDestroyDescriptorSetLayout(device, *setLayouts[i], GetVulkanAllocator());
+            *setLayouts[i] = VK_NULL_HANDLE;
+        }
+    }
+    if (VK_NULL_HANDLE != m_Sampler) {
+        vkDestroySampler(device, m_Sampler, GetVulkanAllocator());
+        m_Sampler = VK_NULL_HANDLE;
+    }
+    for (VulkanBuffer& buffer : m_StatsBuffers) {
+        DestroyBuffer(device, buffer);
+    }
+    m_StatsBuffers.clear();
+    for (VulkanBuffer& buffer : m_FrameBuffers) {
+        DestroyBuffer(device, buffer);
+    }
+    m_FrameBuffers.clear();
+    DestroyBuffer(device, m_PyramidCounterBuffer);
+    DestroyBuffer(device, m_CounterBuffer);
+    DestroyBuffer(device, m_RetestBuffer);
+    DestroyBuffer(device, m_VisibleBuffer);
+    DestroyBuffer(device, m_BoundsBuffer);
+    m_InstanceCount = 0;
+    m_CreateInfo.m_Device = VK_NULL_HANDLE;
+}
+
+__END_NAMESPACE
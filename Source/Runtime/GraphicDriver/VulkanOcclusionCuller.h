@@ -0,0 +1,130 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+typedef struct VulkanOcclusionCullerCreateInfo {
+	VkDevice             m_Device;
+	VkPhysicalDevice     m_PhysicalDevice;
+	VkPipelineCache      m_PipelineCache;
+	uint32_t             m_QueueFamilyIndex;          // Of the queue the culling is recorded for, for timestamps
+	uint32_t             m_FramesInFlight = 1;        // Frame constants, statistics & timestamp slots, the pyramid & lists are shared in submission order
+	uint32_t             m_MaxInstances = 1 << 16;
+	uint32_t             m_VertexCount;               // Of the non indexed draw every instance is
+} VulkanOcclusionCullerCreateInfo;
+
+// World space axis aligned box, std430 layout of occlusion_common.glsl.
+typedef struct OcclusionBounds {
+	glm::vec4            m_Center;
+	glm::vec4            m_Extent;                    // Half size, w unused
+} OcclusionBounds;
+
+typedef struct OcclusionCullStats {
+	uint32_t             m_EarlyVisible;              // Drawn by the early phase
+	uint32_t             m_LateVisible;               // Hidden in the previous frame's pyramid, drawn by the late phase
+	uint32_t             m_Occluded;
+	uint32_t             m_FrustumCulled;
+	double               m_CullGpuMs;                 // Both culling phases, 0 without timestamp support
+	double               m_PyramidGpuMs;
+} OcclusionCullStats;
+
+
+/**
+ * Two phase occlusion culling of instances against a hierarchical depth pyramid, all on the GPU.
+ *
+ * The early phase tests every instance against the frustum & against the pyramid the previous frame left,
+ * through the previous frame's camera, and draws the ones visible in it. The pyramid is then rebuilt from the
+ * depth those drew, in a single dispatch whose last group finishes the levels the others can't, and the late
+ * phase retests the instances the early one found hidden, drawing the ones that came into view. An instance
+ * is thus never missing for a frame because it was hidden in the previous one.
+ *
+ * Each phase compacts the indices of its visible instances into a list the draw reads as a per instance
+ * vertex attribute, see GetVertexInputState(), with its instance count in an indirect draw.
+ */
+class VulkanOcclusionCuller
+{
+public:
+	VulkanOcclusionCuller();
+	virtual ~VulkanOcclusionCuller();
+
+	bool Create(const VulkanOcclusionCullerCreateInfo& createInfo);
+	void Destroy();
+	// The depth the early phase draws into, single sampled & left in DEPTH_STENCIL_READ_ONLY_OPTIMAL by its pass.
+	bool CreateTargets(VkExtent2D depthExtent, VkImageView depthView);
+	void DestroyTargets();
+
+	// Copied to host visible memory, call between frames. Instances past the count are never drawn.
+	void SetBounds(const OcclusionBounds* bounds, uint32_t instanceCount);
+	// The next early phase finds no pyramid & draws everything in the frustum, for a camera cut.
+	void ResetHistory() { m_PyramidValid = false; }
+
+	// Record outside of a render pass, before the early draw.
+	void RecordEarlyCull(VkCommandBuffer commandBuffer, uint32_t frameIndex, const glm::mat4& viewProjection);
+	// Record inside a pass drawing into the depth, the instance list pipeline bound. Draws m_VertexCount vertices per visible instance.
+	void RecordEarlyDraw(VkCommandBuffer commandBuffer);
+	// Record outside of a render pass, once the early pass stored its depth: builds the pyramid & culls the late phase.
+	void RecordLateCull(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	// Record inside a pass loading what the early one stored.
+	void RecordLateDraw(VkCommandBuffer commandBuffer);
+	// Once the frame slot's fence signaled, reads back its counts & GPU times.
+	void CollectStats(uint32_t frameIndex);
+	const OcclusionCullStats& GetLastStats() const { return m_LastStats; }
+
+	// Binding 0 at the instance rate, a uint instance index at location 0.
+	static void GetVertexInputState(VkVertexInputBindingDescription& binding, VkVertexInputAttributeDescription& attribute);
+	uint32_t GetMaxInstances() const { return m_CreateInfo.m_MaxInstances; }
+	VkExtent2D GetPyramidExtent() const { return m_PyramidExtent; }
+	// Bytes of the bounds, lists, counters & pyramid.
+	VkDeviceSize GetMemoryBytes() const;
+
+	static const uint32_t MAX_PYRAMID_LEVELS = 13;
+
+private:
+	VulkanOcclusionCullerCreateInfo    m_CreateInfo;
+	uint32_t                           m_InstanceCount;
+	glm::mat4                          m_ViewProjection;     // This frame's, the pyramid's once it's rebuilt
+	glm::mat4                          m_PyramidViewProjection;
+	bool                               m_PyramidValid;
+
+	VulkanBuffer                       m_BoundsBuffer;
+	VulkanBuffer                       m_VisibleBuffer;
+	VulkanBuffer                       m_RetestBuffer;
+	VulkanBuffer                       m_CounterBuffer;
+	VulkanBuffer                       m_PyramidCounterBuffer;
+	std::vector<VulkanBuffer>          m_FrameBuffers;       // Per frame in flight, constants of both phases
+	std::vector<VulkanBuffer>          m_StatsBuffers;       // Per frame in flight, the counters copied back
+
+	VkExtent2D                         m_DepthExtent;
+	VkExtent2D                         m_PyramidExtent;
+	uint32_t                           m_PyramidLevels;
+	VulkanImage                        m_Pyramid;            // Its view covers all levels, sampled by the culling
+	VkImageView                        m_LevelViews[MAX_PYRAMID_LEVELS];  // Written by the build, the ones past the levels alias the last
+	bool                               m_PyramidInitialized; // Out of the undefined layout
+	VkSampler                          m_Sampler;
+
+	VkDescriptorSetLayout              m_CullSetLayout;
+	VkDescriptorSetLayout              m_PyramidSetLayout;
+	VkDescriptorPool                   m_DescriptorPool;
+	std::vector<VkDescriptorSet>       m_CullSets;           // Per frame in flight, for its constants
+	VkDescriptorSet                    m_PyramidSet;
+	VkPipelineLayout                   m_CullPipelineLayout;
+	VkPipelineLayout                   m_PyramidPipelineLayout;
+	VkPipeline                         m_CullPipeline;
+	VkPipeline                         m_PyramidPipeline;
+
+	VkQueryPool                        m_QueryPool;
+	double                             m_TimestampPeriod;    // Nanoseconds per tick
+	uint64_t                           m_TimestampMask;
+	std::vector<bool>                  m_QueryWritten;
+	OcclusionCullStats                 m_LastStats;
+
+	bool CreateDescriptors();
+	bool CreatePipelines();
+	void UpdateDescriptors(VkImageView depthView);
+	void RecordPyramid(VkCommandBuffer commandBuffer);
+	void RecordCull(VkCommandBuffer commandBuffer, uint32_t frameIndex, bool late);
+};
+
+
+__END_NAMESPACE
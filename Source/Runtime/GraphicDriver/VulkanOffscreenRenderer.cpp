@@ -0,0 +1,1976 @@
+#include "FrameAllocator.h"
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanSceneAttachments.h"
+#include "VulkanClusteredLighting.h"
+#include "VulkanDeferredPass.h"
+#include "VulkanCascadedShadows.h"
+#include "VulkanPostProcess.h"
+#include "VulkanTemporalUpscaler.h"
+#include "VulkanParticleSystem.h"
+#include "VulkanFrameRing.h"
+#include "VulkanSkinning.h"
+#include "VulkanOcclusionCuller.h"
+#include "Meshlet.h"
+#include "VulkanMeshletCuller.h"
+#include "VulkanDrawBatcher.h"
+#include "StreamingIO.h"
+#include "VirtualTexture.h"
+#include "VulkanVirtualTexture.h"
+#include "Animation.h"
+#include "VulkanHeadlessDevice.h"
+#include "VulkanOffscreenRenderer.h"
+
+
+__BEGIN_NAMESPACE
+
+static const uint32_t PROCEDURAL_CUBE_VERTEX_COUNT = 36;
+static const uint32_t PROCEDURAL_CUBE_HEIGHTS = 4;     // Of hash & 3 in procedural_scene.shader.vert
+static const float PROCEDURAL_GRID_SPACING = 1.5f;
+static const float PROCEDURAL_CUBE_SIZE = 1.0f;
+static const float PROCEDURAL_NEAR_PLANE = 0.1f;
+static const float PROCEDURAL_FAR_PLANE = 1000.0f;
+static const float PROCEDURAL_LIGHTS_PER_POINT = 16.0f;
+static const uint32_t OFFSCREEN_MIN_LIGHT_CAPACITY = 1024;
+// Below half the size too little is left for the history to recover.
+static const float OFFSCREEN_MIN_TEMPORAL_SCALE = 0.5f;
+// Simulated per frame whatever the frame takes, so every run sees the same particles.
+static const float OFFSCREEN_PARTICLE_TIMESTEP = 1.0f / 60.0f;
+static const double OFFSCREEN_ANIMATION_TIMESTEP = 1.0 / 60.0;
+static const uint32_t OFFSCREEN_CHARACTER_JOINTS = 16;
+static const uint32_t OFFSCREEN_VIRTUAL_TEXTURE_CACHE_SLOTS = 256;
+// Frame ring room for the passes' constants, on top of the palettes & batched instances.
+static const VkDeviceSize OFFSCREEN_FRAME_RING_CONSTANT_BYTES = 64 * 1024;
+static const PostProcessEffect OFFSCREEN_POST_EFFECTS[] = {
+    PostProcessEffect::Bloom,
+    PostProcessEffect::Tonemap,
+    PostProcessEffect::ColorGrading,
+    PostProcessEffect::Fxaa,
+    PostProcessEffect::Vignette,
+};
+
+// Copied to the readback buffer once the pass is done.
+static const VkSubpassDependency TARGET_DEPENDENCIES[2] = {
+    { VK_SUBPASS_EXTERNAL, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0 },
+    { 0, VK_SUBPASS_EXTERNAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0 },
+};
+
+// Read in compute once the pass is done, by the temporal resolve or the virtual texture feedback, the previous
+// frame's dispatch read it too.
+static const VkSubpassDependency TEMPORAL_DEPENDENCIES[2] = {
+    { VK_SUBPASS_EXTERNAL, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        0, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, 0 },
+    { 0, VK_SUBPASS_EXTERNAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, 0 },
+};
+
+// Both passes of an occlusion culled frame: the culling & the pyramid build run around them, the second one's output
+// is copied or post-processed.
+static const VkSubpassDependency OCCLUSION_DEPENDENCIES[2] = {
+    { VK_SUBPASS_EXTERNAL, 0, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, 0 },
+    { 0, VK_SUBPASS_EXTERNAL, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT, 0 },
+};
+
+static double ElapsedMilliseconds(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void BuildProceduralFrameDesc(uint32_t width, uint32_t height, uint32_t instanceCount, const glm::vec3& eye, const glm::vec3& target,
+    float fieldOfView, OffscreenFrameDesc& desc)
+{
+    uint32_t perRow = (uint32_t)ceil(sqrt((double)instanceCount));
+
+    glm::mat4 view = glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(fieldOfView), (float)width / (float)height, PROCEDURAL_NEAR_PLANE, PROCEDURAL_FAR_PLANE);
+    // Vulkan clip space points y down.
+    projection[1][1] *= -1.0f;
+
+    desc.m_Width = width;
+    desc.m_Height = height;
+    desc.m_InstanceCount = instanceCount;
+    desc.m_Constants.m_ViewProjection = projection * view;
+    desc.m_Constants.m_Grid = glm::vec4((float)perRow, PROCEDURAL_GRID_SPACING, PROCEDURAL_CUBE_SIZE, 0.0f);
+    desc.m_View = view;
+    desc.m_Projection = projection;
+    desc.m_NearPlane = PROCEDURAL_NEAR_PLANE;
+    desc.m_FarPlane = PROCEDURAL_FAR_PLANE;
+    desc.m_Lights = nullptr;
+    desc.m_LightCount = 0;
+    desc.m_Deferred = false;
+    desc.m_Shadows = false;
+    // LIGHT_DIRECTION of procedural_scene_common.glsl
+    desc.m_LightDirection = glm::normalize(glm::vec3(0.408f, 0.816f, 0.408f));
+    desc.m_DynamicCasterStart = instanceCount;
+    desc.m_StaticVersion = 0;
+    desc.m_PostProcess = OffscreenPostProcess::None;
+    desc.m_TemporalScale = 0.0f;
+    desc.m_ParticleCapacity = 0;
+    desc.m_ParticleEmitRate = 0.0f;
+    desc.m_SkinnedInstances = 0;
+    desc.m_OcclusionCulling = false;
+    desc.m_VirtualTexturePath = nullptr;
+    desc.m_VirtualTextureCacheSlots = OFFSCREEN_VIRTUAL_TEXTURE_CACHE_SLOTS;
+    desc.m_Meshlets = false;
+    desc.m_Batched = false;
+}
+
+// Same hash as procedural_scene.shader.vert
+static uint32_t ProceduralHash(uint32_t value)
+{
+    value ^= value >> 16;
+    value *= 0x7feb352du;
+    value ^= value >> 15;
+    value *= 0x846ca68bu;
+    value ^= value >> 16;
+    return value;
+}
+
+static float ProceduralUnit(uint32_t& state)
+{
+    state = ProceduralHash(state + 0x9e3779b9u);
+    return (float)(state >> 8) / (float)(1u << 24);
+}
+
+void BuildProceduralLights(uint32_t instanceCount, uint32_t lightCount, std::vector<ClusteredLight>& lights)
+{
+    uint32_t perRow = (uint32_t)ceil(sqrt((double)std::max(instanceCount, 1u)));
+    float side = (float)perRow * PROCEDURAL_GRID_SPACING;
+    // Coverage = lights * pi * range^2 / area, solved for the range.
+    float meanRange = sqrt(PROCEDURAL_LIGHTS_PER_POINT * side * side / (3.14159265f * (float)std::max(lightCount, 1u)));
+
+    lights.resize(lightCount);
+    uint32_t state = lightCount;
+    for (uint32_t i = 0; i < lightCount; i++) {
+        ClusteredLight& light = lights[i];
+        glm::vec3 position((ProceduralUnit(state) - 0.5f) * side, (0.5f + 3.0f * ProceduralUnit(state)) * PROCEDURAL_CUBE_SIZE,
+            (ProceduralUnit(state) - 0.5f) * side);
+        float range = meanRange * (0.75f + 0.5f * ProceduralUnit(state));
+        glm::vec3 color(0.3f + 0.7f * ProceduralUnit(state), 0.3f + 0.7f * ProceduralUnit(state), 0.3f + 0.7f * ProceduralUnit(state));
+        light.m_PositionRange = glm::vec4(position, range);
+        light.m_ColorIntensity = glm::vec4(color, 0.5f * range * range);
+
+        // One in four is a spot pointing roughly down.
+        if (0 == (i & 3)) {
+            glm::vec3 direction = glm::normalize(glm::vec3(ProceduralUnit(state) - 0.5f, -1.0f, ProceduralUnit(state) - 0.5f));
+            float outer = glm::radians(30.0f + 20.0f * ProceduralUnit(state));
+            light.m_DirectionType = glm::vec4(direction, (float)ClusteredLightType::Spot);
+            light.m_SpotCosines = glm::vec4(cos(outer), cos(outer * 0.75f), 0.0f, 0.0f);
+        } else {
+            light.m_DirectionType = glm::vec4(0.0f, -1.0f, 0.0f, (float)ClusteredLightType::Point);
+            light.m_SpotCosines = glm::vec4(-1.0f, -1.0f, 0.0f, 0.0f);
+        }
+    }
+}
+
+void GenerateProceduralTexture(uint32_t textureIndex, uint32_t textureSize, uint8_t* rgba)
+{
+    uint32_t hash = ProceduralHash(textureIndex);
+    glm::vec3 base = glm::vec3((float)((hash >> 8) & 255), (float)((hash >> 16) & 255), (float)((hash >> 24) & 255)) / 255.0f * 0.7f + 0.3f;
+    uint32_t tileSize = std::max(textureSize / (4 + (hash & 3)), 1u);
+    float center = 0.5f * (float)textureSize;
+    for (uint32_t y = 0; y < textureSize; y++) {
+        for (uint32_t x = 0; x < textureSize; x++) {
+            float tile = (0 == ((x / tileSize + y / tileSize) & 1)) ? 1.0f : 0.6f;
+            float radius = sqrt(((float)x - center) * ((float)x - center) + ((float)y - center) * ((float)y - center));
+            float ring = 0.85f + 0.15f * cosf(radius * 2.0f);
+            glm::vec3 color = glm::clamp(base * tile * ring, 0.0f, 1.0f) * 255.0f;
+            uint8_t* texel = &rgba[((size_t)y * textureSize + x) * 4];
+            texel[0] = (uint8_t)(color.r + 0.5f);
+            texel[1] = (uint8_t)(color.g + 0.5f);
+            texel[2] = (uint8_t)(color.b + 0.5f);
+            texel[3] = 255;
+        }
+    }
+}
+
+// Boxes of the cubes procedural_scene.shader.vert places, standing on the ground plane.
+static void BuildProceduralBounds(const glm::vec4& grid, uint32_t count, OcclusionBounds* bounds)
+{
+    uint32_t perRow = std::max((uint32_t)grid.x, 1u);
+    float spacing = grid.y;
+    float size = grid.z;
+
+    for (uint32_t i = 0; i < count; i++) {
+        float height = (float)(1 + (ProceduralHash(i) & 3));
+        float x = (float)(i % perRow) - (float)(perRow - 1) * 0.5f;
+        float z = (float)(i / perRow) - (float)(perRow - 1) * 0.5f;
+        bounds[i].m_Center = glm::vec4(x * spacing, 0.5f * height * size, z * spacing, 0.0f);
+        bounds[i].m_Extent = glm::vec4(0.5f * size, 0.5f * height * size, 0.5f * size, 0.0f);
+    }
+}
+
+// Corners of each face of a cube spanning -1 to 1, counter clockwise seen from outside, in +x, -x, +y, -y, +z, -z order.
+// Same faces & corners, in the same order, as procedural_scene.shader.vert generates.
+static const glm::vec3 PROCEDURAL_FACE_CORNERS[6][4] = {
+    { glm::vec3( 1.0f, -1.0f, -1.0f), glm::vec3( 1.0f,  1.0f, -1.0f), glm::vec3( 1.0f,  1.0f,  1.0f), glm::vec3( 1.0f, -1.0f,  1.0f) },
+    { glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(-1.0f, -1.0f,  1.0f), glm::vec3(-1.0f,  1.0f,  1.0f), glm::vec3(-1.0f,  1.0f, -1.0f) },
+    { glm::vec3(-1.0f,  1.0f, -1.0f), glm::vec3(-1.0f,  1.0f,  1.0f), glm::vec3( 1.0f,  1.0f,  1.0f), glm::vec3( 1.0f,  1.0f, -1.0f) },
+    { glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3( 1.0f, -1.0f, -1.0f), glm::vec3( 1.0f, -1.0f,  1.0f), glm::vec3(-1.0f, -1.0f,  1.0f) },
+    { glm::vec3(-1.0f, -1.0f,  1.0f), glm::vec3( 1.0f, -1.0f,  1.0f), glm::vec3( 1.0f,  1.0f,  1.0f), glm::vec3(-1.0f,  1.0f,  1.0f) },
+    { glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(-1.0f,  1.0f, -1.0f), glm::vec3( 1.0f,  1.0f, -1.0f), glm::vec3( 1.0f, -1.0f, -1.0f) },
+};
+
+// The cubes of BuildProceduralBounds() as one mesh, every face of a direction before the next direction's, so the
+// meshlets built in order each face one way & their normal cones stay narrow.
+static void BuildProceduralMesh(const glm::vec4& grid, uint32_t count, std::vector<glm::vec3>& positions, std::vector<uint32_t>& indices)
+{
+    std::vector<OcclusionBounds> bounds(count);
+    BuildProceduralBounds(grid, count, bounds.data());
+
+    positions.clear();
+    indices.clear();
+    positions.reserve((size_t)count * 24);
+    indices.reserve((size_t)count * 36);
+    for (uint32_t face = 0; face < 6; face++) {
+        for (const OcclusionBounds& cube : bounds) {
+            uint32_t first = (uint32_t)positions.size();
+            for (uint32_t corner = 0; corner < 4; corner++) {
+                positions.push_back(glm::vec3(cube.m_Center) + glm::vec3(cube.m_Extent) * PROCEDURAL_FACE_CORNERS[face][corner]);
+            }
+            const uint32_t quad[6] = { 0, 1, 2, 0, 2, 3 };
+            for (uint32_t index : quad) {
+                indices.push_back(first + index);
+            }
+        }
+    }
+}
+
+// A cube of each height standing on the origin, as procedural_scene.shader.vert places them, for the batched scene:
+// per vertex the corner & face * 4 + corner of the face's quad, 4 vertices per face & the same 36 indices for every height.
+static void BuildProceduralCubeMeshes(float cubeSize, std::vector<glm::vec4>& vertices, std::vector<uint32_t>& indices)
+{
+    vertices.clear();
+    indices.clear();
+    for (uint32_t height = 1; height <= PROCEDURAL_CUBE_HEIGHTS; height++) {
+        glm::vec3 scale = glm::vec3(0.5f, 0.5f * height, 0.5f) * cubeSize;
+        for (uint32_t face = 0; face < 6; face++) {
+            for (uint32_t corner = 0; corner < 4; corner++) {
+                glm::vec3 position = PROCEDURAL_FACE_CORNERS[face][corner] * scale + glm::vec3(0.0f, scale.y, 0.0f);
+                vertices.push_back(glm::vec4(position, (float)(face * 4 + corner)));
+            }
+        }
+    }
+    for (uint32_t face = 0; face < 6; face++) {
+        const uint32_t quad[6] = { 0, 1, 2, 0, 2, 3 };
+        for (uint32_t index : quad) {
+            indices.push_back(face * 4 + index);
+        }
+    }
+}
+
+// Characters on a square grid of their own, standing where four cubes meet & facing any way, each playing both
+// clips at its own pace & phase & drifting between them.
+static void UpdateCharacterInstances(const glm::vec4& grid, uint32_t count, double time, std::vector<AnimationInstance>& instances)
+{
+    uint32_t cubesPerRow = std::max((uint32_t)grid.x, 1u);
+    uint32_t perRow = (uint32_t)ceil(sqrt((double)std::max(count, 1u)));
+    float spacing = grid.y;
+    float gapOffset = (0 == cubesPerRow % 2) ? 0.0f : 0.5f * spacing;
+
+    instances.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t state = i;
+        float yaw = 6.28318531f * ProceduralUnit(state);
+        float scale = 0.8f + 0.4f * ProceduralUnit(state);
+        float speed = 0.8f + 0.4f * ProceduralUnit(state);
+        float phase = 6.28318531f * ProceduralUnit(state);
+        glm::vec3 position(((float)(i % perRow) - (float)(perRow / 2)) * spacing + gapOffset, 0.0f,
+            ((float)(i / perRow) - (float)(perRow / 2)) * spacing + gapOffset);
+
+        AnimationInstance& instance = instances[i];
+        instance.m_ClipA = 0;
+        instance.m_ClipB = 1;
+        instance.m_TimeA = (float)(time * speed) + phase;
+        instance.m_TimeB = (float)(time * speed * 0.75) + phase;
+        instance.m_Weight = 0.5f + 0.5f * sinf((float)(time * 0.5) + phase);
+        instance.m_Root = MakeJointMatrix(position, yaw, scale * grid.z);
+    }
+}
+
+VulkanOffscreenRenderer::VulkanOffscreenRenderer() :
+	m_HeadlessDevice(nullptr),
+	m_Device(VK_NULL_HANDLE),
+	m_QueueIndex(0),
+	m_CommandPool(VK_NULL_HANDLE),
+	m_CommandBuffer(VK_NULL_HANDLE),
+	m_Fence(VK_NULL_HANDLE),
+	m_FrameRing(nullptr),
+	m_SceneAttachments(nullptr),
+	m_RenderPass(VK_NULL_HANDLE),
+	m_PipelineLayout(VK_NULL_HANDLE),
+	m_Pipeline(VK_NULL_HANDLE),
+	m_ClusteredLighting(nullptr),
+	m_LitPipelineLayout(VK_NULL_HANDLE),
+	m_LitPipeline(VK_NULL_HANDLE),
+	m_DeferredPass(nullptr),
+	m_DeferredPipelineLayout(VK_NULL_HANDLE),
+	m_DeferredPipeline(VK_NULL_HANDLE),
+	m_CascadedShadows(nullptr),
+	m_ShadowedPipelineLayout(VK_NULL_HANDLE),
+	m_ShadowedPipeline(VK_NULL_HANDLE),
+	m_ShadowCasterPipelineLayout(VK_NULL_HANDLE),
+	m_ShadowCasterPipeline(VK_NULL_HANDLE),
+	m_PostProcess(nullptr),
+	m_PostProcessMode(OffscreenPostProcess::None),
+	m_TemporalAttachments(nullptr),
+	m_TemporalRenderPass(VK_NULL_HANDLE),
+	m_TemporalPipelineLayout(VK_NULL_HANDLE),
+	m_TemporalPipeline(VK_NULL_HANDLE),
+	m_TemporalUpscaler(nullptr),
+	m_ParticleSystem(nullptr),
+	m_Character(nullptr),
+	m_AnimationEvaluator(nullptr),
+	m_Skinning(nullptr),
+	m_AnimationTime(0.0),
+	m_OcclusionAttachments(nullptr),
+	m_OcclusionRenderPass(VK_NULL_HANDLE),
+	m_OcclusionLateRenderPass(VK_NULL_HANDLE),
+	m_OcclusionPipelineLayout(VK_NULL_HANDLE),
+	m_OcclusionPipeline(VK_NULL_HANDLE),
+	m_OcclusionCuller(nullptr),
+	m_OcclusionGrid(0.0f),
+	m_OcclusionInstances(0),
+	m_Streaming(nullptr),
+	m_VirtualTexture(nullptr),
+	m_VirtualTextureCacheSlots(0),
+	m_VirtualPipelineLayout(VK_NULL_HANDLE),
+	m_VirtualPipeline(VK_NULL_HANDLE),
+	m_FeedbackAttachments(nullptr),
+	m_FeedbackRenderPass(VK_NULL_HANDLE),
+	m_FeedbackPipelineLayout(VK_NULL_HANDLE),
+	m_FeedbackPipeline(VK_NULL_HANDLE),
+	m_MeshletCuller(nullptr),
+	m_MeshletGrid(0.0f),
+	m_MeshletInstances(0),
+	m_DrawBatcher(nullptr),
+	m_BatchMaterialSetLayout(VK_NULL_HANDLE),
+	m_BatchedPipelineLayout(VK_NULL_HANDLE),
+	m_BatchedPipeline(VK_NULL_HANDLE),
+	m_BatchedGrid(0.0f),
+	m_BatchedView(1.0f),
+	m_Extent({ 0, 0 }),
+	m_Framebuffer(VK_NULL_HANDLE),
+	m_DeferredFramebuffer(VK_NULL_HANDLE),
+	m_TemporalExtent({ 0, 0 }),
+	m_TemporalFramebuffer(VK_NULL_HANDLE),
+	m_OcclusionFramebuffer(VK_NULL_HANDLE),
+	m_FeedbackExtent({ 0, 0 }),
+	m_FeedbackFramebuffer(VK_NULL_HANDLE),
+	m_ReadbackCoherent(true),
+	m_LastTiming({ 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0.0, 0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0.0 }),
+	m_LastBandwidth{}
+{
+}
+
+VulkanOffscreenRenderer::~VulkanOffscreenRenderer()
+{
+}
+
+bool VulkanOffscreenRenderer::Create(VulkanHeadlessDevice* headlessDevice, uint32_t queueIndex, const SceneAttachmentSettings& attachmentSettings)
+{
+    m_HeadlessDevice = headlessDevice;
+    m_Device = headlessDevice->GetDevice();
+    m_QueueIndex = queueIndex;
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.queueFamilyIndex = headlessDevice->GetQueueFamilyIndex();
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    if (vkCreateCommandPool(m_Device, &poolInfo, GetVulkanAllocator(), &m_CommandPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create command pool.\n";
+        SetErrorCode(ErrorCode::Vulkan_Invalid_CommandPool);
+        return false;
+    }
+
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_CommandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(m_Device, &allocInfo, &m_CommandBuffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate command buffers.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    if (vkCreateFence(m_Device, &fenceInfo, GetVulkanAllocator(), &m_Fence) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create fence.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    // A single frame slot, every frame waits for its fence before the next one is recorded.
+    m_FrameRing = New<VulkanFrameRing>(MemoryTag::GraphicDriver);
+    VULKAN_DRIVER_CHECK_FUN(m_FrameRing->Create(m_Device, headlessDevice->GetPhysicalDevice(), 1, OFFSCREEN_FRAME_RING_CONSTANT_BYTES));
+
+    m_SceneAttachments = New<VulkanSceneAttachments>(MemoryTag::GraphicDriver);
+    VULKAN_DRIVER_CHECK_FUN(m_SceneAttachments->Create(m_Device, headlessDevice->GetPhysicalDevice(), COLOR_FORMAT, attachmentSettings));
+
+    VULKAN_DRIVER_CHECK_FUN(m_SceneAttachments->CreateRenderPass(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, TARGET_DEPENDENCIES, 2, m_RenderPass));
+
+    return CreatePipeline("Data/Engine/procedural_scene.fs.spv", VK_NULL_HANDLE, PipelinePass::Forward, m_PipelineLayout, m_Pipeline);
+}
+
+bool VulkanOffscreenRenderer::CreateClusteredLighting(uint32_t lightCount)
+{
+    DestroyClusteredLighting();
+
+    VulkanClusteredLightingCreateInfo createInfo;
+    createInfo.m_Device = m_Device;
+    createInfo.m_PhysicalDevice = m_HeadlessDevice->GetPhysicalDevice();
+    createInfo.m_MaxLights = std::max(lightCount, OFFSCREEN_MIN_LIGHT_CAPACITY);
+    m_ClusteredLighting = New<VulkanClusteredLighting>(MemoryTag::GraphicDriver);
+    if (!m_ClusteredLighting->Create(createInfo) ||
+        !CreatePipeline("Data/Engine/clustered_pbr.fs.spv", m_ClusteredLighting->GetDescriptorSetLayout(), PipelinePass::Forward, m_LitPipelineLayout, m_LitPipeline)) {
+        DestroyClusteredLighting();
+        return false;
+    }
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyClusteredLighting()
+{
+    // Its lighting pipeline is laid out on the clustered lighting's set.
+    DestroyDeferredPass();
+    if (VK_NULL_HANDLE != m_LitPipeline) {
+        vkDestroyPipeline(m_Device, m_LitPipeline, GetVulkanAllocator());
+        m_LitPipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_LitPipelineLayout) {
+        vkDestroyPipelineLayout(m_Device, m_LitPipelineLayout, GetVulkanAllocator());
+        m_LitPipelineLayout = VK_NULL_HANDLE;
+    }
+    if (nullptr != m_ClusteredLighting) {
+        m_ClusteredLighting->Destroy();
+        Delete(m_ClusteredLighting);
+        m_ClusteredLighting = nullptr;
+    }
+}
+
+bool VulkanOffscreenRenderer::CreateDeferredPass()
+{
+    DestroyDeferredPass();
+
+    VulkanDeferredPassCreateInfo createInfo;
+    createInfo.m_Device = m_Device;
+    createInfo.m_PhysicalDevice = m_HeadlessDevice->GetPhysicalDevice();
+    createInfo.m_PipelineCache = m_HeadlessDevice->GetPipelineCache();
+    createInfo.m_OutputFormat = COLOR_FORMAT;
+    createInfo.m_FinalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    createInfo.m_Dependencies = TARGET_DEPENDENCIES;
+    createInfo.m_DependencyCount = 2;
+    createInfo.m_LightingSetLayout = m_ClusteredLighting->GetDescriptorSetLayout();
+    m_DeferredPass = New<VulkanDeferredPass>(MemoryTag::GraphicDriver);
+    if (!m_DeferredPass->Create(createInfo) ||
+        !CreatePipeline("Data/Engine/gbuffer.fs.spv", VK_NULL_HANDLE, PipelinePass::DeferredGeometry, m_DeferredPipelineLayout, m_DeferredPipeline) ||
+        (0 != m_Extent.width && !CreateDeferredTarget())) {
+        DestroyDeferredPass();
+        return false;
+    }
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyDeferredPass()
+{
+    if (VK_NULL_HANDLE != m_DeferredFramebuffer) {
+        vkDestroyFramebuffer(m_Device, m_DeferredFramebuffer, GetVulkanAllocator());
+        m_DeferredFramebuffer = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DeferredPipeline) {
+        vkDestroyPipeline(m_Device, m_DeferredPipeline, GetVulkanAllocator());
+        m_DeferredPipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DeferredPipelineLayout) {
+        vkDestroyPipelineLayout(m_Device, m_DeferredPipelineLayout, GetVulkanAllocator());
+        m_DeferredPipelineLayout = VK_NULL_HANDLE;
+    }
+    if (nullptr != m_DeferredPass) {
+        m_DeferredPass->Destroy();
+        Delete(m_DeferredPass);
+        m_DeferredPass = nullptr;
+    }
+}
+
+bool VulkanOffscreenRenderer::CreateDeferredTarget()
+{
+    if (VK_NULL_HANDLE != m_DeferredFramebuffer) {
+        vkDestroyFramebuffer(m_Device, m_DeferredFramebuffer, GetVulkanAllocator());
+        m_DeferredFramebuffer = VK_NULL_HANDLE;
+    }
+    VULKAN_DRIVER_CHECK_FUN(m_DeferredPass->CreateImages(m_Extent));
+
+    VkImageView attachments[VulkanDeferredPass::ATTACHMENT_COUNT];
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_DeferredPass->GetRenderPass();
+    framebufferInfo.attachmentCount = m_DeferredPass->GetFramebufferAttachments(m_Target.m_View, attachments);
+    framebufferInfo.pAttachments = attachments;
+    framebufferInfo.width = m_Extent.width;
+    framebufferInfo.height = m_Extent.height;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(m_Device, &framebufferInfo, GetVulkanAllocator(), &m_DeferredFramebuffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create deferred framebuffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanOffscreenRenderer::CreateCascadedShadows()
+{
+    DestroyCascadedShadows();
+
+    VulkanCascadedShadowsCreateInfo createInfo;
+    createInfo.m_Device = m_Device;
+    createInfo.m_PhysicalDevice = m_HeadlessDevice->GetPhysicalDevice();
+    createInfo.m_QueueFamilyIndex = m_HeadlessDevice->GetQueueFamilyIndex();
+    m_CascadedShadows = New<VulkanCascadedShadows>(MemoryTag::GraphicDriver);
+    if (!m_CascadedShadows->Create(createInfo) ||
+        !CreatePipeline(nullptr, VK_NULL_HANDLE, PipelinePass::ShadowCaster, m_ShadowCasterPipelineLayout, m_ShadowCasterPipeline) ||
+        !CreatePipeline("Data/Engine/shadowed_scene.fs.spv", m_CascadedShadows->GetDescriptorSetLayout(), PipelinePass::Forward,
+            m_ShadowedPipelineLayout, m_ShadowedPipeline)) {
+        DestroyCascadedShadows();
+        return false;
+    }
+    if (nullptr != m_Skinning) {
+        VULKAN_DRIVER_CHECK_FUN(m_Skinning->CreateShadowPipeline(*m_CascadedShadows));
+    }
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyCascadedShadows()
+{
+    VkPipeline* pipelines[2] = { &m_ShadowedPipeline, &m_ShadowCasterPipeline };
+    VkPipelineLayout* pipelineLayouts[2] = { &m_ShadowedPipelineLayout, &m_ShadowCasterPipelineLayout };
+    for (uint32_t i = 0; i < 2; i++) {
+        if (VK_NULL_HANDLE != *pipelines[i]) {
+            vkDestroyPipeline(m_Device, *pipelines[i], GetVulkanAllocator());
+            *pipelines[i] = VK_NULL_HANDLE;
+        }
+        if (VK_NULL_HANDLE != *pipelineLayouts[i]) {
+            vkDestroyPipelineLayout(m_Device, *pipelineLayouts[i], GetVulkanAllocator());
+            *pipelineLayouts[i] = VK_NULL_HANDLE;
+        }
+    }
+    if (nullptr != m_CascadedShadows) {
+        m_CascadedShadows->Destroy();
+        Delete(m_CascadedShadows);
+        m_CascadedShadows = nullptr;
+    }
+}
+
+bool VulkanOffscreenRenderer::CreatePostProcess(OffscreenPostProcess mode)
+{
+    DestroyPostProcess();
+
+    VulkanPostProcessCreateInfo createInfo;
+    createInfo.m_Device = m_Device;
+    createInfo.m_PhysicalDevice = m_HeadlessDevice->GetPhysicalDevice();
+    createInfo.m_PipelineCache = m_HeadlessDevice->GetPipelineCache();
+    createInfo.m_QueueFamilyIndex = m_HeadlessDevice->GetQueueFamilyIndex();
+    createInfo.m_Effects = OFFSCREEN_POST_EFFECTS;
+    createInfo.m_EffectCount = sizeof(OFFSCREEN_POST_EFFECTS) / sizeof(OFFSCREEN_POST_EFFECTS[0]);
+    createInfo.m_Fuse = (OffscreenPostProcess::Fused == mode);
+    m_PostProcess = New<VulkanPostProcess>(MemoryTag::GraphicDriver);
+    if (!m_PostProcess->Create(createInfo) || (0 != m_Extent.width && !CreatePostTarget())) {
+        DestroyPostProcess();
+        return false;
+    }
+    m_PostProcessMode = mode;
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyPostProcess()
+{
+    DestroyImage(m_Device, m_PostTarget);
+    if (nullptr != m_PostProcess) {
+        m_PostProcess->Destroy();
+        Delete(m_PostProcess);
+        m_PostProcess = nullptr;
+    }
+    m_PostProcessMode = OffscreenPostProcess::None;
+}
+
+bool VulkanOffscreenRenderer::CreatePostTarget()
+{
+    DestroyImage(m_Device, m_PostTarget);
+    VULKAN_DRIVER_CHECK_FUN(CreateImage2D(m_Device, m_HeadlessDevice->GetPhysicalDevice(), m_Extent, VK_FORMAT_R8G8B8A8_UNORM,
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_PostTarget));
+    return m_PostProcess->CreateTargets(m_Extent, m_Target.m_View, m_PostTarget.m_View);
+}
+
+bool VulkanOffscreenRenderer::CreateTemporalUpscaler()
+{
+    DestroyTemporalUpscaler();
+
+    // The jitter takes the place of MSAA, and the resolve reads the depth for the motion vectors.
+    SceneAttachmentSettings attachmentSettings = m_SceneAttachments->GetSettings();
+    attachmentSettings.m_Depth = true;
+    attachmentSettings.m_SampledDepth = true;
+    m_TemporalAttachments = New<VulkanSceneAttachments>(MemoryTag::GraphicDriver);
+    if (!m_TemporalAttachments->Create(m_Device, m_HeadlessDevice->GetPhysicalDevice(), COLOR_FORMAT, attachmentSettings) ||
+        !m_TemporalAttachments->CreateRenderPass(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, TEMPORAL_DEPENDENCIES, 2, m_TemporalRenderPass) ||
+        !CreatePipeline("Data/Engine/procedural_scene.fs.spv", VK_NULL_HANDLE, PipelinePass::Temporal, m_TemporalPipelineLayout, m_TemporalPipeline)) {
+        DestroyTemporalUpscaler();
+        return false;
+    }
+
+    VulkanTemporalUpscalerCreateInfo createInfo;
+    createInfo.m_Device = m_Device;
+    createInfo.m_PhysicalDevice = m_HeadlessDevice->GetPhysicalDevice();
+    createInfo.m_PipelineCache = m_HeadlessDevice->GetPipelineCache();
+    createInfo.m_FrameRing = m_FrameRing;
+    createInfo.m_QueueFamilyIndex = m_HeadlessDevice->GetQueueFamilyIndex();
+    createInfo.m_DepthMotion = m_TemporalAttachments->IsDepthSampled();
+    m_TemporalUpscaler = New<VulkanTemporalUpscaler>(MemoryTag::GraphicDriver);
+    if (!m_TemporalUpscaler->Create(createInfo)) {
+        DestroyTemporalUpscaler();
+        return false;
+    }
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyTemporalUpscaler()
+{
+    DestroyTemporalTarget();
+    if (nullptr != m_TemporalUpscaler) {
+        m_TemporalUpscaler->Destroy();
+        Delete(m_TemporalUpscaler);
+        m_TemporalUpscaler = nullptr;
+    }
+    if (VK_NULL_HANDLE != m_TemporalPipeline) {
+        vkDestroyPipeline(m_Device, m_TemporalPipeline, GetVulkanAllocator());
+        m_TemporalPipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_TemporalPipelineLayout) {
+        vkDestroyPipelineLayout(m_Device, m_TemporalPipelineLayout, GetVulkanAllocator());
+        m_TemporalPipelineLayout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_TemporalRenderPass) {
+        vkDestroyRenderPass(m_Device, m_TemporalRenderPass, GetVulkanAllocator());
+        m_TemporalRenderPass = VK_NULL_HANDLE;
+    }
+    if (nullptr != m_TemporalAttachments) {
+        m_TemporalAttachments->Destroy();
+        Delete(m_TemporalAttachments);
+        m_TemporalAttachments = nullptr;
+    }
+}
+
+bool VulkanOffscreenRenderer::CreateTemporalTarget(VkExtent2D renderExtent)
+{
+    DestroyTemporalTarget();
+    VULKAN_DRIVER_CHECK_FUN(m_TemporalAttachments->CreateImages(renderExtent));
+    VULKAN_DRIVER_CHECK_FUN(CreateImage2D(m_Device, m_HeadlessDevice->GetPhysicalDevice(), renderExtent, COLOR_FORMAT,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_TemporalInput));
+
+    VkImageView attachments[VulkanSceneAttachments::MAX_ATTACHMENTS];
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_TemporalRenderPass;
+    framebufferInfo.attachmentCount = m_TemporalAttachments->GetFramebufferAttachments(m_TemporalInput.m_View, attachments);
+    framebufferInfo.pAttachments = attachments;
+    framebufferInfo.width = renderExtent.width;
+    framebufferInfo.height = renderExtent.height;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(m_Device, &framebufferInfo, GetVulkanAllocator(), &m_TemporalFramebuffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create temporal framebuffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VULKAN_DRIVER_CHECK_FUN(m_TemporalUpscaler->CreateTargets(renderExtent, m_Extent, m_TemporalInput.m_View, m_TemporalAttachments->GetDepthView()));
+    m_TemporalExtent = renderExtent;
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyTemporalTarget()
+{
+    if (nullptr != m_TemporalUpscaler) {
+        m_TemporalUpscaler->DestroyTargets();
+    }
+    if (VK_NULL_HANDLE != m_TemporalFramebuffer) {
+        vkDestroyFramebuffer(m_Device, m_TemporalFramebuffer, GetVulkanAllocator());
+        m_TemporalFramebuffer = VK_NULL_HANDLE;
+    }
+    DestroyImage(m_Device, m_TemporalInput);
+    if (nullptr != m_TemporalAttachments) {
+        m_TemporalAttachments->DestroyImages();
+    }
+    m_TemporalExtent = { 0, 0 };
+}
+
+bool VulkanOffscreenRenderer::CreateParticleSystem(uint32_t capacity)
+{
+    DestroyParticleSystem();
+
+    VulkanParticleSystemCreateInfo createInfo;
+    createInfo.m_Device = m_Device;
+    createInfo.m_PhysicalDevice = m_HeadlessDevice->GetPhysicalDevice();
+    createInfo.m_PipelineCache = m_HeadlessDevice->GetPipelineCache();
+    createInfo.m_FrameRing = m_FrameRing;
+    createInfo.m_QueueFamilyIndex = m_HeadlessDevice->GetQueueFamilyIndex();
+    createInfo.m_Capacity = capacity;
+    m_ParticleSystem = New<VulkanParticleSystem>(MemoryTag::GraphicDriver);
+    if (!m_ParticleSystem->Create(createInfo) || !m_ParticleSystem->CreateDrawPipeline(*m_SceneAttachments, m_RenderPass)) {
+        DestroyParticleSystem();
+        return false;
+    }
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyParticleSystem()
+{
+    if (nullptr != m_ParticleSystem) {
+        m_ParticleSystem->Destroy();
+        Delete(m_ParticleSystem);
+        m_ParticleSystem = nullptr;
+    }
+}
+
+bool VulkanOffscreenRenderer::CreateSkinning(uint32_t maxInstances)
+{
+    DestroySkinning();
+
+    // The character & the workers outlive rebuilds of the GPU side.
+    if (nullptr == m_Character) {
+        m_Character = New<AnimatedCharacter>(MemoryTag::GraphicDriver);
+        BuildProceduralCharacter(OFFSCREEN_CHARACTER_JOINTS, 1.6f * PROCEDURAL_CUBE_SIZE, 0.15f * PROCEDURAL_CUBE_SIZE, *m_Character);
+    }
+    if (nullptr == m_AnimationEvaluator) {
+        m_AnimationEvaluator = New<AnimationEvaluator>(MemoryTag::GraphicDriver);
+        VULKAN_DRIVER_CHECK_FUN(m_AnimationEvaluator->Create());
+    }
+
+    VulkanSkinningCreateInfo createInfo;
+    createInfo.m_Device = m_Device;
+    createInfo.m_PhysicalDevice = m_HeadlessDevice->GetPhysicalDevice();
+    createInfo.m_PipelineCache = m_HeadlessDevice->GetPipelineCache();
+    createInfo.m_QueueFamilyIndex = m_HeadlessDevice->GetQueueFamilyIndex();
+    createInfo.m_MaxInstances = maxInstances;
+    createInfo.m_JointCount = (uint32_t)m_Character->m_Skeleton.m_Parents.size();
+    createInfo.m_Mesh = &m_Character->m_Mesh;
+    m_Skinning = New<VulkanSkinning>(MemoryTag::GraphicDriver);
+    if (!m_Skinning->Create(createInfo) || !m_Skinning->CreateDrawPipeline(*m_SceneAttachments, m_RenderPass) ||
+        (nullptr != m_CascadedShadows && !m_Skinning->CreateShadowPipeline(*m_CascadedShadows)) || !ReserveFrameRing()) {
+        DestroySkinning();
+        return false;
+    }
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroySkinning()
+{
+    if (nullptr != m_Skinning) {
+        m_Skinning->Destroy();
+        Delete(m_Skinning);
+        m_Skinning = nullptr;
+    }
+}
+
+bool VulkanOffscreenRenderer::CreateOcclusionCuller(uint32_t maxInstances)
+{
+    DestroyOcclusionCuller();
+
+    // The pyramid is built from a single sampled depth, kept for the second pass to test against & load.
+    SceneAttachmentSettings attachmentSettings = m_SceneAttachments->GetSettings();
+    attachmentSettings.m_Samples = 1;
+    attachmentSettings.m_Depth = true;
+    attachmentSettings.m_SampledDepth = true;
+    m_OcclusionAttachments = New<VulkanSceneAttachments>(MemoryTag::GraphicDriver);
+    if (!m_OcclusionAttachments->Create(m_Device, m_HeadlessDevice->GetPhysicalDevice(), COLOR_FORMAT, attachmentSettings) ||
+        !m_OcclusionAttachments->CreateRenderPass(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, OCCLUSION_DEPENDENCIES, 2, m_OcclusionRenderPass) ||
+        !m_OcclusionAttachments->CreateRenderPass(VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, OCCLUSION_DEPENDENCIES, 2, m_OcclusionLateRenderPass, true) ||
+        !CreatePipeline("Data/Engine/procedural_scene.fs.spv", VK_NULL_HANDLE, PipelinePass::OcclusionCulled, m_OcclusionPipelineLayout, m_OcclusionPipeline)) {
+        DestroyOcclusionCuller();
+        return false;
+    }
+
+    VulkanOcclusionCullerCreateInfo createInfo;
+    createInfo.m_Device = m_Device;
+    createInfo.m_PhysicalDevice = m_HeadlessDevice->GetPhysicalDevice();
+    createInfo.m_PipelineCache = m_HeadlessDevice->GetPipelineCache();
+    createInfo.m_QueueFamilyIndex = m_HeadlessDevice->GetQueueFamilyIndex();
+    createInfo.m_MaxInstances = maxInstances;
+    createInfo.m_VertexCount = PROCEDURAL_CUBE_VERTEX_COUNT;
+    m_OcclusionCuller = New<VulkanOcclusionCuller>(MemoryTag::GraphicDriver);
+    if (!m_OcclusionCuller->Create(createInfo) || (0 != m_Extent.width && !CreateOcclusionTarget())) {
+        DestroyOcclusionCuller();
+        return false;
+    }
+    m_OcclusionInstances = 0;
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyOcclusionCuller()
+{
+    DestroyOcclusionTarget();
+    if (nullptr != m_OcclusionCuller) {
+        m_OcclusionCuller->Destroy();
+        Delete(m_OcclusionCuller);
+        m_OcclusionCuller = nullptr;
+    }
+    if (VK_NULL_HANDLE != m_OcclusionPipeline) {
+        vkDestroyPipeline(m_Device, m_OcclusionPipeline, GetVulkanAllocator());
+        m_OcclusionPipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_OcclusionPipelineLayout) {
+        vkDestroyPipelineLayout(m_Device, m_OcclusionPipelineLayout, GetVulkanAllocator());
+        m_OcclusionPipelineLayout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_OcclusionLateRenderPass) {
+        vkDestroyRenderPass(m_Device, m_OcclusionLateRenderPass, GetVulkanAllocator());
+        m_OcclusionLateRenderPass = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_OcclusionRenderPass) {
+        vkDestroyRenderPass(m_Device, m_OcclusionRenderPass, GetVulkanAllocator());
+        m_OcclusionRenderPass = VK_NULL_HANDLE;
+    }
+    if (nullptr != m_OcclusionAttachments) {
+        m_OcclusionAttachments->Destroy();
+        Delete(m_OcclusionAttachments);
+        m_OcclusionAttachments = nullptr;
+    }
+    m_OcclusionInstances = 0;
+}
+
+bool VulkanOffscreenRenderer::CreateOcclusionTarget()
+{
+    DestroyOcclusionTarget();
+    VULKAN_DRIVER_CHECK_FUN(m_OcclusionAttachments->CreateImages(m_Extent));
+
+    // Both passes render into the target, their attachments only differ in load ops so one framebuffer serves both.
+    VkImageView attachments[VulkanSceneAttachments::MAX_ATTACHMENTS];
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_OcclusionRenderPass;
+    framebufferInfo.attachmentCount = m_OcclusionAttachments->GetFramebufferAttachments(m_Target.m_View, attachments);
+    framebufferInfo.pAttachments = attachments;
+    framebufferInfo.width = m_Extent.width;
+    framebufferInfo.height = m_Extent.height;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(m_Device, &framebufferInfo, GetVulkanAllocator(), &m_OcclusionFramebuffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create occlusion framebuffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    return m_OcclusionCuller->CreateTargets(m_Extent, m_OcclusionAttachments->GetDepthView());
+}
+
+void VulkanOffscreenRenderer::DestroyOcclusionTarget()
+{
+    if (nullptr != m_OcclusionCuller) {
+        m_OcclusionCuller->DestroyTargets();
+    }
+    if (VK_NULL_HANDLE != m_OcclusionFramebuffer) {
+        vkDestroyFramebuffer(m_Device, m_OcclusionFramebuffer, GetVulkanAllocator());
+        m_OcclusionFramebuffer = VK_NULL_HANDLE;
+    }
+    if (nullptr != m_OcclusionAttachments) {
+        m_OcclusionAttachments->DestroyImages();
+    }
+}
+
+bool VulkanOffscreenRenderer::CreateVirtualTexture(const char* path, uint32_t cacheSlots)
+{
+    DestroyVirtualTexture();
+
+    // Pages are only read from the texture's own workers, so their completions are all its own.
+    m_Streaming = New<StreamingIO>(MemoryTag::GraphicDriver);
+    VULKAN_DRIVER_CHECK_FUN(m_Streaming->Create());
+
+    VulkanVirtualTextureCreateInfo createInfo;
+    createInfo.m_Device = m_Device;
+    createInfo.m_PhysicalDevice = m_HeadlessDevice->GetPhysicalDevice();
+    createInfo.m_PipelineCache = m_HeadlessDevice->GetPipelineCache();
+    createInfo.m_Streaming = m_Streaming;
+    createInfo.m_Path = path;
+    createInfo.m_CacheSlots = cacheSlots;
+    createInfo.m_SparseResidency = m_HeadlessDevice->IsSparseResidencyEnabled();
+    m_VirtualTexture = New<VulkanVirtualTexture>(MemoryTag::GraphicDriver);
+    if (!m_VirtualTexture->Create(createInfo)) {
+        DestroyVirtualTexture();
+        return false;
+    }
+
+    // The feedback only needs the nearest page per texel, no MSAA.
+    SceneAttachmentSettings attachmentSettings = m_SceneAttachments->GetSettings();
+    attachmentSettings.m_Samples = 1;
+    attachmentSettings.m_Depth = true;
+    attachmentSettings.m_SampledDepth = false;
+    m_FeedbackAttachments = New<VulkanSceneAttachments>(MemoryTag::GraphicDriver);
+    if (!m_FeedbackAttachments->Create(m_Device, m_HeadlessDevice->GetPhysicalDevice(), VK_FORMAT_R32_UINT, attachmentSettings) ||
+        !m_FeedbackAttachments->CreateRenderPass(VK_IMAGE_LAYOUT_GENERAL, TEMPORAL_DEPENDENCIES, 2, m_FeedbackRenderPass) ||
+        !CreatePipeline("Data/Engine/virtual_texture_feedback.fs.spv", m_VirtualTexture->GetDescriptorSetLayout(), PipelinePass::VirtualFeedback,
+            m_FeedbackPipelineLayout, m_FeedbackPipeline) ||
+        !CreatePipeline("Data/Engine/virtual_textured_scene.fs.spv", m_VirtualTexture->GetDescriptorSetLayout(), PipelinePass::Forward,
+            m_VirtualPipelineLayout, m_VirtualPipeline) ||
+        (0 != m_Extent.width && !CreateFeedbackTarget())) {
+        DestroyVirtualTexture();
+        return false;
+    }
+    m_VirtualTexturePath = path;
+    m_VirtualTextureCacheSlots = cacheSlots;
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyVirtualTexture()
+{
+    DestroyFeedbackTarget();
+    VkPipeline* pipelines[2] = { &m_VirtualPipeline, &m_FeedbackPipeline };
+    VkPipelineLayout* pipelineLayouts[2] = { &m_VirtualPipelineLayout, &m_FeedbackPipelineLayout };
+    for (uint32_t i = 0; i < 2; i++) {
+        if (VK_NULL_HANDLE != *pipelines[i]) {
+            vkDestroyPipeline(m_Device, *pipelines[i], GetVulkanAllocator());
+            *pipelines[i] = VK_NULL_HANDLE;
+        }
+        if (VK_NULL_HANDLE != *pipelineLayouts[i]) {
+            vkDestroyPipelineLayout(m_Device, *pipelineLayouts[i], GetVulkanAllocator());
+            *pipelineLayouts[i] = VK_NULL_HANDLE;
+        }
+    }
+    if (VK_NULL_HANDLE != m_FeedbackRenderPass) {
+        vkDestroyRenderPass(m_Device, m_FeedbackRenderPass, GetVulkanAllocator());
+        m_FeedbackRenderPass = VK_NULL_HANDLE;
+    }
+    if (nullptr != m_FeedbackAttachments) {
+        m_FeedbackAttachments->Destroy();
+        Delete(m_FeedbackAttachments);
+        m_FeedbackAttachments = nullptr;
+    }
+    // Waits for its reads, before the workers go.
+    if (nullptr != m_VirtualTexture) {
+        m_VirtualTexture->Destroy();
+        Delete(m_VirtualTexture);
+        m_VirtualTexture = nullptr;
+    }
+    if (nullptr != m_Streaming) {
+        m_Streaming->Destroy();
+        Delete(m_Streaming);
+        m_Streaming = nullptr;
+    }
+    m_VirtualTexturePath.clear();
+    m_VirtualTextureCacheSlots = 0;
+}
+
+bool VulkanOffscreenRenderer::CreateFeedbackTarget()
+{
+    DestroyFeedbackTarget();
+    VkExtent2D feedbackExtent = m_VirtualTexture->GetFeedbackExtent(m_Extent);
+    VULKAN_DRIVER_CHECK_FUN(m_FeedbackAttachments->CreateImages(feedbackExtent));
+    VULKAN_DRIVER_CHECK_FUN(CreateImage2D(m_Device, m_HeadlessDevice->GetPhysicalDevice(), feedbackExtent, VK_FORMAT_R32_UINT,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_STORAGE_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_FeedbackTarget));
+
+    VkImageView attachments[VulkanSceneAttachments::MAX_ATTACHMENTS];
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_FeedbackRenderPass;
+    framebufferInfo.attachmentCount = m_FeedbackAttachments->GetFramebufferAttachments(m_FeedbackTarget.m_View, attachments);
+    framebufferInfo.pAttachments = attachments;
+    framebufferInfo.width = feedbackExtent.width;
+    framebufferInfo.height = feedbackExtent.height;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(m_Device, &framebufferInfo, GetVulkanAllocator(), &m_FeedbackFramebuffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create virtual texture feedback framebuffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VULKAN_DRIVER_CHECK_FUN(m_VirtualTexture->CreateTargets(feedbackExtent, m_FeedbackTarget.m_View));
+    m_FeedbackExtent = feedbackExtent;
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyFeedbackTarget()
+{
+    if (nullptr != m_VirtualTexture) {
+        m_VirtualTexture->DestroyTargets();
+    }
+    if (VK_NULL_HANDLE != m_FeedbackFramebuffer) {
+        vkDestroyFramebuffer(m_Device, m_FeedbackFramebuffer, GetVulkanAllocator());
+        m_FeedbackFramebuffer = VK_NULL_HANDLE;
+    }
+    DestroyImage(m_Device, m_FeedbackTarget);
+    if (nullptr != m_FeedbackAttachments) {
+        m_FeedbackAttachments->DestroyImages();
+    }
+    m_FeedbackExtent = { 0, 0 };
+}
+
+bool VulkanOffscreenRenderer::CreateMeshletCuller(const glm::vec4& grid, uint32_t instanceCount)
+{
+    DestroyMeshletCuller();
+
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t> indices;
+    BuildProceduralMesh(grid, instanceCount, positions, indices);
+    MeshletMesh mesh;
+    if (!BuildMeshlets(positions.data(), positions.size(), indices.data(), indices.size(), mesh)) {
+        return false;
+    }
+
+    // The headless device enables no mesh shader nor draw indirect count extension, culled meshlets are drawn with no instances.
+    VulkanMeshletCullerCreateInfo createInfo;
+    createInfo.m_Device = m_Device;
+    createInfo.m_PhysicalDevice = m_HeadlessDevice->GetPhysicalDevice();
+    createInfo.m_MeshShaderSupported = false;
+    createInfo.m_MultiDrawIndirectSupported = m_HeadlessDevice->IsMultiDrawIndirectEnabled();
+    createInfo.m_DrawIndirectCountSupported = false;
+    createInfo.m_DrawIndirectFirstInstanceSupported = m_HeadlessDevice->IsDrawIndirectFirstInstanceEnabled();
+    m_MeshletCuller = New<VulkanMeshletCuller>(MemoryTag::GraphicDriver);
+    if (!m_MeshletCuller->Create(createInfo, mesh, positions.data(), positions.size()) ||
+        !m_MeshletCuller->CreateDrawPipeline(*m_SceneAttachments, m_RenderPass)) {
+        DestroyMeshletCuller();
+        return false;
+    }
+    m_MeshletGrid = grid;
+    m_MeshletInstances = instanceCount;
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyMeshletCuller()
+{
+    if (nullptr != m_MeshletCuller) {
+        m_MeshletCuller->Destroy();
+        Delete(m_MeshletCuller);
+        m_MeshletCuller = nullptr;
+    }
+    m_MeshletInstances = 0;
+}
+
+bool VulkanOffscreenRenderer::ReserveFrameRing()
+{
+    // Each allocation may be padded up to the storage alignment, at most 256 bytes.
+    VkDeviceSize required = OFFSCREEN_FRAME_RING_CONSTANT_BYTES;
+    if (nullptr != m_Skinning) {
+        required += m_Skinning->GetPaletteBytes(m_Skinning->GetMaxInstances()) + 256;
+    }
+    if (nullptr != m_DrawBatcher) {
+        required += m_DrawBatcher->GetInstanceBytes() + 256;
+    }
+    if (required <= m_FrameRing->GetBytesPerFrame()) {
+        return true;
+    }
+    // Same object, its users see the generation change & point their descriptors at the new buffer.
+    m_FrameRing->Destroy();
+    return m_FrameRing->Create(m_Device, m_HeadlessDevice->GetPhysicalDevice(), 1, required);
+}
+
+bool VulkanOffscreenRenderer::CreateDrawBatcher(uint32_t maxInstances)
+{
+    DestroyDrawBatcher();
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    if (vkCreateDescriptorSetLayout(m_Device, &layoutInfo, GetVulkanAllocator(), &m_BatchMaterialSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create batched material set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    m_DrawBatcher = New<VulkanDrawBatcher>(MemoryTag::GraphicDriver);
+    if (!m_DrawBatcher->Create(m_Device, m_FrameRing, maxInstances) || !ReserveFrameRing() ||
+        !CreatePipeline("Data/Engine/procedural_scene.fs.spv", m_DrawBatcher->GetInstanceSetLayout(), PipelinePass::Batched, m_BatchedPipelineLayout, m_BatchedPipeline)) {
+        DestroyDrawBatcher();
+        return false;
+    }
+    m_DrawBatcher->RegisterPipeline(0, m_BatchedPipeline, m_BatchedPipelineLayout);
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyDrawBatcher()
+{
+    if (nullptr != m_DrawBatcher) {
+        m_DrawBatcher->Destroy();
+        Delete(m_DrawBatcher);
+        m_DrawBatcher = nullptr;
+    }
+    m_BatchedObjects.clear();
+    DestroyBuffer(m_Device, m_BatchedVertices);
+    DestroyBuffer(m_Device, m_BatchedIndices);
+    if (VK_NULL_HANDLE != m_BatchedPipeline) {
+        vkDestroyPipeline(m_Device, m_BatchedPipeline, GetVulkanAllocator());
+        m_BatchedPipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_BatchedPipelineLayout) {
+        vkDestroyPipelineLayout(m_Device, m_BatchedPipelineLayout, GetVulkanAllocator());
+        m_BatchedPipelineLayout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_BatchMaterialSetLayout) {
+        vkDestroyDescriptorSetLayout(m_Device, m_BatchMaterialSetLayout, GetVulkanAllocator());
+        m_BatchMaterialSetLayout = VK_NULL_HANDLE;
+    }
+}
+
+bool VulkanOffscreenRenderer::UpdateBatchedObjects(const OffscreenFrameDesc& desc)
+{
+    // Every frame the view moves, kept only until the objects are updated.
+    OcclusionBounds* bounds = FrameArena::AllocateArray<OcclusionBounds>(desc.m_InstanceCount);
+    if (nullptr == bounds) {
+        return false;
+    }
+    BuildProceduralBounds(desc.m_Constants.m_Grid, desc.m_InstanceCount, bounds);
+    auto getDepth = [&](const OcclusionBounds& cube) {
+        return -(desc.m_View * glm::vec4(glm::vec3(cube.m_Center), 1.0f)).z / desc.m_FarPlane;
+    };
+
+    // Only the depths move with the view, the batches are sorted again but no instance changes.
+    if (desc.m_InstanceCount == (uint32_t)m_BatchedObjects.size() && desc.m_Constants.m_Grid == m_BatchedGrid) {
+        if (desc.m_View != m_BatchedView) {
+            for (uint32_t i = 0; i < desc.m_InstanceCount; i++) {
+                DrawInstanceData instance;
+                instance.m_Transform = glm::translate(glm::mat4(1.0f), glm::vec3(bounds[i].m_Center.x, 0.0f, bounds[i].m_Center.z));
+                instance.m_Params = glm::vec4((float)i, 0.0f, 0.0f, 0.0f);
+                m_DrawBatcher->UpdateObject(m_BatchedObjects[i], instance, getDepth(bounds[i]));
+            }
+            m_BatchedView = desc.m_View;
+        }
+        return true;
+    }
+
+    // The previous frame's fence was waited on, the meshes can be replaced.
+    for (uint32_t objectID : m_BatchedObjects) {
+        m_DrawBatcher->RemoveObject(objectID);
+    }
+    m_BatchedObjects.clear();
+    DestroyBuffer(m_Device, m_BatchedVertices);
+    DestroyBuffer(m_Device, m_BatchedIndices);
+
+    std::vector<glm::vec4> vertices;
+    std::vector<uint32_t> indices;
+    BuildProceduralCubeMeshes(desc.m_Constants.m_Grid.z, vertices, indices);
+    VULKAN_DRIVER_CHECK_FUN(UploadBuffer(m_Device, m_HeadlessDevice->GetPhysicalDevice(), vertices.data(), sizeof(glm::vec4) * vertices.size(),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_BatchedVertices));
+    VULKAN_DRIVER_CHECK_FUN(UploadBuffer(m_Device, m_HeadlessDevice->GetPhysicalDevice(), indices.data(), sizeof(uint32_t) * indices.size(),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_BatchedIndices));
+    uint32_t verticesPerMesh = (uint32_t)vertices.size() / PROCEDURAL_CUBE_HEIGHTS;
+    for (uint32_t mesh = 0; mesh < PROCEDURAL_CUBE_HEIGHTS; mesh++) {
+        m_DrawBatcher->RegisterMesh(mesh, DrawMesh{ m_BatchedVertices.m_Buffer, m_BatchedIndices.m_Buffer, VK_INDEX_TYPE_UINT32,
+            (uint32_t)indices.size(), 0, (int32_t)(mesh * verticesPerMesh) });
+    }
+
+    m_BatchedObjects.resize(desc.m_InstanceCount);
+    for (uint32_t i = 0; i < desc.m_InstanceCount; i++) {
+        DrawObjectDesc object;
+        object.m_PipelineID = 0;
+        object.m_MaterialID = 0;
+        object.m_MeshID = ProceduralHash(i) & (PROCEDURAL_CUBE_HEIGHTS - 1);
+        object.m_Depth = getDepth(bounds[i]);
+        object.m_Instance.m_Transform = glm::translate(glm::mat4(1.0f), glm::vec3(bounds[i].m_Center.x, 0.0f, bounds[i].m_Center.z));
+        object.m_Instance.m_Params = glm::vec4((float)i, 0.0f, 0.0f, 0.0f);
+        m_BatchedObjects[i] = m_DrawBatcher->AddObject(object);
+        if (DRAW_BATCH_INVALID_ID == m_BatchedObjects[i]) {
+            m_BatchedObjects.resize(i);
+            return false;
+        }
+    }
+    m_BatchedGrid = desc.m_Constants.m_Grid;
+    m_BatchedView = desc.m_View;
+    return true;
+}
+
+uint32_t VulkanOffscreenRenderer::GetAnimationThreadCount() const
+{
+    return (nullptr != m_AnimationEvaluator) ? m_AnimationEvaluator->GetThreadCount() : 0;
+}
+
+bool VulkanOffscreenRenderer::CreatePipeline(const char* fragmentShaderPath, VkDescriptorSetLayout setLayout, PipelinePass pass, VkPipelineLayout& pipelineLayout, VkPipeline& pipeline)
+{
+    // Shadow casters only write depth.
+    bool depthOnly = (PipelinePass::ShadowCaster == pass);
+    bool culled = (PipelinePass::OcclusionCulled == pass);
+    bool batched = (PipelinePass::Batched == pass);
+    const char* vertexShaderPath = "Data/Engine/procedural_scene.vs.spv";
+    if (culled) {
+        vertexShaderPath = "Data/Engine/procedural_scene_culled.vs.spv";
+    } else if (batched) {
+        vertexShaderPath = "Data/Engine/procedural_scene_batched.vs.spv";
+    }
+    VkShaderModule vertShaderModule = LoadShaderModule(m_Device, vertexShaderPath);
+    VkShaderModule fragShaderModule = depthOnly ? VK_NULL_HANDLE : LoadShaderModule(m_Device, fragmentShaderPath);
+    if (VK_NULL_HANDLE == vertShaderModule || (!depthOnly && VK_NULL_HANDLE == fragShaderModule)) {
+        if (VK_NULL_HANDLE != vertShaderModule) {
+            vkDestroyShaderModule(m_Device, vertShaderModule, GetVulkanAllocator());
+        }
+        if (VK_NULL_HANDLE != fragShaderModule) {
+            vkDestroyShaderModule(m_Device, fragShaderModule, GetVulkanAllocator());
+        }
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(ProceduralSceneConstants);
+
+    // Batched draws read their instances from the batcher's set, after an empty material set.
+    VkDescriptorSetLayout setLayouts[2] = { setLayout, VK_NULL_HANDLE };
+    uint32_t setLayoutCount = (VK_NULL_HANDLE != setLayout) ? 1 : 0;
+    if (batched) {
+        setLayouts[DRAW_BATCH_MATERIAL_SET] = m_BatchMaterialSetLayout;
+        setLayouts[DRAW_BATCH_INSTANCE_SET] = setLayout;
+        setLayoutCount = 2;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = setLayoutCount;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(m_Device, &pipelineLayoutInfo, GetVulkanAllocator(), &pipelineLayout) != VK_SUCCESS) {
+        if (VK_NULL_HANDLE != fragShaderModule) {
+            vkDestroyShaderModule(m_Device, fragShaderModule, GetVulkanAllocator());
+        }
+        vkDestroyShaderModule(m_Device, vertShaderModule, GetVulkanAllocator());
+        std::cout << "Vulkan failed to create pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkPipelineShaderStageCreateInfo shaderStages[2] = {};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName = "main";
+
+    // Geometry comes from gl_VertexIndex & gl_InstanceIndex, culled instances from the culler's list instead, batched
+    // cubes from their meshes.
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    VkVertexInputBindingDescription instanceBinding{};
+    VkVertexInputAttributeDescription instanceAttribute{};
+    if (culled) {
+        VulkanOcclusionCuller::GetVertexInputState(instanceBinding, instanceAttribute);
+        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.pVertexBindingDescriptions = &instanceBinding;
+        vertexInputInfo.vertexAttributeDescriptionCount = 1;
+        vertexInputInfo.pVertexAttributeDescriptions = &instanceAttribute;
+    } else if (batched) {
+        instanceBinding = { 0, sizeof(glm::vec4), VK_VERTEX_INPUT_RATE_VERTEX };
+        instanceAttribute = { 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, 0 };
+        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.pVertexBindingDescriptions = &instanceBinding;
+        vertexInputInfo.vertexAttributeDescriptionCount = 1;
+        vertexInputInfo.pVertexAttributeDescriptions = &instanceAttribute;
+    }
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    VkPipelineColorBlendAttachmentState colorBlendAttachments[VulkanDeferredPass::GBUFFER_COLOR_COUNT] = {};
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.pAttachments = colorBlendAttachments;
+    if (PipelinePass::DeferredGeometry == pass) {
+        m_DeferredPass->GetGeometryPipelineState(multisampling, depthStencil, colorBlendAttachments);
+        colorBlending.attachmentCount = VulkanDeferredPass::GBUFFER_COLOR_COUNT;
+    } else if (depthOnly) {
+        m_CascadedShadows->GetPipelineState(rasterizer, depthStencil);
+        multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        colorBlending.attachmentCount = 0;
+    } else {
+        VulkanSceneAttachments* attachments = m_SceneAttachments;
+        if (PipelinePass::Temporal == pass) {
+            attachments = m_TemporalAttachments;
+        } else if (culled) {
+            attachments = m_OcclusionAttachments;
+        } else if (PipelinePass::VirtualFeedback == pass) {
+            attachments = m_FeedbackAttachments;
+        }
+        attachments->GetPipelineState(multisampling, depthStencil);
+        colorBlendAttachments[0].colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachments[0].blendEnable = VK_FALSE;
+        colorBlending.attachmentCount = 1;
+    }
+
+    // Resolution changes per job without rebuilding the pipeline.
+    VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = depthOnly ? 1 : 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = pipelineLayout;
+    switch (pass) {
+    case PipelinePass::DeferredGeometry:
+        pipelineInfo.renderPass = m_DeferredPass->GetRenderPass();
+        break;
+    case PipelinePass::ShadowCaster:
+        pipelineInfo.renderPass = m_CascadedShadows->GetRenderPass();
+        break;
+    case PipelinePass::Temporal:
+        pipelineInfo.renderPass = m_TemporalRenderPass;
+        break;
+    case PipelinePass::OcclusionCulled:
+        pipelineInfo.renderPass = m_OcclusionRenderPass;
+        break;
+    case PipelinePass::VirtualFeedback:
+        pipelineInfo.renderPass = m_FeedbackRenderPass;
+        break;
+    default:
+        pipelineInfo.renderPass = m_RenderPass;
+        break;
+    }
+    pipelineInfo.subpass = 0;
+
+    VkResult result = vkCreateGraphicsPipelines(m_Device, m_HeadlessDevice->GetPipelineCache(), 1, &pipelineInfo, GetVulkanAllocator(), &pipeline);
+    if (VK_NULL_HANDLE != fragShaderModule) {
+        vkDestroyShaderModule(m_Device, fragShaderModule, GetVulkanAllocator());
+    }
+    vkDestroyShaderModule(m_Device, vertShaderModule, GetVulkanAllocator());
+    if (VK_SUCCESS != result) {
+        std::cout << "Vulkan failed to create offscreen pipeline.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanOffscreenRenderer::CreateTarget(VkExtent2D extent)
+{
+    DestroyTarget();
+
+    VkPhysicalDevice physicalDevice = m_HeadlessDevice->GetPhysicalDevice();
+    VULKAN_DRIVER_CHECK_FUN(m_SceneAttachments->CreateImages(extent));
+    // Temporal frames are blitted into it instead of rendered.
+    VULKAN_DRIVER_CHECK_FUN(CreateImage2D(m_Device, physicalDevice, extent, COLOR_FORMAT,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_IMAGE_ASPECT_COLOR_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_Target));
+
+    VkImageView attachments[VulkanSceneAttachments::MAX_ATTACHMENTS];
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_RenderPass;
+    framebufferInfo.attachmentCount = m_SceneAttachments->GetFramebufferAttachments(m_Target.m_View, attachments);
+    framebufferInfo.pAttachments = attachments;
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(m_Device, &framebufferInfo, GetVulkanAllocator(), &m_Framebuffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create offscreen framebuffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    // Cached memory makes the CPU read of the pixels much faster, it just needs an invalidate.
+    VkDeviceSize readbackSize = (VkDeviceSize)extent.width * extent.height * 4;
+    m_ReadbackCoherent = false;
+    if (UINT32_MAX == FindMemoryType(physicalDevice, UINT32_MAX, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT) ||
+        !CreateBuffer(m_Device, physicalDevice, readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, m_Readback)) {
+        m_ReadbackCoherent = true;
+        VULKAN_DRIVER_CHECK_FUN(CreateBuffer(m_Device, physicalDevice, readbackSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_Readback));
+    }
+
+    m_Extent = extent;
+    if (nullptr != m_DeferredPass) {
+        VULKAN_DRIVER_CHECK_FUN(CreateDeferredTarget());
+    }
+    if (nullptr != m_PostProcess) {
+        VULKAN_DRIVER_CHECK_FUN(CreatePostTarget());
+    }
+    if (nullptr != m_OcclusionCuller) {
+        VULKAN_DRIVER_CHECK_FUN(CreateOcclusionTarget());
+    }
+    if (nullptr != m_VirtualTexture) {
+        VULKAN_DRIVER_CHECK_FUN(CreateFeedbackTarget());
+    }
+    return true;
+}
+
+void VulkanOffscreenRenderer::DestroyTarget()
+{
+    DestroyTemporalTarget();
+    DestroyOcclusionTarget();
+    DestroyFeedbackTarget();
+    if (nullptr != m_PostProcess) {
+        m_PostProcess->DestroyTargets();
+    }
+    DestroyImage(m_Device, m_PostTarget);
+    if (VK_NULL_HANDLE != m_DeferredFramebuffer) {
+        vkDestroyFramebuffer(m_Device, m_DeferredFramebuffer, GetVulkanAllocator());
+        m_DeferredFramebuffer = VK_NULL_HANDLE;
+    }
+    if (nullptr != m_DeferredPass) {
+        m_DeferredPass->DestroyImages();
+    }
+    if (VK_NULL_HANDLE != m_Framebuffer) {
+        vkDestroyFramebuffer(m_Device, m_Framebuffer, GetVulkanAllocator());
+        m_Framebuffer = VK_NULL_HANDLE;
+    }
+    DestroyImage(m_Device, m_Target);
+    DestroyBuffer(m_Device, m_Readback);
+    if (nullptr != m_SceneAttachments) {
+        m_SceneAttachments->DestroyImages();
+    }
+    m_Extent = { 0, 0 };
+}
+
+bool VulkanOffscreenRenderer::Render(const OffscreenFrameDesc& desc, std::vector<uint8_t>& rgba)
+{
+    PROFILE_FUNCTION();
+    if (0 == desc.m_Width || 0 == desc.m_Height) {
+        return false;
+    }
+
+    auto recordStart = std::chrono::steady_clock::now();
+    if (desc.m_Width != m_Extent.width || desc.m_Height != m_Extent.height) {
+        VULKAN_DRIVER_CHECK_FUN(CreateTarget({ desc.m_Width, desc.m_Height }));
+    }
+    bool lit = (nullptr != desc.m_Lights && desc.m_LightCount > 0);
+    if (lit && (nullptr == m_ClusteredLighting || desc.m_LightCount > m_ClusteredLighting->GetMaxLights())) {
+        VULKAN_DRIVER_CHECK_FUN(CreateClusteredLighting(desc.m_LightCount));
+    }
+    bool deferred = lit && desc.m_Deferred;
+    if (deferred && nullptr == m_DeferredPass) {
+        VULKAN_DRIVER_CHECK_FUN(CreateDeferredPass());
+    }
+    bool shadowed = !lit && desc.m_Shadows;
+    if (shadowed && nullptr == m_CascadedShadows) {
+        VULKAN_DRIVER_CHECK_FUN(CreateCascadedShadows());
+    }
+    bool postProcessed = (OffscreenPostProcess::None != desc.m_PostProcess);
+    if (postProcessed && desc.m_PostProcess != m_PostProcessMode) {
+        VULKAN_DRIVER_CHECK_FUN(CreatePostProcess(desc.m_PostProcess));
+    }
+    bool temporal = !lit && !shadowed && desc.m_TemporalScale > 0.0f;
+    VkExtent2D renderExtent = m_Extent;
+    if (temporal) {
+        if (nullptr == m_TemporalUpscaler) {
+            VULKAN_DRIVER_CHECK_FUN(CreateTemporalUpscaler());
+        }
+        float scale = std::max(OFFSCREEN_MIN_TEMPORAL_SCALE, std::min(desc.m_TemporalScale, 1.0f));
+        renderExtent.width = std::max(1u, (uint32_t)(m_Extent.width * scale + 0.5f));
+        renderExtent.height = std::max(1u, (uint32_t)(m_Extent.height * scale + 0.5f));
+        VkExtent2D outputExtent = m_TemporalUpscaler->GetOutputExtent();
+        if (renderExtent.width != m_TemporalExtent.width || renderExtent.height != m_TemporalExtent.height ||
+            outputExtent.width != m_Extent.width || outputExtent.height != m_Extent.height) {
+            VULKAN_DRIVER_CHECK_FUN(CreateTemporalTarget(renderExtent));
+        }
+    } else if (nullptr != m_TemporalUpscaler) {
+        m_TemporalUpscaler->ResetHistory();
+    }
+    bool occluded = !lit && !shadowed && !temporal && desc.m_OcclusionCulling;
+    if (occluded) {
+        if (nullptr == m_OcclusionCuller || desc.m_InstanceCount > m_OcclusionCuller->GetMaxInstances()) {
+            VULKAN_DRIVER_CHECK_FUN(CreateOcclusionCuller(std::max(desc.m_InstanceCount, 1u)));
+        }
+        // Only rebuilt when the grid changes, the previous frame's fence was waited on.
+        if (desc.m_InstanceCount != m_OcclusionInstances || desc.m_Constants.m_Grid != m_OcclusionGrid) {
+            std::vector<OcclusionBounds> bounds(desc.m_InstanceCount);
+            BuildProceduralBounds(desc.m_Constants.m_Grid, desc.m_InstanceCount, bounds.data());
+            m_OcclusionCuller->SetBounds(bounds.data(), desc.m_InstanceCount);
+            m_OcclusionInstances = desc.m_InstanceCount;
+            m_OcclusionGrid = desc.m_Constants.m_Grid;
+        }
+    } else if (nullptr != m_OcclusionCuller) {
+        m_OcclusionCuller->ResetHistory();
+    }
+    bool virtualTextured = !lit && !shadowed && !temporal && !occluded && nullptr != desc.m_VirtualTexturePath;
+    if (virtualTextured && (nullptr == m_VirtualTexture || m_VirtualTexturePath != desc.m_VirtualTexturePath ||
+        desc.m_VirtualTextureCacheSlots != m_VirtualTextureCacheSlots)) {
+        VULKAN_DRIVER_CHECK_FUN(CreateVirtualTexture(desc.m_VirtualTexturePath, desc.m_VirtualTextureCacheSlots));
+    }
+    bool meshlets = !lit && !shadowed && !temporal && !occluded && !virtualTextured && desc.m_Meshlets;
+    // Only rebuilt when the grid changes, the previous frame's fence was waited on.
+    if (meshlets && (nullptr == m_MeshletCuller || desc.m_InstanceCount != m_MeshletInstances || desc.m_Constants.m_Grid != m_MeshletGrid)) {
+        VULKAN_DRIVER_CHECK_FUN(CreateMeshletCuller(desc.m_Constants.m_Grid, std::max(desc.m_InstanceCount, 1u)));
+    }
+    bool batched = !lit && !shadowed && !temporal && !occluded && !virtualTextured && !meshlets && desc.m_Batched;
+    if (batched && (nullptr == m_DrawBatcher || desc.m_InstanceCount > m_DrawBatcher->GetMaxInstances())) {
+        VULKAN_DRIVER_CHECK_FUN(CreateDrawBatcher(std::max(desc.m_InstanceCount, 1u)));
+    }
+    if (batched) {
+        VULKAN_DRIVER_CHECK_FUN(UpdateBatchedObjects(desc));
+    }
+    bool particles = !deferred && !temporal && !occluded && desc.m_ParticleCapacity > 0;
+    if (particles && (nullptr == m_ParticleSystem || desc.m_ParticleCapacity > m_ParticleSystem->GetCapacity())) {
+        VULKAN_DRIVER_CHECK_FUN(CreateParticleSystem(desc.m_ParticleCapacity));
+    } else if (!particles && nullptr != m_ParticleSystem) {
+        m_ParticleSystem->Reset();
+    }
+    bool skinned = !deferred && !temporal && !occluded && desc.m_SkinnedInstances > 0;
+    if (skinned && (nullptr == m_Skinning || desc.m_SkinnedInstances > m_Skinning->GetMaxInstances())) {
+        VULKAN_DRIVER_CHECK_FUN(CreateSkinning(desc.m_SkinnedInstances));
+    } else if (!skinned) {
+        m_AnimationTime = 0.0;
+    }
+
+    // The previous frame's fence was waited on, the one frame slot's transient data can be overwritten.
+    m_FrameRing->BeginFrame(0);
+    vkResetCommandBuffer(m_CommandBuffer, 0);
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(m_CommandBuffer, &beginInfo) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to begin recording command buffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    // The previous frame's fence was waited on, so the lights & parameters can be rewritten.
+    if (lit) {
+        m_ClusteredLighting->SetLights(desc.m_Lights, desc.m_LightCount);
+        m_ClusteredLighting->RecordCull(m_CommandBuffer, desc.m_View, desc.m_Projection, desc.m_NearPlane, desc.m_FarPlane, m_Extent);
+    }
+    m_LastTiming.m_SkinningCpuMs = 0.0;
+    m_LastTiming.m_BatchedCpuMs = 0.0;
+    if (skinned) {
+        // Before the shadows, every pass of the frame draws the same skinned vertices.
+        auto animationStart = std::chrono::steady_clock::now();
+        uint32_t instanceCount = std::min(desc.m_SkinnedInstances, m_Skinning->GetMaxInstances());
+        UpdateCharacterInstances(desc.m_Constants.m_Grid, instanceCount, m_AnimationTime, m_AnimationInstances);
+        FrameRingAllocation palette;
+        if (m_FrameRing->AllocateStorage(m_Skinning->GetPaletteBytes(instanceCount), palette)) {
+            m_AnimationEvaluator->Evaluate(m_Character->m_Skeleton, m_Character->m_Clips.data(), m_AnimationInstances.data(), instanceCount,
+                (JointMatrix*)palette.m_Mapped);
+            m_Skinning->RecordSkinning(m_CommandBuffer, 0, palette, instanceCount);
+        }
+        m_AnimationTime += OFFSCREEN_ANIMATION_TIMESTEP;
+        m_LastTiming.m_SkinningCpuMs = ElapsedMilliseconds(animationStart);
+    }
+    if (shadowed) {
+        m_CascadedShadows->Update(desc.m_View, desc.m_Projection, desc.m_NearPlane, desc.m_FarPlane, desc.m_LightDirection, desc.m_StaticVersion);
+        uint32_t dynamicStart = std::min(desc.m_DynamicCasterStart, desc.m_InstanceCount);
+        auto drawCasters = [&](VkCommandBuffer commandBuffer, const glm::mat4& viewProjection, uint32_t firstInstance, uint32_t instanceCount) {
+            if (0 == instanceCount) {
+                return;
+            }
+            ProceduralSceneConstants constants = desc.m_Constants;
+            constants.m_ViewProjection = viewProjection;
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_ShadowCasterPipeline);
+            vkCmdPushConstants(commandBuffer, m_ShadowCasterPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ProceduralSceneConstants), &constants);
+            vkCmdDraw(commandBuffer, PROCEDURAL_CUBE_VERTEX_COUNT, instanceCount, 0, firstInstance);
+        };
+        m_CascadedShadows->RecordShadows(m_CommandBuffer,
+            [&](VkCommandBuffer commandBuffer, const glm::mat4& viewProjection) { drawCasters(commandBuffer, viewProjection, 0, dynamicStart); },
+            [&](VkCommandBuffer commandBuffer, const glm::mat4& viewProjection) {
+                drawCasters(commandBuffer, viewProjection, dynamicStart, desc.m_InstanceCount - dynamicStart);
+                if (skinned) {
+                    m_Skinning->RecordShadowDraw(commandBuffer, viewProjection);
+                }
+            });
+    }
+    if (particles) {
+        // A fountain in the middle of the grid, falling back onto the cubes' ground plane.
+        float gridCenter = 0.5f * (desc.m_Constants.m_Grid.x - 1.0f) * desc.m_Constants.m_Grid.y;
+        ParticleFrameParams params;
+        params.m_ViewProjection = desc.m_Constants.m_ViewProjection;
+        params.m_CameraPosition = glm::vec3(glm::inverse(desc.m_View)[3]);
+        params.m_DeltaTime = OFFSCREEN_PARTICLE_TIMESTEP;
+        params.m_EmitterPosition = glm::vec3(gridCenter, 2.0f * PROCEDURAL_CUBE_SIZE, gridCenter);
+        params.m_EmitterRadius = 0.25f * PROCEDURAL_CUBE_SIZE;
+        params.m_EmitterVelocity = glm::vec3(0.0f, 8.0f, 0.0f);
+        params.m_VelocitySpread = 3.0f;
+        params.m_EmitRate = desc.m_ParticleEmitRate;
+        m_ParticleSystem->RecordSimulate(m_CommandBuffer, 0, params);
+    }
+    if (occluded) {
+        m_OcclusionCuller->RecordEarlyCull(m_CommandBuffer, 0, desc.m_Constants.m_ViewProjection);
+    }
+    if (meshlets) {
+        m_MeshletCuller->RecordCull(m_CommandBuffer, desc.m_Constants.m_ViewProjection, glm::vec3(glm::inverse(desc.m_View)[3]));
+    }
+    if (virtualTextured) {
+        // The previous frame's feedback picks the pages to stream, the ones read since are uploaded for this one.
+        m_VirtualTexture->BeginFrame(0);
+        m_VirtualTexture->RecordUpdate(m_CommandBuffer, 0);
+
+        VkRenderPassBeginInfo feedbackPassInfo{};
+        feedbackPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        feedbackPassInfo.renderPass = m_FeedbackRenderPass;
+        feedbackPassInfo.framebuffer = m_FeedbackFramebuffer;
+        feedbackPassInfo.renderArea.offset = { 0, 0 };
+        feedbackPassInfo.renderArea.extent = m_FeedbackExtent;
+        VkClearValue feedbackClearValues[VulkanSceneAttachments::MAX_ATTACHMENTS];
+        feedbackPassInfo.clearValueCount = m_FeedbackAttachments->GetClearValues(feedbackClearValues);
+        feedbackClearValues[0].color.uint32[0] = UINT32_MAX;
+        feedbackPassInfo.pClearValues = feedbackClearValues;
+        vkCmdBeginRenderPass(m_CommandBuffer, &feedbackPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        VkViewport feedbackViewport = { 0.0f, 0.0f, (float)m_FeedbackExtent.width, (float)m_FeedbackExtent.height, 0.0f, 1.0f };
+        VkRect2D feedbackScissor = { { 0, 0 }, m_FeedbackExtent };
+        VkDescriptorSet virtualSet = m_VirtualTexture->GetDescriptorSet();
+        vkCmdSetViewport(m_CommandBuffer, 0, 1, &feedbackViewport);
+        vkCmdSetScissor(m_CommandBuffer, 0, 1, &feedbackScissor);
+        vkCmdBindPipeline(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_FeedbackPipeline);
+        vkCmdBindDescriptorSets(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_FeedbackPipelineLayout, 0, 1, &virtualSet, 0, nullptr);
+        vkCmdPushConstants(m_CommandBuffer, m_FeedbackPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ProceduralSceneConstants), &desc.m_Constants);
+        vkCmdDraw(m_CommandBuffer, PROCEDURAL_CUBE_VERTEX_COUNT, desc.m_InstanceCount, 0, 0);
+        vkCmdEndRenderPass(m_CommandBuffer);
+        m_VirtualTexture->RecordFeedback(m_CommandBuffer, 0);
+    }
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = deferred ? m_DeferredPass->GetRenderPass() : m_RenderPass;
+    renderPassInfo.framebuffer = deferred ? m_DeferredFramebuffer : m_Framebuffer;
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = renderExtent;
+    VkClearValue clearValues[VulkanDeferredPass::ATTACHMENT_COUNT];
+    renderPassInfo.clearValueCount = deferred ? m_DeferredPass->GetClearValues(clearValues) : m_SceneAttachments->GetClearValues(clearValues);
+    if (temporal) {
+        renderPassInfo.renderPass = m_TemporalRenderPass;
+        renderPassInfo.framebuffer = m_TemporalFramebuffer;
+        renderPassInfo.clearValueCount = m_TemporalAttachments->GetClearValues(clearValues);
+    } else if (occluded) {
+        renderPassInfo.renderPass = m_OcclusionRenderPass;
+        renderPassInfo.framebuffer = m_OcclusionFramebuffer;
+        renderPassInfo.clearValueCount = m_OcclusionAttachments->GetClearValues(clearValues);
+    }
+    renderPassInfo.pClearValues = clearValues;
+    vkCmdBeginRenderPass(m_CommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport = { 0.0f, 0.0f, (float)renderExtent.width, (float)renderExtent.height, 0.0f, 1.0f };
+    VkRect2D scissor = { { 0, 0 }, renderExtent };
+    vkCmdSetViewport(m_CommandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(m_CommandBuffer, 0, 1, &scissor);
+    VkPipeline pipeline = m_Pipeline;
+    VkPipelineLayout pipelineLayout = m_PipelineLayout;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    if (deferred) {
+        pipeline = m_DeferredPipeline;
+        pipelineLayout = m_DeferredPipelineLayout;
+    } else if (lit) {
+        pipeline = m_LitPipeline;
+        pipelineLayout = m_LitPipelineLayout;
+        descriptorSet = m_ClusteredLighting->GetDescriptorSet();
+    } else if (shadowed) {
+        pipeline = m_ShadowedPipeline;
+        pipelineLayout = m_ShadowedPipelineLayout;
+        descriptorSet = m_CascadedShadows->GetDescriptorSet();
+    } else if (temporal) {
+        pipeline = m_TemporalPipeline;
+        pipelineLayout = m_TemporalPipelineLayout;
+    } else if (occluded) {
+        pipeline = m_OcclusionPipeline;
+        pipelineLayout = m_OcclusionPipelineLayout;
+    } else if (virtualTextured) {
+        pipeline = m_VirtualPipeline;
+        pipelineLayout = m_VirtualPipelineLayout;
+        descriptorSet = m_VirtualTexture->GetDescriptorSet();
+    } else if (batched) {
+        pipeline = m_BatchedPipeline;
+        pipelineLayout = m_BatchedPipelineLayout;
+    }
+    ProceduralSceneConstants constants = desc.m_Constants;
+    if (temporal) {
+        glm::vec2 jitter = m_TemporalUpscaler->GetJitter(renderExtent);
+        constants.m_ViewProjection = VulkanTemporalUpscaler::JitterProjection(desc.m_Projection, jitter, renderExtent) * desc.m_View;
+    }
+    vkCmdBindPipeline(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    if (VK_NULL_HANDLE != descriptorSet) {
+        vkCmdBindDescriptorSets(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    }
+    vkCmdPushConstants(m_CommandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ProceduralSceneConstants), &constants);
+    if (occluded) {
+        m_OcclusionCuller->RecordEarlyDraw(m_CommandBuffer);
+    } else if (meshlets) {
+        m_MeshletCuller->RecordDraw(m_CommandBuffer, viewport, scissor);
+    } else if (batched) {
+        auto batchStart = std::chrono::steady_clock::now();
+        m_DrawBatcher->Prepare();
+        m_DrawBatcher->RecordDraws(m_CommandBuffer);
+        m_LastTiming.m_BatchedCpuMs = ElapsedMilliseconds(batchStart);
+    } else {
+        vkCmdDraw(m_CommandBuffer, PROCEDURAL_CUBE_VERTEX_COUNT, desc.m_InstanceCount, 0, 0);
+    }
+    if (skinned) {
+        m_Skinning->RecordDraw(m_CommandBuffer, desc.m_Constants.m_ViewProjection);
+    }
+    if (particles) {
+        m_ParticleSystem->RecordDraw(m_CommandBuffer);
+    }
+    if (deferred) {
+        m_DeferredPass->RecordLighting(m_CommandBuffer, m_ClusteredLighting->GetDescriptorSet());
+        m_DeferredPass->GetBandwidth(m_Extent, m_LastBandwidth);
+    } else if (temporal) {
+        m_TemporalAttachments->GetBandwidth(renderExtent, m_LastBandwidth);
+    } else if (occluded) {
+        m_OcclusionAttachments->GetBandwidth(m_Extent, m_LastBandwidth);
+    } else {
+        m_SceneAttachments->GetBandwidth(m_Extent, m_LastBandwidth);
+    }
+    vkCmdEndRenderPass(m_CommandBuffer);
+
+    if (occluded) {
+        // The pyramid from what the first pass drew, then the cubes it shows came into view on top of that.
+        m_OcclusionCuller->RecordLateCull(m_CommandBuffer, 0);
+        renderPassInfo.renderPass = m_OcclusionLateRenderPass;
+        vkCmdBeginRenderPass(m_CommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdSetViewport(m_CommandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(m_CommandBuffer, 0, 1, &scissor);
+        vkCmdBindPipeline(m_CommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+        vkCmdPushConstants(m_CommandBuffer, pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ProceduralSceneConstants), &constants);
+        m_OcclusionCuller->RecordLateDraw(m_CommandBuffer);
+        vkCmdEndRenderPass(m_CommandBuffer);
+    }
+
+    if (temporal) {
+        // Resolved into the target, left as the pass would have for the copy or the post-processing chain.
+        TemporalUpscaleFrame frame = { renderExtent, desc.m_Constants.m_ViewProjection };
+        m_TemporalUpscaler->Record(m_CommandBuffer, 0, frame, m_Target.m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    if (postProcessed) {
+        // The pass leaves the target ready for the copy, the chain samples it instead & its output is copied.
+        CmdImageBarrier(m_CommandBuffer, m_Target.m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        CmdImageBarrier(m_CommandBuffer, m_PostTarget.m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+        m_PostProcess->Record(m_CommandBuffer, PostProcessParams());
+        CmdImageBarrier(m_CommandBuffer, m_PostTarget.m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    }
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.imageExtent = { m_Extent.width, m_Extent.height, 1 };
+    vkCmdCopyImageToBuffer(m_CommandBuffer, postProcessed ? m_PostTarget.m_Image : m_Target.m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_Readback.m_Buffer, 1, &region);
+
+    VkBufferMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.buffer = m_Readback.m_Buffer;
+    hostBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(m_CommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+
+    if (vkEndCommandBuffer(m_CommandBuffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to record command buffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    m_LastTiming.m_RecordMs = ElapsedMilliseconds(recordStart);
+
+    auto gpuStart = std::chrono::steady_clock::now();
+    {
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &m_CommandBuffer;
+
+        std::mutex& queueMutex = m_HeadlessDevice->GetQueueMutex(m_QueueIndex);
+        PROFILE_LOCK(queueMutex, "OffscreenQueue");
+        // The cache rows this frame first uploads to get their memory ahead of it, on the same queue.
+        VkSemaphore bindSemaphore = virtualTextured ? m_VirtualTexture->FlushSparseBinds(m_HeadlessDevice->GetQueue(m_QueueIndex)) : VK_NULL_HANDLE;
+        VkPipelineStageFlags bindWaitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        if (VK_NULL_HANDLE != bindSemaphore) {
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = &bindSemaphore;
+            submitInfo.pWaitDstStageMask = &bindWaitStage;
+        }
+        if (vkQueueSubmit(m_HeadlessDevice->GetQueue(m_QueueIndex), 1, &submitInfo, m_Fence) != VK_SUCCESS) {
+            std::cout << "Vulkan failed to submit offscreen command buffer.\n";
+            SetErrorCode(ErrorCode::UnKnow);
+            return false;
+        }
+    }
+    {
+        PROFILE_ZONE("WaitForOffscreenFence");
+        vkWaitForFences(m_Device, 1, &m_Fence, VK_TRUE, UINT64_MAX);
+        vkResetFences(m_Device, 1, &m_Fence);
+    }
+    m_LastTiming.m_GpuMs = ElapsedMilliseconds(gpuStart);
+    m_LastTiming.m_ShadowCpuMs = 0.0;
+    m_LastTiming.m_ShadowGpuMs = 0.0;
+    m_LastTiming.m_ShadowStaticCascades = 0;
+    if (shadowed) {
+        m_CascadedShadows->CollectGpuTiming();
+        const CascadedShadowTiming& shadowTiming = m_CascadedShadows->GetLastTiming();
+        m_LastTiming.m_ShadowCpuMs = shadowTiming.m_CpuMs;
+        m_LastTiming.m_ShadowGpuMs = shadowTiming.m_GpuMs;
+        m_LastTiming.m_ShadowStaticCascades = shadowTiming.m_StaticCascades;
+    }
+    m_LastTiming.m_TemporalGpuMs = 0.0;
+    if (temporal) {
+        m_TemporalUpscaler->CollectGpuTiming(0);
+        m_LastTiming.m_TemporalGpuMs = m_TemporalUpscaler->GetLastTiming().m_GpuMs;
+    }
+    m_LastTiming.m_ParticleGpuMs = 0.0;
+    if (particles) {
+        m_ParticleSystem->CollectGpuTiming(0);
+        m_LastTiming.m_ParticleGpuMs = m_ParticleSystem->GetLastTiming().m_GpuMs;
+    }
+    m_LastTiming.m_SkinningGpuMs = 0.0;
+    if (skinned) {
+        m_Skinning->CollectGpuTiming(0);
+        m_LastTiming.m_SkinningGpuMs = m_Skinning->GetLastTiming().m_GpuMs;
+    }
+    m_LastTiming.m_OcclusionCullGpuMs = 0.0;
+    m_LastTiming.m_OcclusionPyramidGpuMs = 0.0;
+    m_LastTiming.m_OcclusionEarlyDrawn = 0;
+    m_LastTiming.m_OcclusionLateDrawn = 0;
+    if (occluded) {
+        m_OcclusionCuller->CollectStats(0);
+        const OcclusionCullStats& stats = m_OcclusionCuller->GetLastStats();
+        m_LastTiming.m_OcclusionCullGpuMs = stats.m_CullGpuMs;
+        m_LastTiming.m_OcclusionPyramidGpuMs = stats.m_PyramidGpuMs;
+        m_LastTiming.m_OcclusionEarlyDrawn = stats.m_EarlyVisible;
+        m_LastTiming.m_OcclusionLateDrawn = stats.m_LateVisible;
+    }
+    m_LastTiming.m_VirtualPagesRequested = 0;
+    m_LastTiming.m_VirtualPagesUploaded = 0;
+    m_LastTiming.m_VirtualPagesResident = 0;
+    if (virtualTextured) {
+        const VirtualTextureStats& stats = m_VirtualTexture->GetStats();
+        m_LastTiming.m_VirtualPagesRequested = stats.m_PagesRequested;
+        m_LastTiming.m_VirtualPagesUploaded = stats.m_PagesUploaded;
+        m_LastTiming.m_VirtualPagesResident = stats.m_PagesResident;
+    }
+    m_LastTiming.m_MeshletTriangles = 0;
+    m_LastTiming.m_MeshletVisibleTriangles = 0;
+    m_LastTiming.m_MeshletCount = 0;
+    m_LastTiming.m_MeshletVisibleCount = 0;
+    if (meshlets) {
+        MeshletCullStatistics stats = m_MeshletCuller->GetStatistics();
+        m_LastTiming.m_MeshletTriangles = stats.m_TotalTriangles;
+        m_LastTiming.m_MeshletVisibleTriangles = stats.m_VisibleTriangles;
+        m_LastTiming.m_MeshletCount = stats.m_TotalMeshlets;
+        m_LastTiming.m_MeshletVisibleCount = stats.m_VisibleMeshlets;
+    }
+    m_LastTiming.m_BatchedObjects = 0;
+    m_LastTiming.m_BatchedDrawCalls = 0;
+    m_LastTiming.m_BatchedPipelineBinds = 0;
+    if (batched) {
+        const DrawBatchStatistics& stats = m_DrawBatcher->GetStatistics();
+        m_LastTiming.m_BatchedObjects = stats.m_Objects;
+        m_LastTiming.m_BatchedDrawCalls = stats.m_DrawCalls;
+        m_LastTiming.m_BatchedPipelineBinds = stats.m_PipelineBinds;
+    }
+    m_LastTiming.m_PostGpuMs = 0.0;
+    m_LastTiming.m_PostDispatches = 0;
+    if (postProcessed) {
+        m_PostProcess->CollectGpuTiming();
+        m_LastTiming.m_PostGpuMs = m_PostProcess->GetLastTiming().m_GpuMs;
+        m_LastTiming.m_PostDispatches = m_PostProcess->GetLastTiming().m_Dispatches;
+    }
+
+    auto readbackStart = std::chrono::steady_clock::now();
+    if (!m_ReadbackCoherent) {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = m_Readback.m_Memory;
+        range.offset = 0;
+        range.size = VK_WHOLE_SIZE;
+        vkInvalidateMappedMemoryRanges(m_Device, 1, &range);
+    }
+    rgba.resize((size_t)m_Readback.m_Size);
+    memcpy(rgba.data(), m_Readback.m_Mapped, rgba.size());
+    m_LastTiming.m_ReadbackMs = ElapsedMilliseconds(readbackStart);
+    return true;
+}
+
+void VulkanOffscreenRenderer::Destroy()
+{
+    if (VK_NULL_HANDLE == m_Device) {
+        return;
+    }
+
+    DestroyTarget();
+    DestroyClusteredLighting();
+    DestroyCascadedShadows();
+    DestroyPostProcess();
+    DestroyTemporalUpscaler();
+    DestroyParticleSystem();
+    DestroySkinning();
+    DestroyOcclusionCuller();
+    DestroyVirtualTexture();
+    DestroyMeshletCuller();
+    DestroyDrawBatcher();
+    // After everything taking its constants from it.
+    if (nullptr != m_FrameRing) {
+        m_FrameRing->Destroy();
+        Delete(m_FrameRing);
+        m_FrameRing = nullptr;
+    }
+    if (nullptr != m_AnimationEvaluator) {
+        m_AnimationEvaluator->Destroy();
+        Delete(m_AnimationEvaluator);
+        m_AnimationEvaluator = nullptr;
+    }
+    if (nullptr != m_Character) {
+        Delete(m_Character);
+        m_Character = nullptr;
+    }
+    if (nullptr != m_SceneAttachments) {
+        m_SceneAttachments->Destroy();
+        Delete(m_SceneAttachments);
+        m_SceneAttachments = nullptr;
+    }
+    if (VK_NULL_HANDLE != m_Pipeline) {
+        vkDestroyPipeline(m_Device, m_Pipeline, GetVulkanAllocator());
+        m_Pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_PipelineLayout) {
+        vkDestroyPipelineLayout(m_Device, m_PipelineLayout, GetVulkanAllocator());
+        m_PipelineLayout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_RenderPass) {
+        vkDestroyRenderPass(m_Device, m_RenderPass, GetVulkanAllocator());
+        m_RenderPass = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_Fence) {
+        vkDestroyFence(m_Device, m_Fence, GetVulkanAllocator());
+        m_Fence = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_CommandPool) {
+        vkDestroyCommandPool(m_Device, m_CommandPool, GetVulkanAllocator());
+        m_CommandPool = VK_NULL_HANDLE;
+        m_CommandBuffer = VK_NULL_HANDLE;
+    }
+    m_Device = VK_NULL_HANDLE;
+}
+
+__END_NAMESPACE
@@ -0,0 +1,312 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+class VulkanHeadlessDevice;
+class VulkanSceneAttachments;
+class VulkanClusteredLighting;
+class VulkanDeferredPass;
+class VulkanCascadedShadows;
+class VulkanPostProcess;
+class VulkanTemporalUpscaler;
+class VulkanParticleSystem;
+class VulkanSkinning;
+class VulkanOcclusionCuller;
+class VulkanMeshletCuller;
+class VulkanDrawBatcher;
+class VulkanVirtualTexture;
+class StreamingIO;
+class VulkanFrameRing;
+class AnimationEvaluator;
+struct AnimatedCharacter;
+struct AnimationInstance;
+struct SceneAttachmentSettings;
+struct ClusteredLight;
+
+
+// Push constants of procedural_scene.shader.*, a grid of lit cubes generated in the vertex shader.
+typedef struct ProceduralSceneConstants {
+	glm::mat4    m_ViewProjection;
+	glm::vec4    m_Grid;            // x: cubes per row, y: spacing, z: cube size
+} ProceduralSceneConstants;
+
+enum class OffscreenPostProcess : uint32_t
+{
+	None = 0,
+	Fused,          // Bloom, tonemapping, color grading, FXAA & vignette in compute, per pixel effects fused
+	Unfused,        // The same with a dispatch per effect, to compare against
+};
+
+typedef struct OffscreenFrameDesc {
+	uint32_t                  m_Width;
+	uint32_t                  m_Height;
+	uint32_t                  m_InstanceCount;
+	ProceduralSceneConstants  m_Constants;
+	glm::mat4                 m_View;
+	glm::mat4                 m_Projection;
+	float                     m_NearPlane;
+	float                     m_FarPlane;
+	const ClusteredLight*     m_Lights;          // Shaded by clustered forward+ PBR when given, else by one directional light
+	uint32_t                  m_LightCount;
+	bool                      m_Deferred;        // Lit frames only, G-buffer in subpass inputs instead of forward+
+	bool                      m_Shadows;         // Unlit frames only, the directional light casts cascaded shadows
+	glm::vec3                 m_LightDirection;  // Towards the directional light
+	uint32_t                  m_DynamicCasterStart;  // Instances from it on are dynamic shadow casters, the ones before static
+	uint64_t                  m_StaticVersion;   // Bump when a static caster moves, their cached shadows are redrawn
+	OffscreenPostProcess      m_PostProcess;
+	float                     m_TemporalScale;   // Unlit frames only, 0 off, 1 temporal AA, below 1 temporally upscaled from that fraction of the size
+	uint32_t                  m_ParticleCapacity;  // Forward frames without occlusion culling only, 0 none, else a fountain of GPU particles over the grid
+	float                     m_ParticleEmitRate;  // Particles per second, each frame simulates a fixed 1/60 s
+	uint32_t                  m_SkinnedInstances;  // Forward frames without occlusion culling only, 0 none, else animated characters between the cubes, 1/60 s further each frame
+	bool                      m_OcclusionCulling;  // Unlit, unshadowed & non temporal frames only, the cubes are culled on the GPU against a depth pyramid
+	const char*               m_VirtualTexturePath;  // Unlit, unshadowed, non temporal & unculled frames only, null off, else a set written by WriteVirtualTextureSet() the cubes are textured from
+	uint32_t                  m_VirtualTextureCacheSlots;  // Pages of its physical cache
+	bool                      m_Meshlets;          // Unlit, unshadowed, non temporal, unculled & non virtual textured frames only, the cubes are one mesh split into meshlets, culled on the GPU
+	bool                      m_Batched;           // The same frames without meshlets only, the cubes are objects of a draw batcher, indexed meshes merged into instanced draws
+} OffscreenFrameDesc;
+
+// Square grid of instanceCount cubes seen from eye, vertical field of view in degrees.
+void BuildProceduralFrameDesc(uint32_t width, uint32_t height, uint32_t instanceCount, const glm::vec3& eye, const glm::vec3& target,
+	float fieldOfView, OffscreenFrameDesc& desc);
+// Point & spot lights scattered over the grid of instanceCount cubes, each point in reach of about the same number of lights whatever lightCount is.
+void BuildProceduralLights(uint32_t instanceCount, uint32_t lightCount, std::vector<ClusteredLight>& lights);
+// Texture of a virtual texture set, a VirtualTextureGenerator: tiles of the texture's own hue with rings finer than a
+// texel at mip 0, so every mip looks different.
+void GenerateProceduralTexture(uint32_t textureIndex, uint32_t textureSize, uint8_t* rgba);
+
+typedef struct OffscreenFrameTiming {
+	double       m_RecordMs;
+	double       m_GpuMs;           // Submit to fence, includes queue contention
+	double       m_ReadbackMs;
+	double       m_ShadowCpuMs;     // Cascade fitting & recording, part of m_RecordMs
+	double       m_ShadowGpuMs;     // Shadow pass alone, 0 without timestamps
+	uint32_t     m_ShadowStaticCascades;  // Cascades whose static casters were redrawn
+	double       m_PostGpuMs;       // Post-processing chain alone, 0 without timestamps
+	uint32_t     m_PostDispatches;
+	double       m_TemporalGpuMs;   // Temporal resolve alone, 0 without timestamps
+	double       m_ParticleGpuMs;   // Particle emission, simulation & sort alone, 0 without timestamps
+	double       m_SkinningCpuMs;   // Animation sampling & blending into the palettes, part of m_RecordMs
+	double       m_SkinningGpuMs;   // Skinning dispatch alone, 0 without timestamps
+	double       m_OcclusionCullGpuMs;     // Both culling phases, 0 without timestamps
+	double       m_OcclusionPyramidGpuMs;  // Depth pyramid build alone, 0 without timestamps
+	uint32_t     m_OcclusionEarlyDrawn;    // Cubes visible in the previous frame's pyramid
+	uint32_t     m_OcclusionLateDrawn;     // Cubes hidden in it but visible in this frame's
+	uint32_t     m_VirtualPagesRequested;  // Missing pages the previous frame's feedback asked for
+	uint32_t     m_VirtualPagesUploaded;
+	uint32_t     m_VirtualPagesResident;
+	uint32_t     m_MeshletTriangles;         // Of the whole mesh
+	uint32_t     m_MeshletVisibleTriangles;  // In the meshlets left after frustum & normal cone culling
+	uint32_t     m_MeshletCount;
+	uint32_t     m_MeshletVisibleCount;
+	uint32_t     m_BatchedObjects;         // Draw calls without batching
+	uint32_t     m_BatchedDrawCalls;
+	uint32_t     m_BatchedPipelineBinds;
+	double       m_BatchedCpuMs;           // Batch preparation & draw recording, part of m_RecordMs
+} OffscreenFrameTiming;
+
+
+/**
+ * One render worker on a headless device: its own command pool, fence, attachments & readback buffer,
+ * so several of them render concurrently. The render pass & pipeline are built once and stay warm,
+ * only a resolution change reallocates the target. The clustered lighting & its pipeline are built on the
+ * first lit frame, and rebuilt only when a frame brings more lights than they hold, the deferred pass likewise
+ * on the first deferred frame, the cascaded shadows on the first shadowed one & the post-processing chain on the
+ * first frame asking for it, rebuilt when the frames switch between its fused & unfused variants.
+ *
+ * Temporal frames are drawn jittered into single sampled attachments of their own, sized by the temporal scale,
+ * and resolved into m_Target by the temporal upscaler. Its history carries over consecutive temporal frames
+ * only, any other frame in between starts it over.
+ *
+ * Particles are simulated before the pass & drawn after the opaque scene in it. The particle system is built on
+ * the first frame asking for them & rebuilt only for a larger capacity, its particles carry over consecutive
+ * particle frames, any other frame in between kills them all.
+ *
+ * Skinned characters are animated on the host into palettes of an upload ring, skinned once per frame in compute
+ * before the shadows & drawn from the skinned vertices by the dynamic shadow casters & the scene pass alike. Their
+ * clock runs over consecutive skinned frames only, like the particles.
+ *
+ * Occlusion culled frames are drawn into single sampled attachments of their own, whose depth the culler builds its
+ * pyramid from, in two passes: the cubes visible in the previous frame's pyramid, then, loading what the first one
+ * stored, those the rebuilt pyramid shows came into view. The pyramid carries over consecutive culled frames only.
+ *
+ * Virtual textured frames draw the cubes into a feedback target a fraction of the size first, whose pages the next
+ * frame streams in, then into the scene attachments sampling the pages resident so far. The virtual texture & its
+ * streaming workers are built on the first such frame & kept, its resident pages carrying over any frames between.
+ *
+ * Meshlet frames split the grid into one mesh of faces sorted by direction, built on the host when the grid changes,
+ * whose meshlets are frustum & normal cone culled in compute before the pass & drawn indirect in it.
+ *
+ * Batched frames add the cubes as objects of a draw batcher, a mesh per cube height & a transform each, which merges
+ * them into an instanced draw per mesh. They're added again when the grid changes, only their depths are updated
+ * when the view does.
+ */
+class VulkanOffscreenRenderer
+{
+public:
+	VulkanOffscreenRenderer();
+	virtual ~VulkanOffscreenRenderer();
+
+	bool Create(VulkanHeadlessDevice* headlessDevice, uint32_t queueIndex, const SceneAttachmentSettings& attachmentSettings);
+	void Destroy();
+
+	// Renders & waits, rgba receives tightly packed 8 bit sRGB pixels.
+	bool Render(const OffscreenFrameDesc& desc, std::vector<uint8_t>& rgba);
+	const OffscreenFrameTiming& GetLastTiming() const { return m_LastTiming; }
+	// Attachment traffic of the last frame's render pass, an estimate from formats & store ops.
+	const AttachmentBandwidth& GetLastBandwidth() const { return m_LastBandwidth; }
+	// Sample count & depth actually used, after clamping to the device.
+	const VulkanSceneAttachments* GetSceneAttachments() const { return m_SceneAttachments; }
+	// Null until a frame is post-processed.
+	const VulkanPostProcess* GetPostProcess() const { return m_PostProcess; }
+	// Null until a frame has skinned characters.
+	const VulkanSkinning* GetSkinning() const { return m_Skinning; }
+	// Null until a frame is occlusion culled.
+	const VulkanOcclusionCuller* GetOcclusionCuller() const { return m_OcclusionCuller; }
+	// Null until a frame is virtual textured.
+	const VulkanVirtualTexture* GetVirtualTexture() const { return m_VirtualTexture; }
+	// Null until a frame is drawn from meshlets.
+	const VulkanMeshletCuller* GetMeshletCuller() const { return m_MeshletCuller; }
+	// Null until a frame is batched.
+	const VulkanDrawBatcher* GetDrawBatcher() const { return m_DrawBatcher; }
+	// Threads sampling the animations, the recording one included, 0 until a frame has skinned characters.
+	uint32_t GetAnimationThreadCount() const;
+
+	static const VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_SRGB;
+
+private:
+	VulkanHeadlessDevice*     m_HeadlessDevice;
+	VkDevice                  m_Device;
+	uint32_t                  m_QueueIndex;
+	VkCommandPool             m_CommandPool;
+	VkCommandBuffer           m_CommandBuffer;
+	VkFence                   m_Fence;
+	VulkanFrameRing*          m_FrameRing;          // Constants, palettes & batched instances of the one frame slot
+	VulkanSceneAttachments*   m_SceneAttachments;
+	VkRenderPass              m_RenderPass;
+	VkPipelineLayout          m_PipelineLayout;
+	VkPipeline                m_Pipeline;
+	VulkanClusteredLighting*  m_ClusteredLighting;
+	VkPipelineLayout          m_LitPipelineLayout;
+	VkPipeline                m_LitPipeline;
+	VulkanDeferredPass*       m_DeferredPass;
+	VkPipelineLayout          m_DeferredPipelineLayout;
+	VkPipeline                m_DeferredPipeline;
+	VulkanCascadedShadows*    m_CascadedShadows;
+	VkPipelineLayout          m_ShadowedPipelineLayout;
+	VkPipeline                m_ShadowedPipeline;
+	VkPipelineLayout          m_ShadowCasterPipelineLayout;
+	VkPipeline                m_ShadowCasterPipeline;
+	VulkanPostProcess*        m_PostProcess;
+	OffscreenPostProcess      m_PostProcessMode;
+	VulkanSceneAttachments*   m_TemporalAttachments;   // Single sampled, with a sampled depth for the motion vectors
+	VkRenderPass              m_TemporalRenderPass;
+	VkPipelineLayout          m_TemporalPipelineLayout;
+	VkPipeline                m_TemporalPipeline;
+	VulkanTemporalUpscaler*   m_TemporalUpscaler;
+	VulkanParticleSystem*     m_ParticleSystem;
+	AnimatedCharacter*        m_Character;
+	AnimationEvaluator*       m_AnimationEvaluator;
+	VulkanSkinning*           m_Skinning;
+	std::vector<AnimationInstance>  m_AnimationInstances;
+	double                    m_AnimationTime;      // Seconds, over consecutive skinned frames
+	VulkanSceneAttachments*   m_OcclusionAttachments;  // Single sampled, with a sampled depth for the pyramid
+	VkRenderPass              m_OcclusionRenderPass;
+	VkRenderPass              m_OcclusionLateRenderPass;  // Loads what the first pass stored
+	VkPipelineLayout          m_OcclusionPipelineLayout;
+	VkPipeline                m_OcclusionPipeline;
+	VulkanOcclusionCuller*    m_OcclusionCuller;
+	glm::vec4                 m_OcclusionGrid;      // Of the bounds the culler holds
+	uint32_t                  m_OcclusionInstances;
+	StreamingIO*              m_Streaming;
+	VulkanVirtualTexture*     m_VirtualTexture;
+	std::string               m_VirtualTexturePath;    // & cache slots it was built for
+	uint32_t                  m_VirtualTextureCacheSlots;
+	VkPipelineLayout          m_VirtualPipelineLayout;
+	VkPipeline                m_VirtualPipeline;
+	VulkanSceneAttachments*   m_FeedbackAttachments;   // Single sampled R32_UINT, a page index per texel
+	VkRenderPass              m_FeedbackRenderPass;
+	VkPipelineLayout          m_FeedbackPipelineLayout;
+	VkPipeline                m_FeedbackPipeline;
+	VulkanMeshletCuller*      m_MeshletCuller;
+	glm::vec4                 m_MeshletGrid;        // Of the mesh the culler holds
+	uint32_t                  m_MeshletInstances;
+	VulkanDrawBatcher*        m_DrawBatcher;
+	VkDescriptorSetLayout     m_BatchMaterialSetLayout;  // Empty, the batched pipeline has no material set
+	VkPipelineLayout          m_BatchedPipelineLayout;
+	VkPipeline                m_BatchedPipeline;
+	VulkanBuffer              m_BatchedVertices;    // Of the cube meshes, one per height
+	VulkanBuffer              m_BatchedIndices;
+	std::vector<uint32_t>     m_BatchedObjects;     // Batcher object of each cube
+	glm::vec4                 m_BatchedGrid;        // & view the objects were last added or updated for
+	glm::mat4                 m_BatchedView;
+
+	VkExtent2D                m_Extent;
+	VulkanImage               m_Target;
+	VkFramebuffer             m_Framebuffer;
+	VkFramebuffer             m_DeferredFramebuffer;
+	VulkanImage               m_PostTarget;         // Post-processed output, read back instead of m_Target
+	VkExtent2D                m_TemporalExtent;     // Render extent of temporal frames
+	VulkanImage               m_TemporalInput;
+	VkFramebuffer             m_TemporalFramebuffer;
+	VkFramebuffer             m_OcclusionFramebuffer;
+	VkExtent2D                m_FeedbackExtent;
+	VulkanImage               m_FeedbackTarget;     // Read by the feedback dispatch in GENERAL
+	VkFramebuffer             m_FeedbackFramebuffer;
+	VulkanBuffer              m_Readback;
+	bool                      m_ReadbackCoherent;
+	OffscreenFrameTiming      m_LastTiming;
+	AttachmentBandwidth       m_LastBandwidth;
+
+	enum class PipelinePass
+	{
+		Forward,
+		DeferredGeometry,     // Geometry subpass of the deferred pass
+		ShadowCaster,         // Depth only, no fragment shader
+		Temporal,             // Forward, into the temporal attachments
+		OcclusionCulled,      // Forward, into the occlusion attachments, instances from the culler's lists
+		VirtualFeedback,      // Into the feedback attachments
+		Batched,              // Forward, indexed cube meshes & the draw batcher's instances
+	};
+
+	// Grows the frame ring to what the current skinning & draw batcher take per frame, between frames only.
+	bool ReserveFrameRing();
+	bool CreatePipeline(const char* fragmentShaderPath, VkDescriptorSetLayout setLayout, PipelinePass pass, VkPipelineLayout& pipelineLayout, VkPipeline& pipeline);
+	bool CreateClusteredLighting(uint32_t lightCount);
+	void DestroyClusteredLighting();
+	bool CreateDeferredPass();
+	void DestroyDeferredPass();
+	bool CreateDeferredTarget();
+	bool CreateCascadedShadows();
+	void DestroyCascadedShadows();
+	bool CreatePostProcess(OffscreenPostProcess mode);
+	void DestroyPostProcess();
+	bool CreatePostTarget();
+	bool CreateTemporalUpscaler();
+	void DestroyTemporalUpscaler();
+	bool CreateTemporalTarget(VkExtent2D renderExtent);
+	void DestroyTemporalTarget();
+	bool CreateParticleSystem(uint32_t capacity);
+	void DestroyParticleSystem();
+	bool CreateSkinning(uint32_t maxInstances);
+	void DestroySkinning();
+	bool CreateOcclusionCuller(uint32_t maxInstances);
+	void DestroyOcclusionCuller();
+	bool CreateOcclusionTarget();
+	void DestroyOcclusionTarget();
+	bool CreateVirtualTexture(const char* path, uint32_t cacheSlots);
+	void DestroyVirtualTexture();
+	bool CreateFeedbackTarget();
+	void DestroyFeedbackTarget();
+	bool CreateMeshletCuller(const glm::vec4& grid, uint32_t instanceCount);
+	void DestroyMeshletCuller();
+	bool CreateDrawBatcher(uint32_t maxInstances);
+	void DestroyDrawBatcher();
+	bool UpdateBatchedObjects(const OffscreenFrameDesc& desc);
+	bool CreateTarget(VkExtent2D extent);
+	void DestroyTarget();
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,663 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanSceneAttachments.h"
+#include "VulkanCommandCache.h"
+#include "VulkanFrameRing.h"
+#include "VulkanParticleSystem.h"
+
+
+__BEGIN_NAMESPACE
+
+static const uint32_t PARTICLE_GROUP_SIZE = 256;
+// Elements sorted in shared memory by one group, PARTICLE_SORT_BLOCK of particle_common.glsl.
+static const uint32_t PARTICLE_SORT_BLOCK = 512;
+// Every dispatch, reset included, stays within the 65535 groups all devices support.
+static const uint32_t PARTICLE_MAX_CAPACITY = 1u << 23;
+
+enum ParticleBinding
+{
+    ParticleBinding_Counters = 0,
+    ParticleBinding_Particles,
+    ParticleBinding_DeadList,
+    ParticleBinding_AliveLists,
+    ParticleBinding_SortEntries,
+    ParticleBinding_Constants,          // Dynamic uniform in the frame ring, the bindings before it are storage
+    ParticleBinding_Count,
+};
+
+// Same layout as ParticleCounterBuffer of particle_common.glsl.
+typedef struct ParticleCounters {
+	uint32_t             m_AliveCount[2];
+	uint32_t             m_DeadCount;
+	uint32_t             m_EmitCount;
+	uint32_t             m_EmitDispatch[3];
+	uint32_t             m_SimulateDispatch[3];
+	uint32_t             m_SortDispatch[3];
+	uint32_t             m_SortCount;
+	uint32_t             m_Draw[4];
+} ParticleCounters;
+
+// Same layout as the ParticleConstants uniform block of particle_common.glsl.
+typedef struct ParticleConstants {
+	glm::mat4            m_ViewProjection;
+	glm::vec4            m_CameraPosition;   // w: delta time
+	glm::vec4            m_Emitter;          // w: radius
+	glm::vec4            m_EmitterVelocity;  // w: spread
+	glm::uvec4           m_Frame;            // x: emitted, y: seed, z: alive list read
+} ParticleConstants;
+
+// Same layout as the SortConstants push constants of particle_sort.shader.comp.
+typedef struct SortConstants {
+	uint32_t             m_Stage;
+	uint32_t             m_Step;
+} SortConstants;
+
+// Specialization constants of particle_simulate.shader.comp.
+typedef struct ParticleSpecialization {
+	uint32_t             m_Kernel;
+	uint32_t             m_Capacity;
+	float                m_LifetimeMin;
+	float                m_LifetimeMax;
+	float                m_Gravity;
+	float                m_Drag;
+} ParticleSpecialization;
+
+static uint32_t NextPowerOfTwo(uint32_t value)
+{
+    uint32_t power = 1;
+    while (power < value) {
+        power <<= 1;
+    }
+    return power;
+}
+
+
+VulkanParticleSystem::VulkanParticleSystem() :
+	m_CreateInfo{},
+	m_SortCapacity(0),
+	m_AliveList(0),
+	m_EmitSeed(0),
+	m_EmitRemainder(0.0),
+	m_ResetPending(true),
+	m_ConstantsWritten(false),
+	m_ConstantsOffset(0),
+	m_ConstantsGeneration(0),
+	m_DescriptorSetLayout(VK_NULL_HANDLE),
+	m_DescriptorPool(VK_NULL_HANDLE),
+	m_DescriptorSet(VK_NULL_HANDLE),
+	m_PipelineLayout(VK_NULL_HANDLE),
+	m_SortPipelineLayout(VK_NULL_HANDLE),
+	m_Pipelines{},
+	m_DrawPipeline(VK_NULL_HANDLE),
+	m_QueryPool(VK_NULL_HANDLE),
+	m_TimestampPeriod(1.0),
+	m_TimestampMask(UINT64_MAX),
+	m_LastTiming({ 0.0 })
+{
+}
+
+VulkanParticleSystem::~VulkanParticleSystem()
+{
+}
+
+bool VulkanParticleSystem::Create(const VulkanParticleSystemCreateInfo& createInfo)
+{
+    if (nullptr == createInfo.m_FrameRing) {
+        std::cout << "Vulkan particle system needs a frame ring.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    m_CreateInfo = createInfo;
+    m_CreateInfo.m_FramesInFlight = std::max(m_CreateInfo.m_FramesInFlight, 1u);
+    m_CreateInfo.m_Capacity = std::max(1u, std::min(m_CreateInfo.m_Capacity, PARTICLE_MAX_CAPACITY));
+    m_CreateInfo.m_LifetimeMax = std::max(m_CreateInfo.m_LifetimeMax, m_CreateInfo.m_LifetimeMin);
+    m_SortCapacity = std::max(NextPowerOfTwo(m_CreateInfo.m_Capacity), PARTICLE_SORT_BLOCK);
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+
+    /****************************************************************************
+     * Pool, lists & counters only ever touched by the GPU
+     ****************************************************************************/
+    VkDeviceSize capacity = m_CreateInfo.m_Capacity;
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, sizeof(ParticleCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_CounterBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, capacity * 2 * sizeof(glm::vec4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_ParticleBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, capacity * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_DeadBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, capacity * 2 * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_AliveBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, (VkDeviceSize)m_SortCapacity * sizeof(glm::uvec2), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_SortBuffer));
+
+    VkDescriptorSetLayoutBinding bindings[ParticleBinding_Count]{};
+    for (uint32_t i = 0; i < ParticleBinding_Count; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = (ParticleBinding_Constants == i) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = ParticleBinding_Count;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_DescriptorSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create particle descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = ParticleBinding_Constants;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[1].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(device, &poolInfo, GetVulkanAllocator(), &m_DescriptorPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create particle descriptor pool.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_DescriptorSetLayout;
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_DescriptorSet) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate particle descriptor set.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    // The constants are written with the frame ring's buffer at the first simulation.
+    const VulkanBuffer* buffers[ParticleBinding_Constants] = { &m_CounterBuffer, &m_ParticleBuffer, &m_DeadBuffer, &m_AliveBuffer, &m_SortBuffer };
+    VkDescriptorBufferInfo bufferInfos[ParticleBinding_Constants]{};
+    VkWriteDescriptorSet writes[ParticleBinding_Constants]{};
+    for (uint32_t i = 0; i < ParticleBinding_Constants; i++) {
+        bufferInfos[i] = { buffers[i]->m_Buffer, 0, VK_WHOLE_SIZE };
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_DescriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(device, ParticleBinding_Constants, writes, 0, nullptr);
+
+    /****************************************************************************
+     * The simulation & the draw share their layout & the constants in the frame
+     * ring, the sort only pushes its stage
+     ****************************************************************************/
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_PipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create particle pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(SortConstants);
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_SortPipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create particle sort pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    VULKAN_DRIVER_CHECK_FUN(CreatePipelines());
+
+    /****************************************************************************
+     * Timestamps around the simulation, two per frame in flight
+     ****************************************************************************/
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    uint32_t validBits = (m_CreateInfo.m_QueueFamilyIndex < queueFamilyCount) ? queueFamilies[m_CreateInfo.m_QueueFamilyIndex].timestampValidBits : 0;
+
+    if (0 != validBits && deviceProperties.limits.timestampPeriod > 0.0f) {
+        m_TimestampPeriod = deviceProperties.limits.timestampPeriod;
+        m_TimestampMask = (validBits >= 64) ? UINT64_MAX : ((1ull << validBits) - 1);
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = m_CreateInfo.m_FramesInFlight * 2;
+        if (vkCreateQueryPool(device, &queryPoolInfo, GetVulkanAllocator(), &m_QueryPool) != VK_SUCCESS) {
+            m_QueryPool = VK_NULL_HANDLE;
+        }
+    }
+    m_QueryWritten.assign(m_CreateInfo.m_FramesInFlight, false);
+
+    Reset();
+    std::cout << "Vulkan particle system created, " << m_CreateInfo.m_Capacity << " particles, " << (GetMemoryBytes() >> 20) << " MB, "
+        << (m_CreateInfo.m_Sort ? "sorted" : "unsorted") << ".\n";
+    return true;
+}
+
+bool VulkanParticleSystem::CreatePipelines()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    VkShaderModule simulateModule = LoadShaderModule(device, "Data/Engine/particle_simulate.cs.spv");
+    VkShaderModule sortModule = LoadShaderModule(device, "Data/Engine/particle_sort.cs.spv");
+
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+    if (VK_NULL_HANDLE != simulateModule && VK_NULL_HANDLE != sortModule) {
+        // One pipeline per kernel, the branches on the kernel constant fold away.
+        ParticleSpecialization specializations[ParticlePipeline_SortLocal];
+        uint32_t sortKernels[ParticlePipeline_Count - ParticlePipeline_SortLocal];
+        VkSpecializationMapEntry simulateEntries[6];
+        for (uint32_t i = 0; i < 6; i++) {
+            simulateEntries[i] = { i, i * (uint32_t)sizeof(uint32_t), sizeof(uint32_t) };
+        }
+        VkSpecializationMapEntry sortEntry = { 0, 0, sizeof(uint32_t) };
+
+        VkSpecializationInfo specializationInfos[ParticlePipeline_Count]{};
+        VkComputePipelineCreateInfo pipelineInfos[ParticlePipeline_Count]{};
+        for (uint32_t i = 0; i < ParticlePipeline_Count; i++) {
+            bool sort = i >= ParticlePipeline_SortLocal;
+            if (sort) {
+                sortKernels[i - ParticlePipeline_SortLocal] = i - ParticlePipeline_SortLocal;
+                specializationInfos[i].mapEntryCount = 1;
+                specializationInfos[i].pMapEntries = &sortEntry;
+                specializationInfos[i].dataSize = sizeof(uint32_t);
+                specializationInfos[i].pData = &sortKernels[i - ParticlePipeline_SortLocal];
+            } else {
+                specializations[i] = { i, m_CreateInfo.m_Capacity, m_CreateInfo.m_LifetimeMin, m_CreateInfo.m_LifetimeMax,
+                    m_CreateInfo.m_Gravity, m_CreateInfo.m_Drag };
+                specializationInfos[i].mapEntryCount = 6;
+                specializationInfos[i].pMapEntries = simulateEntries;
+                specializationInfos[i].dataSize = sizeof(ParticleSpecialization);
+                specializationInfos[i].pData = &specializations[i];
+            }
+
+            pipelineInfos[i].sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+            pipelineInfos[i].stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            pipelineInfos[i].stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+            pipelineInfos[i].stage.module = sort ? sortModule : simulateModule;
+            pipelineInfos[i].stage.pName = "main";
+            pipelineInfos[i].stage.pSpecializationInfo = &specializationInfos[i];
+            pipelineInfos[i].layout = sort ? m_SortPipelineLayout : m_PipelineLayout;
+        }
+        result = vkCreateComputePipelines(device, m_CreateInfo.m_PipelineCache, ParticlePipeline_Count, pipelineInfos, GetVulkanAllocator(), m_Pipelines);
+    }
+
+    VkShaderModule shaderModules[2] = { simulateModule, sortModule };
+    for (VkShaderModule shaderModule : shaderModules) {
+        if (VK_NULL_HANDLE != shaderModule) {
+            vkDestroyShaderModule(device, shaderModule, GetVulkanAllocator());
+        }
+    }
+
+    if (VK_SUCCESS != result) {
+        std::cout << "Vulkan failed to create particle pipelines.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanParticleSystem::CreateDrawPipeline(const VulkanSceneAttachments& sceneAttachments, VkRenderPass sceneRenderPass)
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE != m_DrawPipeline) {
+        vkDestroyPipeline(device, m_DrawPipeline, GetVulkanAllocator());
+        m_DrawPipeline = VK_NULL_HANDLE;
+    }
+
+    VkShaderModule vertShaderModule = LoadShaderModule(device, "Data/Engine/particle.vs.spv");
+    VkShaderModule fragShaderModule = LoadShaderModule(device, "Data/Engine/particle.fs.spv");
+
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+    if (VK_NULL_HANDLE != vertShaderModule && VK_NULL_HANDLE != fragShaderModule) {
+        VkSpecializationMapEntry specializationEntry = { 0, 0, sizeof(float) };
+        VkSpecializationInfo specializationInfo{};
+        specializationInfo.mapEntryCount = 1;
+        specializationInfo.pMapEntries = &specializationEntry;
+        specializationInfo.dataSize = sizeof(float);
+        specializationInfo.pData = &m_CreateInfo.m_Size;
+
+        VkPipelineShaderStageCreateInfo shaderStages[2]{};
+        shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shaderStages[0].module = vertShaderModule;
+        shaderStages[0].pName = "main";
+        shaderStages[0].pSpecializationInfo = &specializationInfo;
+        shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStages[1].module = fragShaderModule;
+        shaderStages[1].pName = "main";
+
+        // Quads are expanded from the particle buffer, nothing comes from vertex buffers.
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        VkPipelineViewportStateCreateInfo viewportState{};
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount = 1;
+
+        VkPipelineRasterizationStateCreateInfo rasterizer{};
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.lineWidth = 1.0f;
+        rasterizer.cullMode = VK_CULL_MODE_NONE;
+        rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+        // Tested against the opaque scene, never written so particles don't hide each other.
+        VkPipelineMultisampleStateCreateInfo multisampling{};
+        VkPipelineDepthStencilStateCreateInfo depthStencil{};
+        sceneAttachments.GetPipelineState(multisampling, depthStencil);
+        depthStencil.depthWriteEnable = VK_FALSE;
+
+        // Sorted particles blend over each other back to front, unsorted ones only add up, which any order gets right.
+        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachment.blendEnable = VK_TRUE;
+        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        colorBlendAttachment.dstColorBlendFactor = m_CreateInfo.m_Sort ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+        colorBlendAttachment.srcAlphaBlendFactor = m_CreateInfo.m_Sort ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ZERO;
+        colorBlendAttachment.dstAlphaBlendFactor = m_CreateInfo.m_Sort ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE;
+        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+
+        VkPipelineColorBlendStateCreateInfo colorBlending{};
+        colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlending.attachmentCount = 1;
+        colorBlending.pAttachments = &colorBlendAttachment;
+
+        VkDynamicState dynamicStates[] = {
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+        };
+
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = 2;
+        dynamicState.pDynamicStates = dynamicStates;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = 2;
+        pipelineInfo.pStages = shaderStages;
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterizer;
+        pipelineInfo.pMultisampleState = &multisampling;
+        pipelineInfo.pDepthStencilState = &depthStencil;
+        pipelineInfo.pColorBlendState = &colorBlending;
+        pipelineInfo.pDynamicState = &dynamicState;
+        pipelineInfo.layout = m_PipelineLayout;
+        sceneAttachments.SetPipelineTarget(pipelineInfo, sceneRenderPass);
+        pipelineInfo.basePipelineIndex = -1;
+
+        result = vkCreateGraphicsPipelines(device, m_CreateInfo.m_PipelineCache, 1, &pipelineInfo, GetVulkanAllocator(), &m_DrawPipeline);
+    }
+
+    VkShaderModule shaderModules[2] = { vertShaderModule, fragShaderModule };
+    for (VkShaderModule shaderModule : shaderModules) {
+        if (VK_NULL_HANDLE != shaderModule) {
+            vkDestroyShaderModule(device, shaderModule, GetVulkanAllocator());
+        }
+    }
+
+    if (VK_SUCCESS != result) {
+        m_DrawPipeline = VK_NULL_HANDLE;
+        std::cout << "Vulkan failed to create particle draw pipeline.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+VkDeviceSize VulkanParticleSystem::GetMemoryBytes() const
+{
+    return m_CounterBuffer.m_Size + m_ParticleBuffer.m_Size + m_DeadBuffer.m_Size + m_AliveBuffer.m_Size + m_SortBuffer.m_Size;
+}
+
+void VulkanParticleSystem::Reset()
+{
+    m_ResetPending = true;
+    m_AliveList = 0;
+    m_EmitSeed = 0;
+    m_EmitRemainder = 0.0;
+}
+
+void VulkanParticleSystem::WriteConstantsDescriptor()
+{
+    // Only when the ring was created again, between frames.
+    if (m_CreateInfo.m_FrameRing->GetGeneration() == m_ConstantsGeneration) {
+        return;
+    }
+    VkDescriptorBufferInfo bufferInfo = { m_CreateInfo.m_FrameRing->GetBuffer(), 0, sizeof(ParticleConstants) };
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = m_DescriptorSet;
+    write.dstBinding = ParticleBinding_Constants;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    write.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(m_CreateInfo.m_Device, 1, &write, 0, nullptr);
+    m_ConstantsGeneration = m_CreateInfo.m_FrameRing->GetGeneration();
+}
+
+void VulkanParticleSystem::CmdComputeBarrier(VkCommandBuffer commandBuffer, bool indirect)
+{
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | (indirect ? VK_ACCESS_INDIRECT_COMMAND_READ_BIT : 0);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | (indirect ? VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT : 0), 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void VulkanParticleSystem::RecordSimulate(VkCommandBuffer commandBuffer, uint32_t frameIndex, const ParticleFrameParams& params)
+{
+    PROFILE_FUNCTION();
+    if (VK_NULL_HANDLE == m_Pipelines[ParticlePipeline_Simulate]) {
+        return;
+    }
+
+    // Read by this frame's dispatches & its draw, the ring keeps them until the frame slot comes around again.
+    FrameRingAllocation allocation;
+    m_ConstantsWritten = m_CreateInfo.m_FrameRing->AllocateUniform(sizeof(ParticleConstants), allocation);
+    if (!m_ConstantsWritten) {
+        return;
+    }
+
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdResetQueryPool(commandBuffer, m_QueryPool, frameIndex * 2, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, frameIndex * 2);
+    }
+
+    // Whole particles only, the fraction is emitted by a later frame so low rates at high frame rates still emit.
+    float deltaTime = std::max(params.m_DeltaTime, 0.0f);
+    double emit = std::max((double)params.m_EmitRate, 0.0) * deltaTime + m_EmitRemainder;
+    uint32_t emitCount = (uint32_t)std::min(floor(emit), (double)m_CreateInfo.m_Capacity);
+    m_EmitRemainder = std::min(emit - floor(emit), 1.0);
+
+    ParticleConstants* constants = static_cast<ParticleConstants*>(allocation.m_Mapped);
+    constants->m_ViewProjection = params.m_ViewProjection;
+    constants->m_CameraPosition = glm::vec4(params.m_CameraPosition, deltaTime);
+    constants->m_Emitter = glm::vec4(params.m_EmitterPosition, params.m_EmitterRadius);
+    constants->m_EmitterVelocity = glm::vec4(params.m_EmitterVelocity, params.m_VelocitySpread);
+    constants->m_Frame = glm::uvec4(emitCount, m_EmitSeed * 0x9e3779b9u, m_AliveList, 0);
+    m_ConstantsOffset = (uint32_t)allocation.m_Offset;
+    WriteConstantsDescriptor();
+
+    // The previous frame's draw reads what this one rewrites.
+    VkMemoryBarrier drawBarrier{};
+    drawBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    drawBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    drawBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &drawBarrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_DescriptorSet, 1, &m_ConstantsOffset);
+
+    if (m_ResetPending) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipelines[ParticlePipeline_Reset]);
+        vkCmdDispatch(commandBuffer, (m_CreateInfo.m_Capacity + PARTICLE_GROUP_SIZE - 1) / PARTICLE_GROUP_SIZE, 1, 1);
+        CmdComputeBarrier(commandBuffer, false);
+        m_ResetPending = false;
+    }
+
+    // Each step sizes the next ones from counters the host never reads back.
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipelines[ParticlePipeline_Begin]);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+    CmdComputeBarrier(commandBuffer, true);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipelines[ParticlePipeline_Emit]);
+    vkCmdDispatchIndirect(commandBuffer, m_CounterBuffer.m_Buffer, offsetof(ParticleCounters, m_EmitDispatch));
+    CmdComputeBarrier(commandBuffer, false);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipelines[ParticlePipeline_Simulate]);
+    vkCmdDispatchIndirect(commandBuffer, m_CounterBuffer.m_Buffer, offsetof(ParticleCounters, m_SimulateDispatch));
+    CmdComputeBarrier(commandBuffer, false);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipelines[ParticlePipeline_Finish]);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+    if (m_CreateInfo.m_Sort) {
+        CmdComputeBarrier(commandBuffer, true);
+        // Stages above a block are recorded for the capacity, the ones past the alive count find nothing to swap.
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_SortPipelineLayout, 0, 1, &m_DescriptorSet, 1, &m_ConstantsOffset);
+        SortConstants localConstants = { PARTICLE_SORT_BLOCK, PARTICLE_SORT_BLOCK / 2 };
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipelines[ParticlePipeline_SortLocal]);
+        vkCmdPushConstants(commandBuffer, m_SortPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SortConstants), &localConstants);
+        vkCmdDispatchIndirect(commandBuffer, m_CounterBuffer.m_Buffer, offsetof(ParticleCounters, m_SortDispatch));
+        for (uint32_t stage = PARTICLE_SORT_BLOCK * 2; stage <= m_SortCapacity; stage <<= 1) {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipelines[ParticlePipeline_SortGlobalStep]);
+            for (uint32_t step = stage / 2; step >= PARTICLE_SORT_BLOCK; step >>= 1) {
+                SortConstants sortConstants = { stage, step };
+                CmdComputeBarrier(commandBuffer, false);
+                vkCmdPushConstants(commandBuffer, m_SortPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SortConstants), &sortConstants);
+                vkCmdDispatchIndirect(commandBuffer, m_CounterBuffer.m_Buffer, offsetof(ParticleCounters, m_SortDispatch));
+            }
+            SortConstants sortConstants = { stage, PARTICLE_SORT_BLOCK / 2 };
+            CmdComputeBarrier(commandBuffer, false);
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipelines[ParticlePipeline_SortLocalMerge]);
+            vkCmdPushConstants(commandBuffer, m_SortPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SortConstants), &sortConstants);
+            vkCmdDispatchIndirect(commandBuffer, m_CounterBuffer.m_Buffer, offsetof(ParticleCounters, m_SortDispatch));
+        }
+    }
+
+    VkMemoryBarrier simulateBarrier{};
+    simulateBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    simulateBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    simulateBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+        0, 1, &simulateBarrier, 0, nullptr, 0, nullptr);
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, frameIndex * 2 + 1);
+        m_QueryWritten[frameIndex] = true;
+    }
+
+    m_AliveList = 1 - m_AliveList;
+    m_EmitSeed++;
+}
+
+void VulkanParticleSystem::RecordDraw(VkCommandBuffer commandBuffer)
+{
+    if (VK_NULL_HANDLE == m_DrawPipeline || !m_ConstantsWritten) {
+        return;
+    }
+
+    // The vertex shader only reads the camera of the simulation's constants.
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_DrawPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSet, 1, &m_ConstantsOffset);
+    vkCmdDrawIndirect(commandBuffer, m_CounterBuffer.m_Buffer, offsetof(ParticleCounters, m_Draw), 1, sizeof(VkDrawIndirectCommand));
+}
+
+uint64_t VulkanParticleSystem::GetDrawHash() const
+{
+    uint64_t hash = HashCommandValue(COMMAND_HASH_SEED, m_DrawPipeline);
+    hash = HashCommandValue(hash, m_DescriptorSet);
+    hash = HashCommandValue(hash, m_ConstantsWritten);
+    hash = HashCommandValue(hash, m_ConstantsGeneration);
+    return HashCommandValue(hash, m_ConstantsOffset);
+}
+
+void VulkanParticleSystem::CollectGpuTiming(uint32_t frameIndex)
+{
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    if (VK_NULL_HANDLE == m_QueryPool || !m_QueryWritten[frameIndex]) {
+        return;
+    }
+
+    uint64_t timestamps[2] = { 0, 0 };
+    if (VK_SUCCESS != vkGetQueryPoolResults(m_CreateInfo.m_Device, m_QueryPool, frameIndex * 2, 2, sizeof(timestamps), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT)) {
+        return;
+    }
+    m_QueryWritten[frameIndex] = false;
+    m_LastTiming.m_GpuMs = ((timestamps[1] - timestamps[0]) & m_TimestampMask) * m_TimestampPeriod / 1000000.0;
+    PROFILE_COUNTER("ParticleGpuMs", m_LastTiming.m_GpuMs);
+}
+
+void VulkanParticleSystem::Destroy()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE == device) {
+        return;
+    }
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkDestroyQueryPool(device, m_QueryPool, GetVulkanAllocator());
+        m_QueryPool = VK_NULL_HANDLE;
+    }
+    m_QueryWritten.clear();
+    if (VK_NULL_HANDLE != m_DrawPipeline) {
+        vkDestroyPipeline(device, m_DrawPipeline, GetVulkanAllocator());
+        m_DrawPipeline = VK_NULL_HANDLE;
+    }
+    for (VkPipeline& pipeline : m_Pipelines) {
+        if (VK_NULL_HANDLE != pipeline) {
+            vkDestroyPipeline(device, pipeline, GetVulkanAllocator());
+            pipeline = VK_NULL_HANDLE;
+        }
+    }
+    VkPipelineLayout* layouts[2] = { &m_PipelineLayout, &m_SortPipelineLayout };
+    for (VkPipelineLayout* layout : layouts) {
+        if (VK_NULL_HANDLE != *layout) {
+            vkDestroyPipelineLayout(device, *layout, GetVulkanAllocator());
+            *layout = VK_NULL_HANDLE;
+        }
+    }
+    if (VK_NULL_HANDLE != m_DescriptorPool) {
+        vkDestroyDescriptorPool(device, m_DescriptorPool, GetVulkanAllocator());
+        m_DescriptorPool = VK_NULL_HANDLE;
+        m_DescriptorSet = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorSetLayout) {
+        vkDestroyDescriptorSetLayout(device, m_DescriptorSetLayout, GetVulkanAllocator());
+        m_DescriptorSetLayout = VK_NULL_HANDLE;
+    }
+    DestroyBuffer(device, m_SortBuffer);
+    DestroyBuffer(device, m_AliveBuffer);
+    DestroyBuffer(device, m_DeadBuffer);
+    DestroyBuffer(device, m_ParticleBuffer);
+    DestroyBuffer(device, m_CounterBuffer);
+    m_CreateInfo.m_Device = VK_NULL_HANDLE;
+}
+
+__END_NAMESPACE
@@ -0,0 +1,135 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+class VulkanSceneAttachments;
+class VulkanFrameRing;
+
+
+typedef struct VulkanParticleSystemCreateInfo {
+	VkDevice             m_Device;
+	VkPhysicalDevice     m_PhysicalDevice;
+	VkPipelineCache      m_PipelineCache;
+	uint32_t             m_QueueFamilyIndex;          // Of the queue the simulation is recorded for, for timestamps
+	VulkanFrameRing*     m_FrameRing = nullptr;       // Each frame's constants, outlives the system
+	uint32_t             m_FramesInFlight = 1;        // Timestamp slots, the particles themselves are shared in submission order
+	uint32_t             m_Capacity = 1 << 20;
+	bool                 m_Sort = true;               // Back to front & alpha blended, false draws additively in any order
+	float                m_LifetimeMin = 1.0f;        // Seconds
+	float                m_LifetimeMax = 4.0f;
+	float                m_Gravity = -9.81f;          // Along y, particles bounce off the y = 0 plane
+	float                m_Drag = 0.1f;               // Velocity lost per second
+	float                m_Size = 0.05f;              // World size at emission
+} VulkanParticleSystemCreateInfo;
+
+// Emitter & camera of one frame.
+typedef struct ParticleFrameParams {
+	glm::mat4            m_ViewProjection;
+	glm::vec3            m_CameraPosition;
+	float                m_DeltaTime;                 // Seconds simulated by this frame
+	glm::vec3            m_EmitterPosition;
+	float                m_EmitterRadius;
+	glm::vec3            m_EmitterVelocity;
+	float                m_VelocitySpread;            // Random velocity of at most this length added to each particle
+	float                m_EmitRate;                  // Particles per second, while dead ones are left
+} ParticleFrameParams;
+
+typedef struct ParticleSystemTiming {
+	double               m_GpuMs;                     // Emission to sort, 0 without timestamp support
+} ParticleSystemTiming;
+
+
+/**
+ * GPU particles: emission, simulation, compaction & sorting all run in compute & the draw is indirect, so
+ * the host records the same commands whatever the particle count & never touches a particle.
+ *
+ * Particles live in a fixed pool. Emission pops indices off a dead list, the simulation pushes the expired
+ * ones back & appends the survivors to the other of two alive lists, which compacts them for the next frame.
+ * Single invocation passes turn the counters into the indirect arguments of the next dispatches & of the draw.
+ * Sorted systems then bitonic sort the survivors back to front, in shared memory up to 512 entries & with a
+ * dispatch per larger step above, over their count padded to a power of two.
+ */
+class VulkanParticleSystem
+{
+public:
+	VulkanParticleSystem();
+	virtual ~VulkanParticleSystem();
+
+	bool Create(const VulkanParticleSystemCreateInfo& createInfo);
+	// For the driver's scene passes, with render pass objects or dynamic rendering. Depth tested, not written.
+	bool CreateDrawPipeline(const VulkanSceneAttachments& sceneAttachments, VkRenderPass sceneRenderPass);
+	void Destroy();
+
+	// Every particle is dead again at the next RecordSimulate(), which restarts the emission sequence.
+	void Reset();
+	// Record outside of a render pass, before the draw of the same frame & after the frame ring's BeginFrame() for it.
+	// Advances the simulation by params.m_DeltaTime.
+	void RecordSimulate(VkCommandBuffer commandBuffer, uint32_t frameIndex, const ParticleFrameParams& params);
+	// Record inside the pass the draw pipeline was created for, viewport & scissor are dynamic. Reads the constants
+	// RecordSimulate() wrote into the frame ring, in the same frame.
+	void RecordDraw(VkCommandBuffer commandBuffer);
+	// Changes whenever RecordDraw() would record different commands, the particle count & camera come from buffers.
+	uint64_t GetDrawHash() const;
+	// Once the frame slot's fence signaled, reads back the GPU time of its simulation.
+	void CollectGpuTiming(uint32_t frameIndex);
+	const ParticleSystemTiming& GetLastTiming() const { return m_LastTiming; }
+
+	uint32_t GetCapacity() const { return m_CreateInfo.m_Capacity; }
+	// Bytes of the pool, lists, sort entries & counters.
+	VkDeviceSize GetMemoryBytes() const;
+
+private:
+	enum ParticlePipeline : uint32_t
+	{
+		ParticlePipeline_Reset = 0,
+		ParticlePipeline_Begin,
+		ParticlePipeline_Emit,
+		ParticlePipeline_Simulate,
+		ParticlePipeline_Finish,
+		ParticlePipeline_SortLocal,
+		ParticlePipeline_SortGlobalStep,
+		ParticlePipeline_SortLocalMerge,
+		ParticlePipeline_Count,
+	};
+
+	VulkanParticleSystemCreateInfo     m_CreateInfo;
+	uint32_t                           m_SortCapacity;       // Capacity padded to a power of two, at least a sort block
+	uint32_t                           m_AliveList;          // Read by the next frame
+	uint32_t                           m_EmitSeed;
+	double                             m_EmitRemainder;      // Fraction of a particle carried to the next frame
+	bool                               m_ResetPending;
+	bool                               m_ConstantsWritten;   // This frame's, the draw is skipped without them
+	uint32_t                           m_ConstantsOffset;    // Dynamic offset of the last simulated frame's constants
+	uint32_t                           m_ConstantsGeneration; // Of the ring buffer the descriptor set was written with
+
+	VulkanBuffer                       m_CounterBuffer;
+	VulkanBuffer                       m_ParticleBuffer;
+	VulkanBuffer                       m_DeadBuffer;
+	VulkanBuffer                       m_AliveBuffer;
+	VulkanBuffer                       m_SortBuffer;
+
+	VkDescriptorSetLayout              m_DescriptorSetLayout;
+	VkDescriptorPool                   m_DescriptorPool;
+	VkDescriptorSet                    m_DescriptorSet;
+	VkPipelineLayout                   m_PipelineLayout;
+	VkPipelineLayout                   m_SortPipelineLayout;
+	VkPipeline                         m_Pipelines[ParticlePipeline_Count];
+	VkPipeline                         m_DrawPipeline;      // Shares the simulation's layout & constants
+
+	VkQueryPool                        m_QueryPool;
+	double                             m_TimestampPeriod;    // Nanoseconds per tick
+	uint64_t                           m_TimestampMask;
+	std::vector<bool>                  m_QueryWritten;
+	ParticleSystemTiming               m_LastTiming;
+
+	bool CreatePipelines();
+	// With the frame ring's current buffer.
+	void WriteConstantsDescriptor();
+	// Makes the previous dispatch's writes visible to the next one, & to its indirect arguments when those were written.
+	void CmdComputeBarrier(VkCommandBuffer commandBuffer, bool indirect);
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,523 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanPostProcess.h"
+
+
+__BEGIN_NAMESPACE
+
+static const VkFormat POST_INTERMEDIATE_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+static const uint32_t POST_GROUP_SIZE = 8;
+static const uint32_t POST_MAX_BLOOM_MIPS = 8;
+
+enum PostBinding
+{
+    PostBinding_Source = 0,
+    PostBinding_Secondary,
+    PostBinding_Destination,
+    PostBinding_Count,
+};
+
+// Same layout as the PostProcessConstants push constants of post_process.shader.comp.
+typedef struct PostProcessConstants {
+	PostProcessParams    m_Params;
+	glm::vec4            m_TexelSize;     // xy: of the destination, zw: of the source
+} PostProcessConstants;
+
+// Bit of a per pixel effect in PostDispatch::m_FusedEffects, 0 for the others. The shader applies them in bit order.
+static uint32_t GetFusedEffectBit(PostProcessEffect effect)
+{
+    switch (effect) {
+    case PostProcessEffect::Bloom:
+        return 1u << 0;
+    case PostProcessEffect::Tonemap:
+        return 1u << 1;
+    case PostProcessEffect::ColorGrading:
+        return 1u << 2;
+    case PostProcessEffect::Vignette:
+        return 1u << 3;
+    default:
+        return 0;
+    }
+}
+
+
+VulkanPostProcess::VulkanPostProcess() :
+	m_CreateInfo{},
+	m_Extent({ 0, 0 }),
+	m_IntermediateBytes(0),
+	m_UnsharedIntermediateBytes(0),
+	m_Sampler(VK_NULL_HANDLE),
+	m_DescriptorSetLayout(VK_NULL_HANDLE),
+	m_DescriptorPool(VK_NULL_HANDLE),
+	m_PipelineLayout(VK_NULL_HANDLE),
+	m_QueryPool(VK_NULL_HANDLE),
+	m_TimestampPeriod(1.0),
+	m_TimestampMask(UINT64_MAX),
+	m_QueryWritten(false),
+	m_LastTiming({ 0.0, 0 })
+{
+}
+
+VulkanPostProcess::~VulkanPostProcess()
+{
+}
+
+bool VulkanPostProcess::Create(const VulkanPostProcessCreateInfo& createInfo)
+{
+    m_CreateInfo = createInfo;
+    m_CreateInfo.m_BloomMips = std::min(std::max(m_CreateInfo.m_BloomMips, 1u), POST_MAX_BLOOM_MIPS);
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+
+    BuildDispatches();
+    AssignImages();
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+    if (vkCreateSampler(device, &samplerInfo, GetVulkanAllocator(), &m_Sampler) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create post process sampler.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    /****************************************************************************
+     * One descriptor set per dispatch, written once the targets exist
+     ****************************************************************************/
+    VkDescriptorSetLayoutBinding bindings[PostBinding_Count]{};
+    for (uint32_t i = 0; i < PostBinding_Count; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = (PostBinding_Destination == i) ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = PostBinding_Count;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_DescriptorSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create post process descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    uint32_t dispatchCount = (uint32_t)m_Dispatches.size();
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = 2 * dispatchCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = dispatchCount;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = dispatchCount;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(device, &poolInfo, GetVulkanAllocator(), &m_DescriptorPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create post process descriptor pool.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    std::vector<VkDescriptorSetLayout> setLayouts(dispatchCount, m_DescriptorSetLayout);
+    std::vector<VkDescriptorSet> descriptorSets(dispatchCount);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = dispatchCount;
+    allocInfo.pSetLayouts = setLayouts.data();
+    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate post process descriptor sets.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    for (uint32_t i = 0; i < dispatchCount; i++) {
+        m_Dispatches[i].m_DescriptorSet = descriptorSets[i];
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(PostProcessConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_PipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create post process pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    VULKAN_DRIVER_CHECK_FUN(CreatePipelines());
+
+    /****************************************************************************
+     * Timestamps around the chain
+     ****************************************************************************/
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    uint32_t validBits = (m_CreateInfo.m_QueueFamilyIndex < queueFamilyCount) ? queueFamilies[m_CreateInfo.m_QueueFamilyIndex].timestampValidBits : 0;
+
+    if (0 != validBits && deviceProperties.limits.timestampPeriod > 0.0f) {
+        m_TimestampPeriod = deviceProperties.limits.timestampPeriod;
+        m_TimestampMask = (validBits >= 64) ? UINT64_MAX : ((1ull << validBits) - 1);
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = 2;
+        if (vkCreateQueryPool(device, &queryPoolInfo, GetVulkanAllocator(), &m_QueryPool) != VK_SUCCESS) {
+            m_QueryPool = VK_NULL_HANDLE;
+        }
+    }
+
+    std::cout << "Vulkan post process created, " << m_CreateInfo.m_EffectCount << " effects in " << dispatchCount << " dispatches, "
+        << m_Intermediates.size() << " intermediates in " << m_ImageMips.size() << " images.\n";
+    return true;
+}
+
+void VulkanPostProcess::BuildDispatches()
+{
+    m_Dispatches.clear();
+    m_Intermediates.clear();
+
+    // The dispatch per pixel effects are still being fused into, it only gets a destination once it's closed.
+    PostDispatch open = { PostKernel::Load, 0, -1, -1, -1, 0, VK_NULL_HANDLE };
+    auto isBare = [&]() {
+        return PostKernel::Load == open.m_Kernel && 0 == open.m_FusedEffects;
+    };
+    auto addIntermediate = [&](uint32_t mip) {
+        m_Intermediates.push_back({ mip, 0 });
+        return (int32_t)m_Intermediates.size() - 1;
+    };
+    auto close = [&](PostKernel nextKernel) {
+        open.m_Destination = addIntermediate(0);
+        m_Dispatches.push_back(open);
+        open = { nextKernel, 0, open.m_Destination, -1, -1, 0, VK_NULL_HANDLE };
+    };
+
+    for (uint32_t i = 0; i < m_CreateInfo.m_EffectCount; i++) {
+        PostProcessEffect effect = m_CreateInfo.m_Effects[i];
+        if (PostProcessEffect::Fxaa == effect) {
+            if (isBare()) {
+                open.m_Kernel = PostKernel::Fxaa;
+            } else {
+                close(PostKernel::Fxaa);
+            }
+            continue;
+        }
+
+        if (PostProcessEffect::Bloom == effect) {
+            // The chain reads what came before as a whole image.
+            if (!isBare()) {
+                close(PostKernel::Load);
+            }
+            int32_t down[POST_MAX_BLOOM_MIPS + 1];
+            down[0] = open.m_Source;
+            for (uint32_t mip = 1; mip <= m_CreateInfo.m_BloomMips; mip++) {
+                down[mip] = addIntermediate(mip);
+                m_Dispatches.push_back({ (1 == mip) ? PostKernel::BloomPrefilter : PostKernel::BloomDownsample, 0, down[mip - 1], -1, down[mip], 0, VK_NULL_HANDLE });
+            }
+            int32_t up = down[m_CreateInfo.m_BloomMips];
+            for (uint32_t mip = m_CreateInfo.m_BloomMips - 1; mip >= 1; mip--) {
+                int32_t destination = addIntermediate(mip);
+                m_Dispatches.push_back({ PostKernel::BloomUpsample, 0, up, down[mip], destination, 0, VK_NULL_HANDLE });
+                up = destination;
+            }
+            open.m_Secondary = up;
+        }
+
+        // Fused only after the effects the shader applies before it, unfused the effect gets a dispatch of its own.
+        uint32_t bit = GetFusedEffectBit(effect);
+        bool fusable = m_CreateInfo.m_Fuse ? (open.m_FusedEffects < bit) : isBare();
+        if (!fusable) {
+            close(PostKernel::Load);
+        }
+        open.m_FusedEffects |= bit;
+    }
+
+    open.m_Destination = -1;
+    m_Dispatches.push_back(open);
+}
+
+void VulkanPostProcess::AssignImages()
+{
+    std::vector<int32_t> lastRead(m_Intermediates.size(), -1);
+    for (size_t i = 0; i < m_Dispatches.size(); i++) {
+        if (m_Dispatches[i].m_Source >= 0) {
+            lastRead[m_Dispatches[i].m_Source] = (int32_t)i;
+        }
+        if (m_Dispatches[i].m_Secondary >= 0) {
+            lastRead[m_Dispatches[i].m_Secondary] = (int32_t)i;
+        }
+    }
+
+    // An image is free for a dispatch once the last reader of what it holds came before it.
+    std::vector<int32_t> busyUntil;
+    m_ImageMips.clear();
+    for (size_t i = 0; i < m_Dispatches.size(); i++) {
+        int32_t destination = m_Dispatches[i].m_Destination;
+        if (destination < 0) {
+            continue;
+        }
+        PostIntermediate& intermediate = m_Intermediates[destination];
+        uint32_t image = (uint32_t)m_ImageMips.size();
+        for (uint32_t j = 0; j < (uint32_t)m_ImageMips.size(); j++) {
+            if (m_ImageMips[j] == intermediate.m_Mip && busyUntil[j] < (int32_t)i) {
+                image = j;
+                break;
+            }
+        }
+        if (image == (uint32_t)m_ImageMips.size()) {
+            m_ImageMips.push_back(intermediate.m_Mip);
+            busyUntil.push_back(0);
+        }
+        intermediate.m_Image = image;
+        busyUntil[image] = std::max(lastRead[destination], (int32_t)i);
+    }
+}
+
+bool VulkanPostProcess::CreatePipelines()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+
+    // The last dispatch writes the 8 bit output, the others the intermediates.
+    VkShaderModule shaderModules[2] = {
+        LoadShaderModule(device, "Data/Engine/post_process.cs.spv"),
+        LoadShaderModule(device, "Data/Engine/post_process_final.cs.spv"),
+    };
+    bool succeeded = (VK_NULL_HANDLE != shaderModules[0] && VK_NULL_HANDLE != shaderModules[1]);
+
+    // Dispatches of the same kernel, effects & output share their pipeline.
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; succeeded && i < m_Dispatches.size(); i++) {
+        PostDispatch& dispatch = m_Dispatches[i];
+        uint32_t finalOutput = (dispatch.m_Destination < 0) ? 1 : 0;
+        uint64_t key = ((uint64_t)dispatch.m_Kernel << 33) | ((uint64_t)dispatch.m_FusedEffects << 1) | finalOutput;
+        auto found = std::find(keys.begin(), keys.end(), key);
+        if (found != keys.end()) {
+            dispatch.m_Pipeline = (uint32_t)(found - keys.begin());
+            continue;
+        }
+
+        uint32_t specialization[2] = { (uint32_t)dispatch.m_Kernel, dispatch.m_FusedEffects };
+        VkSpecializationMapEntry specializationEntries[2] = {
+            { 0, 0, sizeof(uint32_t) },
+            { 1, sizeof(uint32_t), sizeof(uint32_t) },
+        };
+        VkSpecializationInfo specializationInfo{};
+        specializationInfo.mapEntryCount = 2;
+        specializationInfo.pMapEntries = specializationEntries;
+        specializationInfo.dataSize = sizeof(specialization);
+        specializationInfo.pData = specialization;
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = shaderModules[finalOutput];
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+        pipelineInfo.layout = m_PipelineLayout;
+
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        if (vkCreateComputePipelines(device, m_CreateInfo.m_PipelineCache, 1, &pipelineInfo, GetVulkanAllocator(), &pipeline) != VK_SUCCESS) {
+            std::cout << "Vulkan failed to create post process pipeline.\n";
+            succeeded = false;
+            break;
+        }
+        dispatch.m_Pipeline = (uint32_t)m_Pipelines.size();
+        m_Pipelines.push_back(pipeline);
+        keys.push_back(key);
+    }
+
+    for (VkShaderModule shaderModule : shaderModules) {
+        if (VK_NULL_HANDLE != shaderModule) {
+            vkDestroyShaderModule(device, shaderModule, GetVulkanAllocator());
+        }
+    }
+    if (!succeeded) {
+        SetErrorCode(ErrorCode::UnKnow);
+    }
+    return succeeded;
+}
+
+VkExtent2D VulkanPostProcess::GetMipExtent(uint32_t mip) const
+{
+    return { std::max(m_Extent.width >> mip, 1u), std::max(m_Extent.height >> mip, 1u) };
+}
+
+bool VulkanPostProcess::CreateTargets(VkExtent2D extent, VkImageView input, VkImageView output)
+{
+    DestroyTargets();
+    m_Extent = extent;
+    VkDevice device = m_CreateInfo.m_Device;
+
+    uint32_t texelSize = GetFormatSize(POST_INTERMEDIATE_FORMAT);
+    m_Images.resize(m_ImageMips.size());
+    for (size_t i = 0; i < m_Images.size(); i++) {
+        VkExtent2D mipExtent = GetMipExtent(m_ImageMips[i]);
+        VULKAN_DRIVER_CHECK_FUN(CreateImage2D(device, m_CreateInfo.m_PhysicalDevice, mipExtent, POST_INTERMEDIATE_FORMAT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_Images[i]));
+        m_IntermediateBytes += (VkDeviceSize)mipExtent.width * mipExtent.height * texelSize;
+    }
+    for (const PostIntermediate& intermediate : m_Intermediates) {
+        VkExtent2D mipExtent = GetMipExtent(intermediate.m_Mip);
+        m_UnsharedIntermediateBytes += (VkDeviceSize)mipExtent.width * mipExtent.height * texelSize;
+    }
+
+    for (const PostDispatch& dispatch : m_Dispatches) {
+        VkDescriptorImageInfo imageInfos[PostBinding_Count]{};
+        int32_t reads[2] = { dispatch.m_Source, (dispatch.m_Secondary >= 0) ? dispatch.m_Secondary : dispatch.m_Source };
+        for (uint32_t i = 0; i < 2; i++) {
+            imageInfos[i].sampler = m_Sampler;
+            imageInfos[i].imageView = (reads[i] < 0) ? input : m_Images[m_Intermediates[reads[i]].m_Image].m_View;
+            imageInfos[i].imageLayout = (reads[i] < 0) ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+        }
+        imageInfos[PostBinding_Destination].imageView = (dispatch.m_Destination < 0) ? output : m_Images[m_Intermediates[dispatch.m_Destination].m_Image].m_View;
+        imageInfos[PostBinding_Destination].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        VkWriteDescriptorSet writes[PostBinding_Count]{};
+        for (uint32_t i = 0; i < PostBinding_Count; i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = dispatch.m_DescriptorSet;
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = (PostBinding_Destination == i) ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            writes[i].pImageInfo = &imageInfos[i];
+        }
+        vkUpdateDescriptorSets(device, PostBinding_Count, writes, 0, nullptr);
+    }
+    return true;
+}
+
+void VulkanPostProcess::DestroyTargets()
+{
+    for (VulkanImage& image : m_Images) {
+        DestroyImage(m_CreateInfo.m_Device, image);
+    }
+    m_Images.clear();
+    m_Extent = { 0, 0 };
+    m_IntermediateBytes = 0;
+    m_UnsharedIntermediateBytes = 0;
+}
+
+void VulkanPostProcess::Record(VkCommandBuffer commandBuffer, const PostProcessParams& params)
+{
+    PROFILE_FUNCTION();
+    if (0 == m_Extent.width || m_Pipelines.empty()) {
+        return;
+    }
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdResetQueryPool(commandBuffer, m_QueryPool, 0, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, 0);
+    }
+
+    // Everything the last frame left in the intermediates is overwritten before it's read.
+    for (const VulkanImage& image : m_Images) {
+        CmdImageBarrier(commandBuffer, image.m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    }
+
+    PostProcessConstants constants;
+    constants.m_Params = params;
+    for (size_t i = 0; i < m_Dispatches.size(); i++) {
+        const PostDispatch& dispatch = m_Dispatches[i];
+        if (i > 0) {
+            // Also orders the reads of a shared image before the next intermediate overwrites it.
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                1, &barrier, 0, nullptr, 0, nullptr);
+        }
+
+        VkExtent2D destinationExtent = (dispatch.m_Destination < 0) ? m_Extent : GetMipExtent(m_Intermediates[dispatch.m_Destination].m_Mip);
+        VkExtent2D sourceExtent = (dispatch.m_Source < 0) ? m_Extent : GetMipExtent(m_Intermediates[dispatch.m_Source].m_Mip);
+        constants.m_TexelSize = glm::vec4(1.0f / destinationExtent.width, 1.0f / destinationExtent.height,
+            1.0f / sourceExtent.width, 1.0f / sourceExtent.height);
+
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipelines[dispatch.m_Pipeline]);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &dispatch.m_DescriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PostProcessConstants), &constants);
+        vkCmdDispatch(commandBuffer, (destinationExtent.width + POST_GROUP_SIZE - 1) / POST_GROUP_SIZE,
+            (destinationExtent.height + POST_GROUP_SIZE - 1) / POST_GROUP_SIZE, 1);
+    }
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, 1);
+        m_QueryWritten = true;
+    }
+    m_LastTiming.m_Dispatches = (uint32_t)m_Dispatches.size();
+}
+
+void VulkanPostProcess::CollectGpuTiming()
+{
+    if (VK_NULL_HANDLE == m_QueryPool || !m_QueryWritten) {
+        return;
+    }
+
+    uint64_t timestamps[2] = { 0, 0 };
+    if (VK_SUCCESS != vkGetQueryPoolResults(m_CreateInfo.m_Device, m_QueryPool, 0, 2, sizeof(timestamps), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT)) {
+        return;
+    }
+    m_QueryWritten = false;
+    m_LastTiming.m_GpuMs = ((timestamps[1] - timestamps[0]) & m_TimestampMask) * m_TimestampPeriod / 1000000.0;
+    PROFILE_COUNTER("PostProcessGpuMs", m_LastTiming.m_GpuMs);
+}
+
+void VulkanPostProcess::Destroy()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE == device) {
+        return;
+    }
+
+    DestroyTargets();
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkDestroyQueryPool(device, m_QueryPool, GetVulkanAllocator());
+        m_QueryPool = VK_NULL_HANDLE;
+    }
+    for (VkPipeline pipeline : m_Pipelines) {
+        vkDestroyPipeline(device, pipeline, GetVulkanAllocator());
+    }
+    m_Pipelines.clear();
+    if (VK_NULL_HANDLE != m_PipelineLayout) {
+        vkDestroyPipelineLayout(device, m_PipelineLayout, GetVulkanAllocator());
+        m_PipelineLayout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorPool) {
+        vkDestroyDescriptorPool(device, m_DescriptorPool, GetVulkanAllocator());
+        m_DescriptorPool = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorSetLayout) {
+        vkDestroyDescriptorSetLayout(device, m_DescriptorSetLayout, GetVulkanAllocator());
+        m_DescriptorSetLayout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_Sampler) {
+        vkDestroySampler(device, m_Sampler, GetVulkanAllocator());
+        m_Sampler = VK_NULL_HANDLE;
+    }
+    m_Dispatches.clear();
+    m_Intermediates.clear();
+    m_ImageMips.clear();
+    m_CreateInfo.m_Device = VK_NULL_HANDLE;
+}
+
+__END_NAMESPACE
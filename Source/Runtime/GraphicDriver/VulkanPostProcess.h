@@ -0,0 +1,128 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+enum class PostProcessEffect : uint32_t
+{
+	Bloom = 0,        // Bright parts blurred down & back up a mip chain, added back to the color
+	Tonemap,          // Exposure & ACES fitted curve
+	ColorGrading,     // Saturation, contrast, lift & gain
+	Fxaa,             // Reads its neighbours, so it starts a dispatch of its own
+	Vignette,
+};
+
+// Same layout as the first members of the PostProcessConstants push constants of post_process.shader.comp.
+typedef struct PostProcessParams {
+	glm::vec4            m_Bloom = glm::vec4(0.8f, 0.5f, 0.6f, 0.0f);      // x: threshold, y: soft knee, z: intensity
+	glm::vec4            m_Tonemap = glm::vec4(1.4f, 0.0f, 0.0f, 0.0f);    // x: exposure
+	glm::vec4            m_Grading = glm::vec4(1.1f, 1.05f, 0.01f, 1.0f);  // x: saturation, y: contrast, z: lift, w: gain
+	glm::vec4            m_Vignette = glm::vec4(0.35f, 2.5f, 0.0f, 0.0f);  // x: intensity, y: falloff exponent
+} PostProcessParams;
+
+typedef struct VulkanPostProcessCreateInfo {
+	VkDevice                    m_Device;
+	VkPhysicalDevice            m_PhysicalDevice;
+	VkPipelineCache             m_PipelineCache;
+	uint32_t                    m_QueueFamilyIndex;      // Of the queue the chain is recorded for, for timestamps
+	const PostProcessEffect*    m_Effects;               // In the order they apply, only read by Create()
+	uint32_t                    m_EffectCount;
+	bool                        m_Fuse = true;           // false gives every effect a dispatch of its own, to measure what fusing saves
+	uint32_t                    m_BloomMips = 5;
+} VulkanPostProcessCreateInfo;
+
+typedef struct PostProcessTiming {
+	double               m_GpuMs;                // Whole chain, 0 without timestamp support
+	uint32_t             m_Dispatches;
+} PostProcessTiming;
+
+
+/**
+ * A chain of post-processing effects run as compute dispatches, from a sampled scene color to a storage image
+ * written sRGB encoded.
+ *
+ * The chain is planned once, when it's created: runs of per pixel effects are fused into the dispatch before
+ * them as specialization constants of post_process.shader.comp, so their colors stay in registers instead of
+ * going through memory between effects. Only effects reading their neighbours, FXAA & the bloom chain, start
+ * a new dispatch. Each intermediate is then given the first image of its size that no later dispatch reads
+ * anymore, so the bloom mips & the fused passes share a few images rather than owning one each.
+ */
+class VulkanPostProcess
+{
+public:
+	VulkanPostProcess();
+	virtual ~VulkanPostProcess();
+
+	bool Create(const VulkanPostProcessCreateInfo& createInfo);
+	// Intermediate images for extent & the descriptor sets over them. input is sampled in SHADER_READ_ONLY_OPTIMAL,
+	// output an R8G8B8A8_UNORM storage view written in GENERAL, both the size of extent.
+	bool CreateTargets(VkExtent2D extent, VkImageView input, VkImageView output);
+	void DestroyTargets();
+	void Destroy();
+
+	// Record outside of a render pass, once the input is readable & the output in GENERAL by the compute stage.
+	void Record(VkCommandBuffer commandBuffer, const PostProcessParams& params);
+	// Once the recorded frame's fence signaled, reads back the GPU time of its chain.
+	void CollectGpuTiming();
+	const PostProcessTiming& GetLastTiming() const { return m_LastTiming; }
+
+	uint32_t GetDispatchCount() const { return (uint32_t)m_Dispatches.size(); }
+	// Of the images actually allocated, after reuse, and of one image per intermediate without it.
+	VkDeviceSize GetIntermediateBytes() const { return m_IntermediateBytes; }
+	VkDeviceSize GetUnsharedIntermediateBytes() const { return m_UnsharedIntermediateBytes; }
+
+private:
+	enum class PostKernel : uint32_t
+	{
+		Load = 0,             // The source at the same pixel, per pixel effects only
+		Fxaa,
+		BloomPrefilter,       // Thresholded & downsampled from the source
+		BloomDownsample,
+		BloomUpsample,        // Tent filtered source plus the secondary, one mip up
+	};
+
+	typedef struct PostDispatch {
+		PostKernel       m_Kernel;
+		uint32_t         m_FusedEffects;     // Bits of the per pixel effects applied after the kernel
+		int32_t          m_Source;           // Intermediate read, -1 for the input
+		int32_t          m_Secondary;        // Intermediate read at the same uv, bloom or the mip added, -1 for none
+		int32_t          m_Destination;      // Intermediate written, -1 for the output
+		uint32_t         m_Pipeline;
+		VkDescriptorSet  m_DescriptorSet;
+	} PostDispatch;
+
+	typedef struct PostIntermediate {
+		uint32_t         m_Mip;              // Size is the extent >> m_Mip
+		uint32_t         m_Image;            // Index in m_Images
+	} PostIntermediate;
+
+	VulkanPostProcessCreateInfo        m_CreateInfo;
+	std::vector<PostDispatch>          m_Dispatches;
+	std::vector<PostIntermediate>      m_Intermediates;
+	std::vector<uint32_t>              m_ImageMips;        // Mip of each shared image
+	std::vector<VulkanImage>           m_Images;
+	VkExtent2D                         m_Extent;
+	VkDeviceSize                       m_IntermediateBytes;
+	VkDeviceSize                       m_UnsharedIntermediateBytes;
+
+	VkSampler                          m_Sampler;
+	VkDescriptorSetLayout              m_DescriptorSetLayout;
+	VkDescriptorPool                   m_DescriptorPool;
+	VkPipelineLayout                   m_PipelineLayout;
+	std::vector<VkPipeline>            m_Pipelines;
+
+	VkQueryPool                        m_QueryPool;
+	double                             m_TimestampPeriod;    // Nanoseconds per tick
+	uint64_t                           m_TimestampMask;
+	bool                               m_QueryWritten;
+	PostProcessTiming                  m_LastTiming;
+
+	void BuildDispatches();
+	void AssignImages();
+	bool CreatePipelines();
+	VkExtent2D GetMipExtent(uint32_t mip) const;
+};
+
+
+__END_NAMESPACE
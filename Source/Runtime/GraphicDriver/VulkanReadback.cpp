@@ -0,0 +1,254 @@
+#include <cstdint> // Necessary for UINT32_MAX
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanReadback.h"
+
+
+__BEGIN_NAMESPACE
+
+static const double READBACK_THROUGHPUT_WINDOW_SECONDS = 1.0;
+
+VulkanReadback::VulkanReadback() :
+	m_Device(VK_NULL_HANDLE),
+	m_PhysicalDevice(VK_NULL_HANDLE),
+	m_Queue(VK_NULL_HANDLE),
+	m_CommandPool(VK_NULL_HANDLE),
+	m_NextSlot(0),
+	m_CompletedCount(0),
+	m_DroppedCount(0),
+	m_WindowBytes(0),
+	m_ThroughputMBps(0.0)
+{
+}
+
+VulkanReadback::~VulkanReadback()
+{
+}
+
+bool VulkanReadback::Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, VkQueue queue, uint32_t slotCount)
+{
+    m_Device = device;
+    m_PhysicalDevice = physicalDevice;
+    m_Queue = queue;
+    m_WindowStart = std::chrono::steady_clock::now();
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndex;
+    if (vkCreateCommandPool(m_Device, &poolInfo, GetVulkanAllocator(), &m_CommandPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create readback command pool.\n";
+        SetErrorCode(ErrorCode::Vulkan_Invalid_CommandPool);
+        return false;
+    }
+
+    m_Slots.resize(std::max(slotCount, 1u));
+    for (ReadbackSlot& slot : m_Slots) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_CommandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkAllocateCommandBuffers(m_Device, &allocInfo, &slot.m_CommandBuffer) != VK_SUCCESS ||
+            vkCreateFence(m_Device, &fenceInfo, GetVulkanAllocator(), &slot.m_Fence) != VK_SUCCESS) {
+            std::cout << "Vulkan failed to create readback slot.\n";
+            SetErrorCode(ErrorCode::UnKnow);
+            return false;
+        }
+    }
+    return true;
+}
+
+void VulkanReadback::Destroy()
+{
+    if (VK_NULL_HANDLE == m_Device) {
+        return;
+    }
+
+    for (ReadbackSlot& slot : m_Slots) {
+        if (slot.m_Busy) {
+            vkWaitForFences(m_Device, 1, &slot.m_Fence, VK_TRUE, UINT64_MAX);
+        }
+        if (VK_NULL_HANDLE != slot.m_Fence) {
+            vkDestroyFence(m_Device, slot.m_Fence, GetVulkanAllocator());
+        }
+        DestroyBuffer(m_Device, slot.m_Buffer);
+    }
+    m_Slots.clear();
+
+    if (VK_NULL_HANDLE != m_CommandPool) {
+        vkDestroyCommandPool(m_Device, m_CommandPool, GetVulkanAllocator());
+        m_CommandPool = VK_NULL_HANDLE;
+    }
+    m_Device = VK_NULL_HANDLE;
+}
+
+bool VulkanReadback::BeginCapture(VkExtent2D extent)
+{
+    if (m_Slots.empty() || m_Slots[m_NextSlot].m_Busy || !ReserveBuffer(m_Slots[m_NextSlot], (VkDeviceSize)extent.width * extent.height * 4)) {
+        m_DroppedCount++;
+        return false;
+    }
+    return true;
+}
+
+// Grows only, slots keep their buffer across captures of the same size.
+bool VulkanReadback::ReserveBuffer(ReadbackSlot& slot, VkDeviceSize size)
+{
+    if (slot.m_Buffer.m_Size >= size) {
+        return true;
+    }
+    DestroyBuffer(m_Device, slot.m_Buffer);
+
+    // Cached memory makes the CPU read of the pixels much faster, it just needs an invalidate.
+    slot.m_Coherent = false;
+    if (UINT32_MAX == FindMemoryType(m_PhysicalDevice, UINT32_MAX, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT) ||
+        !CreateBuffer(m_Device, m_PhysicalDevice, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, slot.m_Buffer)) {
+        slot.m_Coherent = true;
+        VULKAN_DRIVER_CHECK_FUN(CreateBuffer(m_Device, m_PhysicalDevice, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, slot.m_Buffer));
+    }
+    return true;
+}
+
+bool VulkanReadback::Submit(const ReadbackRequest& request, uint64_t frameIndex, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore)
+{
+    PROFILE_FUNCTION();
+    // BeginCapture() made sure the slot is free & big enough.
+    ReadbackSlot& slot = m_Slots[m_NextSlot];
+    VkDeviceSize size = (VkDeviceSize)request.m_Extent.width * request.m_Extent.height * 4;
+
+    VkCommandBuffer commandBuffer = slot.m_CommandBuffer;
+    vkResetCommandBuffer(commandBuffer, 0);
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to begin recording readback command buffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = { request.m_Extent.width, request.m_Extent.height, 1 };
+    vkCmdCopyImageToBuffer(commandBuffer, request.m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.m_Buffer.m_Buffer, 1, &region);
+
+    // Back to the layout the image's owner expects, the semaphore orders it before the next use.
+    CmdImageBarrier(commandBuffer, request.m_Image, VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, request.m_FinalLayout,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0);
+
+    VkBufferMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.buffer = slot.m_Buffer.m_Buffer;
+    hostBarrier.size = size;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to record readback command buffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = (VK_NULL_HANDLE != waitSemaphore) ? 1 : 0;
+    submitInfo.pWaitSemaphores = &waitSemaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = (VK_NULL_HANDLE != signalSemaphore) ? 1 : 0;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+
+    vkResetFences(m_Device, 1, &slot.m_Fence);
+    if (vkQueueSubmit(m_Queue, 1, &submitInfo, slot.m_Fence) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to submit readback command buffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    slot.m_Busy = true;
+    slot.m_Request = request;
+    slot.m_FrameIndex = frameIndex;
+    m_NextSlot = (m_NextSlot + 1) % (uint32_t)m_Slots.size();
+    return true;
+}
+
+void VulkanReadback::Complete(ReadbackSlot& slot, uint64_t frameIndex)
+{
+    PROFILE_ZONE("ReadbackCallback");
+    const ReadbackRequest& request = slot.m_Request;
+    VkDeviceSize size = (VkDeviceSize)request.m_Extent.width * request.m_Extent.height * 4;
+    if (!slot.m_Coherent) {
+        VkMappedMemoryRange range{};
+        range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        range.memory = slot.m_Buffer.m_Memory;
+        range.size = VK_WHOLE_SIZE;
+        vkInvalidateMappedMemoryRanges(m_Device, 1, &range);
+    }
+
+    if (request.m_Callback) {
+        ReadbackResult result;
+        result.m_Data = (const uint8_t*)slot.m_Buffer.m_Mapped;
+        result.m_Size = size;
+        result.m_Width = request.m_Extent.width;
+        result.m_Height = request.m_Extent.height;
+        result.m_Format = request.m_Format;
+        result.m_FrameIndex = slot.m_FrameIndex;
+        result.m_LatencyFrames = (uint32_t)(frameIndex - slot.m_FrameIndex);
+        request.m_Callback(result);
+    }
+
+    slot.m_Busy = false;
+    slot.m_Request = {};
+    m_CompletedCount++;
+    m_WindowBytes += size;
+}
+
+void VulkanReadback::Update(uint64_t frameIndex)
+{
+    // Slots finish in submit order on the one queue, so stop at the first one still running.
+    for (size_t i = 0; i < m_Slots.size(); i++) {
+        ReadbackSlot& slot = m_Slots[(m_NextSlot + i) % m_Slots.size()];
+        if (!slot.m_Busy) {
+            continue;
+        }
+        if (vkGetFenceStatus(m_Device, slot.m_Fence) != VK_SUCCESS) {
+            break;
+        }
+        Complete(slot, frameIndex);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_WindowStart).count();
+    if (seconds >= READBACK_THROUGHPUT_WINDOW_SECONDS) {
+        m_ThroughputMBps = (double)m_WindowBytes / (1024.0 * 1024.0) / seconds;
+        m_WindowBytes = 0;
+        m_WindowStart = std::chrono::steady_clock::now();
+        PROFILE_COUNTER("ReadbackMBps", m_ThroughputMBps);
+    }
+}
+
+void VulkanReadback::Flush(uint64_t frameIndex)
+{
+    for (size_t i = 0; i < m_Slots.size(); i++) {
+        ReadbackSlot& slot = m_Slots[(m_NextSlot + i) % m_Slots.size()];
+        if (slot.m_Busy) {
+            vkWaitForFences(m_Device, 1, &slot.m_Fence, VK_TRUE, UINT64_MAX);
+            Complete(slot, frameIndex);
+        }
+    }
+}
+
+__END_NAMESPACE
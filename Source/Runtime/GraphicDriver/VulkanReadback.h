@@ -0,0 +1,88 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+// Pixels of a finished readback, only valid during the callback.
+typedef struct ReadbackResult {
+	const uint8_t*    m_Data;
+	VkDeviceSize      m_Size;
+	uint32_t          m_Width;
+	uint32_t          m_Height;
+	VkFormat          m_Format;
+	uint64_t          m_FrameIndex;        // Frame the image was captured in
+	uint32_t          m_LatencyFrames;     // Frames between the capture & the callback
+} ReadbackResult;
+
+typedef std::function<void(const ReadbackResult&)> ReadbackCallback;
+
+typedef struct ReadbackRequest {
+	VkImage           m_Image;
+	VkExtent2D        m_Extent;
+	VkFormat          m_Format;            // 4 bytes per pixel
+	VkImageLayout     m_FinalLayout;       // The image is in TRANSFER_SRC_OPTIMAL when the copy runs, then goes to this
+	ReadbackCallback  m_Callback;
+} ReadbackRequest;
+
+
+/**
+ * Asynchronous image downloads. Each capture copies into one slot of a ring of host cached, persistently
+ * mapped buffers, on its own submit chained after the frame by a semaphore, and Update() runs the callback
+ * once the slot's fence has signaled, normally frames later. Nothing ever waits on the GPU: with every slot
+ * in flight a capture is dropped instead.
+ */
+class VulkanReadback
+{
+public:
+	VulkanReadback();
+	virtual ~VulkanReadback();
+
+	bool Create(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, VkQueue queue, uint32_t slotCount);
+	void Destroy();
+
+	// Call before recording the transition of the captured image, false when every slot is in flight & the capture is dropped.
+	bool BeginCapture(VkExtent2D extent);
+	// Copies request.m_Image after waitSemaphore & signals signalSemaphore.
+	bool Submit(const ReadbackRequest& request, uint64_t frameIndex, VkSemaphore waitSemaphore, VkSemaphore signalSemaphore);
+	// Runs the callbacks of every finished slot, call once per frame.
+	void Update(uint64_t frameIndex);
+	// Waits for every slot & runs the callbacks.
+	void Flush(uint64_t frameIndex);
+
+	VkQueue GetQueue() const { return m_Queue; }
+	// Bytes delivered per second of wall time, over the last second.
+	double GetThroughputMBps() const { return m_ThroughputMBps; }
+	uint64_t GetCompletedCount() const { return m_CompletedCount; }
+	uint64_t GetDroppedCount() const { return m_DroppedCount; }
+
+private:
+	typedef struct ReadbackSlot {
+		VulkanBuffer        m_Buffer;
+		bool                m_Coherent = true;
+		VkCommandBuffer     m_CommandBuffer = VK_NULL_HANDLE;
+		VkFence             m_Fence = VK_NULL_HANDLE;
+		bool                m_Busy = false;
+		ReadbackRequest     m_Request = {};
+		uint64_t            m_FrameIndex = 0;
+	} ReadbackSlot;
+
+	bool ReserveBuffer(ReadbackSlot& slot, VkDeviceSize size);
+	void Complete(ReadbackSlot& slot, uint64_t frameIndex);
+
+	VkDevice                      m_Device;
+	VkPhysicalDevice              m_PhysicalDevice;
+	VkQueue                       m_Queue;
+	VkCommandPool                 m_CommandPool;
+	std::vector<ReadbackSlot>     m_Slots;
+	uint32_t                      m_NextSlot;
+
+	uint64_t                      m_CompletedCount;
+	uint64_t                      m_DroppedCount;
+	uint64_t                      m_WindowBytes;
+	std::chrono::steady_clock::time_point m_WindowStart;
+	double                        m_ThroughputMBps;
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,541 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanSceneAttachments.h"
+
+
+__BEGIN_NAMESPACE
+
+// Preferred first, the stencil formats are only a fallback since nothing uses stencil yet.
+static const VkFormat SCENE_DEPTH_FORMATS[] = {
+    VK_FORMAT_D32_SFLOAT,
+    VK_FORMAT_D32_SFLOAT_S8_UINT,
+    VK_FORMAT_D24_UNORM_S8_UINT,
+};
+
+static bool HasStencilComponent(VkFormat format)
+{
+    return VK_FORMAT_D32_SFLOAT_S8_UINT == format || VK_FORMAT_D24_UNORM_S8_UINT == format;
+}
+
+VulkanSceneAttachments::VulkanSceneAttachments() :
+	m_Device(VK_NULL_HANDLE),
+	m_PhysicalDevice(VK_NULL_HANDLE),
+	m_ColorFormat(VK_FORMAT_UNDEFINED),
+	m_DepthFormat(VK_FORMAT_UNDEFINED),
+	m_Samples(VK_SAMPLE_COUNT_1_BIT),
+	m_TransientMemoryProperties(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT),
+#if defined(VK_KHR_dynamic_rendering)
+	m_CmdBeginRendering(nullptr),
+	m_CmdEndRendering(nullptr),
+	m_PipelineRendering{},
+	m_InheritanceRendering{},
+#endif
+#if defined(VK_KHR_synchronization2)
+	m_CmdPipelineBarrier2(nullptr),
+#endif
+	m_DynamicRendering(false),
+	m_Synchronization2(false)
+{
+}
+
+VulkanSceneAttachments::~VulkanSceneAttachments()
+{
+}
+
+bool VulkanSceneAttachments::Create(VkDevice device, VkPhysicalDevice physicalDevice, VkFormat colorFormat, const SceneAttachmentSettings& settings)
+{
+    m_Device = device;
+    m_PhysicalDevice = physicalDevice;
+    m_ColorFormat = colorFormat;
+    m_Settings = settings;
+
+    m_DepthFormat = VK_FORMAT_UNDEFINED;
+    if (m_Settings.m_Depth) {
+        // A sampled view has a single aspect, combined formats would need a second view for the attachment.
+        VkFormatFeatureFlags depthFeatures = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT |
+            (m_Settings.m_SampledDepth ? VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT : 0);
+        for (VkFormat format : SCENE_DEPTH_FORMATS) {
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+            if ((formatProperties.optimalTilingFeatures & depthFeatures) == depthFeatures &&
+                !(m_Settings.m_SampledDepth && HasStencilComponent(format))) {
+                m_DepthFormat = format;
+                break;
+            }
+        }
+        if (VK_FORMAT_UNDEFINED == m_DepthFormat) {
+            std::cout << "Vulkan has no depth attachment format, scene renders without depth.\n";
+        }
+    }
+    if (m_Settings.m_SampledDepth) {
+        // Sampled as a whole image by the passes after, never resolved.
+        m_Settings.m_Samples = 1;
+    }
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+    VkSampleCountFlags supportedSamples = deviceProperties.limits.framebufferColorSampleCounts;
+    if (HasDepth()) {
+        supportedSamples &= deviceProperties.limits.framebufferDepthSampleCounts;
+    }
+
+    // Highest supported count not above the requested one, sample counts are single bits.
+    m_Samples = VK_SAMPLE_COUNT_1_BIT;
+    for (uint32_t samples = std::max(m_Settings.m_Samples, 1u); samples > 1; samples >>= 1) {
+        if ((samples & (samples - 1)) == 0 && (supportedSamples & samples)) {
+            m_Samples = (VkSampleCountFlagBits)samples;
+            break;
+        }
+    }
+
+    // Tilers expose lazily allocated memory, transient attachments then never get backing memory at all. Whether an
+    // image can live in it is only known from its own requirements, CreateImage2D() drops the bit for those that can't.
+    m_TransientMemoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if (UINT32_MAX != FindMemoryType(physicalDevice, UINT32_MAX, VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+        m_TransientMemoryProperties |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    }
+
+    UpdatePipelineRendering();
+    std::cout << "Vulkan scene attachments: " << (uint32_t)m_Samples << "x MSAA, depth format " << m_DepthFormat
+        << (IsLazilyAllocated() ? ", lazily allocated" : "") << (m_DynamicRendering ? ", dynamic rendering" : "") << ".\n";
+    return true;
+}
+
+bool VulkanSceneAttachments::CreateImages(VkExtent2D extent)
+{
+    DestroyImages();
+
+    if (IsMultisampled()) {
+        if (!CreateImage2D(m_Device, m_PhysicalDevice, extent, m_ColorFormat,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+            VK_IMAGE_ASPECT_COLOR_BIT, m_TransientMemoryProperties, m_ColorImage, m_Samples)) {
+            return false;
+        }
+    }
+
+    if (HasDepth()) {
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        if (HasStencilComponent(m_DepthFormat)) {
+            aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+        }
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT |
+            (IsDepthSampled() ? VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+        if (!CreateImage2D(m_Device, m_PhysicalDevice, extent, m_DepthFormat, usage, aspect,
+            IsDepthSampled() ? (VkMemoryPropertyFlags)VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : (VkMemoryPropertyFlags)m_TransientMemoryProperties, m_DepthImage, m_Samples)) {
+            DestroyImages();
+            return false;
+        }
+    }
+    return true;
+}
+
+void VulkanSceneAttachments::DestroyImages()
+{
+    if (VK_NULL_HANDLE == m_Device) {
+        return;
+    }
+    DestroyImage(m_Device, m_ColorImage);
+    DestroyImage(m_Device, m_DepthImage);
+}
+
+void VulkanSceneAttachments::Destroy()
+{
+    DestroyImages();
+    m_DynamicRendering = false;
+    m_Synchronization2 = false;
+    m_Device = VK_NULL_HANDLE;
+}
+
+bool VulkanSceneAttachments::CreateRenderPass(VkImageLayout finalLayout, const VkSubpassDependency* dependencies, uint32_t dependencyCount, VkRenderPass& renderPass,
+    bool load) const
+{
+    // Multisampled color & an unsampled depth aren't stored, there'd be nothing to load.
+    if (load && (IsMultisampled() || (HasDepth() && !IsDepthSampled()))) {
+        std::cout << "Vulkan scene pass can only load single sampled attachments with a sampled depth.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkAttachmentDescription attachments[MAX_ATTACHMENTS] = {};
+    uint32_t attachmentCount = 0;
+
+    // Without MSAA the color attachment is the output, otherwise only its resolve is kept.
+    VkAttachmentDescription& colorAttachment = attachments[attachmentCount++];
+    colorAttachment.format = m_ColorFormat;
+    colorAttachment.samples = m_Samples;
+    colorAttachment.loadOp = load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = IsMultisampled() ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = load ? finalLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = IsMultisampled() ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : finalLayout;
+
+    VkAttachmentReference colorAttachmentRef{};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentRef{};
+    if (HasDepth()) {
+        VkAttachmentDescription& depthAttachment = attachments[attachmentCount];
+        depthAttachment.format = m_DepthFormat;
+        depthAttachment.samples = m_Samples;
+        depthAttachment.loadOp = load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = IsDepthSampled() ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.finalLayout = IsDepthSampled() ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.initialLayout = load ? depthAttachment.finalLayout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+        depthAttachmentRef.attachment = attachmentCount++;
+        depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    }
+
+    VkAttachmentReference resolveAttachmentRef{};
+    if (IsMultisampled()) {
+        VkAttachmentDescription& resolveAttachment = attachments[attachmentCount];
+        resolveAttachment.format = m_ColorFormat;
+        resolveAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolveAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        resolveAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        resolveAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        resolveAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        resolveAttachment.finalLayout = finalLayout;
+
+        resolveAttachmentRef.attachment = attachmentCount++;
+        resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = HasDepth() ? &depthAttachmentRef : nullptr;
+    subpass.pResolveAttachments = IsMultisampled() ? &resolveAttachmentRef : nullptr;
+
+    // Transient images are shared by all frames in flight, the previous frame's writes to them must finish first.
+    VkSubpassDependency sceneDependencies[4] = {};
+    dependencyCount = std::min(dependencyCount, 4u);
+    for (uint32_t i = 0; i < dependencyCount; i++) {
+        sceneDependencies[i] = dependencies[i];
+        if (IsMultisampled() && VK_SUBPASS_EXTERNAL == sceneDependencies[i].srcSubpass) {
+            sceneDependencies[i].srcStageMask |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            sceneDependencies[i].srcAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            sceneDependencies[i].dstStageMask |= VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+            sceneDependencies[i].dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        }
+        if (HasDepth() && VK_SUBPASS_EXTERNAL == sceneDependencies[i].srcSubpass) {
+            sceneDependencies[i].srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            sceneDependencies[i].srcAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+            sceneDependencies[i].dstStageMask |= VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+            sceneDependencies[i].dstAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        }
+        // Sampled depth is read after the pass, at the stages the dependency out of it names.
+        if (IsDepthSampled() && VK_SUBPASS_EXTERNAL == sceneDependencies[i].dstSubpass) {
+            sceneDependencies[i].srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+            sceneDependencies[i].srcAccessMask |= VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        }
+    }
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = attachmentCount;
+    renderPassInfo.pAttachments = attachments;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = dependencyCount;
+    renderPassInfo.pDependencies = sceneDependencies;
+
+    if (vkCreateRenderPass(m_Device, &renderPassInfo, GetVulkanAllocator(), &renderPass) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create scene render pass.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+uint32_t VulkanSceneAttachments::GetFramebufferAttachments(VkImageView outputView, VkImageView* views) const
+{
+    uint32_t count = 0;
+    views[count++] = IsMultisampled() ? m_ColorImage.m_View : outputView;
+    if (HasDepth()) {
+        views[count++] = m_DepthImage.m_View;
+    }
+    if (IsMultisampled()) {
+        views[count++] = outputView;
+    }
+    return count;
+}
+
+uint32_t VulkanSceneAttachments::GetClearValues(VkClearValue* clearValues) const
+{
+    uint32_t count = 0;
+    clearValues[count++].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+    if (HasDepth()) {
+        clearValues[count++].depthStencil = { 1.0f, 0 };
+    }
+    if (IsMultisampled()) {
+        // Resolve target isn't cleared, the entry only keeps indices matching attachments.
+        clearValues[count++].color = { { 0.0f, 0.0f, 0.0f, 1.0f } };
+    }
+    return count;
+}
+
+void VulkanSceneAttachments::GetPipelineState(VkPipelineMultisampleStateCreateInfo& multisampling, VkPipelineDepthStencilStateCreateInfo& depthStencil) const
+{
+    multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = m_Samples;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.minSampleShading = 1.0f;
+
+    depthStencil = {};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = HasDepth() ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = HasDepth() ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+    depthStencil.minDepthBounds = 0.0f;
+    depthStencil.maxDepthBounds = 1.0f;
+}
+
+void VulkanSceneAttachments::GetBandwidth(VkExtent2D extent, AttachmentBandwidth& bandwidth) const
+{
+    // Only the single sampled output & a sampled depth are stored, multisampled color & depth are written then dropped.
+    VkDeviceSize pixels = (VkDeviceSize)extent.width * extent.height;
+    VkDeviceSize samples = (VkDeviceSize)m_Samples;
+    bandwidth.m_MemoryBytes = pixels * (GetFormatSize(m_ColorFormat) + (IsDepthSampled() ? GetFormatSize(m_DepthFormat) : 0));
+    bandwidth.m_OnChipBytes = pixels * samples * ((IsMultisampled() ? GetFormatSize(m_ColorFormat) : 0) + (HasDepth() ? GetFormatSize(m_DepthFormat) : 0));
+}
+
+bool VulkanSceneAttachments::EnableDynamicRendering(bool synchronization2)
+{
+    m_DynamicRendering = false;
+    m_Synchronization2 = false;
+
+#if defined(VK_KHR_dynamic_rendering)
+    // Core names first, the KHR aliases only resolve when the extension itself was enabled.
+    m_CmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(m_Device, "vkCmdBeginRendering");
+    m_CmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(m_Device, "vkCmdEndRendering");
+    if (nullptr == m_CmdBeginRendering || nullptr == m_CmdEndRendering) {
+        m_CmdBeginRendering = (PFN_vkCmdBeginRenderingKHR)vkGetDeviceProcAddr(m_Device, "vkCmdBeginRenderingKHR");
+        m_CmdEndRendering = (PFN_vkCmdEndRenderingKHR)vkGetDeviceProcAddr(m_Device, "vkCmdEndRenderingKHR");
+    }
+    m_DynamicRendering = (nullptr != m_CmdBeginRendering && nullptr != m_CmdEndRendering);
+
+#if defined(VK_KHR_synchronization2)
+    if (m_DynamicRendering && synchronization2) {
+        m_CmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2KHR)vkGetDeviceProcAddr(m_Device, "vkCmdPipelineBarrier2");
+        if (nullptr == m_CmdPipelineBarrier2) {
+            m_CmdPipelineBarrier2 = (PFN_vkCmdPipelineBarrier2KHR)vkGetDeviceProcAddr(m_Device, "vkCmdPipelineBarrier2KHR");
+        }
+        m_Synchronization2 = (nullptr != m_CmdPipelineBarrier2);
+    }
+#endif
+    UpdatePipelineRendering();
+#endif
+    (void)synchronization2;
+    return m_DynamicRendering;
+}
+
+void VulkanSceneAttachments::UpdatePipelineRendering()
+{
+#if defined(VK_KHR_dynamic_rendering)
+    m_PipelineRendering = {};
+    m_PipelineRendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    m_PipelineRendering.colorAttachmentCount = 1;
+    m_PipelineRendering.pColorAttachmentFormats = &m_ColorFormat;
+    m_PipelineRendering.depthAttachmentFormat = m_DepthFormat;
+    m_PipelineRendering.stencilAttachmentFormat = HasStencilComponent(m_DepthFormat) ? m_DepthFormat : VK_FORMAT_UNDEFINED;
+
+    m_InheritanceRendering = {};
+    m_InheritanceRendering.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+    m_InheritanceRendering.colorAttachmentCount = 1;
+    m_InheritanceRendering.pColorAttachmentFormats = &m_ColorFormat;
+    m_InheritanceRendering.depthAttachmentFormat = m_PipelineRendering.depthAttachmentFormat;
+    m_InheritanceRendering.stencilAttachmentFormat = m_PipelineRendering.stencilAttachmentFormat;
+    m_InheritanceRendering.rasterizationSamples = m_Samples;
+#endif
+}
+
+void VulkanSceneAttachments::SetPipelineTarget(VkGraphicsPipelineCreateInfo& pipelineInfo, VkRenderPass renderPass) const
+{
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+#if defined(VK_KHR_dynamic_rendering)
+    if (m_DynamicRendering) {
+        pipelineInfo.renderPass = VK_NULL_HANDLE;
+        pipelineInfo.pNext = &m_PipelineRendering;
+    }
+#endif
+}
+
+void VulkanSceneAttachments::SetInheritanceTarget(VkCommandBufferInheritanceInfo& inheritance, VkRenderPass renderPass) const
+{
+    inheritance.renderPass = renderPass;
+    inheritance.subpass = 0;
+    inheritance.framebuffer = VK_NULL_HANDLE;
+#if defined(VK_KHR_dynamic_rendering)
+    if (m_DynamicRendering) {
+        inheritance.renderPass = VK_NULL_HANDLE;
+        inheritance.pNext = &m_InheritanceRendering;
+    }
+#endif
+}
+
+void VulkanSceneAttachments::CmdTransitions(VkCommandBuffer commandBuffer, const AttachmentTransition* transitions, uint32_t count) const
+{
+    VkImageSubresourceRange range{};
+    range.baseMipLevel = 0;
+    range.levelCount = 1;
+    range.baseArrayLayer = 0;
+    range.layerCount = 1;
+
+#if defined(VK_KHR_synchronization2)
+    // Every image gets its own stages instead of the union of all of them.
+    if (m_Synchronization2) {
+        VkImageMemoryBarrier2KHR barriers[MAX_ATTACHMENTS] = {};
+        for (uint32_t i = 0; i < count; i++) {
+            const AttachmentTransition& transition = transitions[i];
+            VkImageMemoryBarrier2KHR& barrier = barriers[i];
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR;
+            barrier.srcStageMask = (VkPipelineStageFlags2KHR)transition.m_SrcStage;
+            barrier.srcAccessMask = (VkAccessFlags2KHR)transition.m_SrcAccess;
+            barrier.dstStageMask = (VkPipelineStageFlags2KHR)transition.m_DstStage;
+            barrier.dstAccessMask = (VkAccessFlags2KHR)transition.m_DstAccess;
+            barrier.oldLayout = transition.m_OldLayout;
+            barrier.newLayout = transition.m_NewLayout;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = transition.m_Image;
+            barrier.subresourceRange = range;
+            barrier.subresourceRange.aspectMask = transition.m_Aspect;
+        }
+
+        VkDependencyInfoKHR dependencyInfo{};
+        dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO_KHR;
+        dependencyInfo.imageMemoryBarrierCount = count;
+        dependencyInfo.pImageMemoryBarriers = barriers;
+        m_CmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+        return;
+    }
+#endif
+
+    VkImageMemoryBarrier barriers[MAX_ATTACHMENTS] = {};
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const AttachmentTransition& transition = transitions[i];
+        VkImageMemoryBarrier& barrier = barriers[i];
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = transition.m_SrcAccess;
+        barrier.dstAccessMask = transition.m_DstAccess;
+        barrier.oldLayout = transition.m_OldLayout;
+        barrier.newLayout = transition.m_NewLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = transition.m_Image;
+        barrier.subresourceRange = range;
+        barrier.subresourceRange.aspectMask = transition.m_Aspect;
+        srcStages |= transition.m_SrcStage;
+        dstStages |= transition.m_DstStage;
+    }
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 0, nullptr, 0, nullptr, count, barriers);
+}
+
+void VulkanSceneAttachments::CmdBeginRendering(VkCommandBuffer commandBuffer, VkImage outputImage, VkImageView outputView, VkExtent2D renderExtent, VkPipelineStageFlags srcStage,
+    bool secondaryContents) const
+{
+#if defined(VK_KHR_dynamic_rendering)
+    // Contents are never kept, every transition starts from UNDEFINED. The transient images are shared by the
+    // frames in flight, so the previous frame's writes are waited for like the render pass dependencies do.
+    AttachmentTransition transitions[MAX_ATTACHMENTS];
+    uint32_t transitionCount = 0;
+    transitions[transitionCount++] = { outputImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        srcStage, 0, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+    if (IsMultisampled()) {
+        transitions[transitionCount++] = { m_ColorImage.m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+    }
+    if (HasDepth()) {
+        VkImageAspectFlags aspect = VK_IMAGE_ASPECT_DEPTH_BIT | (HasStencilComponent(m_DepthFormat) ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+        VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        // A sampled depth may still be read by the previous frame's passes after the scene, which srcStage covers.
+        transitions[transitionCount++] = { m_DepthImage.m_Image, aspect, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            depthStages | (IsDepthSampled() ? srcStage : 0), VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+    }
+    CmdTransitions(commandBuffer, transitions, transitionCount);
+
+    VkClearValue clearValues[MAX_ATTACHMENTS];
+    GetClearValues(clearValues);
+
+    // Without MSAA the color attachment is the output, otherwise only its resolve is kept.
+    VkRenderingAttachmentInfoKHR colorAttachment{};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    colorAttachment.imageView = IsMultisampled() ? m_ColorImage.m_View : outputView;
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.resolveMode = IsMultisampled() ? VK_RESOLVE_MODE_AVERAGE_BIT_KHR : VK_RESOLVE_MODE_NONE_KHR;
+    colorAttachment.resolveImageView = IsMultisampled() ? outputView : VK_NULL_HANDLE;
+    colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = IsMultisampled() ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.clearValue = clearValues[0];
+
+    VkRenderingAttachmentInfoKHR depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+    depthAttachment.imageView = m_DepthImage.m_View;
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.resolveMode = VK_RESOLVE_MODE_NONE_KHR;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = IsDepthSampled() ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue = HasDepth() ? clearValues[1] : VkClearValue{};
+
+    VkRenderingInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.flags = secondaryContents ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+    renderingInfo.renderArea.offset = { 0, 0 };
+    renderingInfo.renderArea.extent = renderExtent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    // Must match the pipelines' formats, which name a stencil attachment for combined formats.
+    renderingInfo.pDepthAttachment = HasDepth() ? &depthAttachment : nullptr;
+    renderingInfo.pStencilAttachment = HasStencilComponent(m_DepthFormat) ? &depthAttachment : nullptr;
+    m_CmdBeginRendering(commandBuffer, &renderingInfo);
+    if (secondaryContents) {
+        return;
+    }
+
+    VkViewport viewport = { 0.0f, 0.0f, (float)renderExtent.width, (float)renderExtent.height, 0.0f, 1.0f };
+    VkRect2D scissor = { { 0, 0 }, renderExtent };
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+#else
+    (void)commandBuffer; (void)outputImage; (void)outputView; (void)renderExtent; (void)srcStage; (void)secondaryContents;
+#endif
+}
+
+void VulkanSceneAttachments::CmdEndRendering(VkCommandBuffer commandBuffer, VkImage outputImage, VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) const
+{
+#if defined(VK_KHR_dynamic_rendering)
+    m_CmdEndRendering(commandBuffer);
+
+    AttachmentTransition transitions[2];
+    uint32_t transitionCount = 0;
+    transitions[transitionCount++] = { outputImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, finalLayout,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, dstStage, dstAccess };
+    if (IsDepthSampled()) {
+        transitions[transitionCount++] = { m_DepthImage.m_Image, VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            dstStage, VK_ACCESS_SHADER_READ_BIT };
+    }
+    CmdTransitions(commandBuffer, transitions, transitionCount);
+#else
+    (void)commandBuffer; (void)outputImage; (void)finalLayout; (void)dstStage; (void)dstAccess;
+#endif
+}
+
+__END_NAMESPACE
@@ -0,0 +1,120 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+typedef struct SceneAttachmentSettings {
+	uint32_t    m_Samples = 4;      // Clamped to the highest count color & depth both support, 1 disables MSAA
+	bool        m_Depth = true;
+	bool        m_SampledDepth = false; // Depth is stored for later passes instead of transient, single sampled formats without stencil only
+} SceneAttachmentSettings;
+
+
+/**
+ * Attachment layout shared by every scene render pass, so pipelines built against one pass work in all of them.
+ *
+ *   0: color, multisampled when MSAA is on, otherwise the output image itself
+ *   1: depth, when enabled
+ *   n: resolve target (the output image), when MSAA is on
+ *
+ * Multisampled color & depth only live for the pass: they are TRANSIENT_ATTACHMENT images on lazily allocated
+ * memory where the device has it, and their store ops are DONT_CARE, so tilers never write them back to memory.
+ * Sampled depth is the exception: it's stored & left in DEPTH_STENCIL_READ_ONLY_OPTIMAL for the passes after.
+ *
+ * With dynamic rendering enabled the same layout is bound at record time by CmdBeginRendering() instead, and
+ * scene passes have neither render pass nor framebuffer objects.
+ */
+class VulkanSceneAttachments
+{
+public:
+	VulkanSceneAttachments();
+	virtual ~VulkanSceneAttachments();
+
+	// Validates the settings against the device, picks the sample count & depth format.
+	bool Create(VkDevice device, VkPhysicalDevice physicalDevice, VkFormat colorFormat, const SceneAttachmentSettings& settings);
+	// Transient images, large enough for every framebuffer they're used in.
+	bool CreateImages(VkExtent2D extent);
+	void DestroyImages();
+	void Destroy();
+
+	// The pass leaves the output image in finalLayout. Depth stages are added to the external dependencies.
+	// A loading pass continues one of the same final layout, which stored everything: single sampled with a sampled depth only.
+	bool CreateRenderPass(VkImageLayout finalLayout, const VkSubpassDependency* dependencies, uint32_t dependencyCount, VkRenderPass& renderPass,
+		bool load = false) const;
+	// Framebuffer views in attachment order, returns the count.
+	uint32_t GetFramebufferAttachments(VkImageView outputView, VkImageView* views) const;
+	// Clear values in attachment order, returns the count.
+	uint32_t GetClearValues(VkClearValue* clearValues) const;
+	// Multisample & depth state for pipelines drawn in scene passes.
+	void GetPipelineState(VkPipelineMultisampleStateCreateInfo& multisampling, VkPipelineDepthStencilStateCreateInfo& depthStencil) const;
+	// Attachment traffic of one scene pass over extent.
+	void GetBandwidth(VkExtent2D extent, AttachmentBandwidth& bandwidth) const;
+
+	// False, and scene passes keep using render passes, when the device lacks the entry points.
+	// Layout transitions go through vkCmdPipelineBarrier2 when synchronization2 is set.
+	bool EnableDynamicRendering(bool synchronization2);
+	bool UsesDynamicRendering() const { return m_DynamicRendering; }
+	// Pipelines drawn in scene passes target renderPass, or the attachment formats with dynamic rendering.
+	void SetPipelineTarget(VkGraphicsPipelineCreateInfo& pipelineInfo, VkRenderPass renderPass) const;
+	// Likewise for secondary command buffers recorded for scene passes, subpass 0 without a framebuffer.
+	void SetInheritanceTarget(VkCommandBufferInheritanceInfo& inheritance, VkRenderPass renderPass) const;
+	// Dynamic rendering counterpart of beginning a pass from CreateRenderPass(): output & the transient images are transitioned,
+	// after srcStage for output's previous use, then cleared & bound over renderExtent. With secondaryContents the
+	// contents come from secondary command buffers, which set the viewport & scissor themselves.
+	void CmdBeginRendering(VkCommandBuffer commandBuffer, VkImage outputImage, VkImageView outputView, VkExtent2D renderExtent, VkPipelineStageFlags srcStage,
+		bool secondaryContents = false) const;
+	// Leaves output in finalLayout for dstStage & dstAccess.
+	void CmdEndRendering(VkCommandBuffer commandBuffer, VkImage outputImage, VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess) const;
+
+	const SceneAttachmentSettings& GetSettings() const { return m_Settings; }
+	VkSampleCountFlagBits GetSamples() const { return m_Samples; }
+	VkFormat GetDepthFormat() const { return m_DepthFormat; }
+	bool IsMultisampled() const { return m_Samples != VK_SAMPLE_COUNT_1_BIT; }
+	bool HasDepth() const { return VK_FORMAT_UNDEFINED != m_DepthFormat; }
+	bool IsDepthSampled() const { return HasDepth() && m_Settings.m_SampledDepth; }
+	// Depth aspect only, VK_NULL_HANDLE until the images exist.
+	VkImageView GetDepthView() const { return m_DepthImage.m_View; }
+	bool IsLazilyAllocated() const { return 0 != (m_TransientMemoryProperties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT); }
+	static const uint32_t MAX_ATTACHMENTS = 3;
+
+private:
+	typedef struct AttachmentTransition {
+		VkImage                 m_Image;
+		VkImageAspectFlags      m_Aspect;
+		VkImageLayout           m_OldLayout;
+		VkImageLayout           m_NewLayout;
+		VkPipelineStageFlags    m_SrcStage;
+		VkAccessFlags           m_SrcAccess;
+		VkPipelineStageFlags    m_DstStage;
+		VkAccessFlags           m_DstAccess;
+	} AttachmentTransition;
+
+	void CmdTransitions(VkCommandBuffer commandBuffer, const AttachmentTransition* transitions, uint32_t count) const;
+	void UpdatePipelineRendering();
+
+	VkDevice                    m_Device;
+	VkPhysicalDevice            m_PhysicalDevice;
+	SceneAttachmentSettings     m_Settings;
+	VkFormat                    m_ColorFormat;
+	VkFormat                    m_DepthFormat;
+	VkSampleCountFlagBits       m_Samples;
+	VkMemoryPropertyFlags       m_TransientMemoryProperties;
+	VulkanImage                 m_ColorImage;
+	VulkanImage                 m_DepthImage;
+
+#if defined(VK_KHR_dynamic_rendering)
+	PFN_vkCmdBeginRenderingKHR  m_CmdBeginRendering;
+	PFN_vkCmdEndRenderingKHR    m_CmdEndRendering;
+	VkPipelineRenderingCreateInfoKHR m_PipelineRendering;   // Points at m_ColorFormat
+	VkCommandBufferInheritanceRenderingInfoKHR m_InheritanceRendering;   // Likewise
+#endif
+#if defined(VK_KHR_synchronization2)
+	PFN_vkCmdPipelineBarrier2KHR m_CmdPipelineBarrier2;
+#endif
+	bool                        m_DynamicRendering;
+	bool                        m_Synchronization2;
+};
+
+
+__END_NAMESPACE
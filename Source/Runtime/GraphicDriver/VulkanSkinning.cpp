@@ -0,0 +1,557 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanSceneAttachments.h"
+#include "VulkanCascadedShadows.h"
+#include "VulkanFrameRing.h"
+#include "Animation.h"
+#include "VulkanSkinning.h"
+
+
+__BEGIN_NAMESPACE
+
+// SKINNING_GROUP_SIZE of skinning_common.glsl
+static const uint32_t SKINNING_GROUP_SIZE = 64;
+// Instances are the rows of the dispatch, within the 65535 groups all devices support.
+static const uint32_t SKINNING_MAX_INSTANCES = 65535;
+
+enum SkinBinding
+{
+    SkinBinding_RestVertices = 0,
+    SkinBinding_Palette,
+    SkinBinding_SkinnedVertices,
+    SkinBinding_Count,
+};
+
+// std430 layout of skinning_common.glsl
+typedef struct SkinnedVertex {
+    glm::vec4    m_Position;
+    glm::vec4    m_Normal;
+} SkinnedVertex;
+
+// Push constants of skin.shader.comp
+typedef struct SkinningConstants {
+    uint32_t     m_VertexCount;
+    uint32_t     m_JointCount;
+    uint32_t     m_InstanceCount;
+    uint32_t     m_Pad;
+} SkinningConstants;
+
+// Push constants of skinned.shader.vert
+typedef struct SkinnedDrawConstants {
+    glm::mat4    m_ViewProjection;
+    glm::uvec4   m_Mesh;
+} SkinnedDrawConstants;
+
+
+VulkanSkinning::VulkanSkinning() :
+	m_CreateInfo{},
+	m_VertexCount(0),
+	m_IndexCount(0),
+	m_SkinnedInstances(0),
+	m_SkinSetLayout(VK_NULL_HANDLE),
+	m_DrawSetLayout(VK_NULL_HANDLE),
+	m_DescriptorPool(VK_NULL_HANDLE),
+	m_DrawSet(VK_NULL_HANDLE),
+	m_SkinPipelineLayout(VK_NULL_HANDLE),
+	m_DrawPipelineLayout(VK_NULL_HANDLE),
+	m_SkinPipeline(VK_NULL_HANDLE),
+	m_DrawPipeline(VK_NULL_HANDLE),
+	m_ShadowPipeline(VK_NULL_HANDLE),
+	m_QueryPool(VK_NULL_HANDLE),
+	m_TimestampPeriod(1.0),
+	m_TimestampMask(UINT64_MAX),
+	m_LastTiming({ 0.0 })
+{
+}
+
+VulkanSkinning::~VulkanSkinning()
+{
+}
+
+bool VulkanSkinning::Create(const VulkanSkinningCreateInfo& createInfo)
+{
+    m_CreateInfo = createInfo;
+    m_CreateInfo.m_FramesInFlight = std::max(m_CreateInfo.m_FramesInFlight, 1u);
+    m_CreateInfo.m_MaxInstances = std::max(1u, std::min(m_CreateInfo.m_MaxInstances, SKINNING_MAX_INSTANCES));
+    m_CreateInfo.m_JointCount = std::max(1u, std::min(m_CreateInfo.m_JointCount, ANIMATION_MAX_JOINTS));
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+    const SkinnedMesh* mesh = m_CreateInfo.m_Mesh;
+    m_CreateInfo.m_Mesh = nullptr;
+    if (nullptr == mesh || mesh->m_Vertices.empty() || mesh->m_Indices.empty()) {
+        std::cout << "Vulkan failed to create skinning, no mesh.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    /****************************************************************************
+     * Rest pose & indices are read every frame, the skinned vertices only ever
+     * touched by the GPU
+     ****************************************************************************/
+    m_VertexCount = (uint32_t)mesh->m_Vertices.size();
+    m_IndexCount = (uint32_t)mesh->m_Indices.size();
+    VULKAN_DRIVER_CHECK_FUN(UploadBuffer(device, physicalDevice, mesh->m_Vertices.data(), mesh->m_Vertices.size() * sizeof(SkinnedMeshVertex),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, m_RestBuffer));
+    VULKAN_DRIVER_CHECK_FUN(UploadBuffer(device, physicalDevice, mesh->m_Indices.data(), mesh->m_Indices.size() * sizeof(uint32_t),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_IndexBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, (VkDeviceSize)m_CreateInfo.m_MaxInstances * m_VertexCount * sizeof(SkinnedVertex),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_SkinnedBuffer));
+    VULKAN_DRIVER_CHECK_FUN(CreateDescriptors());
+
+    /****************************************************************************
+     * Skinning pipeline
+     ****************************************************************************/
+    VkShaderModule skinModule = LoadShaderModule(device, "Data/Engine/skin.cs.spv");
+    if (VK_NULL_HANDLE == skinModule) {
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = skinModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_SkinPipelineLayout;
+    VkResult result = vkCreateComputePipelines(device, m_CreateInfo.m_PipelineCache, 1, &pipelineInfo, GetVulkanAllocator(), &m_SkinPipeline);
+    vkDestroyShaderModule(device, skinModule, GetVulkanAllocator());
+    if (VK_SUCCESS != result) {
+        m_SkinPipeline = VK_NULL_HANDLE;
+        std::cout << "Vulkan failed to create skinning pipeline.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    /****************************************************************************
+     * Timestamps around the dispatch, two per frame in flight
+     ****************************************************************************/
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    uint32_t validBits = (m_CreateInfo.m_QueueFamilyIndex < queueFamilyCount) ? queueFamilies[m_CreateInfo.m_QueueFamilyIndex].timestampValidBits : 0;
+
+    if (0 != validBits && deviceProperties.limits.timestampPeriod > 0.0f) {
+        m_TimestampPeriod = deviceProperties.limits.timestampPeriod;
+        m_TimestampMask = (validBits >= 64) ? UINT64_MAX : ((1ull << validBits) - 1);
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = m_CreateInfo.m_FramesInFlight * 2;
+        if (vkCreateQueryPool(device, &queryPoolInfo, GetVulkanAllocator(), &m_QueryPool) != VK_SUCCESS) {
+            m_QueryPool = VK_NULL_HANDLE;
+        }
+    }
+    m_QueryWritten.assign(m_CreateInfo.m_FramesInFlight, false);
+
+    std::cout << "Vulkan skinning created, " << m_CreateInfo.m_MaxInstances << " instances of " << m_VertexCount << " vertices & "
+        << m_CreateInfo.m_JointCount << " joints, " << (GetMemoryBytes() >> 20) << " MB.\n";
+    return true;
+}
+
+bool VulkanSkinning::CreateDescriptors()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+
+    VkDescriptorSetLayoutBinding bindings[SkinBinding_Count]{};
+    for (uint32_t i = 0; i < SkinBinding_Count; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = SkinBinding_Count;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_SkinSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create skinning descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    // The draws only see the skinned vertices.
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    layoutInfo.bindingCount = 1;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_DrawSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create skinned draw descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    uint32_t framesInFlight = m_CreateInfo.m_FramesInFlight;
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = framesInFlight * SkinBinding_Count + 1;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = framesInFlight + 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    if (vkCreateDescriptorPool(device, &poolInfo, GetVulkanAllocator(), &m_DescriptorPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create skinning descriptor pool.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    std::vector<VkDescriptorSetLayout> setLayouts(framesInFlight, m_SkinSetLayout);
+    setLayouts.push_back(m_DrawSetLayout);
+    std::vector<VkDescriptorSet> sets(framesInFlight + 1);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = framesInFlight + 1;
+    allocInfo.pSetLayouts = setLayouts.data();
+    if (vkAllocateDescriptorSets(device, &allocInfo, sets.data()) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate skinning descriptor sets.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    m_SkinSets.assign(sets.begin(), sets.begin() + framesInFlight);
+    m_DrawSet = sets.back();
+
+    // Everything but the palettes, which RecordSkinning() points at each frame.
+    VkDescriptorBufferInfo restInfo = { m_RestBuffer.m_Buffer, 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo skinnedInfo = { m_SkinnedBuffer.m_Buffer, 0, VK_WHOLE_SIZE };
+    std::vector<VkWriteDescriptorSet> writes;
+    for (VkDescriptorSet set : sets) {
+        bool draw = (set == m_DrawSet);
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = set;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.dstBinding = draw ? 0 : SkinBinding_SkinnedVertices;
+        write.pBufferInfo = &skinnedInfo;
+        writes.push_back(write);
+        if (!draw) {
+            write.dstBinding = SkinBinding_RestVertices;
+            write.pBufferInfo = &restInfo;
+            writes.push_back(write);
+        }
+    }
+    vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(SkinningConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_SkinSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_SkinPipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create skinning pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.size = sizeof(SkinnedDrawConstants);
+    pipelineLayoutInfo.pSetLayouts = &m_DrawSetLayout;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_DrawPipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create skinned draw pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanSkinning::CreateGraphicsPipeline(VkGraphicsPipelineCreateInfo& pipelineInfo, bool depthOnly, VkPipeline& pipeline)
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE != pipeline) {
+        vkDestroyPipeline(device, pipeline, GetVulkanAllocator());
+        pipeline = VK_NULL_HANDLE;
+    }
+
+    VkShaderModule vertShaderModule = LoadShaderModule(device, "Data/Engine/skinned.vs.spv");
+    VkShaderModule fragShaderModule = depthOnly ? VK_NULL_HANDLE : LoadShaderModule(device, "Data/Engine/procedural_scene.fs.spv");
+
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+    if (VK_NULL_HANDLE != vertShaderModule && (depthOnly || VK_NULL_HANDLE != fragShaderModule)) {
+        VkPipelineShaderStageCreateInfo shaderStages[2]{};
+        shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shaderStages[0].module = vertShaderModule;
+        shaderStages[0].pName = "main";
+        shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStages[1].module = fragShaderModule;
+        shaderStages[1].pName = "main";
+
+        // Vertices are fetched from the skinned buffer, only the indices come from a bound buffer.
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+        VkPipelineViewportStateCreateInfo viewportState{};
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.scissorCount = 1;
+
+        VkDynamicState dynamicStates[] = {
+            VK_DYNAMIC_STATE_VIEWPORT,
+            VK_DYNAMIC_STATE_SCISSOR
+        };
+
+        VkPipelineDynamicStateCreateInfo dynamicState{};
+        dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicState.dynamicStateCount = 2;
+        dynamicState.pDynamicStates = dynamicStates;
+
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = depthOnly ? 1 : 2;
+        pipelineInfo.pStages = shaderStages;
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pDynamicState = &dynamicState;
+        pipelineInfo.layout = m_DrawPipelineLayout;
+        pipelineInfo.basePipelineIndex = -1;
+
+        result = vkCreateGraphicsPipelines(device, m_CreateInfo.m_PipelineCache, 1, &pipelineInfo, GetVulkanAllocator(), &pipeline);
+    }
+
+    VkShaderModule shaderModules[2] = { vertShaderModule, fragShaderModule };
+    for (VkShaderModule shaderModule : shaderModules) {
+        if (VK_NULL_HANDLE != shaderModule) {
+            vkDestroyShaderModule(device, shaderModule, GetVulkanAllocator());
+        }
+    }
+
+    if (VK_SUCCESS != result) {
+        pipeline = VK_NULL_HANDLE;
+        std::cout << "Vulkan failed to create skinned " << (depthOnly ? "shadow" : "draw") << " pipeline.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanSkinning::CreateDrawPipeline(const VulkanSceneAttachments& sceneAttachments, VkRenderPass sceneRenderPass)
+{
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    sceneAttachments.GetPipelineState(multisampling, depthStencil);
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    sceneAttachments.SetPipelineTarget(pipelineInfo, sceneRenderPass);
+    return CreateGraphicsPipeline(pipelineInfo, false, m_DrawPipeline);
+}
+
+bool VulkanSkinning::CreateShadowPipeline(const VulkanCascadedShadows& cascadedShadows)
+{
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    cascadedShadows.GetPipelineState(rasterizer, depthStencil);
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 0;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.renderPass = cascadedShadows.GetRenderPass();
+    return CreateGraphicsPipeline(pipelineInfo, true, m_ShadowPipeline);
+}
+
+VkDeviceSize VulkanSkinning::GetPaletteBytes(uint32_t instanceCount) const
+{
+    return (VkDeviceSize)instanceCount * m_CreateInfo.m_JointCount * sizeof(JointMatrix);
+}
+
+VkDeviceSize VulkanSkinning::GetMemoryBytes() const
+{
+    return m_RestBuffer.m_Size + m_IndexBuffer.m_Size + m_SkinnedBuffer.m_Size;
+}
+
+void VulkanSkinning::RecordSkinning(VkCommandBuffer commandBuffer, uint32_t frameIndex, const FrameRingAllocation& palette, uint32_t instanceCount)
+{
+    PROFILE_FUNCTION();
+    m_SkinnedInstances = 0;
+    instanceCount = std::min(instanceCount, m_CreateInfo.m_MaxInstances);
+    if (VK_NULL_HANDLE == m_SkinPipeline || 0 == instanceCount || palette.m_Size < GetPaletteBytes(instanceCount)) {
+        return;
+    }
+
+    // The frame slot's previous palettes were consumed once its fence signaled.
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    VkDescriptorSet skinSet = m_SkinSets[frameIndex];
+    VkDescriptorBufferInfo paletteInfo = { palette.m_Buffer, palette.m_Offset, GetPaletteBytes(instanceCount) };
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = skinSet;
+    write.dstBinding = SkinBinding_Palette;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo = &paletteInfo;
+    vkUpdateDescriptorSets(m_CreateInfo.m_Device, 1, &write, 0, nullptr);
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdResetQueryPool(commandBuffer, m_QueryPool, frameIndex * 2, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, frameIndex * 2);
+    }
+
+    // The previous frame's draws are done reading the vertices about to be overwritten.
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+    SkinningConstants constants = { m_VertexCount, m_CreateInfo.m_JointCount, instanceCount, 0 };
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_SkinPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_SkinPipelineLayout, 0, 1, &skinSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_SkinPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SkinningConstants), &constants);
+    vkCmdDispatch(commandBuffer, (m_VertexCount + SKINNING_GROUP_SIZE - 1) / SKINNING_GROUP_SIZE, instanceCount, 1);
+
+    // Every pass of the frame after it reads the same skinned vertices.
+    VkBufferMemoryBarrier skinnedBarrier{};
+    skinnedBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    skinnedBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    skinnedBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    skinnedBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    skinnedBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    skinnedBarrier.buffer = m_SkinnedBuffer.m_Buffer;
+    skinnedBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, 0, 0, nullptr, 1, &skinnedBarrier, 0, nullptr);
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, frameIndex * 2 + 1);
+        m_QueryWritten[frameIndex] = true;
+    }
+    m_SkinnedInstances = instanceCount;
+}
+
+void VulkanSkinning::RecordInstances(VkCommandBuffer commandBuffer, VkPipeline pipeline, const glm::mat4& viewProjection)
+{
+    if (VK_NULL_HANDLE == pipeline || 0 == m_SkinnedInstances) {
+        return;
+    }
+
+    SkinnedDrawConstants constants;
+    constants.m_ViewProjection = viewProjection;
+    constants.m_Mesh = glm::uvec4(m_VertexCount, 0, 0, 0);
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_DrawPipelineLayout, 0, 1, &m_DrawSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_DrawPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(SkinnedDrawConstants), &constants);
+    vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer.m_Buffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdDrawIndexed(commandBuffer, m_IndexCount, m_SkinnedInstances, 0, 0, 0);
+}
+
+void VulkanSkinning::RecordDraw(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection)
+{
+    RecordInstances(commandBuffer, m_DrawPipeline, viewProjection);
+}
+
+void VulkanSkinning::RecordShadowDraw(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection)
+{
+    RecordInstances(commandBuffer, m_ShadowPipeline, viewProjection);
+}
+
+void VulkanSkinning::CollectGpuTiming(uint32_t frameIndex)
+{
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    if (VK_NULL_HANDLE == m_QueryPool || !m_QueryWritten[frameIndex]) {
+        return;
+    }
+
+    uint64_t timestamps[2] = { 0, 0 };
+    if (VK_SUCCESS != vkGetQueryPoolResults(m_CreateInfo.m_Device, m_QueryPool, frameIndex * 2, 2, sizeof(timestamps), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT)) {
+        return;
+    }
+    m_QueryWritten[frameIndex] = false;
+    m_LastTiming.m_GpuMs = ((timestamps[1] - timestamps[0]) & m_TimestampMask) * m_TimestampPeriod / 1000000.0;
+    PROFILE_COUNTER("SkinningGpuMs", m_LastTiming.m_GpuMs);
+}
+
+void VulkanSkinning::Destroy()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE == device) {
+        return;
+    }
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkDestroyQueryPool(device, m_QueryPool, GetVulkanAllocator());
+        m_QueryPool = VK_NULL_HANDLE;
+    }
+    m_QueryWritten.clear();
+    VkPipeline* pipelines[3] = { &m_SkinPipeline, &m_DrawPipeline, &m_ShadowPipeline };
+    for (VkPipeline* pipeline : pipelines) {
+        if (VK_NULL_HANDLE != *pipeline) {
+            vkDestroyPipeline(device, *pipeline, GetVulkanAllocator());
+            *pipeline = VK_NULL_HANDLE;
+        }
+    }
+    VkPipelineLayout* layouts[2] = { &m_SkinPipelineLayout, &m_DrawPipelineLayout };
+    for (VkPipelineLayout* layout : layouts) {
+        if (VK_NULL_HANDLE != *layout) {
+            vkDestroyPipelineLayout(device, *layout, GetVulkanAllocator());
+            *layout = VK_NULL_HANDLE;
+        }
+    }
+    if (VK_NULL_HANDLE != m_DescriptorPool) {
+        vkDestroyDescriptorPool(device, m_DescriptorPool, GetVulkanAllocator());
+        m_DescriptorPool = VK_NULL_HANDLE;
+        m_SkinSets.clear();
+        m_DrawSet = VK_NULL_HANDLE;
+    }
+    VkDescriptorSetLayout* setLayouts[2] = { &m_SkinSetLayout, &m_DrawSetLayout };
+    for (VkDescriptorSetLayout* setLayout : setLayouts) {
+        if (VK_NULL_HANDLE != *setLayout) {
+            vkDestroyDescriptorSetLayout(device, *setLayout, GetVulkanAllocator());
+            *setLayout = VK_NULL_HANDLE;
+        }
+    }
+    DestroyBuffer(device, m_SkinnedBuffer);
+    DestroyBuffer(device, m_IndexBuffer);
+    DestroyBuffer(device, m_RestBuffer);
+    m_SkinnedInstances = 0;
+    m_CreateInfo.m_Device = VK_NULL_HANDLE;
+}
+
+__END_NAMESPACE
@@ -0,0 +1,98 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+class VulkanSceneAttachments;
+class VulkanCascadedShadows;
+struct SkinnedMesh;
+struct FrameRingAllocation;
+
+
+typedef struct VulkanSkinningCreateInfo {
+	VkDevice             m_Device;
+	VkPhysicalDevice     m_PhysicalDevice;
+	VkPipelineCache      m_PipelineCache;
+	uint32_t             m_QueueFamilyIndex;          // Of the queue the skinning is recorded for, for timestamps
+	uint32_t             m_FramesInFlight = 1;        // Palette descriptors & timestamp slots, the skinned vertices are shared in submission order
+	uint32_t             m_MaxInstances = 4096;
+	uint32_t             m_JointCount;                // Palette matrices per instance
+	const SkinnedMesh*   m_Mesh;                      // Rest pose, copied at creation
+} VulkanSkinningCreateInfo;
+
+typedef struct SkinningTiming {
+	double               m_GpuMs;                     // Skinning dispatch alone, 0 without timestamp support
+} SkinningTiming;
+
+
+/**
+ * Skins instanced characters in a compute pre-pass: every instance's vertices are transformed by its joint
+ * palette once per frame into a device local buffer, which the scene pass & each shadow cascade then draw
+ * as plain instanced indexed geometry, the vertex shader fetching the skinned vertex of gl_VertexIndex.
+ *
+ * Palettes come from the host each frame, usually out of a VulkanFrameRing the animation evaluator writes
+ * straight into. A descriptor set per frame in flight points at that frame's palettes.
+ */
+class VulkanSkinning
+{
+public:
+	VulkanSkinning();
+	virtual ~VulkanSkinning();
+
+	bool Create(const VulkanSkinningCreateInfo& createInfo);
+	// For the driver's scene passes, with render pass objects or dynamic rendering. Shaded by procedural_scene.fs.spv.
+	bool CreateDrawPipeline(const VulkanSceneAttachments& sceneAttachments, VkRenderPass sceneRenderPass);
+	// Depth only, for the cascades' render pass.
+	bool CreateShadowPipeline(const VulkanCascadedShadows& cascadedShadows);
+	void Destroy();
+
+	// Record outside of a render pass, before any draw of the same frame. palette holds instanceCount * joint count matrices.
+	void RecordSkinning(VkCommandBuffer commandBuffer, uint32_t frameIndex, const FrameRingAllocation& palette, uint32_t instanceCount);
+	// Draw the instances skinned last, inside the pass the pipeline was created for, viewport & scissor are dynamic.
+	void RecordDraw(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection);
+	void RecordShadowDraw(VkCommandBuffer commandBuffer, const glm::mat4& viewProjection);
+	// Once the frame slot's fence signaled, reads back the GPU time of its skinning.
+	void CollectGpuTiming(uint32_t frameIndex);
+	const SkinningTiming& GetLastTiming() const { return m_LastTiming; }
+
+	uint32_t GetMaxInstances() const { return m_CreateInfo.m_MaxInstances; }
+	uint32_t GetVertexCount() const { return m_VertexCount; }
+	VkDeviceSize GetPaletteBytes(uint32_t instanceCount) const;
+	// Bytes of the rest pose, indices & skinned vertices.
+	VkDeviceSize GetMemoryBytes() const;
+
+private:
+	VulkanSkinningCreateInfo           m_CreateInfo;
+	uint32_t                           m_VertexCount;
+	uint32_t                           m_IndexCount;
+	uint32_t                           m_SkinnedInstances;  // Of the last RecordSkinning(), drawn by the passes after it
+
+	VulkanBuffer                       m_RestBuffer;
+	VulkanBuffer                       m_IndexBuffer;
+	VulkanBuffer                       m_SkinnedBuffer;
+
+	VkDescriptorSetLayout              m_SkinSetLayout;
+	VkDescriptorSetLayout              m_DrawSetLayout;
+	VkDescriptorPool                   m_DescriptorPool;
+	std::vector<VkDescriptorSet>       m_SkinSets;          // Per frame in flight, the palette binding is rewritten each frame
+	VkDescriptorSet                    m_DrawSet;
+	VkPipelineLayout                   m_SkinPipelineLayout;
+	VkPipelineLayout                   m_DrawPipelineLayout;
+	VkPipeline                         m_SkinPipeline;
+	VkPipeline                         m_DrawPipeline;
+	VkPipeline                         m_ShadowPipeline;
+
+	VkQueryPool                        m_QueryPool;
+	double                             m_TimestampPeriod;    // Nanoseconds per tick
+	uint64_t                           m_TimestampMask;
+	std::vector<bool>                  m_QueryWritten;
+	SkinningTiming                     m_LastTiming;
+
+	bool CreateDescriptors();
+	bool CreateGraphicsPipeline(VkGraphicsPipelineCreateInfo& pipelineInfo, bool depthOnly, VkPipeline& pipeline);
+	void RecordInstances(VkCommandBuffer commandBuffer, VkPipeline pipeline, const glm::mat4& viewProjection);
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,491 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "VulkanFrameRing.h"
+#include "VulkanTemporalUpscaler.h"
+
+
+__BEGIN_NAMESPACE
+
+static const VkFormat TEMPORAL_HISTORY_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+static const uint32_t TEMPORAL_GROUP_SIZE = 8;
+// Jitter positions at native resolution, times the output pixels per render pixel when upscaling so each
+// output pixel still gets a few samples of its own per cycle.
+static const uint32_t TEMPORAL_JITTER_PHASES = 8;
+
+enum TemporalBinding
+{
+    TemporalBinding_Color = 0,
+    TemporalBinding_Depth,
+    TemporalBinding_History,
+    TemporalBinding_Destination,
+    TemporalBinding_Constants,          // Dynamic uniform in the frame ring, the bindings before it are images
+    TemporalBinding_Count,
+};
+
+// Same layout as the TemporalConstants uniform block of temporal_upscale.shader.comp.
+typedef struct TemporalConstants {
+	glm::mat4            m_Reprojection;
+	glm::vec4            m_Jitter;        // xy: in render pixels, z: 1 drops the history
+	glm::vec4            m_RenderSize;    // xy: render extent, zw: its reciprocal
+	glm::vec4            m_OutputSize;    // xy: output extent, zw: its reciprocal
+} TemporalConstants;
+
+// Radical inverse of index in base, low discrepancy in both axes with bases 2 & 3.
+static float Halton(uint32_t index, uint32_t base)
+{
+    float fraction = 1.0f;
+    float result = 0.0f;
+    while (index > 0) {
+        fraction /= (float)base;
+        result += fraction * (float)(index % base);
+        index /= base;
+    }
+    return result;
+}
+
+
+VulkanTemporalUpscaler::VulkanTemporalUpscaler() :
+	m_CreateInfo{},
+	m_InputExtent({ 0, 0 }),
+	m_OutputExtent({ 0, 0 }),
+	m_HistoryIndex(0),
+	m_HistoryValid(false),
+	m_JitterIndex(0),
+	m_PreviousViewProjection(1.0f),
+	m_Sampler(VK_NULL_HANDLE),
+	m_PointSampler(VK_NULL_HANDLE),
+	m_DescriptorSetLayout(VK_NULL_HANDLE),
+	m_DescriptorPool(VK_NULL_HANDLE),
+	m_DescriptorSets{ VK_NULL_HANDLE, VK_NULL_HANDLE },
+	m_ConstantsGeneration(0),
+	m_PipelineLayout(VK_NULL_HANDLE),
+	m_Pipeline(VK_NULL_HANDLE),
+	m_QueryPool(VK_NULL_HANDLE),
+	m_TimestampPeriod(1.0),
+	m_TimestampMask(UINT64_MAX),
+	m_LastTiming({ 0.0 })
+{
+}
+
+VulkanTemporalUpscaler::~VulkanTemporalUpscaler()
+{
+}
+
+bool VulkanTemporalUpscaler::Create(const VulkanTemporalUpscalerCreateInfo& createInfo)
+{
+    if (nullptr == createInfo.m_FrameRing) {
+        std::cout << "Vulkan temporal upscaler needs a frame ring.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    m_CreateInfo = createInfo;
+    m_CreateInfo.m_FramesInFlight = std::max(m_CreateInfo.m_FramesInFlight, 1u);
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+
+    // The history is written by the resolve, sampled by the next one & blitted to the output.
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, TEMPORAL_HISTORY_FORMAT, &formatProperties);
+    VkFormatFeatureFlags historyFeatures = VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT;
+    if ((formatProperties.optimalTilingFeatures & historyFeatures) != historyFeatures) {
+        std::cout << "Vulkan temporal upscaler needs a storage, filterable & blittable history format.\n";
+        return false;
+    }
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+    if (vkCreateSampler(device, &samplerInfo, GetVulkanAllocator(), &m_Sampler) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create temporal upscaler sampler.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    // Depth formats aren't always linearly filterable.
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    if (vkCreateSampler(device, &samplerInfo, GetVulkanAllocator(), &m_PointSampler) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create temporal upscaler sampler.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    /****************************************************************************
+     * A descriptor set per history image written, the other one is read
+     ****************************************************************************/
+    VkDescriptorSetLayoutBinding bindings[TemporalBinding_Count]{};
+    for (uint32_t i = 0; i < TemporalBinding_Count; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = GetDescriptorType(i);
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = TemporalBinding_Count;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_DescriptorSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create temporal upscaler descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSizes[3]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = 2 * 3;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = 2;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[2].descriptorCount = 2;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 2;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(device, &poolInfo, GetVulkanAllocator(), &m_DescriptorPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create temporal upscaler descriptor pool.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorSetLayout setLayouts[2] = { m_DescriptorSetLayout, m_DescriptorSetLayout };
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 2;
+    allocInfo.pSetLayouts = setLayouts;
+    if (vkAllocateDescriptorSets(device, &allocInfo, m_DescriptorSets) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate temporal upscaler descriptor sets.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_DescriptorSetLayout;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_PipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create temporal upscaler pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    VULKAN_DRIVER_CHECK_FUN(CreatePipeline());
+
+    /****************************************************************************
+     * Timestamps around the resolve, two per frame in flight
+     ****************************************************************************/
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+    uint32_t validBits = (m_CreateInfo.m_QueueFamilyIndex < queueFamilyCount) ? queueFamilies[m_CreateInfo.m_QueueFamilyIndex].timestampValidBits : 0;
+
+    if (0 != validBits && deviceProperties.limits.timestampPeriod > 0.0f) {
+        m_TimestampPeriod = deviceProperties.limits.timestampPeriod;
+        m_TimestampMask = (validBits >= 64) ? UINT64_MAX : ((1ull << validBits) - 1);
+
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = m_CreateInfo.m_FramesInFlight * 2;
+        if (vkCreateQueryPool(device, &queryPoolInfo, GetVulkanAllocator(), &m_QueryPool) != VK_SUCCESS) {
+            m_QueryPool = VK_NULL_HANDLE;
+        }
+    }
+    m_QueryWritten.assign(m_CreateInfo.m_FramesInFlight, false);
+
+    std::cout << "Vulkan temporal upscaler created, " << (m_CreateInfo.m_DepthMotion ? "depth" : "no") << " motion vectors.\n";
+    return true;
+}
+
+bool VulkanTemporalUpscaler::CreatePipeline()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    VkShaderModule shaderModule = LoadShaderModule(device, "Data/Engine/temporal_upscale.cs.spv");
+    if (VK_NULL_HANDLE == shaderModule) {
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkBool32 depthMotion = m_CreateInfo.m_DepthMotion ? VK_TRUE : VK_FALSE;
+    VkSpecializationMapEntry specializationEntry = { 0, 0, sizeof(VkBool32) };
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = 1;
+    specializationInfo.pMapEntries = &specializationEntry;
+    specializationInfo.dataSize = sizeof(depthMotion);
+    specializationInfo.pData = &depthMotion;
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+    pipelineInfo.layout = m_PipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(device, m_CreateInfo.m_PipelineCache, 1, &pipelineInfo, GetVulkanAllocator(), &m_Pipeline);
+    vkDestroyShaderModule(device, shaderModule, GetVulkanAllocator());
+    if (VK_SUCCESS != result) {
+        m_Pipeline = VK_NULL_HANDLE;
+        std::cout << "Vulkan failed to create temporal upscaler pipeline.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanTemporalUpscaler::CreateTargets(VkExtent2D inputExtent, VkExtent2D outputExtent, VkImageView color, VkImageView depth)
+{
+    DestroyTargets();
+    VkDevice device = m_CreateInfo.m_Device;
+
+    for (VulkanImage& history : m_History) {
+        VULKAN_DRIVER_CHECK_FUN(CreateImage2D(device, m_CreateInfo.m_PhysicalDevice, outputExtent, TEMPORAL_HISTORY_FORMAT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, history));
+    }
+
+    // Without depth motion the binding is never read, the color stands in for it. The constants are written by Record().
+    for (uint32_t written = 0; written < 2; written++) {
+        VkDescriptorImageInfo imageInfos[TemporalBinding_Constants]{};
+        imageInfos[TemporalBinding_Color] = { m_PointSampler, color, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        imageInfos[TemporalBinding_Depth] = m_CreateInfo.m_DepthMotion ?
+            VkDescriptorImageInfo{ m_PointSampler, depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL } :
+            VkDescriptorImageInfo{ m_PointSampler, color, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        imageInfos[TemporalBinding_History] = { m_Sampler, m_History[1 - written].m_View, VK_IMAGE_LAYOUT_GENERAL };
+        imageInfos[TemporalBinding_Destination] = { VK_NULL_HANDLE, m_History[written].m_View, VK_IMAGE_LAYOUT_GENERAL };
+
+        VkWriteDescriptorSet writes[TemporalBinding_Constants]{};
+        for (uint32_t i = 0; i < TemporalBinding_Constants; i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = m_DescriptorSets[written];
+            writes[i].dstBinding = i;
+            writes[i].descriptorCount = 1;
+            writes[i].descriptorType = GetDescriptorType(i);
+            writes[i].pImageInfo = &imageInfos[i];
+        }
+        vkUpdateDescriptorSets(device, TemporalBinding_Constants, writes, 0, nullptr);
+    }
+
+    m_InputExtent = inputExtent;
+    m_OutputExtent = outputExtent;
+    m_HistoryIndex = 0;
+    ResetHistory();
+    return true;
+}
+
+void VulkanTemporalUpscaler::DestroyTargets()
+{
+    for (VulkanImage& history : m_History) {
+        DestroyImage(m_CreateInfo.m_Device, history);
+    }
+    m_InputExtent = { 0, 0 };
+    m_OutputExtent = { 0, 0 };
+    m_HistoryValid = false;
+}
+
+uint32_t VulkanTemporalUpscaler::GetJitterPhases(VkExtent2D renderExtent) const
+{
+    float upscale = (float)m_OutputExtent.width / (float)std::max(renderExtent.width, 1u);
+    return TEMPORAL_JITTER_PHASES * std::max((uint32_t)ceil(upscale * upscale - 0.01f), 1u);
+}
+
+glm::vec2 VulkanTemporalUpscaler::GetJitter(VkExtent2D renderExtent) const
+{
+    if (0 == m_OutputExtent.width) {
+        return glm::vec2(0.0f);
+    }
+    // Halton starts at 0 for index 0, skipped so no phase sits exactly on the pixel corner.
+    uint32_t index = (m_JitterIndex % GetJitterPhases(renderExtent)) + 1;
+    return glm::vec2(Halton(index, 2) - 0.5f, Halton(index, 3) - 0.5f);
+}
+
+glm::mat4 VulkanTemporalUpscaler::JitterProjection(const glm::mat4& projection, const glm::vec2& jitter, VkExtent2D renderExtent)
+{
+    // A translation in NDC after the projection, a render pixel being 2 / extent wide.
+    glm::mat4 offset(1.0f);
+    offset[3][0] = 2.0f * jitter.x / (float)std::max(renderExtent.width, 1u);
+    offset[3][1] = 2.0f * jitter.y / (float)std::max(renderExtent.height, 1u);
+    return offset * projection;
+}
+
+void VulkanTemporalUpscaler::Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, const TemporalUpscaleFrame& frame, VkImage outputImage,
+    VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    PROFILE_FUNCTION();
+    if (0 == m_OutputExtent.width || VK_NULL_HANDLE == m_Pipeline) {
+        return;
+    }
+
+    FrameRingAllocation allocation;
+    if (!m_CreateInfo.m_FrameRing->AllocateUniform(sizeof(TemporalConstants), allocation)) {
+        return;
+    }
+    WriteConstantsDescriptors();
+
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdResetQueryPool(commandBuffer, m_QueryPool, frameIndex * 2, 2);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, frameIndex * 2);
+    }
+
+    VkExtent2D renderExtent;
+    renderExtent.width = std::max(1u, std::min(frame.m_RenderExtent.width, m_InputExtent.width));
+    renderExtent.height = std::max(1u, std::min(frame.m_RenderExtent.height, m_InputExtent.height));
+    glm::vec2 jitter = GetJitter(renderExtent);
+
+    TemporalConstants* constants = static_cast<TemporalConstants*>(allocation.m_Mapped);
+    constants->m_Reprojection = m_HistoryValid ? m_PreviousViewProjection * glm::inverse(frame.m_ViewProjection) : glm::mat4(1.0f);
+    constants->m_Jitter = glm::vec4(jitter, m_HistoryValid ? 0.0f : 1.0f, 0.0f);
+    constants->m_RenderSize = glm::vec4((float)renderExtent.width, (float)renderExtent.height, 1.0f / renderExtent.width, 1.0f / renderExtent.height);
+    constants->m_OutputSize = glm::vec4((float)m_OutputExtent.width, (float)m_OutputExtent.height, 1.0f / m_OutputExtent.width, 1.0f / m_OutputExtent.height);
+    uint32_t constantsOffset = (uint32_t)allocation.m_Offset;
+
+    // The written history is overwritten whole, only the previous frame's reads & blit of it must be done. Without
+    // a history the other one is never sampled, it only needs the layout its descriptor names.
+    const VulkanImage& written = m_History[m_HistoryIndex];
+    CmdImageBarrier(commandBuffer, written.m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    if (!m_HistoryValid) {
+        CmdImageBarrier(commandBuffer, m_History[1 - m_HistoryIndex].m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_DescriptorSets[m_HistoryIndex], 1, &constantsOffset);
+    vkCmdDispatch(commandBuffer, (m_OutputExtent.width + TEMPORAL_GROUP_SIZE - 1) / TEMPORAL_GROUP_SIZE,
+        (m_OutputExtent.height + TEMPORAL_GROUP_SIZE - 1) / TEMPORAL_GROUP_SIZE, 1);
+
+    // Blitted now & sampled as the history by the next frame, it stays in GENERAL.
+    CmdImageBarrier(commandBuffer, written.m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_GENERAL,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+
+    // After an acquire semaphore wait at the color output stage or a previous copy of the output.
+    CmdImageBarrier(commandBuffer, outputImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    // Same size, the blit only converts the format.
+    VkImageBlit region{};
+    region.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.srcOffsets[1] = { (int32_t)m_OutputExtent.width, (int32_t)m_OutputExtent.height, 1 };
+    region.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    region.dstOffsets[1] = { (int32_t)m_OutputExtent.width, (int32_t)m_OutputExtent.height, 1 };
+    vkCmdBlitImage(commandBuffer, written.m_Image, VK_IMAGE_LAYOUT_GENERAL, outputImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region, VK_FILTER_NEAREST);
+
+    CmdImageBarrier(commandBuffer, outputImage, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, dstStage, dstAccess);
+
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, frameIndex * 2 + 1);
+        m_QueryWritten[frameIndex] = true;
+    }
+
+    m_PreviousViewProjection = frame.m_ViewProjection;
+    m_HistoryIndex = 1 - m_HistoryIndex;
+    m_HistoryValid = true;
+    m_JitterIndex++;
+}
+
+VkDescriptorType VulkanTemporalUpscaler::GetDescriptorType(uint32_t binding)
+{
+    switch (binding) {
+    case TemporalBinding_Destination:
+        return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    case TemporalBinding_Constants:
+        return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    default:
+        return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    }
+}
+
+void VulkanTemporalUpscaler::WriteConstantsDescriptors()
+{
+    // Only when the ring was created again, between frames.
+    if (m_CreateInfo.m_FrameRing->GetGeneration() == m_ConstantsGeneration) {
+        return;
+    }
+    VkDescriptorBufferInfo bufferInfo = { m_CreateInfo.m_FrameRing->GetBuffer(), 0, sizeof(TemporalConstants) };
+    VkWriteDescriptorSet writes[2]{};
+    for (uint32_t i = 0; i < 2; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_DescriptorSets[i];
+        writes[i].dstBinding = TemporalBinding_Constants;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+        writes[i].pBufferInfo = &bufferInfo;
+    }
+    vkUpdateDescriptorSets(m_CreateInfo.m_Device, 2, writes, 0, nullptr);
+    m_ConstantsGeneration = m_CreateInfo.m_FrameRing->GetGeneration();
+}
+
+void VulkanTemporalUpscaler::CollectGpuTiming(uint32_t frameIndex)
+{
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    if (VK_NULL_HANDLE == m_QueryPool || !m_QueryWritten[frameIndex]) {
+        return;
+    }
+
+    uint64_t timestamps[2] = { 0, 0 };
+    if (VK_SUCCESS != vkGetQueryPoolResults(m_CreateInfo.m_Device, m_QueryPool, frameIndex * 2, 2, sizeof(timestamps), timestamps,
+        sizeof(uint64_t), VK_QUERY_RESULT_64_BIT)) {
+        return;
+    }
+    m_QueryWritten[frameIndex] = false;
+    m_LastTiming.m_GpuMs = ((timestamps[1] - timestamps[0]) & m_TimestampMask) * m_TimestampPeriod / 1000000.0;
+    PROFILE_COUNTER("TemporalUpscaleGpuMs", m_LastTiming.m_GpuMs);
+}
+
+void VulkanTemporalUpscaler::Destroy()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE == device) {
+        return;
+    }
+
+    DestroyTargets();
+    if (VK_NULL_HANDLE != m_QueryPool) {
+        vkDestroyQueryPool(device, m_QueryPool, GetVulkanAllocator());
+        m_QueryPool = VK_NULL_HANDLE;
+    }
+    m_QueryWritten.clear();
+    if (VK_NULL_HANDLE != m_Pipeline) {
+        vkDestroyPipeline(device, m_Pipeline, GetVulkanAllocator());
+        m_Pipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_PipelineLayout) {
+        vkDestroyPipelineLayout(device, m_PipelineLayout, GetVulkanAllocator());
+        m_PipelineLayout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorPool) {
+        vkDestroyDescriptorPool(device, m_DescriptorPool, GetVulkanAllocator());
+        m_DescriptorPool = VK_NULL_HANDLE;
+        m_DescriptorSets[0] = VK_NULL_HANDLE;
+        m_DescriptorSets[1] = VK_NULL_HANDLE;
+        m_ConstantsGeneration = 0;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorSetLayout) {
+        vkDestroyDescriptorSetLayout(device, m_DescriptorSetLayout, GetVulkanAllocator());
+        m_DescriptorSetLayout = VK_NULL_HANDLE;
+    }
+    VkSampler* samplers[2] = { &m_Sampler, &m_PointSampler };
+    for (VkSampler* sampler : samplers) {
+        if (VK_NULL_HANDLE != *sampler) {
+            vkDestroySampler(device, *sampler, GetVulkanAllocator());
+            *sampler = VK_NULL_HANDLE;
+        }
+    }
+    m_CreateInfo.m_Device = VK_NULL_HANDLE;
+}
+
+__END_NAMESPACE
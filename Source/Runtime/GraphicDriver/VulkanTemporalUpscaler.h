@@ -0,0 +1,102 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+class VulkanFrameRing;
+
+
+typedef struct VulkanTemporalUpscalerCreateInfo {
+	VkDevice             m_Device;
+	VkPhysicalDevice     m_PhysicalDevice;
+	VkPipelineCache      m_PipelineCache;
+	VulkanFrameRing*     m_FrameRing = nullptr;     // Each frame's constants, outlives the upscaler
+	uint32_t             m_QueueFamilyIndex;        // Of the queue the resolve is recorded for, for timestamps
+	uint32_t             m_FramesInFlight = 1;      // Timestamp slots, the history itself is shared in submission order
+	bool                 m_DepthMotion = true;      // Motion vectors from the scene depth & camera, false treats the camera as static
+} VulkanTemporalUpscalerCreateInfo;
+
+typedef struct TemporalUpscaleFrame {
+	VkExtent2D           m_RenderExtent;         // Scene area at the top left of the inputs, at most their size
+	glm::mat4            m_ViewProjection;       // Unjittered, reprojected with the previous frame's one
+} TemporalUpscaleFrame;
+
+typedef struct TemporalUpscalerTiming {
+	double               m_GpuMs;                // Resolve & output blit, 0 without timestamp support
+} TemporalUpscalerTiming;
+
+
+/**
+ * Temporal anti-aliasing, resolving a scene rendered with a sub-pixel jitter into a history at the output
+ * resolution. With a render area smaller than the output it's a temporal upscaler: each frame's samples land
+ * on different output pixels & the history gathers them over the jitter sequence.
+ *
+ * Each frame the history is reprojected with motion vectors derived from the scene depth & the camera change,
+ * sampled with a Catmull-Rom filter, and clipped to the variance box of the current samples around the pixel
+ * in YCoCg, which rejects what's been disoccluded or changed. The resolved frame becomes the next history &
+ * is blitted to the output image.
+ */
+class VulkanTemporalUpscaler
+{
+public:
+	VulkanTemporalUpscaler();
+	virtual ~VulkanTemporalUpscaler();
+
+	bool Create(const VulkanTemporalUpscalerCreateInfo& createInfo);
+	// History images for outputExtent & the descriptor sets over them. color is sampled in SHADER_READ_ONLY_OPTIMAL,
+	// depth in DEPTH_STENCIL_READ_ONLY_OPTIMAL & ignored without depth motion, both inputExtent large. Resets the history.
+	bool CreateTargets(VkExtent2D inputExtent, VkExtent2D outputExtent, VkImageView color, VkImageView depth);
+	void DestroyTargets();
+	void Destroy();
+
+	// Offset of the next frame's samples in render pixels, the scene is drawn with JitterProjection() or a viewport moved by it.
+	glm::vec2 GetJitter(VkExtent2D renderExtent) const;
+	static glm::mat4 JitterProjection(const glm::mat4& projection, const glm::vec2& jitter, VkExtent2D renderExtent);
+	// The next frame starts over from its own samples & the jitter sequence from its start, e.g. after a camera cut.
+	void ResetHistory() { m_HistoryValid = false; m_JitterIndex = 0; }
+
+	// Record outside of a render pass, once the inputs are readable by the compute stage. outputImage, outputExtent
+	// large, is overwritten & left in finalLayout for dstStage & dstAccess. Advances the jitter sequence. The constants
+	// are taken from the frame ring, nothing is recorded when it's full.
+	void Record(VkCommandBuffer commandBuffer, uint32_t frameIndex, const TemporalUpscaleFrame& frame, VkImage outputImage,
+		VkImageLayout finalLayout, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+	// Once the frame slot's fence signaled, reads back the GPU time of its resolve.
+	void CollectGpuTiming(uint32_t frameIndex);
+	const TemporalUpscalerTiming& GetLastTiming() const { return m_LastTiming; }
+	VkExtent2D GetOutputExtent() const { return m_OutputExtent; }
+
+private:
+	VulkanTemporalUpscalerCreateInfo   m_CreateInfo;
+	VkExtent2D                         m_InputExtent;
+	VkExtent2D                         m_OutputExtent;
+	VulkanImage                        m_History[2];         // Ping-pong, one read while the other is written
+	uint32_t                           m_HistoryIndex;       // Written by the next frame
+	bool                               m_HistoryValid;
+	uint32_t                           m_JitterIndex;
+	glm::mat4                          m_PreviousViewProjection;
+
+	VkSampler                          m_Sampler;            // Bilinear, for the history
+	VkSampler                          m_PointSampler;       // The inputs are only fetched
+	VkDescriptorSetLayout              m_DescriptorSetLayout;
+	VkDescriptorPool                   m_DescriptorPool;
+	VkDescriptorSet                    m_DescriptorSets[2];  // By the history written
+	uint32_t                           m_ConstantsGeneration; // Of the frame ring the sets' constants point into
+	VkPipelineLayout                   m_PipelineLayout;
+	VkPipeline                         m_Pipeline;
+
+	VkQueryPool                        m_QueryPool;
+	double                             m_TimestampPeriod;    // Nanoseconds per tick
+	uint64_t                           m_TimestampMask;
+	std::vector<bool>                  m_QueryWritten;
+	TemporalUpscalerTiming             m_LastTiming;
+
+	bool CreatePipeline();
+	static VkDescriptorType GetDescriptorType(uint32_t binding);
+	// With the frame ring's current buffer.
+	void WriteConstantsDescriptors();
+	uint32_t GetJitterPhases(VkExtent2D renderExtent) const;
+};
+
+
+__END_NAMESPACE
@@ -0,0 +1,292 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+
+
+__BEGIN_NAMESPACE
+
+int ReadFile(const std::string& filename, std::vector<char>& output)
+{
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open()) {
+        std::cout << "failed to open file!\n";
+        return -1;
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    output.resize(fileSize);
+    file.seekg(0);
+    file.read(output.data(), fileSize);
+    file.close();
+    return 0;
+}
+
+std::string CurExePath()
+{
+    char buffer[MAX_PATH];
+    ::GetModuleFileName(NULL, buffer, MAX_PATH);
+    std::string::size_type pos = std::string(buffer).find_last_of("\\/");
+    return std::string(buffer).substr(0, pos);
+}
+
+VkShaderModule CreateShaderModule(const VkDevice& device, const std::vector<char>& code)
+{
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &createInfo, GetVulkanAllocator(), &shaderModule) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create shader module.\n";
+        return VK_NULL_HANDLE;
+    }
+
+    return shaderModule;
+}
+
+VkShaderModule LoadShaderModule(const VkDevice& device, const std::string& relativePath)
+{
+    std::vector<char> shaderCode;
+    if (0 != ReadFile(CurExePath() + "/../" + relativePath, shaderCode) || shaderCode.empty()) {
+        std::cout << "Vulkan missing shader binary " << relativePath << ".\n";
+        return VK_NULL_HANDLE;
+    }
+    return CreateShaderModule(device, shaderCode);
+}
+
+uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
+{
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    return UINT32_MAX;
+}
+
+bool CreateBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VulkanBuffer& buffer)
+{
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, GetVulkanAllocator(), &buffer.m_Buffer) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create buffer.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer.m_Buffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+    if (UINT32_MAX == allocInfo.memoryTypeIndex ||
+        vkAllocateMemory(device, &allocInfo, GetVulkanAllocator(), &buffer.m_Memory) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate buffer memory.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        DestroyBuffer(device, buffer);
+        return false;
+    }
+
+    vkBindBufferMemory(device, buffer.m_Buffer, buffer.m_Memory, 0);
+    buffer.m_Size = size;
+
+    if (properties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        vkMapMemory(device, buffer.m_Memory, 0, size, 0, &buffer.m_Mapped);
+    }
+    return true;
+}
+
+bool UploadBuffer(VkDevice device, VkPhysicalDevice physicalDevice, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VulkanBuffer& buffer)
+{
+    if (!CreateBuffer(device, physicalDevice, size, usage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer)) {
+        return false;
+    }
+    memcpy(buffer.m_Mapped, data, (size_t)size);
+    return true;
+}
+
+void DestroyBuffer(VkDevice device, VulkanBuffer& buffer)
+{
+    if (nullptr != buffer.m_Mapped) {
+        vkUnmapMemory(device, buffer.m_Memory);
+        buffer.m_Mapped = nullptr;
+    }
+    if (VK_NULL_HANDLE != buffer.m_Buffer) {
+        vkDestroyBuffer(device, buffer.m_Buffer, GetVulkanAllocator());
+        buffer.m_Buffer = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != buffer.m_Memory) {
+        vkFreeMemory(device, buffer.m_Memory, GetVulkanAllocator());
+        buffer.m_Memory = VK_NULL_HANDLE;
+    }
+    buffer.m_Size = 0;
+}
+
+static bool CreateImage(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent, uint32_t mipLevels, uint32_t layers, VkImageViewType viewType,
+    VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkMemoryPropertyFlags properties, VulkanImage& image, VkSampleCountFlagBits samples)
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = { extent.width, extent.height, 1 };
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = layers;
+    imageInfo.samples = samples;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(device, &imageInfo, GetVulkanAllocator(), &image.m_Image) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create image.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image.m_Image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+    // Lazily allocated memory is only a hint, an image whose requirements exclude it takes the same flags without it.
+    if (UINT32_MAX == allocInfo.memoryTypeIndex && (properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)) {
+        allocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties & ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+    }
+    if (UINT32_MAX == allocInfo.memoryTypeIndex ||
+        vkAllocateMemory(device, &allocInfo, GetVulkanAllocator(), &image.m_Memory) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate image memory.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        DestroyImage(device, image);
+        return false;
+    }
+    vkBindImageMemory(device, image.m_Image, image.m_Memory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image.m_Image;
+    viewInfo.viewType = viewType;
+    viewInfo.format = format;
+    viewInfo.subresourceRange.aspectMask = aspect;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = mipLevels;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = layers;
+    if (vkCreateImageView(device, &viewInfo, GetVulkanAllocator(), &image.m_View) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create image view.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        DestroyImage(device, image);
+        return false;
+    }
+
+    image.m_Format = format;
+    image.m_Extent = extent;
+    return true;
+}
+
+bool CreateImage2D(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
+    VkImageAspectFlags aspect, VkMemoryPropertyFlags properties, VulkanImage& image, VkSampleCountFlagBits samples)
+{
+    return CreateImage(device, physicalDevice, extent, 1, 1, VK_IMAGE_VIEW_TYPE_2D, format, usage, aspect, properties, image, samples);
+}
+
+bool CreateImage2DMips(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage,
+    VkImageAspectFlags aspect, VkMemoryPropertyFlags properties, VulkanImage& image)
+{
+    return CreateImage(device, physicalDevice, extent, mipLevels, 1, VK_IMAGE_VIEW_TYPE_2D, format, usage, aspect, properties, image, VK_SAMPLE_COUNT_1_BIT);
+}
+
+bool CreateImage2DArray(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent, uint32_t layers, VkFormat format, VkImageUsageFlags usage,
+    VkImageAspectFlags aspect, VkMemoryPropertyFlags properties, VulkanImage& image)
+{
+    return CreateImage(device, physicalDevice, extent, 1, layers, VK_IMAGE_VIEW_TYPE_2D_ARRAY, format, usage, aspect, properties, image, VK_SAMPLE_COUNT_1_BIT);
+}
+
+void DestroyImage(VkDevice device, VulkanImage& image)
+{
+    if (VK_NULL_HANDLE != image.m_View) {
+        vkDestroyImageView(device, image.m_View, GetVulkanAllocator());
+        image.m_View = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != image.m_Image) {
+        vkDestroyImage(device, image.m_Image, GetVulkanAllocator());
+        image.m_Image = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != image.m_Memory) {
+        vkFreeMemory(device, image.m_Memory, GetVulkanAllocator());
+        image.m_Memory = VK_NULL_HANDLE;
+    }
+    image.m_Extent = { 0, 0 };
+}
+
+void CmdImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect,
+    VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = aspect;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+uint32_t GetFormatSize(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_D16_UNORM:
+        return 2;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+    case VK_FORMAT_R16G16_SFLOAT:
+    case VK_FORMAT_R32_SFLOAT:
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+        return 4;
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return 5;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return 8;
+    default:
+        return 0;
+    }
+}
+
+bool HasDeviceExtension(const std::vector<VkExtensionProperties>& availableExtensions, const char* extensionName)
+{
+    for (const auto& extension : availableExtensions) {
+        if (strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+__END_NAMESPACE
@@ -0,0 +1,65 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+#define VULKAN_DRIVER_CHECK_FUN(fun) {bool ok = fun; \
+if (!ok) { \
+    return false; \
+}}
+
+
+typedef struct VulkanBuffer {
+	VkBuffer          m_Buffer = VK_NULL_HANDLE;
+	VkDeviceMemory    m_Memory = VK_NULL_HANDLE;
+	VkDeviceSize      m_Size = 0;
+	void*             m_Mapped = nullptr;   // Persistently mapped pointer for host visible buffers.
+} VulkanBuffer;
+
+typedef struct VulkanImage {
+	VkImage           m_Image = VK_NULL_HANDLE;
+	VkDeviceMemory    m_Memory = VK_NULL_HANDLE;
+	VkImageView       m_View = VK_NULL_HANDLE;
+	VkFormat          m_Format = VK_FORMAT_UNDEFINED;
+	VkExtent2D        m_Extent = { 0, 0 };
+} VulkanImage;
+
+// First order attachment traffic of one frame, each attachment counted once per write & per read, overdraw ignored.
+typedef struct AttachmentBandwidth {
+	VkDeviceSize      m_MemoryBytes = 0;    // Loads & stores a tiler makes to memory
+	VkDeviceSize      m_OnChipBytes = 0;    // Transient attachment traffic a tiler keeps in tile memory, an immediate mode GPU doesn't
+} AttachmentBandwidth;
+
+
+int ReadFile(const std::string& filename, std::vector<char>& output);
+std::string CurExePath();
+VkShaderModule CreateShaderModule(const VkDevice& device, const std::vector<char>& code);
+VkShaderModule LoadShaderModule(const VkDevice& device, const std::string& relativePath);
+
+uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
+bool CreateBuffer(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VulkanBuffer& buffer);
+bool UploadBuffer(VkDevice device, VkPhysicalDevice physicalDevice, const void* data, VkDeviceSize size, VkBufferUsageFlags usage, VulkanBuffer& buffer);
+void DestroyBuffer(VkDevice device, VulkanBuffer& buffer);
+
+// Single mip, single layer 2D image with a view over aspect.
+bool CreateImage2D(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent, VkFormat format, VkImageUsageFlags usage,
+	VkImageAspectFlags aspect, VkMemoryPropertyFlags properties, VulkanImage& image, VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT);
+// Single layer 2D image of mipLevels levels with a view over all of them, their contents are left to the caller.
+bool CreateImage2DMips(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage,
+	VkImageAspectFlags aspect, VkMemoryPropertyFlags properties, VulkanImage& image);
+// Single mip 2D image of layers layers with a 2D array view over all of them.
+bool CreateImage2DArray(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D extent, uint32_t layers, VkFormat format, VkImageUsageFlags usage,
+	VkImageAspectFlags aspect, VkMemoryPropertyFlags properties, VulkanImage& image);
+void DestroyImage(VkDevice device, VulkanImage& image);
+void CmdImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect,
+	VkImageLayout oldLayout, VkImageLayout newLayout, VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+	VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+// Bytes per texel of the color & depth formats the engine renders to, 0 for others.
+uint32_t GetFormatSize(VkFormat format);
+
+bool HasDeviceExtension(const std::vector<VkExtensionProperties>& availableExtensions, const char* extensionName);
+
+
+__END_NAMESPACE
@@ -0,0 +1,849 @@
+#include "VulkanAllocator.h"
+#include "VulkanUtility.h"
+#include "StreamingIO.h"
+#include "VirtualTexture.h"
+#include "VulkanVirtualTexture.h"
+
+
+__BEGIN_NAMESPACE
+
+static const VkFormat VIRTUAL_TEXTURE_CACHE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+// Entries of slot x, slot y, mip of the page mapped & resident flag, the slot indices fit 8 bits up to MAX_CACHE_SLOTS.
+static const VkFormat VIRTUAL_TEXTURE_PAGE_TABLE_FORMAT = VK_FORMAT_R8G8B8A8_UINT;
+static const uint32_t VIRTUAL_TEXTURE_FEEDBACK_GROUP_SIZE = 8;
+
+enum VirtualTextureBinding
+{
+    VirtualTextureBinding_Params = 0,
+    VirtualTextureBinding_PageTable,
+    VirtualTextureBinding_Cache,
+    VirtualTextureBinding_Count,
+};
+
+// Same layout as VirtualTextureParams of virtual_texture_common.glsl.
+typedef struct VirtualTextureParams {
+	glm::vec4            m_Pages;            // xy: pages a side of mip 0, z: mips, w: lod bias of the feedback pass
+	glm::vec4            m_Cache;            // xy: 1 / cache texels, z: page payload, w: page border
+	glm::uvec4           m_TextureSet;       // x: textures a row, y: textures, z: texels a side of a texture, w: texels a side of a page
+} VirtualTextureParams;
+
+// Same layout as the FeedbackConstants push constants of virtual_texture_feedback.shader.comp.
+typedef struct FeedbackConstants {
+	uint32_t             m_Width;
+	uint32_t             m_Height;
+	uint32_t             m_PageCount;
+} FeedbackConstants;
+
+
+VulkanVirtualTexture::VulkanVirtualTexture() :
+	m_CreateInfo{},
+	m_Header{},
+	m_File(STREAMING_INVALID_FILE),
+	m_PageCount(0),
+	m_Frame(0),
+	m_Stats({ 0, 0, 0, 0, 0 }),
+	m_CacheExtent({ 0, 0 }),
+	m_CacheInitialized(false),
+	m_Sparse(false),
+	m_SparseRowBytes(0),
+	m_SparseMemoryType(UINT32_MAX),
+	m_SparseRowsPending(0),
+	m_SparseSemaphore(VK_NULL_HANDLE),
+	m_PageTableDirty(true),
+	m_FeedbackExtent({ 0, 0 }),
+	m_PageTableSampler(VK_NULL_HANDLE),
+	m_CacheSampler(VK_NULL_HANDLE),
+	m_DescriptorSetLayout(VK_NULL_HANDLE),
+	m_FeedbackSetLayout(VK_NULL_HANDLE),
+	m_DescriptorPool(VK_NULL_HANDLE),
+	m_DescriptorSet(VK_NULL_HANDLE),
+	m_FeedbackPipelineLayout(VK_NULL_HANDLE),
+	m_FeedbackPipeline(VK_NULL_HANDLE)
+{
+}
+
+VulkanVirtualTexture::~VulkanVirtualTexture()
+{
+}
+
+bool VulkanVirtualTexture::Create(const VulkanVirtualTextureCreateInfo& createInfo)
+{
+    m_CreateInfo = createInfo;
+    m_CreateInfo.m_FramesInFlight = std::max(m_CreateInfo.m_FramesInFlight, 1u);
+    m_CreateInfo.m_CacheSlots = std::max(1u, std::min(m_CreateInfo.m_CacheSlots, MAX_CACHE_SLOTS));
+    if (m_CreateInfo.m_CacheSlots > CACHE_SLOTS_PER_ROW) {
+        m_CreateInfo.m_CacheSlots = (m_CreateInfo.m_CacheSlots + CACHE_SLOTS_PER_ROW - 1) / CACHE_SLOTS_PER_ROW * CACHE_SLOTS_PER_ROW;
+    }
+    m_CreateInfo.m_StagingPages = std::max(m_CreateInfo.m_StagingPages, 1u);
+    m_CreateInfo.m_MaxUploadsPerFrame = std::max(m_CreateInfo.m_MaxUploadsPerFrame, 1u);
+    m_CreateInfo.m_FeedbackDivisor = std::max(m_CreateInfo.m_FeedbackDivisor, 1u);
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+    uint32_t framesInFlight = m_CreateInfo.m_FramesInFlight;
+
+    if (nullptr == m_CreateInfo.m_Streaming || !ReadVirtualTextureHeader(m_CreateInfo.m_Path, m_Header)) {
+        std::cout << "Vulkan failed to open virtual texture " << m_CreateInfo.m_Path << ".\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    m_File = m_CreateInfo.m_Streaming->OpenFile(m_CreateInfo.m_Path);
+    if (STREAMING_INVALID_FILE == m_File) {
+        std::cout << "Vulkan failed to open virtual texture " << m_CreateInfo.m_Path << " for streaming.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    m_PageCount = GetVirtualTexturePageCount(m_Header);
+    m_Cache.Create(m_CreateInfo.m_CacheSlots);
+    m_Frame = 0;
+    m_Stats = { 0, 0, 0, 0, 0 };
+
+    /****************************************************************************
+     * Staging the streaming workers read into, a page each
+     ****************************************************************************/
+    VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, (VkDeviceSize)m_CreateInfo.m_StagingPages * VIRTUAL_TEXTURE_PAGE_BYTES,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_StagingBuffer));
+    StagingPage freePage = { UINT32_MAX, UINT32_MAX, 0, STAGING_FREE };
+    m_StagingPages.assign(m_CreateInfo.m_StagingPages, freePage);
+    m_FreeStaging.clear();
+    for (uint32_t i = m_CreateInfo.m_StagingPages; i > 0; i--) {
+        m_FreeStaging.push_back(i - 1);
+    }
+    m_ReadyStaging.clear();
+
+    /****************************************************************************
+     * Physical cache & page table, every page missing until the first upload
+     ****************************************************************************/
+    VULKAN_DRIVER_CHECK_FUN(CreateCache());
+    VULKAN_DRIVER_CHECK_FUN(CreateImage2DMips(device, physicalDevice, { m_Header.m_PagesPerSide, m_Header.m_PagesPerSide }, m_Header.m_MipCount,
+        VIRTUAL_TEXTURE_PAGE_TABLE_FORMAT, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_PageTableImage));
+    m_PageTable.assign(m_PageCount, 0);
+    m_PageTableDirty = true;
+
+    m_PageTableStaging.resize(framesInFlight);
+    m_RequestBuffers.resize(framesInFlight);
+    VkDeviceSize requestBytes = (VkDeviceSize)((m_PageCount + 31) / 32) * sizeof(uint32_t);
+    for (uint32_t i = 0; i < framesInFlight; i++) {
+        VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, (VkDeviceSize)m_PageCount * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_PageTableStaging[i]));
+        VULKAN_DRIVER_CHECK_FUN(CreateBuffer(device, physicalDevice, requestBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_RequestBuffers[i]));
+        memset(m_RequestBuffers[i].m_Mapped, 0, (size_t)requestBytes);
+    }
+    m_FeedbackWritten.assign(framesInFlight, false);
+
+    VirtualTextureParams params;
+    params.m_Pages = glm::vec4((float)m_Header.m_PagesPerSide, (float)m_Header.m_PagesPerSide, (float)m_Header.m_MipCount,
+        -log2((float)m_CreateInfo.m_FeedbackDivisor));
+    params.m_Cache = glm::vec4(1.0f / (float)m_CacheExtent.width, 1.0f / (float)m_CacheExtent.height, (float)VIRTUAL_TEXTURE_PAGE_PAYLOAD,
+        (float)VIRTUAL_TEXTURE_PAGE_BORDER);
+    params.m_TextureSet = glm::uvec4(m_Header.m_TextureColumns, m_Header.m_TextureCount, m_Header.m_TextureSize, VIRTUAL_TEXTURE_PAGE_SIZE);
+    VULKAN_DRIVER_CHECK_FUN(UploadBuffer(device, physicalDevice, &params, sizeof(params), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, m_ParamsBuffer));
+
+    VULKAN_DRIVER_CHECK_FUN(CreateDescriptors());
+    VULKAN_DRIVER_CHECK_FUN(CreatePipeline());
+
+    std::cout << "Vulkan virtual texture created, " << m_Header.m_TextureCount << " textures of " << m_Header.m_TextureSize << " texels, "
+        << m_PageCount << " pages over " << m_Header.m_MipCount << " mips, cache of " << m_CreateInfo.m_CacheSlots << " pages ("
+        << (((VkDeviceSize)m_CreateInfo.m_CacheSlots * VIRTUAL_TEXTURE_PAGE_BYTES) >> 20) << " MB), " << (m_Sparse ? "sparse" : "committed") << ".\n";
+    return true;
+}
+
+bool VulkanVirtualTexture::CreateCache()
+{
+    uint32_t slotsPerRow = std::min(m_CreateInfo.m_CacheSlots, CACHE_SLOTS_PER_ROW);
+    m_CacheExtent.width = slotsPerRow * VIRTUAL_TEXTURE_PAGE_SIZE;
+    m_CacheExtent.height = (m_CreateInfo.m_CacheSlots / slotsPerRow) * VIRTUAL_TEXTURE_PAGE_SIZE;
+    m_CacheInitialized = false;
+    m_SparseRowsPending = 0;
+
+    m_Sparse = m_CreateInfo.m_SparseResidency && CreateSparseCache();
+    if (m_Sparse) {
+        return true;
+    }
+    return CreateImage2D(m_CreateInfo.m_Device, m_CreateInfo.m_PhysicalDevice, m_CacheExtent, VIRTUAL_TEXTURE_CACHE_FORMAT,
+        VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_ASPECT_COLOR_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_CacheImage);
+}
+
+bool VulkanVirtualTexture::CreateSparseCache()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPhysicalDevice physicalDevice = m_CreateInfo.m_PhysicalDevice;
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    // A page must be exactly one sparse block, so a slot's memory binds on its own.
+    uint32_t propertyCount = 0;
+    vkGetPhysicalDeviceSparseImageFormatProperties(physicalDevice, VIRTUAL_TEXTURE_CACHE_FORMAT, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT, usage,
+        VK_IMAGE_TILING_OPTIMAL, &propertyCount, nullptr);
+    std::vector<VkSparseImageFormatProperties> formatProperties(propertyCount);
+    vkGetPhysicalDeviceSparseImageFormatProperties(physicalDevice, VIRTUAL_TEXTURE_CACHE_FORMAT, VK_IMAGE_TYPE_2D, VK_SAMPLE_COUNT_1_BIT, usage,
+        VK_IMAGE_TILING_OPTIMAL, &propertyCount, formatProperties.data());
+    bool pageBlocks = false;
+    for (const VkSparseImageFormatProperties& properties : formatProperties) {
+        pageBlocks = pageBlocks || (0 != (properties.aspectMask & VK_IMAGE_ASPECT_COLOR_BIT) &&
+            VIRTUAL_TEXTURE_PAGE_SIZE == properties.imageGranularity.width && VIRTUAL_TEXTURE_PAGE_SIZE == properties.imageGranularity.height);
+    }
+    if (!pageBlocks) {
+        std::cout << "Vulkan virtual texture cache falls back to committed memory, the sparse blocks aren't pages.\n";
+        return false;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.flags = VK_IMAGE_CREATE_SPARSE_BINDING_BIT | VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VIRTUAL_TEXTURE_CACHE_FORMAT;
+    imageInfo.extent = { m_CacheExtent.width, m_CacheExtent.height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImage image = VK_NULL_HANDLE;
+    if (vkCreateImage(device, &imageInfo, GetVulkanAllocator(), &image) != VK_SUCCESS) {
+        std::cout << "Vulkan virtual texture cache falls back to committed memory, the sparse image failed.\n";
+        return false;
+    }
+
+    // Without a metadata aspect or a mip tail, the rows of slots are all there is to bind.
+    VkMemoryRequirements memoryRequirements;
+    vkGetImageMemoryRequirements(device, image, &memoryRequirements);
+    uint32_t requirementCount = 0;
+    vkGetImageSparseMemoryRequirements(device, image, &requirementCount, nullptr);
+    std::vector<VkSparseImageMemoryRequirements> sparseRequirements(requirementCount);
+    vkGetImageSparseMemoryRequirements(device, image, &requirementCount, sparseRequirements.data());
+    bool usable = (VIRTUAL_TEXTURE_PAGE_BYTES == memoryRequirements.alignment) && 0 != requirementCount;
+    for (const VkSparseImageMemoryRequirements& requirements : sparseRequirements) {
+        usable = usable && VK_IMAGE_ASPECT_COLOR_BIT == requirements.formatProperties.aspectMask && requirements.imageMipTailFirstLod > 0;
+    }
+    m_SparseMemoryType = FindMemoryType(physicalDevice, memoryRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if (!usable || UINT32_MAX == m_SparseMemoryType) {
+        vkDestroyImage(device, image, GetVulkanAllocator());
+        std::cout << "Vulkan virtual texture cache falls back to committed memory, the sparse image has a layout it can't bind by rows.\n";
+        return false;
+    }
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    if (vkCreateSemaphore(device, &semaphoreInfo, GetVulkanAllocator(), &m_SparseSemaphore) != VK_SUCCESS) {
+        vkDestroyImage(device, image, GetVulkanAllocator());
+        std::cout << "Vulkan failed to create virtual texture bind semaphore.\n";
+        return false;
+    }
+
+    m_CacheImage.m_Image = image;
+    m_CacheImage.m_Format = VIRTUAL_TEXTURE_CACHE_FORMAT;
+    m_CacheImage.m_Extent = m_CacheExtent;
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VIRTUAL_TEXTURE_CACHE_FORMAT;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    if (vkCreateImageView(device, &viewInfo, GetVulkanAllocator(), &m_CacheImage.m_View) != VK_SUCCESS) {
+        DestroyImage(device, m_CacheImage);
+        vkDestroySemaphore(device, m_SparseSemaphore, GetVulkanAllocator());
+        m_SparseSemaphore = VK_NULL_HANDLE;
+        std::cout << "Vulkan virtual texture cache falls back to committed memory, its sparse view failed.\n";
+        return false;
+    }
+    m_SparseRowBytes = (VkDeviceSize)std::min(m_CreateInfo.m_CacheSlots, CACHE_SLOTS_PER_ROW) * memoryRequirements.alignment;
+    return true;
+}
+
+bool VulkanVirtualTexture::CreateDescriptors()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    uint32_t framesInFlight = m_CreateInfo.m_FramesInFlight;
+
+    // The page table is fetched texel by texel, the cache filtered within a page's border.
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = (float)m_Header.m_MipCount;
+    if (vkCreateSampler(device, &samplerInfo, GetVulkanAllocator(), &m_PageTableSampler) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create virtual texture page table sampler.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.maxLod = 0.0f;
+    if (vkCreateSampler(device, &samplerInfo, GetVulkanAllocator(), &m_CacheSampler) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create virtual texture cache sampler.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorSetLayoutBinding bindings[VirtualTextureBinding_Count]{};
+    for (uint32_t i = 0; i < VirtualTextureBinding_Count; i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorCount = 1;
+        bindings[i].descriptorType = (VirtualTextureBinding_Params == i) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = VirtualTextureBinding_Count;
+    layoutInfo.pBindings = bindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_DescriptorSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create virtual texture descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorSetLayoutBinding feedbackBindings[2]{};
+    feedbackBindings[0] = { 0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+    feedbackBindings[1] = { 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = feedbackBindings;
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, GetVulkanAllocator(), &m_FeedbackSetLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create virtual texture feedback descriptor set layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorPoolSize poolSizes[4] = {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, framesInFlight },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, framesInFlight },
+    };
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 1 + framesInFlight;
+    poolInfo.poolSizeCount = 4;
+    poolInfo.pPoolSizes = poolSizes;
+    if (vkCreateDescriptorPool(device, &poolInfo, GetVulkanAllocator(), &m_DescriptorPool) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create virtual texture descriptor pool.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_DescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_DescriptorSetLayout;
+    std::vector<VkDescriptorSetLayout> feedbackLayouts(framesInFlight, m_FeedbackSetLayout);
+    m_FeedbackSets.resize(framesInFlight);
+    VkDescriptorSetAllocateInfo feedbackAllocInfo = allocInfo;
+    feedbackAllocInfo.descriptorSetCount = framesInFlight;
+    feedbackAllocInfo.pSetLayouts = feedbackLayouts.data();
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_DescriptorSet) != VK_SUCCESS ||
+        vkAllocateDescriptorSets(device, &feedbackAllocInfo, m_FeedbackSets.data()) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to allocate virtual texture descriptor sets.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkDescriptorBufferInfo paramsInfo = { m_ParamsBuffer.m_Buffer, 0, VK_WHOLE_SIZE };
+    VkDescriptorImageInfo imageInfos[2] = {
+        { m_PageTableSampler, m_PageTableImage.m_View, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+        { m_CacheSampler, m_CacheImage.m_View, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL },
+    };
+    VkWriteDescriptorSet writes[VirtualTextureBinding_Count]{};
+    for (uint32_t i = 0; i < VirtualTextureBinding_Count; i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_DescriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = bindings[i].descriptorType;
+        if (VirtualTextureBinding_Params == i) {
+            writes[i].pBufferInfo = &paramsInfo;
+        } else {
+            writes[i].pImageInfo = &imageInfos[i - VirtualTextureBinding_PageTable];
+        }
+    }
+    vkUpdateDescriptorSets(device, VirtualTextureBinding_Count, writes, 0, nullptr);
+
+    // The feedback image is written with the targets.
+    for (uint32_t i = 0; i < framesInFlight; i++) {
+        VkDescriptorBufferInfo requestInfo = { m_RequestBuffers[i].m_Buffer, 0, VK_WHOLE_SIZE };
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_FeedbackSets[i];
+        write.dstBinding = 1;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pBufferInfo = &requestInfo;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+    }
+    return true;
+}
+
+bool VulkanVirtualTexture::CreatePipeline()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(FeedbackConstants);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_FeedbackSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, GetVulkanAllocator(), &m_FeedbackPipelineLayout) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to create virtual texture feedback pipeline layout.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+
+    VkShaderModule shaderModule = LoadShaderModule(device, "Data/Engine/virtual_texture_feedback.cs.spv");
+    VkResult result = VK_ERROR_INITIALIZATION_FAILED;
+    if (VK_NULL_HANDLE != shaderModule) {
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = shaderModule;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = m_FeedbackPipelineLayout;
+        result = vkCreateComputePipelines(device, m_CreateInfo.m_PipelineCache, 1, &pipelineInfo, GetVulkanAllocator(), &m_FeedbackPipeline);
+        vkDestroyShaderModule(device, shaderModule, GetVulkanAllocator());
+    }
+    if (VK_SUCCESS != result) {
+        m_FeedbackPipeline = VK_NULL_HANDLE;
+        std::cout << "Vulkan failed to create virtual texture feedback pipeline.\n";
+        SetErrorCode(ErrorCode::UnKnow);
+        return false;
+    }
+    return true;
+}
+
+bool VulkanVirtualTexture::CreateTargets(VkExtent2D feedbackExtent, VkImageView feedbackView)
+{
+    VkDescriptorImageInfo feedbackInfo = { VK_NULL_HANDLE, feedbackView, VK_IMAGE_LAYOUT_GENERAL };
+    for (VkDescriptorSet feedbackSet : m_FeedbackSets) {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = feedbackSet;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        write.pImageInfo = &feedbackInfo;
+        vkUpdateDescriptorSets(m_CreateInfo.m_Device, 1, &write, 0, nullptr);
+    }
+    m_FeedbackExtent = feedbackExtent;
+    return true;
+}
+
+void VulkanVirtualTexture::DestroyTargets()
+{
+    m_FeedbackExtent = { 0, 0 };
+}
+
+VkExtent2D VulkanVirtualTexture::GetFeedbackExtent(VkExtent2D viewExtent) const
+{
+    uint32_t divisor = std::max(m_CreateInfo.m_FeedbackDivisor, 1u);
+    return { std::max((viewExtent.width + divisor - 1) / divisor, 1u), std::max((viewExtent.height + divisor - 1) / divisor, 1u) };
+}
+
+void VulkanVirtualTexture::BeginFrame(uint32_t frameIndex)
+{
+    PROFILE_FUNCTION();
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    m_Frame++;
+
+    // What this slot's last frame uploaded is in the cache now.
+    for (uint32_t i = 0; i < (uint32_t)m_StagingPages.size(); i++) {
+        StagingPage& staging = m_StagingPages[i];
+        if (STAGING_UPLOADING == staging.m_State && frameIndex == staging.m_FrameIndex) {
+            staging.m_State = STAGING_FREE;
+            m_FreeStaging.push_back(i);
+        }
+    }
+    CollectReads();
+    RequestPages(frameIndex);
+
+    m_Stats.m_PagesResident = m_Cache.GetResidentCount();
+    m_Stats.m_PagesPending = 0;
+    for (const StagingPage& staging : m_StagingPages) {
+        m_Stats.m_PagesPending += (STAGING_READING == staging.m_State || STAGING_READY == staging.m_State) ? 1 : 0;
+    }
+    PROFILE_COUNTER("VirtualPagesResident", m_Stats.m_PagesResident);
+}
+
+void VulkanVirtualTexture::CollectReads()
+{
+    m_Completions.clear();
+    m_CreateInfo.m_Streaming->CollectCompleted(m_Completions);
+    for (const StreamingCompletion& completion : m_Completions) {
+        uint32_t index = (uint32_t)completion.m_UserData;
+        StagingPage& staging = m_StagingPages[index];
+        if (!completion.m_Succeeded) {
+            // Asked for again by the next feedback still wanting it.
+            m_Cache.Release(staging.m_Slot);
+            staging.m_State = STAGING_FREE;
+            m_FreeStaging.push_back(index);
+            continue;
+        }
+        staging.m_State = STAGING_READY;
+        m_ReadyStaging.push_back(index);
+        m_Stats.m_BytesStreamed += VIRTUAL_TEXTURE_PAGE_BYTES;
+    }
+}
+
+void VulkanVirtualTexture::RequestPages(uint32_t frameIndex)
+{
+    m_Missing.clear();
+    if (m_FeedbackWritten[frameIndex]) {
+        // A wanted page keeps its coarser mips, the fallbacks while it loads, so they are touched & requested too.
+        uint32_t* requests = (uint32_t*)m_RequestBuffers[frameIndex].m_Mapped;
+        uint32_t wordCount = (m_PageCount + 31) / 32;
+        for (uint32_t word = 0; word < wordCount; word++) {
+            uint32_t bits = requests[word];
+            for (uint32_t bit = 0; 0 != bits; bit++, bits >>= 1) {
+                if (0 == (bits & 1)) {
+                    continue;
+                }
+                uint32_t mip, x, y;
+                DecodeVirtualTexturePage(m_Header, word * 32 + bit, mip, x, y);
+                for (; mip < m_Header.m_MipCount; mip++, x /= 2, y /= 2) {
+                    uint32_t page = GetVirtualTexturePageIndex(m_Header, mip, x, y);
+                    if (UINT32_MAX == m_Cache.Touch(page, m_Frame)) {
+                        m_Missing.push_back(page);
+                    }
+                }
+            }
+        }
+        memset(requests, 0, wordCount * sizeof(uint32_t));
+        m_FeedbackWritten[frameIndex] = false;
+    }
+    if (UINT32_MAX == m_Cache.Touch(m_PageCount - 1, m_Frame)) {
+        m_Missing.push_back(m_PageCount - 1);
+    }
+
+    // Coarse mips first, they follow the finer ones in page order.
+    std::sort(m_Missing.begin(), m_Missing.end(), std::greater<uint32_t>());
+    m_Missing.erase(std::unique(m_Missing.begin(), m_Missing.end()), m_Missing.end());
+    m_Stats.m_PagesRequested = (uint32_t)m_Missing.size();
+
+    for (uint32_t page : m_Missing) {
+        if (m_FreeStaging.empty()) {
+            break;
+        }
+        // Pages touched by this frame's feedback are never evicted, the rest waits for a view needing less.
+        uint32_t evictedPage = UINT32_MAX;
+        uint32_t slot = m_Cache.Allocate(page, m_Frame, evictedPage);
+        if (UINT32_MAX == slot) {
+            break;
+        }
+        if (UINT32_MAX != evictedPage) {
+            m_PageTableDirty = true;
+        }
+
+        uint32_t index = m_FreeStaging.back();
+        m_FreeStaging.pop_back();
+        StagingPage& staging = m_StagingPages[index];
+        staging.m_Page = page;
+        staging.m_Slot = slot;
+        staging.m_State = STAGING_READING;
+
+        StreamingRequest request;
+        request.m_File = m_File;
+        request.m_Offset = GetVirtualTexturePageOffset(m_Header, page);
+        request.m_Size = VIRTUAL_TEXTURE_PAGE_BYTES;
+        request.m_Destination = (uint8_t*)m_StagingBuffer.m_Mapped + (size_t)index * VIRTUAL_TEXTURE_PAGE_BYTES;
+        request.m_UserData = index;
+        m_CreateInfo.m_Streaming->Read(request);
+    }
+
+    if (m_Sparse) {
+        uint32_t slotsPerRow = std::min(m_CreateInfo.m_CacheSlots, CACHE_SLOTS_PER_ROW);
+        m_SparseRowsPending = std::max(m_SparseRowsPending, (m_Cache.GetUsedSlotCount() + slotsPerRow - 1) / slotsPerRow);
+    }
+}
+
+void VulkanVirtualTexture::RebuildPageTable()
+{
+    PROFILE_FUNCTION();
+    // Coarsest mip first, a page not resident itself takes its parent's entry, the finest resident page covering it.
+    uint32_t slotsPerRow = std::min(m_CreateInfo.m_CacheSlots, CACHE_SLOTS_PER_ROW);
+    for (uint32_t level = m_Header.m_MipCount; level > 0; level--) {
+        uint32_t mip = level - 1;
+        uint32_t pagesPerSide = GetVirtualTexturePagesPerSide(m_Header, mip);
+        uint32_t first = GetVirtualTexturePageIndex(m_Header, mip, 0, 0);
+        bool hasParent = (level < m_Header.m_MipCount);
+        uint32_t parentFirst = hasParent ? GetVirtualTexturePageIndex(m_Header, mip + 1, 0, 0) : 0;
+        uint32_t parentPerSide = hasParent ? GetVirtualTexturePagesPerSide(m_Header, mip + 1) : 0;
+        for (uint32_t y = 0; y < pagesPerSide; y++) {
+            for (uint32_t x = 0; x < pagesPerSide; x++) {
+                uint32_t page = first + y * pagesPerSide + x;
+                uint32_t slot = m_Cache.Find(page);
+                uint32_t entry = 0;
+                if (UINT32_MAX != slot && m_Cache.IsResident(slot)) {
+                    entry = (slot % slotsPerRow) | ((slot / slotsPerRow) << 8) | (mip << 16) | (1u << 24);
+                } else if (hasParent) {
+                    entry = m_PageTable[parentFirst + (y / 2) * parentPerSide + x / 2];
+                }
+                m_PageTable[page] = entry;
+            }
+        }
+    }
+}
+
+void VulkanVirtualTexture::RecordUpdate(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    PROFILE_FUNCTION();
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    uint32_t slotsPerRow = std::min(m_CreateInfo.m_CacheSlots, CACHE_SLOTS_PER_ROW);
+    // The first update initializes the cache & uploads the page table, dirty since creation.
+    bool firstUpdate = !m_CacheInitialized;
+
+    // Resident as of this frame, the page table below maps them.
+    std::vector<VkBufferImageCopy> copies;
+    copies.reserve(std::min((size_t)m_CreateInfo.m_MaxUploadsPerFrame, m_ReadyStaging.size()));
+    while (!m_ReadyStaging.empty() && copies.size() < m_CreateInfo.m_MaxUploadsPerFrame) {
+        uint32_t index = m_ReadyStaging.front();
+        m_ReadyStaging.pop_front();
+        StagingPage& staging = m_StagingPages[index];
+
+        VkBufferImageCopy copy{};
+        copy.bufferOffset = (VkDeviceSize)index * VIRTUAL_TEXTURE_PAGE_BYTES;
+        copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        copy.imageOffset = { (int32_t)((staging.m_Slot % slotsPerRow) * VIRTUAL_TEXTURE_PAGE_SIZE),
+            (int32_t)((staging.m_Slot / slotsPerRow) * VIRTUAL_TEXTURE_PAGE_SIZE), 0 };
+        copy.imageExtent = { VIRTUAL_TEXTURE_PAGE_SIZE, VIRTUAL_TEXTURE_PAGE_SIZE, 1 };
+        copies.push_back(copy);
+
+        m_Cache.MakeResident(staging.m_Slot, IsPinned(staging.m_Page));
+        staging.m_State = STAGING_UPLOADING;
+        staging.m_FrameIndex = frameIndex;
+        m_PageTableDirty = true;
+    }
+    m_Stats.m_PagesUploaded = (uint32_t)copies.size();
+
+    // Slots are rewritten & entries remapped only once the frames sampling them are done.
+    if (!copies.empty()) {
+        CmdImageBarrier(commandBuffer, m_CacheImage.m_Image, VK_IMAGE_ASPECT_COLOR_BIT,
+            m_CacheInitialized ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+        vkCmdCopyBufferToImage(commandBuffer, m_StagingBuffer.m_Buffer, m_CacheImage.m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            (uint32_t)copies.size(), copies.data());
+        CmdImageBarrier(commandBuffer, m_CacheImage.m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        m_CacheInitialized = true;
+    } else if (!m_CacheInitialized) {
+        CmdImageBarrier(commandBuffer, m_CacheImage.m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        m_CacheInitialized = true;
+    }
+
+    if (!m_PageTableDirty) {
+        return;
+    }
+    RebuildPageTable();
+    memcpy(m_PageTableStaging[frameIndex].m_Mapped, m_PageTable.data(), m_PageTable.size() * sizeof(uint32_t));
+
+    VkBufferImageCopy regions[VIRTUAL_TEXTURE_MAX_MIPS]{};
+    for (uint32_t mip = 0; mip < m_Header.m_MipCount; mip++) {
+        uint32_t pagesPerSide = GetVirtualTexturePagesPerSide(m_Header, mip);
+        regions[mip].bufferOffset = (VkDeviceSize)GetVirtualTexturePageIndex(m_Header, mip, 0, 0) * sizeof(uint32_t);
+        regions[mip].imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 1 };
+        regions[mip].imageExtent = { pagesPerSide, pagesPerSide, 1 };
+    }
+    CmdImageBarrier(commandBuffer, m_PageTableImage.m_Image, VK_IMAGE_ASPECT_COLOR_BIT,
+        firstUpdate ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    vkCmdCopyBufferToImage(commandBuffer, m_PageTableStaging[frameIndex].m_Buffer, m_PageTableImage.m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        m_Header.m_MipCount, regions);
+    CmdImageBarrier(commandBuffer, m_PageTableImage.m_Image, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    m_PageTableDirty = false;
+}
+
+void VulkanVirtualTexture::RecordFeedback(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    frameIndex %= m_CreateInfo.m_FramesInFlight;
+    if (0 == m_FeedbackExtent.width || VK_NULL_HANDLE == m_FeedbackPipeline) {
+        return;
+    }
+
+    FeedbackConstants constants = { m_FeedbackExtent.width, m_FeedbackExtent.height, m_PageCount };
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_FeedbackPipeline);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_FeedbackPipelineLayout, 0, 1, &m_FeedbackSets[frameIndex], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_FeedbackPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(FeedbackConstants), &constants);
+    vkCmdDispatch(commandBuffer, (m_FeedbackExtent.width + VIRTUAL_TEXTURE_FEEDBACK_GROUP_SIZE - 1) / VIRTUAL_TEXTURE_FEEDBACK_GROUP_SIZE,
+        (m_FeedbackExtent.height + VIRTUAL_TEXTURE_FEEDBACK_GROUP_SIZE - 1) / VIRTUAL_TEXTURE_FEEDBACK_GROUP_SIZE, 1);
+
+    VkBufferMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    hostBarrier.buffer = m_RequestBuffers[frameIndex].m_Buffer;
+    hostBarrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+    m_FeedbackWritten[frameIndex] = true;
+}
+
+VkSemaphore VulkanVirtualTexture::FlushSparseBinds(VkQueue queue)
+{
+    if (!m_Sparse || m_SparseRows.size() >= m_SparseRowsPending) {
+        return VK_NULL_HANDLE;
+    }
+
+    // A row of slots at a time, the rows are used in order.
+    uint32_t slotsPerRow = std::min(m_CreateInfo.m_CacheSlots, CACHE_SLOTS_PER_ROW);
+    std::vector<VkSparseImageMemoryBind> binds;
+    while (m_SparseRows.size() < m_SparseRowsPending) {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = m_SparseRowBytes;
+        allocInfo.memoryTypeIndex = m_SparseMemoryType;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        if (vkAllocateMemory(m_CreateInfo.m_Device, &allocInfo, GetVulkanAllocator(), &memory) != VK_SUCCESS) {
+            std::cout << "Vulkan failed to allocate virtual texture cache memory, its pages past row " << m_SparseRows.size() << " won't show.\n";
+            m_SparseRowsPending = (uint32_t)m_SparseRows.size();
+            break;
+        }
+
+        VkSparseImageMemoryBind bind{};
+        bind.subresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0 };
+        bind.offset = { 0, (int32_t)(m_SparseRows.size() * VIRTUAL_TEXTURE_PAGE_SIZE), 0 };
+        bind.extent = { slotsPerRow * VIRTUAL_TEXTURE_PAGE_SIZE, VIRTUAL_TEXTURE_PAGE_SIZE, 1 };
+        bind.memory = memory;
+        bind.memoryOffset = 0;
+        binds.push_back(bind);
+        m_SparseRows.push_back(memory);
+    }
+    if (binds.empty()) {
+        return VK_NULL_HANDLE;
+    }
+
+    VkSparseImageMemoryBindInfo imageBindInfo{};
+    imageBindInfo.image = m_CacheImage.m_Image;
+    imageBindInfo.bindCount = (uint32_t)binds.size();
+    imageBindInfo.pBinds = binds.data();
+
+    VkBindSparseInfo bindInfo{};
+    bindInfo.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+    bindInfo.imageBindCount = 1;
+    bindInfo.pImageBinds = &imageBindInfo;
+    bindInfo.signalSemaphoreCount = 1;
+    bindInfo.pSignalSemaphores = &m_SparseSemaphore;
+    if (vkQueueBindSparse(queue, 1, &bindInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        std::cout << "Vulkan failed to bind virtual texture cache memory.\n";
+        return VK_NULL_HANDLE;
+    }
+    return m_SparseSemaphore;
+}
+
+bool VulkanVirtualTexture::IsSettled() const
+{
+    if (0 != m_Stats.m_PagesRequested || !m_ReadyStaging.empty()) {
+        return false;
+    }
+    for (const StagingPage& staging : m_StagingPages) {
+        if (STAGING_READING == staging.m_State) {
+            return false;
+        }
+    }
+    return true;
+}
+
+VkDeviceSize VulkanVirtualTexture::GetMemoryBytes() const
+{
+    VkDeviceSize cacheBytes = m_Sparse ? (VkDeviceSize)m_SparseRows.size() * m_SparseRowBytes : (VkDeviceSize)m_CreateInfo.m_CacheSlots * VIRTUAL_TEXTURE_PAGE_BYTES;
+    return cacheBytes + (VkDeviceSize)m_PageCount * sizeof(uint32_t);
+}
+
+void VulkanVirtualTexture::Destroy()
+{
+    VkDevice device = m_CreateInfo.m_Device;
+    if (VK_NULL_HANDLE == device) {
+        return;
+    }
+
+    // The workers write into the staging buffer until their reads complete.
+    for (;;) {
+        if (nullptr != m_CreateInfo.m_Streaming) {
+            CollectReads();
+        }
+        bool reading = false;
+        for (const StagingPage& staging : m_StagingPages) {
+            reading = reading || STAGING_READING == staging.m_State;
+        }
+        if (!reading) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    m_StagingPages.clear();
+    m_FreeStaging.clear();
+    m_ReadyStaging.clear();
+
+    if (VK_NULL_HANDLE != m_FeedbackPipeline) {
+        vkDestroyPipeline(device, m_FeedbackPipeline, GetVulkanAllocator());
+        m_FeedbackPipeline = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_FeedbackPipelineLayout) {
+        vkDestroyPipelineLayout(device, m_FeedbackPipelineLayout, GetVulkanAllocator());
+        m_FeedbackPipelineLayout = VK_NULL_HANDLE;
+    }
+    if (VK_NULL_HANDLE != m_DescriptorPool) {
+        vkDestroyDescriptorPool(device, m_DescriptorPool, GetVulkanAllocator());
+        m_DescriptorPool = VK_NULL_HANDLE;
+        m_DescriptorSet = VK_NULL_HANDLE;
+        m_FeedbackSets.clear();
+    }
+    VkDescriptorSetLayout* setLayouts[2] = { &m_DescriptorSetLayout, &m_FeedbackSetLayout };
+    for (VkDescriptorSetLayout* setLayout : setLayouts) {
+        if (VK_NULL_HANDLE != *setLayout) {
+            vkDestroyDescriptorSetLayout(device, *setLayout, GetVulkanAllocator());
+            *setLayout = VK_NULL_HANDLE;
+        }
+    }
+    VkSampler* samplers[2] = { &m_PageTableSampler, &m_CacheSampler };
+    for (VkSampler* sampler : samplers) {
+        if (VK_NULL_HANDLE != *sampler) {
+            vkDestroySampler(device, *sampler, GetVulkanAllocator());
+            *sampler = VK_NULL_HANDLE;
+        }
+    }
+    DestroyBuffer(device, m_ParamsBuffer);
+    for (VulkanBuffer& buffer : m_RequestBuffers) {
+        DestroyBuffer(device, buffer);
+    }
+    m_RequestBuffers.clear();
+    for (VulkanBuffer& buffer : m_PageTableStaging) {
+        DestroyBuffer(device, buffer);
+    }
+    m_PageTableStaging.clear();
+    m_FeedbackWritten.clear();
+    DestroyImage(device, m_PageTableImage);
+    m_PageTable.clear();
+
+    // The sparse rows are freed once nothing binds them.
+    DestroyImage(device, m_CacheImage);
+    for (VkDeviceMemory memory : m_SparseRows) {
+        vkFreeMemory(device, memory, GetVulkanAllocator());
+    }
+    m_SparseRows.clear();
+    m_SparseRowsPending = 0;
+    if (VK_NULL_HANDLE != m_SparseSemaphore) {
+        vkDestroySemaphore(device, m_SparseSemaphore, GetVulkanAllocator());
+        m_SparseSemaphore = VK_NULL_HANDLE;
+    }
+    m_Sparse = false;
+    DestroyBuffer(device, m_StagingBuffer);
+    m_Cache.Destroy();
+    m_FeedbackExtent = { 0, 0 };
+    m_CreateInfo.m_Device = VK_NULL_HANDLE;
+}
+
+__END_NAMESPACE
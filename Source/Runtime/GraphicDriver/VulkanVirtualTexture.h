@@ -0,0 +1,156 @@
+#pragma once
+
+
+__BEGIN_NAMESPACE
+
+
+class StreamingIO;
+
+
+typedef struct VulkanVirtualTextureCreateInfo {
+	VkDevice             m_Device;
+	VkPhysicalDevice     m_PhysicalDevice;
+	VkPipelineCache      m_PipelineCache;
+	uint32_t             m_FramesInFlight = 1;        // Feedback & page table staging slots, the cache is shared in submission order
+	StreamingIO*         m_Streaming;                 // Its completions are all taken as this texture's, give it one of its own
+	std::string          m_Path;                      // A set written by WriteVirtualTextureSet()
+	uint32_t             m_CacheSlots = 256;          // Pages the physical cache holds, what bounds its memory, in whole rows of 32
+	uint32_t             m_StagingPages = 64;         // Pages read or waiting for their upload at once
+	uint32_t             m_MaxUploadsPerFrame = 32;
+	uint32_t             m_FeedbackDivisor = 4;       // The feedback pass is this many times smaller a side than the view
+	bool                 m_SparseResidency = false;   // The device enabled sparseBinding & sparseResidencyImage2D on a sparse binding queue
+} VulkanVirtualTextureCreateInfo;
+
+typedef struct VirtualTextureStats {
+	uint32_t             m_PagesRequested;            // Missing pages the last feedback asked for, their coarser mips included
+	uint32_t             m_PagesUploaded;             // Copied into the cache by the last frame
+	uint32_t             m_PagesResident;
+	uint32_t             m_PagesPending;              // Being read or waiting for their upload
+	uint64_t             m_BytesStreamed;             // Since creation
+} VirtualTextureStats;
+
+
+/**
+ * Virtual texturing of a texture set far larger than the memory given to it. The set's pages stream from a tiled
+ * file into a fixed cache of page slots, which a page table maps the virtual texture onto, each entry pointing at the
+ * finest resident page covering it so a missing page shows a coarser mip of itself rather than nothing.
+ *
+ * What to stream comes from the GPU: a feedback pass a fraction of the view's size writes the page each pixel wants,
+ * and a dispatch folds it into a bit per page the host reads once the frame's fence signaled. Missing pages are
+ * requested coarse mips first, read asynchronously through the streaming layer straight into host visible staging,
+ * and copied into the cache at most m_MaxUploadsPerFrame a frame. The least recently used page makes room, never one
+ * the last feedback asked for, and the coarsest mip's single page is pinned, so every texel always has some mip.
+ *
+ * With sparse residency the cache is a sparse image whose memory is bound a row of slots at a time as they first get
+ * used, see FlushSparseBinds(), so a cache sized for the worst view costs only what the views so far needed.
+ */
+class VulkanVirtualTexture
+{
+public:
+	VulkanVirtualTexture();
+	virtual ~VulkanVirtualTexture();
+
+	bool Create(const VulkanVirtualTextureCreateInfo& createInfo);
+	// Waits for the reads in progress.
+	void Destroy();
+	// The feedback pass's R32_UINT target, left in GENERAL by its pass, a page index per texel or UINT32_MAX.
+	bool CreateTargets(VkExtent2D feedbackExtent, VkImageView feedbackView);
+	void DestroyTargets();
+	VkExtent2D GetFeedbackExtent(VkExtent2D viewExtent) const;
+
+	// Once the frame slot's fence signaled: reads its feedback, collects the finished reads & starts new ones.
+	void BeginFrame(uint32_t frameIndex);
+	// Record outside of a render pass, before the draws sampling the texture: page table & page uploads.
+	void RecordUpdate(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	// Record outside of a render pass, once the feedback pass is done & its dependencies made its writes visible to compute.
+	void RecordFeedback(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+	// Under the queue's lock, before submitting what RecordUpdate() recorded: binds the memory of the cache rows it
+	// first uploads to. The submission waits on the returned semaphore at the transfer stage, VK_NULL_HANDLE when
+	// nothing was bound.
+	VkSemaphore FlushSparseBinds(VkQueue queue);
+
+	// Uniforms, page table & cache for fragment shaders, see virtual_texture_common.glsl.
+	VkDescriptorSetLayout GetDescriptorSetLayout() const { return m_DescriptorSetLayout; }
+	VkDescriptorSet GetDescriptorSet() const { return m_DescriptorSet; }
+	const VirtualTextureHeader& GetHeader() const { return m_Header; }
+	const VirtualTextureStats& GetStats() const { return m_Stats; }
+	// Nothing missing in the last feedback, nothing being read or uploaded.
+	bool IsSettled() const;
+	bool IsSparse() const { return m_Sparse; }
+	// Cache memory committed & the page table, the staging & feedback buffers aside.
+	VkDeviceSize GetMemoryBytes() const;
+
+	static const uint32_t CACHE_SLOTS_PER_ROW = 32;
+	static const uint32_t MAX_CACHE_SLOTS = 1024;
+
+private:
+	enum : uint8_t {
+		STAGING_FREE = 0,
+		STAGING_READING,
+		STAGING_READY,
+		STAGING_UPLOADING,
+	};
+
+	typedef struct StagingPage {
+		uint32_t         m_Page;
+		uint32_t         m_Slot;                          // Of the cache
+		uint32_t         m_FrameIndex;                    // Uploading, freed once this frame slot's fence signaled
+		uint8_t          m_State;
+	} StagingPage;
+
+	VulkanVirtualTextureCreateInfo     m_CreateInfo;
+	VirtualTextureHeader               m_Header;
+	uint32_t                           m_File;
+	uint32_t                           m_PageCount;
+	uint64_t                           m_Frame;
+	VirtualTexturePageCache            m_Cache;
+	VirtualTextureStats                m_Stats;
+
+	VulkanBuffer                       m_StagingBuffer;      // m_StagingPages pages, read into by the streaming workers
+	std::vector<StagingPage>           m_StagingPages;
+	std::vector<uint32_t>              m_FreeStaging;
+	std::deque<uint32_t>               m_ReadyStaging;       // In completion order
+	std::vector<StreamingCompletion>   m_Completions;
+	std::vector<uint32_t>              m_Missing;
+
+	VkExtent2D                         m_CacheExtent;
+	VulkanImage                        m_CacheImage;
+	bool                               m_CacheInitialized;   // Out of the undefined layout
+	bool                               m_Sparse;
+	VkDeviceSize                       m_SparseRowBytes;
+	uint32_t                           m_SparseMemoryType;
+	std::vector<VkDeviceMemory>        m_SparseRows;         // Bound rows of slots, in order
+	uint32_t                           m_SparseRowsPending;  // Rows used, bound or not
+	VkSemaphore                        m_SparseSemaphore;
+
+	std::vector<uint32_t>              m_PageTable;          // Host copy, an entry per page in page index order
+	bool                               m_PageTableDirty;     // Uploaded by the next update, the first one takes it out of the undefined layout
+	VulkanImage                        m_PageTableImage;
+	std::vector<VulkanBuffer>          m_PageTableStaging;   // Per frame in flight
+	std::vector<VulkanBuffer>          m_RequestBuffers;     // Per frame in flight, a bit per page
+	std::vector<bool>                  m_FeedbackWritten;
+	VkExtent2D                         m_FeedbackExtent;
+
+	VulkanBuffer                       m_ParamsBuffer;
+	VkSampler                          m_PageTableSampler;
+	VkSampler                          m_CacheSampler;
+	VkDescriptorSetLayout              m_DescriptorSetLayout;
+	VkDescriptorSetLayout              m_FeedbackSetLayout;
+	VkDescriptorPool                   m_DescriptorPool;
+	VkDescriptorSet                    m_DescriptorSet;
+	std::vector<VkDescriptorSet>       m_FeedbackSets;       // Per frame in flight, for its request bits
+	VkPipelineLayout                   m_FeedbackPipelineLayout;
+	VkPipeline                         m_FeedbackPipeline;
+
+	bool CreateCache();
+	bool CreateSparseCache();
+	bool CreateDescriptors();
+	bool CreatePipeline();
+	void CollectReads();
+	void RequestPages(uint32_t frameIndex);
+	void RebuildPageTable();
+	bool IsPinned(uint32_t page) const { return page + 1 == m_PageCount; }
+};
+
+
+__END_NAMESPACE